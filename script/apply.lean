@@ -47,6 +47,25 @@ def mkFsArgs (n : Nat) : String :=
 def mkIncFs (n : Nat) : String :=
   genSeq n (s!"lean_inc(fx({·})); ") (sep := "")
 
+/-- Maximal arity of the closures that over-application calls directly, see `mkOverApply`. -/
+def overApplyMaxArity := 4
+
+-- Direct calls for over-application of closures with small arity and no or one fixed argument,
+-- which then apply the result to the remaining arguments.
+def mkOverApply (n : Nat) : M Unit := do
+  emit "  if (fixed == 0) {
+    switch (arity) {\n"
+  for j in [1:min overApplyMaxArity (n - 1) + 1] do
+    emit s!"    case {j}: \{ obj* r = FN{j}(f)({mkArgs j}); lean_dec_ref(f); return lean_apply_{n - j}(r, {mkArgsFrom j n}); }\n"
+  emit "    }
+  } else if (fixed == 1) {
+    switch (arity) {\n"
+  for j in [2:min overApplyMaxArity n + 1] do
+    let call := s!"FN{j}(f)(fx(0), {mkArgs (j - 1)})"
+    emit s!"    case {j}: \{ obj* r; if (lean_is_exclusive(f)) \{ r = {call}; lean_free_small_object(f); } else \{ lean_inc(fx(0)); r = {call}; lean_dec_ref(f); } return lean_apply_{n - (j - 1)}(r, {mkArgsFrom (j - 1) n}); }\n"
+  emit "    }
+  }\n"
+
 def mkApplyI (n : Nat) (max : Nat) : M Unit := do
   let argDecls := mkArgDecls n
   let args := mkArgs n
@@ -81,6 +100,7 @@ if (arity == fixed + {n}) \{
   }
 } else if (arity < fixed + {n}) \{\n"
   if n ≥ 2 then do
+    mkOverApply n
     emit  s!"  obj * as[{n}] = \{ {args} };
   obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
   for (unsigned i = 0; i < fixed; i++) \{ lean_inc(fx(i)); args[i] = fx(i); }
@@ -144,12 +164,30 @@ if (arity == fixed + n) \{
 }\n"
 
 def mkFixArgs : M Unit := emit "
+/* Number of additional arguments that fit into the closures allocated by `fix_args`, so that
+   applying an exclusive partial application to further arguments can reuse its memory. */
+#define LEAN_CLOSURE_SLACK 2
+
 static obj* fix_args(obj* f, unsigned n, obj*const* as) {
     unsigned arity = lean_closure_arity(f);
     unsigned fixed = lean_closure_num_fixed(f);
     unsigned new_fixed = fixed + n;
     lean_assert(new_fixed < arity);
-    obj * r = lean_alloc_closure(lean_closure_fun(f), arity, new_fixed);
+    if (lean_is_exclusive(f) &&
+        lean_small_object_size(f) >= sizeof(lean_closure_object) + sizeof(void*)*new_fixed) {
+        obj ** target = lean_closure_arg_cptr(f) + fixed;
+        for (unsigned i = 0; i < n; i++, as++, target++) {
+            *target = *as;
+        }
+        lean_to_closure(f)->m_num_fixed = new_fixed;
+        return f;
+    }
+    unsigned capacity = std::min(arity - 1, new_fixed + LEAN_CLOSURE_SLACK);
+    obj * r = lean_alloc_small_object(sizeof(lean_closure_object) + sizeof(void*)*capacity);
+    lean_set_st_header(r, LeanClosure, 0);
+    lean_to_closure(r)->m_fun = lean_closure_fun(f);
+    lean_to_closure(r)->m_arity = arity;
+    lean_to_closure(r)->m_num_fixed = new_fixed;
     obj ** source = lean_closure_arg_cptr(f);
     obj ** target = lean_closure_arg_cptr(r);
     if (!lean_is_exclusive(f)) {
@@ -187,6 +225,7 @@ def mkApplyCpp (max : Nat) : M Unit := do
   mkCopyright
   emit "// DO NOT EDIT, this is an automatically generated file
 // Generated using script: ../../gen/apply.lean
+#include <algorithm>
 #include \"runtime/apply.h\"
 namespace lean {
 #define obj lean_object
@@ -196,7 +235,10 @@ namespace lean {
   emit "typedef obj* (*fnn)(obj**); // NOLINT
 #define FNN(f) reinterpret_cast<fnn>(lean_closure_fun(f))\n"
   mkCurry max
-  emit "extern \"C\" obj* lean_apply_n(obj*, unsigned, obj**);\n"
+  emit "/* Over-application of closures with small arity and at most one fixed argument, as is common for
+   combinators, calls the function directly and applies the result to the remaining arguments
+   instead of going through `curry` and an argument array. */
+extern \"C\" obj* lean_apply_n(obj*, unsigned, obj**);\n"
   for i in [0:max] do mkApplyI (i+1) max
   mkApplyM max
   mkApplyN max
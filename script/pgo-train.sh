@@ -0,0 +1,32 @@
+#!/usr/bin/env bash
+
+# Collects a clang profile from a build configured with `-DPGO=GENERATE` and merges it into
+# `lean.profdata`, to be passed back as `-DPGO=USE -DPGO_PROFILE=...`; see `doc/make/index.md`.
+# The training workload is building the stage 2 standard library with the instrumented stage 1
+# binaries, followed by the elaboration benchmarks in `tests/bench`.
+
+set -euo pipefail
+
+if [ "$#" -ne 1 ]; then
+    echo "Usage: $0 <build directory, e.g. build/release>"
+    exit 1
+fi
+
+REPO_ROOT=$(git rev-parse --show-toplevel)
+BUILD=$(realpath "$1")
+PROFILES="$BUILD/pgo-profiles"
+LLVM_PROFDATA=${LLVM_PROFDATA:-llvm-profdata}
+
+rm -rf "$PROFILES"
+mkdir -p "$PROFILES"
+# `%m` keeps the profiles of different binaries apart, `%p` those of concurrent processes
+export LLVM_PROFILE_FILE="$PROFILES/lean-%p-%m.profraw"
+
+make -C "$BUILD" stage2 -j"$(nproc || sysctl -n hw.logicalcpu)"
+cd "$REPO_ROOT/tests/bench"
+for f in big_do.lean big_omega.lean lazy_delta.lean reduceMatch.lean simp_arith1.lean; do
+    "$BUILD/stage1/bin/lean" "$f" > /dev/null
+done
+
+"$LLVM_PROFDATA" merge -o "$BUILD/lean.profdata" "$PROFILES"/*.profraw
+echo "Wrote $BUILD/lean.profdata"
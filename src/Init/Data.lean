@@ -17,6 +17,7 @@ import Init.Data.Array
 import Init.Data.Array.Subarray.Split
 import Init.Data.ByteArray
 import Init.Data.FloatArray
+import Init.Data.UInt64Array
 import Init.Data.Fin
 import Init.Data.UInt
 import Init.Data.SInt
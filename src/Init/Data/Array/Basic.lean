@@ -672,6 +672,15 @@ def map {α : Type u} {β : Type v} (f : α → β) (as : Array α) : Array β :
 instance : Functor Array where
   map := map
 
+/--
+Like `Array.map`, but may apply `f` to the elements in parallel on the task manager's worker
+threads. The calling thread participates in the work, and the array is split into ranges lazily,
+so this is cheap even for large arrays of small elements. `f` should be pure and not block.
+-/
+@[extern "lean_array_par_map"]
+def parMap {α : Type u} {β : Type v} (f : α → β) (as : Array α) : Array β :=
+  as.map f
+
 /-- Variant of `mapIdx` which receives the index as a `Fin as.size`. -/
 @[inline]
 def mapFinIdx {α : Type u} {β : Type v} (as : Array α) (f : (i : Nat) → α → (h : i < as.size) → β) : Array β :=
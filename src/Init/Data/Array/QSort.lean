@@ -12,14 +12,15 @@ set_option linter.listVariables true -- Enforce naming conventions for `List`/`A
 
 namespace Array
 
-private def qpartition {n} (as : Vector α n) (lt : α → α → Bool) (lo hi : Nat)
+-- Specialized together with `qsort.sort` so that `lt` is not called as a closure.
+@[specialize] private def qpartition {n} (as : Vector α n) (lt : α → α → Bool) (lo hi : Nat)
     (hlo : lo < n := by omega) (hhi : hi < n := by omega) : {n : Nat // lo ≤ n} × Vector α n :=
   let mid := (lo + hi) / 2
   let as  := if lt as[mid] as[lo] then as.swap lo mid else as
   let as  := if lt as[hi]  as[lo] then as.swap lo hi  else as
   let as  := if lt as[mid] as[hi] then as.swap mid hi else as
   let pivot := as[hi]
-  let rec loop (as : Vector α n) (i j : Nat)
+  let rec @[specialize] loop (as : Vector α n) (i j : Nat)
       (ilo : lo ≤ i := by omega) (jh : j < n := by omega) (w : i ≤ j := by omega) :=
     if h : j < hi then
       if lt as[j] pivot then
@@ -406,14 +406,13 @@ def toSubarray (as : Array α) (start : Nat := 0) (stop : Nat := as.size) : Suba
         stop_le_array_size := Nat.le_refl _ }
 
 /--
-Allocates a new array that contains the contents of the subarray.
+Returns an array that contains the contents of the subarray.
+
+This is `Array.extract`, so no copy is made when the subarray is the only reference to its array.
 -/
 @[coe]
-def ofSubarray (s : Subarray α) : Array α := Id.run do
-  let mut as := mkEmpty (s.stop - s.start)
-  for a in s do
-    as := as.push a
-  return as
+def ofSubarray (s : Subarray α) : Array α :=
+  s.array.extract s.start s.stop
 
 instance : Coe (Subarray α) (Array α) := ⟨ofSubarray⟩
 
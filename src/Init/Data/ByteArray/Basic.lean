@@ -119,6 +119,20 @@ def toList (bs : ByteArray) : List UInt8 :=
     decreasing_by decreasing_trivial_pre_omega
   loop start
 
+/--
+Returns the index of the first occurrence of `b` at or after `start`, or `a.size` if there is none.
+-/
+@[extern "lean_byte_array_index_of"]
+def indexOfAux (a : @& ByteArray) (b : UInt8) (start : @& Nat) : Nat :=
+  (a.findIdx? (· == b) start).getD a.size
+
+/--
+Returns the index of the first occurrence of `b` at or after `start`.
+-/
+@[inline] def indexOf? (a : ByteArray) (b : UInt8) (start := 0) : Option Nat :=
+  let i := a.indexOfAux b start
+  if i < a.size then some i else none
+
 @[inline] def findFinIdx? (a : ByteArray) (p : UInt8 → Bool) (start := 0) : Option (Fin a.size) :=
   let rec @[specialize] loop (i : Nat) :=
     if h : i < a.size then
@@ -204,6 +218,19 @@ def foldlM {β : Type v} {m : Type v → Type w} [Monad m] (f : β → UInt8 →
 def foldl {β : Type v} (f : β → UInt8 → β) (init : β) (as : ByteArray) (start := 0) (stop := as.size) : β :=
   Id.run <| as.foldlM f init start stop
 
+/--
+Sorts the bytes of an array in increasing order.
+
+The runtime implementation is a counting sort that reuses the array if it is not shared.
+-/
+@[extern "lean_byte_array_sort"]
+def sort (a : ByteArray) : ByteArray :=
+  let counts := a.foldl (init := mkArray 256 0) fun counts b => counts.modify b.toNat (· + 1)
+  let rec pushN (r : ByteArray) (b : UInt8) : Nat → ByteArray
+    | 0 => r
+    | n + 1 => pushN (r.push b) b n
+  counts.foldl (init := (emptyWithCapacity a.size, 0)) (fun (r, b) n => (pushN r b.toUInt8 n, b + 1)) |>.1
+
 /-- Iterator over the bytes (`UInt8`) of a `ByteArray`.
 
 Typically created by `arr.iter`, where `arr` is a `ByteArray`.
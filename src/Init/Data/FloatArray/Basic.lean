@@ -165,6 +165,11 @@ def foldlM {β : Type v} {m : Type v → Type w} [Monad m] (f : β → Float →
 def foldl {β : Type v} (f : β → Float → β) (init : β) (as : FloatArray) (start := 0) (stop := as.size) : β :=
   Id.run <| as.foldlM f init start stop
 
+/-- Sums the elements from left to right. -/
+@[extern "lean_float_array_sum"]
+def sum (a : @& FloatArray) : Float :=
+  a.foldl (· + ·) 0
+
 end FloatArray
 
 /--
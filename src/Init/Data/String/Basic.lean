@@ -347,7 +347,8 @@ theorem prev_lt_of_pos (s : String) (i : Pos) (h : i ≠ 0) : (s.prev i).1 < i.1
   simp [prev, h]
   exact utf8PrevAux_lt_of_pos _ _ _ h
 
-def posOfAux (s : String) (c : Char) (stopPos : Pos) (pos : Pos) : Pos :=
+@[extern "lean_string_pos_of_aux"]
+def posOfAux (s : @& String) (c : Char) (stopPos : @& Pos) (pos : @& Pos) : Pos :=
   if h : pos < stopPos then
     if s.get pos == c then pos
     else
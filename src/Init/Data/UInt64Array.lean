@@ -0,0 +1,6 @@
+/-
+Copyright (c) 2025 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+-/
+prelude
+import Init.Data.UInt64Array.Basic
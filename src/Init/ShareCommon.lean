@@ -6,6 +6,7 @@ Authors: Leonardo de Moura, Mario Carneiro
 prelude
 import Init.Util
 import Init.Data.UInt.Basic
+import Init.System.IO
 
 namespace ShareCommon
 /-
@@ -111,3 +112,28 @@ Remark: it optimizes the number of RC operations, and the strategy for caching r
 -/
 @[extern "lean_sharecommon_quick"]
 def ShareCommon.shareCommon' (a : @& α) : α := a
+
+namespace ShareCommon
+
+opaque ConcurrentTablePointed : NonemptyType
+
+/--
+A hash-consing table that can be used by several tasks at the same time, so that terms
+produced by different tasks end up maximally shared with each other.
+Objects stored in the table are kept alive for as long as the table is.
+-/
+def ConcurrentTable : Type := ConcurrentTablePointed.type
+instance : Nonempty ConcurrentTable := ConcurrentTablePointed.property
+
+@[extern "lean_sharecommon_concurrent_table_new"]
+opaque ConcurrentTable.new : BaseIO ConcurrentTable
+
+/--
+Like `ShareCommon.shareCommon'`, but objects are maximally shared with everything previously
+hash-consed in `t`, including by other tasks.
+-/
+@[extern "lean_sharecommon_concurrent"]
+def ConcurrentTable.shareCommon (t : @& ConcurrentTable) (a : @& α) : BaseIO α :=
+  pure a
+
+end ShareCommon
@@ -94,6 +94,22 @@ set_option compiler.extract_closed false in
 @[extern "lean_io_timeit"] opaque timeit (msg : @& String) (fn : IO α) : IO α
 @[extern "lean_io_allocprof"] opaque allocprof (msg : @& String) (fn : IO α) : IO α
 
+/--
+Starts sampling the allocations of all threads, on average once every `period` allocated bytes,
+discarding previous samples. Each sample records the native backtrace of the allocation and the
+name of the declaration being interpreted, if any. Use `writeAllocProfile` to save the samples.
+-/
+@[extern "lean_io_start_alloc_sampling"]
+opaque startAllocSampling (period : USize := 512 * 1024) : BaseIO Unit
+/-- Stops sampling allocations. The samples collected so far are kept. -/
+@[extern "lean_io_stop_alloc_sampling"] opaque stopAllocSampling : BaseIO Unit
+/--
+Writes the allocations sampled since the last `startAllocSampling` to `fname` in the
+[pprof](https://github.com/google/pprof) format. The interpreted declaration is stored in the
+`lean_decl` sample label, e.g. `pprof -top -tagroot=lean_decl <fname>`.
+-/
+@[extern "lean_io_write_alloc_profile"] opaque writeAllocProfile (fname : @& FilePath) : IO Unit
+
 /-- Programs can execute IO actions during initialization that occurs before
    the `main` function is executed. The attribute `[init <action>]` specifies
    which IO action is executed to set the value of an opaque constant.
@@ -231,6 +247,14 @@ def chainTask (t : Task α) (f : α → IO Unit) (prio := Task.Priority.default)
 /-- Request cooperative cancellation of the task. The task must explicitly call `IO.checkCanceled` to react to the cancellation. -/
 @[extern "lean_io_cancel"] opaque cancel : @& Task α → BaseIO Unit
 
+/--
+Registers `act` to be run when the current task is canceled, e.g. to resolve a promise the task is
+blocked on so that it wakes up without polling `IO.checkCanceled`. If the task has already been
+canceled, `act` is run immediately. `act` is run by the thread requesting the cancellation, and is
+discarded if the task finishes first. Outside of a task, this function does nothing.
+-/
+@[extern "lean_io_on_cancel"] opaque onCancel (act : BaseIO Unit) : BaseIO Unit
+
 /-- The current state of a `Task` in the Lean runtime's task manager. -/
 inductive TaskState
   /--
@@ -284,9 +308,120 @@ equivalent.
     (h : tasks.length > 0 := by exact Nat.zero_lt_succ _) : BaseIO α :=
   return tasks[0].get
 
+private opaque TaskSetPointed : NonemptyType.{0}
+
+/--
+A set of tasks from which finished tasks can be taken in the order in which they finish.
+
+Unlike repeated calls to `IO.waitAny`, which scan the whole list on every wakeup, taking a
+finished task from a `TaskSet` takes constant time, so draining `n` tasks is `O(n)`.
+-/
+def TaskSet (_ : Type) : Type := TaskSetPointed.type
+
+instance : Nonempty (TaskSet α) := TaskSetPointed.property
+
+/-- Creates a new, empty `TaskSet`. -/
+@[extern "lean_io_task_set_new"] opaque TaskSet.new : BaseIO (TaskSet α)
+
+/-- Adds a task to the set. It can be taken from the set once it has finished. -/
+@[extern "lean_io_task_set_add"] opaque TaskSet.add (set : @& TaskSet α) (t : Task α) : BaseIO Unit
+
+/--
+Waits until any task in the set has finished, removes it from the set and returns it. Returns
+`none` if the set is empty.
+-/
+@[extern "lean_io_task_set_take"] opaque TaskSet.take? (set : @& TaskSet α) : BaseIO (Option (Task α))
+
+/--
+Removes a finished task from the set and returns it, or returns `none` if no task in the set has
+finished yet.
+-/
+@[extern "lean_io_task_set_try_take"] opaque TaskSet.tryTake? (set : @& TaskSet α) : BaseIO (Option (Task α))
+
+/-- Returns the number of tasks in the set, finished or not. -/
+@[extern "lean_io_task_set_size"] opaque TaskSet.size (set : @& TaskSet α) : BaseIO Nat
+
+/--
+Returns the number of worker threads of the task manager, or `0` if tasks are run synchronously.
+-/
+@[extern "lean_io_get_num_threads"] opaque getNumThreads : BaseIO Nat
+
+/--
+Changes the number of worker threads of the task manager, e.g. to shrink an idle server process or
+to follow a changed CPU quota. The new size is at least `1`. Excess workers finish their current
+task before they stop picking up new work. Has no effect if tasks are run synchronously.
+-/
+@[extern "lean_io_set_num_threads"] opaque setNumThreads (n : @& Nat) : BaseIO Unit
+
 /-- Helper method for implementing "deterministic" timeouts. It is the number of "small" memory allocations performed by the current execution thread. -/
 @[extern "lean_io_get_num_heartbeats"] opaque getNumHeartbeats : BaseIO Nat
 
+/--
+Returns how often, summed over all threads, an operation on a shared `IO.Ref` found its value held
+by another thread, and how often such an operation had to stop spinning and sleep until the value
+was put back. High numbers indicate that a ref is a point of contention.
+-/
+@[extern "lean_io_get_ref_contention"] opaque getRefContention : BaseIO (Nat × Nat)
+
+/-- Memory usage of the process, see `IO.getMemoryStats`. All sizes are in bytes. -/
+structure MemoryStats where
+  /-- Resident set size of the process. -/
+  rss : Nat
+  /-- Peak resident set size of the process. -/
+  peakRss : Nat
+  /-- Memory obtained from the operating system by the small object allocator. -/
+  allocator : Nat
+  /-- Memory of the compacted regions of loaded `.olean` files. -/
+  compactedRegions : Nat
+  /-- Resident set size above which the runtime evicts caches, or `0` if unset. -/
+  softLimit : Nat
+  /-- Resident set size above which the runtime throws an out of memory error, or `0` if unset. -/
+  hardLimit : Nat
+  deriving Inhabited, Repr
+
+/--
+Returns the current memory usage of the process. When a memory limit is set, e.g. by `lean --memory`,
+the resident set size is sampled in the background and internal caches are evicted once it
+exceeds the soft limit.
+-/
+@[extern "lean_io_get_memory_stats"] opaque getMemoryStats : BaseIO MemoryStats
+
+/-- Statistics about one size class of the runtime's small object allocator. -/
+structure AllocSizeClassStats where
+  /-- Size in bytes of the objects of this size class. -/
+  objSize : Nat
+  /-- Number of allocator pages currently assigned to this size class. -/
+  numPages : Nat
+  /-- Number of objects of this size class currently allocated. -/
+  numLiveObjects : Nat
+  /-- Number of objects that fit into the pages of this size class. -/
+  capacity : Nat
+  deriving Inhabited, Repr
+
+/--
+Statistics about the runtime's small object allocator, aggregated over the heaps of all threads.
+The numbers for heaps of threads other than the current one are periodically republished
+snapshots, so they may be slightly out of date.
+-/
+structure AllocStats where
+  /-- Number of thread heaps created so far. Heaps of finished threads are reused. -/
+  numHeaps : Nat
+  /-- Number of allocator segments currently mapped. -/
+  numSegments : Nat
+  /-- Number of pages currently returned to the operating system. -/
+  numReleasedPages : Nat
+  /-- Number of objects freed by a thread other than the one that allocated them. -/
+  numRemoteFrees : Nat
+  /-- Statistics for each size class with at least one page. -/
+  sizeClasses : Array AllocSizeClassStats
+  deriving Inhabited, Repr
+
+/--
+Returns statistics about the runtime's small object allocator. Objects larger than the biggest size
+class are allocated with the system allocator and are not included.
+-/
+@[extern "lean_io_get_alloc_stats"] opaque getAllocStats : BaseIO AllocStats
+
 /--
 Sets the heartbeat counter of the current thread to the given amount. This can be used to avoid
 counting heartbeats of code whose execution time is non-deterministic.
@@ -457,7 +592,34 @@ If the returned array is empty, an end-of-file marker has been reached.
 Note that EOF does not actually close a handle, so further reads may block and return more data.
 -/
 @[extern "lean_io_prim_handle_read"] opaque read (h : @& Handle) (bytes : USize) : IO ByteArray
+/--
+Read up to `bytes` bytes from the handle into `buf` at offset `off`, and return `buf` truncated to
+the end of the data read. If `off` is larger than `buf.size`, `buf.size` is used instead.
+If `buf` is not shared and has enough capacity, no memory is allocated, so reusing the returned
+buffer gives allocation-free read loops. If nothing was read, an end-of-file marker has been reached.
+-/
+@[extern "lean_io_prim_handle_read_into"]
+opaque readInto (h : @& Handle) (buf : ByteArray) (off : USize) (bytes : USize) : IO ByteArray
 @[extern "lean_io_prim_handle_write"] opaque write (h : @& Handle) (buffer : @& ByteArray) : IO Unit
+/--
+Writes all the given buffers, in order, with as few system calls as possible (`writev`).
+Buffered data from previous writes is flushed first.
+-/
+@[extern "lean_io_prim_handle_write_many"]
+opaque writeMany (h : @& Handle) (buffers : @& Array ByteArray) : IO Unit
+/--
+Reads up to `bytes` bytes starting at byte `offset` of the file (`pread`). On POSIX systems, this
+does not change the position of the handle, so it can be used by several tasks at the same time.
+If the returned array is empty, `offset` is at or past the end of the file.
+-/
+@[extern "lean_io_prim_handle_read_at"]
+opaque readAt (h : @& Handle) (offset : UInt64) (bytes : USize) : IO ByteArray
+/--
+Writes `buffer` starting at byte `offset` of the file (`pwrite`). On POSIX systems, this does not
+change the position of the handle.
+-/
+@[extern "lean_io_prim_handle_write_at"]
+opaque writeAt (h : @& Handle) (offset : UInt64) (buffer : @& ByteArray) : IO Unit
 
 /--
 Read text up to (including) the next line break from the handle.
@@ -469,6 +631,51 @@ Note that EOF does not actually close a handle, so further reads may block and r
 
 end Handle
 
+/--
+A read-only view of the contents of a file. Where the platform supports it, the file is memory
+mapped, so only the parts that are accessed are read from disk. The contents are unspecified if
+the file is modified while it is mapped. If it is truncated, accessing the contents beyond its new
+end kills the process with `SIGBUS`, including through `extract` and `hash`. Files that other
+processes may truncate should be read with `readBinFile` or hashed with `hashBinFile` instead.
+-/
+opaque MappedFile : Type := Unit
+
+/-- Expected access patterns for `MappedFile.advise`, following the POSIX `madvise` values. -/
+inductive MappedFile.Advice where
+  | normal
+  | sequential
+  | random
+  /-- The contents will be accessed soon, so they should be read ahead. -/
+  | willNeed
+  /-- The contents will not be accessed soon, so their pages can be dropped. -/
+  | dontNeed
+
+namespace MappedFile
+
+/-- Maps the whole file `fname`. The mapping is released once the `MappedFile` is no longer used. -/
+@[extern "lean_io_mapped_file_mk"] opaque mk (fname : @& FilePath) : IO MappedFile
+@[extern "lean_io_mapped_file_size"] opaque size (m : @& MappedFile) : Nat
+/-- Returns the byte at index `i`. Panics and returns `0` if `i` is out of bounds. -/
+@[extern "lean_io_mapped_file_get"] opaque get! (m : @& MappedFile) (i : @& Nat) : UInt8
+/-- Copies the bytes from `start` to `stop` (exclusive) into a new `ByteArray`; bounds are clamped. -/
+@[extern "lean_io_mapped_file_extract"] opaque extract (m : @& MappedFile) (start stop : @& Nat) : ByteArray
+/-- Tells the operating system how the file will be accessed. Has no effect if it is not memory mapped. -/
+@[extern "lean_io_mapped_file_advise"] opaque advise (m : @& MappedFile) (advice : Advice) : IO Unit
+/--
+Hashes the contents of the file without copying them. The result is the same as that of
+`hash (m.extract 0 m.size)`.
+-/
+@[extern "lean_io_mapped_file_hash"] opaque hash (m : @& MappedFile) : UInt64
+
+end MappedFile
+
+/--
+Hashes the contents of the file `fname` without reading all of it into memory at once. The result
+is the same as that of `hash (← readBinFile fname)`. Unlike `MappedFile.hash`, fails with an error
+instead of crashing if the file is truncated while it is being hashed.
+-/
+@[extern "lean_io_hash_bin_file"] opaque hashBinFile (fname : @& FilePath) : IO UInt64
+
 /--
 Resolves a pathname to an absolute pathname with no '.', '..', or symbolic links.
 
@@ -527,11 +734,12 @@ def Handle.putStrLn (h : Handle) (s : String) : IO Unit :=
 
 partial def Handle.readBinToEndInto (h : Handle) (buf : ByteArray) : IO ByteArray := do
   let rec loop (acc : ByteArray) : IO ByteArray := do
-    let buf ← h.read 1024
-    if buf.isEmpty then
+    let sz := acc.size
+    let acc ← h.readInto acc sz.toUSize 1024
+    if acc.size == sz then
       return acc
     else
-      loop (acc ++ buf)
+      loop acc
   loop buf
 
 partial def Handle.readBinToEnd (h : Handle) : IO ByteArray := do
@@ -543,19 +751,26 @@ def Handle.readToEnd (h : Handle) : IO String := do
   | some s => return s
   | none => throw <| .userError s!"Tried to read from handle containing non UTF-8 data."
 
-partial def lines (fname : FilePath) : IO (Array String) := do
-  let h ← Handle.mk fname Mode.read
-  let rec read (lines : Array String) := do
+/--
+Folds `f` over the remaining lines of `h`, reading one line at a time, so that the whole contents
+never need to be in memory. As in `IO.FS.lines`, the line terminators `\n` and `\r\n` are removed.
+-/
+partial def Handle.foldLines {α : Type} (h : Handle) (init : α) (f : α → String → IO α) : IO α := do
+  let rec read (acc : α) := do
     let line ← h.getLine
     if line.length == 0 then
-      pure lines
+      pure acc
     else if line.back == '\n' then
       let line := line.dropRight 1
       let line := if line.back == '\r' then line.dropRight 1 else line
-      read <| lines.push line
+      read (← f acc line)
     else
-      pure <| lines.push line
-  read #[]
+      f acc line
+  read init
+
+def lines (fname : FilePath) : IO (Array String) := do
+  let h ← Handle.mk fname Mode.read
+  h.foldLines #[] fun lines line => pure <| lines.push line
 
 def writeBinFile (fname : FilePath) (content : ByteArray) : IO Unit := do
   let h ← Handle.mk fname Mode.write
@@ -608,6 +823,14 @@ open IO
 @[extern "lean_io_read_dir"]
 opaque readDir : @& FilePath → IO (Array IO.FS.DirEntry)
 
+/--
+Like `readDir`, but also returns the type of each entry. Symbolic links are not followed, so links
+are reported as `FileType.symlink`. The type is taken from the directory listing where the file
+system provides it, which avoids a separate `metadata` call per entry.
+-/
+@[extern "lean_io_read_dir_with_type"]
+opaque readDirWithType : @& FilePath → IO (Array (IO.FS.DirEntry × IO.FS.FileType))
+
 @[extern "lean_io_metadata"]
 opaque metadata : @& FilePath → IO IO.FS.Metadata
 
@@ -628,20 +851,24 @@ where
   go p := do
     if !(← enter p) then
       return ()
-    for d in (← p.readDir) do
+    for (d, type) in (← p.readDirWithType) do
       modify (·.push d.path)
-      match (← d.path.metadata.toBaseIO) with
-      | .ok { type := .symlink, .. } =>
-        let p' ← FS.realPath d.path
-        if (← p'.isDir) then
-          -- do not call `enter` on a non-directory symlink
-          if (← enter p) then
-            go p'
-      | .ok { type := .dir, .. } => go d.path
-      | .ok _ => pure ()
-      -- entry vanished, ignore
-      | .error (.noFileOrDirectory ..) => pure ()
-      | .error e => throw e
+      match type with
+      | .dir => go d.path
+      | .symlink =>
+        match (← d.path.metadata.toBaseIO) with
+        | .ok { type := .symlink, .. } =>
+          let p' ← FS.realPath d.path
+          if (← p'.isDir) then
+            -- do not call `enter` on a non-directory symlink
+            if (← enter p) then
+              go p'
+        | .ok { type := .dir, .. } => go d.path
+        | .ok _ => pure ()
+        -- entry vanished, ignore
+        | .error (.noFileOrDirectory ..) => pure ()
+        | .error e => throw e
+      | _ => pure ()
 
 end System.FilePath
 
@@ -733,8 +960,8 @@ partial def createDirAll (p : FilePath) : IO Unit := do
   Fully remove given directory by deleting all contained files and directories in an unspecified order.
   Fails if any contained entry cannot be deleted or was newly created during execution. -/
 partial def removeDirAll (p : FilePath) : IO Unit := do
-  for ent in (← p.readDir) do
-    if (← ent.path.isDir : Bool) then
+  for (ent, type) in (← p.readDirWithType) do
+    if type == .dir then
       removeDirAll ent.path
     else
       removeFile ent.path
@@ -844,17 +1071,27 @@ structure Output where
   stdout   : String
   stderr   : String
 
+/--
+Reads both handles to their end concurrently, so that a process blocked on writing to one of them
+cannot stall reading the other. The handles are read at the file descriptor level and must not
+have been read from before, as in the output pipes of a freshly spawned `Child`.
+-/
+@[extern "lean_io_process_read_outputs"]
+opaque readOutputs (h₁ h₂ : @& FS.Handle) : IO (ByteArray × ByteArray)
+
 /--
 Run process to completion and capture output.
 The process does not inherit the standard input of the caller.
 -/
 def output (args : SpawnArgs) : IO Output := do
   let child ← spawn { args with stdout := .piped, stderr := .piped, stdin := .null }
-  let stdout ← IO.asTask child.stdout.readToEnd Task.Priority.dedicated
-  let stderr ← child.stderr.readToEnd
+  let (stdout, stderr) ← readOutputs child.stdout child.stderr
   let exitCode ← child.wait
-  let stdout ← IO.ofExcept stdout.get
-  pure { exitCode := exitCode, stdout := stdout, stderr := stderr }
+  let toString (data : ByteArray) : IO String :=
+    match String.fromUTF8? data with
+    | some s => return s
+    | none => throw <| .userError s!"Tried to read from handle containing non UTF-8 data."
+  pure { exitCode := exitCode, stdout := ← toString stdout, stderr := ← toString stderr }
 
 /-- Run process to completion and return stdout on success. -/
 def run (args : SpawnArgs) : IO String := do
@@ -936,6 +1173,53 @@ private def isSetExport := @isSet
 
 end CancelToken
 
+/-- Implementation detail of `CacheCell`. -/
+opaque CacheCellPointed : NonemptyType.{0}
+
+/--
+Mutable cell for a cached value that can be recomputed when needed. The runtime empties all cache
+cells once memory usage exceeds the soft memory limit, which defaults to 80% of the limit set with
+`--memory`, so `get?` may return `none` at any time after `set`.
+
+A cell can be shared between threads. Its value is marked as multi-threaded when it is stored.
+-/
+structure CacheCell (α : Type) : Type where
+  private ref : CacheCellPointed.type
+
+instance : Nonempty (CacheCell α) :=
+  ⟨{ ref := Classical.choice CacheCellPointed.property }⟩
+
+namespace CacheCell
+
+/-- Creates a new empty cache cell. -/
+@[extern "lean_io_cache_cell_new"]
+opaque new : BaseIO (CacheCell α)
+
+/-- Returns the value of the cell, or `none` if it is empty. -/
+@[extern "lean_io_cache_cell_get"]
+opaque get? (c : @& CacheCell α) : BaseIO (Option α)
+
+/-- Stores `a` in the cell, replacing its previous value. -/
+@[extern "lean_io_cache_cell_set"]
+opaque set (c : @& CacheCell α) (a : α) : BaseIO Unit
+
+/-- Empties the cell. -/
+@[extern "lean_io_cache_cell_clear"]
+opaque clear (c : @& CacheCell α) : BaseIO Unit
+
+/--
+Returns the value of the cell if it is not empty, or otherwise computes it with `f` and stores
+it. Concurrent callers may compute the value more than once.
+-/
+def getOrCompute (c : CacheCell α) (f : BaseIO α) : BaseIO α := do
+  if let some a ← c.get? then
+    return a
+  let a ← f
+  c.set a
+  return a
+
+end CacheCell
+
 namespace FS
 namespace Stream
 
@@ -1021,6 +1305,22 @@ not used concurrently or which are already persistent.
 @[extern "lean_runtime_mark_persistent"]
 unsafe def Runtime.markPersistent (a : α) : BaseIO α := return a
 
+/--
+Evaluates `f ()` with the small objects allocated by the current thread placed in a fresh region,
+and returns a copy of the result allocated outside of it. Objects that become garbage inside the
+region are not freed one by one; the whole region is released at once when `f` returns. This can
+speed up short computations that allocate many small temporary objects.
+
+This function is only safe to use if `f` does not create tasks or promises, does not store values
+in `IO.Ref`s or other mutable state that outlives the call, and does not return objects that are
+shared with values created by other threads. References from region garbage to objects allocated
+outside of the region are never released. Values that outlive the region are allocated or copied
+outside of it: those of thunks created before the call, lazily initialized closed terms, and values
+passed to `Runtime.markPersistent`.
+-/
+@[extern "lean_with_region"]
+unsafe def Runtime.withRegion (f : Unit → α) : α := f ()
+
 set_option linter.unusedVariables false in
 /--
 Discards the passed owned reference. This leads to `a` any any object reachable from it never being
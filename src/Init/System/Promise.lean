@@ -76,6 +76,21 @@ Like `Promise.result`, but resolves to `dflt` if the promise is dropped without
 @[macro_inline] def Promise.resultD (promise : Promise α) (dflt : α) : Task α :=
   promise.result?.map (sync := true) (·.getD dflt)
 
+@[extern "lean_io_select"]
+private opaque selectCore [Nonempty α] (tasks : @& Array (Task α)) : BaseIO (Task (Option (Nat × α)))
+
+/--
+Returns a task that finishes as soon as any of `tasks` has finished, with the index and the result of
+the first such task.
+
+Unlike `IO.waitAny`, this does not block a thread while waiting: a single continuation is registered
+on every task and the registrations on the remaining tasks are removed once the first one finishes.
+If several tasks are already finished, the one with the smallest index is chosen.
+-/
+def select [Nonempty α] (tasks : Array (Task α)) (_h : 0 < tasks.size := by exact Nat.zero_lt_succ _) :
+    BaseIO (Task (Nat × α)) := do
+  return (← selectCore tasks).map (sync := true) Option.getOrBlock!
+
 /--
 Checks whether the promise has already been resolved, i.e. whether access to `result*` will return
 immediately.
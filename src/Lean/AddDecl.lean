@@ -9,6 +9,12 @@ import Lean.Namespace
 
 namespace Lean
 
+register_builtin_option kernel.profile : Bool := {
+  defValue := false
+  group    := "profiler"
+  descr    := "report kernel type checker counters (reductions, cache hits, lazy delta steps) for each declaration"
+}
+
 /-- Adds given declaration to the environment, respecting `debug.skipKernelTC`. -/
 def Kernel.Environment.addDecl (env : Environment) (opts : Options) (decl : Declaration)
     (cancelTk? : Option IO.CancelToken := none) : Except Exception Environment :=
@@ -83,7 +89,14 @@ where doAdd := do
     withTraceNode `Kernel (fun _ => return m!"typechecking declarations {decl.getTopLevelNames}") do
       if !(← MonadLog.hasErrors) && decl.hasSorry then
         logWarning <| .tagged `hasSorry m!"declaration uses 'sorry'"
-      let env ← (← getEnv).addDeclAux (← getOptions) decl (← read).cancelTk?
+      let opts ← getOptions
+      if kernel.profile.get opts && !debug.skipKernelTC.get opts then
+        let (env, prof) ← ofExceptKernelException <|
+          (← getEnv).addDeclProfiled (Core.getMaxHeartbeats opts).toUSize decl (← read).cancelTk?
+        logInfo m!"kernel profile for {decl.getTopLevelNames}: {prof}"
+        setEnv env
+        return
+      let env ← (← getEnv).addDeclAux opts decl (← read).cancelTk?
         |> ofExceptKernelException
       setEnv env
 
@@ -13,25 +13,59 @@ structure ClosedTermCache where
   constNames : NameSet := {}
   -- used for `replay?` only
   revExprs   : List Expr := []
-  deriving Inhabited
+  /--
+  Closed terms of imported modules, so that the compiler can refer to them instead of extracting
+  and initializing the same term again. Only built when the compiler first looks up a term.
+  -/
+  importedMap : Thunk (PHashMap Expr Name) := .pure {}
+  /--
+  Whether other modules may refer to the closed terms of this module, which is not the case when
+  they are initialized lazily, see `compiler.lazyClosedTerms`.
+  -/
+  shared     : Bool := true
 
-builtin_initialize closedTermCacheExt : EnvExtension ClosedTermCache ←
-  registerEnvExtension (pure {}) (asyncMode := .sync)  -- compilation is non-parallel anyway
-    (replay? := some fun oldState newState _ s =>
+instance : Inhabited ClosedTermCache := ⟨{}⟩
+
+builtin_initialize closedTermCacheExt : PersistentEnvExtension (Expr × Name) (Expr × Name) ClosedTermCache ←
+  registerPersistentEnvExtension {
+    mkInitial       := pure {}
+    addImportedFn   := fun entries => pure {
+      importedMap := Thunk.mk fun _ =>
+        entries.foldl (init := {}) fun m es => es.foldl (init := m) fun m (e, n) => m.insert e n }
+    addEntryFn      := fun s (e, n) =>
+      { s with map := s.map.insert e n, constNames := s.constNames.insert n, revExprs := e :: s.revExprs }
+    exportEntriesFn := fun s =>
+      if s.shared then s.revExprs.reverse.toArray.map fun e => (e, s.map.find! e) else #[]
+    asyncMode       := .sync  -- compilation is non-parallel anyway
+    replay?         := some fun oldState newState _ s =>
       let newExprs := newState.revExprs.take (newState.revExprs.length - oldState.revExprs.length)
       newExprs.foldl (init := s) fun s e =>
         let c := newState.map.find! e
-        { s with map := s.map.insert e c, constNames := s.constNames.insert c, revExprs := e :: s.revExprs })
+        { s with map := s.map.insert e c, constNames := s.constNames.insert c, revExprs := e :: s.revExprs }
+  }
 
 @[export lean_cache_closed_term_name]
 def cacheClosedTermName (env : Environment) (e : Expr) (n : Name) : Environment :=
-  closedTermCacheExt.modifyState env fun s => { s with map := s.map.insert e n, constNames := s.constNames.insert n }
+  closedTermCacheExt.addEntry env (e, n)
+
+/-- Closed terms of this module are only referred to by this module from now on. -/
+@[export lean_disable_closed_term_sharing]
+def disableClosedTermSharing (env : Environment) : Environment :=
+  closedTermCacheExt.modifyState env fun s => { s with shared := false }
 
 @[export lean_get_closed_term_name]
 def getClosedTermName? (env : Environment) (e : Expr) : Option Name :=
-  (closedTermCacheExt.getState env).map.find? e
+  let s := closedTermCacheExt.getState env
+  s.map.find? e <|> s.importedMap.get.find? e
 
 def isClosedTermName (env : Environment) (n : Name) : Bool :=
   (closedTermCacheExt.getState env).constNames.contains n
 
+/--
+Whether other modules may refer to the closed terms of the current module, which then need to be
+exported.
+-/
+def closedTermsShared (env : Environment) : Bool :=
+  (closedTermCacheExt.getState env).shared
+
 end Lean
@@ -20,6 +20,8 @@ import Lean.Compiler.IR.ExpandResetReuse
 import Lean.Compiler.IR.UnboxResult
 import Lean.Compiler.IR.ElimDeadBranches
 import Lean.Compiler.IR.EmitC
+import Lean.Compiler.IR.StackCtors
+import Lean.Compiler.IR.ExclusiveLoops
 import Lean.Compiler.IR.CtorLayout
 import Lean.Compiler.IR.Sorry
 
@@ -13,10 +13,32 @@ import Lean.Compiler.IR.EmitUtil
 import Lean.Compiler.IR.NormIds
 import Lean.Compiler.IR.SimpCase
 import Lean.Compiler.IR.Boxing
+import Lean.Compiler.IR.StackCtors
+import Lean.Compiler.IR.ExclusiveLoops
 
 namespace Lean.IR.EmitC
 open ExplicitBoxing (requiresBoxedVersion mkBoxedName isBoxedName)
 
+register_builtin_option compiler.lazyClosedTerms : Bool := {
+  defValue := false
+  descr    := "(C backend) initialize closed terms extracted by the compiler on first access instead of in the module initializer"
+}
+
+register_builtin_option compiler.stackCtors : Bool := {
+  defValue := false
+  descr    := "(C backend) allocate constructor objects that do not escape the current function on the stack"
+}
+
+register_builtin_option compiler.exclusiveLoops : Bool := {
+  defValue := false
+  descr    := "(C backend) hoist the exclusivity checks of scalar arrays updated in place out of loops by emitting the loop body a second time for the iterations following the first one"
+}
+
+register_builtin_option compiler.symbolTable : Bool := {
+  defValue := false
+  descr    := "(C backend) emit a table of the native symbols of the module, which the interpreter registers when the module is loaded from a shared library; set by Lake for modules with `precompileModules`"
+}
+
 def leanMainFn := "_lean_main"
 
 structure Context where
@@ -25,6 +47,30 @@ structure Context where
   jpMap      : JPParamsMap := {}
   mainFn     : FunId := default
   mainParams : Array Param := #[]
+  /-- See `compiler.lazyClosedTerms`. -/
+  lazyClosedTerms : Bool := false
+  /-- See `compiler.stackCtors`. -/
+  stackCtors : Bool := false
+  /-- Constructor objects of the current function allocated on the stack, see `Decl.stackCtors`. -/
+  stackCtorVars : IndexSet := {}
+  /-- Declarations of the current module. -/
+  modDecls   : NameSet := {}
+  /-- See `compiler.exclusiveLoops`. -/
+  exclusiveLoops : Bool := false
+  /-- See `compiler.symbolTable`. -/
+  symbolTable : Bool := false
+  /-- Variables known to be exclusive, see `Decl.exclusiveLoopParams`. -/
+  exclusiveVars : IndexSet := {}
+  /-- Suffix of the labels of the current copy of the function body. -/
+  labelSuffix : String := ""
+  /-- Label that self tail calls jump to. -/
+  startLabel : String := "_start"
+  /--
+  In the first copy of the body of a function with exclusive loop parameters, these parameters
+  and the unshared update results, see `Decl.exclusiveLoopParams`. Self tail calls passing such a
+  result for each of the parameters jump to the second copy instead of `startLabel`.
+  -/
+  exclusiveEntry? : Option (IndexSet × IndexSet) := none
 
 abbrev M := ReaderT Context (EStateM String String)
 
@@ -92,11 +138,24 @@ def toCInitName (n : Name) : M String := do
 def emitCInitName (n : Name) : M Unit :=
   toCInitName n >>= emit
 
+/--
+Whether `decl` is a closed term the module initializer leaves alone. Its value is stored in an atomic
+cell instead, which `lean_get_lazy_closed_term` fills by calling the `_init_` function on first access.
+-/
+def isLazyClosedTerm (decl : Decl) : M Bool := do
+  let env ← getEnv
+  return (← read).lazyClosedTerms && decl.params.isEmpty && decl.resultType.isObj &&
+    isClosedTermName env decl.name && !closedTermsShared env && !hasInitAttr env decl.name
+
 def emitFnDeclAux (decl : Decl) (cppBaseName : String) (isExternal : Bool) : M Unit := do
   let ps := decl.params
   let env ← getEnv
+  if ← isLazyClosedTerm decl then
+    emitLn ("static lean_object* _init_" ++ cppBaseName ++ "(void);")
+    emitLn ("static _Atomic(lean_object*) " ++ cppBaseName ++ ";")
+    return
   if ps.isEmpty then
-    if isClosedTermName env decl.name then emit "static "
+    if isClosedTermName env decl.name && !closedTermsShared env then emit "static "
     else if isExternal then emit "extern "
     else emit "LEAN_EXPORT "
   else
@@ -256,13 +315,29 @@ def declareVar (x : VarId) (t : IRType) : M Unit := do
 def declareParams (ps : Array Param) : M Unit :=
   ps.forM fun p => declareVar p.x p.ty
 
+def emitCtorScalarSize (usize : Nat) (ssize : Nat) : M Unit := do
+  if usize == 0 then emit ssize
+  else if ssize == 0 then emit "sizeof(size_t)*"; emit usize
+  else emit "sizeof(size_t)*"; emit usize; emit " + "; emit ssize
+
+def isStackCtor (x : VarId) : M Bool :=
+  return (← read).stackCtorVars.contains x.idx
+
+/-- Declare the storage of the stack constructor object `x`, rounded up to whole `uint64_t`s. -/
+def declareStackCtor (x : VarId) (c : CtorInfo) : M Unit := do
+  emit "uint64_t "; emit x; emit "_stk[(sizeof(lean_ctor_object) + sizeof(void*)*"; emit c.size
+  emit " + "; emitCtorScalarSize c.usize c.ssize; emit " + 7) / 8]; "
+
 partial def declareVars : FnBody → Bool → M Bool
-  | e@(FnBody.vdecl x t _ b), d => do
+  | e@(FnBody.vdecl x t v b), d => do
     let ctx ← read
     if isTailCallTo ctx.mainFn e then
       pure d
     else
-      declareVar x t; declareVars b true
+      declareVar x t
+      if let .ctor c _ := v then
+        if ← isStackCtor x then declareStackCtor x c
+      declareVars b true
   | FnBody.jdecl _ xs _ b,    d => do declareParams xs; declareVars b (d || xs.size > 0)
   | e,                        d => if e.isTerminal then pure d else declareVars e.body d
 
@@ -329,7 +404,7 @@ def emitJmp (j : JoinPointId) (xs : Array Arg) : M Unit := do
       let p := ps[i]
       let x := xs[i]
       emit p.x; emit " = "; emitArg x; emitLn ";"
-    emit "goto "; emit j; emitLn ";"
+    emit "goto "; emit j; emit (← read).labelSuffix; emitLn ";"
   else
     do throw "invalid goto"
 
@@ -341,11 +416,6 @@ def emitArgs (ys : Array Arg) : M Unit :=
     if i > 0 then emit ", "
     emitArg ys[i]
 
-def emitCtorScalarSize (usize : Nat) (ssize : Nat) : M Unit := do
-  if usize == 0 then emit ssize
-  else if ssize == 0 then emit "sizeof(size_t)*"; emit usize
-  else emit "sizeof(size_t)*"; emit usize; emit " + "; emit ssize
-
 def emitAllocCtor (c : CtorInfo) : M Unit := do
   emit "lean_alloc_ctor("; emit c.cidx; emit ", "; emit c.size; emit ", "
   emitCtorScalarSize c.usize c.ssize; emitLn ");"
@@ -358,6 +428,10 @@ def emitCtor (z : VarId) (c : CtorInfo) (ys : Array Arg) : M Unit := do
   emitLhs z;
   if c.size == 0 && c.usize == 0 && c.ssize == 0 then do
     emit "lean_box("; emit c.cidx; emitLn ");"
+  else if ← isStackCtor z then
+    emit "lean_stack_ctor_init("; emit z; emit "_stk, "; emit c.cidx; emit ", "; emit c.size; emit ", "
+    emitCtorScalarSize c.usize c.ssize; emitLn ");"
+    emitCtorSetArgs z ys
   else do
     emitAllocCtor c; emitCtorSetArgs z ys
 
@@ -416,9 +490,18 @@ def emitSimpleExternalCall (f : String) (ps : Array Param) (ys : Array Arg) : M
   emitLn ");"
   pure ()
 
+/-- Use the variant of an update primitive that does not check exclusivity if possible. -/
+def exclusiveExternFn (extFn : String) (ys : Array Arg) : M String := do
+  match ys[0]? with
+  | some (.var x) =>
+    if (← read).exclusiveVars.contains x.idx && ExclusiveLoops.updateOps.contains extFn then
+      return extFn ++ "_exclusive"
+  | _ => pure ()
+  return extFn
+
 def emitExternCall (f : FunId) (ps : Array Param) (extData : ExternAttrData) (ys : Array Arg) : M Unit :=
   match getExternEntryFor extData `c with
-  | some (ExternEntry.standard _ extFn) => emitSimpleExternalCall extFn ps ys
+  | some (ExternEntry.standard _ extFn) => do emitSimpleExternalCall (← exclusiveExternFn extFn ys) ps ys
   | some (ExternEntry.inline _ pat)     => do emit (expandExternPattern pat (toStringArgs ys)); emitLn ";"
   | some (ExternEntry.foreign _ extFn)  => emitSimpleExternalCall extFn ps ys
   | _ => throw s!"failed to emit extern application '{f}'"
@@ -429,6 +512,10 @@ def emitFullApp (z : VarId) (f : FunId) (ys : Array Arg) : M Unit := do
   match decl with
   | Decl.extern _ ps _ extData => emitExternCall f ps extData ys
   | _ =>
+    if ← isLazyClosedTerm decl then
+      let name ← toCName f
+      emitLn ("lean_get_lazy_closed_term(&" ++ name ++ ", _init_" ++ name ++ ");")
+      return
     emitCName f
     if ys.size > 0 then emit "("; emitArgs ys; emit ")"
     emitLn ";"
@@ -529,6 +616,22 @@ def isTailCall (x : VarId) (v : Expr) (b : FnBody) : M Bool := do
   | Expr.fap f _, FnBody.ret (Arg.var y) => return f == ctx.mainFn && x == y
   | _, _ => pure false
 
+/--
+Whether `let x := v; b` is a tail call to another function of this module with the same C signature
+as the current one, which is emitted with `LEAN_MUSTTAIL` so that mutually recursive functions run in
+constant stack space like self-recursive ones do.
+-/
+def isMustTailCall (x : VarId) (v : Expr) (b : FnBody) : M Bool := do
+  let ctx ← read
+  let .fap f ys := v | return false
+  let .ret (.var y) := b | return false
+  unless x == y && f != ctx.mainFn && ctx.modDecls.contains f && !ys.isEmpty do return false
+  let .fdecl (xs := ps) (type := t) .. ← getDecl f | return false
+  let caller ← getDecl ctx.mainFn
+  let qs := ctx.mainParams
+  return ps.size == qs.size && ps.size ≤ closureMaxArgs && toCType t == toCType caller.resultType &&
+    (ps.zip qs).all fun (p, q) => toCType p.ty == toCType q.ty
+
 def paramEqArg (p : Param) (x : Arg) : Bool :=
   match x with
   | Arg.var x => p.x == x
@@ -578,7 +681,16 @@ def emitTailCall (v : Expr) : M Unit :=
           let p := ps[i]
           let y := ys[i]
           unless paramEqArg p y do emit p.x; emit " = "; emitArg y; emitLn ";"
-      emitLn "goto _start;"
+      let startLabel := match ctx.exclusiveEntry? with
+        | some (params, results) =>
+          let exclusiveArg (i : Nat) : Bool :=
+            !params.contains ps[i]!.x.idx ||
+              match ys[i]! with
+              | .var y => results.contains y.idx
+              | _ => false
+          if (List.range ps.size).all exclusiveArg then "_start_excl" else ctx.startLabel
+        | none => ctx.startLabel
+      emit "goto "; emit startLabel; emitLn ";"
     else
       throw "invalid tail call"
   | _ => throw "bug at emitTailCall"
@@ -610,6 +722,9 @@ partial def emitBlock (b : FnBody) : M Unit := do
     let ctx ← read
     if isTailCallTo ctx.mainFn d then
       emitTailCall v
+    else if ← isMustTailCall x v b then
+      let .fap f ys := v | unreachable!
+      emit "LEAN_MUSTTAIL return "; emitCName f; emit "("; emitArgs ys; emitLn ");"
     else
       emitVDecl x t v
       emitBlock b
@@ -617,7 +732,9 @@ partial def emitBlock (b : FnBody) : M Unit := do
     unless p do emitInc x n c
     emitBlock b
   | FnBody.dec x n c p b       =>
-    unless p do emitDec x n c
+    if ← isStackCtor x then
+      emit "lean_stack_ctor_release("; emit x; emitLn ");"
+    else unless p do emitDec x n c
     emitBlock b
   | FnBody.del x b             => emitDel x; emitBlock b
   | FnBody.setTag x i b        => emitSetTag x i; emitBlock b
@@ -631,7 +748,7 @@ partial def emitBlock (b : FnBody) : M Unit := do
   | FnBody.unreachable         => emitLn "lean_internal_panic_unreachable();"
 
 partial def emitJPs : FnBody → M Unit
-  | FnBody.jdecl j _  v b => do emit j; emitLn ":"; emitFnBody v; emitJPs b
+  | FnBody.jdecl j _  v b => do emit j; emit (← read).labelSuffix; emitLn ":"; emitFnBody v; emitJPs b
   | e                     => do unless e.isTerminal do emitJPs e.body
 
 partial def emitFnBody (b : FnBody) : M Unit := do
@@ -647,7 +764,8 @@ end
 def emitDeclAux (d : Decl) : M Unit := do
   let env ← getEnv
   let (_, jpMap) := mkVarJPMaps d
-  withReader (fun ctx => { ctx with jpMap := jpMap }) do
+  let stackCtorVars := if (← read).stackCtors then d.stackCtors else {}
+  withReader (fun ctx => { ctx with jpMap, stackCtorVars }) do
   unless hasInitAttr env d.name do
     match d with
     | .fdecl (f := f) (xs := xs) (type := t) (body := b) .. =>
@@ -676,7 +794,17 @@ def emitDeclAux (d : Decl) : M Unit := do
           let x := xs[i]!
           emit "lean_object* "; emit x.x; emit " = _args["; emit i; emitLn "];"
       emitLn "_start:";
-      withReader (fun ctx => { ctx with mainFn := f, mainParams := xs }) (emitFnBody b);
+      let (exclusiveVars, exclusiveResults) :=
+        if (← read).exclusiveLoops then d.exclusiveLoopParams env else ({}, {})
+      withReader (fun ctx => { ctx with mainFn := f, mainParams := xs }) do
+        if exclusiveVars.isEmpty then
+          emitFnBody b
+        else
+          withReader ({ · with exclusiveEntry? := some (exclusiveVars, exclusiveResults) })
+            (emitFnBody b)
+          emitLn "_start_excl:"
+          withReader ({ · with exclusiveVars, labelSuffix := "_excl", startLabel := "_start_excl" })
+            (emitFnBody b)
       emitLn "}"
     | _ => pure ()
 
@@ -687,10 +815,28 @@ def emitDecl (d : Decl) : M Unit := do
   catch err =>
     throw s!"{err}\ncompiling:\n{d}"
 
+/-- Number of declarations emitted by a single task in `emitFns`. -/
+def emitFnsChunkSize : Nat := 64
+
 def emitFns : M Unit := do
   let env ← getEnv;
-  let decls := getDecls env;
-  decls.reverse.forM emitDecl
+  let decls := (getDecls env).reverse.toArray
+  if decls.size ≤ emitFnsChunkSize then
+    decls.forM emitDecl
+  else
+    -- Declarations are emitted independently of each other, so we emit chunks of them in parallel (using the
+    -- threads of the task manager, see `-j`) and concatenate the results in order.
+    let ctx ← read
+    let numChunks := (decls.size + emitFnsChunkSize - 1) / emitFnsChunkSize
+    let tasks := (Array.range numChunks).map fun i => Task.spawn fun _ =>
+      let chunk := decls.extract (i * emitFnsChunkSize) ((i + 1) * emitFnsChunkSize)
+      match ((chunk.forM emitDecl).run ctx).run "" with
+      | EStateM.Result.ok    _   s => Except.ok s
+      | EStateM.Result.error err _ => Except.error err
+    for t in tasks do
+      match t.get with
+      | Except.ok s      => emit s
+      | Except.error err => throw err
 
 def emitMarkPersistent (d : Decl) (n : Name) : M Unit := do
   if d.resultType.isObj then
@@ -726,7 +872,8 @@ def emitDeclInit (d : Decl) : M Unit := do
       if getBuiltinInitFnNameFor? env d.name |>.isSome then
         emit "}"
     | _ =>
-      emitCName n; emit " = "; emitCInitName n; emitLn "();"; emitMarkPersistent d n
+      unless ← isLazyClosedTerm d do
+        emitCName n; emit " = "; emitCInitName n; emitLn "();"; emitMarkPersistent d n
 
 def emitInitFn : M Unit := do
   let env ← getEnv
@@ -747,19 +894,43 @@ def emitInitFn : M Unit := do
   decls.reverse.forM emitDeclInit
   emitLns ["return lean_io_result_mk_ok(lean_box(0));", "}"]
 
+/--
+Emit the table of the native symbols defined by this module, which `lean_run_mod_init` registers
+with the interpreter when the module is loaded from a shared library, so that these symbols do not
+have to be looked up one by one. It is only emitted with `compiler.symbolTable`, and only compiled
+into objects for shared libraries, which are built with `LEAN_EXPORTING`.
+-/
+def emitSymbolTable : M Unit := do
+  unless (← read).symbolTable do return
+  let env ← getEnv
+  emitLns ["#ifdef LEAN_EXPORTING",
+    "LEAN_EXPORT const lean_native_symbol " ++ mkModuleInitializationFunctionName (← getModName) ++ "_symbols[] = {"]
+  (getDecls env).reverse.forM fun d => do
+    if d matches .fdecl .. then
+      unless isClosedTermName env d.name && !closedTermsShared env do
+        let n ← toCName d.name
+        emitLn ("{\"" ++ n ++ "\", (void*)" ++ (if d.params.isEmpty then "&" else "") ++ n ++ "},")
+  emitLns ["{NULL, NULL}", "};", "#endif"]
+
 def main : M Unit := do
   emitFileHeader
   emitFnDecls
   emitFns
   emitInitFn
+  emitSymbolTable
   emitMainFnIfNeeded
   emitFileFooter
 
 end EmitC
 
 @[export lean_ir_emit_c]
-def emitC (env : Environment) (modName : Name) : Except String String :=
-  match (EmitC.main { env := env, modName := modName }).run "" with
+def emitC (env : Environment) (modName : Name) (opts : Options := {}) : Except String String :=
+  let ctx := { env, modName, lazyClosedTerms := compiler.lazyClosedTerms.get opts,
+               stackCtors := compiler.stackCtors.get opts,
+               modDecls := (getDecls env).foldl (·.insert ·.name) {},
+               exclusiveLoops := compiler.exclusiveLoops.get opts,
+               symbolTable := compiler.symbolTable.get opts }
+  match (EmitC.main ctx).run "" with
   | EStateM.Result.ok    _   s => Except.ok s
   | EStateM.Result.error err _ => Except.error err
 
@@ -0,0 +1,114 @@
+/-
+Copyright (c) 2025 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+-/
+prelude
+import Lean.Compiler.ExternAttr
+import Lean.Compiler.IR.Basic
+import Lean.Compiler.IR.FreeVars
+
+namespace Lean.IR
+/-!
+Detection of loops over scalar arrays whose exclusivity checks can be hoisted (see
+`compiler.exclusiveLoops`).
+
+A self-recursive function updating a `ByteArray` or `FloatArray` parameter `a` in place checks
+`lean_is_exclusive(a)` on every iteration, but from the second iteration on `a` is the result of
+the update in the previous one and hence exclusive, as long as `a` and the updated array are never
+shared in between. The C backend therefore emits the body of such a function a second time for
+the following iterations, using update primitives that skip the check.
+-/
+namespace ExclusiveLoops
+
+/--
+Primitives that update the array passed as their first argument and always return an exclusive
+array. This excludes `lean_byte_array_set` and `lean_float_array_set`, which return the argument
+unchanged if the index is out of bounds.
+-/
+def updateOps : List String := [
+  "lean_byte_array_uset", "lean_byte_array_fset", "lean_float_array_uset", "lean_float_array_fset"]
+
+/-- Primitives that borrow the array passed as their first argument. -/
+def readOps : List String := [
+  "lean_sarray_size",
+  "lean_byte_array_size", "lean_byte_array_uget", "lean_byte_array_get", "lean_byte_array_fget",
+  "lean_float_array_size", "lean_float_array_uget", "lean_float_array_get", "lean_float_array_fget"]
+
+def isUpdateOp (env : Environment) (f : FunId) : Bool :=
+  (getExternNameFor env `c f).any (updateOps.contains ·)
+
+def isReadOp (env : Environment) (f : FunId) : Bool :=
+  (getExternNameFor env `c f).any (readOps.contains ·)
+
+def isSelfTailCall (fn : FunId) (x : VarId) (v : Expr) (b : FnBody) : Bool :=
+  match v, b with
+  | .fap f _, .ret (.var y) => f == fn && x == y
+  | _, _ => false
+
+/--
+Whether `x` is never shared in `b`: it is only read by the primitives above, updated, passed to a
+self tail call of `fn`, returned, or `dec`ed, and it is never `inc`ed.
+-/
+partial def isUnshared (env : Environment) (fn : FunId) (x : VarId) : FnBody → Bool
+  | .vdecl y _ v b =>
+    let ok := match v with
+      | .fap g ys =>
+        if isSelfTailCall fn y v b then true
+        else if isUpdateOp env g || isReadOp env g then !(ys.extract 1 ys.size).any (·.hasFreeVar x)
+        else !v.hasFreeVar x
+      | v => !v.hasFreeVar x
+    ok && isUnshared env fn x b
+  | .jdecl _ _ v b     => isUnshared env fn x v && isUnshared env fn x b
+  | .dec y n _ _ b     => (y != x || n == 1) && isUnshared env fn x b
+  | .case _ _ _ alts   => alts.all (isUnshared env fn x ·.body)
+  | .mdata _ b         => isUnshared env fn x b
+  | .ret _             => true
+  | b                  =>
+    if b.isTerminal then !b.hasFreeVar x
+    else !b.resetBody.hasFreeVar x && isUnshared env fn x b.body
+
+structure State where
+  /-- Results of update primitives that are never shared afterwards. -/
+  exclusive : IndexSet := {}
+  /-- Arguments of the self tail calls. -/
+  tailArgs  : Array (Array Arg) := #[]
+
+partial def collect (env : Environment) (fn : FunId) : FnBody → StateM State Unit
+  | .vdecl x _ v b => do
+    if isSelfTailCall fn x v b then
+      let .fap _ ys := v | unreachable!
+      modify fun s => { s with tailArgs := s.tailArgs.push ys }
+    else if let .fap g _ := v then
+      if isUpdateOp env g && isUnshared env fn x b then
+        modify fun s => { s with exclusive := s.exclusive.insert x.idx }
+    collect env fn b
+  | .jdecl _ _ v b   => do collect env fn v; collect env fn b
+  | .case _ _ _ alts => alts.forM (collect env fn ·.body)
+  | b                => unless b.isTerminal do collect env fn b.body
+
+end ExclusiveLoops
+
+open ExclusiveLoops in
+/--
+The parameters of `d` that are exclusive from the second iteration of its loop on: they are never
+shared, and every self tail call passes either the parameter itself or an unshared result of an
+update primitive, the latter at least once. Also returns the unshared update results; a self tail
+call may only enter the second iteration if it passes such a result for each of these parameters.
+-/
+def Decl.exclusiveLoopParams (env : Environment) (d : Decl) : IndexSet × IndexSet := Id.run do
+  let .fdecl (f := f) (xs := ps) (body := b) .. := d | return ({}, {})
+  let (_, s) := collect env f b |>.run {}
+  let mut r : IndexSet := {}
+  for h : i in [:ps.size] do
+    have : i < ps.size := h.upper
+    let p := ps[i]
+    let isExclusiveArg (ys : Array Arg) : Bool :=
+      match ys[i]? with
+      | some (.var y) => s.exclusive.contains y.idx
+      | _ => false
+    if p.ty.isObj && !p.borrow && isUnshared env f p.x b && s.tailArgs.any isExclusiveArg &&
+        s.tailArgs.all fun ys => isExclusiveArg ys || ys[i]? == some (.var p.x) then
+      r := r.insert p.x.idx
+  return (r, s.exclusive)
+
+end Lean.IR
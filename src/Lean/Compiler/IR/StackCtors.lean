@@ -0,0 +1,61 @@
+/-
+Copyright (c) 2025 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+-/
+prelude
+import Lean.Compiler.IR.Basic
+import Lean.Compiler.IR.FreeVars
+
+namespace Lean.IR
+/-!
+Escape analysis for the constructor applications that the C backend may allocate in the stack frame
+of the function instead of the heap (see `compiler.stackCtors`).
+
+A constructor object `x` does not escape if the only instructions mentioning it are projections
+from it, `case` on it, setting its scalar fields, and a single `dec x` on each path, which the C
+backend replaces with releasing the fields of `x`. In particular, `x` is not passed to any function
+(borrowed parameters may still be stored after an `inc`), returned, stored in another object,
+passed to a join point, or reused.
+-/
+namespace StackCtors
+
+/-- Maximal size of a stack constructor object in words, not counting the header. -/
+def maxWords : Nat := 8
+
+def isCandidate (c : CtorInfo) : Bool :=
+  !c.isScalar && c.size + c.usize + (c.ssize + 7) / 8 ≤ maxWords
+
+partial def isLocal (x : VarId) : FnBody → Bool
+  | .vdecl _ _ v b =>
+    (match v with
+     | .proj _ _ | .uproj _ _ | .sproj _ _ _ => true
+     | v => !v.hasFreeVar x) && isLocal x b
+  | .jdecl _ _ v b     => isLocal x v && isLocal x b
+  | .dec y n _ _ b     => (y != x || n == 1) && isLocal x b
+  | .uset _ _ y b      => y != x && isLocal x b
+  | .sset _ _ _ y _ b  => y != x && isLocal x b
+  | .case _ _ _ alts   => alts.all (isLocal x ·.body)
+  | .mdata _ b         => isLocal x b
+  | b                  =>
+    if b.isTerminal then !b.hasFreeVar x
+    else !b.resetBody.hasFreeVar x && isLocal x b.body
+
+partial def collect : FnBody → IndexSet → IndexSet
+  | .vdecl x _ v b, s =>
+    let s := match v with
+      | .ctor c _ => if isCandidate c && isLocal x b then s.insert x.idx else s
+      | _         => s
+    collect b s
+  | .jdecl _ _ v b,   s => collect b (collect v s)
+  | .case _ _ _ alts, s => alts.foldl (fun s alt => collect alt.body s) s
+  | b,                s => if b.isTerminal then s else collect b.body s
+
+end StackCtors
+
+/-- The variables of `d` bound to constructor objects that do not escape. -/
+def Decl.stackCtors (d : Decl) : IndexSet :=
+  match d with
+  | .fdecl (body := b) .. => StackCtors.collect b {}
+  | .extern .. => {}
+
+end Lean.IR
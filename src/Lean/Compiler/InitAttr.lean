@@ -65,7 +65,7 @@ unsafe def registerInitAttrUnsafe (attrName : Name) (runAfterImport : Bool) (ref
           -- any native Lean code reachable by the interpreter (i.e. from shared
           -- libraries with their corresponding module in the Environment) must
           -- first be initialized
-          if (← runModInit mod) then
+          if (← profileitIO "import: [init]" ctx.opts (decl := mod) (runModInit mod)) then
             continue
           -- If no native code for the module is available, run `[init]` decls manually.
           -- All other constants (nullary functions) are lazily initialized by the interpreter.
@@ -79,14 +79,15 @@ unsafe def registerInitAttrUnsafe (attrName : Name) (runAfterImport : Bool) (ref
           if (← interpretedModInits.get).contains mod then
             continue
           interpretedModInits.modify (·.insert mod)
-          for c in modData.constNames do
-            -- make sure to run initializers in declaration order, not extension state order, to respect dependencies
-            if let some (decl, initDecl) := modEntries.binSearch (c, default) (Name.quickLt ·.1 ·.1) then
-              if initDecl.isAnonymous then
-                let initFn ← IO.ofExcept <| ctx.env.evalConst (IO Unit) ctx.opts decl
-                initFn
-              else
-                runInit ctx.env ctx.opts decl initDecl
+          profileitIO "import: [init]" ctx.opts (decl := mod) do
+            for c in modData.constNames do
+              -- make sure to run initializers in declaration order, not extension state order, to respect dependencies
+              if let some (decl, initDecl) := modEntries.binSearch (c, default) (Name.quickLt ·.1 ·.1) then
+                if initDecl.isAnonymous then
+                  let initFn ← IO.ofExcept <| ctx.env.evalConst (IO Unit) ctx.opts decl
+                  initFn
+                else
+                  runInit ctx.env ctx.opts decl initDecl
   }
 
 @[implemented_by registerInitAttrUnsafe]
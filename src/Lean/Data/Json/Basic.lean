@@ -10,6 +10,7 @@ import Init.Data.OfScientific
 import Init.Data.Hashable
 import Lean.Data.RBMap
 import Init.Data.ToString.Macro
+import Init.Data.String.Extra
 
 namespace Lean
 
@@ -296,6 +297,23 @@ def mergeObj : Json → Json → Json
     obj <| fold (insert compare) kvs₁ kvs₂
   | _, j₂ => j₂
 
+/--
+Returns the position of the first byte at or after `i` in `s` that is `"`, `\` or a control
+character below `0x20`, or `s.utf8ByteSize` if there is none. These are the only characters that
+need special treatment when parsing or rendering the contents of a string literal, so the bytes
+before the result can be copied as they are. This function is implemented natively and scans
+several bytes at a time.
+-/
+@[extern "lean_json_next_special_byte"]
+def nextSpecialByte (s : @& String) (i : @& Nat) : Nat :=
+  if h : i < s.utf8ByteSize then
+    let b := s.getUtf8Byte i h
+    -- `"` and `\`
+    if b == 34 || b == 92 || b < 0x20 then i else nextSpecialByte s (i + 1)
+  else
+    i
+termination_by s.utf8ByteSize - i
+
 inductive Structured where
   | arr (elems : Array Json)
   | obj (kvPairs : RBNode String (fun _ => Json))
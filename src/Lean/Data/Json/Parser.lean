@@ -41,7 +41,16 @@ def escapedChar : Parser Char := do
     return Char.ofNat $ 4096*u1 + 256*u2 + 16*u3 + u4
   | _ => fail "illegal \\u escape"
 
+/--
+Appends the characters up to the next one that needs special treatment in a string literal to
+`acc`, see `Json.nextSpecialByte`.
+-/
+@[inline] def plainChars (acc : String) : Parser String := fun it =>
+  let stop : String.Pos := ⟨nextSpecialByte it.s it.i.byteIdx⟩
+  .success ⟨it.s, stop⟩ (acc ++ it.s.extract it.i stop)
+
 partial def strCore (acc : String) : Parser String := do
+  let acc ← plainChars acc
   let c ← peek!
   if c == '"' then
     skip
@@ -11,22 +11,6 @@ import Init.Data.List.Impl
 namespace Lean
 namespace Json
 
-set_option maxRecDepth 1024 in
-/--
-This table contains for each UTF-8 byte whether we need to escape a string that contains it.
--/
-private def escapeTable : { xs : ByteArray // xs.size = 256 } :=
-  ⟨ByteArray.mk #[
-    1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1, 1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
-    0,0,1,0,0,0,0,0,0,0,0,0,0,0,0,1, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
-    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,1,0,0,0,
-    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
-    1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1, 1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
-    1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1, 1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
-    1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1, 1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,
-    1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1, 1,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1
-  ], by rfl⟩
-
 private def escapeAux (acc : String) (c : Char) : String :=
   -- escape ", \, \n and \r, keep all other characters ≥ 0x20 and render characters < 0x20 with \u
   if c = '"' then -- hack to prevent emacs from regarding the rest of the file as a string: "
@@ -55,27 +39,19 @@ private def escapeAux (acc : String) (c : Char) : String :=
     let d4 := Nat.digitChar (n % 16)
     acc ++ "\\u" |>.push d1 |>.push d2 |>.push d3 |>.push d4
 
-private def needEscape (s : String) : Bool :=
-  go s 0
+def escape (s : String) (acc : String := "") : String :=
+  -- Characters that do not need to be escaped are copied in runs, see `nextSpecialByte`.
+  go acc 0
 where
-  go (s : String) (i : Nat) : Bool :=
-    if h : i < s.utf8ByteSize then
-      let byte := s.getUtf8Byte i h
-      have h1 : byte.toNat < 256 := UInt8.toNat_lt_size byte
-      have h2 : escapeTable.val.size = 256 := escapeTable.property
-      if escapeTable.val.get byte.toNat (Nat.lt_of_lt_of_eq h1 h2.symm) == 0 then
-        go s (i + 1)
-      else
-        true
+  go (acc : String) (i : Nat) : String :=
+    let j := nextSpecialByte s i
+    let acc := acc ++ s.extract ⟨i⟩ ⟨j⟩
+    if h : i ≤ j ∧ j < s.utf8ByteSize then
+      -- the special character is ASCII, so it is a single byte
+      go (escapeAux acc (s.get ⟨j⟩)) (j + 1)
     else
-      false
-
-def escape (s : String) (acc : String := "") : String :=
-  -- If we don't have any characters that need to be escaped we can just append right away.
-  if needEscape s then
-    s.foldl escapeAux acc
-  else
-    acc ++ s
+      acc
+  termination_by s.utf8ByteSize - i
 
 def renderString (s : String) (acc : String := "") : String :=
   let acc := acc ++ "\""
@@ -258,6 +258,44 @@ instance : FromJson Message where
         let data? := err.getObjVal? "data"
         pure (Message.responseError id code message data?.toOption))
 
+/-! Classifying messages in the exact format written by `IO.FS.Stream.writeLspMessage` without parsing
+them, so that messages can be forwarded cheaply. `Json.compress` writes object fields in reverse
+alphabetical order, so a notification ends with its `method` and `jsonrpc` fields whereas requests
+and responses end with `id`, and only responses start with `result`. -/
+
+private def endsWith (ss : Substring) (s : String) : Bool :=
+  ss.takeRight s.length == s.toSubstring
+
+/-- The method of the notification `s`, if `s` is one. Returns `none` for other messages. -/
+def peekNotificationMethod? (s : String) : Option String := do
+  guard <| s.startsWith "{\"params\":" || s.startsWith "{\"method\":"
+  let suffix := "\",\"jsonrpc\":\"2.0\"}"
+  guard <| s.endsWith suffix
+  let ss := s.toSubstring.dropRight suffix.length
+  let method := (ss.takeRightWhile fun c => c != '"' && c != '\\').toString
+  guard <| endsWith (ss.dropRight method.length) "\"method\":\""
+  return method
+
+/--
+The id of the successful response `s`, if `s` is one. Returns `none` for other messages, and for
+responses with ids that contain escaped characters.
+-/
+def peekResponseId? (s : String) : Option RequestID := do
+  guard <| s.startsWith "{\"result\":" && s.endsWith "}"
+  let ss := s.toSubstring.dropRight 1
+  let (id, ss) ← if endsWith ss "\"" then
+      let ss := ss.dropRight 1
+      let content := (ss.takeRightWhile fun c => c != '"' && c != '\\').toString
+      let ss := ss.dropRight content.length
+      guard <| endsWith ss "\""
+      pure (RequestID.str content, ss.dropRight 1)
+    else
+      let n := (ss.takeRightWhile fun c => c.isDigit || "-+.eE".contains c).toString
+      let .ok (.num n') := Json.parse n | none
+      pure (RequestID.num n', ss.dropRight n.length)
+  guard <| endsWith ss ",\"jsonrpc\":\"2.0\",\"id\":"
+  return id
+
 -- TODO(WN): temporary until we have deriving FromJson
 instance [FromJson α] : FromJson (Notification α) where
   fromJson? j := do
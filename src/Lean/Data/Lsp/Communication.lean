@@ -71,6 +71,16 @@ section
     catch e =>
       throw $ userError s!"Cannot read LSP message: {e}"
 
+  /-- Reads the content of an LSP message without parsing it, see `JsonRpc.peekResponseId?`. -/
+  def readLspMessageRaw (h : FS.Stream) : IO String := do
+    try
+      let nBytes ← readLspHeader h
+      let bytes ← h.read (USize.ofNat nBytes)
+      let some s := String.fromUTF8? bytes | throw (IO.userError "invalid UTF-8")
+      return s
+    catch e =>
+      throw $ userError s!"Cannot read LSP message: {e}"
+
   def readLspRequestAs (h : FS.Stream) (expectedMethod : String) (α) [FromJson α] : IO (Request α) := do
     try
       let nBytes ← readLspHeader h
@@ -104,6 +114,12 @@ section
     h.putStr (header ++ j)
     h.flush
 
+  /-- Writes a message read by `readLspMessageRaw`. -/
+  def writeLspMessageRaw (h : FS.Stream) (j : String) : IO Unit := do
+    let header := s!"Content-Length: {toString j.utf8ByteSize}\r\n\r\n"
+    h.putStr (header ++ j)
+    h.flush
+
   def writeLspRequest (h : FS.Stream) (r : Request α) : IO Unit :=
     h.writeLspMessage r
 
@@ -144,6 +144,32 @@ def push (t : PersistentArray α) (a : α) : PersistentArray α :=
   else
     mkNewTail r
 
+/-- Splits `xs` into arrays of `branching` elements, the last one may be smaller. -/
+private def chunks {β : Type v} (xs : Array β) : Array (Array β) :=
+  let n := (xs.size + branching.toNat - 1) / branching.toNat
+  n.fold (init := Array.mkEmpty n) fun i _ r =>
+    r.push (xs.extract (i * branching.toNat) ((i + 1) * branching.toNat))
+
+/-- Adds levels above the children `cs` of a node at `shift` until the tree can hold `tailOff` elements. -/
+private partial def mkRoot (cs : Array (PersistentArrayNode α)) (shift : USize) (tailOff : Nat) :
+    PersistentArrayNode α × USize :=
+  if tailOff <= (mul2Shift 1 (shift + initShift)).toNat then
+    (node cs, shift)
+  else
+    mkRoot ((chunks cs).map node) (shift + initShift) tailOff
+
+/--
+Converts an array to a persistent array. The result has the same shape as the one obtained by
+pushing the elements one by one, but each leaf and node is allocated only once.
+-/
+def ofArray (xs : Array α) : PersistentArray α :=
+  if xs.size >= tooBig then
+    xs.foldl (init := {}) push
+  else
+    let tailOff := xs.size - xs.size % branching.toNat
+    let (root, shift) := mkRoot ((chunks (xs.extract 0 tailOff)).map leaf) initShift tailOff
+    { root, tail := xs.extract tailOff xs.size, size := xs.size, shift, tailOff }
+
 private def emptyArray {α : Type u} : Array (PersistentArrayNode α) :=
   Array.mkEmpty PersistentArray.branching.toNat
 
@@ -385,10 +411,7 @@ open Lean (PersistentArray)
 Converts a list to a persistent array.
 -/
 def List.toPArray' {α : Type u} (xs : List α) : PersistentArray α :=
-  let rec loop : List α → PersistentArray α → PersistentArray α
-  | [],    t => t
-  | x::xs, t => loop xs (t.push x)
-  loop xs {}
+  PersistentArray.ofArray xs.toArray
 
 def Array.toPArray' {α : Type u} (xs : Array α) : PersistentArray α :=
-  xs.foldl (init := .empty) fun p x => p.push x
+  PersistentArray.ofArray xs
@@ -213,13 +213,49 @@ structure PrintImportsResult where
   imports : Array PrintImportResult
   deriving ToJson
 
+namespace ParseImports
+
+/-- Size of the prefix of a file that is read first in the hope that it contains the whole header. -/
+def headerChunkSize : Nat := 65536
+
+/--
+Parses the header in `buf`, a prefix of a file. The prefix is cut after its last newline, so that
+it is valid UTF-8 and no identifier or keyword is cut in half. The result is only returned if it
+cannot depend on the rest of the file, that is, if the parser stopped at a token that is not
+`import` and that lies before the end of the prefix.
+-/
+def parsePrefix? (buf : ByteArray) : Option (Array Import) := Id.run do
+  let mut n := buf.size
+  while n > 0 && buf[n - 1]! != '\n'.toUInt8 do
+    n := n - 1
+  let some input := String.fromUTF8? (buf.extract 0 n) | return none
+  let s := main input (whitespace input {})
+  if s.error?.isNone && s.pos.byteIdx + "import".utf8ByteSize < input.utf8ByteSize &&
+      !input.substrEq s.pos "import" 0 "import".utf8ByteSize then
+    return some s.imports
+  return none
+
+/-- Like `parseImports' (← IO.FS.readFile fileName) fileName`, but reads only the header if possible. -/
+def parseFileImports (fileName : String) : IO (Array Import) := do
+  let h ← IO.FS.Handle.mk fileName .read
+  let buf ← h.read headerChunkSize.toUSize
+  if buf.size == headerChunkSize then
+    if let some imports := parsePrefix? buf then
+      return imports
+  let buf ← h.readBinToEndInto buf
+  let some input := String.fromUTF8? buf
+    | throw <| .userError s!"Tried to read file '{fileName}' containing non UTF-8 data."
+  parseImports' input fileName
+
+end ParseImports
+
+/-- Prints the imports of the given files as JSON. The files are read and parsed in parallel. -/
 @[export lean_print_imports_json]
 def printImportsJson (fileNames : Array String) : IO Unit := do
-  let rs ← fileNames.mapM fun fn => do
-    try
-      let deps ← parseImports' (← IO.FS.readFile ⟨fn⟩) fn
-      return { imports? := some deps }
-    catch e => return { errors := #[e.toString] }
+  let tasks ← fileNames.mapM fun fn => IO.asTask (ParseImports.parseFileImports fn)
+  let rs := tasks.map fun t => match t.get with
+    | .ok deps => { imports? := some deps }
+    | .error e => { errors := #[e.toString] : PrintImportResult }
   IO.println (toJson { imports := rs : PrintImportsResult } |>.compress)
 
 end Lean
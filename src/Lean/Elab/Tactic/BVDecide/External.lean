@@ -98,10 +98,16 @@ partial def runInterruptible (timeout : Nat) (args : IO.Process.SpawnArgs) :
   let child ← IO.Process.spawn { args with stdout := .piped, stderr := .piped, stdin := .null }
   let stdout ← IO.asTask child.stdout.readToEnd Task.Priority.dedicated
   let stderr ← IO.asTask child.stderr.readToEnd Task.Priority.dedicated
-  go (timeout * 1000) child stdout stderr
+  go (timeout * 1000) 1 child stdout stderr
 where
-  go {cfg} (budgetMs : Nat) (child : IO.Process.Child cfg) (stdout stderr : Task (Except IO.Error String)) :
-      CoreM (TimedOut IO.Process.Output) := do
+  /-
+  The polling interval starts at `1` ms and doubles up to `maxSleepMs`, so that the many small SAT
+  queries of a single `bv_decide` call do not each wait for a full interval.
+  -/
+  maxSleepMs : Nat := 50
+
+  go {cfg} (budgetMs sleepMs : Nat) (child : IO.Process.Child cfg)
+      (stdout stderr : Task (Except IO.Error String)) : CoreM (TimedOut IO.Process.Output) := do
     let cleanup := killAndWait child
     withTimeoutCheck budgetMs cleanup do
     withInterruptCheck cleanup do
@@ -111,9 +117,8 @@ where
         let stderr ← IO.ofExcept stderr.get
         return .success { exitCode := exitCode, stdout := stdout, stderr := stderr }
       | none =>
-        let sleepMs : Nat := 50
         IO.sleep sleepMs.toUInt32
-        go (budgetMs - sleepMs) child stdout stderr
+        go (budgetMs - sleepMs) (min (2 * sleepMs) maxSleepMs) child stdout stderr
 
   killAndWait {cfg} (child : IO.Process.Child cfg) : IO Unit := do
     child.kill
@@ -262,6 +262,31 @@ inductive Exception where
   | interrupted
 deriving Nonempty
 
+/-- Counters collected by the kernel type checker while checking a declaration, see `kernel.profile`. -/
+structure Profile where
+  whnfCore           : Nat
+  whnfCoreCacheHits  : Nat
+  whnf               : Nat
+  whnfCacheHits      : Nat
+  inferType          : Nat
+  inferTypeCacheHits : Nat
+  isDefEqCore        : Nat
+  equivHits          : Nat
+  equivMerges        : Nat
+  failureChecks      : Nat
+  failureHits        : Nat
+  lazyDeltaSteps     : Nat
+  cacheResets        : Nat
+
+instance : ToString Profile where
+  toString p :=
+    s!"whnf_core: {p.whnfCore} ({p.whnfCoreCacheHits} cache hits), " ++
+    s!"whnf: {p.whnf} ({p.whnfCacheHits} cache hits), " ++
+    s!"infer_type: {p.inferType} ({p.inferTypeCacheHits} cache hits), " ++
+    s!"is_def_eq_core: {p.isDefEqCore}, equiv_manager: {p.equivHits} hits, {p.equivMerges} merges, " ++
+    s!"failure cache: {p.failureHits}/{p.failureChecks} hits, lazy delta steps: {p.lazyDeltaSteps}, " ++
+    s!"cache resets: {p.cacheResets}"
+
 namespace Environment
 
 @[export lean_environment_find]
@@ -282,6 +307,16 @@ private def isQuotInit (env : Environment) : Bool :=
 opaque addDeclCore (env : Environment) (maxHeartbeats : USize) (decl : @& Declaration)
   (cancelTk? : @& Option IO.CancelToken) : Except Exception Environment
 
+/--
+Type check given declarations and add them to the environment. Declaration `i` is checked in the
+environment extended by declarations `0` to `i - 1`, but the checks run concurrently on the task
+manager. If several declarations fail to check, the error of the first one is returned. This is
+not used by the elaborator yet, which still adds declarations one at a time with `addDeclCore`.
+-/
+@[extern "lean_add_decls"]
+opaque addDeclsCore (env : Environment) (maxHeartbeats : USize) (decls : @& Array Declaration)
+  (cancelTk? : @& Option IO.CancelToken) : Except Exception Environment
+
 /--
 Add declaration to kernel without type checking it.
 
@@ -574,6 +609,10 @@ def asyncMayContain (env : Environment) (declName : Name) : Bool :=
 private opaque addDeclCheck (env : Environment) (maxHeartbeats : USize) (decl : @& Declaration)
   (cancelTk? : @& Option IO.CancelToken) : Except Kernel.Exception Environment
 
+@[extern "lean_elab_add_decl_profiled"]
+private opaque addDeclProfiledCheck (env : Environment) (maxHeartbeats : USize) (decl : @& Declaration)
+  (cancelTk? : @& Option IO.CancelToken) : Except Kernel.Exception (Environment × Kernel.Profile)
+
 @[extern "lean_elab_add_decl_without_checking"]
 private opaque addDeclWithoutChecking (env : Environment) (decl : @& Declaration) :
   Except Kernel.Exception Environment
@@ -596,6 +635,19 @@ def addDeclCore (env : Environment) (maxHeartbeats : USize) (decl : @& Declarati
   else
     addDeclWithoutChecking env decl
 
+/--
+Like `addDeclCore` with `doCheck := true`, but also returns the counters collected by the kernel
+type checker, see `kernel.profile`.
+-/
+def addDeclProfiled (env : Environment) (maxHeartbeats : USize) (decl : @& Declaration)
+    (cancelTk? : @& Option IO.CancelToken) :
+    Except Kernel.Exception (Environment × Kernel.Profile) := do
+  if let some ctx := env.asyncCtx? then
+    if let some n := decl.getTopLevelNames.find? (!ctx.mayContain ·) then
+      throw <| .other s!"cannot add declaration {n} to environment as it is restricted to the \
+        prefix {ctx.declPrefix}"
+  addDeclProfiledCheck env maxHeartbeats decl cancelTk?
+
 @[inherit_doc Kernel.Environment.constants]
 def constants (env : Environment) : ConstMap :=
   env.toKernelEnv.constants
@@ -1560,6 +1612,13 @@ end MapDeclarationExtension
 opaque saveModuleData (fname : @& System.FilePath) (mod : @& Name) (data : @& ModuleData) : IO Unit
 @[extern "lean_read_module_data"]
 opaque readModuleData (fname : @& System.FilePath) : IO (ModuleData × CompactedRegion)
+/--
+Reads several `.olean` files concurrently on the task manager. An entry is `none` if the
+corresponding file could not be read; `readModuleData` can be used to obtain the error.
+-/
+@[extern "lean_read_module_data_parallel"]
+opaque readModuleDataParallel (fnames : @& Array System.FilePath) :
+    IO (Array (Option (ModuleData × CompactedRegion)))
 
 /--
   Free compacted regions of imports. No live references to imported objects may exist at the time of invocation; in
@@ -1668,7 +1727,8 @@ where
       let s := extDescr.toEnvExtension.getState (asyncMode := .local) env
       let prevSize := (← persistentEnvExtensionsRef.get).size
       let prevAttrSize ← getNumBuiltinAttributes
-      let newState ← extDescr.addImportedFn s.importedEntries { env := env, opts := opts }
+      let newState ← profileitIO "import: extension" opts (decl := extDescr.name) <|
+        extDescr.addImportedFn s.importedEntries { env := env, opts := opts }
       let mut env := extDescr.toEnvExtension.setState env { s with state := newState }
       env ← ensureExtensionsArraySize env
       if (← persistentEnvExtensionsRef.get).size > prevSize || (← getNumBuiltinAttributes) > prevAttrSize then
@@ -1687,6 +1747,68 @@ structure ImportState where
   moduleNames   : Array Name := #[]
   moduleData    : Array ModuleData := #[]
   regions       : Array CompactedRegion := #[]
+  /-- Modules read ahead of time by `importModulesCore` but not imported yet. -/
+  prefetched    : Std.HashMap Name (ModuleData × CompactedRegion) := {}
+
+/--
+The `.olean` data of all transitive imports of a file compacted into a single file, see
+`saveImportSnapshot`.
+-/
+structure ImportSnapshot where
+  imports     : Array Import
+  moduleNames : Array Name
+  moduleData  : Array ModuleData
+  /-- Modification times of the `.olean` files of `moduleNames` when the snapshot was saved. -/
+  modTimes    : Array IO.FS.SystemTime
+
+@[extern "lean_save_module_data"]
+private opaque saveImportSnapshotData (fname : @& System.FilePath) (mod : @& Name)
+    (data : @& ImportSnapshot) : IO Unit
+@[extern "lean_read_module_data"]
+private opaque readImportSnapshotData (fname : @& System.FilePath) :
+    IO (ImportSnapshot × CompactedRegion)
+
+private def oleanModTimes (mods : Array Name) : IO (Array IO.FS.SystemTime) :=
+  mods.mapM fun mod => return (← (← findOLean mod).metadata).modified
+
+/--
+Saves the `.olean` data of the imports of `env` as a snapshot. A process that imports the same
+modules with `LEAN_IMPORT_SNAPSHOT` set to `fname` then maps this single file instead of the
+`.olean` files of all imports.
+-/
+@[export lean_save_import_snapshot]
+def saveImportSnapshot (env : Environment) (fname : System.FilePath) : IO Unit := do
+  let moduleNames := env.header.moduleNames
+  -- The name only determines the base address of the file.
+  saveImportSnapshotData fname (.mkSimple fname.toString) {
+    imports := env.header.imports, moduleNames, moduleData := env.header.moduleData
+    modTimes := (← oleanModTimes moduleNames)
+  }
+
+private unsafe def readImportSnapshotUnsafe? (imports : Array Import) : IO (Option ImportState) := do
+  let some fname ← IO.getEnv "LEAN_IMPORT_SNAPSHOT" | return none
+  unless (← System.FilePath.pathExists fname) do
+    return none
+  let (snap, region) ← readImportSnapshotData fname
+  let sameImports := snap.imports.size == imports.size &&
+    (snap.imports.zip imports).all fun (i, j) => i.module == j.module && i.runtimeOnly == j.runtimeOnly
+  -- A snapshot that is out of date is ignored, it is up to the user to save it again.
+  unless sameImports && (← oleanModTimes snap.moduleNames) == snap.modTimes do
+    region.free
+    return none
+  return some {
+    moduleNameSet := snap.moduleNames.foldl (·.insert ·) {}
+    moduleNames   := snap.moduleNames
+    moduleData    := snap.moduleData
+    regions       := #[region]
+  }
+
+/--
+Reads the snapshot saved by `saveImportSnapshot` at `LEAN_IMPORT_SNAPSHOT`, if this variable is
+set and the snapshot is for `imports` and has been saved after the `.olean` files it contains.
+-/
+@[implemented_by readImportSnapshotUnsafe?]
+private opaque readImportSnapshot? (imports : Array Import) : IO (Option ImportState)
 
 def throwAlreadyImported (s : ImportState) (const2ModIdx : Std.HashMap Name ModuleIdx) (modIdx : Nat) (cname : Name) : IO α := do
   let modName := s.moduleNames[modIdx]!
@@ -1698,16 +1820,52 @@ abbrev ImportStateM := StateRefT ImportState IO
 @[inline] nonrec def ImportStateM.run (x : ImportStateM α) (s : ImportState := {}) : IO (α × ImportState) :=
   x.run s
 
-partial def importModulesCore (imports : Array Import) : ImportStateM Unit := do
+/--
+Reads the `.olean` files of the given imports that have not been imported or read yet
+concurrently and stores them in `ImportState.prefetched`. Failures are ignored here and reported
+when the module is imported.
+-/
+private def prefetchModules (imports : Array Import) (opts : Options) : ImportStateM Unit := do
+  let mut names := #[]
+  let mut files := #[]
+  for i in imports do
+    let s ← get
+    if i.runtimeOnly || s.moduleNameSet.contains i.module || s.prefetched.contains i.module ||
+        names.contains i.module then
+      continue
+    try
+      let mFile ← findOLean i.module
+      if (← mFile.pathExists) then
+        names := names.push i.module
+        files := files.push mFile
+    catch _ => pure ()
+  if files.size < 2 then
+    return
+  let results ← profileitIO "import: read .olean" opts (readModuleDataParallel files)
+  for name in names, result? in results do
+    if let some result := result? then
+      modify fun s => { s with prefetched := s.prefetched.insert name result }
+
+/--
+Reads the `.olean` files of `imports` and their transitive imports. With the `profiler` option set
+in `opts`, reading and relocating the files is reported per module.
+-/
+partial def importModulesCore (imports : Array Import) (opts : Options := {}) : ImportStateM Unit := do
+  prefetchModules imports opts
   for i in imports do
     if i.runtimeOnly || (← get).moduleNameSet.contains i.module then
       continue
     modify fun s => { s with moduleNameSet := s.moduleNameSet.insert i.module }
-    let mFile ← findOLean i.module
-    unless (← mFile.pathExists) do
-      throw <| IO.userError s!"object file '{mFile}' of module {i.module} does not exist"
-    let (mod, region) ← readModuleData mFile
-    importModulesCore mod.imports
+    let (mod, region) ← match (← get).prefetched[i.module]? with
+      | some result =>
+        modify fun s => { s with prefetched := s.prefetched.erase i.module }
+        pure result
+      | none =>
+        let mFile ← findOLean i.module
+        unless (← mFile.pathExists) do
+          throw <| IO.userError s!"object file '{mFile}' of module {i.module} does not exist"
+        profileitIO "import: read .olean" opts (decl := i.module) (readModuleData mFile)
+    importModulesCore mod.imports opts
     modify fun s => { s with
       moduleData  := s.moduleData.push mod
       regions     := s.regions.push region
@@ -1786,7 +1944,7 @@ def finalizeImport (s : ImportState) (imports : Array Import) (opts : Options) (
     }
     realizedImportedConsts? := none
   }
-  env ← setImportedEntries env s.moduleData
+  env ← profileitIO "import: extension entries" opts (setImportedEntries env s.moduleData)
   if leakEnv then
     /- Mark persistent a first time before `finalizePersistenExtensions`, which
        avoids costly MT markings when e.g. an interpreter closure (which
@@ -1825,7 +1983,9 @@ def importModules (imports : Array Import) (opts : Options) (trustLevel : UInt32
       throw <| IO.userError "import failed, trying to import module with anonymous name"
   withImporting do
     plugins.forM Lean.loadPlugin
-    let (_, s) ← importModulesCore imports |>.run
+    let s ← match (← profileitIO "import: read snapshot" opts (readImportSnapshot? imports)) with
+      | some s => pure s
+      | none   => pure (← importModulesCore imports opts |>.run).2
     finalizeImport (leakEnv := leakEnv) s imports opts trustLevel
 
 /--
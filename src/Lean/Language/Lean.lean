@@ -331,6 +331,36 @@ If the option is defined in this library, use '-D{`weak ++ name}' to set it cond
 
   return opts'
 
+register_builtin_option Elab.speculativeParsing : Bool := {
+  defValue := false
+  descr    := "parse the next command in parallel with elaborating the current one and keep the \
+    result if elaboration did not change any state the parser depends on"
+}
+
+/-- A parse of the next command started before the elaboration of the current command finished. -/
+private structure SpeculativeParse where
+  /-- The context the command was parsed in. -/
+  pmctx  : Parser.ParserModuleContext
+  result : Task (Syntax × Parser.ModuleParserState × MessageLog)
+
+private unsafe def isSameParserContextUnsafe (c₁ c₂ : Parser.ParserModuleContext) : Bool :=
+  ptrEq (Parser.parserExtension.getState c₁.env) (Parser.parserExtension.getState c₂.env) &&
+  ptrEq (Parser.categoryParserFnExtension.getState c₁.env)
+    (Parser.categoryParserFnExtension.getState c₂.env) &&
+  ptrEq c₁.options c₂.options && c₁.currNamespace == c₂.currNamespace &&
+  ptrEq c₁.openDecls c₂.openDecls
+
+/--
+Returns whether parsing in `c₁` and `c₂` is guaranteed to produce the same result. The parser
+accesses the environment only through the parser extensions, except for resolving namespaces in
+`open ... in`, which can only affect the result via scoped parser extension entries, and for
+`evalInsideQuot` under `internal.parseQuotWithCurrentStage`, for which speculative parsing is not
+used. Comparing pointers is conservative but sufficient as most commands do not touch any of these
+states.
+-/
+@[implemented_by isSameParserContextUnsafe]
+private opaque isSameParserContext (c₁ c₂ : Parser.ParserModuleContext) : Bool
+
 private def getNiceCommandStartPos? (stx : Syntax) : Option String.Pos := do
   let mut stx := stx
   if stx[0].isOfKind ``Command.declModifiers then
@@ -513,7 +543,8 @@ where
 
   parseCmd (old? : Option CommandParsedSnapshot) (parserState : Parser.ModuleParserState)
       (cmdState : Command.State) (prom : IO.Promise CommandParsedSnapshot) (sync : Bool)
-      (parseCancelTk : IO.CancelToken) : LeanProcessingM Unit := do
+      (parseCancelTk : IO.CancelToken) (speculative? : Option SpeculativeParse := none) :
+      LeanProcessingM Unit := do
     let ctx ← read
 
     let unchanged old newParserState : BaseIO Unit :=
@@ -545,13 +576,18 @@ where
 
     let beginPos := parserState.pos
     let scope := cmdState.scopes.head!
-    let pmctx := {
+    let pmctx : Parser.ParserModuleContext := {
       env := cmdState.env, options := scope.opts, currNamespace := scope.currNamespace
       openDecls := scope.openDecls
     }
-    let (stx, parserState, msgLog) :=
+    let parse pmctx parserState :=
       profileit "parsing" scope.opts fun _ =>
         Parser.parseCommand ctx.toInputContext pmctx parserState .empty
+    let (stx, parserState, msgLog) :=
+      if let some spec := speculative?.filter (isSameParserContext ·.pmctx pmctx) then
+        spec.result.get
+      else
+        parse pmctx parserState
 
     -- semi-fast path
     if let some old := old? then
@@ -625,6 +661,14 @@ where
         infoTreeSnap := { stx? := stx', reportingRange? := initRange?, task := finishedPromise.result! }
         reportSnap := { stx? := none, reportingRange? := initRange?, task := reportPromise.result! }
       }
+      -- The next command starts where this one ended, so it can be parsed while elaborating this
+      -- one, as long as elaboration does not affect parsing. This is checked in the next
+      -- `parseCmd` call.
+      let speculative? := if next?.isSome && Elab.speculativeParsing.get scope.opts &&
+          !Parser.internal.parseQuotWithCurrentStage.get scope.opts then
+        some { pmctx, result := Task.spawn fun _ => parse pmctx parserState : SpeculativeParse }
+      else
+        none
       let cmdState ← doElab stx cmdState beginPos
         { old? := old?.map fun old => ⟨old.stx, old.elabSnap⟩, new := elabPromise }
         elabCmdCancelTk ctx
@@ -693,7 +737,7 @@ where
           }
       if let some next := next? then
         -- We're definitely off the fast-forwarding path now
-        parseCmd none parserState cmdState next (sync := false) elabCmdCancelTk ctx
+        parseCmd none parserState cmdState next (sync := false) elabCmdCancelTk speculative? ctx
 
   doElab (stx : Syntax) (cmdState : Command.State) (beginPos : String.Pos)
       (snap : SnapshotBundle DynamicSnapshot) (cancelTk : IO.CancelToken) :
@@ -897,9 +897,19 @@ private def createImportedEnvironmentSeq (cctx : Core.Context) (ngen : NameGener
               toFlat d tree
     termination_by stop - start
 
-/-- Get the results of each task and merge using combining function -/
-private def combineGet [Append α] (z : α) (tasks : Array (Task α)) : α :=
-  tasks.foldl (fun x t => x ++ t.get) (init := z)
+/--
+Merges the results of `tasks` from left to right. Halves are merged in a balanced tree of tasks, so
+merges of independent results run in parallel instead of one after the other on the thread that
+waits for the result.
+-/
+private partial def combineTasks [Append α] [Inhabited α] (tasks : Array (Task α)) : Task α :=
+  if tasks.size ≤ 1 then
+    tasks.getD 0 (.pure default)
+  else
+    let mid := tasks.size / 2
+    let l := combineTasks (tasks.extract 0 mid)
+    let r := combineTasks (tasks.extract mid tasks.size)
+    l.bind (sync := true) fun x => r.map (x ++ ·)
 
 def getChildNgen [Monad M] [MonadNameGenerator M] : M NameGenerator := do
   let ngen ← getNGen
@@ -955,7 +965,7 @@ def createImportedDiscrTree [Monad m] [MonadLog m] [AddMessageContext m] [MonadO
           pure tasks
     termination_by env.header.moduleData.size - idx
   let tasks ← go ngen #[] 0 0 0
-  let r := combineGet default tasks
+  let r := (combineTasks tasks).get
   r.errors.forM logImportFailure
   pure <| r.tree.toLazy
 
@@ -31,6 +31,11 @@ register_builtin_option backward.synthInstance.canonInstances : Bool := {
   descr := "use optimization that relies on 'morally canonical' instances during type class resolution"
 }
 
+register_builtin_option synthInstance.sharedCache : Bool := {
+  defValue := false
+  descr := "share successful results of type class problems without metavariables, free variables, and local instances between commands as long as the set of instances and the reducibility settings are unchanged"
+}
+
 namespace SynthInstance
 
 def getMaxHeartbeats (opts : Options) : Nat :=
@@ -775,6 +780,51 @@ private def cacheResult (cacheKey : SynthInstanceCacheKey) (abstResult? : Option
     else
       modify fun s => { s with cache.synthInstance := s.cache.synthInstance.insert cacheKey (some abstResult) }
 
+/--
+Results of closed type class problems shared between all `MetaM` runs of the process, see
+`synthInstance.sharedCache`. Such a result depends on the environment only through its instances and
+reducibility settings, so the cache stores the corresponding extension states it is valid for.
+-/
+private structure SharedSynthInstanceCache where
+  instances         : Instances
+  reducibility      : NameMap ReducibilityStatus
+  reducibilityExtra : SMap Name ReducibilityStatus
+  /-- Keyed by the type, `synthPendingDepth`, the maximum result size, and the configuration key. -/
+  results           : Std.HashMap (Expr × Nat × Nat × UInt64) Expr := {}
+
+builtin_initialize sharedSynthInstanceCache : IO.Ref (Option SharedSynthInstanceCache) ← IO.mkRef none
+
+private unsafe def SharedSynthInstanceCache.isValidForUnsafe (c : SharedSynthInstanceCache)
+    (instances : Instances) (reducibility : NameMap ReducibilityStatus)
+    (reducibilityExtra : SMap Name ReducibilityStatus) : Bool :=
+  ptrEq c.instances instances && ptrEq c.reducibility reducibility && ptrEq c.reducibilityExtra reducibilityExtra
+
+/--
+Returns whether the cache was created for the given states. Any change to the extensions creates new
+state objects, so comparing pointers is a conservative check. As the cache keeps its states alive,
+their addresses cannot be reused by unrelated states.
+-/
+@[implemented_by SharedSynthInstanceCache.isValidForUnsafe]
+private opaque SharedSynthInstanceCache.isValidFor (c : SharedSynthInstanceCache)
+    (instances : Instances) (reducibility : NameMap ReducibilityStatus)
+    (reducibilityExtra : SMap Name ReducibilityStatus) : Bool
+
+/--
+Runs `f` on the shared cache for the instances and reducibility settings of the current environment,
+resetting it if they changed.
+-/
+private def modifyGetSharedCache (f : SharedSynthInstanceCache → α × SharedSynthInstanceCache) : MetaM α := do
+  let env ← getEnv
+  let instances := instanceExtension.getState env
+  let reducibility := reducibilityCoreExt.getState env (asyncMode := .local)
+  let reducibilityExtra := reducibilityExtraExt.getState env
+  sharedSynthInstanceCache.modifyGet fun c? =>
+    let c := match c? with
+      | some c => if c.isValidFor instances reducibility reducibilityExtra then c else { instances, reducibility, reducibilityExtra }
+      | none   => { instances, reducibility, reducibilityExtra }
+    let (a, c) := f c
+    (a, some c)
+
 def synthInstance? (type : Expr) (maxResultSize? : Option Nat := none) : MetaM (Option Expr) := do profileitM Exception "typeclass inference" (← getOptions) (decl := type.getAppFn.constName?.getD .anonymous) do
   let opts ← getOptions
   let maxResultSize := maxResultSize?.getD (synthInstance.maxSize.get opts)
@@ -793,12 +843,32 @@ def synthInstance? (type : Expr) (maxResultSize? : Option Nat := none) : MetaM (
       trace[Meta.synthInstance] "result {result?} (cached)"
       return result?
     | none =>
+      /-
+      Only problems whose solution cannot depend on the local context or on metavariables are shared.
+      Failures are not shared as they may be due to the heartbeat limit of the current command.
+      -/
+      let sharedKey? :=
+        if synthInstance.sharedCache.get opts && localInsts.isEmpty && !type.hasMVar && !type.hasFVar then
+          some (type, (← read).synthPendingDepth, maxResultSize,
+            (← getConfigWithKey).key ^^^ (backward.synthInstance.canonInstances.get opts).toUInt64)
+        else
+          none
+      if let some sharedKey := sharedKey? then
+        if let some expr ← modifyGetSharedCache fun c => (c.results[sharedKey]?, c) then
+          let abstResult? := some { expr, paramNames := #[], numMVars := 0 }
+          let result? ← applyCachedAbstractResult? type abstResult?
+          trace[Meta.synthInstance] "result {result?} (shared cache)"
+          cacheResult cacheKey abstResult? result?
+          return result?
       let abstResult? ← withNewMCtxDepth (allowLevelAssignments := true) do
         let normType ← preprocessOutParam type
         SynthInstance.main normType maxResultSize
       let result? ← applyAbstractResult? type abstResult?
       trace[Meta.synthInstance] "result {result?}"
       cacheResult cacheKey abstResult? result?
+      if let (some sharedKey, some abstResult, some _) := (sharedKey?, abstResult?, result?) then
+        if abstResult.numMVars == 0 && abstResult.paramNames.isEmpty then
+          modifyGetSharedCache fun c => ((), { c with results := c.results.insert sharedKey abstResult.expr })
       return result?
 
 /--
@@ -930,6 +930,8 @@ def reduceNat? (e : Expr) : MetaM (Option Expr) :=
   | .app (.const fn _) a =>
     if fn == ``Nat.succ then
       reduceUnaryNatOp Nat.succ a
+    else if fn == ``Nat.log2 then
+      reduceUnaryNatOp Nat.log2 a
     else
       return none
   | .app (.app (.const fn _) a1) a2 =>
@@ -948,6 +950,7 @@ def reduceNat? (e : Expr) : MetaM (Option Expr) :=
     | ``Nat.xor  => reduceBinNatOp Nat.xor a1 a2
     | ``Nat.shiftLeft  => reduceBinNatOp Nat.shiftLeft a1 a2
     | ``Nat.shiftRight => reduceBinNatOp Nat.shiftRight a1 a2
+    | ``Nat.testBit => reduceBinNatPred Nat.testBit a1 a2
     | _ => return none
   | _ =>
     return none
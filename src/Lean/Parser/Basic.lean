@@ -519,12 +519,68 @@ partial def takeUntilFn (p : Char → Bool) : ParserFn := fun c s =>
 def takeWhileFn (p : Char → Bool) : ParserFn :=
   takeUntilFn (fun c => !p c)
 
+/-!
+The following functions find the end of runs of ASCII characters that the tokenizer skips over one
+character at a time otherwise. They are implemented natively and scan several bytes at a time where
+possible. Their results are always positions of characters as they stop at non-ASCII bytes.
+-/
+
+/--
+Returns the position of the first byte at or after `i` in `s` that is not an ASCII character
+satisfying `isIdRest`, or `s.utf8ByteSize` if there is none.
+-/
+@[extern "lean_parser_ascii_id_rest_end"]
+def asciiIdRestEnd (s : @& String) (i : @& Nat) : Nat :=
+  if h : i < s.utf8ByteSize then
+    let b := s.getUtf8Byte i h
+    if b < 128 && isIdRest (Char.ofNat b.toNat) then asciiIdRestEnd s (i + 1) else i
+  else
+    i
+termination_by s.utf8ByteSize - i
+
+/--
+Returns the position of the first byte at or after `i` in `s` that is neither a space nor a newline,
+or `s.utf8ByteSize` if there is none.
+-/
+@[extern "lean_parser_ascii_blank_end"]
+def asciiBlankEnd (s : @& String) (i : @& Nat) : Nat :=
+  if h : i < s.utf8ByteSize then
+    let b := s.getUtf8Byte i h
+    -- ` ` and `\n`
+    if b == 32 || b == 10 then asciiBlankEnd s (i + 1) else i
+  else
+    i
+termination_by s.utf8ByteSize - i
+
+/--
+Returns the position of the first byte at or after `i` in `s` that is `-` or `/`, which are the only
+characters that can start or end a nested comment, or `s.utf8ByteSize` if there is none.
+-/
+@[extern "lean_parser_next_comment_delim_byte"]
+def nextCommentDelimByte (s : @& String) (i : @& Nat) : Nat :=
+  if h : i < s.utf8ByteSize then
+    let b := s.getUtf8Byte i h
+    -- `-` and `/`
+    if b == 45 || b == 47 then i else nextCommentDelimByte s (i + 1)
+  else
+    i
+termination_by s.utf8ByteSize - i
+
+/-- `takeWhileFn isIdRest` that skips runs of ASCII characters natively. -/
+partial def takeIdRestFn : ParserFn := fun c s =>
+  let s := s.setPos ⟨asciiIdRestEnd c.input s.pos.byteIdx⟩
+  let i := s.pos
+  if h : c.input.atEnd i then s
+  else if isIdRest (c.input.get' i h) then takeIdRestFn c (s.next' c.input i h)
+  else s
+
 def takeWhile1Fn (p : Char → Bool) (errorMsg : String) : ParserFn :=
   andthenFn (satisfyFn p errorMsg) (takeWhileFn p)
 
 variable (pushMissingOnError : Bool) in
 partial def finishCommentBlock (nesting : Nat) : ParserFn := fun c s =>
   let input := c.input
+  let s     := s.setPos ⟨nextCommentDelimByte input s.pos.byteIdx⟩
   let i     := s.pos
   if h : input.atEnd i then eoi s
   else
@@ -560,11 +616,13 @@ partial def whitespace : ParserFn := fun c s =>
       s.mkUnexpectedError (pushMissing := false) "tabs are not allowed; please configure your editor to expand them"
     else if curr == '\r' then
       s.mkUnexpectedError (pushMissing := false) "isolated carriage returns are not allowed"
-    else if curr.isWhitespace then whitespace c (s.next' input i h)
+    else if curr.isWhitespace then whitespace c (s.setPos ⟨asciiBlankEnd input i.byteIdx⟩)
     else if curr == '-' then
       let i    := input.next' i h
       let curr := input.get i
-      if curr == '-' then andthenFn (takeUntilFn (fun c => c = '\n')) whitespace c (s.next input i)
+      if curr == '-' then
+        let i := input.next i
+        whitespace c (s.setPos (input.posOfAux '\n' input.endPos i))
       else s
     else if curr == '/' then
       let i        := input.next' i h
@@ -984,7 +1042,7 @@ partial def identFnAux (startPos : String.Pos) (tk : Option Token) (r : Name) :
             mkIdResult startPos tk r c s
       else if isIdFirst curr then
         let startPart := i
-        let s         := takeWhileFn isIdRest c (s.next input i)
+        let s         := takeIdRestFn c (s.next input i)
         let stopPart  := s.pos
         let r := .str r (input.extract startPart stopPart)
         if isIdCont input s then
@@ -8,6 +8,7 @@ prelude
 import Lean.Data.Lsp.Internal
 import Lean.Server.Utils
 import Std.Data.TreeMap
+import Std.Data.HashMap
 
 /-! # Representing collected and deduplicated definitions and usages -/
 
@@ -390,6 +391,11 @@ structure References where
   ileans : ILeanMap
   /-- References from workers, overriding the corresponding ilean files -/
   workers : WorkerRefMap
+  /--
+  The modules in `ileans` for every path, so that updating an ilean file does not have to visit
+  all modules.
+  -/
+  ileanModules : Std.HashMap System.FilePath (Array Name) := {}
 
 namespace References
 
@@ -398,13 +404,20 @@ def empty : References := { ileans := ∅, workers := ∅ }
 
 /-- Adds the contents of an ilean file `ilean` at `path` to `self`. -/
 def addIlean (self : References) (path : System.FilePath) (ilean : Ilean) : References :=
-  { self with ileans := self.ileans.insert ilean.module (path, ilean.references) }
+  let ileanModules := match self.ileans[ilean.module]? with
+    | some (oldPath, _) =>
+      self.ileanModules.insert oldPath <|
+        (self.ileanModules.getD oldPath #[]).filter (· != ilean.module)
+    | none => self.ileanModules
+  { self with
+    ileans := self.ileans.insert ilean.module (path, ilean.references)
+    ileanModules := ileanModules.insert path <| (ileanModules.getD path #[]).push ilean.module }
 
 /-- Removes the ilean file data at `path` from `self`. -/
 def removeIlean (self : References) (path : System.FilePath) : References :=
-  let namesToRemove := self.ileans.filter (fun _ (p, _) => p == path)
-  namesToRemove.foldl (init := self) fun self name _ =>
-    { self with ileans := self.ileans.erase name }
+  let namesToRemove := self.ileanModules.getD path #[]
+  namesToRemove.foldl (init := { self with ileanModules := self.ileanModules.erase path })
+    fun self name => { self with ileans := self.ileans.erase name }
 
 /--
 Updates the worker references in `self` with the `refs` of the worker managing the module `name`.
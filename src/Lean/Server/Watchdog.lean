@@ -62,6 +62,9 @@ Moreover, we don't implement the full protocol at this level:
   process.
 - File workers are always terminated with an `exit` notification, without previously receiving a
   `shutdown` request. Similarly, they never receive a `didClose` notification.
+- The watchdog keeps one spare worker process that has been started but not yet sent `initialize`,
+  and hands it to the next file that is opened. Hence, workers do not get the URI of their file on
+  the command line.
 
 ## Watchdog <-> client communication
 
@@ -256,6 +259,20 @@ section FileWorker
         return exitCode
 
   end FileWorker
+
+  /--
+  Starts a file worker process. The worker waits for the `initialize` request and the `didOpen`
+  notification of its file, so it can be started before it is known which file it is for.
+  -/
+  def spawnWorkerProc (workerPath : System.FilePath) (args : List String) :
+      IO (Process.Child workerCfg) :=
+    Process.spawn {
+      toStdioConfig := workerCfg
+      cmd           := workerPath.toString
+      args          := #["--worker"] ++ args.toArray
+      -- open session for `kill` above
+      setsid        := true
+    }
 end FileWorker
 
 section ServerM
@@ -349,6 +366,12 @@ section ServerM
     serverRequestData : IO.Ref ServerRequestData
     importData        : IO.Ref ImportData
     requestData       : RequestDataMutex
+    /--
+    A worker process that was started ahead of time and is handed to the next file that is opened,
+    so that process startup and runtime initialization are not on the path to its first
+    diagnostics.
+    -/
+    spareWorker       : IO.Ref (Option (Process.Child workerCfg))
 
   structure ReferenceRequestContext where
     srcSearchPath : System.SearchPath
@@ -434,9 +457,16 @@ section ServerM
     loop : ServerM WorkerEvent := do
       let uri := fw.doc.uri
       let o := (←read).hOut
-      let msg ←
+      -- Most messages are forwarded to the client unchanged, so we only parse the ones that the
+      -- watchdog needs to inspect or rewrite.
+      let (raw, msg?) ←
         try
-          fw.stdout.readLspMessage
+          let raw ← fw.stdout.readLspMessageRaw
+          if isForwardedUnchanged raw then
+            pure (raw, none)
+          else
+            let msg : Message ← ofExcept <| Json.parse raw >>= fromJson?
+            pure (raw, some msg)
         catch _ =>
           let exitCode ← fw.waitForProc
           -- Remove surviving descendant processes, if any, such as from nested builds.
@@ -458,6 +488,13 @@ section ServerM
           return
         -- Re. `o.writeLspMessage msg`:
         -- Writes to Lean I/O channels are atomic, so these won't trample on each other.
+        let some msg := msg?
+          | if let some id := peekResponseId? raw then
+              -- See `Message.response` below.
+              if (← erasePendingRequest uri id) then
+                o.writeLspMessageRaw raw
+            else
+              o.writeLspMessageRaw raw
         match msg with
         | Message.response id _ => do
           let wasPending ← erasePendingRequest uri id
@@ -493,16 +530,36 @@ section ServerM
 
       loop
 
+    /-- Whether `raw` is a response or a notification that is not handled by the watchdog. -/
+    isForwardedUnchanged (raw : String) : Bool :=
+      match peekNotificationMethod? raw with
+      | some method =>
+        !["$/lean/ileanInfoUpdate", "$/lean/ileanInfoFinal", "$/lean/importClosure"].contains method
+      | none => (peekResponseId? raw).isSome
+
+  /-- Takes the spare worker if it is still alive, and starts a new worker otherwise. -/
+  def takeWorkerProc : ServerM (Process.Child workerCfg) := do
+    let st ← read
+    if let some proc ← st.spareWorker.swap none then
+      if (← proc.tryWait).isNone then
+        return proc
+    spawnWorkerProc st.workerPath st.args
+
+  /-- Starts a new spare worker unless there already is one. -/
+  def replenishSpareWorker : ServerM Unit := do
+    let st ← read
+    if (← st.spareWorker.get).isSome then
+      return
+    try
+      st.spareWorker.set (some (← spawnWorkerProc st.workerPath st.args))
+    catch _ =>
+      -- Failing to start a worker is reported when it is actually needed.
+      pure ()
+
   def startFileWorker (m : DocumentMeta) : ServerM Unit := do
     let st ← read
     st.hOut.writeLspMessage <| mkFileProgressAtPosNotification m 0
-    let workerProc ← Process.spawn {
-      toStdioConfig := workerCfg
-      cmd           := st.workerPath.toString
-      args          := #["--worker"] ++ st.args.toArray ++ #[m.uri]
-      -- open session for `kill` above
-      setsid        := true
-    }
+    let workerProc ← takeWorkerProc
     let exitCode ← Std.Mutex.new none
     let initialDependencyBuildMode := m.dependencyBuildMode
     let updatedDependencyBuildMode :=
@@ -537,6 +594,7 @@ section ServerM
       }
     }
     updateFileWorkers fw
+    replenishSpareWorker
     let reqQueue ← st.requestData.getRequestQueue m.uri
     for (_, msg) in reqQueue do
       try
@@ -1082,6 +1140,12 @@ section MainLoop
     for ⟨_, fw⟩ in fileWorkers do
       -- TODO: Wait for process group to finish instead
       try let _ ← fw.killProcAndWait catch _ => pure ()
+    if let some proc ← (←read).spareWorker.swap none then
+      try
+        proc.kill
+        let _ ← proc.wait
+      catch _ =>
+        pure ()
 
   inductive ServerEvent where
     | workerEvent (fw : FileWorker) (ev : WorkerEvent)
@@ -1252,6 +1316,9 @@ def findWorkerPath : IO System.FilePath := do
     workerPath := System.FilePath.mk path
   return workerPath
 
+/-- Number of dedicated tasks that load the .ileans in the search path at startup. -/
+def ileanLoadingTasks : Nat := 8
+
 /--
 Starts loading .ileans present in the search path asynchronously in an IO task.
 This ensures that server startup is not blocked by loading the .ileans.
@@ -1263,16 +1330,22 @@ def startLoadingReferences (references : IO.Ref References) : IO Unit := do
   -- but we should try to continue server operations regardless
   let _ ← ServerTask.IO.asTask do
     let oleanSearchPath ← Lean.searchPathRef.get
-    for path in ← oleanSearchPath.findAllWithExt "ilean" do
-      try
-        let ilean ← Ilean.load path
-        references.modify fun refs =>
-          refs.addIlean path ilean
-      catch _ =>
-        -- could be a race with the build system, for example
-        -- ilean load errors should not be fatal, but we *should* log them
-        -- when we add logging to the server
-        pure ()
+    let paths ← oleanSearchPath.findAllWithExt "ilean"
+    -- Reading and parsing the .ileans dominates, so it is split between several tasks that only
+    -- synchronize to insert the results.
+    for i in [0:ileanLoadingTasks] do
+      let _ ← ServerTask.IO.asTask do
+        for j in [i:paths.size:ileanLoadingTasks] do
+          let path := paths[j]!
+          try
+            let ilean ← Ilean.load path
+            references.modify fun refs =>
+              refs.addIlean path ilean
+          catch _ =>
+            -- could be a race with the build system, for example
+            -- ilean load errors should not be fatal, but we *should* log them
+            -- when we add logging to the server
+            pure ()
 
 def initAndRunWatchdog (args : List String) (i o e : FS.Stream) : IO Unit := do
   let workerPath ← findWorkerPath
@@ -1286,6 +1359,12 @@ def initAndRunWatchdog (args : List String) (i o e : FS.Stream) : IO Unit := do
   }
   let importData ← IO.mkRef ⟨RBMap.empty, RBMap.empty⟩
   let requestData ← RequestDataMutex.new
+  -- Start a worker for the first file while waiting for the client to initialize the server.
+  let spareWorker : IO.Ref (Option (Process.Child workerCfg)) ← IO.mkRef none
+  try
+    spareWorker.set (some (← spawnWorkerProc workerPath args))
+  catch _ =>
+    pure ()
   let i ← maybeTee "wdIn.txt" false i
   let o ← maybeTee "wdOut.txt" true o
   let e ← maybeTee "wdErr.txt" true e
@@ -1314,6 +1393,7 @@ def initAndRunWatchdog (args : List String) (i o e : FS.Stream) : IO Unit := do
     serverRequestData
     importData
     requestData
+    spareWorker
     : ServerContext
   }
 
@@ -22,7 +22,9 @@ as-is to the wrapped compiler.
 
 Interesting options:
 * `--print-cflags`: print C compiler flags necessary for building against the Lean runtime and exit
-* `--print-ldflags`: print C compiler flags necessary for statically linking against the Lean library and exit"
+* `--print-ldflags`: print C compiler flags necessary for statically linking against the Lean library and exit
+* `--lto`: compile and link with ThinLTO, linking statically against the bitcode version of the Lean runtime so
+  that runtime functions can be inlined into the program; requires a toolchain built with `-DLTO_RUNTIME=ON`"
     return 1
 
   -- It is difficult to identify the correct minor version here, leading to linking warnings like:
@@ -35,12 +37,19 @@ Interesting options:
   -- let compileOnly := args.contains "-c"
   let linkStatic := !(args.contains "-shared" || args.contains "-leanshared")
   let args := args.erase "-leanshared"
+  let lto := args.contains "--lto"
+  let args := args.erase "--lto"
 
   -- We assume that the CMake variables do not contain escaped spaces
   let cflags := getCFlags root
   let mut cflagsInternal := getInternalCFlags root
   let mut ldflagsInternal := getInternalLinkerFlags root
-  let ldflags := getLinkerFlags root linkStatic
+  let mut ldflags := getLinkerFlags root linkStatic
+  if lto then
+    if linkStatic && !args.contains "-c" && !(← (root / "lib" / "lean" / "libleanrt_lto.a").pathExists) then
+      IO.eprintln "leanc: `--lto` requires a Lean toolchain built with `-DLTO_RUNTIME=ON`"
+      return 1
+    ldflags := ldflags.map fun flag => if flag == "-lleanrt" then "-lleanrt_lto" else flag
 
   for arg in args do
     match arg with
@@ -57,6 +66,7 @@ Interesting options:
     -- these are intended for the bundled compiler only
     cflagsInternal := #[]
     ldflagsInternal := #[]
+  let args := if lto then "-flto=thin" :: args else args
   let args := cflags ++ cflagsInternal ++ args ++ ldflagsInternal ++ ldflags ++ ["-Wno-unused-command-line-argument"]
   let args := args.filter (!·.isEmpty)
   if args.contains "-v" then
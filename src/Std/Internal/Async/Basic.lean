@@ -100,6 +100,14 @@ Create an `AsyncTask` that resolves to the value of `x`.
 def ofPurePromise (x : IO.Promise α) : AsyncTask α :=
   x.result!.map pure
 
+/--
+Create an `AsyncTask` that finishes as soon as either `x` or `y` has finished, this is useful for
+timeouts. No thread is blocked while waiting.
+-/
+def race (x y : AsyncTask α) : BaseIO (AsyncTask α) := do
+  let t ← IO.select #[x, y]
+  return t.map (sync := true) (·.2)
+
 /--
 Obtain the `IO.TaskState` of `x`.
 -/
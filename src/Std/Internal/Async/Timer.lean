@@ -74,6 +74,16 @@ def sleep (duration : Std.Time.Millisecond.Offset) : IO (AsyncTask Unit) := do
   let sleeper ← Sleep.mk duration
   sleeper.wait
 
+/--
+Return an `AsyncTask` that resolves after `duration`, rounded up to the 10 millisecond tick of the
+shared timer wheel. Unlike `sleep` this does not allocate a timer per call, so it should be
+preferred for large numbers of timeouts.
+-/
+@[inline]
+def coarseSleep (duration : Std.Time.Millisecond.Offset) : IO (AsyncTask Unit) := do
+  let promise ← Internal.UV.TimerWheel.sleep duration.toInt.toNat.toUInt64
+  return .ofPurePromise promise
+
 /--
 `Interval` can be used to repeatedly wait for some duration like a clock.
 The underlying timer has millisecond resolution.
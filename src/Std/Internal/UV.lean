@@ -9,3 +9,9 @@ import Init.System.Promise
 
 import Std.Internal.UV.Loop
 import Std.Internal.UV.Timer
+import Std.Internal.UV.TimerWheel
+import Std.Internal.UV.FS
+import Std.Internal.UV.Writer
+import Std.Internal.UV.TCP
+import Std.Internal.UV.UDP
+import Std.Internal.UV.DNS
@@ -0,0 +1,42 @@
+/-
+Copyright (c) 2025 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+-/
+prelude
+import Init.System.IO
+import Init.System.Promise
+import Std.Net.Addr
+
+namespace Std
+namespace Internal
+namespace UV
+namespace DNS
+
+open Std.Net
+
+/-!
+Asynchronous name resolution. The lookups run on the libuv thread pool instead of blocking a
+thread of the task manager. Errors are reported through the `Except` in the promise.
+-/
+
+/--
+Resolve `host` and `service` to the socket addresses they refer to, as in `getaddrinfo`. Either of
+them may be empty, but not both. `service` can be a port number or a service name like `"http"`.
+
+If `cache` is `true`, successful results are kept in a small in-process cache for 30 seconds and
+later lookups of the same `host` and `service` with `cache` set are answered from it.
+-/
+@[extern "lean_uv_dns_get_info"]
+opaque getAddrInfo (host service : @& String) (cache : Bool := false) :
+    IO (IO.Promise (Except IO.Error (Array SocketAddress)))
+
+/--
+Look up the host name and service name of `addr`, as in `getnameinfo`.
+-/
+@[extern "lean_uv_dns_get_name"]
+opaque getNameInfo (addr : @& SocketAddress) : IO (IO.Promise (Except IO.Error (String × String)))
+
+end DNS
+end UV
+end Internal
+end Std
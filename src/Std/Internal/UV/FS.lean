@@ -0,0 +1,54 @@
+/-
+Copyright (c) 2025 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+-/
+prelude
+import Init.System.IO
+import Init.System.Promise
+
+namespace Std
+namespace Internal
+namespace UV
+namespace FS
+
+/-!
+Asynchronous file system operations. Each function submits a request to the libuv thread pool and
+returns right away with an `IO.Promise` that is resolved on the event loop once the request has
+completed. Errors are reported through the `Except` in the promise, while errors that occur when
+submitting the request are thrown directly.
+-/
+
+/--
+Asynchronous version of `System.FilePath.metadata`.
+-/
+@[extern "lean_uv_fs_metadata"]
+opaque metadata (path : @& String) : IO (IO.Promise (Except IO.Error IO.FS.Metadata))
+
+/--
+Asynchronous version of `IO.FS.rename`.
+-/
+@[extern "lean_uv_fs_rename"]
+opaque rename (oldPath newPath : @& String) : IO (IO.Promise (Except IO.Error Unit))
+
+/--
+Asynchronous version of `IO.FS.removeFile`.
+-/
+@[extern "lean_uv_fs_remove_file"]
+opaque removeFile (path : @& String) : IO (IO.Promise (Except IO.Error Unit))
+
+/--
+Asynchronous version of `IO.FS.createDir`.
+-/
+@[extern "lean_uv_fs_create_dir"]
+opaque createDir (path : @& String) : IO (IO.Promise (Except IO.Error Unit))
+
+/--
+Asynchronous version of `IO.FS.removeDir`.
+-/
+@[extern "lean_uv_fs_remove_dir"]
+opaque removeDir (path : @& String) : IO (IO.Promise (Except IO.Error Unit))
+
+end FS
+end UV
+end Internal
+end Std
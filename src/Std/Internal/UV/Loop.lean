@@ -28,17 +28,71 @@ structure Options where
   blockSigProfSignal : Bool := False
 
 /--
-Configures the event loop with the specified options.
+Configures the event loop with the specified options. If the runtime was started with
+`LEAN_NUM_EVENT_LOOPS` set to run several event loops (at most 64), all of them are configured.
 -/
 @[extern "lean_uv_event_loop_configure"]
 opaque configure (options : Options) : BaseIO Unit
 
 /--
-Checks if the event loop is still active and processing events.
+Checks if any event loop is still active and processing events.
 -/
 @[extern "lean_uv_event_loop_alive"]
 opaque alive : BaseIO Bool
 
+/--
+Counters of an event loop. All times are in nanoseconds and accumulated since the start of the
+program.
+-/
+structure Stats where
+  /--
+  The number of active handles by type, e.g. `("tcp", 3)`.
+  -/
+  handles : Array (String × Nat)
+  /--
+  The number of iterations of the event loop.
+  -/
+  iterations : UInt64
+  /--
+  The time spent running the event loop, including the time spent waiting for events.
+  -/
+  runTime : UInt64
+  /--
+  The time spent waiting for events, only accumulated if the loop was configured with
+  `accumulateIdleTime`.
+  -/
+  idleTime : UInt64
+  /--
+  The number of times a thread had to wait for the event loop to become free.
+  -/
+  lockWaits : UInt64
+  /--
+  The total time threads waited for the event loop to become free.
+  -/
+  lockWaitTime : UInt64
+  /--
+  The number of asynchronous requests started on the event loop, such as DNS lookups or timer
+  sleeps.
+  -/
+  submissions : UInt64
+  /--
+  The total time between issuing these requests and the event loop starting to process them.
+  -/
+  submitLatency : UInt64
+  /--
+  The longest time between issuing a request and the event loop starting to process it.
+  -/
+  maxSubmitLatency : UInt64
+  deriving Inhabited, Repr
+
+/--
+Returns the counters of every event loop. Setting the environment variable
+`LEAN_EVENT_LOOP_STATS_INTERVAL` to a number of milliseconds additionally logs them to stderr in
+that interval.
+-/
+@[extern "lean_uv_event_loop_stats"]
+opaque stats : BaseIO (Array Stats)
+
 end Loop
 end UV
 end Internal
@@ -0,0 +1,112 @@
+/-
+Copyright (c) 2025 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+-/
+prelude
+import Init.System.IO
+import Init.System.Promise
+import Std.Net.Addr
+
+namespace Std
+namespace Internal
+namespace UV
+namespace TCP
+
+open Std.Net
+
+private opaque SocketImpl : NonemptyType.{0}
+
+/--
+Represents a TCP socket on the event loop. Operations that wait for the network return an
+`IO.Promise` that is resolved on the event loop; errors that can be detected right away are thrown
+directly.
+-/
+def Socket : Type := SocketImpl.type
+
+instance : Nonempty Socket := SocketImpl.property
+
+namespace Socket
+
+/--
+Creates a new, unconnected TCP socket.
+-/
+@[extern "lean_uv_tcp_new"]
+opaque new : IO Socket
+
+/--
+Connects the socket to `addr`. The returned promise is resolved once the connection has been
+established.
+-/
+@[extern "lean_uv_tcp_connect"]
+opaque connect (socket : @& Socket) (addr : @& SocketAddress) : IO (IO.Promise (Except IO.Error Unit))
+
+/--
+Sends `data` through the socket. Sends are performed in order, and the returned promise is
+resolved once `data` has been handed to the operating system.
+-/
+@[extern "lean_uv_tcp_send"]
+opaque send (socket : @& Socket) (data : ByteArray) : IO (IO.Promise (Except IO.Error Unit))
+
+/--
+Receives at most `size` bytes from the socket, which are read directly into the returned
+`ByteArray`. The promise is resolved with `none` once the peer has closed the connection. Only one
+receive can be pending at a time.
+-/
+@[extern "lean_uv_tcp_recv"]
+opaque recv? (socket : @& Socket) (size : UInt64) : IO (IO.Promise (Except IO.Error (Option ByteArray)))
+
+/--
+Binds the socket to `addr`.
+-/
+@[extern "lean_uv_tcp_bind"]
+opaque bind (socket : @& Socket) (addr : @& SocketAddress) : IO Unit
+
+/--
+Starts listening for incoming connections on the socket, queueing at most `backlog` of them.
+-/
+@[extern "lean_uv_tcp_listen"]
+opaque listen (socket : @& Socket) (backlog : UInt32) : IO Unit
+
+/--
+Accepts an incoming connection on a listening socket. Only one accept can be pending at a time.
+-/
+@[extern "lean_uv_tcp_accept"]
+opaque accept (socket : @& Socket) : IO (IO.Promise (Except IO.Error Socket))
+
+/--
+Shuts down the writing side of the socket once all pending sends have completed.
+-/
+@[extern "lean_uv_tcp_shutdown"]
+opaque shutdown (socket : @& Socket) : IO (IO.Promise (Except IO.Error Unit))
+
+/--
+Returns the address of the peer the socket is connected to.
+-/
+@[extern "lean_uv_tcp_getpeername"]
+opaque getPeerName (socket : @& Socket) : IO SocketAddress
+
+/--
+Returns the address the socket is bound to.
+-/
+@[extern "lean_uv_tcp_getsockname"]
+opaque getSockName (socket : @& Socket) : IO SocketAddress
+
+/--
+Disables Nagle's algorithm for the socket.
+-/
+@[extern "lean_uv_tcp_nodelay"]
+opaque noDelay (socket : @& Socket) : IO Unit
+
+/--
+Enables or disables TCP keep-alive. `delay` is the initial delay in seconds and ignored when
+disabling keep-alive.
+-/
+@[extern "lean_uv_tcp_keepalive"]
+opaque keepAlive (socket : @& Socket) (enable : Bool) (delay : UInt32) : IO Unit
+
+end Socket
+
+end TCP
+end UV
+end Internal
+end Std
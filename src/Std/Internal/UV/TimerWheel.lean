@@ -0,0 +1,39 @@
+/-
+Copyright (c) 2025 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+-/
+prelude
+import Init.System.IO
+import Init.System.Promise
+
+namespace Std
+namespace Internal
+namespace UV
+
+/-!
+A hierarchical timer wheel that is driven by a single libuv timer. In contrast to `Timer`, which
+allocates a libuv handle per timer, sleeping on the wheel only costs a small list entry, and all
+sleeps that expire in the same tick share one `IO.Promise`. This makes it suitable for huge numbers
+of sleeps and timeouts that do not require millisecond precision.
+-/
+
+namespace TimerWheel
+
+/--
+Return an `IO.Promise` that resolves once at least `timeout` milliseconds have elapsed. The wheel
+ticks every 10 milliseconds, so the promise may resolve up to one tick late.
+-/
+@[extern "lean_uv_timer_wheel_sleep"]
+opaque sleep (timeout : UInt64) : IO (IO.Promise Unit)
+
+/--
+The number of distinct deadlines that are currently waiting in the timer wheel.
+-/
+@[extern "lean_uv_timer_wheel_pending"]
+opaque pending : IO UInt64
+
+end TimerWheel
+
+end UV
+end Internal
+end Std
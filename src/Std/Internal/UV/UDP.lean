@@ -0,0 +1,81 @@
+/-
+Copyright (c) 2025 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+-/
+prelude
+import Init.System.IO
+import Init.System.Promise
+import Std.Net.Addr
+
+namespace Std
+namespace Internal
+namespace UV
+namespace UDP
+
+open Std.Net
+
+private opaque SocketImpl : NonemptyType.{0}
+
+/--
+Represents a UDP socket on the event loop.
+-/
+def Socket : Type := SocketImpl.type
+
+instance : Nonempty Socket := SocketImpl.property
+
+namespace Socket
+
+/--
+Creates a new UDP socket.
+-/
+@[extern "lean_uv_udp_new"]
+opaque new : IO Socket
+
+/--
+Binds the socket to `addr`.
+-/
+@[extern "lean_uv_udp_bind"]
+opaque bind (socket : @& Socket) (addr : @& SocketAddress) : IO Unit
+
+/--
+Associates the socket with the remote address `addr`, so that `send` can be used without an
+address and only datagrams from `addr` are received.
+-/
+@[extern "lean_uv_udp_connect"]
+opaque connect (socket : @& Socket) (addr : @& SocketAddress) : IO Unit
+
+/--
+Sends `data` as a single datagram to `addr`, which must be `none` exactly if the socket is
+connected. The returned promise is resolved once the datagram has been sent.
+-/
+@[extern "lean_uv_udp_send"]
+opaque send (socket : @& Socket) (data : ByteArray) (addr : @& Option SocketAddress) :
+    IO (IO.Promise (Except IO.Error Unit))
+
+/--
+Receives a single datagram of at most `size` bytes, which is read directly into the returned
+`ByteArray`, together with the address of its sender if known. Only one receive can be pending at a
+time.
+-/
+@[extern "lean_uv_udp_recv"]
+opaque recv (socket : @& Socket) (size : UInt64) :
+    IO (IO.Promise (Except IO.Error (ByteArray × Option SocketAddress)))
+
+/--
+Returns the address the socket is bound to.
+-/
+@[extern "lean_uv_udp_getsockname"]
+opaque getSockName (socket : @& Socket) : IO SocketAddress
+
+/--
+Returns the address the socket is connected to.
+-/
+@[extern "lean_uv_udp_getpeername"]
+opaque getPeerName (socket : @& Socket) : IO SocketAddress
+
+end Socket
+
+end UDP
+end UV
+end Internal
+end Std
@@ -0,0 +1,55 @@
+/-
+Copyright (c) 2025 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+-/
+prelude
+import Init.System.IO
+import Init.System.Promise
+
+namespace Std
+namespace Internal
+namespace UV
+
+private opaque WriterImpl : NonemptyType.{0}
+
+/--
+A `Writer` writes to a pipe or terminal on the event loop, so that a slow reader on the other end
+does not block the writing thread. Writes are queued in order; `Writer.queueSize` reports how much
+data is still waiting to be written, which callers can use to apply backpressure.
+
+Creating a `Writer` puts the file descriptor into non-blocking mode, so it should not be written to
+through an `IO.FS.Handle` at the same time.
+-/
+def Writer : Type := WriterImpl.type
+
+instance : Nonempty Writer := WriterImpl.property
+
+namespace Writer
+
+/--
+Create a `Writer` for the file descriptor `fd`, e.g. `1` for the standard output. Fails if `fd` is
+neither a pipe nor a terminal. The writer uses a duplicate of `fd`, which it closes when it is
+freed, so `fd` itself stays open.
+-/
+@[extern "lean_uv_writer_mk"]
+opaque mk (fd : UInt32) : IO Writer
+
+/--
+Queue `data` for writing and return an `IO.Promise` that is resolved once all of it has been
+written, or with the error that prevented it. The writer is kept alive until then.
+-/
+@[extern "lean_uv_writer_write"]
+opaque write (writer : @& Writer) (data : ByteArray) : IO (IO.Promise (Except IO.Error Unit))
+
+/--
+Return the number of bytes that have been queued by `write` but not yet been written, including
+those of writes that the event loop has not started yet.
+-/
+@[extern "lean_uv_writer_queue_size"]
+opaque queueSize (writer : @& Writer) : IO UInt64
+
+end Writer
+
+end UV
+end Internal
+end Std
@@ -6,3 +6,5 @@ Authors: Henrik Böving
 prelude
 import Std.Sync.Channel
 import Std.Sync.Mutex
+import Std.Sync.SharedMutex
+import Std.Sync.Atomic
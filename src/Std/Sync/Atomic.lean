@@ -0,0 +1,58 @@
+/-
+Copyright (c) 2025 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+-/
+prelude
+import Init.System.IO
+
+namespace Std
+
+private opaque AtomicUInt64Impl : NonemptyType.{0}
+
+/--
+A `UInt64` that can be read and updated atomically by multiple threads, for example a counter
+shared between tasks. All operations are sequentially consistent.
+-/
+def AtomicUInt64 : Type := AtomicUInt64Impl.type
+
+instance : Nonempty AtomicUInt64 := AtomicUInt64Impl.property
+
+namespace AtomicUInt64
+
+/-- Creates a new `AtomicUInt64` with value `v`. -/
+@[extern "lean_io_atomic_uint64_new"]
+opaque new (v : UInt64 := 0) : BaseIO AtomicUInt64
+
+/-- Reads the current value. -/
+@[extern "lean_io_atomic_uint64_load"]
+opaque load (a : @& AtomicUInt64) : BaseIO UInt64
+
+/-- Replaces the current value with `v`. -/
+@[extern "lean_io_atomic_uint64_store"]
+opaque store (a : @& AtomicUInt64) (v : UInt64) : BaseIO Unit
+
+/-- Replaces the current value with `v` and returns the previous value. -/
+@[extern "lean_io_atomic_uint64_swap"]
+opaque swap (a : @& AtomicUInt64) (v : UInt64) : BaseIO UInt64
+
+/-- Adds `v` to the current value, wrapping around on overflow, and returns the previous value. -/
+@[extern "lean_io_atomic_uint64_fetch_add"]
+opaque fetchAdd (a : @& AtomicUInt64) (v : UInt64) : BaseIO UInt64
+
+/--
+Subtracts `v` from the current value, wrapping around on underflow, and returns the previous
+value.
+-/
+@[extern "lean_io_atomic_uint64_fetch_sub"]
+opaque fetchSub (a : @& AtomicUInt64) (v : UInt64) : BaseIO UInt64
+
+/--
+Replaces the current value with `desired` if it is equal to `expected`. Returns whether the value
+was replaced.
+-/
+@[extern "lean_io_atomic_uint64_compare_and_swap"]
+opaque compareAndSwap (a : @& AtomicUInt64) (expected desired : UInt64) : BaseIO Bool
+
+end AtomicUInt64
+
+end Std
@@ -5,60 +5,65 @@ Authors: Gabriel Ebner
 -/
 prelude
 import Init.System.Promise
-import Init.Data.Queue
-import Std.Sync.Mutex
 
 namespace Std
 
-/--
-Internal state of an `Channel`.
-
-We maintain the invariant that at all times either `consumers` or `values` is empty.
--/
-structure Channel.State (α : Type) where
-  values : Std.Queue α := ∅
-  consumers : Std.Queue (IO.Promise (Option α)) := ∅
-  closed := false
-  deriving Inhabited
+private opaque ChannelImpl : NonemptyType.{0}
 
 /--
 FIFO channel with unbounded buffer, where `recv?` returns a `Task`.
 
 A channel can be closed.  Once it is closed, all `send`s are ignored, and
 `recv?` returns `none` once the queue is empty.
+
+The channel is implemented natively by a lock-free ring buffer, so multiple producers and consumers
+can use it concurrently without contending on a mutex. A lock is only taken when the ring buffer
+overflows or a consumer has to wait for a message.
 -/
-def Channel (α : Type) : Type := Mutex (Channel.State α)
+def Channel (_α : Type) : Type := ChannelImpl.type
 
-instance : Nonempty (Channel α) :=
-  inferInstanceAs (Nonempty (Mutex _))
+instance : Nonempty (Channel α) := ChannelImpl.property
+
+@[extern "lean_io_channel_new"]
+private opaque Channel.newCore (capacity : USize) (bounded : Bool) : BaseIO (Channel α)
 
 /-- Creates a new `Channel`. -/
 def Channel.new : BaseIO (Channel α) :=
-  Mutex.new {}
+  Channel.newCore 0 false
+
+/--
+Creates a new `Channel` that buffers at most `capacity` messages for `trySend`.
+
+`send` does not block and hence ignores the capacity.
+-/
+def Channel.newBounded (capacity : Nat) (_ : 0 < capacity := by decide) : BaseIO (Channel α) :=
+  Channel.newCore capacity.toUSize true
 
 /--
 Sends a message on an `Channel`.
 
 This function does not block.
 -/
-def Channel.send (ch : Channel α) (v : α) : BaseIO Unit :=
-  ch.atomically do
-    let st ← get
-    if st.closed then return
-    if let some (consumer, consumers) := st.consumers.dequeue? then
-      consumer.resolve (some v)
-      set { st with consumers }
-    else
-      set { st with values := st.values.enqueue v }
+@[extern "lean_io_channel_send"]
+opaque Channel.send (ch : @& Channel α) (v : α) : BaseIO Unit
+
+/--
+Sends a message on an `Channel` unless the channel is closed or is bounded and currently holds
+`capacity` messages. Returns whether the message was sent.
+
+This function does not block.
+-/
+@[extern "lean_io_channel_try_send"]
+opaque Channel.trySend (ch : @& Channel α) (v : α) : BaseIO Bool
 
 /--
 Closes an `Channel`.
 -/
-def Channel.close (ch : Channel α) : BaseIO Unit :=
-  ch.atomically do
-    let st ← get
-    for consumer in st.consumers.toArray do consumer.resolve none
-    set { st with closed := true, consumers := ∅ }
+@[extern "lean_io_channel_close"]
+opaque Channel.close (ch : @& Channel α) : BaseIO Unit
+
+@[extern "lean_io_channel_recv"]
+private opaque Channel.recvCore (ch : @& Channel α) : BaseIO (Option α ⊕ IO.Promise (Option α))
 
 /--
 Receives a message, without blocking.
@@ -67,18 +72,10 @@ Every message is only received once.
 
 Returns `none` if the channel is closed and the queue is empty.
 -/
-def Channel.recv? (ch : Channel α) : BaseIO (Task (Option α)) :=
-  ch.atomically do
-    let st ← get
-    if let some (a, values) := st.values.dequeue? then
-      set { st with values }
-      return .pure a
-    else if !st.closed then
-      let promise ← IO.Promise.new
-      set { st with consumers := st.consumers.enqueue promise }
-      return promise.result?.map (sync := true) (·.bind id)
-    else
-      return .pure none
+def Channel.recv? (ch : Channel α) : BaseIO (Task (Option α)) := do
+  match ← ch.recvCore with
+  | .inl a => return .pure a
+  | .inr promise => return promise.result?.map (sync := true) (·.bind id)
 
 /--
 `ch.forAsync f` calls `f` for every messages received on `ch`.
@@ -96,9 +93,8 @@ Receives all currently queued messages from the channel.
 
 Those messages are dequeued and will not be returned by `recv?`.
 -/
-def Channel.recvAllCurrent (ch : Channel α) : BaseIO (Array α) :=
-  ch.atomically do
-    modifyGet fun st => (st.values.toArray, { st with values := ∅ })
+@[extern "lean_io_channel_recv_all_current"]
+opaque Channel.recvAllCurrent (ch : @& Channel α) : BaseIO (Array α)
 
 /-- Type tag for synchronous (blocking) operations on a `Channel`. -/
 def Channel.Sync := Channel
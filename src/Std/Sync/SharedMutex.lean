@@ -0,0 +1,111 @@
+/-
+Copyright (c) 2025 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+-/
+prelude
+import Std.Sync.Mutex
+
+namespace Std
+
+private opaque BaseSharedMutexImpl : NonemptyType.{0}
+
+/--
+Reader-writer lock. It can either be locked exclusively by a single writer or be shared by any
+number of readers.
+
+If you want to guard shared state, use `SharedMutex α` instead.
+-/
+def BaseSharedMutex : Type := BaseSharedMutexImpl.type
+
+instance : Nonempty BaseSharedMutex := BaseSharedMutexImpl.property
+
+/-- Creates a new `BaseSharedMutex`. -/
+@[extern "lean_io_basesharedmutex_new"]
+opaque BaseSharedMutex.new : BaseIO BaseSharedMutex
+
+/--
+Locks a `BaseSharedMutex` exclusively. Waits until no other thread holds the lock, exclusively or
+shared.
+
+The current thread must not already hold the lock.
+-/
+@[extern "lean_io_basesharedmutex_lock"]
+opaque BaseSharedMutex.lock (mutex : @& BaseSharedMutex) : BaseIO Unit
+
+/--
+Tries to lock a `BaseSharedMutex` exclusively without waiting. Returns whether it succeeded.
+-/
+@[extern "lean_io_basesharedmutex_try_lock"]
+opaque BaseSharedMutex.tryLock (mutex : @& BaseSharedMutex) : BaseIO Bool
+
+/--
+Unlocks an exclusively locked `BaseSharedMutex`.
+
+The current thread must hold the lock exclusively.
+-/
+@[extern "lean_io_basesharedmutex_unlock"]
+opaque BaseSharedMutex.unlock (mutex : @& BaseSharedMutex) : BaseIO Unit
+
+/--
+Locks a `BaseSharedMutex` for reading. Waits until no other thread holds the lock exclusively.
+
+The current thread must not already hold the lock.
+-/
+@[extern "lean_io_basesharedmutex_lock_shared"]
+opaque BaseSharedMutex.lockShared (mutex : @& BaseSharedMutex) : BaseIO Unit
+
+/--
+Tries to lock a `BaseSharedMutex` for reading without waiting. Returns whether it succeeded.
+-/
+@[extern "lean_io_basesharedmutex_try_lock_shared"]
+opaque BaseSharedMutex.tryLockShared (mutex : @& BaseSharedMutex) : BaseIO Bool
+
+/--
+Unlocks a `BaseSharedMutex` that was locked for reading.
+
+The current thread must hold the lock for reading.
+-/
+@[extern "lean_io_basesharedmutex_unlock_shared"]
+opaque BaseSharedMutex.unlockShared (mutex : @& BaseSharedMutex) : BaseIO Unit
+
+/--
+Reader-writer lock guarding shared state of type `α`. Any number of readers can access the state
+at the same time through `atomicallyRead`, while `atomically` gives a single writer exclusive
+access. This is preferable to `Mutex α` for state that is read much more often than written.
+-/
+structure SharedMutex (α : Type) where private mk ::
+  private ref : IO.Ref α
+  mutex : BaseSharedMutex
+  deriving Nonempty
+
+instance : CoeOut (SharedMutex α) BaseSharedMutex where coe := SharedMutex.mutex
+
+/-- Creates a new shared mutex. -/
+def SharedMutex.new (a : α) : BaseIO (SharedMutex α) :=
+  return { ref := ← IO.mkRef a, mutex := ← BaseSharedMutex.new }
+
+/--
+`mutex.atomically k` runs `k` with access to the mutex's state while holding the lock
+exclusively.
+-/
+def SharedMutex.atomically [Monad m] [MonadLiftT BaseIO m] [MonadFinally m]
+    (mutex : SharedMutex α) (k : AtomicT α m β) : m β := do
+  try
+    mutex.mutex.lock
+    k mutex.ref
+  finally
+    mutex.mutex.unlock
+
+/--
+`mutex.atomicallyRead k` runs `k` with read access to the mutex's state while holding the lock for
+reading. Other readers may run at the same time.
+-/
+def SharedMutex.atomicallyRead [Monad m] [MonadLiftT BaseIO m] [MonadFinally m]
+    (mutex : SharedMutex α) (k : ReaderT α m β) : m β := do
+  try
+    mutex.mutex.lockShared
+    k.run (← mutex.ref.get)
+  finally
+    mutex.mutex.unlockShared
+
+end Std
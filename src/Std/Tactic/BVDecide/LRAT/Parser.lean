@@ -291,9 +291,20 @@ def loadLRATProof (path : System.FilePath) : IO (Array IntAction) := do
   | .ok actions => return actions
   | .error err => throw <| .userError err
 
+/--
+Native implementation of `parseLRATProof` in `runtime/lrat.cpp`. It only builds the resulting
+actions once the whole proof has been parsed into flat arrays of literals and ids.
+
+Using it when checking certificates by `ofReduceBool` does not affect soundness: `verifyCert_correct`
+holds for any parser, as the resulting actions are checked against the CNF by `LRAT.check`.
+-/
+@[extern "lean_lrat_parse_proof"]
+private opaque parseLRATProofNative (proof : @& ByteArray) : Except String (Array IntAction)
+
 /--
 Parse `proof` as an LRAT proof. `proof` may contain either the binary or the non-binary LRAT format.
 -/
+@[implemented_by parseLRATProofNative]
 def parseLRATProof (proof : ByteArray) : Except String (Array IntAction) :=
   Parser.parseActions.run proof
 
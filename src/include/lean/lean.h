@@ -52,6 +52,17 @@ extern "C" {
 #define LEAN_ALWAYS_INLINE
 #endif
 
+/* Guaranteed tail calls, emitted for tail calls between functions of a module that have the same
+   signature. Only enabled on targets where compilers supporting the attribute implement it. */
+#if defined(__has_attribute) && (defined(__x86_64__) || defined(__aarch64__))
+#if __has_attribute(musttail)
+#define LEAN_MUSTTAIL __attribute__((musttail))
+#endif
+#endif
+#ifndef LEAN_MUSTTAIL
+#define LEAN_MUSTTAIL
+#endif
+
 #ifndef assert
 #ifdef NDEBUG
 #define assert(expr)
@@ -528,6 +539,25 @@ static inline bool lean_is_shared(lean_object * o) {
 LEAN_EXPORT void lean_mark_mt(lean_object * o);
 LEAN_EXPORT void lean_mark_persistent(lean_object * o);
 
+/* Closed terms of modules compiled with `compiler.lazyClosedTerms` are stored in cells that are
+   filled with the persistent result of `init` on first access. */
+LEAN_EXPORT lean_object * lean_init_lazy_closed_term(_Atomic(lean_object *) * cell, lean_object * (*init)(void));
+
+static inline lean_object * lean_get_lazy_closed_term(_Atomic(lean_object *) * cell, lean_object * (*init)(void)) {
+    lean_object * v = *cell;
+    if (LEAN_LIKELY(v != NULL))
+        return v;
+    return lean_init_lazy_closed_term(cell, init);
+}
+
+/* Entry of the table of native symbols emitted for modules compiled with `compiler.symbolTable`,
+   terminated by `{NULL, NULL}`. The address of a nullary declaration is the one of the variable
+   holding its value. */
+typedef struct {
+    char const * m_name;
+    void *       m_addr;
+} lean_native_symbol;
+
 static inline void lean_set_st_header(lean_object * o, unsigned tag, unsigned other) {
     o->m_rc       = 1;
     o->m_tag      = tag;
@@ -576,6 +606,15 @@ static inline lean_object * lean_alloc_ctor(unsigned tag, unsigned num_objs, uns
     return o;
 }
 
+/* Initialize the constructor object stored in `mem` in the stack frame of a function it does not
+   escape, see `compiler.stackCtors`. Like persistent objects, it is not reference counted. */
+static inline lean_object * lean_stack_ctor_init(void * mem, unsigned tag, unsigned num_objs, unsigned scalar_sz) {
+    assert(tag <= LeanMaxCtorTag && num_objs < LEAN_MAX_CTOR_FIELDS && scalar_sz < LEAN_MAX_CTOR_SCALARS_SIZE);
+    lean_object * o = (lean_object *)mem;
+    lean_set_non_heap_header(o, sizeof(lean_ctor_object) + sizeof(void*)*num_objs + scalar_sz, tag, num_objs);
+    return o;
+}
+
 static inline b_lean_obj_res lean_ctor_get(b_lean_obj_arg o, unsigned i) {
     assert(i < lean_ctor_num_objs(o));
     return lean_ctor_obj_cptr(o)[i];
@@ -598,6 +637,13 @@ static inline void lean_ctor_release(b_lean_obj_arg o, unsigned i) {
     objs[i] = lean_box(0);
 }
 
+/* Release the fields of a stack constructor object where a heap object would be `lean_dec`ed. */
+static inline void lean_stack_ctor_release(b_lean_obj_arg o) {
+    lean_object ** objs = lean_ctor_obj_cptr(o);
+    for (unsigned i = 0; i < lean_ctor_num_objs(o); i++)
+        lean_dec(objs[i]);
+}
+
 static inline size_t lean_ctor_get_usize(b_lean_obj_arg o, unsigned i) {
     assert(i >= lean_ctor_num_objs(o));
     return *((size_t*)(lean_ctor_obj_cptr(o) + i));
@@ -867,6 +913,7 @@ static inline lean_object * lean_array_swap(lean_obj_arg a, b_lean_obj_arg i, b_
 
 LEAN_EXPORT lean_object * lean_array_push(lean_obj_arg a, lean_obj_arg v);
 LEAN_EXPORT lean_object * lean_mk_array(lean_obj_arg n, lean_obj_arg v);
+LEAN_EXPORT lean_obj_res lean_array_extract(lean_obj_arg a, b_lean_obj_arg start, b_lean_obj_arg stop);
 
 /* Array of scalars */
 
@@ -931,6 +978,8 @@ static inline uint8_t lean_byte_array_fget(b_lean_obj_arg a, b_lean_obj_arg i) {
 }
 
 LEAN_EXPORT lean_obj_res lean_byte_array_push(lean_obj_arg a, uint8_t b);
+LEAN_EXPORT lean_obj_res lean_byte_array_index_of(b_lean_obj_arg a, uint8_t b, b_lean_obj_arg start);
+LEAN_EXPORT lean_obj_res lean_byte_array_sort(lean_obj_arg a);
 
 static inline lean_object * lean_byte_array_uset(lean_obj_arg a, size_t i, uint8_t v) {
     lean_obj_res r;
@@ -941,6 +990,18 @@ static inline lean_object * lean_byte_array_uset(lean_obj_arg a, size_t i, uint8
     return r;
 }
 
+/* `lean_byte_array_uset` and `lean_byte_array_fset` for arrays known to be exclusive, see
+   `compiler.exclusiveLoops`. */
+static inline lean_obj_res lean_byte_array_uset_exclusive(lean_obj_arg a, size_t i, uint8_t v) {
+    assert(lean_is_exclusive(a));
+    lean_sarray_cptr(a)[i] = v;
+    return a;
+}
+
+static inline lean_obj_res lean_byte_array_fset_exclusive(lean_obj_arg a, b_lean_obj_arg i, uint8_t v) {
+    return lean_byte_array_uset_exclusive(a, lean_unbox(i), v);
+}
+
 static inline lean_obj_res lean_byte_array_set(lean_obj_arg a, b_lean_obj_arg i, uint8_t b) {
     if (!lean_is_scalar(i)) {
         return a;
@@ -996,6 +1057,7 @@ static inline double lean_float_array_get(b_lean_obj_arg a, b_lean_obj_arg i) {
 }
 
 LEAN_EXPORT lean_obj_res lean_float_array_push(lean_obj_arg a, double d);
+LEAN_EXPORT double lean_float_array_sum(b_lean_obj_arg a);
 
 static inline lean_obj_res lean_float_array_uset(lean_obj_arg a, size_t i, double d) {
     lean_obj_res r;
@@ -1010,6 +1072,18 @@ static inline lean_obj_res lean_float_array_fset(lean_obj_arg a, b_lean_obj_arg
     return lean_float_array_uset(a, lean_unbox(i), d);
 }
 
+/* `lean_float_array_uset` and `lean_float_array_fset` for arrays known to be exclusive, see
+   `compiler.exclusiveLoops`. */
+static inline lean_obj_res lean_float_array_uset_exclusive(lean_obj_arg a, size_t i, double d) {
+    assert(lean_is_exclusive(a));
+    lean_float_array_cptr(a)[i] = d;
+    return a;
+}
+
+static inline lean_obj_res lean_float_array_fset_exclusive(lean_obj_arg a, b_lean_obj_arg i, double d) {
+    return lean_float_array_uset_exclusive(a, lean_unbox(i), d);
+}
+
 static inline lean_obj_res lean_float_array_set(lean_obj_arg a, b_lean_obj_arg i, double d) {
     if (!lean_is_scalar(i)) {
         return a;
@@ -1023,6 +1097,71 @@ static inline lean_obj_res lean_float_array_set(lean_obj_arg a, b_lean_obj_arg i
     }
 }
 
+/* UInt64Array (special case of Array of Scalars) */
+
+LEAN_EXPORT lean_obj_res lean_uint64_array_mk(lean_obj_arg a);
+LEAN_EXPORT lean_obj_res lean_uint64_array_data(lean_obj_arg a);
+LEAN_EXPORT lean_obj_res lean_copy_uint64_array(lean_obj_arg a);
+
+static inline lean_obj_res lean_mk_empty_uint64_array(b_lean_obj_arg capacity) {
+    if (!lean_is_scalar(capacity)) lean_internal_panic_out_of_memory();
+    return lean_alloc_sarray(sizeof(uint64_t), 0, lean_unbox(capacity)); // NOLINT
+}
+
+static inline lean_obj_res lean_uint64_array_size(b_lean_obj_arg a) {
+    return lean_box(lean_sarray_size(a));
+}
+
+static inline uint64_t * lean_uint64_array_cptr(b_lean_obj_arg a) {
+    return (uint64_t*)(lean_sarray_cptr(a)); // NOLINT
+}
+
+static inline uint64_t lean_uint64_array_uget(b_lean_obj_arg a, size_t i) {
+    return lean_uint64_array_cptr(a)[i];
+}
+
+static inline uint64_t lean_uint64_array_fget(b_lean_obj_arg a, b_lean_obj_arg i) {
+    return lean_uint64_array_uget(a, lean_unbox(i));
+}
+
+static inline uint64_t lean_uint64_array_get(b_lean_obj_arg a, b_lean_obj_arg i) {
+    if (lean_is_scalar(i)) {
+        size_t idx = lean_unbox(i);
+        return idx < lean_sarray_size(a) ? lean_uint64_array_uget(a, idx) : 0;
+    } else {
+        /* The index must be out of bounds. Otherwise we would be out of memory. */
+        return 0;
+    }
+}
+
+LEAN_EXPORT lean_obj_res lean_uint64_array_push(lean_obj_arg a, uint64_t v);
+
+static inline lean_obj_res lean_uint64_array_uset(lean_obj_arg a, size_t i, uint64_t v) {
+    lean_obj_res r;
+    if (lean_is_exclusive(a)) r = a;
+    else r = lean_copy_uint64_array(a);
+    uint64_t * it = lean_uint64_array_cptr(r) + i;
+    *it = v;
+    return r;
+}
+
+static inline lean_obj_res lean_uint64_array_fset(lean_obj_arg a, b_lean_obj_arg i, uint64_t v) {
+    return lean_uint64_array_uset(a, lean_unbox(i), v);
+}
+
+static inline lean_obj_res lean_uint64_array_set(lean_obj_arg a, b_lean_obj_arg i, uint64_t v) {
+    if (!lean_is_scalar(i)) {
+        return a;
+    } else {
+        size_t idx = lean_unbox(i);
+        if (idx >= lean_sarray_size(a)) {
+            return a;
+        } else {
+            return lean_uint64_array_uset(a, idx, v);
+        }
+    }
+}
+
 /* Strings */
 
 static inline lean_obj_res lean_alloc_string(size_t size, size_t capacity, size_t len) {
@@ -1087,6 +1226,11 @@ static inline uint8_t lean_string_utf8_at_end(b_lean_obj_arg s, b_lean_obj_arg i
     return !lean_is_scalar(i) || lean_unbox(i) >= lean_string_size(s) - 1;
 }
 LEAN_EXPORT lean_obj_res lean_string_utf8_extract(b_lean_obj_arg s, b_lean_obj_arg b, b_lean_obj_arg e);
+LEAN_EXPORT lean_obj_res lean_string_pos_of_aux(b_lean_obj_arg s, uint32_t c, b_lean_obj_arg stop, b_lean_obj_arg i);
+LEAN_EXPORT lean_obj_res lean_json_next_special_byte(b_lean_obj_arg s, b_lean_obj_arg i);
+LEAN_EXPORT lean_obj_res lean_parser_ascii_id_rest_end(b_lean_obj_arg s, b_lean_obj_arg i);
+LEAN_EXPORT lean_obj_res lean_parser_ascii_blank_end(b_lean_obj_arg s, b_lean_obj_arg i);
+LEAN_EXPORT lean_obj_res lean_parser_next_comment_delim_byte(b_lean_obj_arg s, b_lean_obj_arg i);
 static inline lean_obj_res lean_string_utf8_byte_size(b_lean_obj_arg s) { return lean_box(lean_string_size(s) - 1); }
 LEAN_EXPORT bool lean_string_eq_cold(b_lean_obj_arg s1, b_lean_obj_arg s2);
 static inline bool lean_string_eq(b_lean_obj_arg s1, b_lean_obj_arg s2) {
@@ -1098,6 +1242,7 @@ static inline uint8_t lean_string_dec_eq(b_lean_obj_arg s1, b_lean_obj_arg s2) {
 static inline uint8_t lean_string_dec_lt(b_lean_obj_arg s1, b_lean_obj_arg s2) { return lean_string_lt(s1, s2); }
 LEAN_EXPORT uint64_t lean_string_hash(b_lean_obj_arg);
 LEAN_EXPORT lean_obj_res lean_string_of_usize(size_t);
+LEAN_EXPORT lean_obj_res lean_nat_big_repr(b_lean_obj_arg n);
 
 /* Thunks */
 
@@ -2662,43 +2807,116 @@ static inline unsigned lean_unbox_uint32(b_lean_obj_arg o) {
     }
 }
 
+/* With `LEAN_INLINE_BOXED_SCALARS` on 64-bit machines, boxed 64-bit scalars are stored in scalar
+   objects if they fit and only allocated otherwise. Unboxing accepts both representations, so
+   objects boxed by code compiled without the flag, e.g. in .olean files, can still be read, but
+   not vice versa: all code of a program must agree on the flag. */
+
 static inline lean_obj_res lean_box_uint64(uint64_t v) {
+#ifdef LEAN_INLINE_BOXED_SCALARS
+    if (sizeof(void*) == 8 && v <= LEAN_MAX_SMALL_NAT)
+        return lean_box(v);
+#endif
     lean_obj_res r = lean_alloc_ctor(0, 0, sizeof(uint64_t));
     lean_ctor_set_uint64(r, 0, v);
     return r;
 }
 
 static inline uint64_t lean_unbox_uint64(b_lean_obj_arg o) {
+#ifdef LEAN_INLINE_BOXED_SCALARS
+    if (lean_is_scalar(o))
+        return lean_unbox(o);
+#endif
     return lean_ctor_get_uint64(o, 0);
 }
 
 static inline lean_obj_res lean_box_usize(size_t v) {
+#ifdef LEAN_INLINE_BOXED_SCALARS
+    if (v <= LEAN_MAX_SMALL_NAT)
+        return lean_box(v);
+#endif
     lean_obj_res r = lean_alloc_ctor(0, 0, sizeof(size_t));
     lean_ctor_set_usize(r, 0, v);
     return r;
 }
 
 static inline size_t lean_unbox_usize(b_lean_obj_arg o) {
+#ifdef LEAN_INLINE_BOXED_SCALARS
+    if (lean_is_scalar(o))
+        return lean_unbox(o);
+#endif
     return lean_ctor_get_usize(o, 0);
 }
 
+#ifdef LEAN_INLINE_BOXED_SCALARS
+/* A double fits into the 63 bits of a scalar object if the two most significant bits of its
+   exponent differ, which holds for magnitudes between 2^-511 and 2^512: the second bit is then
+   implied by the first and is dropped. The payload 0, which would be 2^-511, is used for `0.0`
+   instead. */
+#define LEAN_FLOAT_EXP_BIT (1ull << 61)
+
+static inline uint64_t lean_inline_float_to_bits(double v) {
+    union { double d; uint64_t u; } c;
+    c.d = v;
+    return c.u;
+}
+
+static inline double lean_inline_float_of_bits(uint64_t u) {
+    union { double d; uint64_t u; } c;
+    c.u = u;
+    return c.d;
+}
+#endif
+
 static inline lean_obj_res lean_box_float(double v) {
+#ifdef LEAN_INLINE_BOXED_SCALARS
+    if (sizeof(void*) == 8) {
+        uint64_t b = lean_inline_float_to_bits(v);
+        if (b == 0)
+            return lean_box(0);
+        if ((((b >> 62) ^ (b >> 61)) & 1) && b != LEAN_FLOAT_EXP_BIT)
+            return lean_box(((b >> 1) & (3ull << 61)) | (b & (LEAN_FLOAT_EXP_BIT - 1)));
+    }
+#endif
     lean_obj_res r = lean_alloc_ctor(0, 0, sizeof(double)); // NOLINT
     lean_ctor_set_float(r, 0, v);
     return r;
 }
 
 static inline double lean_unbox_float(b_lean_obj_arg o) {
+#ifdef LEAN_INLINE_BOXED_SCALARS
+    if (lean_is_scalar(o)) {
+        uint64_t p = lean_unbox(o);
+        if (p == 0)
+            return 0.0;
+        uint64_t implied = (~p & (1ull << 61)) ? LEAN_FLOAT_EXP_BIT : 0;
+        return lean_inline_float_of_bits(((p & (3ull << 61)) << 1) | implied | (p & (LEAN_FLOAT_EXP_BIT - 1)));
+    }
+#endif
     return lean_ctor_get_float(o, 0);
 }
 
 static inline lean_obj_res lean_box_float32(float v) {
+#ifdef LEAN_INLINE_BOXED_SCALARS
+    if (sizeof(void*) == 8) {
+        union { float f; uint32_t u; } c;
+        c.f = v;
+        return lean_box(c.u);
+    }
+#endif
     lean_obj_res r = lean_alloc_ctor(0, 0, sizeof(float)); // NOLINT
     lean_ctor_set_float32(r, 0, v);
     return r;
 }
 
 static inline float lean_unbox_float32(b_lean_obj_arg o) {
+#ifdef LEAN_INLINE_BOXED_SCALARS
+    if (lean_is_scalar(o)) {
+        union { float f; uint32_t u; } c;
+        c.u = (uint32_t)lean_unbox(o);
+        return c.f;
+    }
+#endif
     return lean_ctor_get_float32(o, 0);
 }
 
@@ -8,17 +8,50 @@ Author: Leonardo de Moura
 #include <utility>
 #include <vector>
 #include "kernel/abstract.h"
+#include "util/name_hash_map.h"
 #include "kernel/replace_fn.h"
 
 namespace lean {
+/* For substitutions with more variables, `abstract` looks up variables in a hash table instead of
+   scanning the substitution at every occurrence. */
+#define LEAN_ABSTRACT_MAX_LINEAR_SCAN 8
+
+/* Position of the last occurrence of each variable name in a substitution. */
+class abstract_index {
+    name_hash_map<unsigned> m_fvars;
+    name_hash_map<unsigned> m_mvars;
+public:
+    void add_fvar(name const & n, unsigned i) { m_fvars[n] = i; }
+    void add_mvar(name const & n, unsigned i) { m_mvars[n] = i; }
+    optional<unsigned> find_fvar(name const & n) const {
+        auto it = m_fvars.find(n);
+        return it == m_fvars.end() ? optional<unsigned>() : optional<unsigned>(it->second);
+    }
+    optional<unsigned> find_mvar(name const & n) const {
+        auto it = m_mvars.find(n);
+        return it == m_mvars.end() ? optional<unsigned>() : optional<unsigned>(it->second);
+    }
+};
+
 expr abstract(expr const & e, unsigned n, expr const * subst) {
     lean_assert(std::all_of(subst, subst+n, [](expr const & e) { return !has_loose_bvars(e) && is_fvar(e); }));
     if (!has_fvar(e))
         return e;
-    return replace(e, [=](expr const & m, unsigned offset) -> optional<expr> {
+    abstract_index index;
+    bool use_index = n > LEAN_ABSTRACT_MAX_LINEAR_SCAN;
+    if (use_index) {
+        for (unsigned i = 0; i < n; i++)
+            index.add_fvar(fvar_name(subst[i]), i);
+    }
+    return replace(e, [&](expr const & m, unsigned offset) -> optional<expr> {
             if (!has_fvar(m))
                 return some_expr(m); // expression m does not contain free variables
             if (is_fvar(m)) {
+                if (use_index) {
+                    if (optional<unsigned> i = index.find_fvar(fvar_name(m)))
+                        return some_expr(mk_bvar(offset + n - *i - 1));
+                    return none_expr();
+                }
                 unsigned i = n;
                 while (i > 0) {
                     --i;
@@ -43,12 +76,29 @@ static object * lean_expr_abstract_core(object * e0, size_t n, object * subst) {
         lean_inc(e0);
         return e0;
     }
-    expr r = replace(e, [=](expr const & m, unsigned offset) -> optional<expr> {
+    abstract_index index;
+    bool use_index = n > LEAN_ABSTRACT_MAX_LINEAR_SCAN;
+    if (use_index) {
+        for (size_t i = 0; i < n; i++) {
+            object * v = lean_array_get_core(subst, i);
+            if (is_fvar_core(v))
+                index.add_fvar(fvar_name_core(v), i);
+            else if (is_mvar_core(v))
+                index.add_mvar(mvar_name_core(v), i);
+        }
+    }
+    expr r = replace(e, [&](expr const & m, unsigned offset) -> optional<expr> {
             if (!has_fvar(m) && !has_mvar(m))
                 return some_expr(m); // expression m does not contain free/meta variables
             bool fv = is_fvar(m);
             bool mv = is_mvar(m);
             if (fv || mv) {
+                if (use_index) {
+                    optional<unsigned> i = fv ? index.find_fvar(fvar_name(m)) : index.find_mvar(mvar_name(m));
+                    if (i)
+                        return some_expr(mk_bvar(offset + n - *i - 1));
+                    return none_expr();
+                }
                 size_t i = n;
                 while (i > 0) {
                     --i;
@@ -7,6 +7,8 @@ Author: Leonardo de Moura
 #include <utility>
 #include <vector>
 #include <limits>
+#include <atomic>
+#include <cstdlib>
 #include "runtime/sstream.h"
 #include "runtime/thread.h"
 #include "runtime/sharecommon.h"
@@ -157,6 +159,11 @@ environment environment::add_axiom(declaration const & d, bool check) const {
     return diag.update(add(constant_info(d)));
 }
 
+static std::atomic<bool> g_kernel_max_sharing(false);
+
+void set_kernel_max_sharing(bool f) { g_kernel_max_sharing = f; }
+bool get_kernel_max_sharing() { return g_kernel_max_sharing; }
+
 environment environment::add_definition(declaration const & d, bool check) const {
     scoped_diagnostics diag(*this, check);
     definition_val const & v = d.to_definition_val();
@@ -181,8 +188,15 @@ environment environment::add_definition(declaration const & d, bool check) const
             type_checker checker(*this, diag.get());
             check_constant_val(*this, v.to_constant_val(), checker);
             check_no_metavar_no_fvar(*this, v.get_name(), v.get_value());
-            expr val_type = checker.check(v.get_value(), v.get_lparams());
-            if (!checker.is_def_eq(val_type, v.get_type()))
+            expr val  = v.get_value();
+            expr type = v.get_type();
+            sharecommon_persistent_fn share;
+            if (get_kernel_max_sharing()) {
+                val  = expr(share(val.raw()));
+                type = expr(share(type.raw()));
+            }
+            expr val_type = checker.check(val, v.get_lparams());
+            if (!checker.is_def_eq(val_type, type))
                 throw definition_type_mismatch_exception(*this, d, val_type);
         }
         return diag.update(add(constant_info(d)));
@@ -214,8 +228,15 @@ environment environment::add_opaque(declaration const & d, bool check) const {
     if (check) {
         type_checker checker(*this, diag.get());
         check_constant_val(*this, v.to_constant_val(), checker);
-        expr val_type = checker.check(v.get_value(), v.get_lparams());
-        if (!checker.is_def_eq(val_type, v.get_type()))
+        expr val  = v.get_value();
+        expr type = v.get_type();
+        sharecommon_persistent_fn share;
+        if (get_kernel_max_sharing()) {
+            val  = expr(share(val.raw()));
+            type = expr(share(type.raw()));
+        }
+        expr val_type = checker.check(val, v.get_lparams());
+        if (!checker.is_def_eq(val_type, type))
             throw definition_type_mismatch_exception(*this, d, val_type);
     }
     return diag.update(add(constant_info(d)));
@@ -287,6 +308,119 @@ extern "C" LEAN_EXPORT object * lean_add_decl_without_checking(object * env, obj
         });
 }
 
+/* `cache` is a boxed `shared_kernel_cache *` owned by `lean_add_decls`, which waits for all tasks.
+   `prefix` is the number of declarations of the batch that `env` contains. */
+static obj_res add_decl_fn(obj_arg env, obj_arg decl, obj_arg max_heartbeat, obj_arg opt_cancel_tk, obj_arg cache,
+    obj_arg prefix, obj_arg) {
+    scope_shared_kernel_cache s(reinterpret_cast<shared_kernel_cache *>(lean_unbox_usize(cache)),
+        lean_unbox(prefix));
+    object * r = lean_add_decl(env, lean_unbox_usize(max_heartbeat), decl, opt_cancel_tk);
+    dec(cache);
+    dec(decl);
+    dec(max_heartbeat);
+    dec(opt_cancel_tk);
+    return r;
+}
+
+/*
+addDeclsCore (env : Environment) (maxHeartbeats : USize) (decls : @& Array Declaration)
+  (cancelTk? : @& Option IO.CancelToken) : Except Kernel.Exception Environment
+
+Declaration `i` is checked in the environment extended by declarations `0` to `i - 1` added
+without checking, so that a proof cannot refer to later declarations of the batch. The checks
+run in one task each; we then wait for them in order and return the first error, which
+makes error reporting independent of scheduling. If declaration `i` cannot even be added without
+checking, that error is reported unless an earlier check fails, and the later declarations are not
+checked. The tasks share a `shared_kernel_cache`, so that reductions of closed terms are not
+repeated for each declaration. Its entries are keyed on the index `i` of the environment they
+were computed in, so that a check never uses results that depend on later declarations of the
+batch. Inductive types and `Quot` are added synchronously since adding them without checking does
+the same work as checking them. When kernel diagnostics are enabled, all declarations are added
+sequentially so that no diagnostics are lost. */
+extern "C" LEAN_EXPORT object * lean_add_decls(object * env, size_t max_heartbeat, object * decls,
+    object * opt_cancel_tk) {
+    size_t n = array_size(decls);
+    bool diag_enabled;
+    {
+        scoped_diagnostics diag(environment(env, true), true);
+        diag_enabled = diag.get() != nullptr;
+    }
+    if (n == 0)
+        return mk_cnstr(1, object_ref(env)).steal();
+    if (diag_enabled) {
+        object * r = nullptr;
+        for (size_t i = 0; i < n; i++) {
+            r = lean_add_decl(env, max_heartbeat, array_get(decls, i), opt_cancel_tk);
+            if (cnstr_tag(r) == 0 || i + 1 == n)
+                return r;
+            env = cnstr_get(r, 0);
+            inc(env);
+            dec(r);
+        }
+        lean_unreachable();
+    }
+    shared_kernel_cache cache;
+    // each entry is either a task whose value is the result, or the result itself
+    buffer<object *> results;
+    buffer<bool> is_task;
+    for (size_t i = 0; i < n; i++) {
+        object * decl = array_get(decls, i);
+        declaration_kind k = declaration(decl, true).kind();
+        if (k == declaration_kind::Inductive || k == declaration_kind::Quot) {
+            object * r = lean_add_decl(env, max_heartbeat, decl, opt_cancel_tk);
+            results.push_back(r);
+            is_task.push_back(false);
+            if (cnstr_tag(r) == 0 || i + 1 == n)
+                break;
+            env = cnstr_get(r, 0);
+            inc(env);
+            continue;
+        }
+        object * c = lean_alloc_closure(reinterpret_cast<void *>(add_decl_fn), 7, 6);
+        inc(env);
+        inc(decl);
+        inc(opt_cancel_tk);
+        lean_closure_set(c, 0, env);
+        lean_closure_set(c, 1, decl);
+        lean_closure_set(c, 2, lean_box_usize(max_heartbeat));
+        lean_closure_set(c, 3, opt_cancel_tk);
+        lean_closure_set(c, 4, lean_box_usize(reinterpret_cast<size_t>(&cache)));
+        lean_closure_set(c, 5, lean_box(i));
+        results.push_back(lean_task_spawn_core(c, 0, false));
+        is_task.push_back(true);
+        if (i + 1 == n) {
+            dec(env);
+            break;
+        }
+        object * r = lean_add_decl_without_checking(env, decl);
+        if (cnstr_tag(r) == 0) {
+            // reported after the check of `decl`, which usually fails with the same error
+            results.push_back(r);
+            is_task.push_back(false);
+            break;
+        }
+        env = cnstr_get(r, 0);
+        inc(env);
+        dec(r);
+    }
+    object * result = nullptr;
+    for (size_t i = 0; i < results.size(); i++) {
+        object * r = results[i];
+        if (is_task[i]) {
+            r = lean_task_get(results[i]);
+            inc(r);
+            dec(results[i]);
+        }
+        if (result && cnstr_tag(result) == 0) {
+            dec(r);
+        } else {
+            if (result) dec(result);
+            result = r;
+        }
+    }
+    return result;
+}
+
 void environment::for_each_constant(std::function<void(constant_info const & d)> const & f) const {
     smap_foreach(cnstr_get(raw(), 1), [&](object *, object * v) {
             constant_info cinfo(v, true);
@@ -295,6 +429,8 @@ void environment::for_each_constant(std::function<void(constant_info const & d)>
 }
 
 void initialize_environment() {
+    if (std::getenv("LEAN_KERNEL_MAX_SHARING"))
+        set_kernel_max_sharing(true);
 }
 
 void finalize_environment() {
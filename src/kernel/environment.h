@@ -107,6 +107,13 @@ public:
 
 void check_no_metavar_no_fvar(environment const & env, name const & n, expr const & e);
 
+/** \brief When set, the values and types of definitions and opaque constants are maximally shared
+    before type checking them, as is always done for theorems. It is off by default since hash-consing
+    has a cost that only pays off for terms with a lot of duplication. The initial value is taken from
+    the `LEAN_KERNEL_MAX_SHARING` environment variable. */
+void set_kernel_max_sharing(bool f);
+bool get_kernel_max_sharing();
+
 void initialize_environment();
 void finalize_environment();
 }
@@ -23,7 +23,10 @@ auto equiv_manager::find(node_ref n) -> node_ref {
         node_ref p = m_nodes[n].m_parent;
         if (p == n)
             return p;
-        n = p;
+        // path halving
+        node_ref g = m_nodes[p].m_parent;
+        m_nodes[n].m_parent = g;
+        n = g;
     }
 }
 
@@ -17,9 +17,11 @@ class equiv_manager {
         unsigned m_rank;
     };
 
-    std::vector<node>  m_nodes;
-    expr_map<node_ref> m_to_node;
-    bool               m_use_hash;
+    std::vector<node>                    m_nodes;
+    /* Structurally equal terms with different pointers get different nodes that are merged by
+       `is_equiv_core`, so we only need pointer equality here. */
+    expr_flat_map<node_ref, true>        m_to_node;
+    bool                                 m_use_hash;
 
     node_ref mk_node();
     node_ref find(node_ref n);
@@ -30,5 +32,7 @@ public:
     equiv_manager():m_use_hash(false) {}
     bool is_equiv(expr const & e1, expr const & e2, bool use_hash = false);
     void add_equiv(expr const & e1, expr const & e2);
+    unsigned size() const { return m_nodes.size(); }
+    void clear() { m_nodes.clear(); m_to_node.clear(); }
 };
 }
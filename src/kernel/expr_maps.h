@@ -7,6 +7,8 @@ Author: Leonardo de Moura
 #pragma once
 #include <unordered_map>
 #include <functional>
+#include <vector>
+#include "util/pair.h"
 #include "kernel/expr.h"
 
 namespace lean {
@@ -17,6 +19,90 @@ using expr_map = typename std::unordered_map<expr, T, expr_hash, std::equal_to<e
 template<typename T>
 using expr_bi_map = typename std::unordered_map<expr, T, expr_hash, is_bi_equal_proc>;
 
+/* \brief Map based on structural equality using open addressing. Entries are stored contiguously
+   in insertion order and indexed by a linear-probing table of (hash, entry index) slots, so a
+   lookup compares stored hashes before touching any entry, and keys are compared by pointer
+   before falling back to structural equality. Entries are never removed.
+
+   If `PtrKeys` is true, keys are only compared by pointer, which is cheaper when structurally
+   equal keys are handled by the caller anyway (e.g., `equiv_manager`).
+
+   Only the subset of the `std::unordered_map` interface used by the kernel caches is provided.
+   Pointers returned by `find` are invalidated by `insert`. */
+template<typename T, bool PtrKeys = false>
+class expr_flat_map {
+public:
+    typedef pair<expr, T> value_type;
+    typedef value_type * iterator;
+private:
+    struct slot {
+        unsigned m_hash;
+        unsigned m_idx; // index into `m_entries` plus one, 0 if the slot is empty
+    };
+    std::vector<value_type> m_entries;
+    std::vector<slot>       m_slots; // size is zero or a power of two
+
+    unsigned find_slot(expr const & e, unsigned h) const {
+        unsigned mask = m_slots.size() - 1;
+        unsigned i    = h & mask;
+        while (true) {
+            slot const & s = m_slots[i];
+            if (s.m_idx == 0)
+                return i;
+            if (s.m_hash == h) {
+                expr const & k = m_entries[s.m_idx - 1].first;
+                if (is_eqp(k, e) || (!PtrKeys && k == e))
+                    return i;
+            }
+            i = (i + 1) & mask;
+        }
+    }
+
+    void grow() {
+        std::vector<slot> slots(m_slots.empty() ? 16 : 2 * m_slots.size(), slot{0, 0});
+        unsigned mask = slots.size() - 1;
+        for (slot const & s : m_slots) {
+            if (s.m_idx == 0)
+                continue;
+            unsigned i = s.m_hash & mask;
+            while (slots[i].m_idx != 0)
+                i = (i + 1) & mask;
+            slots[i] = s;
+        }
+        m_slots.swap(slots);
+    }
+public:
+    iterator end() const { return nullptr; }
+    size_t size() const { return m_entries.size(); }
+    bool empty() const { return m_entries.empty(); }
+
+    iterator find(expr const & e) const {
+        if (m_slots.empty())
+            return end();
+        unsigned idx = m_slots[find_slot(e, hash(e))].m_idx;
+        return idx == 0 ? end() : const_cast<iterator>(&m_entries[idx - 1]);
+    }
+
+    /* Insert `p` unless its key is already present, like `std::unordered_map::insert`. */
+    void insert(value_type const & p) {
+        // keep the load factor at most 1/2
+        if (2 * (m_entries.size() + 1) > m_slots.size())
+            grow();
+        unsigned h = hash(p.first);
+        slot & s = m_slots[find_slot(p.first, h)];
+        if (s.m_idx != 0)
+            return;
+        m_entries.push_back(p);
+        s.m_hash = h;
+        s.m_idx  = m_entries.size();
+    }
+
+    void clear() {
+        m_entries.clear();
+        m_slots.clear();
+    }
+};
+
 template<typename T>
 class expr_cond_bi_map : public std::unordered_map<expr, T, expr_hash, is_cond_bi_equal_proc> {
 public:
@@ -4,8 +4,17 @@ Released under Apache 2.0 license as described in the file LICENSE.
 
 Author: Leonardo de Moura
 */
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <functional>
+#include <exception>
 #include "runtime/sstream.h"
 #include "runtime/utf8.h"
+#include "runtime/interrupt.h"
+#include "runtime/memory.h"
+#include "runtime/thread.h"
+#include "util/name_hash_map.h"
 #include "util/name_generator.h"
 #include "kernel/environment.h"
 #include "kernel/type_checker.h"
@@ -15,6 +24,9 @@ Author: Leonardo de Moura
 #include "kernel/replace_fn.h"
 #include "kernel/kernel_exception.h"
 
+/* Minimum number of constructors for checking them and generating their recursor rules in parallel. */
+#define LEAN_INDUCTIVE_PAR_MIN_ITEMS 64
+
 namespace lean {
 static name * g_ind_fresh = nullptr;
 
@@ -110,10 +122,41 @@ expr expand_eta_struct(environment const & env, expr const & e_type, expr const
     return result;
 }
 
+/* Recursors with at least this many rules are indexed by `get_rec_rule_for`. */
+#define LEAN_REC_RULE_INDEX_MIN_RULES 16
+/* Maximum number of recursors indexed by each thread, the index is cleared when it is exceeded. */
+#define LEAN_REC_RULE_INDEX_MAX_RECS 1024
+
+/* Rules of a recursor indexed by constructor name. `m_rules` keeps the key alive, so that its address is not reused. */
+struct rec_rule_index {
+    recursor_rules               m_rules;
+    name_hash_map<recursor_rule> m_map;
+};
+typedef std::unordered_map<lean_object *, rec_rule_index> rec_rule_index_cache;
+MK_THREAD_LOCAL_GET_DEF(rec_rule_index_cache, get_rec_rule_index_cache);
+
 optional<recursor_rule> get_rec_rule_for(recursor_val const & rec_val, expr const & major) {
     expr const & fn = get_app_fn(major);
     if (!is_constant(fn)) return optional<recursor_rule>();
-    for (recursor_rule const & rule : rec_val.get_rules()) {
+    recursor_rules const & rules = rec_val.get_rules();
+    if (!is_nil(rules) && length(rules) >= LEAN_REC_RULE_INDEX_MIN_RULES) {
+        rec_rule_index_cache & cache = get_rec_rule_index_cache();
+        auto it = cache.find(rules.raw());
+        if (it == cache.end()) {
+            if (cache.size() >= LEAN_REC_RULE_INDEX_MAX_RECS)
+                cache.clear();
+            rec_rule_index & index = cache[rules.raw()];
+            index.m_rules = rules;
+            for (recursor_rule const & rule : rules)
+                index.m_map.insert(mk_pair(rule.get_cnstr(), rule));
+            it = cache.find(rules.raw());
+        }
+        auto r = it->second.m_map.find(const_name(fn));
+        if (r == it->second.m_map.end())
+            return optional<recursor_rule>();
+        return optional<recursor_rule>(r->second);
+    }
+    for (recursor_rule const & rule : rules) {
         if (rule.get_cnstr() == const_name(fn))
             return optional<recursor_rule>(rule);
     }
@@ -170,6 +213,117 @@ public:
 
     type_checker tc() { return type_checker(m_env, m_lctx, m_diag, m_is_unsafe ? definition_safety::unsafe : definition_safety::safe); }
 
+    /* Store the constructors of all inductive datatypes being declared, paired with the position of their datatype. */
+    void collect_cnstrs(buffer<pair<unsigned, constructor>> & cnstrs) const {
+        for (unsigned idx = 0; idx < m_ind_types.size(); idx++) {
+            for (constructor const & cnstr : m_ind_types[idx].get_cnstrs())
+                cnstrs.push_back(mk_pair(idx, cnstr));
+        }
+    }
+
+    /* Mark the objects reachable from this object as multi-threaded, so that copies can be used by other threads. */
+    void mark_fields_mt() {
+        mark_mt(m_env.raw());
+        mark_mt(m_lctx.raw());
+        mark_mt(m_lparams.raw());
+        mark_mt(m_result_level.raw());
+        mark_mt(m_levels.raw());
+        mark_mt(m_elim_level.raw());
+        for (inductive_type const & ind_type : m_ind_types) mark_mt(ind_type.raw());
+        for (expr const & e : m_params) mark_mt(e.raw());
+        for (expr const & e : m_ind_cnsts) mark_mt(e.raw());
+        for (rec_info const & info : m_rec_infos) {
+            mark_mt(info.m_C.raw());
+            mark_mt(info.m_major.raw());
+            for (expr const & e : info.m_minors) mark_mt(e.raw());
+            for (expr const & e : info.m_indices) mark_mt(e.raw());
+        }
+    }
+
+    /* The interruption settings of the thread calling `par_for`, which its tasks run with. */
+    struct par_settings {
+        size_t        m_max_heartbeat;
+        size_t        m_heartbeat;
+        lean_object * m_cancel_tk;
+    };
+
+    struct par_job {
+        std::unique_ptr<add_inductive_fn>                           m_fn;
+        unsigned                                                    m_idx;
+        par_settings const *                                        m_settings;
+        std::function<void(add_inductive_fn &, unsigned)> const *  m_run;
+        std::exception_ptr *                                        m_ex;
+        size_t                                                      m_heartbeats{0}; // used by the task
+        par_job(add_inductive_fn * fn, unsigned idx, par_settings const * settings,
+                std::function<void(add_inductive_fn &, unsigned)> const * run, std::exception_ptr * ex):
+            m_fn(fn), m_idx(idx), m_settings(settings), m_run(run), m_ex(ex) {}
+    };
+
+    /* Task body. `job` is a boxed pointer to a `par_job` owned by `par_for`. Each task starts from
+       the heartbeats the caller had used, so that it fails where the sequential check would fail
+       at the latest, and observes the caller's cancellation token. */
+    static obj_res run_par_job(obj_arg job, obj_arg) {
+        par_job * j = reinterpret_cast<par_job *>(lean_unbox_usize(job));
+        lean_dec(job);
+        scope_max_heartbeat s1(j->m_settings->m_max_heartbeat);
+        scope_heartbeat s2(j->m_settings->m_heartbeat);
+        scope_cancel_tk s3(j->m_settings->m_cancel_tk);
+        try {
+            (*j->m_run)(*j->m_fn, j->m_idx);
+        } catch (...) {
+            *j->m_ex = std::current_exception();
+        }
+        j->m_heartbeats = get_heartbeat() - j->m_settings->m_heartbeat;
+        return box(0);
+    }
+
+    /* Execute `run(fn, i)` for each `i < n`, storing the exception thrown by each call in `exs[i]`.
+
+       When there are at least `LEAN_INDUCTIVE_PAR_MIN_ITEMS` items, each call runs in its own task,
+       where `fn` is a copy of this object with its own name generator, so that the free variables
+       created by different tasks are distinct. Otherwise, or when collecting kernel diagnostics,
+       `fn` is this object and we stop at the first exception. `run` must only update `fn` and
+       the position `i` of its own results. */
+    template<typename F>
+    void par_for(unsigned n, F && run, std::vector<std::exception_ptr> & exs) {
+        exs.clear();
+        exs.resize(n);
+        if (m_diag || n < LEAN_INDUCTIVE_PAR_MIN_ITEMS) {
+            for (unsigned i = 0; i < n; i++) {
+                try {
+                    run(*this, i);
+                } catch (...) {
+                    exs[i] = std::current_exception();
+                    return;
+                }
+            }
+            return;
+        }
+        std::function<void(add_inductive_fn &, unsigned)> run_fn(run);
+        par_settings settings{get_max_heartbeat(), get_heartbeat(), get_cancel_tk()};
+        mark_fields_mt();
+        /* The token is queried by all tasks. */
+        if (settings.m_cancel_tk)
+            mark_mt(settings.m_cancel_tk);
+        std::vector<par_job> jobs;
+        jobs.reserve(n);
+        std::vector<object *> tasks;
+        for (unsigned i = 0; i < n; i++) {
+            jobs.emplace_back(new add_inductive_fn(*this), i, &settings, &run_fn, &exs[i]);
+            jobs.back().m_fn->m_ngen = m_ngen.mk_child();
+            object * c = lean_alloc_closure(reinterpret_cast<void *>(run_par_job), 2, 1);
+            lean_closure_set(c, 0, lean_box_usize(reinterpret_cast<size_t>(&jobs.back())));
+            tasks.push_back(lean_task_spawn_core(c, 0, false));
+        }
+        for (object * t : tasks) {
+            lean_task_get(t);
+            lean_dec(t);
+        }
+        /* The work of the tasks counts towards the heartbeat limit of the caller. */
+        for (par_job const & j : jobs)
+            add_heartbeat(j.m_heartbeats);
+    }
+
     /** Return type of the parameter at position `i` */
     expr get_param_type(unsigned i) const {
         return m_lctx.get_local_decl(m_params[i]).get_type();
@@ -407,48 +561,60 @@ public:
         }
     }
 
-    /** \brief Check whether the constructor declarations are type correct, parameters are in the expected positions,
-        constructor fields are in acceptable universe levels, positivity constraints, and returns the expected result. */
-    void check_constructors() {
-        for (unsigned idx = 0; idx < m_ind_types.size(); idx++) {
-            inductive_type const & ind_type = m_ind_types[idx];
-            name_set found_cnstrs;
-            for (constructor const & cnstr : ind_type.get_cnstrs()) {
-                name const & n = constructor_name(cnstr);
-                if (found_cnstrs.contains(n)) {
-                    throw kernel_exception(m_env, sstream() << "duplicate constructor name '" << n << "'");
-                }
-                found_cnstrs.insert(n);
-                expr t = constructor_type(cnstr);
-                m_env.check_name(n);
-                check_no_metavar_no_fvar(m_env, n, t);
-                tc().check(t, m_lparams);
-                unsigned i = 0;
-                while (is_pi(t)) {
-                    if (i < m_nparams) {
-                        if (!is_def_eq(binding_domain(t), get_param_type(i)))
-                            throw kernel_exception(m_env, sstream() << "arg #" << (i + 1) << " of '" << n << "' "
-                                                   << "does not match inductive datatypes parameters'");
-                        t = instantiate(binding_body(t), m_params[i]);
-                    } else {
-                        expr s = tc().ensure_type(binding_domain(t));
-                        // the sort is ok IF
-                        //   1- its level is <= inductive datatype level, OR
-                        //   2- is an inductive predicate
-                        if (!(is_geq(m_result_level, sort_level(s)) || is_zero(m_result_level))) {
-                            throw kernel_exception(m_env, sstream() << "universe level of type_of(arg #" << (i + 1) << ") "
-                                                   << "of '" << n << "' is too big for the corresponding inductive datatype");
-                        }
-                        if (!m_is_unsafe)
-                            check_positivity(binding_domain(t), n, i);
-                        expr local = mk_local_decl_for(t);
-                        t = instantiate(binding_body(t), local);
-                    }
-                    i++;
+    /** \brief Check whether the given constructor of the inductive datatype at position `idx` is type correct,
+        parameters are in the expected positions, its fields are in acceptable universe levels,
+        positivity constraints, and returns the expected result. */
+    void check_constructor(unsigned idx, constructor const & cnstr) {
+        name const & n = constructor_name(cnstr);
+        expr t = constructor_type(cnstr);
+        m_env.check_name(n);
+        check_no_metavar_no_fvar(m_env, n, t);
+        tc().check(t, m_lparams);
+        unsigned i = 0;
+        while (is_pi(t)) {
+            if (i < m_nparams) {
+                if (!is_def_eq(binding_domain(t), get_param_type(i)))
+                    throw kernel_exception(m_env, sstream() << "arg #" << (i + 1) << " of '" << n << "' "
+                                           << "does not match inductive datatypes parameters'");
+                t = instantiate(binding_body(t), m_params[i]);
+            } else {
+                expr s = tc().ensure_type(binding_domain(t));
+                // the sort is ok IF
+                //   1- its level is <= inductive datatype level, OR
+                //   2- is an inductive predicate
+                if (!(is_geq(m_result_level, sort_level(s)) || is_zero(m_result_level))) {
+                    throw kernel_exception(m_env, sstream() << "universe level of type_of(arg #" << (i + 1) << ") "
+                                           << "of '" << n << "' is too big for the corresponding inductive datatype");
                 }
-                if (!is_valid_ind_app(t, idx))
-                    throw kernel_exception(m_env, sstream() << "invalid return type for '" << n << "'");
+                if (!m_is_unsafe)
+                    check_positivity(binding_domain(t), n, i);
+                expr local = mk_local_decl_for(t);
+                t = instantiate(binding_body(t), local);
+            }
+            i++;
+        }
+        if (!is_valid_ind_app(t, idx))
+            throw kernel_exception(m_env, sstream() << "invalid return type for '" << n << "'");
+    }
+
+    /** \brief Check all constructor declarations (see `check_constructor`). The checks run in parallel (see `par_for`),
+        and their errors are reported in the same order as in a sequential check. */
+    void check_constructors() {
+        buffer<pair<unsigned, constructor>> cnstrs;
+        collect_cnstrs(cnstrs);
+        std::vector<std::exception_ptr> exs;
+        par_for(cnstrs.size(), [&](add_inductive_fn & fn, unsigned i) {
+                fn.check_constructor(cnstrs[i].first, cnstrs[i].second);
+            }, exs);
+        name_set found_cnstrs;
+        for (unsigned i = 0; i < cnstrs.size(); i++) {
+            name const & n = constructor_name(cnstrs[i].second);
+            if (found_cnstrs.contains(n)) {
+                throw kernel_exception(m_env, sstream() << "duplicate constructor name '" << n << "'");
             }
+            found_cnstrs.insert(n);
+            if (exs[i])
+                std::rethrow_exception(exs[i]);
         }
     }
 
@@ -700,50 +866,45 @@ public:
             ms.append(m_rec_infos[i].m_minors);
     }
 
-    recursor_rules mk_rec_rules(unsigned d_idx, buffer<expr> const & Cs, buffer<expr> const & minors, unsigned & minor_idx) {
-        inductive_type const & d = m_ind_types[d_idx];
+    /** \brief Return the recursor rule for the given constructor. `minor_idx` is the position of its minor premise. */
+    recursor_rule mk_rec_rule(constructor const & cnstr, buffer<expr> const & Cs, buffer<expr> const & minors, unsigned minor_idx) {
         levels lvls = get_rec_levels();
-        buffer<recursor_rule> rules;
-        for (constructor const & cnstr : d.get_cnstrs()) {
-            buffer<expr> b_u;
-            buffer<expr> u;
-            expr t = constructor_type(cnstr);
-            unsigned i = 0;
-            while (is_pi(t)) {
-                if (i < m_nparams) {
-                    t = instantiate(binding_body(t), m_params[i]);
-                } else {
-                    expr l = mk_local_decl_for(t);
-                    b_u.push_back(l);
-                    if (is_rec_argument(binding_domain(t)))
-                        u.push_back(l);
-                    t = instantiate(binding_body(t), l);
-                }
-                i++;
+        buffer<expr> b_u;
+        buffer<expr> u;
+        expr t = constructor_type(cnstr);
+        unsigned i = 0;
+        while (is_pi(t)) {
+            if (i < m_nparams) {
+                t = instantiate(binding_body(t), m_params[i]);
+            } else {
+                expr l = mk_local_decl_for(t);
+                b_u.push_back(l);
+                if (is_rec_argument(binding_domain(t)))
+                    u.push_back(l);
+                t = instantiate(binding_body(t), l);
             }
-            buffer<expr> v;
-            for (unsigned i = 0; i < u.size(); i++) {
-                expr u_i    = u[i];
-                expr u_i_ty = whnf(infer_type(u_i));
-                buffer<expr> xs;
-                while (is_pi(u_i_ty)) {
-                    expr x = mk_local_decl_for(u_i_ty);
-                    xs.push_back(x);
-                    u_i_ty = whnf(instantiate(binding_body(u_i_ty), x));
-                }
-                buffer<expr> it_indices;
-                unsigned it_idx = get_I_indices(u_i_ty, it_indices);
-                name rec_name   = mk_rec_name(m_ind_types[it_idx].get_name());
-                expr rec_app    = mk_constant(rec_name, lvls);
-                rec_app         = mk_app(mk_app(mk_app(mk_app(mk_app(rec_app, m_params), Cs), minors), it_indices), mk_app(u_i, xs));
-                v.push_back(mk_lambda(xs, rec_app));
+            i++;
+        }
+        buffer<expr> v;
+        for (unsigned i = 0; i < u.size(); i++) {
+            expr u_i    = u[i];
+            expr u_i_ty = whnf(infer_type(u_i));
+            buffer<expr> xs;
+            while (is_pi(u_i_ty)) {
+                expr x = mk_local_decl_for(u_i_ty);
+                xs.push_back(x);
+                u_i_ty = whnf(instantiate(binding_body(u_i_ty), x));
             }
-            expr e_app    = mk_app(mk_app(minors[minor_idx], b_u), v);
-            expr comp_rhs = mk_lambda(m_params, mk_lambda(Cs, mk_lambda(minors, mk_lambda(b_u, e_app))));
-            rules.push_back(recursor_rule(constructor_name(cnstr), b_u.size(), comp_rhs));
-            minor_idx++;
+            buffer<expr> it_indices;
+            unsigned it_idx = get_I_indices(u_i_ty, it_indices);
+            name rec_name   = mk_rec_name(m_ind_types[it_idx].get_name());
+            expr rec_app    = mk_constant(rec_name, lvls);
+            rec_app         = mk_app(mk_app(mk_app(mk_app(mk_app(rec_app, m_params), Cs), minors), it_indices), mk_app(u_i, xs));
+            v.push_back(mk_lambda(xs, rec_app));
         }
-        return recursor_rules(rules);
+        expr e_app    = mk_app(mk_app(minors[minor_idx], b_u), v);
+        expr comp_rhs = mk_lambda(m_params, mk_lambda(Cs, mk_lambda(minors, mk_lambda(b_u, e_app))));
+        return recursor_rule(constructor_name(cnstr), b_u.size(), comp_rhs);
     }
 
     /** \brief Declare recursors. */
@@ -753,6 +914,18 @@ public:
         unsigned nminors   = minors.size();
         unsigned nmotives  = Cs.size();
         names all          = get_all_inductive_names();
+        /* The minor premises are in the same order as the constructors. */
+        buffer<pair<unsigned, constructor>> cnstrs;
+        collect_cnstrs(cnstrs);
+        std::vector<optional<recursor_rule>> all_rules(cnstrs.size());
+        std::vector<std::exception_ptr> exs;
+        par_for(cnstrs.size(), [&](add_inductive_fn & fn, unsigned i) {
+                all_rules[i] = fn.mk_rec_rule(cnstrs[i].second, Cs, minors, i);
+            }, exs);
+        for (std::exception_ptr const & ex : exs) {
+            if (ex)
+                std::rethrow_exception(ex);
+        }
         unsigned minor_idx = 0;
         for (unsigned d_idx = 0; d_idx < m_ind_types.size(); d_idx++) {
             rec_info const & info = m_rec_infos[d_idx];
@@ -763,7 +936,10 @@ public:
             rec_ty                = mk_pi(Cs, rec_ty);
             rec_ty                = mk_pi(m_params, rec_ty);
             rec_ty                = infer_implicit(rec_ty, true /* strict */);
-            recursor_rules rules  = mk_rec_rules(d_idx, Cs, minors, minor_idx);
+            buffer<recursor_rule> rules_buffer;
+            for (unsigned i = 0; i < length(m_ind_types[d_idx].get_cnstrs()); i++, minor_idx++)
+                rules_buffer.push_back(*all_rules[minor_idx]);
+            recursor_rules rules(rules_buffer);
             name rec_name         = mk_rec_name(m_ind_types[d_idx].get_name());
             names rec_lparams     = get_rec_lparams();
             m_env.add_core(constant_info(recursor_val(rec_name, rec_lparams, rec_ty, all,
@@ -1208,6 +1384,7 @@ expr string_lit_to_constructor(expr const & e) {
 
 
 void initialize_inductive() {
+    register_memory_pressure_fn([]() { get_rec_rule_index_cache().clear(); });
     g_nested         = new name("_nested");
     mark_persistent(g_nested->raw());
     g_ind_fresh      = new name("_ind_fresh");
@@ -9,6 +9,7 @@ Author: Leonardo de Moura
 #include "kernel/type_checker.h"
 #include "kernel/expr.h"
 #include "kernel/level.h"
+#include "kernel/instantiate.h"
 #include "kernel/declaration.h"
 #include "kernel/local_ctx.h"
 #include "kernel/inductive.h"
@@ -23,6 +24,7 @@ void initialize_kernel_module() {
     initialize_type_checker();
     initialize_environment();
     initialize_local_ctx();
+    initialize_instantiate_mvars();
     initialize_inductive();
     initialize_quot();
     initialize_trace();
@@ -32,6 +34,7 @@ void finalize_kernel_module() {
     finalize_trace();
     finalize_quot();
     finalize_inductive();
+    finalize_instantiate_mvars();
     finalize_local_ctx();
     finalize_environment();
     finalize_type_checker();
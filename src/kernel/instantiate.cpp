@@ -263,4 +263,50 @@ expr instantiate_value_lparams(constant_info const & info, levels const & ls) {
     return instantiate_lparams(info.get_value(), info.get_lparams(), ls);
 }
 
+/* Fused version of `head_beta_reduce(mk_rev_app(instantiate_lparams(value, lps, ls), n, rev_args))`
+   restricted to the leading lambdas of `value`. */
+static expr instantiate_lparams_beta(expr const & value, names const & lps, levels const & ls, unsigned n, expr const * rev_args) {
+    expr body  = value;
+    unsigned m = 0;
+    while (is_lambda(body) && m < n) {
+        body = binding_body(body);
+        m++;
+    }
+    bool inst_lparams = !is_nil(ls) && has_param_univ(body);
+    if (!inst_lparams && m == 0)
+        return mk_rev_app(body, n, rev_args);
+    expr const * subst  = rev_args + (n - m);
+    expr new_body = replace(body, [&](expr const & e, unsigned offset) -> optional<expr> {
+            bool inst_bvars = offset < get_loose_bvar_range(e);
+            if (!inst_bvars && !(inst_lparams && has_param_univ(e)))
+                return some_expr(e);
+            if (is_bvar(e)) {
+                nat const & vidx = bvar_idx(e);
+                if (vidx < offset)
+                    return some_expr(e);
+                if (vidx < offset + m)
+                    return some_expr(lift_loose_bvars(subst[vidx.get_small_value() - offset], offset));
+                return some_expr(mk_bvar(vidx - nat(m)));
+            } else if (is_constant(e)) {
+                return some_expr(update_constant(e, map_reuse(const_levels(e), [&](level const & l) { return instantiate(l, lps, ls); })));
+            } else if (is_sort(e)) {
+                return some_expr(update_sort(e, instantiate(sort_level(e), lps, ls)));
+            } else {
+                return none_expr();
+            }
+        });
+    return mk_rev_app(new_body, n - m, rev_args);
+}
+
+expr instantiate_value_lparams_beta(constant_info const & info, levels const & ls, unsigned n, expr const * rev_args) {
+    if (info.get_num_lparams() != length(ls))
+        lean_internal_panic("#universes mismatch at instantiateValueLevelParams");
+    if (!info.has_value())
+        lean_internal_panic("definition/theorem expected at instantiateValueLevelParams");
+    return instantiate_lparams_beta(info.get_value(), info.get_lparams(), ls, n, rev_args);
+}
+
+expr instantiate_lambdas_beta(expr const & f, unsigned n, expr const * rev_args) {
+    return instantiate_lparams_beta(f, names(), levels(), n, rev_args);
+}
 }
@@ -42,4 +42,16 @@ expr instantiate_type_lparams(constant_info const & info, levels const & ls);
 /** \brief Instantiate the universe level parameters of the value of the given constant.
     \pre d.get_num_lparams() == length(ls) */
 expr instantiate_value_lparams(constant_info const & info, levels const & ls);
+/** \brief Fused version of `head_beta_reduce(mk_rev_app(instantiate_value_lparams(info, ls), n, rev_args))`
+    restricted to the leading lambdas of the value: the universe level parameters and the bound
+    variables of the consumed binders are substituted in a single traversal.
+    \pre d.get_num_lparams() == length(ls) */
+expr instantiate_value_lparams_beta(constant_info const & info, levels const & ls, unsigned n, expr const * rev_args);
+/** \brief Version of `instantiate_value_lparams_beta` for a value `f` whose universe level parameters have
+    already been instantiated. */
+expr instantiate_lambdas_beta(expr const & f, unsigned n, expr const * rev_args);
+
+/* Setup for `instantiateExprMVars` (see `instantiate_mvars.cpp`). */
+void initialize_instantiate_mvars();
+void finalize_instantiate_mvars();
 }
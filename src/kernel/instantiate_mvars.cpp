@@ -7,6 +7,7 @@ Authors: Leonardo de Moura
 #include <vector>
 #include <unordered_map>
 #include "util/name_set.h"
+#include "runtime/thread.h"
 #include "runtime/option_ref.h"
 #include "runtime/array_ref.h"
 #include "kernel/instantiate.h"
@@ -35,6 +36,7 @@ class instantiate_lmvars_fn {
     metavar_ctx & m_mctx;
     std::unordered_map<lean_object *, level> m_cache;
     std::vector<level> m_saved; // Helper vector to prevent values from being garbage collected
+    std::vector<pair<name, level>> * m_record; // If not null, log of the assignments updated by this object
 
     inline level cache(level const & l, level r, bool shared) {
         if (shared) {
@@ -43,7 +45,8 @@ class instantiate_lmvars_fn {
         return r;
     }
 public:
-    instantiate_lmvars_fn(metavar_ctx & mctx):m_mctx(mctx) {}
+    instantiate_lmvars_fn(metavar_ctx & mctx, std::vector<pair<name, level>> * record = nullptr):
+        m_mctx(mctx), m_record(record) {}
     level visit(level const & l) {
         if (!has_mvar(l))
             return l;
@@ -80,6 +83,8 @@ public:
                         */
                         m_saved.push_back(a);
                         assign_lmvar(m_mctx, mvar_id(l), a_new);
+                        if (m_record)
+                            m_record->push_back(mk_pair(mvar_id(l), a_new));
                     }
                     return a_new;
                 }
@@ -143,6 +148,10 @@ class instantiate_mvars_fn {
     name_set m_already_normalized; // Store metavariables whose assignment has already been normalized.
     std::unordered_map<lean_object *, expr> m_cache;
     std::vector<expr> m_saved; // Helper vector to prevent values from being garbage collected
+    std::vector<pair<name, expr>> * m_record; // If not null, log of the assignments updated by this object
+    /* Results computed in advance by other threads, see `instantiate_mvars_par`.
+       Unlike `m_cache`, entries are used even if the key is not shared. */
+    std::unordered_map<lean_object *, expr> m_precomputed;
 
     level visit_level(level const & l) {
         return m_level_fn(l);
@@ -181,6 +190,8 @@ class instantiate_mvars_fn {
                     */
                     m_saved.push_back(a);
                     assign_mvar(m_mctx, mid, a_new);
+                    if (m_record)
+                        m_record->push_back(mk_pair(mid, a_new));
                 }
                 return optional<expr>(a_new);
             }
@@ -322,11 +333,33 @@ class instantiate_mvars_fn {
     }
 
 public:
-    instantiate_mvars_fn(metavar_ctx & mctx):m_mctx(mctx), m_level_fn(mctx) {}
+    instantiate_mvars_fn(metavar_ctx & mctx, std::vector<pair<name, expr>> * record = nullptr,
+                         std::vector<pair<name, level>> * lrecord = nullptr):
+        m_mctx(mctx), m_level_fn(mctx, lrecord), m_record(record) {}
+
+    /* The following two methods are used to merge the work done by the tasks created by `instantiate_mvars_par`. */
+
+    /* Use `r` as the result for `e` (compared by pointer). */
+    void set_precomputed(expr const & e, expr const & r) {
+        m_precomputed.insert(mk_pair(e.raw(), r));
+    }
+
+    /* Assign `a`, which is already normalized, to `mid`. */
+    void set_normalized(name const & mid, expr const & a) {
+        if (!m_already_normalized.contains(mid)) {
+            m_already_normalized.insert(mid);
+            assign_mvar(m_mctx, mid, a);
+        }
+    }
 
     expr visit(expr const & e) {
         if (!has_mvar(e))
             return e;
+        if (!m_precomputed.empty()) {
+            auto it = m_precomputed.find(e.raw());
+            if (it != m_precomputed.end())
+                return it->second;
+        }
         bool shared = false;
         if (is_shared(e)) {
             auto it = m_cache.find(e.raw());
@@ -362,12 +395,128 @@ public:
     expr operator()(expr const & e) { return visit(e); }
 };
 
+/*
+Parallel mode.
+
+The metavariable context is a persistent value threaded through the traversal, so tasks cannot
+update a shared one. Instead, we split `e` into independent subterms, and each task instantiates
+its subterm using its own copy of the metavariable context, recording the (path-compressed)
+assignments it updates. Afterwards, the recorded assignments are applied to `mctx`, and a
+sequential pass reuses the task results for the subterms, revisiting only the spine above them.
+The result is the same as the sequential one since the instantiation of a subterm depends only on
+the subterm and the original metavariable context.
+
+The mode is enabled by setting the environment variable `LEAN_PARALLEL_INSTANTIATE_MVARS`.
+*/
+static bool g_instantiate_mvars_par = false;
+/* Minimum number of subterms to make the parallel mode worthwhile. */
+#define LEAN_INSTANTIATE_MVARS_PAR_MIN_SUBTERMS 4
+
+struct instantiate_mvars_job {
+    metavar_ctx                    m_mctx;
+    expr                           m_e;
+    expr                           m_result;
+    std::vector<pair<name, expr>>  m_assignments;
+    std::vector<pair<name, level>> m_lassignments;
+};
+
+/* Task body. `job` is a boxed pointer to an `instantiate_mvars_job` owned by `instantiate_mvars_par`. */
+static obj_res instantiate_mvars_job_fn(obj_arg job, obj_arg) {
+    instantiate_mvars_job * j = reinterpret_cast<instantiate_mvars_job *>(lean_unbox_usize(job));
+    lean_dec(job);
+    j->m_result = instantiate_mvars_fn(j->m_mctx, &j->m_assignments, &j->m_lassignments)(j->m_e);
+    return box(0);
+}
+
+/* Split `e` into at least `n` subterms containing metavariables, if possible.
+   We only descend into subterms whose instantiation does not depend on their parent,
+   that is, we never split the function of an application. */
+static void split_for_instantiate_mvars(expr const & e, unsigned n, buffer<expr> & result) {
+    std::vector<expr> todo;
+    todo.push_back(e);
+    size_t i = 0;
+    while (i < todo.size() && todo.size() - i < n) {
+        expr const & t = todo[i];
+        i++;
+        switch (t.kind()) {
+        case expr_kind::MData:
+            todo.push_back(mdata_expr(t)); break;
+        case expr_kind::Proj:
+            todo.push_back(proj_expr(t)); break;
+        case expr_kind::App: {
+            expr const * curr = &t;
+            while (is_app(*curr)) {
+                if (has_mvar(app_arg(*curr)))
+                    todo.push_back(app_arg(*curr));
+                curr = &app_fn(*curr);
+            }
+            if (!is_mvar(*curr) && has_mvar(*curr))
+                todo.push_back(*curr);
+            break;
+        }
+        case expr_kind::Pi: case expr_kind::Lambda:
+            if (has_mvar(binding_domain(t))) todo.push_back(binding_domain(t));
+            if (has_mvar(binding_body(t))) todo.push_back(binding_body(t));
+            break;
+        case expr_kind::Let:
+            if (has_mvar(let_type(t))) todo.push_back(let_type(t));
+            if (has_mvar(let_value(t))) todo.push_back(let_value(t));
+            if (has_mvar(let_body(t))) todo.push_back(let_body(t));
+            break;
+        default:
+            break;
+        }
+    }
+    for (; i < todo.size(); i++) {
+        if (!is_mvar(todo[i]))
+            result.push_back(todo[i]);
+    }
+}
+
+static expr instantiate_mvars_par(metavar_ctx & mctx, expr const & e) {
+    buffer<expr> subterms;
+    split_for_instantiate_mvars(e, 4 * hardware_concurrency(), subterms);
+    if (subterms.size() < LEAN_INSTANTIATE_MVARS_PAR_MIN_SUBTERMS)
+        return instantiate_mvars_fn(mctx)(e);
+    mark_mt(mctx.raw());
+    mark_mt(e.raw());
+    std::vector<instantiate_mvars_job> jobs(subterms.size());
+    buffer<object *> tasks;
+    for (unsigned i = 0; i < subterms.size(); i++) {
+        jobs[i].m_mctx = mctx;
+        jobs[i].m_e    = subterms[i];
+        object * c = lean_alloc_closure(reinterpret_cast<void *>(instantiate_mvars_job_fn), 2, 1);
+        lean_closure_set(c, 0, lean_box_usize(reinterpret_cast<size_t>(&jobs[i])));
+        tasks.push_back(lean_task_spawn_core(c, 0, false));
+    }
+    for (object * t : tasks) {
+        lean_task_get(t);
+        lean_dec(t);
+    }
+    instantiate_mvars_fn fn(mctx);
+    for (instantiate_mvars_job & job : jobs) {
+        for (auto const & p : job.m_lassignments)
+            assign_lmvar(mctx, p.first, p.second);
+        for (auto const & p : job.m_assignments)
+            fn.set_normalized(p.first, p.second);
+        fn.set_precomputed(job.m_e, job.m_result);
+    }
+    return fn(e);
+}
+
 extern "C" LEAN_EXPORT object * lean_instantiate_expr_mvars(object * m, object * e) {
     metavar_ctx mctx(m);
-    expr e_new = instantiate_mvars_fn(mctx)(expr(e));
+    expr e_new = g_instantiate_mvars_par ? instantiate_mvars_par(mctx, expr(e)) : instantiate_mvars_fn(mctx)(expr(e));
     object * r = alloc_cnstr(0, 2, 0);
     cnstr_set(r, 0, mctx.steal());
     cnstr_set(r, 1, e_new.steal());
     return r;
 }
+
+void initialize_instantiate_mvars() {
+    g_instantiate_mvars_par = getenv("LEAN_PARALLEL_INSTANTIATE_MVARS") != nullptr;
+}
+
+void finalize_instantiate_mvars() {
+}
 }
@@ -8,10 +8,13 @@ Author: Leonardo de Moura
 #include <algorithm>
 #include <vector>
 #include <unordered_set>
+#include <unordered_map>
 #include "runtime/debug.h"
 #include "runtime/interrupt.h"
+#include "runtime/memory.h"
 #include "runtime/hash.h"
 #include "runtime/buffer.h"
+#include "runtime/thread.h"
 #include "util/list.h"
 #include "kernel/level.h"
 #include "kernel/environment.h"
@@ -426,7 +429,39 @@ level mk_succ(level l, unsigned k) {
     return l;
 }
 
+/* Return true if `l` is of the form `succ^k(a)` where `a` is not a `max` or `imax`. These levels are normalized. */
+static bool is_offset_of_atom(level const & l) {
+    level const * it = &l;
+    while (is_succ(*it))
+        it = &succ_of(*it);
+    return !is_max(*it) && !is_imax(*it);
+}
+
+/* Levels whose normal form is cached by `normalize`, see `get_normalize_cache`. */
+#define LEAN_LEVEL_NORMALIZE_CACHE_MAX_SIZE 4096
+
+/* Normal forms of levels indexed by pointer. Each entry also stores the key, so that its address is not reused.
+   The cache is cleared when it reaches `LEAN_LEVEL_NORMALIZE_CACHE_MAX_SIZE` entries. */
+typedef std::unordered_map<lean_object *, pair<level, level>> normalize_cache;
+MK_THREAD_LOCAL_GET_DEF(normalize_cache, get_normalize_cache);
+
+static level normalize_core(level const & l);
+
 level normalize(level const & l) {
+    if (is_offset_of_atom(l))
+        return l;
+    normalize_cache & cache = get_normalize_cache();
+    auto it = cache.find(l.raw());
+    if (it != cache.end())
+        return it->second.second;
+    level r = normalize_core(l);
+    if (cache.size() >= LEAN_LEVEL_NORMALIZE_CACHE_MAX_SIZE)
+        cache.clear();
+    cache.insert(mk_pair(l.raw(), mk_pair(l, r)));
+    return r;
+}
+
+static level normalize_core(level const & l) {
     auto p = to_offset(l);
     level const & r = p.first;
     switch (kind(r)) {
@@ -492,7 +527,11 @@ level normalize(level const & l) {
 
 bool is_equivalent(level const & lhs, level const & rhs) {
     check_system("level constraints");
-    return lhs == rhs || normalize(lhs) == normalize(rhs);
+    if (lhs == rhs)
+        return true;
+    if (is_offset_of_atom(lhs) && is_offset_of_atom(rhs))
+        return false; // both are in normal form
+    return normalize(lhs) == normalize(rhs);
 }
 
 bool is_geq_core(level l1, level l2) {
@@ -515,6 +554,13 @@ bool is_geq_core(level l1, level l2) {
     return false;
 }
 bool is_geq(level const & l1, level const & l2) {
+    if (is_offset_of_atom(l1) && is_offset_of_atom(l2)) {
+        auto p1 = to_offset(l1);
+        auto p2 = to_offset(l2);
+        if (p1.first == p2.first || is_zero(p2.first))
+            return p1.second >= p2.second;
+        return false;
+    }
     return is_geq_core(normalize(l1), normalize(l2));
 }
 levels lparams_to_levels(names const & ps) {
@@ -532,6 +578,7 @@ void initialize_level() {
     mark_persistent(g_level_zero->raw());
     g_level_one  = new level(mk_succ(*g_level_zero));
     mark_persistent(g_level_one->raw());
+    register_memory_pressure_fn([]() { get_normalize_cache().clear(); });
 }
 
 void finalize_level() {
@@ -90,13 +90,13 @@ void local_ctx::clear(local_decl const & d) {
     m_obj = lean_local_ctx_erase(m_obj, d.get_name().to_obj_arg());
 }
 
-template<bool is_lambda>
-expr local_ctx::mk_binding(unsigned num, expr const * fvars, expr const & b, bool remove_dead_let) const {
+template<bool is_lambda, typename Ctx>
+static expr mk_binding_core(Ctx const & lctx, unsigned num, expr const * fvars, expr const & b, bool remove_dead_let) {
     expr r     = abstract(b, num, fvars);
     unsigned i = num;
     while (i > 0) {
         --i;
-        local_decl const & decl = get_local_decl(fvar_name(fvars[i]));
+        local_decl const & decl = lctx.get_local_decl(fvars[i]);
         if (optional<expr> const & opt_val = decl.get_value()) {
             if (!remove_dead_let || has_loose_bvar(r, 0)) {
                 expr type  = abstract(decl.get_type(), i, fvars);
@@ -116,6 +116,11 @@ expr local_ctx::mk_binding(unsigned num, expr const * fvars, expr const & b, boo
     return r;
 }
 
+template<bool is_lambda>
+expr local_ctx::mk_binding(unsigned num, expr const * fvars, expr const & b, bool remove_dead_let) const {
+    return mk_binding_core<is_lambda>(*this, num, fvars, b, remove_dead_let);
+}
+
 expr local_ctx::mk_lambda(unsigned num, expr const * fvars, expr const & e, bool remove_dead_let) const {
     return mk_binding<true>(num, fvars, e, remove_dead_let);
 }
@@ -124,6 +129,102 @@ expr local_ctx::mk_pi(unsigned num, expr const * fvars, expr const & e, bool rem
     return mk_binding<false>(num, fvars, e, remove_dead_let);
 }
 
+/* Large gaps in the indices happen when other type checkers share the name generator. We start a
+   new segment in this case, to avoid wasting memory with dummy entries. Lookups go through the
+   segments, so the free variables created after `LEAN_INDEXED_LCTX_MAX_SEGMENTS` segments are
+   stored in the wrapped `local_ctx` instead. */
+#define LEAN_INDEXED_LCTX_MAX_GAP 1024
+#define LEAN_INDEXED_LCTX_MAX_SEGMENTS 8
+
+template<typename F>
+expr indexed_local_ctx::mk_local_decl_core(name_generator & g, F && mk) {
+    name n = g.next();
+    if (n.is_numeral() && n.get_numeral().is_small()) {
+        unsigned idx = n.get_numeral().get_small_value();
+        segment * s = m_segments.empty() ? nullptr : &m_segments.back();
+        if (!s || n.get_prefix() != s->m_prefix || idx < s->m_first_idx + s->m_decls.size() ||
+            idx - s->m_first_idx - s->m_decls.size() > LEAN_INDEXED_LCTX_MAX_GAP) {
+            if (m_segments.size() == LEAN_INDEXED_LCTX_MAX_SEGMENTS)
+                return mk(n, m_base);
+            m_segments.push_back(segment{n.get_prefix(), idx, std::vector<local_decl>()});
+            s = &m_segments.back();
+        }
+        s->m_decls.resize(idx - s->m_first_idx);
+        s->m_decls.push_back(mk(idx, n));
+        return mk_fvar(n);
+    }
+    return mk(n, m_base);
+}
+
+expr indexed_local_ctx::mk_local_decl(name_generator & g, name const & un, expr const & type, binder_info bi) {
+    struct mk_fn {
+        name const & m_un; expr const & m_type; binder_info m_bi;
+        local_decl operator()(unsigned idx, name const & n) const { return local_decl(idx, n, m_un, m_type, m_bi); }
+        expr operator()(name const & n, local_ctx & base) const { return base.mk_local_decl(n, m_un, m_type, m_bi).mk_ref(); }
+    };
+    return mk_local_decl_core(g, mk_fn{un, type, bi});
+}
+
+expr indexed_local_ctx::mk_local_decl(name_generator & g, name const & un, expr const & type, expr const & value) {
+    struct mk_fn {
+        name const & m_un; expr const & m_type; expr const & m_value;
+        local_decl operator()(unsigned idx, name const & n) const { return local_decl(idx, n, m_un, m_type, m_value); }
+        expr operator()(name const & n, local_ctx & base) const { return base.mk_local_decl(n, m_un, m_type, m_value).mk_ref(); }
+    };
+    return mk_local_decl_core(g, mk_fn{un, type, value});
+}
+
+optional<local_decl> indexed_local_ctx::find_local_decl(expr const & e) const {
+    name const & n = fvar_name(e);
+    if (n.is_numeral() && n.get_numeral().is_small()) {
+        unsigned idx = n.get_numeral().get_small_value();
+        for (auto it = m_segments.rbegin(); it != m_segments.rend(); ++it) {
+            if (idx >= it->m_first_idx && idx - it->m_first_idx < it->m_decls.size()) {
+                local_decl const & d = it->m_decls[idx - it->m_first_idx];
+                if (d.get_name() == n)
+                    return optional<local_decl>(d);
+            }
+        }
+    }
+    return m_base.find_local_decl(n);
+}
+
+local_decl indexed_local_ctx::get_local_decl(expr const & e) const {
+    if (optional<local_decl> r = find_local_decl(e)) {
+        return *r;
+    } else {
+        throw exception(sstream() << "unknown free variable: " << fvar_name(e));
+    }
+}
+
+template<bool is_lambda>
+expr indexed_local_ctx::mk_binding(unsigned num, expr const * fvars, expr const & b) const {
+    return mk_binding_core<is_lambda>(*this, num, fvars, b, false);
+}
+
+expr indexed_local_ctx::mk_lambda(buffer<expr> const & fvars, expr const & e) const {
+    return mk_binding<true>(fvars.size(), fvars.data(), e);
+}
+
+expr indexed_local_ctx::mk_pi(buffer<expr> const & fvars, expr const & e) const {
+    return mk_binding<false>(fvars.size(), fvars.data(), e);
+}
+
+local_ctx indexed_local_ctx::to_local_ctx() const {
+    local_ctx r = m_base;
+    for (segment const & s : m_segments) {
+        for (local_decl const & d : s.m_decls) {
+            if (d.get_idx() == std::numeric_limits<unsigned>::max())
+                continue; // dummy entry
+            if (optional<expr> const & v = d.get_value())
+                r.mk_local_decl(d.get_name(), d.get_user_name(), d.get_type(), *v);
+            else
+                r.mk_local_decl(d.get_name(), d.get_user_name(), d.get_type(), d.get_info());
+        }
+    }
+    return r;
+}
+
 void initialize_local_ctx() {
     g_dummy_type   = new expr(mk_constant(name::mk_internal_unique_name()));
     mark_persistent(g_dummy_type->raw());
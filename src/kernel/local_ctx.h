@@ -5,6 +5,7 @@ Released under Apache 2.0 license as described in the file LICENSE.
 Author: Leonardo de Moura
 */
 #pragma once
+#include <vector>
 #include "util/name_generator.h"
 #include "util/rb_map.h"
 #include "util/name_map.h"
@@ -18,6 +19,7 @@ inductive LocalDecl
 */
 class local_decl : public object_ref {
     friend class local_ctx;
+    friend class indexed_local_ctx;
     friend class local_context;
     friend void initialize_local_ctx();
     local_decl(unsigned idx, name const & n, name const & un, expr const & t, expr const & v);
@@ -101,6 +103,58 @@ public:
     expr mk_pi(std::initializer_list<expr> const & fvars, expr const & e) { return mk_pi(fvars.size(), fvars.begin(), e); }
 };
 
+/* Local context used internally by the kernel type checker.
+
+   The free variables created by `mk_local_decl` are named `<prefix>.<i>` by the name generator,
+   and their declarations are stored in arrays indexed by `i`, so that looking them up does not
+   go through the persistent hash map of `LocalContext`. Each array covers a segment of
+   consecutive indices, and a new segment is started when the indices jump. Free variables not
+   created by this object, and the rare ones whose name cannot be indexed, are stored in the
+   `local_ctx` it wraps. Use `to_local_ctx` to obtain a plain local context (e.g., for error
+   messages). */
+class indexed_local_ctx {
+    struct segment {
+        name                    m_prefix;
+        unsigned                m_first_idx;
+        std::vector<local_decl> m_decls; // `m_decls[i - m_first_idx]` is the declaration for `<m_prefix>.<i>`
+    };
+    local_ctx            m_base;
+    std::vector<segment> m_segments;
+
+    template<typename F> expr mk_local_decl_core(name_generator & g, F && mk);
+    template<bool is_lambda> expr mk_binding(unsigned num, expr const * fvars, expr const & b) const;
+public:
+    explicit indexed_local_ctx(local_ctx const & base):m_base(base) {}
+
+    /* Restore the local context when the scope ends. */
+    class scope {
+        indexed_local_ctx & m_lctx;
+        local_ctx           m_base;
+        size_t              m_num_segments;
+        size_t              m_size; // size of the last segment
+    public:
+        scope(indexed_local_ctx & lctx):
+            m_lctx(lctx), m_base(lctx.m_base), m_num_segments(lctx.m_segments.size()),
+            m_size(lctx.m_segments.empty() ? 0 : lctx.m_segments.back().m_decls.size()) {}
+        ~scope() {
+            m_lctx.m_base = m_base;
+            m_lctx.m_segments.resize(m_num_segments);
+            if (m_num_segments > 0) m_lctx.m_segments.back().m_decls.resize(m_size);
+        }
+    };
+
+    expr mk_local_decl(name_generator & g, name const & un, expr const & type, binder_info bi = mk_binder_info());
+    expr mk_local_decl(name_generator & g, name const & un, expr const & type, expr const & value);
+
+    optional<local_decl> find_local_decl(expr const & e) const;
+    local_decl get_local_decl(expr const & e) const;
+
+    expr mk_lambda(buffer<expr> const & fvars, expr const & e) const;
+    expr mk_pi(buffer<expr> const & fvars, expr const & e) const;
+
+    local_ctx to_local_ctx() const;
+};
+
 void initialize_local_ctx();
 void finalize_local_ctx();
 }
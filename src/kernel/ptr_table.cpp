@@ -0,0 +1,50 @@
+/*
+Copyright (c) 2025 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+*/
+#include <vector>
+#include "runtime/thread.h"
+#include "kernel/ptr_table.h"
+
+/* Tables with more slots are freed instead of being returned to the pool. */
+#ifndef LEAN_MAX_POOLED_PTR_TABLE
+#define LEAN_MAX_POOLED_PTR_TABLE (1u << 16)
+#endif
+
+/* Maximum number of tables per pool, i.e., of nested traversals that reuse memory. */
+#define LEAN_PTR_TABLE_POOL_SIZE 8
+
+namespace lean {
+struct ptr_table_pool {
+    std::vector<ptr_table<bool> *> m_sets;
+    std::vector<ptr_table<expr> *> m_maps;
+    ~ptr_table_pool() {
+        for (ptr_table<bool> * t : m_sets) delete t;
+        for (ptr_table<expr> * t : m_maps) delete t;
+    }
+};
+
+MK_THREAD_LOCAL_GET_DEF(ptr_table_pool, get_ptr_table_pool);
+
+template<typename T> static ptr_table<T> * acquire(std::vector<ptr_table<T> *> & pool) {
+    if (pool.empty())
+        return new ptr_table<T>();
+    ptr_table<T> * t = pool.back();
+    pool.pop_back();
+    return t;
+}
+
+template<typename T> static void release(std::vector<ptr_table<T> *> & pool, ptr_table<T> * t) {
+    if (t->capacity() > LEAN_MAX_POOLED_PTR_TABLE || pool.size() >= LEAN_PTR_TABLE_POOL_SIZE) {
+        delete t;
+    } else {
+        t->clear();
+        pool.push_back(t);
+    }
+}
+
+template<> ptr_table<bool> * acquire_ptr_table<bool>() { return acquire(get_ptr_table_pool().m_sets); }
+template<> ptr_table<expr> * acquire_ptr_table<expr>() { return acquire(get_ptr_table_pool().m_maps); }
+template<> void release_ptr_table<bool>(ptr_table<bool> * t) { release(get_ptr_table_pool().m_sets, t); }
+template<> void release_ptr_table<expr>(ptr_table<expr> * t) { release(get_ptr_table_pool().m_maps, t); }
+}
@@ -0,0 +1,123 @@
+/*
+Copyright (c) 2025 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+*/
+#pragma once
+#include <vector>
+#include <type_traits>
+#include "runtime/hash.h"
+#include "kernel/expr.h"
+
+namespace lean {
+/* \brief Open addressing table keyed by `(object pointer, offset)` pairs, used for the caches of
+   expression traversals. Slots are tagged with a generation number and only the slots of the
+   current generation are live, so `clear` does not free memory and, unless `T` owns resources,
+   runs in constant time. Use `ptr_table_ref` to obtain a table from a thread-local pool, so that
+   the memory of the table is reused across traversals. */
+template<typename T>
+class ptr_table {
+    struct slot {
+        lean_object * m_ptr{nullptr};
+        unsigned      m_offset{0};
+        unsigned      m_gen{0};
+        T             m_value{};
+    };
+    static constexpr bool owns_values = !std::is_trivially_destructible<T>::value;
+    std::vector<slot>     m_slots; // size is zero or a power of two
+    std::vector<unsigned> m_used;  // live slots, only tracked if `owns_values`
+    unsigned              m_gen{1};
+    size_t                m_size{0};
+
+    static unsigned hash_of(lean_object * p, unsigned offset) {
+        return static_cast<unsigned>(hash(reinterpret_cast<size_t>(p) >> 3, offset));
+    }
+
+    unsigned find_slot(lean_object * p, unsigned offset) const {
+        unsigned mask = m_slots.size() - 1;
+        unsigned i    = hash_of(p, offset) & mask;
+        while (true) {
+            slot const & s = m_slots[i];
+            if (s.m_gen != m_gen || (s.m_ptr == p && s.m_offset == offset))
+                return i;
+            i = (i + 1) & mask;
+        }
+    }
+
+    void grow() {
+        std::vector<slot> old(m_slots.empty() ? 64 : 2 * m_slots.size());
+        old.swap(m_slots);
+        m_used.clear();
+        for (slot & s : old) {
+            if (s.m_gen != m_gen)
+                continue;
+            unsigned i = find_slot(s.m_ptr, s.m_offset);
+            m_slots[i] = std::move(s);
+            if (owns_values)
+                m_used.push_back(i);
+        }
+    }
+public:
+    /* Return the value associated with the given key, `nullptr` if there is none.
+       The result is invalidated by `insert`. */
+    T * find(lean_object * p, unsigned offset = 0) {
+        if (m_slots.empty())
+            return nullptr;
+        slot & s = m_slots[find_slot(p, offset)];
+        return s.m_gen == m_gen ? &s.m_value : nullptr;
+    }
+
+    /* Associate `v` with the given key unless it is already present. Return true if it was inserted. */
+    bool insert(lean_object * p, unsigned offset, T const & v) {
+        // keep the load factor at most 1/2
+        if (2 * (m_size + 1) > m_slots.size())
+            grow();
+        unsigned i = find_slot(p, offset);
+        slot & s   = m_slots[i];
+        if (s.m_gen == m_gen)
+            return false;
+        s.m_ptr    = p;
+        s.m_offset = offset;
+        s.m_gen    = m_gen;
+        s.m_value  = v;
+        m_size++;
+        if (owns_values)
+            m_used.push_back(i);
+        return true;
+    }
+
+    void clear() {
+        if (owns_values) {
+            for (unsigned i : m_used)
+                m_slots[i].m_value = T();
+            m_used.clear();
+        }
+        m_size = 0;
+        if (++m_gen == 0) {
+            for (slot & s : m_slots)
+                s.m_gen = 0;
+            m_gen = 1;
+        }
+    }
+
+    size_t size() const { return m_size; }
+    size_t capacity() const { return m_slots.size(); }
+};
+
+/* Take a cleared table from the thread-local pool, and give it back. Only `bool` (visited sets)
+   and `expr` values are supported. */
+template<typename T> ptr_table<T> * acquire_ptr_table();
+template<typename T> void release_ptr_table(ptr_table<T> * t);
+
+/* \brief Owner of a table from the thread-local pool for the duration of a traversal. */
+template<typename T>
+class ptr_table_ref {
+    ptr_table<T> * m_table;
+public:
+    ptr_table_ref():m_table(acquire_ptr_table<T>()) {}
+    ptr_table_ref(ptr_table_ref const &) = delete;
+    ptr_table_ref & operator=(ptr_table_ref const &) = delete;
+    ~ptr_table_ref() { release_ptr_table<T>(m_table); }
+    ptr_table<T> & operator*() const { return *m_table; }
+    ptr_table<T> * operator->() const { return m_table; }
+};
+}
@@ -6,6 +6,8 @@ Author: Leonardo de Moura
 */
 #include <utility>
 #include <vector>
+#include <atomic>
+#include <cstdlib>
 #include "runtime/interrupt.h"
 #include "runtime/sstream.h"
 #include "runtime/flet.h"
@@ -40,10 +42,102 @@ static expr * g_nat_lor      = nullptr;
 static expr * g_nat_xor      = nullptr;
 static expr * g_nat_shiftLeft  = nullptr;
 static expr * g_nat_shiftRight = nullptr;
+static expr * g_nat_testBit   = nullptr;
+static expr * g_nat_log2      = nullptr;
 
 type_checker::state::state(environment const & env):
     m_env(env), m_ngen(*g_kernel_fresh) {}
 
+size_t type_checker::state::num_cache_entries() const {
+    return m_infer_type[0].size() + m_infer_type[1].size() + m_whnf_core.size() + m_whnf.size() +
+        m_is_prop.size() + m_value_lparams.size() + m_failure.size() + m_eqv_manager.size();
+}
+
+void type_checker::state::clear_caches() {
+    m_infer_type[0].clear();
+    m_infer_type[1].clear();
+    m_whnf_core.clear();
+    m_whnf.clear();
+    m_is_prop.clear();
+    m_value_lparams.clear();
+    m_failure.clear();
+    m_eqv_manager.clear();
+    m_constants.clear();
+}
+
+static std::atomic<size_t> g_kernel_cache_budget(0);
+
+void set_kernel_cache_budget(size_t num_entries) { g_kernel_cache_budget = num_entries; }
+size_t get_kernel_cache_budget() { return g_kernel_cache_budget; }
+
+/* Make room for a new cache entry. We simply clear all caches when the budget is exceeded: they only
+   memoize results, and a full reset is cheaper to maintain than an LRU order on every lookup. */
+void type_checker::check_cache_budget() {
+    size_t budget = g_kernel_cache_budget.load(std::memory_order_relaxed);
+    if (budget != 0 && m_st->num_cache_entries() >= budget) {
+        count(&kernel_profile::m_cache_resets);
+        m_st->clear_caches();
+    }
+}
+
+LEAN_THREAD_VALUE(shared_kernel_cache *, g_shared_kernel_cache, nullptr);
+LEAN_THREAD_VALUE(unsigned, g_shared_kernel_cache_prefix, 0);
+
+scope_shared_kernel_cache::scope_shared_kernel_cache(shared_kernel_cache * c, unsigned prefix):
+    m_cache(g_shared_kernel_cache, c), m_prefix(g_shared_kernel_cache_prefix, prefix) {}
+
+optional<expr> shared_kernel_cache::find(cache & m, expr const & e, unsigned prefix) {
+    lock_guard<mutex> lock(m_mutex);
+    auto it = m.find(e);
+    if (it != m.end() && it->second.second <= prefix)
+        return some_expr(it->second.first);
+    return none_expr();
+}
+
+void shared_kernel_cache::insert(cache & m, expr const & e, expr const & r, unsigned prefix) {
+    mark_mt(e.raw());
+    mark_mt(r.raw());
+    lock_guard<mutex> lock(m_mutex);
+    if (m.size() >= m_capacity)
+        m.clear();
+    auto it = m.find(e);
+    if (it == m.end())
+        m.insert(mk_pair(e, mk_pair(r, prefix)));
+    else if (prefix < it->second.second)
+        it->second = mk_pair(r, prefix);
+}
+
+LEAN_THREAD_VALUE(kernel_profile *, g_kernel_profile, nullptr);
+
+scope_kernel_profile::scope_kernel_profile(kernel_profile * p):
+    flet<kernel_profile *>(g_kernel_profile, p) {}
+
+/* Unlike `equiv_manager`, the equalities are not closed under transitivity, since a chain of
+   equalities may combine ones that are only valid in different environments. */
+bool shared_kernel_cache::is_equiv(expr const & t, expr const & s, unsigned prefix) {
+    lock_guard<mutex> lock(m_mutex);
+    auto it = m_equiv.find(mk_pair(t, s));
+    if (it == m_equiv.end())
+        it = m_equiv.find(mk_pair(s, t));
+    return it != m_equiv.end() && it->second <= prefix;
+}
+
+void shared_kernel_cache::add_equiv(expr const & t, expr const & s, unsigned prefix) {
+    mark_mt(t.raw());
+    mark_mt(s.raw());
+    lock_guard<mutex> lock(m_mutex);
+    if (m_equiv.size() >= m_capacity)
+        m_equiv.clear();
+    auto r = m_equiv.insert(mk_pair(mk_pair(t, s), prefix));
+    if (!r.second && prefix < r.first->second)
+        r.first->second = prefix;
+}
+
+/* Return true if results for `e` can be stored in the shared cache. */
+static bool is_shareable(expr const & e) {
+    return !has_fvar(e) && !has_univ_param(e);
+}
+
 /** \brief Make sure \c e "is" a sort, and return the corresponding sort.
     If \c e is not a sort, then the whnf procedure is invoked.
 
@@ -56,7 +150,7 @@ expr type_checker::ensure_sort_core(expr e, expr const & s) {
     if (is_sort(new_e)) {
         return new_e;
     } else {
-        throw type_expected_exception(env(), m_lctx, s);
+        throw type_expected_exception(env(), m_lctx.to_local_ctx(), s);
     }
 }
 
@@ -68,7 +162,7 @@ expr type_checker::ensure_pi_core(expr e, expr const & s) {
     if (is_pi(new_e)) {
         return new_e;
     } else {
-        throw function_expected_exception(env(), m_lctx, s);
+        throw function_expected_exception(env(), m_lctx.to_local_ctx(), s);
     }
 }
 
@@ -88,8 +182,26 @@ expr type_checker::infer_fvar(expr const & e) {
     }
 }
 
+/** \brief Return the declaration named \c n, using and updating the cache of the current state.
+    The result is invalidated when the caches are cleared, see `check_cache_budget`. */
+constant_info const * type_checker::find_constant(name const & n) {
+    if (constant_info const * info = m_st->m_constants.find(n))
+        return info;
+    if (optional<constant_info> info = env().find(n)) {
+        // constants are never removed or changed, so we only cache successful lookups
+        return &m_st->m_constants.insert(n, *info);
+    }
+    return nullptr;
+}
+
+constant_info type_checker::get_constant(name const & n) {
+    if (constant_info const * info = find_constant(n))
+        return *info;
+    throw unknown_constant_exception(env(), n);
+}
+
 expr type_checker::infer_constant(expr const & e, bool infer_only) {
-    constant_info info = env().get(const_name(e));
+    constant_info info = get_constant(const_name(e));
     auto const & ps = info.get_lparams();
     auto const & ls = const_levels(e);
     if (length(ps) != length(ls))
@@ -113,7 +225,7 @@ expr type_checker::infer_constant(expr const & e, bool infer_only) {
 }
 
 expr type_checker::infer_lambda(expr const & _e, bool infer_only) {
-    flet<local_ctx> save_lctx(m_lctx, m_lctx);
+    indexed_local_ctx::scope save_lctx(m_lctx);
     buffer<expr> fvars;
     expr e = _e;
     while (is_lambda(e)) {
@@ -131,7 +243,7 @@ expr type_checker::infer_lambda(expr const & _e, bool infer_only) {
 }
 
 expr type_checker::infer_pi(expr const & _e, bool infer_only) {
-    flet<local_ctx> save_lctx(m_lctx, m_lctx);
+    indexed_local_ctx::scope save_lctx(m_lctx);
     buffer<expr> fvars;
     buffer<level> us;
     expr e = _e;
@@ -160,7 +272,7 @@ expr type_checker::infer_app(expr const & e, bool infer_only) {
         expr a_type = infer_type_core(app_arg(e), infer_only);
         expr d_type = binding_domain(f_type);
         if (!is_def_eq(a_type, d_type)) {
-            throw app_type_mismatch_exception(env(), m_lctx, e, f_type, a_type);
+            throw app_type_mismatch_exception(env(), m_lctx.to_local_ctx(), e, f_type, a_type);
         }
         return instantiate(binding_body(f_type), app_arg(e));
     } else {
@@ -200,7 +312,7 @@ static void mark_used(unsigned n, expr const * fvars, expr const & b, bool * use
 }
 
 expr type_checker::infer_let(expr const & _e, bool infer_only) {
-    flet<local_ctx> save_lctx(m_lctx, m_lctx);
+    indexed_local_ctx::scope save_lctx(m_lctx);
     buffer<expr> fvars;
     buffer<expr> vals;
     expr e = _e;
@@ -214,7 +326,7 @@ expr type_checker::infer_let(expr const & _e, bool infer_only) {
             ensure_sort_core(infer_type_core(type, infer_only), type);
             expr val_type = infer_type_core(val, infer_only);
             if (!is_def_eq(val_type, type)) {
-                throw def_type_mismatch_exception(env(), m_lctx, let_name(e), val_type, type);
+                throw def_type_mismatch_exception(env(), m_lctx.to_local_ctx(), let_name(e), val_type, type);
             }
         }
         e = let_body(e);
@@ -241,47 +353,47 @@ expr type_checker::infer_let(expr const & _e, bool infer_only) {
 expr type_checker::infer_proj(expr const & e, bool infer_only) {
     expr type = whnf(infer_type_core(proj_expr(e), infer_only));
     if (!proj_idx(e).is_small())
-        throw invalid_proj_exception(env(), m_lctx, e);
+        throw invalid_proj_exception(env(), m_lctx.to_local_ctx(), e);
     unsigned idx = proj_idx(e).get_small_value();
     buffer<expr> args;
     expr const & I = get_app_args(type, args);
     if (!is_constant(I))
-        throw invalid_proj_exception(env(), m_lctx, e);
+        throw invalid_proj_exception(env(), m_lctx.to_local_ctx(), e);
     name const & I_name  = const_name(I);
     if (I_name != proj_sname(e))
-        throw invalid_proj_exception(env(), m_lctx, e);
+        throw invalid_proj_exception(env(), m_lctx.to_local_ctx(), e);
     constant_info I_info = env().get(I_name);
     if (!I_info.is_inductive())
-        throw invalid_proj_exception(env(), m_lctx, e);
+        throw invalid_proj_exception(env(), m_lctx.to_local_ctx(), e);
     inductive_val I_val = I_info.to_inductive_val();
     if (length(I_val.get_cnstrs()) != 1 || args.size() != I_val.get_nparams() + I_val.get_nindices())
-        throw invalid_proj_exception(env(), m_lctx, e);
+        throw invalid_proj_exception(env(), m_lctx.to_local_ctx(), e);
 
     constant_info c_info = env().get(head(I_val.get_cnstrs()));
     expr r = instantiate_type_lparams(c_info, const_levels(I));
     for (unsigned i = 0; i < I_val.get_nparams(); i++) {
         lean_assert(i < args.size());
         r = whnf(r);
-        if (!is_pi(r)) throw invalid_proj_exception(env(), m_lctx, e);
+        if (!is_pi(r)) throw invalid_proj_exception(env(), m_lctx.to_local_ctx(), e);
         r = instantiate(binding_body(r), args[i]);
     }
     bool is_prop_type = is_prop(type);
     for (unsigned i = 0; i < idx; i++) {
         r = whnf(r);
-        if (!is_pi(r)) throw invalid_proj_exception(env(), m_lctx, e);
+        if (!is_pi(r)) throw invalid_proj_exception(env(), m_lctx.to_local_ctx(), e);
         if (has_loose_bvars(binding_body(r))) {
             if (is_prop_type && !is_prop(binding_domain(r)))
-                throw invalid_proj_exception(env(), m_lctx, e);
+                throw invalid_proj_exception(env(), m_lctx.to_local_ctx(), e);
             r = instantiate(binding_body(r), mk_proj(I_name, i, proj_expr(e)));
         } else {
             r = binding_body(r);
         }
     }
     r = whnf(r);
-    if (!is_pi(r)) throw invalid_proj_exception(env(), m_lctx, e);
+    if (!is_pi(r)) throw invalid_proj_exception(env(), m_lctx.to_local_ctx(), e);
     r = binding_domain(r);
     if (is_prop_type && !is_prop(r))
-        throw invalid_proj_exception(env(), m_lctx, e);
+        throw invalid_proj_exception(env(), m_lctx.to_local_ctx(), e);
     return r;
 }
 
@@ -294,9 +406,20 @@ expr type_checker::infer_type_core(expr const & e, bool infer_only) {
     lean_assert(!has_loose_bvars(e));
     check_system("type checker", /* do_check_interrupted */ true);
 
+    count(&kernel_profile::m_infer_type);
     auto it = m_st->m_infer_type[infer_only].find(e);
-    if (it != m_st->m_infer_type[infer_only].end())
+    if (it != m_st->m_infer_type[infer_only].end()) {
+        count(&kernel_profile::m_infer_type_hits);
         return it->second;
+    }
+    bool shared = infer_only && m_shared && is_shareable(e);
+    if (shared) {
+        if (auto r = m_shared->find_infer(e, m_shared_prefix)) {
+            check_cache_budget();
+            m_st->m_infer_type[infer_only].insert(mk_pair(e, *r));
+            return *r;
+        }
+    }
 
     expr r;
     switch (e.kind()) {
@@ -318,7 +441,10 @@ expr type_checker::infer_type_core(expr const & e, bool infer_only) {
     case expr_kind::Let:      r = infer_let(e, infer_only);            break;
     }
 
+    check_cache_budget();
     m_st->m_infer_type[infer_only].insert(mk_pair(e, r));
+    if (shared)
+        m_shared->insert_infer(e, r, m_shared_prefix);
     return r;
 }
 
@@ -346,7 +472,12 @@ expr type_checker::ensure_pi(expr const & e, expr const & s) {
 
 /** \brief Return true iff \c e is a proposition */
 bool type_checker::is_prop(expr const & e) {
-    return whnf(infer_type(e)) == mk_Prop();
+    auto it = m_st->m_is_prop.find(e);
+    if (it != m_st->m_is_prop.end())
+        return it->second;
+    bool r = whnf(infer_type(e)) == mk_Prop();
+    m_st->m_is_prop.insert(mk_pair(e, r));
+    return r;
 }
 
 /** \brief Apply normalizer extensions to \c e.
@@ -407,7 +538,7 @@ optional<expr> type_checker::reduce_proj(expr const & e, bool cheap_rec, bool ch
     return reduce_proj_core(c, idx);
 }
 
-static bool is_let_fvar(local_ctx const & lctx, expr const & e) {
+static bool is_let_fvar(indexed_local_ctx const & lctx, expr const & e) {
     lean_assert(is_fvar(e));
     if (optional<local_decl> decl = lctx.find_local_decl(e)) {
         return static_cast<bool>(decl->get_value());
@@ -441,9 +572,12 @@ expr type_checker::whnf_core(expr const & e, bool cheap_rec, bool cheap_proj) {
     }
 
     // check cache
+    count(&kernel_profile::m_whnf_core);
     auto it = m_st->m_whnf_core.find(e);
-    if (it != m_st->m_whnf_core.end())
+    if (it != m_st->m_whnf_core.end()) {
+        count(&kernel_profile::m_whnf_core_hits);
         return it->second;
+    }
 
     // do the actual work
     expr r;
@@ -498,6 +632,7 @@ expr type_checker::whnf_core(expr const & e, bool cheap_rec, bool cheap_proj) {
     }
 
     if (!cheap_rec && !cheap_proj) {
+        check_cache_budget();
         m_st->m_whnf_core.insert(mk_pair(e, r));
     }
     return r;
@@ -505,24 +640,34 @@ expr type_checker::whnf_core(expr const & e, bool cheap_rec, bool cheap_proj) {
 
 /** \brief Return some definition \c d iff \c e is a target for delta-reduction, and the given definition is the one
     to be expanded. */
-optional<constant_info> type_checker::is_delta(expr const & e) const {
+optional<constant_info> type_checker::is_delta(expr const & e) {
     expr const & f = get_app_fn(e);
     if (is_constant(f)) {
-        if (optional<constant_info> info = env().find(const_name(f)))
-            if (info->has_value())
-                return info;
+        constant_info const * info = find_constant(const_name(f));
+        if (info && info->has_value())
+            return optional<constant_info>(*info);
     }
     return none_constant_info();
 }
 
-optional<expr> type_checker::unfold_definition_core(expr const & e) {
+/* Unfold the constant `e` applied to the arguments `rev_args` (in reverse order), and beta reduce
+   the result with the arguments. */
+optional<expr> type_checker::unfold_definition_core(expr const & e, unsigned n, expr const * rev_args) {
     if (is_constant(e)) {
         if (auto d = is_delta(e)) {
             if (length(const_levels(e)) == d->get_num_lparams()) {
                 if (m_diag) {
                     m_diag->record_unfold(d->get_name());
                 }
-                return some_expr(instantiate_value_lparams(*d, const_levels(e)));
+                if (is_nil(const_levels(e)) || !has_param_univ(d->get_value()))
+                    return some_expr(instantiate_value_lparams_beta(*d, const_levels(e), n, rev_args));
+                auto it = m_st->m_value_lparams.find(e);
+                if (it != m_st->m_value_lparams.end())
+                    return some_expr(instantiate_lambdas_beta(it->second, n, rev_args));
+                expr v = instantiate_value_lparams(*d, const_levels(e));
+                check_cache_budget();
+                m_st->m_value_lparams.insert(mk_pair(e, v));
+                return some_expr(instantiate_lambdas_beta(v, n, rev_args));
             }
         }
     }
@@ -532,16 +677,14 @@ optional<expr> type_checker::unfold_definition_core(expr const & e) {
 /* Unfold head(e) if it is a constant */
 optional<expr> type_checker::unfold_definition(expr const & e) {
     if (is_app(e)) {
-        expr f0 = get_app_fn(e);
-        if (auto f  = unfold_definition_core(f0)) {
-            buffer<expr> args;
-            get_app_rev_args(e, args);
-            return some_expr(mk_rev_app(*f, args));
-        } else {
+        expr const & f0 = get_app_fn(e);
+        if (!is_constant(f0))
             return none_expr();
-        }
+        buffer<expr> args;
+        get_app_rev_args(e, args);
+        return unfold_definition_core(f0, args.size(), args.data());
     } else {
-        return unfold_definition_core(e);
+        return unfold_definition_core(e, 0, nullptr);
     }
 }
 
@@ -617,6 +760,40 @@ template<typename F> optional<expr> type_checker::reduce_bin_nat_pred(F const &
     return f(v1.raw(), v2.raw()) ? some_expr(mk_bool_true()) : some_expr(mk_bool_false());
 }
 
+static bool nat_test_bit(b_obj_arg m, b_obj_arg n) {
+    nat r(lean_nat_shiftr(m, n));
+    nat b(lean_nat_land(lean_box(1), r.raw()));
+    return !b.is_zero();
+}
+
+typedef obj_res (*nat_bin_op)(b_obj_arg, b_obj_arg);
+typedef bool (*nat_bin_pred)(b_obj_arg, b_obj_arg);
+
+/* Binary `Nat` functions evaluated on literals by the kernel. Exactly one of `m_op` and `m_pred` is set.
+   `Nat.pow` is handled separately since it needs a bound on the exponent. */
+struct nat_bin_reducer {
+    expr **      m_fn;
+    nat_bin_op   m_op;
+    nat_bin_pred m_pred;
+};
+
+static nat_bin_reducer const g_nat_bin_reducers[] = {
+    {&g_nat_add,        nat_add,         nullptr},
+    {&g_nat_sub,        nat_sub,         nullptr},
+    {&g_nat_mul,        nat_mul,         nullptr},
+    {&g_nat_gcd,        nat_gcd,         nullptr},
+    {&g_nat_mod,        nat_mod,         nullptr},
+    {&g_nat_div,        nat_div,         nullptr},
+    {&g_nat_land,       nat_land,        nullptr},
+    {&g_nat_lor,        nat_lor,         nullptr},
+    {&g_nat_xor,        nat_lxor,        nullptr},
+    {&g_nat_shiftLeft,  lean_nat_shiftl, nullptr},
+    {&g_nat_shiftRight, lean_nat_shiftr, nullptr},
+    {&g_nat_beq,        nullptr,         nat_eq},
+    {&g_nat_ble,        nullptr,         nat_le},
+    {&g_nat_testBit,    nullptr,         nat_test_bit},
+};
+
 optional<expr> type_checker::reduce_nat(expr const & e) {
     unsigned nargs = get_app_num_args(e);
     if (nargs == 1) {
@@ -627,23 +804,20 @@ optional<expr> type_checker::reduce_nat(expr const & e) {
             nat v = get_nat_val(arg);
             return some_expr(mk_lit(literal(nat(v+nat(1)))));
         }
+        if (f == *g_nat_log2) {
+            expr arg = whnf(app_arg(e));
+            if (!is_nat_lit_ext(arg)) return none_expr();
+            nat v = get_nat_val(arg);
+            return some_expr(mk_lit(literal(nat(lean_nat_log2(v.raw())))));
+        }
     } else if (nargs == 2) {
         expr const & f = app_fn(app_fn(e));
         if (!is_constant(f)) return none_expr();
-        if (f == *g_nat_add) return reduce_bin_nat_op(nat_add, e);
-        if (f == *g_nat_sub) return reduce_bin_nat_op(nat_sub, e);
-        if (f == *g_nat_mul) return reduce_bin_nat_op(nat_mul, e);
         if (f == *g_nat_pow) return reduce_pow(e);
-        if (f == *g_nat_gcd) return reduce_bin_nat_op(nat_gcd, e);
-        if (f == *g_nat_mod) return reduce_bin_nat_op(nat_mod, e);
-        if (f == *g_nat_div) return reduce_bin_nat_op(nat_div, e);
-        if (f == *g_nat_beq) return reduce_bin_nat_pred(nat_eq, e);
-        if (f == *g_nat_ble) return reduce_bin_nat_pred(nat_le, e);
-        if (f == *g_nat_land) return reduce_bin_nat_op(nat_land, e);
-        if (f == *g_nat_lor)  return reduce_bin_nat_op(nat_lor, e);
-        if (f == *g_nat_xor)  return reduce_bin_nat_op(nat_lxor, e);
-        if (f == *g_nat_shiftLeft) return reduce_bin_nat_op(lean_nat_shiftl, e);
-        if (f == *g_nat_shiftRight) return reduce_bin_nat_op(lean_nat_shiftr, e);
+        for (nat_bin_reducer const & r : g_nat_bin_reducers) {
+            if (f == **r.m_fn)
+                return r.m_op ? reduce_bin_nat_op(r.m_op, e) : reduce_bin_nat_pred(r.m_pred, e);
+        }
     }
     return none_expr();
 }
@@ -668,26 +842,37 @@ expr type_checker::whnf(expr const & e) {
     }
 
     // check cache
+    count(&kernel_profile::m_whnf);
     auto it = m_st->m_whnf.find(e);
-    if (it != m_st->m_whnf.end())
+    if (it != m_st->m_whnf.end()) {
+        count(&kernel_profile::m_whnf_hits);
         return it->second;
+    }
+    bool shared = m_shared && is_shareable(e);
+    if (shared) {
+        if (auto r = m_shared->find_whnf(e, m_shared_prefix)) {
+            check_cache_budget();
+            m_st->m_whnf.insert(mk_pair(e, *r));
+            return *r;
+        }
+    }
 
     expr t = e;
     while (true) {
         expr t1 = whnf_core(t);
-        if (auto v = reduce_native(env(), t1)) {
-            m_st->m_whnf.insert(mk_pair(e, *v));
-            return *v;
-        } else if (auto v = reduce_nat(t1)) {
-            m_st->m_whnf.insert(mk_pair(e, *v));
-            return *v;
+        optional<expr> v = reduce_native(env(), t1);
+        if (!v) v = reduce_nat(t1);
+        if (v) {
+            t1 = *v;
         } else if (auto next_t = unfold_definition(t1)) {
             t = *next_t;
-        } else {
-            auto r = t1;
-            m_st->m_whnf.insert(mk_pair(e, r));
-            return r;
+            continue;
         }
+        check_cache_budget();
+        m_st->m_whnf.insert(mk_pair(e, t1));
+        if (shared)
+            m_shared->insert_whnf(e, t1, m_shared_prefix);
+        return t1;
     }
 }
 
@@ -701,7 +886,7 @@ expr type_checker::whnf(expr const & e) {
 bool type_checker::is_def_eq_binding(expr t, expr s) {
     lean_assert(t.kind() == s.kind());
     lean_assert(is_binding(t));
-    flet<local_ctx> save_lctx(m_lctx, m_lctx);
+    indexed_local_ctx::scope save_lctx(m_lctx);
     expr_kind k = t.kind();
     buffer<expr> subst;
     do {
@@ -749,8 +934,10 @@ bool type_checker::is_def_eq(levels const & ls1, levels const & ls2) {
 
 /** \brief This is an auxiliary method for is_def_eq. It handles the "easy cases". */
 lbool type_checker::quick_is_def_eq(expr const & t, expr const & s, bool use_hash) {
-    if (m_st->m_eqv_manager.is_equiv(t, s, use_hash))
+    if (m_st->m_eqv_manager.is_equiv(t, s, use_hash)) {
+        count(&kernel_profile::m_eqv_hits);
         return l_true;
+    }
     if (t.kind() == s.kind()) {
         switch (t.kind()) {
         case expr_kind::Lambda: case expr_kind::Pi:
@@ -804,7 +991,7 @@ bool type_checker::try_eta_expansion_core(expr const & t, expr const & s) {
 bool type_checker::try_eta_struct_core(expr const & t, expr const & s) {
     expr f = get_app_fn(s);
     if (!is_constant(f)) return false;
-    constant_info f_info = env().get(const_name(f));
+    constant_info f_info = get_constant(const_name(f));
     if (!f_info.is_constructor()) return false;
     constructor_val f_val = f_info.to_constructor_val();
     if (get_app_num_args(s) != f_val.get_nparams() + f_val.get_nfields()) return false;
@@ -845,6 +1032,13 @@ bool type_checker::is_def_eq_app(expr const & t, expr const & s) {
 /** \brief Return true if \c t and \c s are definitionally equal due to proof irrelevant.
     Return false otherwise. */
 lbool type_checker::is_def_eq_proof_irrel(expr const & t, expr const & s) {
+    // Sorts, function types and literals are never proofs, so their type does not need to be inferred
+    switch (t.kind()) {
+    case expr_kind::Sort: case expr_kind::Pi: case expr_kind::Lit:
+        return l_undef;
+    default:
+        break;
+    }
     // Proof irrelevance support for Prop (aka Type.{0})
     expr t_type = infer_type(t);
     if (!is_prop(t_type))
@@ -854,18 +1048,24 @@ lbool type_checker::is_def_eq_proof_irrel(expr const & t, expr const & s) {
 }
 
 bool type_checker::failed_before(expr const & t, expr const & s) const {
+    count(&kernel_profile::m_failure_checks);
+    bool r;
     if (hash(t) < hash(s)) {
-        return m_st->m_failure.find(mk_pair(t, s)) != m_st->m_failure.end();
+        r = m_st->m_failure.find(mk_pair(t, s)) != m_st->m_failure.end();
     } else if (hash(t) > hash(s)) {
-        return m_st->m_failure.find(mk_pair(s, t)) != m_st->m_failure.end();
+        r = m_st->m_failure.find(mk_pair(s, t)) != m_st->m_failure.end();
     } else {
-        return
+        r =
             m_st->m_failure.find(mk_pair(t, s)) != m_st->m_failure.end() ||
             m_st->m_failure.find(mk_pair(s, t)) != m_st->m_failure.end();
     }
+    if (r)
+        count(&kernel_profile::m_failure_hits);
+    return r;
 }
 
 void type_checker::cache_failure(expr const & t, expr const & s) {
+    check_cache_budget();
     if (hash(t) <= hash(s))
         m_st->m_failure.insert(mk_pair(t, s));
     else
@@ -893,6 +1093,7 @@ optional<expr> type_checker::try_unfold_proj_app(expr const & e) {
 
      \remark t_n, s_n and cs are updated. */
 auto type_checker::lazy_delta_reduction_step(expr & t_n, expr & s_n) -> reduction_status {
+    count(&kernel_profile::m_lazy_delta_steps);
     auto d_t = is_delta(t_n);
     auto d_s = is_delta(s_n);
     if (!d_t && !d_s) {
@@ -1066,6 +1267,7 @@ bool type_checker::is_def_eq_unit_like(expr const & t, expr const & s) {
 
 bool type_checker::is_def_eq_core(expr const & t, expr const & s) {
     check_system("is_definitionally_equal", /* do_check_interrupted */ true);
+    count(&kernel_profile::m_is_def_eq_core);
     bool use_hash = true;
     lbool r = quick_is_def_eq(t, s, use_hash);
     if (r != l_undef) return r == l_true;
@@ -1142,15 +1344,25 @@ bool type_checker::is_def_eq_core(expr const & t, expr const & s) {
 }
 
 bool type_checker::is_def_eq(expr const & t, expr const & s) {
+    bool shared = m_shared && is_shareable(t) && is_shareable(s);
+    if (shared && m_shared->is_equiv(t, s, m_shared_prefix)) {
+        count(&kernel_profile::m_eqv_hits);
+        return true;
+    }
     bool r = is_def_eq_core(t, s);
-    if (r)
+    if (r) {
+        count(&kernel_profile::m_eqv_merges);
+        check_cache_budget();
         m_st->m_eqv_manager.add_equiv(t, s);
+        if (shared)
+            m_shared->add_equiv(t, s, m_shared_prefix);
+    }
     return r;
 }
 
 expr type_checker::eta_expand(expr const & e) {
     buffer<expr> fvars;
-    flet<local_ctx> save_lctx(m_lctx, m_lctx);
+    indexed_local_ctx::scope save_lctx(m_lctx);
     expr it = e;
     while (is_lambda(it)) {
         expr d = instantiate_rev(binding_domain(it), fvars.size(), fvars.data());
@@ -1173,16 +1385,21 @@ expr type_checker::eta_expand(expr const & e) {
 
 type_checker::type_checker(environment const & env, local_ctx const & lctx, diagnostics * diag, definition_safety ds):
     m_st_owner(true), m_st(new state(env)), m_diag(diag),
+    m_shared(diag || ds != definition_safety::safe ? nullptr : g_shared_kernel_cache),
+    m_shared_prefix(g_shared_kernel_cache_prefix), m_profile(g_kernel_profile),
     m_lctx(lctx), m_definition_safety(ds), m_lparams(nullptr) {
 }
 
 type_checker::type_checker(state & st, local_ctx const & lctx, definition_safety ds):
-    m_st_owner(false), m_st(&st), m_diag(nullptr), m_lctx(lctx),
+    m_st_owner(false), m_st(&st), m_diag(nullptr), m_shared(nullptr), m_shared_prefix(0), m_profile(nullptr),
+    m_lctx(lctx),
     m_definition_safety(ds), m_lparams(nullptr) {
 }
 
 type_checker::type_checker(type_checker && src):
-    m_st_owner(src.m_st_owner), m_st(src.m_st), m_diag(src.m_diag), m_lctx(std::move(src.m_lctx)),
+    m_st_owner(src.m_st_owner), m_st(src.m_st), m_diag(src.m_diag), m_shared(src.m_shared),
+    m_shared_prefix(src.m_shared_prefix), m_profile(src.m_profile),
+    m_lctx(std::move(src.m_lctx)),
     m_definition_safety(src.m_definition_safety), m_lparams(src.m_lparams) {
     src.m_st_owner = false;
 }
@@ -1220,10 +1437,14 @@ void initialize_type_checker() {
     g_nat_xor      = new_persistent_expr_const({"Nat", "xor"});
     g_nat_shiftLeft  = new_persistent_expr_const({"Nat", "shiftLeft"});
     g_nat_shiftRight = new_persistent_expr_const({"Nat", "shiftRight"});
+    g_nat_testBit  = new_persistent_expr_const({"Nat", "testBit"});
+    g_nat_log2     = new_persistent_expr_const({"Nat", "log2"});
     g_string_mk    = new_persistent_expr_const({"String", "mk"});
     g_lean_reduce_bool = new_persistent_expr_const({"Lean", "reduceBool"});
     g_lean_reduce_nat  = new_persistent_expr_const({"Lean", "reduceNat"});
     register_name_generator_prefix(*g_kernel_fresh);
+    if (char const * budget = std::getenv("LEAN_KERNEL_CACHE_BUDGET"))
+        set_kernel_cache_budget(std::strtoull(budget, nullptr, 10));
 }
 
 void finalize_type_checker() {
@@ -1246,6 +1467,8 @@ void finalize_type_checker() {
     delete g_nat_xor;
     delete g_nat_shiftLeft;
     delete g_nat_shiftRight;
+    delete g_nat_testBit;
+    delete g_nat_log2;
     delete g_string_mk;
     delete g_lean_reduce_bool;
     delete g_lean_reduce_nat;
@@ -6,12 +6,15 @@ Author: Leonardo de Moura
 */
 #pragma once
 #include <unordered_set>
+#include <unordered_map>
 #include <memory>
 #include <utility>
 #include <algorithm>
 #include "runtime/flet.h"
+#include "runtime/mutex.h"
 #include "util/lbool.h"
 #include "util/name_set.h"
+#include "util/name_flat_map.h"
 #include "util/name_generator.h"
 #include "kernel/environment.h"
 #include "kernel/local_ctx.h"
@@ -19,23 +22,100 @@ Author: Leonardo de Moura
 #include "kernel/equiv_manager.h"
 
 namespace lean {
+/** \brief Size-bounded cache of `whnf` and `infer` results for closed terms (no free variables
+    and no universe parameters) shared by all type checkers created in the scope of a
+    `scope_shared_kernel_cache`. It also records definitional equalities between closed terms
+    proven by any of the type checkers. It is safe to use from several threads; all cached terms
+    are marked as multi-threaded. When the cache exceeds its capacity, it is cleared.
+
+    The type checkers must work on environments `E_0 ⊆ E_1 ⊆ ...` that extend each other, e.g.,
+    the prefixes of a batch of declarations, and pass the index of their environment as `prefix`.
+    The cache is keyed on this index: every entry records the smallest index it was computed at,
+    and is only returned to type checkers at that index or a larger one. A result computed in an
+    environment remains valid in its extensions, but not the other way around, since a term may
+    refer to a constant that does not exist yet in a smaller environment. */
+class shared_kernel_cache {
+    typedef expr_flat_map<pair<expr, unsigned>> cache;
+    typedef std::unordered_map<expr_pair, unsigned, expr_pair_hash, expr_pair_eq> equiv_cache;
+    mutex               m_mutex;
+    size_t              m_capacity;
+    cache               m_whnf;
+    cache               m_infer_type;
+    equiv_cache         m_equiv;
+    optional<expr> find(cache & m, expr const & e, unsigned prefix);
+    void insert(cache & m, expr const & e, expr const & r, unsigned prefix);
+public:
+    shared_kernel_cache(size_t capacity = 1u << 16):m_capacity(capacity) {}
+    optional<expr> find_whnf(expr const & e, unsigned prefix) { return find(m_whnf, e, prefix); }
+    optional<expr> find_infer(expr const & e, unsigned prefix) { return find(m_infer_type, e, prefix); }
+    void insert_whnf(expr const & e, expr const & r, unsigned prefix) { insert(m_whnf, e, r, prefix); }
+    void insert_infer(expr const & e, expr const & r, unsigned prefix) { insert(m_infer_type, e, r, prefix); }
+    bool is_equiv(expr const & t, expr const & s, unsigned prefix);
+    void add_equiv(expr const & t, expr const & s, unsigned prefix);
+};
+
+/* Update the thread local shared kernel cache (`nullptr` if unset) and the index of the
+   environment of the type checkers using it, see `shared_kernel_cache`. */
+class scope_shared_kernel_cache {
+    flet<shared_kernel_cache *> m_cache;
+    flet<unsigned>              m_prefix;
+public:
+    scope_shared_kernel_cache(shared_kernel_cache * c, unsigned prefix);
+};
+
+/** \brief Counters collected by type checkers created in the scope of a `scope_kernel_profile`. */
+struct kernel_profile {
+    uint64 m_whnf_core{0};
+    uint64 m_whnf_core_hits{0};
+    uint64 m_whnf{0};
+    uint64 m_whnf_hits{0};
+    uint64 m_infer_type{0};
+    uint64 m_infer_type_hits{0};
+    uint64 m_is_def_eq_core{0};
+    uint64 m_eqv_hits{0};
+    uint64 m_eqv_merges{0};
+    uint64 m_failure_checks{0};
+    uint64 m_failure_hits{0};
+    uint64 m_lazy_delta_steps{0};
+    uint64 m_cache_resets{0};
+};
+
+/* Update the thread local kernel profile (`nullptr` if unset) */
+class scope_kernel_profile : flet<kernel_profile *> {
+public:
+    scope_kernel_profile(kernel_profile * p);
+};
+
 /** \brief Lean Type Checker. It can also be used to infer types, check whether a
     type \c A is convertible to a type \c B, etc. */
 class type_checker {
 public:
     class state {
-        typedef expr_map<expr> infer_cache;
+        typedef expr_flat_map<expr> infer_cache;
         typedef std::unordered_set<expr_pair, expr_pair_hash, expr_pair_eq> expr_pair_set;
         environment               m_env;
         name_generator            m_ngen;
         infer_cache               m_infer_type[2];
-        expr_map<expr>            m_whnf_core;
-        expr_map<expr>            m_whnf;
+        expr_flat_map<expr>       m_whnf_core;
+        expr_flat_map<expr>       m_whnf;
+        /* Results of `is_prop`, which is called on the type of both sides of most `is_def_eq_core`
+           calls through `is_def_eq_proof_irrel`. */
+        expr_flat_map<bool>       m_is_prop;
+        /* Values of universe polymorphic definitions instantiated with the levels of the constant
+           used as the key, so that unfolding the same constant again only instantiates the
+           arguments. */
+        expr_flat_map<expr>       m_value_lparams;
         equiv_manager             m_eqv_manager;
         expr_pair_set             m_failure;
+        /* Constants looked up by the type checker, to avoid an environment lookup per
+           `infer_constant` and lazy delta step. */
+        name_flat_map<constant_info> m_constants;
         friend type_checker;
     public:
         state(environment const & env);
+        /** \brief Return the number of entries in all caches. */
+        size_t num_cache_entries() const;
+        void clear_caches();
         environment & env() { return m_env; }
         environment const & env() const { return m_env; }
         name_generator & ngen() { return m_ngen; }
@@ -44,12 +124,22 @@ private:
     bool                      m_st_owner;
     state *                   m_st;
     diagnostics *             m_diag;
-    local_ctx                 m_lctx;
+    /* Cache shared with other type checkers, `nullptr` if not available. It is not used when
+       collecting diagnostics, since cache hits would not record unfoldings. */
+    shared_kernel_cache *     m_shared;
+    /* Index of the environment in the sequence of environments sharing `m_shared`. */
+    unsigned                  m_shared_prefix;
+    /* Profile counters, `nullptr` if profiling is disabled. */
+    kernel_profile *          m_profile;
+    indexed_local_ctx         m_lctx;
     definition_safety         m_definition_safety;
     /* When `m_lparams != nullptr, the `check` method makes sure all level parameters
        are in `m_lparams`. */
     names const *             m_lparams;
 
+    void count(uint64 kernel_profile::* c) const { if (m_profile) (m_profile->*c)++; }
+    void check_cache_budget();
+
     expr ensure_sort_core(expr e, expr const & s);
     expr ensure_pi_core(expr e, expr const & s);
     void check_level(level const & l);
@@ -68,8 +158,10 @@ private:
     optional<expr> reduce_proj_core(expr c, unsigned idx);
     optional<expr> reduce_proj(expr const & e, bool cheap_rec, bool cheap_proj);
     expr whnf_fvar(expr const & e, bool cheap_rec, bool cheap_proj);
-    optional<constant_info> is_delta(expr const & e) const;
-    optional<expr> unfold_definition_core(expr const & e);
+    constant_info const * find_constant(name const & n);
+    constant_info get_constant(name const & n);
+    optional<constant_info> is_delta(expr const & e);
+    optional<expr> unfold_definition_core(expr const & e, unsigned n, expr const * rev_args);
 
     bool is_def_eq_binding(expr t, expr s);
     bool is_def_eq(level const & l1, level const & l2);
@@ -163,6 +255,12 @@ public:
     optional<expr> unfold_definition(expr const & e);
 };
 
+/** \brief Set the maximum number of entries kept in the caches of a type checker, `0` means unbounded.
+    When the budget is exceeded, all caches of the type checker are cleared. The initial value is taken
+    from the `LEAN_KERNEL_CACHE_BUDGET` environment variable. */
+void set_kernel_cache_budget(size_t num_entries);
+size_t get_kernel_cache_budget();
+
 void initialize_type_checker();
 void finalize_type_checker();
 }
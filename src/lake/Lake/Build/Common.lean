@@ -53,6 +53,8 @@ which stores information about a (successful) build.
 structure BuildMetadata where
   depHash : Hash
   log : Log
+  /-- How long the build took, in milliseconds. -/
+  elapsed? : Option Nat := none
   deriving ToJson
 
 def BuildMetadata.ofHash (h : Hash) : BuildMetadata :=
@@ -62,10 +64,23 @@ def BuildMetadata.fromJson? (json : Json) : Except String BuildMetadata := do
   let obj ← JsonObject.fromJson? json
   let depHash ← obj.get "depHash"
   let log ← obj.getD "log" {}
-  return {depHash, log}
+  let elapsed? ← obj.get? "elapsed"
+  return {depHash, log, elapsed?}
 
 instance : FromJson BuildMetadata := ⟨BuildMetadata.fromJson?⟩
 
+/--
+The task priority for rebuilding an artifact, based on how long its previous build took.
+Builds that took longer are started first, so that they are less likely to be the last jobs
+still running at the end of a parallel build. Builds of less than a second keep the default
+priority. Above that, the priority grows by one each time the build time doubles, and builds of
+64 seconds or more get `Task.Priority.max`.
+-/
+def BuildMetadata.priority (data : BuildMetadata) : Task.Priority :=
+  match data.elapsed? with
+  | some ms => if ms < 1000 then .default else min Task.Priority.max (Nat.log2 (ms / 1000) + 2)
+  | none => .default
+
 /-- Read persistent trace data from a file. -/
 def readTraceFile? (path : FilePath) : LogIO (Option BuildMetadata) := OptionT.run do
   match (← IO.FS.readFile path |>.toBaseIO) with
@@ -80,9 +95,11 @@ def readTraceFile? (path : FilePath) : LogIO (Option BuildMetadata) := OptionT.r
   | .error e => logWarning s!"{path}: read failed: {e}"; failure
 
 /-- Write persistent trace data to a file. -/
-def writeTraceFile (path : FilePath) (depTrace : BuildTrace) (log : Log) := do
+def writeTraceFile
+  (path : FilePath) (depTrace : BuildTrace) (log : Log) (elapsed? : Option Nat := none)
+:= do
   createParentDirs path
-  let data := {log, depHash := depTrace.hash : BuildMetadata}
+  let data := {log, depHash := depTrace.hash, elapsed? : BuildMetadata}
   IO.FS.writeFile path (toJson data).pretty
 
 /--
@@ -146,9 +163,11 @@ where
     else
       updateAction action
       let iniPos ← getLogPos
+      let start ← IO.monoMsNow
       build -- fatal errors will not produce a trace (or cache their log)
+      let elapsed := (← IO.monoMsNow) - start
       let log := (← getLog).takeFrom iniPos
-      writeTraceFile traceFile depTrace log
+      writeTraceFile traceFile depTrace log elapsed
       return false
 
 /--
@@ -184,15 +184,20 @@ all possible artifacts (i.e., `.olean`, `ilean`, `.c`, and `.bc`).
 -/
 def Module.recBuildLean (mod : Module) : FetchM (Job Unit) := do
   withRegisterJob mod.name.toString do
-  (← mod.deps.fetch).mapM fun {dynlibs, plugins} => do
+  -- Start modules that took long to elaborate in the previous build first, see `BuildMetadata.priority`.
+  let prio := (← readTraceFile? mod.traceFile).elim Task.Priority.default (·.priority)
+  -- Precompiled modules are loaded by the interpreter, which indexes their native symbols.
+  let leanArgs :=
+    if mod.shouldPrecompile then mod.leanArgs.push "-Dcompiler.symbolTable=true" else mod.leanArgs
+  (← mod.deps.fetch).mapM (prio := prio) fun {dynlibs, plugins} => do
     addLeanTrace
-    addPureTrace mod.leanArgs
+    addPureTrace leanArgs
     let srcTrace ← computeTrace (TextFilePath.mk mod.leanFile)
     addTrace srcTrace
     let upToDate ← buildUnlessUpToDate? (oldTrace := srcTrace.mtime) mod (← getTrace) mod.traceFile do
       compileLeanModule mod.leanFile mod.oleanFile mod.ileanFile mod.cFile mod.bcFile?
         (← getLeanPath) mod.rootDir dynlibs plugins
-        (mod.weakLeanArgs ++ mod.leanArgs) (← getLean)
+        (mod.weakLeanArgs ++ leanArgs) (← getLean)
       mod.clearOutputHashes
     unless upToDate && (← getTrustHash) do
       mod.cacheOutputHashes
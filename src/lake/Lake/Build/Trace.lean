@@ -163,7 +163,9 @@ Compute the hash of a binary file.
 Binary files are equivalent only if they are byte identical.
 -/
 def computeBinFileHash (file : FilePath) : IO Hash :=
-  Hash.ofByteArray <$> IO.FS.readBinFile file
+  -- Same as `Hash.ofByteArray <$> IO.FS.readBinFile file`, without copying the file into memory.
+  -- Not mapped, as the file may be truncated by a concurrent build while it is being hashed.
+  Hash.mk <$> IO.FS.hashBinFile file
 
 instance : ComputeHash FilePath IO := ⟨computeBinFileHash⟩
 
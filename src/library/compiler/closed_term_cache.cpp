@@ -10,6 +10,7 @@ Author: Leonardo de Moura
 namespace lean {
 extern "C" object * lean_cache_closed_term_name(object * env, object * e, object * n);
 extern "C" object * lean_get_closed_term_name(object * env, object * e);
+extern "C" object * lean_disable_closed_term_sharing(object * env);
 
 optional<name> get_closed_term_name(elab_environment const & env, expr const & e) {
     return to_optional<name>(lean_get_closed_term_name(env.to_obj_arg(), e.to_obj_arg()));
@@ -18,4 +19,8 @@ optional<name> get_closed_term_name(elab_environment const & env, expr const & e
 elab_environment cache_closed_term_name(elab_environment const & env, expr const & e, name const & n) {
     return elab_environment(lean_cache_closed_term_name(env.to_obj_arg(), e.to_obj_arg(), n.to_obj_arg()));
 }
+
+elab_environment disable_closed_term_sharing(elab_environment const & env) {
+    return elab_environment(lean_disable_closed_term_sharing(env.to_obj_arg()));
+}
 }
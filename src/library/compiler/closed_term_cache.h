@@ -9,4 +9,6 @@ Author: Leonardo de Moura
 namespace lean {
 optional<name> get_closed_term_name(elab_environment const & env, expr const & e);
 elab_environment cache_closed_term_name(elab_environment const & env, expr const & e, name const & n);
+/* Make sure that no other module refers to the closed terms of the current one. */
+elab_environment disable_closed_term_sharing(elab_environment const & env);
 }
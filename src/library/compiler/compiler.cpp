@@ -23,6 +23,7 @@ Author: Leonardo de Moura
 #include "library/compiler/implemented_by_attribute.h"
 #include "library/compiler/lambda_lifting.h"
 #include "library/compiler/extract_closed.h"
+#include "library/compiler/closed_term_cache.h"
 #include "library/compiler/reduce_arity.h"
 #include "library/compiler/ll_infer_type.h"
 #include "library/compiler/simp_app_args.h"
@@ -34,6 +35,7 @@ Author: Leonardo de Moura
 
 namespace lean {
 static name * g_extract_closed = nullptr;
+static name * g_lazy_closed_terms = nullptr;
 
 bool is_extract_closed_enabled(options const & opts) { return opts.get_bool(*g_extract_closed, true); }
 
@@ -158,6 +160,20 @@ bool is_main_fn_type(expr const & type) {
 
 #define trace_compiler(k, ds) lean_trace(k, trace_comp_decls(ds););
 
+static void trace_comp_decls_size(elab_environment const & env, char const * pass, comp_decls const & ds) {
+    for (comp_decl const & d : ds) {
+        tout() << pass << " " << d.fst() << " " << get_lcnf_size(env, d.snd()) << "\n";
+    }
+}
+
+/* Run `...` as the compiler pass `pass` of `compile`. Its time is reported under the profiler category
+   `compilation <pass>`, and the LCNF size of the resulting declarations under `trace.compiler.size`. */
+#define compiler_pass(pass, env, ...) {                                              \
+        time_task _pass_task("compilation " pass, opts, head(cs));                   \
+        __VA_ARGS__;                                                                 \
+    }                                                                                \
+    lean_trace(name({"compiler", "size"}), trace_comp_decls_size(env, pass, ds););
+
 extern "C" object* lean_csimp_replace_constants(object* env, object* n);
 
 expr csimp_replace_constants(elab_environment const & env, expr const & e) {
@@ -205,21 +221,19 @@ elab_environment compile(elab_environment const & env, options const & opts, nam
     auto simp  = [&](elab_environment const & env, expr const & e) { return csimp(env, e, cfg); };
     auto esimp = [&](elab_environment const & env, expr const & e) { return cesimp(env, e, cfg); };
     trace_compiler(name({"compiler", "input"}), ds);
-    ds = apply(eta_expand, env, ds);
+    compiler_pass("eta_expand", env, ds = apply(eta_expand, env, ds));
     trace_compiler(name({"compiler", "eta_expand"}), ds);
-    ds = apply(to_lcnf, env, ds);
-    ds = apply(find_jp, env, ds);
+    compiler_pass("lcnf", env, ds = apply(to_lcnf, env, ds); ds = apply(find_jp, env, ds));
     // trace(ds);
     trace_compiler(name({"compiler", "lcnf"}), ds);
     // trace(ds);
-    ds = apply(cce, env, ds);
+    compiler_pass("cce", env, ds = apply(cce, env, ds));
     trace_compiler(name({"compiler", "cce"}), ds);
-    ds = apply(csimp_replace_constants, env, ds);
-    ds = apply(simp, env, ds);
+    compiler_pass("simp", env, ds = apply(csimp_replace_constants, env, ds); ds = apply(simp, env, ds));
     trace_compiler(name({"compiler", "simp"}), ds);
     // trace(ds);
     elab_environment new_env = env;
-    std::tie(new_env, ds) = eager_lambda_lifting(new_env, ds, cfg);
+    compiler_pass("eager_lambda_lifting", new_env, std::tie(new_env, ds) = eager_lambda_lifting(new_env, ds, cfg));
     trace_compiler(name({"compiler", "eager_lambda_lifting"}), ds);
     ds = apply(max_sharing, ds);
     trace_compiler(name({"compiler", "stage1"}), ds);
@@ -233,43 +247,49 @@ elab_environment compile(elab_environment const & env, options const & opts, nam
            when it is partially applied. Then, we can mark all `match` auxiliary functions as `[strong_inline]` */
         return new_env;
     }
-    std::tie(new_env, ds) = specialize(new_env, ds, cfg);
+    compiler_pass("specialize", new_env, std::tie(new_env, ds) = specialize(new_env, ds, cfg));
     // The following check is incorrect. It was exposed by issue #1812.
     // We will not fix the check since we will delete the compiler.
     // lean_assert(lcnf_check_let_decls(new_env, ds));
     trace_compiler(name({"compiler", "specialize"}), ds);
-    ds = apply(elim_dead_let, ds);
+    compiler_pass("elim_dead_let", new_env, ds = apply(elim_dead_let, ds));
     trace_compiler(name({"compiler", "elim_dead_let"}), ds);
-    ds = apply(erase_irrelevant, new_env, ds);
+    compiler_pass("erase_irrelevant", new_env, ds = apply(erase_irrelevant, new_env, ds));
     trace_compiler(name({"compiler", "erase_irrelevant"}), ds);
-    ds = apply(struct_cases_on, new_env, ds);
+    compiler_pass("struct_cases_on", new_env, ds = apply(struct_cases_on, new_env, ds));
     trace_compiler(name({"compiler", "struct_cases_on"}), ds);
-    ds = apply(esimp, new_env, ds);
+    compiler_pass("simp", new_env, ds = apply(esimp, new_env, ds));
     trace_compiler(name({"compiler", "simp"}), ds);
-    ds = reduce_arity(new_env, ds);
+    compiler_pass("reduce_arity", new_env, ds = reduce_arity(new_env, ds));
     trace_compiler(name({"compiler", "reduce_arity"}), ds);
-    std::tie(new_env, ds) = lambda_lifting(new_env, ds);
+    compiler_pass("lambda_lifting", new_env, std::tie(new_env, ds) = lambda_lifting(new_env, ds));
     trace_compiler(name({"compiler", "lambda_lifting"}), ds);
     // trace(ds);
-    ds = apply(esimp, new_env, ds);
+    compiler_pass("simp", new_env, ds = apply(esimp, new_env, ds));
     trace_compiler(name({"compiler", "simp"}), ds);
     new_env = cache_stage2(new_env, ds);
     trace_compiler(name({"compiler", "stage2"}), ds);
     if (is_extract_closed_enabled(opts)) {
-        std::tie(new_env, ds) = extract_closed(new_env, ds);
-        ds = apply(elim_dead_let, ds);
-        ds = apply(esimp, new_env, ds);
+        // Lazily initialized closed terms are stored differently and cannot be referred to by other modules.
+        if (opts.get_bool(*g_lazy_closed_terms, false))
+            new_env = disable_closed_term_sharing(new_env);
+        compiler_pass("extract_closed", new_env,
+                      std::tie(new_env, ds) = extract_closed(new_env, ds);
+                      ds = apply(elim_dead_let, ds);
+                      ds = apply(esimp, new_env, ds));
         trace_compiler(name({"compiler", "extract_closed"}), ds);
     }
     new_env = cache_new_stage2(new_env, ds);
-    ds = apply(esimp, new_env, ds);
+    compiler_pass("simp", new_env, ds = apply(esimp, new_env, ds));
     trace_compiler(name({"compiler", "simp"}), ds);
-    ds = apply(simp_app_args, new_env, ds);
-    ds = apply(ecse, new_env, ds);
-    ds = apply(elim_dead_let, ds);
+    compiler_pass("simp_app_args", new_env,
+                  ds = apply(simp_app_args, new_env, ds);
+                  ds = apply(ecse, new_env, ds);
+                  ds = apply(elim_dead_let, ds));
     trace_compiler(name({"compiler", "simp_app_args"}), ds);
     // std::cout << trace_scope.get_string() << "\n";
     /* compile IR. */
+    time_task t_ir("compilation ir", opts, head(cs));
     return compile_ir(new_env, opts, ds);
 }
 
@@ -283,8 +303,12 @@ void initialize_compiler() {
     g_extract_closed = new name{"compiler", "extract_closed"};
     mark_persistent(g_extract_closed->raw());
     register_bool_option(*g_extract_closed, true, "(compiler) enable/disable closed term caching");
+    // registered by `Lean.IR.EmitC`
+    g_lazy_closed_terms = new name{"compiler", "lazyClosedTerms"};
+    mark_persistent(g_lazy_closed_terms->raw());
     register_trace_class("compiler");
     register_trace_class({"compiler", "input"});
+    register_trace_class({"compiler", "size"});
     register_trace_class({"compiler", "inline"});
     register_trace_class({"compiler", "eta_expand"});
     register_trace_class({"compiler", "lcnf"});
@@ -325,5 +349,6 @@ void initialize_compiler() {
 
 void finalize_compiler() {
     delete g_extract_closed;
+    delete g_lazy_closed_terms;
 }
 }
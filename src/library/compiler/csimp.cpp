@@ -28,6 +28,10 @@ Author: Leonardo de Moura
 #include "library/compiler/reduce_arity.h"
 #include "library/compiler/init_attribute.h"
 
+#ifndef LEAN_DEFAULT_CSIMP_INLINE_BUDGET
+#define LEAN_DEFAULT_CSIMP_INLINE_BUDGET 10000
+#endif
+
 namespace lean {
 csimp_cfg::csimp_cfg(options const &):
     csimp_cfg() {
@@ -38,6 +42,7 @@ csimp_cfg::csimp_cfg() {
     m_inline_threshold                = 1;
     m_float_cases_threshold           = 20;
     m_inline_jp_threshold             = 2;
+    m_inline_budget                   = LEAN_DEFAULT_CSIMP_INLINE_BUDGET;
 }
 
 /*
@@ -74,6 +79,8 @@ class csimp_fn {
     name                     m_j;
     unsigned                 m_next_idx{1};
     unsigned                 m_next_jp_idx{1};
+    /* Number of functions inlined because they are cheap, see `csimp_cfg::m_inline_budget`. */
+    unsigned                 m_num_cheap_inlined{0};
     expr_set                 m_simplified;
     /* Cache for the method `mk_new_join_point`. It maps the pair `(jp, lambda(x, e))` to the new joint point. */
     jp_cache                 m_jp_cache;
@@ -179,7 +186,7 @@ class csimp_fn {
     }
 
     bool is_small_join_point(expr const & e) const {
-        return get_lcnf_size(env(), e) <= m_cfg.m_inline_jp_threshold;
+        return is_lcnf_size_le(env(), e, m_cfg.m_inline_jp_threshold);
     }
 
     expr find(expr const & e, bool skip_mdata = true, bool use_expr2ctor = false) const {
@@ -409,7 +416,7 @@ class csimp_fn {
                 std::tie(begin_minors, end_minors) = get_cases_on_minors_range(env(), const_name(fn), m_before_erasure);
                 for (unsigned minor_idx = begin_minors; minor_idx < end_minors; minor_idx++) {
                     expr minor = args[minor_idx];
-                    if (get_lcnf_size(env(), minor) > branch_threshold) {
+                    if (!is_lcnf_size_le(env(), minor, branch_threshold)) {
                         buffer<bool> used_zs; /* used_zs[i] iff `minor` uses `zs[i]` */
                         bool         used_fvar = false; /* true iff `minor` uses `fvar` */
                         bool         used_unit = false; /* true if we needed to add `unit ->` to joint point */
@@ -1642,7 +1649,7 @@ class csimp_fn {
                 return optional<constant_info>();
             } else if (has_inline_attribute(m_env, f)) {
                 return info;
-            } else if (get_lcnf_size(m_env, info->get_value()) <= m_cfg.m_inline_threshold) {
+            } else if (is_lcnf_size_le(m_env, info->get_value(), m_cfg.m_inline_threshold)) {
                 return info;
             } else {
                 return optional<constant_info>();
@@ -1727,6 +1734,19 @@ class csimp_fn {
         return !arity_was_reduced(comp_decl(n, info->get_value()));
     }
 
+    /* Return true if the inlining budget allows inlining one more cheap function `fn`. */
+    bool consume_inline_budget(expr const & fn) {
+        if (m_num_cheap_inlined >= m_cfg.m_inline_budget) {
+            if (m_num_cheap_inlined == m_cfg.m_inline_budget) {
+                lean_trace(name({"compiler", "simp"}), tout() << "inline budget exhausted at '" << const_name(fn) << "'\n";);
+                m_num_cheap_inlined++;
+            }
+            return false;
+        }
+        m_num_cheap_inlined++;
+        return true;
+    }
+
     optional<expr> try_inline(expr const & fn, expr const & e, bool is_let_val) {
         lean_assert(is_constant(fn));
         lean_assert(is_constant(e) || is_eqp(find(get_app_fn(e)), fn));
@@ -1742,7 +1762,7 @@ class csimp_fn {
             bool inline_attr           = has_inline_attribute(env(), const_name(fn));
             bool inline_if_reduce_attr = has_inline_if_reduce_attribute(env(), const_name(fn));
             if (!inline_attr && !inline_if_reduce_attr &&
-                (get_lcnf_size(env(), info->get_value()) > m_cfg.m_inline_threshold ||
+                (!is_lcnf_size_le(env(), info->get_value(), m_cfg.m_inline_threshold) ||
                  is_constant(e))) { /* We only inline constants if they are marked with the `[inline]` or `[inline_if_reduce]` attrs */
                 return none_expr();
             }
@@ -1753,6 +1773,7 @@ class csimp_fn {
                 // REMARK: the to be implemented `[strong_inline]` attribute should not be used in unsafe code.
                 if (uses_unsafe_inductive(c)) return none_expr();
             }
+            if (!inline_attr && !inline_if_reduce_attr && !consume_inline_budget(fn)) return none_expr();
             lean_trace(name({"compiler", "inline"}), tout() << const_name(fn) << "\n";);
             expr new_fn = instantiate_value_lparams(*info, const_levels(fn));
             if (inline_if_reduce_attr && !inline_attr) {
@@ -1768,9 +1789,10 @@ class csimp_fn {
             if (!info || !info->is_definition()) return none_expr();
             unsigned arity = get_num_nested_lambdas(info->get_value());
             if (get_app_num_args(e) < arity || arity == 0) return none_expr();
-            if (get_lcnf_size(env(), info->get_value()) > m_cfg.m_inline_threshold) return none_expr();
+            if (!is_lcnf_size_le(env(), info->get_value(), m_cfg.m_inline_threshold)) return none_expr();
             if (is_recursive(const_name(fn))) return none_expr();
             if (uses_unsafe_inductive(c)) return none_expr();
+            if (!consume_inline_budget(fn)) return none_expr();
             return some_expr(beta_reduce(info->get_value(), e, is_let_val));
         }
     }
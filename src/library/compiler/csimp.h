@@ -18,6 +18,10 @@ struct csimp_cfg {
     unsigned m_float_cases_threshold;
     /* We inline join-points that are smaller m_inline_threshold. */
     unsigned m_inline_jp_threshold;
+    /* Maximum number of functions inlined by a single `csimp` invocation only because they are cheap.
+       Once it is exhausted, only functions marked with `[inline]` or `[inline_if_reduce]` are still inlined,
+       so that pathological definitions degrade to less optimized code instead of exploding. */
+    unsigned m_inline_budget;
 public:
     csimp_cfg(options const & opts);
     csimp_cfg();
@@ -37,7 +37,7 @@ std::string decl_to_string(decl const & d);
 void test(decl const & d);
 elab_environment compile(elab_environment const & env, options const & opts, comp_decls const & decls);
 elab_environment add_extern(elab_environment const & env, name const & fn);
-LEAN_EXPORT string_ref emit_c(elab_environment const & env, name const & mod_name);
+LEAN_EXPORT string_ref emit_c(elab_environment const & env, name const & mod_name, options const & opts);
 void emit_llvm(elab_environment const & env, name const & mod_name, std::string const &filepath);
 }
 void initialize_ir();
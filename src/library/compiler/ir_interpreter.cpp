@@ -26,7 +26,10 @@ functions, which have a (relatively) homogeneous ABI that we can use without run
 `call/lookup_symbol` below.
 
 */
+#include <cstdlib>
+#include <fstream>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #ifdef LEAN_WINDOWS
 #include <windows.h>
@@ -37,15 +40,19 @@ functions, which have a (relatively) homogeneous ABI that we can use without run
 #include "library/compiler/ir_interpreter.h"
 #include "runtime/flet.h"
 #include "runtime/apply.h"
+#include "runtime/allocprof.h"
+#include "runtime/task_trace.h"
 #include "runtime/interrupt.h"
 #include "runtime/io.h"
 #include "runtime/option_ref.h"
+#include "runtime/thread.h"
 #include "runtime/array_ref.h"
 #include "kernel/trace.h"
 #include "library/time_task.h"
 #include "library/compiler/ir.h"
 #include "library/compiler/init_attribute.h"
 #include "util/nat.h"
+#include "util/name_flat_map.h"
 #include "util/option_declarations.h"
 
 #ifndef LEAN_DEFAULT_INTERPRETER_PREFER_NATIVE
@@ -197,6 +204,53 @@ static name * g_interpreter_prefer_native = nullptr;
 // constants (lacking native declarations) initialized by `lean_run_init`
 static name_map<object *> * g_init_globals;
 
+/* Native symbol found for a declaration; `m_boxed` is true iff it is the boxed version. */
+struct native_symbol {
+    void * m_addr;
+    bool   m_boxed;
+};
+/* Native symbols found so far, shared by all interpreters of the process since they do not depend on the environment.
+   Only successful lookups are stored, as dynamic libraries loaded later may provide symbols that are missing now. */
+static name_flat_map<native_symbol> * g_native_symbols;
+static mutex * g_native_symbols_mutex;
+/* Symbols of the modules in shared libraries loaded at runtime, indexed by mangled name from the `lean_native_symbol`
+   tables that `lean_run_mod_init` registers. Protected by `g_native_symbols_mutex`. */
+static std::unordered_map<std::string, void *> * g_prelinked_symbols;
+
+/* Sampling profiler for interpreted code, enabled by `LEAN_INTERPRETER_PROFILE=<file>`.
+   A timer thread increments `g_profile_tick` once per sampling interval. Before each step, an interpreter compares it
+   against the last tick it has seen and, when it changed, attributes the elapsed ticks to its current call stack.
+   Samples therefore measure wall-clock time, including time spent in native code called from interpreted code. They
+   are written as folded stacks (`f;g;h <ticks>`), which can be rendered with `flamegraph.pl` or `speedscope`. */
+static atomic<unsigned> g_profile_tick(0);
+static mutex * g_profile_mutex = nullptr;
+static std::unordered_map<std::string, uint64> * g_profile_samples = nullptr;
+static char const * g_profile_fname = nullptr;
+
+#define LEAN_DEFAULT_INTERPRETER_PROFILE_INTERVAL 1000 // microseconds
+
+static void write_interpreter_profile_at_exit() {
+    std::ofstream out(g_profile_fname);
+    lock_guard<mutex> lock(*g_profile_mutex);
+    for (auto const & p : *g_profile_samples)
+        out << p.first << " " << p.second << "\n";
+}
+
+static void start_interpreter_profile(char const * fname, unsigned interval) {
+#if defined(LEAN_MULTI_THREAD)
+    g_profile_fname = fname;
+    std::atexit(write_interpreter_profile_at_exit);
+    lthread([=]() {
+        while (true) {
+            this_thread::sleep_for(chrono::microseconds(interval));
+            g_profile_tick.fetch_add(1, memory_order_relaxed);
+        }
+    });
+#else
+    (void)fname; (void)interval;
+#endif
+}
+
 // reuse the compiler's name mangling to compute native symbol names
 extern "C" object * lean_name_mangle(object * n, object * pre);
 string_ref name_mangle(name const & n, string_ref const & pre) {
@@ -364,16 +418,20 @@ class interpreter {
       value m_val;
     };
     // caches values of nullary functions ("constants")
-    name_map<constant_cache_entry> m_constant_cache;
+    name_flat_map<constant_cache_entry> m_constant_cache;
     struct symbol_cache_entry {
         decl m_decl;
         // symbol address; `nullptr` if function does not have native code
         void * m_addr;
         // true iff we chose the boxed version of a function where the IR uses the unboxed version
         bool m_boxed;
+        // number of variable slots needed to interpret the function, see `get_frame_size`; 0 for external declarations
+        size_t m_frame_size;
     };
-    // caches symbol lookup successes _and_ failures
-    name_map<symbol_cache_entry> m_symbol_cache;
+    // caches symbol lookup successes _and_ failures; entries are never removed, so references to them stay valid
+    name_flat_map<symbol_cache_entry> m_symbol_cache;
+    // last value of `g_profile_tick` accounted for by this interpreter
+    unsigned m_profile_tick;
 
     /** \brief Get current stack frame */
     inline frame & get_frame() {
@@ -384,14 +442,79 @@ class interpreter {
     inline value & var(var_id const & v) {
         // variables are 1-indexed
         size_t i = get_frame().m_arg_bp + v.get_small_value() - 1;
-        // we don't know the frame size (unless we do an additional IR pass), so we extend it dynamically
-        if (i >= m_arg_stack.size()) {
-            m_arg_stack.resize(i + 1);
-        }
+        // the frame is allocated by `push_frame`
+        lean_assert(i < m_arg_stack.size());
         return m_arg_stack[i];
     }
 
+    /** \brief Return the number of variable slots of the frame for `d`, i.e., its largest variable index. */
+    static size_t get_frame_size(decl const & d) {
+        size_t r = 0;
+        auto add_params = [&](array_ref<param> const & ps) {
+            for (param const & p : ps)
+                r = std::max(r, static_cast<size_t>(param_var(p).get_small_value()));
+        };
+        add_params(decl_params(d));
+        std::vector<fn_body const *> todo;
+        todo.push_back(&decl_fun_body(d));
+        while (!todo.empty()) {
+            fn_body const & b = *todo.back();
+            todo.pop_back();
+            switch (fn_body_tag(b)) {
+                case fn_body_kind::VDecl:
+                    r = std::max(r, static_cast<size_t>(fn_body_vdecl_var(b).get_small_value()));
+                    todo.push_back(&fn_body_vdecl_cont(b));
+                    break;
+                case fn_body_kind::JDecl:
+                    add_params(fn_body_jdecl_params(b));
+                    todo.push_back(&fn_body_jdecl_body(b));
+                    todo.push_back(&fn_body_jdecl_cont(b));
+                    break;
+                case fn_body_kind::Set:    todo.push_back(&fn_body_set_cont(b)); break;
+                case fn_body_kind::SetTag: todo.push_back(&fn_body_set_tag_cont(b)); break;
+                case fn_body_kind::USet:   todo.push_back(&fn_body_uset_cont(b)); break;
+                case fn_body_kind::SSet:   todo.push_back(&fn_body_sset_cont(b)); break;
+                case fn_body_kind::Inc:    todo.push_back(&fn_body_inc_cont(b)); break;
+                case fn_body_kind::Dec:    todo.push_back(&fn_body_dec_cont(b)); break;
+                case fn_body_kind::Del:    todo.push_back(&fn_body_del_cont(b)); break;
+                case fn_body_kind::MData:  todo.push_back(&fn_body_mdata_cont(b)); break;
+                case fn_body_kind::Case:
+                    for (alt_core const & alt : fn_body_case_alts(b)) {
+                        if (alt_core_tag(alt) == alt_core_kind::Ctor)
+                            todo.push_back(&alt_core_ctor_cont(alt));
+                        else
+                            todo.push_back(&alt_core_default_cont(alt));
+                    }
+                    break;
+                case fn_body_kind::Ret: case fn_body_kind::Jmp: case fn_body_kind::Unreachable:
+                    break;
+            }
+        }
+        return r;
+    }
+
 public:
+    /** \brief Attribute the profiler ticks elapsed since the last sample to the current call stack. */
+    void record_profile_sample(unsigned tick) {
+        unsigned n = tick - m_profile_tick;
+        m_profile_tick = tick;
+        std::string stack;
+        for (frame const & fr : m_call_stack) {
+            if (!stack.empty())
+                stack += ';';
+            stack += fr.m_fn.to_string();
+        }
+        lock_guard<mutex> lock(*g_profile_mutex);
+        (*g_profile_samples)[stack] += n;
+    }
+
+    /** \brief Name of the declaration being executed by the interpreter of the current thread, if any. */
+    static std::string get_current_fn() {
+        if (g_interpreter && !g_interpreter->m_call_stack.empty())
+            return g_interpreter->get_frame().m_fn.to_string();
+        return std::string();
+    }
+
     template<class T>
     static inline T with_interpreter(elab_environment const & env, options const & opts, name const & fn, std::function<T(interpreter &)> const & f) {
         if (g_interpreter && is_eqp(g_interpreter->m_env, env) && is_eqp(g_interpreter->m_opts, opts)) {
@@ -447,6 +570,41 @@ private:
         return cls;
     }
 
+    /** \brief Return true if applying `f` to `n` arguments is a saturated call of an interpreter stub closure
+        (see `mk_stub_closure`) created by this interpreter. */
+    bool is_interpreter_stub_for(object * f, size_t n) {
+        if (is_scalar(f) || !lean_is_closure(f))
+            return false;
+        unsigned arity = closure_arity(f);
+        unsigned fixed = closure_num_fixed(f);
+        return fixed >= 3 && arity == fixed + n && closure_fun(f) == get_stub(arity) &&
+               closure_arg_cptr(f)[0] == m_env.raw() && closure_arg_cptr(f)[1] == m_opts.raw();
+    }
+
+    /** \brief Apply the interpreter stub closure `f` to `args` in the current interpreter, consuming `f`.
+        This is equivalent to `apply_n`, which would reach `stub_m` via `with_interpreter`, but avoids the generic
+        dispatch and the repacking of the arguments.
+        \pre is_interpreter_stub_for(f, args.size()) */
+    object * apply_stub_closure(object * f, array_ref<arg> const & args) {
+        object ** fx = closure_arg_cptr(f);
+        unsigned fixed = closure_num_fixed(f);
+        // `f` keeps the declaration alive until the call returns
+        decl const & d = TO_REF(decl, fx[2]);
+        size_t old_size = m_arg_stack.size();
+        for (unsigned i = 3; i < fixed; i++) {
+            inc(fx[i]);
+            m_arg_stack.push_back(fx[i]);
+        }
+        for (arg const & a : args) {
+            m_arg_stack.push_back(eval_arg(a));
+        }
+        push_frame(d, old_size, lookup_symbol(decl_fun_id(d)).m_frame_size);
+        object * r = eval_body(decl_fun_body(d)).m_obj;
+        pop_frame(r, type::TObject);
+        dec_ref(f);
+        return r;
+    }
+
     value eval_expr(expr const & e, type t) {
         switch (expr_tag(e)) {
             case expr_kind::Ctor:
@@ -514,7 +672,7 @@ private:
                 }
             }
             case expr_kind::PAp: { // unsatured (partial) application of top-level function
-                symbol_cache_entry sym = lookup_symbol(expr_pap_fun(e));
+                symbol_cache_entry const & sym = lookup_symbol(expr_pap_fun(e));
                 if (sym.m_addr) {
                     // point closure directly at native symbol
                     object * cls = alloc_closure(sym.m_addr, decl_params(sym.m_decl).size(), expr_pap_args(e).size());
@@ -532,6 +690,10 @@ private:
                 }
             }
             case expr_kind::Ap: { // (saturated or unsatured) application of closure; mostly handled by runtime
+                object * f = var(expr_ap_fun(e)).m_obj;
+                if (is_interpreter_stub_for(f, expr_ap_args(e).size())) {
+                    return apply_stub_closure(f, expr_ap_args(e));
+                }
                 object ** args = static_cast<object **>(LEAN_ALLOCA(expr_ap_args(e).size() * sizeof(object *))); // NOLINT
                 for (size_t i = 0; i < expr_ap_args(e).size(); i++) {
                     args[i] = eval_arg(expr_ap_args(e)[i]).m_obj;
@@ -605,6 +767,9 @@ private:
         // make reference reassignable...
         std::reference_wrapper<fn_body const> b(b0);
         while (true) {
+            unsigned tick = g_profile_tick.load(memory_order_relaxed);
+            if (LEAN_UNLIKELY(tick != m_profile_tick))
+                record_profile_sample(tick);
             DEBUG_CODE(lean_trace(name({"interpreter", "step"}),
                                   tout() << std::string(m_call_stack.size(), ' ') << format_fn_body_head(b) << "\n";);)
             switch (fn_body_tag(b)) {
@@ -626,7 +791,8 @@ private:
                         for (size_t i = 0; i < args.size(); i++) {
                             m_arg_stack[get_frame().m_arg_bp + i] = m_arg_stack[old_size + i];
                         }
-                        m_arg_stack.resize(get_frame().m_arg_bp + args.size());
+                        // drop the copies, keeping the frame
+                        m_arg_stack.resize(old_size);
                         b = b0;
                         check_system();
                         break;
@@ -758,8 +924,9 @@ private:
         }
     }
 
-    // specify argument base pointer explicitly because we've usually already pushed some function arguments
-    void push_frame(decl const & d, size_t arg_bp) {
+    // specify argument base pointer explicitly because we've usually already pushed some function arguments;
+    // `frame_size` is the number of variable slots to allocate, which is 0 when calling native code
+    void push_frame(decl const & d, size_t arg_bp, size_t frame_size) {
         DEBUG_CODE({
             lean_trace(name({"interpreter", "call"}),
                        tout() << std::string(m_call_stack.size(), ' ')
@@ -769,6 +936,9 @@ private:
                        }
                        tout() << "\n";);
         });
+        if (m_arg_stack.size() < arg_bp + frame_size) {
+            m_arg_stack.resize(arg_bp + frame_size);
+        }
         m_call_stack.emplace_back(decl_fun_id(d), arg_bp, m_jp_stack.size());
     }
 
@@ -785,26 +955,59 @@ private:
        });
     }
 
+    static void * lookup_prelinked_symbol(char const * sym) {
+        lock_guard<mutex> lock(*g_native_symbols_mutex);
+        auto it = g_prelinked_symbols->find(sym);
+        return it == g_prelinked_symbols->end() ? nullptr : it->second;
+    }
+
+    /** \brief Look up the native code for the given unmangled function name in the current binary, using and
+        updating `g_native_symbols`. */
+    static optional<native_symbol> lookup_native_symbol(name const & fn) {
+        {
+            lock_guard<mutex> lock(*g_native_symbols_mutex);
+            if (native_symbol const * sym = g_native_symbols->find(fn))
+                return optional<native_symbol>(*sym);
+        }
+        string_ref mangled = name_mangle(fn, *g_mangle_prefix);
+        string_ref boxed_mangled(string_append(mangled.to_obj_arg(), g_boxed_mangled_suffix->raw()));
+        native_symbol sym { nullptr, false };
+        // check for boxed version first
+        if (void *p_boxed = lookup_prelinked_symbol(boxed_mangled.data())) {
+            sym = native_symbol { p_boxed, true };
+        } else if (void *p = lookup_prelinked_symbol(mangled.data())) {
+            sym = native_symbol { p, false };
+        } else if (void *p_boxed = lookup_symbol_in_cur_exe(boxed_mangled.data())) {
+            sym = native_symbol { p_boxed, true };
+        } else if (void *p = lookup_symbol_in_cur_exe(mangled.data())) {
+            // if there is no boxed version, there are no unboxed parameters, so use default version
+            sym = native_symbol { p, false };
+        } else {
+            return optional<native_symbol>();
+        }
+        name key = fn;
+        mark_mt(key.raw());
+        lock_guard<mutex> lock(*g_native_symbols_mutex);
+        g_native_symbols->insert(key, sym);
+        return optional<native_symbol>(sym);
+    }
+
     /** \brief Return cached lookup result for given unmangled function name in the current binary. */
-    symbol_cache_entry lookup_symbol(name const & fn) {
+    symbol_cache_entry const & lookup_symbol(name const & fn) {
         if (symbol_cache_entry const * e = m_symbol_cache.find(fn)) {
             return *e;
         } else {
-            symbol_cache_entry e_new { get_decl(fn), nullptr, false };
+            symbol_cache_entry e_new { get_decl(fn), nullptr, false, 0 };
             if (m_prefer_native || decl_tag(e_new.m_decl) == decl_kind::Extern || has_init_attribute(m_env, fn)) {
-                string_ref mangled = name_mangle(fn, *g_mangle_prefix);
-                string_ref boxed_mangled(string_append(mangled.to_obj_arg(), g_boxed_mangled_suffix->raw()));
-                // check for boxed version first
-                if (void *p_boxed = lookup_symbol_in_cur_exe(boxed_mangled.data())) {
-                    e_new.m_addr = p_boxed;
-                    e_new.m_boxed = true;
-                } else if (void *p = lookup_symbol_in_cur_exe(mangled.data())) {
-                    // if there is no boxed version, there are no unboxed parameters, so use default version
-                    e_new.m_addr = p;
+                if (optional<native_symbol> sym = lookup_native_symbol(fn)) {
+                    e_new.m_addr  = sym->m_addr;
+                    e_new.m_boxed = sym->m_boxed;
                 }
             }
-            m_symbol_cache.insert(fn, e_new);
-            return e_new;
+            if (decl_tag(e_new.m_decl) == decl_kind::Fun) {
+                e_new.m_frame_size = get_frame_size(e_new.m_decl);
+            }
+            return m_symbol_cache.insert(fn, e_new);
         }
     }
 
@@ -830,7 +1033,7 @@ private:
             return type_is_scalar(t) ? unbox_t(*o, t) : *o;
         }
 
-        symbol_cache_entry e = lookup_symbol(fn);
+        symbol_cache_entry const & e = lookup_symbol(fn);
         if (e.m_addr) {
             // we can assume that all native code has been initialized (see e.g. `evalConst`)
 
@@ -858,7 +1061,7 @@ private:
             // We don't know whether `[init]` decls can be re-executed, so let's not.
             throw exception(sstream() << "cannot evaluate `[init]` declaration '" << fn << "' in the same module");
         }
-        push_frame(e.m_decl, m_arg_stack.size());
+        push_frame(e.m_decl, m_arg_stack.size(), e.m_frame_size);
         value r = eval_body(decl_fun_body(e.m_decl));
         pop_frame(r, decl_type(e.m_decl));
         if (!type_is_scalar(t)) {
@@ -871,7 +1074,7 @@ private:
     value call(name const & fn, array_ref<arg> const & args) {
         size_t old_size = m_arg_stack.size();
         value r;
-        symbol_cache_entry e = lookup_symbol(fn);
+        symbol_cache_entry const & e = lookup_symbol(fn);
         if (e.m_addr) {
             object ** args2 = static_cast<object **>(LEAN_ALLOCA(args.size() * sizeof(object *))); // NOLINT
             for (size_t i = 0; i < args.size(); i++) {
@@ -885,7 +1088,7 @@ private:
                     inc(args2[i]);
                 }
             }
-            push_frame(e.m_decl, old_size);
+            push_frame(e.m_decl, old_size, 0);
             object * o = curry(e.m_addr, args.size(), args2);
             type t = decl_type(e.m_decl);
             if (type_is_scalar(t)) {
@@ -909,7 +1112,7 @@ private:
             for (const auto & arg : args) {
                 m_arg_stack.push_back(eval_arg(arg));
             }
-            push_frame(e.m_decl, old_size);
+            push_frame(e.m_decl, old_size, e.m_frame_size);
             r = eval_body(decl_fun_body(e.m_decl));
         }
         pop_frame(r, decl_type(e.m_decl));
@@ -923,7 +1126,7 @@ private:
         for (size_t i = 0; i < decl_params(d).size(); i++) {
             m_arg_stack.push_back(args[3 + i]);
         }
-        push_frame(d, old_size);
+        push_frame(d, old_size, lookup_symbol(decl_fun_id(d)).m_frame_size);
         object * r = eval_body(decl_fun_body(d)).m_obj;
         pop_frame(r, type::TObject);
         return r;
@@ -979,18 +1182,19 @@ private:
         }
     }
 public:
-    explicit interpreter(elab_environment const & env, options const & opts) : m_env(env), m_opts(opts) {
+    explicit interpreter(elab_environment const & env, options const & opts) :
+        m_env(env), m_opts(opts), m_profile_tick(g_profile_tick.load(memory_order_relaxed)) {
         m_prefer_native = opts.get_bool(*g_interpreter_prefer_native, LEAN_DEFAULT_INTERPRETER_PREFER_NATIVE);
     }
 
     interpreter(interpreter const &) = delete;
 
     ~interpreter() {
-        for_each(m_constant_cache, [](name const &, constant_cache_entry const & e) {
-            if (!e.m_is_scalar) {
-                dec(e.m_val.m_obj);
+        for (auto const & p : m_constant_cache) {
+            if (!p.second.m_is_scalar) {
+                dec(p.second.m_val.m_obj);
             }
-        });
+        }
     }
 
     /** A variant of `call` designed for external uses.
@@ -998,7 +1202,7 @@ public:
      *  * supports under- and over-application.
      *  * supports "calling" (evaluating) nullary constants. */
     object * call_boxed(name const & fn, unsigned n, object ** args) {
-        symbol_cache_entry e = lookup_symbol(fn);
+        symbol_cache_entry const & e = lookup_symbol(fn);
         unsigned arity = decl_params(e.m_decl).size();
         object * r;
         if (arity == 0) {
@@ -1072,7 +1276,7 @@ public:
                 object * o = io_result_get_value(r);
                 mark_persistent(o);
                 dec_ref(r);
-                symbol_cache_entry e = lookup_symbol(decl);
+                symbol_cache_entry const & e = lookup_symbol(decl);
                 if (e.m_addr) {
                     *((object **)e.m_addr) = o;
                 } else {
@@ -1126,9 +1330,34 @@ extern "C" LEAN_EXPORT object * lean_eval_const(object * env, object * opts, obj
 /* mkModuleInitializationFunctionName (moduleName : Name) : String */
 extern "C" obj_res lean_mk_module_initialization_function_name(obj_arg);
 
+/* Add the symbol table emitted for the module with initializer `init` to `g_prelinked_symbols` if the module is part of
+   a shared library loaded at runtime, such as the ones of `precompileModules`, for which Lake passes
+   `-Dcompiler.symbolTable=true`. Modules without a table are looked up symbol by symbol. Modules linked into the same
+   binary as the interpreter are skipped, as indexing a table would cost more than looking up the few of their symbols
+   that are actually used. */
+static void register_symbol_table(char const * init_name, void * init) {
+#ifndef LEAN_WINDOWS
+    Dl_info init_info, self_info;
+    if (!dladdr(init, &init_info) || !dladdr(reinterpret_cast<void *>(&register_symbol_table), &self_info) ||
+        init_info.dli_fbase == self_info.dli_fbase)
+        return;
+    std::string table_name = std::string(init_name) + "_symbols";
+    auto table = static_cast<lean_native_symbol const *>(dlsym(RTLD_DEFAULT, table_name.c_str()));
+    if (!table)
+        return;
+    lock_guard<mutex> lock(*g_native_symbols_mutex);
+    for (; table->m_name; table++)
+        g_prelinked_symbols->emplace(table->m_name, table->m_addr);
+#else
+    (void)init_name;
+    (void)init;
+#endif
+}
+
 extern "C" LEAN_EXPORT object * lean_run_mod_init(object * mod, object *) {
     string_ref mangled = string_ref(lean_mk_module_initialization_function_name(mod));
     if (void * init = lookup_symbol_in_cur_exe(mangled.data())) {
+        register_symbol_table(mangled.data(), init);
         auto init_fn = reinterpret_cast<object *(*)(uint8_t, object *)>(init);
         uint8_t builtin = 0;
         object * r = init_fn(builtin, io_mk_world());
@@ -1159,6 +1388,19 @@ void initialize_ir_interpreter() {
     mark_persistent(ir::g_boxed_mangled_suffix->raw());
     ir::g_interpreter_prefer_native = new name({"interpreter", "prefer_native"});
     ir::g_init_globals = new name_map<object *>();
+    ir::g_native_symbols = new name_flat_map<ir::native_symbol>();
+    ir::g_native_symbols_mutex = new mutex();
+    ir::g_prelinked_symbols = new std::unordered_map<std::string, void *>();
+    set_alloc_sample_decl_fn(ir::interpreter::get_current_fn);
+    set_task_trace_decl_fn(ir::interpreter::get_current_fn);
+    ir::g_profile_mutex = new mutex();
+    ir::g_profile_samples = new std::unordered_map<std::string, uint64>();
+    if (char const * fname = std::getenv("LEAN_INTERPRETER_PROFILE")) {
+        unsigned interval = LEAN_DEFAULT_INTERPRETER_PROFILE_INTERVAL;
+        if (char const * i = std::getenv("LEAN_INTERPRETER_PROFILE_INTERVAL"))
+            interval = std::max(1ul, std::strtoul(i, nullptr, 10));
+        ir::start_interpreter_profile(fname, interval);
+    }
     register_bool_option(*ir::g_interpreter_prefer_native, LEAN_DEFAULT_INTERPRETER_PREFER_NATIVE, "(interpreter) whether to use precompiled code where available");
     DEBUG_CODE({
         register_trace_class({"interpreter"});
@@ -1168,6 +1410,12 @@ void initialize_ir_interpreter() {
 }
 
 void finalize_ir_interpreter() {
+    set_alloc_sample_decl_fn(nullptr);
+    set_task_trace_decl_fn(nullptr);
+    /* `g_profile_samples` is not deleted because the profile may still be written at exit. */
+    delete ir::g_prelinked_symbols;
+    delete ir::g_native_symbols_mutex;
+    delete ir::g_native_symbols;
     delete ir::g_init_globals;
     delete ir::g_interpreter_prefer_native;
     delete ir::g_boxed_mangled_suffix;
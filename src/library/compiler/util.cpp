@@ -335,6 +335,47 @@ unsigned get_lcnf_size(elab_environment const & env, expr e) {
     lean_unreachable();
 }
 
+/* Auxiliary function for `is_lcnf_size_le`. Subtract the size of `e` from `budget`, and return false if it becomes negative. */
+static bool consume_lcnf_size(elab_environment const & env, expr e, unsigned & budget) {
+    switch (e.kind()) {
+    case expr_kind::Lambda:
+        while (is_lambda(e)) {
+            e = binding_body(e);
+        }
+        return consume_lcnf_size(env, e, budget);
+    case expr_kind::App:
+        if (is_cases_on_app(env, e)) {
+            expr const & c_fn   = get_app_fn(e);
+            inductive_val I_val = env.get(const_name(c_fn).get_prefix()).to_inductive_val();
+            unsigned nminors    = I_val.get_ncnstrs();
+            if (budget == 0) return false;
+            budget--;
+            for (unsigned i = 0; i < nminors; i++) {
+                lean_assert(is_app(e));
+                if (!consume_lcnf_size(env, app_arg(e), budget)) return false;
+                e = app_fn(e);
+            }
+            return true;
+        }
+        break;
+    case expr_kind::Let:
+        while (is_let(e)) {
+            if (!consume_lcnf_size(env, let_value(e), budget)) return false;
+            e = let_body(e);
+        }
+        return consume_lcnf_size(env, e, budget);
+    default:
+        break;
+    }
+    if (budget == 0) return false;
+    budget--;
+    return true;
+}
+
+bool is_lcnf_size_le(elab_environment const & env, expr const & e, unsigned max_size) {
+    return consume_lcnf_size(env, e, max_size);
+}
+
 static expr * g_neutral_expr     = nullptr;
 static expr * g_unreachable_expr = nullptr;
 static expr * g_object_type      = nullptr;
@@ -393,6 +434,7 @@ bool is_runtime_builtin_type(name const & n) {
         n == get_mut_quot_name()  ||
         n == get_byte_array_name()  ||
         n == get_float_array_name()  ||
+        n == get_uint64_array_name()  ||
         n == get_nat_name()    ||
         n == get_int_name();
 }
@@ -121,6 +121,8 @@ void sort_fvars(local_ctx const & lctx, buffer<expr> & fvars);
 
 /* Return the "code" size for `e` */
 unsigned get_lcnf_size(elab_environment const & env, expr e);
+/* Return `get_lcnf_size(env, e) <= max_size`. It stops visiting `e` as soon as the size is known to exceed `max_size`. */
+bool is_lcnf_size_le(elab_environment const & env, expr const & e, unsigned max_size);
 
 // =======================================
 // Auxiliary expressions for erasure.
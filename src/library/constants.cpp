@@ -108,6 +108,8 @@ name const * g_uint8 = nullptr;
 name const * g_uint16 = nullptr;
 name const * g_uint32 = nullptr;
 name const * g_uint64 = nullptr;
+name const * g_uint64_array = nullptr;
+name const * g_uint64_array_data = nullptr;
 name const * g_usize = nullptr;
 void initialize_constants() {
     g_absurd = new name{"absurd"};
@@ -320,6 +322,10 @@ void initialize_constants() {
     mark_persistent(g_uint32->raw());
     g_uint64 = new name{"UInt64"};
     mark_persistent(g_uint64->raw());
+    g_uint64_array = new name{"UInt64Array"};
+    mark_persistent(g_uint64_array->raw());
+    g_uint64_array_data = new name{"UInt64Array", "data"};
+    mark_persistent(g_uint64_array_data->raw());
     g_usize = new name{"USize"};
     mark_persistent(g_usize->raw());
 }
@@ -429,6 +435,8 @@ void finalize_constants() {
     delete g_uint16;
     delete g_uint32;
     delete g_uint64;
+    delete g_uint64_array;
+    delete g_uint64_array_data;
     delete g_usize;
 }
 name const & get_absurd_name() { return *g_absurd; }
@@ -536,5 +544,7 @@ name const & get_uint8_name() { return *g_uint8; }
 name const & get_uint16_name() { return *g_uint16; }
 name const & get_uint32_name() { return *g_uint32; }
 name const & get_uint64_name() { return *g_uint64; }
+name const & get_uint64_array_name() { return *g_uint64_array; }
+name const & get_uint64_array_data_name() { return *g_uint64_array_data; }
 name const & get_usize_name() { return *g_usize; }
 }
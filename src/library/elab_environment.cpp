@@ -34,6 +34,36 @@ extern "C" LEAN_EXPORT object * lean_elab_add_decl(object * env, size_t max_hear
         });
 }
 
+static object * profile_to_obj(kernel_profile const & p) {
+    uint64 const vals[] = {
+        p.m_whnf_core, p.m_whnf_core_hits, p.m_whnf, p.m_whnf_hits, p.m_infer_type, p.m_infer_type_hits,
+        p.m_is_def_eq_core, p.m_eqv_hits, p.m_eqv_merges, p.m_failure_checks, p.m_failure_hits,
+        p.m_lazy_delta_steps, p.m_cache_resets };
+    unsigned n = sizeof(vals) / sizeof(vals[0]);
+    object * r = alloc_cnstr(0, n, 0);
+    for (unsigned i = 0; i < n; i++)
+        cnstr_set(r, i, lean_uint64_to_nat(vals[i]));
+    return r;
+}
+
+/* addDeclProfiledCheck (env : Environment) (maxHeartbeats : USize) (decl : @& Declaration)
+     (cancelTk? : @& Option IO.CancelToken) : Except Kernel.Exception (Environment × Kernel.Profile) */
+extern "C" LEAN_EXPORT object * lean_elab_add_decl_profiled(object * env, size_t max_heartbeat, object * decl,
+    object * opt_cancel_tk) {
+    kernel_profile prof;
+    object * r;
+    {
+        scope_kernel_profile s(&prof);
+        r = lean_elab_add_decl(env, max_heartbeat, decl, opt_cancel_tk);
+    }
+    if (cnstr_tag(r) == 0)
+        return r;
+    object * new_env = cnstr_get(r, 0);
+    inc(new_env);
+    dec(r);
+    return mk_cnstr(1, mk_cnstr(0, object_ref(new_env), object_ref(profile_to_obj(prof)))).steal();
+}
+
 extern "C" LEAN_EXPORT object * lean_elab_add_decl_without_checking(object * env, object * decl) {
     return catch_kernel_exceptions<elab_environment>([&]() {
             return elab_environment(env).add(declaration(decl, true), false);
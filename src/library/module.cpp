@@ -13,7 +13,11 @@ Authors: Leonardo de Moura, Gabriel Ebner, Sebastian Ullrich
 #include <sstream>
 #include <fstream>
 #include <algorithm>
+#include <cstdlib>
 #include <sys/stat.h>
+#ifdef LEAN_ZSTD
+#include <zstd.h>
+#endif
 #include "runtime/thread.h"
 #include "runtime/interrupt.h"
 #include "runtime/sstream.h"
@@ -53,7 +57,9 @@ struct olean_header {
     uint8_t version = 2;
     // 1 byte of flags:
     // * bit 0: whether persisted bignums use GMP or Lean-native encoding
-    // * bit 1-7: reserved
+    // * bit 1: whether the payload is a zstd frame (`LEAN_OLEAN_COMPRESS`, requires `LEAN_ZSTD`)
+    // * bit 2: whether the payload is followed by an `olean_trailer` (`LEAN_OLEAN_CHECKSUM`)
+    // * bit 3-7: reserved
     uint8_t flags =
 #ifdef LEAN_USE_GMP
         0b1;
@@ -76,6 +82,95 @@ struct olean_header {
 // make sure we don't have any padding bytes, which also ensures `data` is properly aligned
 static_assert(sizeof(olean_header) == 5 + 1 + 1 + 33 + 40 + sizeof(size_t), "olean_header must be packed");
 
+#define LEAN_OLEAN_FLAG_ZSTD     0b10
+#define LEAN_OLEAN_FLAG_CHECKSUM 0b100
+
+/** Optional integrity information at the end of a .olean file. It is stored after the payload so
+    that the payload keeps its offset for `mmap`. Payload sizes are checked cheaply; the checksum
+    has to touch every page and is computed with hardware CRC-32C where available. */
+struct olean_trailer {
+    // size of the (possibly compressed) payload
+    uint64_t payload_size;
+    // CRC-32C of the payload
+    uint64_t checksum;
+};
+
+/* Read the trailer of a file of `size` bytes with a checksum, then seek back to the payload. */
+static bool read_olean_trailer(std::ifstream & in, size_t size, olean_trailer & trailer) {
+    if (size < sizeof(olean_header) + sizeof(olean_trailer))
+        return false;
+    in.seekg(size - sizeof(olean_trailer));
+    if (!in.read(reinterpret_cast<char *>(&trailer), sizeof(trailer)))
+        return false;
+    in.seekg(sizeof(olean_header));
+    return trailer.payload_size == size - sizeof(olean_header) - sizeof(olean_trailer);
+}
+
+#ifdef LEAN_ZSTD
+/* Compression level for new .olean files if `LEAN_OLEAN_COMPRESS` is set, or 0 for uncompressed
+   files. Compressed files are meant for cold storage such as build caches: they cannot be mapped
+   directly and are decompressed when read. */
+static int get_olean_compression_level() {
+    char const * level = std::getenv("LEAN_OLEAN_COMPRESS");
+    if (!level)
+        return 0;
+    // favour size over compression speed by default, decompression speed is mostly unaffected
+    int r = atoi(level);
+    return r > 0 ? std::min(r, ZSTD_maxCLevel()) : 19;
+}
+#endif
+
+/*
+  `LEAN_OLEAN_SHARING` is a comma-separated list of the kinds of objects to maximally share when
+  writing .olean files (`ctor`, `array`, `string`, `sarray`, `other`, `all` or `none`), and
+  `LEAN_OLEAN_SHARING_MAX_SIZE` bounds the size in bytes of shared objects.
+  By default, all objects are shared. */
+static compactor_sharing_policy get_olean_sharing_policy() {
+    compactor_sharing_policy p;
+    if (char const * kinds = std::getenv("LEAN_OLEAN_SHARING")) {
+        p.m_kinds = 0;
+        std::stringstream in(kinds);
+        std::string k;
+        while (std::getline(in, k, ',')) {
+            if (k == "ctor")        p.m_kinds |= compactor_share_ctor;
+            else if (k == "array")  p.m_kinds |= compactor_share_array;
+            else if (k == "string") p.m_kinds |= compactor_share_string;
+            else if (k == "sarray") p.m_kinds |= compactor_share_sarray;
+            else if (k == "other")  p.m_kinds |= compactor_share_other;
+            else if (k == "all")    p.m_kinds |= compactor_share_all;
+        }
+    }
+    if (char const * sz = std::getenv("LEAN_OLEAN_SHARING_MAX_SIZE"))
+        p.m_max_size = std::strtoull(sz, nullptr, 10);
+    return p;
+}
+
+/* Return true if the file `fn` consists of exactly `header` followed by `data` and `trailer`. */
+static bool file_has_contents(std::string const & fn, olean_header const & header, char const * data, size_t sz,
+                              olean_trailer const * trailer) {
+    std::ifstream in(fn, std::ios_base::binary);
+    if (!in)
+        return false;
+    in.seekg(0, in.end);
+    if (static_cast<size_t>(in.tellg()) != sizeof(olean_header) + sz + (trailer ? sizeof(olean_trailer) : 0))
+        return false;
+    in.seekg(0);
+    olean_header old_header;
+    if (!in.read(reinterpret_cast<char *>(&old_header), sizeof(old_header)) ||
+        memcmp(&old_header, &header, sizeof(header)) != 0)
+        return false;
+    std::vector<char> chunk(1 << 20);
+    for (size_t pos = 0; pos < sz; pos += chunk.size()) {
+        size_t n = std::min(chunk.size(), sz - pos);
+        if (!in.read(chunk.data(), n) || memcmp(chunk.data(), data + pos, n) != 0)
+            return false;
+    }
+    olean_trailer old_trailer;
+    return !trailer ||
+        (in.read(reinterpret_cast<char *>(&old_trailer), sizeof(old_trailer)) &&
+         memcmp(&old_trailer, trailer, sizeof(old_trailer)) == 0);
+}
+
 extern "C" LEAN_EXPORT object * lean_save_module_data(b_obj_arg fname, b_obj_arg mod, b_obj_arg mdata, object *) {
     std::string olean_fn(string_cstr(fname));
     // we first write to a temp file and then move it to the correct path (possibly deleting an older file)
@@ -106,6 +201,7 @@ extern "C" LEAN_EXPORT object * lean_save_module_data(b_obj_arg fname, b_obj_arg
         base_addr = base_addr & ~((1LL<<16) - 1);
 
         object_compactor compactor(reinterpret_cast<void *>(base_addr + offsetof(olean_header, data)));
+        compactor.set_sharing_policy(get_olean_sharing_policy());
         compactor(mdata);
 
         // see/sync with file format description above
@@ -113,8 +209,39 @@ extern "C" LEAN_EXPORT object * lean_save_module_data(b_obj_arg fname, b_obj_arg
         header.base_addr = base_addr;
         strncpy(header.lean_version, get_short_version_string().c_str(), sizeof(header.lean_version));
         strncpy(header.githash, LEAN_GITHASH, sizeof(header.githash));
+        char const * payload = static_cast<char const *>(compactor.data());
+        size_t payload_sz = compactor.size();
+#ifdef LEAN_ZSTD
+        std::vector<char> compressed;
+        if (int level = get_olean_compression_level()) {
+            compressed.resize(ZSTD_compressBound(compactor.size()));
+            size_t sz = ZSTD_compress(compressed.data(), compressed.size(), compactor.data(), compactor.size(), level);
+            if (ZSTD_isError(sz)) {
+                return io_result_mk_error((sstream() << "failed to compress '" << olean_fn << "': " << ZSTD_getErrorName(sz)).str());
+            }
+            header.flags |= LEAN_OLEAN_FLAG_ZSTD;
+            payload = compressed.data();
+            payload_sz = sz;
+        }
+#endif
+        olean_trailer trailer;
+        bool checksum = std::getenv("LEAN_OLEAN_CHECKSUM") != nullptr;
+        if (checksum) {
+            header.flags |= LEAN_OLEAN_FLAG_CHECKSUM;
+            trailer.payload_size = payload_sz;
+            trailer.checksum = crc32c(payload, payload_sz);
+        }
+        // If the module did not change, keep the existing file. This preserves its modification
+        // time for tools that rely on it and does not disturb other processes that have it mapped.
+        if (file_has_contents(olean_fn, header, payload, payload_sz, checksum ? &trailer : nullptr)) {
+            out.close();
+            std::remove(olean_tmp_fn.c_str());
+            return io_result_mk_ok(box(0));
+        }
         out.write(reinterpret_cast<char *>(&header), sizeof(header));
-        out.write(static_cast<char const *>(compactor.data()), compactor.size());
+        out.write(payload, payload_sz);
+        if (checksum)
+            out.write(reinterpret_cast<char *>(&trailer), sizeof(trailer));
         out.close();
         while (std::rename(olean_tmp_fn.c_str(), olean_fn.c_str()) != 0) {
 #ifdef LEAN_WINDOWS
@@ -142,6 +269,78 @@ extern "C" LEAN_EXPORT object * lean_save_module_data(b_obj_arg fname, b_obj_arg
     }
 }
 
+static object * mk_module_region(size_t size, char * buffer, char * base_addr, bool is_mmap, std::function<void()> free_data) {
+    compacted_region * region = new compacted_region(size, buffer, base_addr, is_mmap, free_data);
+#if defined(__has_feature)
+#if __has_feature(address_sanitizer)
+    // do not report as leak
+    __lsan_ignore_object(region);
+#endif
+#endif
+    object * mod;
+    if (has_profiling_task()) {
+        // Reported separately from `import: read .olean` within which we are usually called.
+        auto start = std::chrono::steady_clock::now();
+        mod = region->read();
+        second_duration d = std::chrono::steady_clock::now() - start;
+        report_profiling_time("import: relocate .olean", d);
+        exclude_profiling_time_from_current_task(d);
+    } else {
+        mod = region->read();
+    }
+    object * mod_region = alloc_cnstr(0, 2, 0);
+    cnstr_set(mod_region, 0, mod);
+    cnstr_set(mod_region, 1, box_size_t(reinterpret_cast<size_t>(region)));
+    return mod_region;
+}
+
+#ifdef LEAN_ZSTD
+/* Read the zstd-compressed payload of `olean_fn`. We decompress directly into the final buffer
+   and try to allocate it at the base address of the file, in which case no relocations are
+   needed, as for an uncompressed file mapped at its base address. */
+static object * read_compressed_module_data(std::ifstream & in, size_t payload_sz, char * base_addr, std::string const & olean_fn,
+                                            olean_trailer const * trailer) {
+    std::vector<char> compressed(payload_sz);
+    if (!in.read(compressed.data(), compressed.size())) {
+        return io_result_mk_error((sstream() << "failed to read file '" << olean_fn << "'").str());
+    }
+    if (trailer && crc32c(compressed.data(), compressed.size()) != trailer->checksum) {
+        return io_result_mk_error((sstream() << "failed to read file '" << olean_fn << "', checksum mismatch").str());
+    }
+    unsigned long long data_sz = ZSTD_getFrameContentSize(compressed.data(), compressed.size());
+    if (data_sz == ZSTD_CONTENTSIZE_UNKNOWN || data_sz == ZSTD_CONTENTSIZE_ERROR) {
+        return io_result_mk_error((sstream() << "failed to read file '" << olean_fn << "', invalid compressed data").str());
+    }
+    size_t map_sz = sizeof(olean_header) + data_sz;
+    char * buffer = nullptr;
+    std::function<void()> free_data;
+#if !defined(LEAN_WINDOWS) && defined(LEAN_MMAP)
+    char * map = static_cast<char *>(mmap(base_addr, map_sz, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    if (map == base_addr) {
+        buffer = map + sizeof(olean_header);
+        free_data = [=]() { lean_always_assert(munmap(map, map_sz) == 0); };
+    } else if (map != MAP_FAILED) {
+        lean_always_assert(munmap(map, map_sz) == 0);
+    }
+#endif
+    if (!buffer) {
+        buffer = static_cast<char *>(malloc(data_sz));
+        free_data = [=]() { free_sized(buffer, data_sz); };
+    }
+    size_t r = ZSTD_decompress(buffer, data_sz, compressed.data(), compressed.size());
+    if (ZSTD_isError(r) || r != data_sz) {
+        free_data();
+        return io_result_mk_error((sstream() << "failed to decompress file '" << olean_fn << "'").str());
+    }
+    object * mod_region = mk_module_region(data_sz, buffer, base_addr + sizeof(olean_header), false, free_data);
+#if !defined(LEAN_WINDOWS) && defined(LEAN_MMAP)
+    if (buffer == base_addr + sizeof(olean_header))
+        mprotect(base_addr, map_sz, PROT_READ);
+#endif
+    return io_result_mk_ok(mod_region);
+}
+#endif
+
 extern "C" LEAN_EXPORT object * lean_read_module_data(object * fname, object *) {
     std::string olean_fn(string_cstr(fname));
     try {
@@ -160,7 +359,8 @@ extern "C" LEAN_EXPORT object * lean_read_module_data(object * fname, object *)
             || memcmp(header.marker, default_header.marker, sizeof(header.marker)) != 0) {
             return io_result_mk_error((sstream() << "failed to read file '" << olean_fn << "', invalid header").str());
         }
-        if (header.version != default_header.version || header.flags != default_header.flags
+        if (header.version != default_header.version ||
+            (header.flags & ~(LEAN_OLEAN_FLAG_ZSTD | LEAN_OLEAN_FLAG_CHECKSUM)) != default_header.flags
 #ifdef LEAN_CHECK_OLEAN_VERSION
             || strncmp(header.githash, LEAN_GITHASH, sizeof(header.githash)) != 0
 #endif
@@ -168,8 +368,26 @@ extern "C" LEAN_EXPORT object * lean_read_module_data(object * fname, object *)
             return io_result_mk_error((sstream() << "failed to read file '" << olean_fn << "', incompatible header").str());
         }
         char * base_addr = reinterpret_cast<char *>(header.base_addr);
+        size_t payload_sz = size - sizeof(olean_header);
+        olean_trailer trailer;
+        bool checksum = header.flags & LEAN_OLEAN_FLAG_CHECKSUM;
+        if (checksum) {
+            if (!read_olean_trailer(in, size, trailer)) {
+                return io_result_mk_error((sstream() << "failed to read file '" << olean_fn << "', file is truncated").str());
+            }
+            payload_sz = trailer.payload_size;
+        }
+        if (header.flags & LEAN_OLEAN_FLAG_ZSTD) {
+#ifdef LEAN_ZSTD
+            return read_compressed_module_data(in, payload_sz, base_addr, olean_fn, checksum ? &trailer : nullptr);
+#else
+            return io_result_mk_error((sstream() << "failed to read file '" << olean_fn << "', compressed .olean files are not supported by this build").str());
+#endif
+        }
         char * buffer = nullptr;
         bool is_mmap = false;
+        // mapping that is relocated in place because it did not land at `base_addr`, see below
+        char * relocated_map = nullptr;
         std::function<void()> free_data;
 #ifdef LEAN_WINDOWS
         // `FILE_SHARE_DELETE` is necessary to allow the file to (be marked to) be deleted while in use
@@ -196,6 +414,23 @@ extern "C" LEAN_EXPORT object * lean_read_module_data(object * fname, object *)
         }
 #ifdef LEAN_MMAP
         buffer = static_cast<char *>(mmap(base_addr, size, PROT_READ, MAP_PRIVATE, fd, 0));
+        // If the mapping did not land at `base_addr`, we still avoid reading the file into a separate
+        // buffer by fixing up the pointers in the private mapping itself. Only pages containing
+        // pointers are copied on write; pages of strings and scalar arrays stay shared with the page
+        // cache.
+        if (buffer != MAP_FAILED && buffer != base_addr && mprotect(buffer, size, PROT_READ | PROT_WRITE) == 0)
+            relocated_map = buffer;
+        if (relocated_map) {
+            // relocation visits every object from front to back
+            madvise(relocated_map, size, MADV_SEQUENTIAL);
+            madvise(relocated_map, size, MADV_WILLNEED);
+        } else if (buffer == base_addr) {
+            // Otherwise, the file is touched in no particular order at import. On network file
+            // systems, starting readahead of the whole file up front avoids serial page faults.
+            static bool prefetch = std::getenv("LEAN_OLEAN_PREFETCH") != nullptr;
+            if (prefetch)
+                madvise(buffer, size, MADV_WILLNEED);
+        }
 #endif
         close(fd);
         free_data = [=]() {
@@ -207,39 +442,78 @@ extern "C" LEAN_EXPORT object * lean_read_module_data(object * fname, object *)
         if (buffer && buffer == base_addr) {
             buffer += sizeof(olean_header);
             is_mmap = true;
+        } else if (relocated_map) {
+            buffer += sizeof(olean_header);
         } else {
 #ifdef LEAN_MMAP
             free_data();
 #endif
-            buffer = static_cast<char *>(malloc(size - sizeof(olean_header)));
+            buffer = static_cast<char *>(malloc(payload_sz));
             free_data = [=]() {
-                free_sized(buffer, size - sizeof(olean_header));
+                free_sized(buffer, payload_sz);
             };
-            in.read(buffer, size - sizeof(olean_header));
+            in.read(buffer, payload_sz);
             if (!in) {
                 return io_result_mk_error((sstream() << "failed to read file '" << olean_fn << "'").str());
             }
         }
         in.close();
 
-        compacted_region * region =
-          new compacted_region(size - sizeof(olean_header), buffer, base_addr + sizeof(olean_header), is_mmap, free_data);
-#if defined(__has_feature)
-#if __has_feature(address_sanitizer)
-        // do not report as leak
-        __lsan_ignore_object(region);
-#endif
+        if (checksum && crc32c(buffer, payload_sz) != trailer.checksum) {
+            free_data();
+            return io_result_mk_error((sstream() << "failed to read file '" << olean_fn << "', checksum mismatch").str());
+        }
+        object * mod_region = mk_module_region(payload_sz, buffer, base_addr + sizeof(olean_header), is_mmap, free_data);
+#if !defined(LEAN_WINDOWS) && defined(LEAN_MMAP)
+        if (relocated_map) {
+            mprotect(relocated_map, size, PROT_READ);
+            madvise(relocated_map, size, MADV_NORMAL);
+        }
 #endif
-        object * mod = region->read();
-        object * mod_region = alloc_cnstr(0, 2, 0);
-        cnstr_set(mod_region, 0, mod);
-        cnstr_set(mod_region, 1, box_size_t(reinterpret_cast<size_t>(region)));
         return io_result_mk_ok(mod_region);
     } catch (exception & ex) {
         return io_result_mk_error((sstream() << "failed to read '" << olean_fn << "': " << ex.what()).str());
     }
 }
 
+static obj_res read_module_data_fn(obj_arg fname, obj_arg) {
+    object * r = lean_read_module_data(fname, io_mk_world());
+    lean_dec(fname);
+    if (!io_result_is_ok(r)) {
+        dec(r);
+        return mk_option_none();
+    }
+    object * v = io_result_get_value(r);
+    inc(v);
+    dec(r);
+    return mk_option_some(v);
+}
+
+/* readModuleDataParallel (fnames : @& Array System.FilePath) : IO (Array (Option (ModuleData × CompactedRegion)))
+
+   Opening, mapping and, on an `mmap` miss, reading and relocating .olean files is independent
+   for each file, so we do it in one task per file. The imported objects are persistent, so
+   returning them from the tasks does not need to mark them as multi-threaded. */
+extern "C" LEAN_EXPORT object * lean_read_module_data_parallel(b_obj_arg fnames, object *) {
+    size_t n = array_size(fnames);
+    buffer<object *> tasks;
+    for (size_t i = 0; i < n; i++) {
+        object * fname = array_get(fnames, i);
+        inc(fname);
+        object * c = lean_alloc_closure(reinterpret_cast<void *>(read_module_data_fn), 2, 1);
+        lean_closure_set(c, 0, fname);
+        tasks.push_back(lean_task_spawn_core(c, 0, false));
+    }
+    object * r = alloc_array(0, n);
+    for (object * t : tasks) {
+        object * v = lean_task_get(t);
+        inc(v);
+        dec_ref(t);
+        r = array_push(r, v);
+    }
+    return io_result_mk_ok(r);
+}
+
 /*
 @[export lean.write_module_core]
 def writeModule (env : Environment) (fname : String) : IO Unit := */
@@ -248,4 +522,35 @@ extern "C" object * lean_write_module(object * env, object * fname, object *);
 void write_module(elab_environment const & env, std::string const & olean_fn) {
     consume_io_result(lean_write_module(env.to_obj_arg(), mk_string(olean_fn), io_mk_world()));
 }
+
+/*
+@[export lean_save_import_snapshot]
+def saveImportSnapshot (env : Environment) (fname : System.FilePath) : IO Unit */
+extern "C" object * lean_save_import_snapshot(object * env, object * fname, object *);
+
+void save_import_snapshot(elab_environment const & env, std::string const & fname) {
+    consume_io_result(lean_save_import_snapshot(env.to_obj_arg(), mk_string(fname), io_mk_world()));
+}
+
+static obj_res write_module_fn(obj_arg env, obj_arg fname, obj_arg) {
+    return lean_write_module(env, fname, io_mk_world());
+}
+
+object * write_module_async(elab_environment const & env, std::string const & olean_fn) {
+    /* The environment is now read by two threads. Marking it persistent rather than
+       multi-threaded also saves both of them the atomic reference count updates; the caller is
+       expected to keep `env` alive until the end of the process anyway. */
+    mark_persistent(env.raw());
+    object * c = lean_alloc_closure(reinterpret_cast<void *>(write_module_fn), 3, 2);
+    lean_closure_set(c, 0, env.to_obj_arg());
+    lean_closure_set(c, 1, mk_string(olean_fn));
+    return lean_task_spawn_core(c, 0, false);
+}
+
+void wait_for_module(object * task) {
+    object * r = lean_task_get(task);
+    inc(r);
+    dec_ref(task);
+    consume_io_result(r);
+}
 }
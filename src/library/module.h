@@ -15,4 +15,12 @@ Authors: Leonardo de Moura, Gabriel Ebner, Sebastian Ullrich
 namespace lean {
 /** \brief Store module using \c env. */
 LEAN_EXPORT void write_module(elab_environment const & env, std::string const & olean_fn);
+/** \brief Like \c write_module, but store the module in a task so that the caller can continue
+    with other work such as code generation in the meantime. \c env is marked persistent.
+    Use \c wait_for_module to wait for the result and rethrow any error. */
+LEAN_EXPORT object * write_module_async(elab_environment const & env, std::string const & olean_fn);
+LEAN_EXPORT void wait_for_module(object * task);
+/** \brief Store the imported modules of \c env in a single file that later processes can map
+    instead of the .olean files, see `LEAN_IMPORT_SNAPSHOT`. */
+LEAN_EXPORT void save_import_snapshot(elab_environment const & env, std::string const & fname);
 }
@@ -4,20 +4,44 @@ Released under Apache 2.0 license as described in the file LICENSE.
 
 Author: Gabriel Ebner
 */
+#include "runtime/thread.h"
 #include "library/profiling.h"
 #include "util/option_declarations.h"
 
 namespace lean {
 
 extern "C" uint8_t lean_get_profiler(obj_arg opts);
+extern "C" double lean_get_profiler_threshold(obj_arg opts);
+
+/* The profiler settings of the options last queried on this thread. `time_task` queries them for
+   every profiled region, almost always with the same options object, while each query is a linear
+   search through the option list. Holding on to the options makes the pointer comparison safe. */
+struct profiler_settings {
+    options m_opts;
+    bool    m_valid = false;
+    bool    m_profiler = false;
+    double  m_threshold = 0;
+};
+
+MK_THREAD_LOCAL_GET_DEF(profiler_settings, get_profiler_settings_cache);
+
+static profiler_settings const & get_profiler_settings(options const & opts) {
+    profiler_settings & s = get_profiler_settings_cache();
+    if (!s.m_valid || !is_eqp(s.m_opts, opts)) {
+        s.m_opts      = opts;
+        s.m_valid     = true;
+        s.m_profiler  = lean_get_profiler(opts.to_obj_arg());
+        s.m_threshold = lean_get_profiler_threshold(opts.to_obj_arg());
+    }
+    return s;
+}
+
 bool get_profiler(options const & opts) {
-    return lean_get_profiler(opts.to_obj_arg());
+    return get_profiler_settings(opts).m_profiler;
 }
 
-extern "C" double lean_get_profiler_threshold(obj_arg opts);
 second_duration get_profiling_threshold(options const & opts) {
-    double ms = lean_get_profiler_threshold(opts.to_obj_arg());
-    return second_duration(ms);
+    return second_duration(get_profiler_settings(opts).m_threshold);
 }
 
 void initialize_profiling() {
@@ -6,21 +6,144 @@ Author: Sebastian Ullrich
 */
 #include <string>
 #include <map>
+#include <vector>
+#include <unordered_map>
+#include <chrono>
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include "runtime/task_trace.h"
+#include "runtime/alloc.h"
 #include "library/time_task.h"
 #include "kernel/trace.h"
 
 namespace lean {
 
-static std::map<std::string, second_duration> * g_cum_times;
+/* Profiling times are accumulated per thread so that finishing a `time_task` neither takes a lock nor
+   looks up its category in a shared map. Categories are interned once per thread, and the per-thread
+   times are merged when displaying them. */
+
+#define LEAN_MAX_PROFILING_CATEGORIES 256
+// Number of declarations listed by `display_cumulative_profiling_times`.
+#define LEAN_PROFILING_TOP_HEARTBEATS 20
+
+struct profiling_accumulator {
+    // Nanoseconds per category id, only written by the owning thread.
+    atomic<uint64_t> m_times[LEAN_MAX_PROFILING_CATEGORIES];
+    std::unordered_map<std::string, unsigned> m_ids;
+    // Heartbeats consumed by each declaration, excluding nested tasks. Only contended when displaying.
+    mutex m_heartbeats_mutex;
+    std::unordered_map<std::string, uint64_t> m_heartbeats;
+    profiling_accumulator() {
+        for (auto & t : m_times) t.store(0, memory_order_relaxed);
+    }
+};
+
+/* The following is protected by `g_cum_times_mutex`. */
 static mutex * g_cum_times_mutex;
+// Interned categories, indexed by id.
+static std::vector<std::string> * g_profiling_categories;
+static std::unordered_map<std::string, unsigned> * g_profiling_category_ids;
+// Accumulators of running threads.
+static std::vector<profiling_accumulator *> * g_profiling_accumulators;
+// Times of finished threads, and of categories beyond `LEAN_MAX_PROFILING_CATEGORIES`.
+static std::map<std::string, second_duration> * g_cum_times;
+
+LEAN_THREAD_PTR(profiling_accumulator, g_profiling_accumulator);
 LEAN_THREAD_PTR(time_task, g_current_time_task);
 
+// Heartbeats of finished threads, protected by `g_cum_times_mutex`.
+static std::unordered_map<std::string, uint64_t> * g_cum_heartbeats;
+
+static void merge_heartbeats(profiling_accumulator & acc, std::unordered_map<std::string, uint64_t> & cum_heartbeats) {
+    lock_guard<mutex> _(acc.m_heartbeats_mutex);
+    for (auto const & p : acc.m_heartbeats)
+        cum_heartbeats[p.first] += p.second;
+}
+
+static void merge_profiling_accumulator(profiling_accumulator const & acc, std::map<std::string, second_duration> & cum_times) {
+    for (unsigned id = 0; id < g_profiling_categories->size(); id++) {
+        if (uint64_t ns = acc.m_times[id].load(memory_order_relaxed))
+            cum_times[(*g_profiling_categories)[id]] += std::chrono::nanoseconds(ns);
+    }
+}
+
+static void finalize_profiling_accumulator(void * p) {
+    profiling_accumulator * acc = static_cast<profiling_accumulator *>(p);
+    if (g_cum_times_mutex) {
+        lock_guard<mutex> _(*g_cum_times_mutex);
+        merge_profiling_accumulator(*acc, *g_cum_times);
+        merge_heartbeats(*acc, *g_cum_heartbeats);
+        auto & accs = *g_profiling_accumulators;
+        for (auto it = accs.begin(); it != accs.end(); it++) {
+            if (*it == acc) {
+                accs.erase(it);
+                break;
+            }
+        }
+    }
+    delete acc;
+    g_profiling_accumulator = nullptr;
+}
+
+static profiling_accumulator & get_profiling_accumulator() {
+    if (!g_profiling_accumulator) {
+        g_profiling_accumulator = new profiling_accumulator();
+        register_thread_finalizer(finalize_profiling_accumulator, g_profiling_accumulator);
+        lock_guard<mutex> _(*g_cum_times_mutex);
+        g_profiling_accumulators->push_back(g_profiling_accumulator);
+    }
+    return *g_profiling_accumulator;
+}
+
+/* Return the id of `category`, or `LEAN_MAX_PROFILING_CATEGORIES` if there are too many categories. */
+static unsigned intern_profiling_category(std::string const & category) {
+    profiling_accumulator & acc = get_profiling_accumulator();
+    auto it = acc.m_ids.find(category);
+    if (it != acc.m_ids.end())
+        return it->second;
+    unsigned id;
+    {
+        lock_guard<mutex> _(*g_cum_times_mutex);
+        auto git = g_profiling_category_ids->find(category);
+        if (git != g_profiling_category_ids->end()) {
+            id = git->second;
+        } else if (g_profiling_categories->size() < LEAN_MAX_PROFILING_CATEGORIES) {
+            id = g_profiling_categories->size();
+            g_profiling_categories->push_back(category);
+            (*g_profiling_category_ids)[category] = id;
+        } else {
+            return LEAN_MAX_PROFILING_CATEGORIES;
+        }
+    }
+    acc.m_ids[category] = id;
+    return id;
+}
+
+static void report_profiling_time(unsigned id, std::string const & category, second_duration time) {
+    if (id < LEAN_MAX_PROFILING_CATEGORIES) {
+        atomic<uint64_t> & t = get_profiling_accumulator().m_times[id];
+        uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(time).count();
+        t.store(t.load(memory_order_relaxed) + ns, memory_order_relaxed);
+    } else {
+        lock_guard<mutex> _(*g_cum_times_mutex);
+        (*g_cum_times)[category] += time;
+    }
+}
+
+static void report_profiling_heartbeats(name const & decl, uint64_t heartbeats) {
+    if (heartbeats == 0)
+        return;
+    profiling_accumulator & acc = get_profiling_accumulator();
+    lock_guard<mutex> _(acc.m_heartbeats_mutex);
+    acc.m_heartbeats[decl.to_string()] += heartbeats;
+}
+
 bool has_profiling_task() {
     return g_current_time_task != nullptr;
 }
 void report_profiling_time(std::string const & category, second_duration time) {
-    lock_guard<mutex> _(*g_cum_times_mutex);
-    (*g_cum_times)[category] += time;
+    report_profiling_time(intern_profiling_category(category), category, time);
 }
 void exclude_profiling_time_from_current_task(second_duration time) {
     if (g_current_time_task)
@@ -28,29 +151,157 @@ void exclude_profiling_time_from_current_task(second_duration time) {
 }
 
 void display_cumulative_profiling_times(std::ostream & out) {
-    if (g_cum_times->empty())
+    std::map<std::string, second_duration> cum_times;
+    std::unordered_map<std::string, uint64_t> cum_heartbeats;
+    {
+        lock_guard<mutex> _(*g_cum_times_mutex);
+        cum_times = *g_cum_times;
+        cum_heartbeats = *g_cum_heartbeats;
+        for (profiling_accumulator * acc : *g_profiling_accumulators) {
+            merge_profiling_accumulator(*acc, cum_times);
+            merge_heartbeats(*acc, cum_heartbeats);
+        }
+    }
+    if (cum_times.empty())
         return;
     sstream ss;
     ss << "cumulative profiling times:\n";
-    for (auto const & p : *g_cum_times)
+    for (auto const & p : cum_times)
         ss << "\t" << p.first << " " << display_profiling_time{p.second} << "\n";
+    if (!cum_heartbeats.empty()) {
+        std::vector<std::pair<std::string, uint64_t>> top(cum_heartbeats.begin(), cum_heartbeats.end());
+        size_t n = std::min<size_t>(top.size(), LEAN_PROFILING_TOP_HEARTBEATS);
+        std::partial_sort(top.begin(), top.begin() + n, top.end(), [](auto const & a, auto const & b) {
+            return a.second > b.second || (a.second == b.second && a.first < b.first);
+        });
+        // `maxHeartbeats` is given in thousands of heartbeats
+        ss << "top heartbeat consumers (in thousands):\n";
+        for (size_t i = 0; i < n; i++)
+            ss << "\t" << top[i].first << " " << top[i].second / 1000 << "\n";
+    }
     // output atomically, like IO.print
     out << ss.str();
 }
 
+/* Spans recorded for `start_profile_trace`. */
+struct profile_span {
+    unsigned    m_tid;
+    unsigned    m_category; // category id, see `intern_profiling_category`
+    uint64_t    m_start;    // microseconds since `start_profile_trace`
+    uint64_t    m_end;
+    uint64_t    m_heartbeats;
+    std::string m_decl;
+};
+
+static bool g_profile_trace = false;
+static char const * g_profile_trace_fname = nullptr;
+static std::chrono::steady_clock::time_point g_profile_trace_start;
+static mutex * g_profile_trace_mutex;
+static std::vector<profile_span> * g_profile_spans;
+/* Names of the categories of the recorded spans, indexed by id. The trace is written at exit, after
+   `finalize_time_task` may have released the profiling categories, so it keeps its own copy. */
+static std::vector<std::string> * g_profile_trace_categories;
+static atomic<unsigned> g_profile_trace_next_tid(1);
+LEAN_THREAD_VALUE(unsigned, g_profile_trace_tid, 0);
+
+static uint64_t get_profile_trace_ts(std::chrono::steady_clock::time_point t) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(t - g_profile_trace_start).count();
+}
+
+static void record_profile_span(unsigned category, std::string const & category_name, name const & decl,
+                                std::chrono::steady_clock::time_point start, uint64_t heartbeats) {
+    if (g_profile_trace_tid == 0)
+        g_profile_trace_tid = g_profile_trace_next_tid++;
+    profile_span span{g_profile_trace_tid, category, get_profile_trace_ts(start),
+                      get_profile_trace_ts(std::chrono::steady_clock::now()), heartbeats,
+                      decl ? decl.to_string() : std::string()};
+    lock_guard<mutex> _(*g_profile_trace_mutex);
+    if (category < LEAN_MAX_PROFILING_CATEGORIES) {
+        if (category >= g_profile_trace_categories->size())
+            g_profile_trace_categories->resize(category + 1);
+        std::string & cat = (*g_profile_trace_categories)[category];
+        if (cat.empty())
+            cat = category_name;
+    }
+    g_profile_spans->push_back(std::move(span));
+}
+
+/* Write the recorded spans as complete events, nested spans of a thread are shown stacked. */
+static void write_profile_trace(std::ostream & out) {
+    std::vector<profile_span> spans;
+    std::vector<std::string> categories;
+    {
+        lock_guard<mutex> _(*g_profile_trace_mutex);
+        spans = *g_profile_spans;
+        categories = *g_profile_trace_categories;
+    }
+    out << "{\"traceEvents\":[\n";
+    bool first = true;
+    for (profile_span const & span : spans) {
+        if (!first) out << ",\n";
+        first = false;
+        std::string const & category = span.m_category < categories.size() ? categories[span.m_category] : "other";
+        out << "{\"pid\":1,\"tid\":" << span.m_tid << ",\"ph\":\"X\",\"ts\":" << span.m_start
+            << ",\"dur\":" << span.m_end - span.m_start << ",\"cat\":";
+        write_json_string(out, category);
+        out << ",\"name\":";
+        write_json_string(out, span.m_decl.empty() ? category : category + " of " + span.m_decl);
+        out << ",\"args\":{\"heartbeats\":" << span.m_heartbeats;
+        if (!span.m_decl.empty()) {
+            out << ",\"decl\":";
+            write_json_string(out, span.m_decl);
+        }
+        out << "}}";
+    }
+    out << "\n]}\n";
+}
+
+static void write_profile_trace_at_exit() {
+    std::ofstream out(g_profile_trace_fname);
+    write_profile_trace(out);
+}
+
+void start_profile_trace(char const * fname) {
+    if (g_profile_trace)
+        return;
+    g_profile_trace_fname = fname;
+    g_profile_trace_start = std::chrono::steady_clock::now();
+    std::atexit(write_profile_trace_at_exit);
+    g_profile_trace = true;
+}
+
 void initialize_time_task() {
+    g_profile_trace_mutex = new mutex;
+    g_profile_spans = new std::vector<profile_span>;
+    g_profile_trace_categories = new std::vector<std::string>;
     g_cum_times_mutex = new mutex;
+    g_profiling_categories = new std::vector<std::string>;
+    g_profiling_category_ids = new std::unordered_map<std::string, unsigned>;
+    g_profiling_accumulators = new std::vector<profiling_accumulator *>;
     g_cum_times = new std::map<std::string, second_duration>;
+    g_cum_heartbeats = new std::unordered_map<std::string, uint64_t>;
 }
 
 void finalize_time_task() {
+    delete g_cum_heartbeats;
     delete g_cum_times;
+    delete g_profiling_accumulators;
+    delete g_profiling_category_ids;
+    delete g_profiling_categories;
     delete g_cum_times_mutex;
+    // Accumulators of threads that are still running are released by their thread finalizers.
+    g_cum_times_mutex = nullptr;
 }
 
 time_task::time_task(std::string const & category, options const & opts, name decl) :
         m_category(category) {
     if (get_profiler(opts)) {
+        m_category_id = intern_profiling_category(m_category);
+        m_decl = decl;
+        m_start_heartbeats = get_num_heartbeats();
+        m_nested_heartbeats = 0;
+        if (g_profile_trace)
+            m_start = std::chrono::steady_clock::now();
         m_timeit = optional<xtimeit>(get_profiling_threshold(opts), [=](second_duration duration) mutable {
             sstream ss;
             ss << m_category;
@@ -68,10 +319,19 @@ time_task::time_task(std::string const & category, options const & opts, name de
 time_task::~time_task() {
     if (m_timeit) {
         g_current_time_task = m_parent_task;
-        report_profiling_time(m_category, m_timeit->get_elapsed());
-        if (m_parent_task && m_parent_task->m_timeit)
+        report_profiling_time(m_category_id, m_category, m_timeit->get_elapsed());
+        // The counter may have been reset in between, e.g. by `IO.setNumHeartbeats`.
+        uint64_t end_heartbeats = get_num_heartbeats();
+        uint64_t heartbeats = end_heartbeats >= m_start_heartbeats ? end_heartbeats - m_start_heartbeats : 0;
+        if (m_decl)
+            report_profiling_heartbeats(m_decl, heartbeats - std::min(heartbeats, m_nested_heartbeats));
+        if (g_profile_trace)
+            record_profile_span(m_category_id, m_category, m_decl, m_start, heartbeats);
+        if (m_parent_task && m_parent_task->m_timeit) {
             // report exclusive times
             m_parent_task->m_timeit->exclude_duration(m_timeit->get_elapsed_inclusive());
+            m_parent_task->m_nested_heartbeats += heartbeats;
+        }
     }
 }
 
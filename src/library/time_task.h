@@ -15,10 +15,18 @@ LEAN_EXPORT bool has_profiling_task();
 LEAN_EXPORT void report_profiling_time(std::string const & category, second_duration time);
 LEAN_EXPORT void display_cumulative_profiling_times(std::ostream & out);
 LEAN_EXPORT void exclude_profiling_time_from_current_task(second_duration time);
+/* Record the spans of all `time_task`s and write them to `fname` in the Chrome trace event format
+   when the process exits. Only tasks created with the `profiler` option set are recorded. */
+LEAN_EXPORT void start_profile_trace(char const * fname);
 
 /** Measure time of some task and report it for the final cumulative profile. */
 class LEAN_EXPORT time_task {
     std::string     m_category;
+    unsigned        m_category_id;
+    name            m_decl;
+    std::chrono::steady_clock::time_point m_start;
+    uint64_t        m_start_heartbeats;
+    uint64_t        m_nested_heartbeats; // heartbeats of nested tasks, excluded from this one
     optional<xtimeit> m_timeit;
     time_task *     m_parent_task;
 public:
@@ -4,11 +4,19 @@ Released under Apache 2.0 license as described in the file LICENSE.
 
 Author: Leonardo de Moura
 */
+#include <cstdlib>
 #include <vector>
+#include <map>
+#include <algorithm>
+#include <cmath>
 #include <lean/lean.h>
+#if !defined(LEAN_WINDOWS) && !defined(LEAN_EMSCRIPTEN)
+#include <sys/mman.h>
+#endif
 #include "runtime/thread.h"
 #include "runtime/debug.h"
 #include "runtime/alloc.h"
+#include "runtime/allocprof.h"
 
 #ifdef LEAN_RUNTIME_STATS
 #define LEAN_RUNTIME_STAT_CODE(c) c
@@ -22,10 +30,30 @@ Author: Leonardo de Moura
 #define LEAN_NOINLINE
 #endif
 
+/* The page size is a compile-time constant because `get_page_of` uses it to mask object addresses
+   on every deallocation. The segment size is only the default, see `initialize_segment_config`. */
+#ifndef LEAN_PAGE_SIZE
 #define LEAN_PAGE_SIZE             8192        // 8 Kb
+#endif
 #define LEAN_SEGMENT_SIZE          8*1024*1024 // 8 Mb
+#define LEAN_HUGE_PAGE_SIZE        2*1024*1024 // 2 Mb
+/* Number of pages moved to page free lists before a heap tries to return empty pages to the OS. */
+#define LEAN_RELEASE_INTERVAL      1024
+/* Number of allocation slow path executions before a heap republishes its statistics. */
+#define LEAN_PUBLISH_STATS_INTERVAL 256
+/* Number of allocated bytes after which a heap checks whether allocation sampling has been enabled. */
+#define LEAN_ALLOC_SAMPLE_RECHECK  16*1024*1024
 #define LEAN_NUM_SLOTS             (LEAN_MAX_SMALL_OBJECT_SIZE / LEAN_OBJECT_SIZE_DELTA)
-#define LEAN_MAX_TO_EXPORT_OBJS    1024
+/* Objects bigger than LEAN_MAX_SMALL_OBJECT_SIZE, up to LEAN_MAX_MEDIUM_OBJECT_SIZE bytes, are
+   "medium" objects. They are served from per-heap caches of free blocks, backed by a central free
+   list per size class. Bigger objects are allocated using `malloc`. */
+#define LEAN_MAX_MEDIUM_OBJECT_SIZE   32*1024     // 32 Kb
+#define LEAN_MEDIUM_SIZE_DELTA        1024
+#define LEAN_NUM_MEDIUM_SLOTS         ((LEAN_MAX_MEDIUM_OBJECT_SIZE - LEAN_MAX_SMALL_OBJECT_SIZE) / LEAN_MEDIUM_SIZE_DELTA)
+/* Amount of memory moved between a heap's medium object cache and the central free lists at once. */
+#define LEAN_MEDIUM_BATCH_SIZE        256*1024    // 256 Kb
+/* Maximum amount of free memory per size class in a heap's medium object cache. */
+#define LEAN_MEDIUM_CACHE_SIZE        1024*1024   // 1 Mb
 
 LEAN_CASSERT(LEAN_PAGE_SIZE > LEAN_MAX_SMALL_OBJECT_SIZE);
 LEAN_CASSERT(LEAN_SEGMENT_SIZE > LEAN_PAGE_SIZE);
@@ -42,8 +70,13 @@ static atomic<uint64> g_num_dealloc(0);
 static atomic<uint64> g_num_small_dealloc(0);
 static atomic<uint64> g_num_segments(0);
 static atomic<uint64> g_num_pages(0);
-static atomic<uint64> g_num_exports(0);
+static atomic<uint64> g_num_remote_frees(0);
 static atomic<uint64> g_num_recycled_pages(0);
+static atomic<uint64> g_num_released_pages(0);
+static atomic<uint64> g_num_released_segments(0);
+static atomic<uint64> g_num_medium_alloc(0);
+static atomic<uint64> g_num_medium_arenas(0);
+static atomic<uint64> g_num_released_medium_arenas(0);
 struct alloc_stats {
     ~alloc_stats() {
         std::cerr << "num. alloc.:         " << g_num_alloc << "\n";
@@ -53,7 +86,12 @@ struct alloc_stats {
         std::cerr << "num. segments:       " << g_num_segments << "\n";
         std::cerr << "num. pages:          " << g_num_pages << "\n";
         std::cerr << "num. recycled pages: " << g_num_recycled_pages << "\n";
-        std::cerr << "num. exports:        " << g_num_exports << "\n";
+        std::cerr << "num. released pages: " << g_num_released_pages << "\n";
+        std::cerr << "num. released segs.: " << g_num_released_segments << "\n";
+        std::cerr << "num. remote frees:   " << g_num_remote_frees << "\n";
+        std::cerr << "num. medium alloc.:  " << g_num_medium_alloc << "\n";
+        std::cerr << "num. medium arenas:  " << g_num_medium_arenas << "\n";
+        std::cerr << "num. released arenas:" << g_num_released_medium_arenas << "\n";
     }
 };
 static alloc_stats g_alloc_stats;
@@ -61,8 +99,10 @@ static alloc_stats g_alloc_stats;
 
 struct heap;
 struct page;
+struct segment;
 struct page_header {
     atomic<heap *>   m_heap;
+    segment *        m_segment;
     page *           m_next;
     page *           m_prev;
     void *           m_free_list;
@@ -71,6 +111,12 @@ struct page_header {
     unsigned         m_num_free;
     unsigned         m_slot_idx;
     bool             m_in_page_free_list;
+    /* Objects in this page deallocated by other threads. They are pushed here with a single
+       compare-and-swap, and reclaimed in bulk by the owner heap in `heap::import_objs`. */
+    atomic<void *>   m_thread_free{nullptr};
+    /* Next page in the owner heap's `m_remote_free_pages` list. The page is in that list iff
+       `m_thread_free` is not empty and the owner has not reclaimed it yet. */
+    page *           m_next_remote_free{nullptr};
 };
 
 struct page {
@@ -83,75 +129,280 @@ struct page {
     void set_heap(heap * h) { m_header.m_heap = h; }
     heap * get_heap() { return m_header.m_heap; }
     bool has_many_free() const { return m_header.m_num_free > m_header.m_max_free / 4; }
+    bool is_empty() const { return m_header.m_num_free == m_header.m_max_free; }
     bool in_page_free_list() const { return m_header.m_in_page_free_list; }
     unsigned get_slot_idx() const { return m_header.m_slot_idx; }
     void push_free_obj(void * o);
+    void push_remote_free_obj(void * o);
 };
 
 inline char * align_ptr(char * p, size_t a) {
     return reinterpret_cast<char*>(lean_align(reinterpret_cast<size_t>(p), a));
 }
 
+/* Segment geometry, configured once at startup by `initialize_segment_config`. */
+static size_t g_segment_size = LEAN_SEGMENT_SIZE;
+static bool   g_huge_pages   = false;
+
+/* A segment is a header followed by `g_segment_size` bytes from which pages are carved. */
 struct segment {
     segment *    m_next{nullptr};
     char *       m_next_page_mem;
-    char         m_data[LEAN_SEGMENT_SIZE];
+    char *       m_end;
+    /* Number of pages of this segment currently returned to the OS. */
+    unsigned     m_num_released{0};
+
+    char * get_data() { return reinterpret_cast<char*>(this + 1); }
 
     char * get_first_page_mem() {
-        lean_assert(align_ptr(m_data, LEAN_PAGE_SIZE) >= m_data);
-        lean_assert(align_ptr(m_data, LEAN_PAGE_SIZE) > reinterpret_cast<char*>(this));
-        return align_ptr(m_data, LEAN_PAGE_SIZE);
+        lean_assert(align_ptr(get_data(), LEAN_PAGE_SIZE) >= get_data());
+        lean_assert(align_ptr(get_data(), LEAN_PAGE_SIZE) > reinterpret_cast<char*>(this));
+        return align_ptr(get_data(), LEAN_PAGE_SIZE);
     }
 
     segment() {
         m_next_page_mem = get_first_page_mem();
+        m_end           = get_data() + g_segment_size;
     }
 
     bool is_full() const {
-        return m_next_page_mem + LEAN_PAGE_SIZE > m_data + LEAN_SEGMENT_SIZE;
+        return m_next_page_mem + LEAN_PAGE_SIZE > m_end;
+    }
+
+    unsigned get_num_pages() {
+        return (m_next_page_mem - get_first_page_mem()) / LEAN_PAGE_SIZE;
     }
 };
 
+static size_t get_segment_mem_size() {
+    size_t sz = sizeof(segment) + g_segment_size;
+    if (g_huge_pages)
+        sz = lean_align(sz, LEAN_HUGE_PAGE_SIZE);
+    return sz;
+}
+
+/* Bytes of segments and medium object arenas currently held by the allocator. */
+static atomic<size_t> g_allocator_memory(0);
+
+static void * alloc_segment_mem(size_t sz) {
+    g_allocator_memory += sz;
+#if defined(LEAN_WINDOWS) || defined(LEAN_EMSCRIPTEN)
+    void * r = malloc(sz);
+    if (r == nullptr) lean_internal_panic_out_of_memory();
+    return r;
+#else
+    void * r = MAP_FAILED;
+#ifdef MAP_HUGETLB
+    if (g_huge_pages)
+        r = mmap(nullptr, sz, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+    if (r == MAP_FAILED) {
+        /* No explicit huge pages reserved by the system, fall back to transparent huge pages. */
+        r = mmap(nullptr, sz, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (r == MAP_FAILED) lean_internal_panic_out_of_memory();
+#ifdef MADV_HUGEPAGE
+        if (g_huge_pages)
+            madvise(r, sz, MADV_HUGEPAGE);
+#endif
+    }
+    return r;
+#endif
+}
+
+static void free_segment_mem(void * mem, size_t sz) {
+    g_allocator_memory -= sz;
+#if defined(LEAN_WINDOWS) || defined(LEAN_EMSCRIPTEN)
+    (void)sz;
+    free(mem);
+#else
+    munmap(mem, sz);
+#endif
+}
+
+/* Return the physical memory backing `[mem, mem+sz)` to the OS. The range stays mapped, and reads
+   zero-filled pages when touched again. Return false if this is not supported. */
+static bool decommit_mem(void * mem, size_t sz) {
+#if defined(LEAN_WINDOWS) || defined(LEAN_EMSCRIPTEN)
+    /* Segments are `malloc`ed on these platforms, so we cannot decommit parts of them. */
+    (void)mem; (void)sz;
+    return false;
+#else
+    return madvise(mem, sz, MADV_DONTNEED) == 0;
+#endif
+}
+
+/* Parse a size such as `4194304`, `512k`, or `4m`. Return 0 on failure. */
+static size_t parse_size(char const * s) {
+    char * end;
+    unsigned long long r = std::strtoull(s, &end, 10);
+    switch (*end) {
+    case 'k': case 'K': r *= 1024; end++; break;
+    case 'm': case 'M': r *= 1024*1024; end++; break;
+    case 'g': case 'G': r *= 1024*1024*1024; end++; break;
+    default: break;
+    }
+    return *end == 0 ? static_cast<size_t>(r) : 0;
+}
+
+/* Select the segment geometry using the environment variables
+   - `LEAN_SEGMENT_SIZE`: size of each allocator segment (e.g. `1m`, at least four pages), and
+   - `LEAN_HUGE_PAGES`: if set, back segments with huge pages (`MAP_HUGETLB` if available,
+     `madvise(MADV_HUGEPAGE)` otherwise).
+   Smaller segments reduce the footprint of many short-lived or mostly idle processes, while large
+   huge-page-backed segments reduce TLB pressure in batch builds. */
+static void initialize_segment_config() {
+#ifndef LEAN_EMSCRIPTEN
+    if (char const * sz = std::getenv("LEAN_SEGMENT_SIZE")) {
+        size_t n = parse_size(sz);
+        if (n >= 4*LEAN_PAGE_SIZE) {
+            g_segment_size = lean_align(n, LEAN_PAGE_SIZE);
+        } else {
+            std::cerr << "warning: ignoring invalid LEAN_SEGMENT_SIZE '" << sz << "'\n";
+        }
+    }
+    if (std::getenv("LEAN_HUGE_PAGES"))
+        g_huge_pages = true;
+#endif
+}
+
 struct heap {
     segment * m_curr_segment{nullptr};
     heap *    m_next_orphan{nullptr};
     page *    m_curr_page[LEAN_NUM_SLOTS];
     page *    m_page_free_list[LEAN_NUM_SLOTS];
-    /* Objects that must be sent to other heaps. */
-    void *    m_to_export_list{nullptr};
-    unsigned  m_to_export_list_size{0};
-    mutex     m_mutex; /* for the following fields */
-    /* The following list contains object by this heap that were deallocated
-       by other heaps. */
-    void *    m_to_import_list{nullptr};
+    /* Pages owned by this heap containing objects deallocated by other heaps.
+       See `page::m_thread_free`. */
+    atomic<page *> m_remote_free_pages{nullptr};
+    /* Pages returned to the OS by `release_free_pages`, to be reused by `alloc_page`.
+       We store their segments here since the page headers are gone. */
+    std::vector<std::pair<page *, segment *>> m_released_pages;
+    /* Number of pages moved to page free lists since the last `release_free_pages`. */
+    unsigned  m_num_recycled{0};
     uint64_t  m_heartbeat{0}; /* Counter for implementing "deterministic timeouts". It is currently the number of small allocations */
+    /* Link in the list of all heaps, see `heap_manager::m_heaps`. */
+    heap *    m_next_heap{nullptr};
+    /* Regions (see `scoped_region`) are heaps whose memory is released in bulk. */
+    bool      m_is_region{false};
+    heap *    m_region_outer{nullptr}; /* the heap that was active when the region was entered */
+    /* Number of bytes to be allocated before the next allocation sample, see `sample_alloc`. */
+    int64_t   m_sample_countdown{LEAN_ALLOC_SAMPLE_RECHECK};
+    uint64_t  m_sample_rng{0x9e3779b97f4a7c15ull};
+    /* Statistics maintained by the owner thread. */
+    uint64_t  m_num_segments{0};
+    uint64_t  m_num_remote_frees{0};
+    unsigned  m_num_cold_allocs{0};
+    /* Snapshot of the statistics above and of the page lists, published by `publish_stats` so that
+       other threads can read them without synchronizing with the owner. */
+    struct slot_stats {
+        atomic<uint64_t> m_num_pages{0};
+        atomic<uint64_t> m_num_objs{0};
+        atomic<uint64_t> m_num_free{0};
+    };
+    slot_stats           m_slot_stats[LEAN_NUM_SLOTS];
+    /* Cache of free medium objects, see `alloc_medium`. */
+    void *    m_medium_free[LEAN_NUM_MEDIUM_SLOTS];
+    unsigned  m_medium_num_free[LEAN_NUM_MEDIUM_SLOTS];
+    atomic<uint64_t>     m_pub_num_segments{0};
+    atomic<uint64_t>     m_pub_num_released{0};
+    atomic<uint64_t>     m_pub_num_remote_frees{0};
     void import_objs();
-    void export_objs();
     void alloc_segment();
+    void release_free_pages(bool keep_reserve);
+    void publish_stats();
+};
+
+static inline unsigned get_medium_slot_idx(size_t sz) {
+    lean_assert(LEAN_MAX_SMALL_OBJECT_SIZE < sz && sz <= LEAN_MAX_MEDIUM_OBJECT_SIZE);
+    return (sz - LEAN_MAX_SMALL_OBJECT_SIZE - 1) / LEAN_MEDIUM_SIZE_DELTA;
+}
+
+static inline size_t get_medium_obj_size(unsigned slot_idx) {
+    return LEAN_MAX_SMALL_OBJECT_SIZE + (slot_idx + 1) * LEAN_MEDIUM_SIZE_DELTA;
+}
+
+static inline unsigned get_medium_batch_size(unsigned slot_idx) {
+    return LEAN_MEDIUM_BATCH_SIZE / get_medium_obj_size(slot_idx);
+}
+
+/* An arena from which medium objects are carved. `m_live` is the number of bytes of its objects
+   that are not in the central free lists, i.e., that are in use or cached by a heap. */
+struct medium_arena {
+    char *    m_end;
+    size_t    m_live;
+};
+
+/* Central free lists for medium objects, shared by all heaps. */
+struct medium_central {
+    mutex     m_mutex;
+    void *    m_free[LEAN_NUM_MEDIUM_SLOTS];
+    unsigned  m_num_free[LEAN_NUM_MEDIUM_SLOTS];
+    /* All arenas, indexed by their first byte, to find the arena of an object. */
+    std::map<char *, medium_arena> m_arenas;
+    /* Remaining memory of the current arena from which new medium objects are carved. */
+    char *    m_arena_curr{nullptr};
+    char *    m_arena_end{nullptr};
+
+    medium_arena & get_arena(void * o) {
+        auto it = m_arenas.upper_bound(static_cast<char *>(o));
+        lean_assert(it != m_arenas.begin());
+        --it;
+        lean_assert(static_cast<char *>(o) < it->second.m_end);
+        return it->second;
+    }
+
+    medium_central() {
+        for (unsigned i = 0; i < LEAN_NUM_MEDIUM_SLOTS; i++) {
+            m_free[i]     = nullptr;
+            m_num_free[i] = 0;
+        }
+    }
 };
 
 struct heap_manager {
-    /* The mutex protects the list of orphan segments. */
-    mutex             m_mutex;
-    heap *            m_orphans{nullptr};
+    /* Lock-free stack of orphan heaps.
+
+       `push_orphan` is a standard Treiber push. To avoid the ABA problem on pop without tagged
+       pointers, `pop_orphan` detaches the whole list with a single `exchange`, keeps its first
+       element, and pushes the (now privately owned) remainder back. A concurrent `pop_orphan`
+       may observe an empty list in the meantime and allocate a fresh heap instead, which is
+       harmless. */
+    atomic<heap *>    m_orphans{nullptr};
+    /* All heaps ever created (heaps are never deleted, only orphaned and adopted again). */
+    atomic<heap *>    m_heaps{nullptr};
+    medium_central    m_medium;
+
+    void register_heap(heap * h) {
+        heap * head = m_heaps.load();
+        do {
+            h->m_next_heap = head;
+        } while (!m_heaps.compare_exchange_strong(head, h));
+    }
+
+    void push_orphans(heap * first, heap * last) {
+        heap * head = m_orphans.load();
+        do {
+            last->m_next_orphan = head;
+        } while (!m_orphans.compare_exchange_strong(head, first));
+    }
 
     void push_orphan(heap * h) {
-        /* TODO(Leo): avoid mutex */
-        lock_guard<mutex> lock(m_mutex);
-        h->m_next_orphan = m_orphans;
-        m_orphans = h;
+        push_orphans(h, h);
     }
 
     heap * pop_orphan() {
-        /* TODO(Leo): avoid mutex */
-        lock_guard<mutex> lock(m_mutex);
-        if (m_orphans) {
-            heap * h = m_orphans;
-            m_orphans = h->m_next_orphan;
-            return h;
-        } else {
+        if (m_orphans.load() == nullptr)
+            return nullptr;
+        heap * h = m_orphans.exchange(nullptr);
+        if (h == nullptr)
             return nullptr;
+        if (heap * rest = h->m_next_orphan) {
+            heap * last = rest;
+            while (last->m_next_orphan)
+                last = last->m_next_orphan;
+            push_orphans(rest, last);
         }
+        h->m_next_orphan = nullptr;
+        return h;
     }
 };
 
@@ -163,6 +414,11 @@ LEAN_THREAD_GLOBAL_PTR(page *, g_curr_pages);
 LEAN_THREAD_PTR(heap, g_heap);
 static heap_manager * g_heap_manager = nullptr;
 
+/* Current page of the size classes of a region that have not been used yet, see `mk_heap`. Its
+   free list is always empty, so the first allocation of each size class takes the slow path,
+   which replaces it with a fresh page. It is never written to. */
+static page g_unused_slot_page;
+
 inline void set_next_obj(void * obj, void * next) {
     *reinterpret_cast<void**>(obj) = next;
 }
@@ -211,6 +467,7 @@ void page::push_free_obj(void * o) {
         unsigned slot_idx = m_header.m_slot_idx;
         if (this != h->m_curr_page[slot_idx]) {
             LEAN_RUNTIME_STAT_CODE(g_num_recycled_pages++);
+            h->m_num_recycled++;
             m_header.m_in_page_free_list = true;
             page_list_remove(h->m_curr_page[slot_idx], this);
             page_list_insert(h->m_page_free_list[slot_idx], this);
@@ -218,76 +475,157 @@ void page::push_free_obj(void * o) {
     }
 }
 
-void heap::import_objs() {
-    void * to_import = nullptr;
-    {   // TODO(Leo): avoid mutex using compare and swap
-        lock_guard<mutex> lock(m_mutex);
-        to_import = m_to_import_list;
-        m_to_import_list = nullptr;
-    }
-    while (to_import) {
-        page * p = get_page_of(to_import);
-        void * n = get_next_obj(to_import);
-        p->push_free_obj(to_import);
-        to_import = n;
+void page::push_remote_free_obj(void * o) {
+    lean_assert(get_page_of(o) == this);
+    LEAN_RUNTIME_STAT_CODE(g_num_remote_frees++);
+    void * head = m_header.m_thread_free.load();
+    do {
+        set_next_obj(o, head);
+    } while (!m_header.m_thread_free.compare_exchange_strong(head, o));
+    if (head == nullptr) {
+        /* We are responsible for notifying the owner heap. The page cannot already be in
+           `m_remote_free_pages` since only the owner empties `m_thread_free`, and it does so
+           after removing the page from that list. */
+        heap * h = get_heap();
+        page * pages = h->m_remote_free_pages.load();
+        do {
+            m_header.m_next_remote_free = pages;
+        } while (!h->m_remote_free_pages.compare_exchange_strong(pages, this));
     }
 }
 
-struct export_entry {
-    heap * m_heap;
-    void * m_head;
-    void * m_tail;
-};
-
-void heap::export_objs() {
-    std::vector<export_entry> to_export;
-    void * o = m_to_export_list;
-    while (o != nullptr) {
-        void * n   = get_next_obj(o);
-        heap * h   = get_page_of(o)->get_heap();
-        bool found = false;
-        for (export_entry & e : to_export) {
-            if (e.m_heap == h) {
-                set_next_obj(o, e.m_head);
-                e.m_head = o;
-                found = true;
-                break;
-            }
-        }
-        if (!found) {
-            set_next_obj(o, nullptr);
-            to_export.push_back(export_entry{h, o, o});
+void heap::import_objs() {
+    if (m_remote_free_pages.load() == nullptr)
+        return;
+    /* Single consumer: detaching the whole list is not subject to the ABA problem. */
+    page * p = m_remote_free_pages.exchange(nullptr);
+    while (p) {
+        /* Read the link before emptying `m_thread_free`: afterwards, another thread may push `p`
+           again and overwrite it. */
+        page * next_p = p->m_header.m_next_remote_free;
+        void * o = p->m_header.m_thread_free.exchange(nullptr);
+        while (o) {
+            void * n = get_next_obj(o);
+            p->push_free_obj(o);
+            m_num_remote_frees++;
+            o = n;
         }
-        o = n;
-    }
-    m_to_export_list      = nullptr;
-    m_to_export_list_size = 0;
-    for (export_entry const & e : to_export) {
-        unique_lock<mutex> lock(e.m_heap->m_mutex);
-        set_next_obj(e.m_tail, e.m_heap->m_to_import_list);
-        e.m_heap->m_to_import_list = e.m_head;
+        p = next_p;
     }
 }
 
 void heap::alloc_segment() {
     LEAN_RUNTIME_STAT_CODE(g_num_segments++);
-    segment * s = new segment();
+    m_num_segments++;
+    segment * s = new (alloc_segment_mem(get_segment_mem_size())) segment();
     s->m_next   = m_curr_segment;
     m_curr_segment = s;
 }
 
+/* Return empty pages in the page free lists to the OS, and unmap segments all of whose pages have
+   been returned. If `keep_reserve` is true, we keep one empty page per size class to avoid
+   repeatedly releasing and faulting in pages of a heap with a stable working set. */
+void heap::release_free_pages(bool keep_reserve) {
+    m_num_recycled = 0;
+    bool released = false;
+    for (unsigned i = 0; i < LEAN_NUM_SLOTS; i++) {
+        bool kept = !keep_reserve;
+        page * p = m_page_free_list[i];
+        while (p) {
+            page * n = p->get_next();
+            if (p->is_empty()) {
+                if (!kept) {
+                    kept = true;
+                } else {
+                    segment * s = p->m_header.m_segment;
+                    if (p == m_page_free_list[i]) {
+                        m_page_free_list[i] = n;
+                    } else {
+                        page_list_remove(m_page_free_list[i], p);
+                    }
+                    if (decommit_mem(p, LEAN_PAGE_SIZE)) {
+                        m_released_pages.push_back(std::make_pair(p, s));
+                        s->m_num_released++;
+                        LEAN_RUNTIME_STAT_CODE(g_num_released_pages++);
+                        released = true;
+                    } else {
+                        page_list_insert(m_page_free_list[i], p);
+                    }
+                }
+            }
+            p = n;
+        }
+    }
+    if (!released)
+        return;
+    /* Unmap segments that have been completely released. */
+    segment ** it = &m_curr_segment->m_next;
+    bool freed_segment = false;
+    while (segment * s = *it) {
+        if (s->m_num_released == s->get_num_pages()) {
+            *it = s->m_next;
+            s->m_num_released = 0;
+            m_released_pages.erase(std::remove_if(m_released_pages.begin(), m_released_pages.end(),
+                                                  [&](std::pair<page *, segment *> const & e) { return e.second == s; }),
+                                   m_released_pages.end());
+            free_segment_mem(s, get_segment_mem_size());
+            m_num_segments--;
+            LEAN_RUNTIME_STAT_CODE(g_num_released_segments++);
+            freed_segment = true;
+        } else {
+            it = &s->m_next;
+        }
+    }
+    if (freed_segment)
+        m_released_pages.shrink_to_fit();
+}
+
+void heap::publish_stats() {
+    for (unsigned i = 0; i < LEAN_NUM_SLOTS; i++) {
+        uint64_t num_pages = 0, num_objs = 0, num_free = 0;
+        for (page * lst : {m_curr_page[i], m_page_free_list[i]}) {
+            if (lst == &g_unused_slot_page)
+                continue;
+            for (page * p = lst; p != nullptr; p = p->get_next()) {
+                num_pages++;
+                num_objs += p->m_header.m_max_free;
+                num_free += p->m_header.m_num_free;
+            }
+        }
+        m_slot_stats[i].m_num_pages.store(num_pages, memory_order_relaxed);
+        m_slot_stats[i].m_num_objs.store(num_objs, memory_order_relaxed);
+        m_slot_stats[i].m_num_free.store(num_free, memory_order_relaxed);
+    }
+    m_pub_num_segments.store(m_num_segments, memory_order_relaxed);
+    m_pub_num_released.store(m_released_pages.size(), memory_order_relaxed);
+    m_pub_num_remote_frees.store(m_num_remote_frees, memory_order_relaxed);
+}
+
 static page * alloc_page(heap * h, unsigned obj_size) {
     lean_assert(lean_align(obj_size, LEAN_OBJECT_SIZE_DELTA) == obj_size);
-    segment * s = h->m_curr_segment;
     LEAN_RUNTIME_STAT_CODE(g_num_pages++);
-    page * p    = new (s->m_next_page_mem) page();
-    s->m_next_page_mem += LEAN_PAGE_SIZE;
-    if (s->is_full()) {
-        /* s is full, we need to allocate a new one. */
-        h->alloc_segment();
+    page * p;
+    if (!h->m_released_pages.empty()) {
+        /* Reuse a page returned to the OS. */
+        segment * s = h->m_released_pages.back().second;
+        p = new (h->m_released_pages.back().first) page();
+        h->m_released_pages.pop_back();
+        s->m_num_released--;
+        p->m_header.m_segment = s;
+    } else {
+        segment * s = h->m_curr_segment;
+        p = new (s->m_next_page_mem) page();
+        p->m_header.m_segment = s;
+        s->m_next_page_mem += LEAN_PAGE_SIZE;
+        if (s->is_full()) {
+            /* s is full, we need to allocate a new one. */
+            h->alloc_segment();
+        }
     }
     unsigned slot_idx        = lean_get_slot_idx(obj_size);
     p->m_header.m_heap       = h;
+    if (h->m_curr_page[slot_idx] == &g_unused_slot_page)
+        h->m_curr_page[slot_idx] = nullptr;
     page_list_insert(h->m_curr_page[slot_idx], p);
     p->m_header.m_slot_idx   = slot_idx;
     p->m_header.m_obj_size   = obj_size;
@@ -321,13 +659,145 @@ static page * alloc_page(heap * h, unsigned obj_size) {
     return p;
 }
 
+/* Move (at most) `n` objects from the list `from` to the list `to`, calling `f` on each of them.
+   Return the number of objects moved. */
+template<typename F>
+static unsigned move_objs(void * & from, void * & to, unsigned n, F && f) {
+    if (n == 0 || from == nullptr)
+        return 0;
+    void * first = from;
+    void * last  = from;
+    unsigned i   = 1;
+    f(last);
+    while (i < n && get_next_obj(last) != nullptr) {
+        last = get_next_obj(last);
+        f(last);
+        i++;
+    }
+    from = get_next_obj(last);
+    set_next_obj(last, to);
+    to = first;
+    return i;
+}
+
+/* Refill the medium object cache of `h` for the given size class, and return one object. */
+LEAN_NOINLINE
+static void * alloc_medium_cold(heap * h, unsigned slot_idx) {
+    medium_central & c = g_heap_manager->m_medium;
+    unsigned batch     = get_medium_batch_size(slot_idx);
+    size_t obj_size    = get_medium_obj_size(slot_idx);
+    lock_guard<mutex> lock(c.m_mutex);
+    if (c.m_free[slot_idx] != nullptr) {
+        unsigned n = move_objs(c.m_free[slot_idx], h->m_medium_free[slot_idx], batch,
+                               [&](void * o) { c.get_arena(o).m_live += obj_size; });
+        c.m_num_free[slot_idx]         -= n;
+        h->m_medium_num_free[slot_idx] += n;
+    } else {
+        for (unsigned i = 0; i < batch; i++) {
+            if (c.m_arena_curr + obj_size > c.m_arena_end) {
+                if (i > 0)
+                    break;
+                /* The rest of the current arena is lost, which wastes less than LEAN_MAX_MEDIUM_OBJECT_SIZE bytes. */
+                LEAN_RUNTIME_STAT_CODE(g_num_medium_arenas++);
+                c.m_arena_curr = static_cast<char*>(alloc_segment_mem(g_segment_size));
+                c.m_arena_end  = c.m_arena_curr + g_segment_size;
+                c.m_arenas[c.m_arena_curr] = medium_arena{c.m_arena_end, 0};
+            }
+            c.get_arena(c.m_arena_curr).m_live += obj_size;
+            set_next_obj(c.m_arena_curr, h->m_medium_free[slot_idx]);
+            h->m_medium_free[slot_idx] = c.m_arena_curr;
+            h->m_medium_num_free[slot_idx]++;
+            c.m_arena_curr += obj_size;
+        }
+    }
+    void * r = h->m_medium_free[slot_idx];
+    lean_assert(r);
+    h->m_medium_free[slot_idx] = get_next_obj(r);
+    h->m_medium_num_free[slot_idx]--;
+    return r;
+}
+
+/* Return (some of) the medium objects cached by `h` for the given size class to the central free lists. */
+LEAN_NOINLINE
+static void flush_medium(heap * h, unsigned slot_idx, unsigned n) {
+    medium_central & c = g_heap_manager->m_medium;
+    size_t obj_size    = get_medium_obj_size(slot_idx);
+    lock_guard<mutex> lock(c.m_mutex);
+    unsigned m = move_objs(h->m_medium_free[slot_idx], c.m_free[slot_idx], n,
+                           [&](void * o) { c.get_arena(o).m_live -= obj_size; });
+    h->m_medium_num_free[slot_idx] -= m;
+    c.m_num_free[slot_idx]         += m;
+}
+
+/* Flush all medium objects cached by `h`, which is going to be idle or deleted, and release the
+   arenas all of whose objects are free, except for the one objects are currently carved from. */
+static void flush_all_medium(heap * h) {
+    for (unsigned i = 0; i < LEAN_NUM_MEDIUM_SLOTS; i++)
+        flush_medium(h, i, h->m_medium_num_free[i]);
+    medium_central & c = g_heap_manager->m_medium;
+    lock_guard<mutex> lock(c.m_mutex);
+    auto is_free = [&](medium_arena const & a) { return a.m_live == 0 && a.m_end != c.m_arena_end; };
+    if (std::none_of(c.m_arenas.begin(), c.m_arenas.end(), [&](auto const & a) { return is_free(a.second); }))
+        return;
+    for (unsigned i = 0; i < LEAN_NUM_MEDIUM_SLOTS; i++) {
+        void * prev = nullptr;
+        void * o    = c.m_free[i];
+        while (o != nullptr) {
+            void * next = get_next_obj(o);
+            if (is_free(c.get_arena(o))) {
+                if (prev) set_next_obj(prev, next); else c.m_free[i] = next;
+                c.m_num_free[i]--;
+            } else {
+                prev = o;
+            }
+            o = next;
+        }
+    }
+    for (auto it = c.m_arenas.begin(); it != c.m_arenas.end();) {
+        if (is_free(it->second)) {
+            LEAN_RUNTIME_STAT_CODE(g_num_released_medium_arenas++);
+            free_segment_mem(it->first, g_segment_size);
+            it = c.m_arenas.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
 static void finalize_heap(void * _h) {
     heap * h = static_cast<heap*>(_h);
-    h->export_objs();
     h->import_objs();
+    /* The heap is going to be idle until it is adopted by a new thread. */
+    h->release_free_pages(false);
+    flush_all_medium(h);
+    h->publish_stats();
     g_heap_manager->push_orphan(h);
 }
 
+/* Regions are usually short-lived and only use a few size classes, so their pages are allocated
+   on first use instead of one per size class upfront, which would touch
+   `LEAN_NUM_SLOTS * LEAN_PAGE_SIZE` bytes for every region. */
+static heap * mk_heap(bool region = false) {
+    heap * h = new heap();
+    for (unsigned i = 0; i < LEAN_NUM_SLOTS; i++) {
+        h->m_curr_page[i] = region ? &g_unused_slot_page : nullptr;
+        h->m_page_free_list[i] = nullptr;
+    }
+    for (unsigned i = 0; i < LEAN_NUM_MEDIUM_SLOTS; i++) {
+        h->m_medium_free[i] = nullptr;
+        h->m_medium_num_free[i] = 0;
+    }
+    h->alloc_segment();
+    unsigned obj_size = LEAN_OBJECT_SIZE_DELTA;
+    for (unsigned i = 0; i < LEAN_NUM_SLOTS; i++) {
+        if (h->m_curr_page[i] == nullptr) {
+            alloc_page(h, obj_size);
+        }
+        obj_size += LEAN_OBJECT_SIZE_DELTA;
+    }
+    return h;
+}
+
 LEAN_NOINLINE
 static void init_heap(bool main) {
     lean_assert(g_heap == nullptr);
@@ -335,24 +805,32 @@ static void init_heap(bool main) {
         /* reuse orphan heap */
         g_heap = h;
     } else {
-        g_heap = new heap();
-        g_curr_pages = g_heap->m_curr_page;
-        for (unsigned i = 0; i < LEAN_NUM_SLOTS; i++) {
-            g_heap->m_curr_page[i] = nullptr;
-            g_heap->m_page_free_list[i] = nullptr;
-        }
-        g_heap->alloc_segment();
-        unsigned obj_size = LEAN_OBJECT_SIZE_DELTA;
-        for (unsigned i = 0; i < LEAN_NUM_SLOTS; i++) {
-            if (g_heap->m_curr_page[i] == nullptr) {
-                alloc_page(g_heap, obj_size);
-            }
-            obj_size += LEAN_OBJECT_SIZE_DELTA;
-        }
+        g_heap = mk_heap();
+        g_heap_manager->register_heap(g_heap);
     }
+    g_curr_pages = g_heap->m_curr_page;
     if (!main)
         register_thread_finalizer(finalize_heap, g_heap);
 }
+
+/* Make `h` the heap of the current thread, carrying over the heartbeat counter. */
+static void switch_heap(heap * h) {
+    h->m_heartbeat = g_heap->m_heartbeat;
+    g_heap         = h;
+    g_curr_pages   = h->m_curr_page;
+}
+
+static void delete_region(heap * r) {
+    lean_assert(r->m_is_region);
+    flush_all_medium(r);
+    segment * s = r->m_curr_segment;
+    while (s) {
+        segment * n = s->m_next;
+        free_segment_mem(s, get_segment_mem_size());
+        s = n;
+    }
+    delete r;
+}
 }
 using namespace allocator; // NOLINT
 
@@ -362,6 +840,12 @@ void init_thread_heap() {
 
 LEAN_NOINLINE
 void * lean_alloc_small_cold(unsigned sz, unsigned slot_idx, page * p) {
+    if (g_heap->m_num_recycled >= LEAN_RELEASE_INTERVAL)
+        g_heap->release_free_pages(true);
+    if (++g_heap->m_num_cold_allocs >= LEAN_PUBLISH_STATS_INTERVAL) {
+        g_heap->m_num_cold_allocs = 0;
+        g_heap->publish_stats();
+    }
     if (g_heap->m_page_free_list[slot_idx] == nullptr) {
         g_heap->import_objs();
         lean_assert(g_heap->m_curr_page[slot_idx] == p);
@@ -381,9 +865,36 @@ void * lean_alloc_small_cold(unsigned sz, unsigned slot_idx, page * p) {
     return r;
 }
 
+/* Record an allocation of `sz` bytes for the sampling allocation profiler, and pick the number of
+   bytes until the next sample. Sampling at exponentially distributed distances with mean `period`
+   makes the samples independent of the allocation pattern. */
+LEAN_NOINLINE
+static void sample_alloc(heap * h, size_t sz) {
+    size_t period = get_alloc_sample_period();
+    if (period == 0) {
+        h->m_sample_countdown = LEAN_ALLOC_SAMPLE_RECHECK;
+        return;
+    }
+    /* xorshift64 */
+    uint64_t x = h->m_sample_rng;
+    x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+    h->m_sample_rng = x;
+    double u = (static_cast<double>(x >> 11) + 1.0) / 9007199254740993.0; // in (0, 1)
+    h->m_sample_countdown = static_cast<int64_t>(-std::log(u) * static_cast<double>(period)) + 1;
+    record_alloc_sample(sz);
+}
+
+static inline void count_sampled_bytes(heap * h, size_t sz) {
+    h->m_sample_countdown -= sz;
+    if (LEAN_UNLIKELY(h->m_sample_countdown < 0)) {
+        sample_alloc(h, sz);
+    }
+}
+
 extern "C" LEAN_EXPORT void * lean_alloc_small(unsigned sz, unsigned slot_idx) {
     page * p = g_heap->m_curr_page[slot_idx];
     g_heap->m_heartbeat++;
+    count_sampled_bytes(g_heap, sz);
     void * r = p->m_header.m_free_list;
     if (LEAN_UNLIKELY(r == nullptr)) {
         return lean_alloc_small_cold(sz, slot_idx, p);
@@ -394,10 +905,43 @@ extern "C" LEAN_EXPORT void * lean_alloc_small(unsigned sz, unsigned slot_idx) {
     return r;
 }
 
+static inline void * alloc_medium(size_t sz) {
+    LEAN_RUNTIME_STAT_CODE(g_num_medium_alloc++);
+    unsigned slot_idx = get_medium_slot_idx(sz);
+    void * r = g_heap->m_medium_free[slot_idx];
+    if (LEAN_UNLIKELY(r == nullptr))
+        return alloc_medium_cold(g_heap, slot_idx);
+    g_heap->m_medium_free[slot_idx] = get_next_obj(r);
+    g_heap->m_medium_num_free[slot_idx]--;
+    return r;
+}
+
+static inline void dealloc_medium(void * o, size_t sz) {
+    if (LEAN_UNLIKELY(g_heap == nullptr)) {
+        init_heap(false);
+    }
+    unsigned slot_idx = get_medium_slot_idx(sz);
+    /* Medium objects do not belong to any particular heap, so they are always cached by the
+       current heap. Caches exceeding LEAN_MEDIUM_CACHE_SIZE bytes are flushed to the central
+       free lists. */
+    set_next_obj(o, g_heap->m_medium_free[slot_idx]);
+    g_heap->m_medium_free[slot_idx] = o;
+    g_heap->m_medium_num_free[slot_idx]++;
+    if (LEAN_UNLIKELY(g_heap->m_medium_num_free[slot_idx] * get_medium_obj_size(slot_idx) > LEAN_MEDIUM_CACHE_SIZE)) {
+        flush_medium(g_heap, slot_idx, get_medium_batch_size(slot_idx));
+    }
+}
+
 void * alloc(size_t sz) {
     sz = lean_align(sz, LEAN_OBJECT_SIZE_DELTA);
     LEAN_RUNTIME_STAT_CODE(g_num_alloc++);
     if (LEAN_UNLIKELY(sz > LEAN_MAX_SMALL_OBJECT_SIZE)) {
+        if (sz <= LEAN_MAX_MEDIUM_OBJECT_SIZE) {
+            lean_assert(g_heap);
+            count_sampled_bytes(g_heap, sz);
+            return alloc_medium(sz);
+        }
+        if (g_heap) count_sampled_bytes(g_heap, sz);
         void * r = malloc(sz);
         if (r == nullptr) lean_internal_panic_out_of_memory();
         return r;
@@ -408,17 +952,6 @@ void * alloc(size_t sz) {
     return lean_alloc_small(sz, slot_idx);
 }
 
-LEAN_NOINLINE
-static void dealloc_small_core_cold(void * o) {
-    set_next_obj(o, g_heap->m_to_export_list);
-    g_heap->m_to_export_list = o;
-    g_heap->m_to_export_list_size++;
-    if (g_heap->m_to_export_list_size > LEAN_MAX_TO_EXPORT_OBJS) {
-        LEAN_RUNTIME_STAT_CODE(g_num_exports++);
-        g_heap->export_objs();
-    }
-}
-
 static inline void dealloc_small_core(void * o) {
     LEAN_RUNTIME_STAT_CODE(g_num_small_dealloc++);
     if (LEAN_UNLIKELY(g_heap == nullptr)) {
@@ -429,7 +962,10 @@ static inline void dealloc_small_core(void * o) {
     if (LEAN_LIKELY(p->get_heap() == g_heap)) {
         p->push_free_obj(o);
     } else {
-        dealloc_small_core_cold(o);
+        /* Object of another thread's heap or of a region that is not active, e.g. because it has
+           been suspended. A region imports its remote frees like any other heap, when it runs out
+           of free objects while active again; the rest is released when the region ends. */
+        p->push_remote_free_obj(o);
     }
 }
 
@@ -437,6 +973,8 @@ void dealloc(void * o, size_t sz) {
     LEAN_RUNTIME_STAT_CODE(g_num_dealloc++);
     sz = lean_align(sz, LEAN_OBJECT_SIZE_DELTA);
     if (LEAN_UNLIKELY(sz > LEAN_MAX_SMALL_OBJECT_SIZE)) {
+        if (sz <= LEAN_MAX_MEDIUM_OBJECT_SIZE)
+            return dealloc_medium(o, sz);
         return free_sized(o, sz);
     }
     dealloc_small_core(o);
@@ -446,15 +984,97 @@ extern "C" LEAN_EXPORT void lean_free_small(void * o) {
     dealloc_small_core(o);
 }
 
+LEAN_THREAD_GLOBAL_PTR(void, g_region);
+
+scoped_region::scoped_region() {
+    if (LEAN_UNLIKELY(g_heap == nullptr)) {
+        init_heap(false);
+    }
+    heap * r = mk_heap(/* region */ true);
+    r->m_is_region    = true;
+    r->m_region_outer = g_heap;
+    switch_heap(r);
+    m_region = g_region;
+    g_region = r;
+}
+
+scoped_region::~scoped_region() {
+    heap * r = static_cast<heap*>(g_region);
+    lean_assert(r == g_heap);
+    switch_heap(r->m_region_outer);
+    g_region = m_region;
+    delete_region(r);
+}
+
+scoped_region_suspend::scoped_region_suspend():m_region(g_region) {
+    if (m_region) {
+        switch_heap(static_cast<heap*>(m_region)->m_region_outer);
+        g_region = nullptr;
+    }
+}
+
+scoped_region_suspend::~scoped_region_suspend() {
+    if (m_region) {
+        switch_heap(static_cast<heap*>(m_region));
+        g_region = m_region;
+    }
+}
+
+bool in_region(void * region, void * o) {
+    return get_page_of(o)->get_heap() == region;
+}
+
+bool in_active_region(void * o) {
+    return g_region != nullptr && in_region(g_region, o);
+}
+
 extern "C" LEAN_EXPORT unsigned lean_small_mem_size(void * o) {
     page * p = get_page_of(o);
     return p->m_header.m_obj_size;
 }
 
+void get_alloc_info(alloc_info & r) {
+    r = alloc_info();
+    r.m_slots.resize(LEAN_NUM_SLOTS);
+    for (unsigned i = 0; i < LEAN_NUM_SLOTS; i++)
+        r.m_slots[i].m_obj_size = (i + 1) * LEAN_OBJECT_SIZE_DELTA;
+    /* The statistics of the current heap are always up to date. */
+    if (g_heap)
+        g_heap->publish_stats();
+    for (heap * h = g_heap_manager->m_heaps.load(); h != nullptr; h = h->m_next_heap) {
+        r.m_num_heaps++;
+        r.m_num_segments     += h->m_pub_num_segments.load(memory_order_relaxed);
+        r.m_num_released     += h->m_pub_num_released.load(memory_order_relaxed);
+        r.m_num_remote_frees += h->m_pub_num_remote_frees.load(memory_order_relaxed);
+        for (unsigned i = 0; i < LEAN_NUM_SLOTS; i++) {
+            alloc_slot_info & s = r.m_slots[i];
+            s.m_num_pages += h->m_slot_stats[i].m_num_pages.load(memory_order_relaxed);
+            s.m_num_objs  += h->m_slot_stats[i].m_num_objs.load(memory_order_relaxed);
+            s.m_num_free  += h->m_slot_stats[i].m_num_free.load(memory_order_relaxed);
+        }
+    }
+}
+
+#endif
+
+#ifndef LEAN_SMALL_ALLOCATOR
+void get_alloc_info(alloc_info & r) {
+    r = alloc_info();
+}
+
+/* Regions are not supported without the small object allocator, so they never contain any object. */
+LEAN_THREAD_GLOBAL_PTR(void, g_region);
+scoped_region::scoped_region():m_region(nullptr) {}
+scoped_region::~scoped_region() {}
+scoped_region_suspend::scoped_region_suspend():m_region(nullptr) {}
+scoped_region_suspend::~scoped_region_suspend() {}
+bool in_region(void *, void *) { return false; }
+bool in_active_region(void *) { return false; }
 #endif
 
 void initialize_alloc() {
 #ifdef LEAN_SMALL_ALLOCATOR
+    initialize_segment_config();
     g_heap_manager = new heap_manager();
     init_heap(true);
 #endif
@@ -490,6 +1110,14 @@ extern "C" LEAN_EXPORT void lean_inc_heartbeat() {
     add_heartbeats(1);
 }
 
+size_t get_allocator_memory() {
+#ifdef LEAN_SMALL_ALLOCATOR
+    return g_allocator_memory;
+#else
+    return 0;
+#endif
+}
+
 uint64_t get_num_heartbeats() {
 #ifdef LEAN_SMALL_ALLOCATOR
     if (g_heap)
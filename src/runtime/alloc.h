@@ -7,15 +7,71 @@ Author: Leonardo de Moura
 #pragma once
 #include <stddef.h>
 #include <stdint.h>
+#include <vector>
 #include <lean/lean.h>
+#include "runtime/thread.h"
 
 namespace lean {
+/* Statistics about one size class of the small object allocator. */
+struct alloc_slot_info {
+    size_t   m_obj_size{0};
+    uint64_t m_num_pages{0};
+    uint64_t m_num_objs{0}; // number of objects fitting in `m_num_pages`
+    uint64_t m_num_free{0};
+};
+
+/* Statistics about the small object allocator, aggregated over all thread heaps.
+   The statistics of heaps owned by other threads are snapshots that are republished
+   periodically, so they may be slightly out of date. */
+struct alloc_info {
+    uint64_t m_num_heaps{0};
+    uint64_t m_num_segments{0};
+    uint64_t m_num_released{0}; // number of pages returned to the OS
+    uint64_t m_num_remote_frees{0}; // number of objects freed by a thread other than their owner
+    std::vector<alloc_slot_info> m_slots;
+};
+LEAN_EXPORT void get_alloc_info(alloc_info & r);
+
+/* The region of the current thread, if any. See `scoped_region`. */
+LEAN_THREAD_EXTERN_PTR(void, g_region);
+
+/** \brief While this object is alive, small objects allocated by the current thread are placed in
+    a fresh region whose memory is released in bulk by the destructor.
+
+    Region objects whose reference counter drops to zero are not freed, and do not decrement the
+    counters of the objects they reference, see `lean_dec_ref_cold`. Thus, references from region
+    garbage to objects outside the region are never released.
+
+    The caller must ensure that no object of the region is referenced after the region ends. In
+    particular, results must be copied out of the region using `region_copy_out` before. */
+class LEAN_EXPORT scoped_region {
+    void * m_region;
+public:
+    scoped_region();
+    ~scoped_region();
+};
+
+/** \brief Temporarily allocate objects outside of the current region, if any. */
+class LEAN_EXPORT scoped_region_suspend {
+    void * m_region;
+public:
+    scoped_region_suspend();
+    ~scoped_region_suspend();
+};
+
+/* Return true if the small object `o` was allocated in `region`. */
+LEAN_EXPORT bool in_region(void * region, void * o);
+/* Return true if the small object `o` was allocated in the region of the current thread. */
+LEAN_EXPORT bool in_active_region(void * o);
+
 void init_thread_heap();
 LEAN_EXPORT void * alloc(size_t sz);
 LEAN_EXPORT void dealloc(void * o, size_t sz);
 LEAN_EXPORT void set_heartbeats(uint64_t count);
 LEAN_EXPORT void add_heartbeats(uint64_t count);
 LEAN_EXPORT uint64_t get_num_heartbeats();
+/* Return the number of bytes the small object allocator obtained from the OS, or 0 if it is disabled. */
+LEAN_EXPORT size_t get_allocator_memory();
 void initialize_alloc();
 void finalize_alloc();
 }
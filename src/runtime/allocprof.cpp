@@ -4,7 +4,29 @@ Released under Apache 2.0 license as described in the file LICENSE.
 
 Author: Leonardo de Moura
 */
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <vector>
 #include "runtime/allocprof.h"
+#include "runtime/thread.h"
+#include "runtime/flet.h"
+
+#if defined(__GLIBC__) || defined(__APPLE__)
+#define LEAN_ALLOC_SAMPLE_BACKTRACE 1
+#include <execinfo.h>
+#include <dlfcn.h>
+#else
+#define LEAN_ALLOC_SAMPLE_BACKTRACE 0
+#endif
+
+#define LEAN_DEFAULT_ALLOC_SAMPLE_PERIOD (512*1024)
+#define LEAN_MAX_ALLOC_SAMPLE_FRAMES     64
+/* Number of innermost frames belonging to the allocator and the profiler itself. */
+#define LEAN_ALLOC_SAMPLE_SKIP_FRAMES    3
+
 namespace lean {
 allocprof::allocprof(std::ostream & out, char const * msg):
     m_out(out), m_msg(msg) {
@@ -44,4 +66,238 @@ allocprof::~allocprof() {
     m_out << "Allocation profiling data is not available, compile lean using `-D RUNTIME_STATS=ON`\n";
 #endif
 }
+
+struct alloc_sample_key {
+    std::vector<void *> m_frames;
+    std::string         m_decl;
+    bool operator<(alloc_sample_key const & k) const {
+        return m_frames < k.m_frames || (m_frames == k.m_frames && m_decl < k.m_decl);
+    }
+};
+
+struct alloc_sample_value {
+    /* Estimated number of objects and bytes allocated at this stack, see `record_alloc_sample`. */
+    double m_num_objs{0};
+    double m_num_bytes{0};
+};
+
+static atomic<size_t> g_alloc_sample_period(0);
+static mutex * g_alloc_samples_mutex = nullptr;
+static std::map<alloc_sample_key, alloc_sample_value> * g_alloc_samples = nullptr;
+static std::string (*g_alloc_sample_decl_fn)() = nullptr;
+static char const * g_alloc_profile_fname = nullptr;
+/* Avoid recording allocations performed while recording a sample. */
+LEAN_THREAD_VALUE(bool, g_recording_alloc_sample, false);
+
+void start_alloc_sampling(size_t period) {
+    {
+        lock_guard<mutex> lock(*g_alloc_samples_mutex);
+        g_alloc_samples->clear();
+    }
+    g_alloc_sample_period = period;
+}
+
+void stop_alloc_sampling() {
+    g_alloc_sample_period = 0;
+}
+
+void set_alloc_sample_decl_fn(std::string (*fn)()) {
+    g_alloc_sample_decl_fn = fn;
+}
+
+size_t get_alloc_sample_period() {
+    return g_alloc_sample_period;
+}
+
+void record_alloc_sample(size_t sz) {
+    size_t period = g_alloc_sample_period;
+    if (period == 0 || g_recording_alloc_sample)
+        return;
+    g_recording_alloc_sample = true;
+    alloc_sample_key k;
+#if LEAN_ALLOC_SAMPLE_BACKTRACE
+    void * frames[LEAN_MAX_ALLOC_SAMPLE_FRAMES];
+    int n = backtrace(frames, LEAN_MAX_ALLOC_SAMPLE_FRAMES);
+    if (n > LEAN_ALLOC_SAMPLE_SKIP_FRAMES)
+        k.m_frames.assign(frames + LEAN_ALLOC_SAMPLE_SKIP_FRAMES, frames + n);
+#endif
+    if (g_alloc_sample_decl_fn)
+        k.m_decl = g_alloc_sample_decl_fn();
+    /* The distance between two samples is exponentially distributed, so an object of size `sz`
+       is sampled with probability `1 - exp(-sz/period)`. Each sample stands for the inverse of
+       this probability objects. */
+    double num_objs = 1.0 / (1.0 - std::exp(-static_cast<double>(sz) / static_cast<double>(period)));
+    {
+        lock_guard<mutex> lock(*g_alloc_samples_mutex);
+        alloc_sample_value & v = (*g_alloc_samples)[k];
+        v.m_num_objs  += num_objs;
+        v.m_num_bytes += num_objs * sz;
+    }
+    g_recording_alloc_sample = false;
+}
+
+/* Minimal protocol buffer encoder for the pprof `Profile` message, see
+   https://github.com/google/pprof/blob/main/proto/profile.proto */
+class pb_writer {
+    std::string m_buf;
+    void add_varint(uint64 v) {
+        while (v >= 0x80) {
+            m_buf.push_back(static_cast<char>((v & 0x7f) | 0x80));
+            v >>= 7;
+        }
+        m_buf.push_back(static_cast<char>(v));
+    }
+public:
+    void add_uint(unsigned field, uint64 v) {
+        add_varint(field << 3);
+        add_varint(v);
+    }
+    void add_bytes(unsigned field, std::string const & s) {
+        add_varint((field << 3) | 2);
+        add_varint(s.size());
+        m_buf += s;
+    }
+    void add_msg(unsigned field, pb_writer const & m) { add_bytes(field, m.m_buf); }
+    void add_packed(unsigned field, std::vector<uint64> const & vs) {
+        pb_writer w;
+        for (uint64 v : vs) w.add_varint(v);
+        add_bytes(field, w.m_buf);
+    }
+    std::string const & str() const { return m_buf; }
+};
+
+class alloc_profile_writer {
+    pb_writer                        m_profile;
+    std::vector<std::string>         m_strings;
+    std::map<std::string, uint64>    m_string_ids;
+    std::map<std::string, uint64>    m_function_ids;
+    std::map<void *, uint64>         m_location_ids;
+
+    uint64 mk_string(std::string const & s) {
+        auto it = m_string_ids.find(s);
+        if (it != m_string_ids.end())
+            return it->second;
+        uint64 id = m_strings.size();
+        m_strings.push_back(s);
+        m_string_ids.insert(std::make_pair(s, id));
+        return id;
+    }
+
+    pb_writer mk_value_type(char const * type, char const * unit) {
+        pb_writer w;
+        w.add_uint(1, mk_string(type));
+        w.add_uint(2, mk_string(unit));
+        return w;
+    }
+
+    uint64 mk_function(std::string const & name, std::string const & fname) {
+        auto it = m_function_ids.find(name);
+        if (it != m_function_ids.end())
+            return it->second;
+        uint64 id = m_function_ids.size() + 1;
+        m_function_ids.insert(std::make_pair(name, id));
+        pb_writer f;
+        f.add_uint(1, id);
+        f.add_uint(2, mk_string(name));
+        f.add_uint(3, mk_string(name));
+        f.add_uint(4, mk_string(fname));
+        m_profile.add_msg(5, f);
+        return id;
+    }
+
+    uint64 mk_location(void * addr) {
+        auto it = m_location_ids.find(addr);
+        if (it != m_location_ids.end())
+            return it->second;
+        uint64 id = m_location_ids.size() + 1;
+        m_location_ids.insert(std::make_pair(addr, id));
+        std::string name, fname;
+#if LEAN_ALLOC_SAMPLE_BACKTRACE
+        Dl_info info;
+        if (dladdr(addr, &info)) {
+            if (info.dli_sname) name = info.dli_sname;
+            if (info.dli_fname) fname = info.dli_fname;
+        }
+#endif
+        if (name.empty()) {
+            std::ostringstream out;
+            out << addr;
+            name = out.str();
+        }
+        pb_writer line;
+        line.add_uint(1, mk_function(name, fname));
+        pb_writer loc;
+        loc.add_uint(1, id);
+        loc.add_uint(3, reinterpret_cast<uintptr_t>(addr));
+        loc.add_msg(4, line);
+        m_profile.add_msg(4, loc);
+        return id;
+    }
+
+public:
+    alloc_profile_writer() {
+        mk_string("");
+    }
+
+    void write(std::ostream & out, std::map<alloc_sample_key, alloc_sample_value> const & samples, size_t period) {
+        m_profile.add_msg(1, mk_value_type("alloc_objects", "count"));
+        m_profile.add_msg(1, mk_value_type("alloc_space", "bytes"));
+        for (auto const & p : samples) {
+            pb_writer s;
+            std::vector<uint64> locs;
+            for (void * addr : p.first.m_frames)
+                locs.push_back(mk_location(addr));
+            s.add_packed(1, locs);
+            s.add_packed(2, {static_cast<uint64>(std::llround(p.second.m_num_objs)),
+                             static_cast<uint64>(std::llround(p.second.m_num_bytes))});
+            if (!p.first.m_decl.empty()) {
+                pb_writer l;
+                l.add_uint(1, mk_string("lean_decl"));
+                l.add_uint(2, mk_string(p.first.m_decl));
+                s.add_msg(3, l);
+            }
+            m_profile.add_msg(2, s);
+        }
+        m_profile.add_msg(11, mk_value_type("space", "bytes"));
+        m_profile.add_uint(12, period);
+        for (std::string const & str : m_strings)
+            m_profile.add_bytes(6, str);
+        out << m_profile.str();
+    }
+};
+
+void write_alloc_profile(std::ostream & out) {
+    std::map<alloc_sample_key, alloc_sample_value> samples;
+    {
+        lock_guard<mutex> lock(*g_alloc_samples_mutex);
+        samples = *g_alloc_samples;
+    }
+    flet<bool> no_sampling(g_recording_alloc_sample, true);
+    alloc_profile_writer().write(out, samples, g_alloc_sample_period);
+}
+
+static void write_alloc_profile_at_exit() {
+    std::ofstream out(g_alloc_profile_fname, std::ios::binary);
+    write_alloc_profile(out);
+}
+
+void initialize_allocprof() {
+    g_alloc_samples_mutex = new mutex();
+    g_alloc_samples       = new std::map<alloc_sample_key, alloc_sample_value>();
+    /* `LEAN_ALLOC_PROFILE=<file>` samples allocations of the whole process and writes the profile
+       to `<file>` on exit. */
+    if (char const * fname = std::getenv("LEAN_ALLOC_PROFILE")) {
+        size_t period = LEAN_DEFAULT_ALLOC_SAMPLE_PERIOD;
+        if (char const * p = std::getenv("LEAN_ALLOC_SAMPLE_PERIOD"))
+            period = std::strtoull(p, nullptr, 10);
+        g_alloc_profile_fname = fname;
+        std::atexit(write_alloc_profile_at_exit);
+        start_alloc_sampling(period);
+    }
+}
+
+void finalize_allocprof() {
+    stop_alloc_sampling();
+    /* `g_alloc_samples` is not deleted because the profile may still be written at exit. */
+}
 }
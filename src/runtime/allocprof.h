@@ -26,4 +26,22 @@ public:
     allocprof(std::ostream & out, char const * msg);
     ~allocprof();
 };
+
+/* Sampling allocation profiler.
+   When enabled, the small object allocator records the native backtrace of an allocation
+   on average once every `period` allocated bytes. The accumulated samples can be written
+   in the pprof profile format and inspected using `pprof -top <file>`. */
+LEAN_EXPORT void start_alloc_sampling(size_t period);
+LEAN_EXPORT void stop_alloc_sampling();
+/* Write the samples collected since the last call to `start_alloc_sampling` to `out`. */
+LEAN_EXPORT void write_alloc_profile(std::ostream & out);
+/* Register a function returning the name of the Lean declaration currently being executed
+   by the interpreter, if any. It is recorded as the `lean_decl` label of each sample. */
+LEAN_EXPORT void set_alloc_sample_decl_fn(std::string (*fn)());
+/* Mean number of bytes between two samples, or 0 if sampling is disabled. */
+size_t get_alloc_sample_period();
+/* Record a sampled allocation of `sz` bytes. Invoked by the allocator. */
+void record_alloc_sample(size_t sz);
+void initialize_allocprof();
+void finalize_allocprof();
 }
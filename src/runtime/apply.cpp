@@ -6,17 +6,36 @@ Author: Leonardo de Moura
 */
 // DO NOT EDIT, this is an automatically generated file
 // Generated using script: ../../gen/apply.lean
+#include <algorithm>
 #include "runtime/apply.h"
 namespace lean {
 #define obj lean_object
 #define fx(i) lean_closure_arg_cptr(f)[i]
 
+/* Number of additional arguments that fit into the closures allocated by `fix_args`, so that
+   applying an exclusive partial application to further arguments can reuse its memory. */
+#define LEAN_CLOSURE_SLACK 2
+
 static obj* fix_args(obj* f, unsigned n, obj*const* as) {
     unsigned arity = lean_closure_arity(f);
     unsigned fixed = lean_closure_num_fixed(f);
     unsigned new_fixed = fixed + n;
     lean_assert(new_fixed < arity);
-    obj * r = lean_alloc_closure(lean_closure_fun(f), arity, new_fixed);
+    if (lean_is_exclusive(f) &&
+        lean_small_object_size(f) >= sizeof(lean_closure_object) + sizeof(void*)*new_fixed) {
+        obj ** target = lean_closure_arg_cptr(f) + fixed;
+        for (unsigned i = 0; i < n; i++, as++, target++) {
+            *target = *as;
+        }
+        lean_to_closure(f)->m_num_fixed = new_fixed;
+        return f;
+    }
+    unsigned capacity = std::min(arity - 1, new_fixed + LEAN_CLOSURE_SLACK);
+    obj * r = lean_alloc_small_object(sizeof(lean_closure_object) + sizeof(void*)*capacity);
+    lean_set_st_header(r, LeanClosure, 0);
+    lean_to_closure(r)->m_fun = lean_closure_fun(f);
+    lean_to_closure(r)->m_arity = arity;
+    lean_to_closure(r)->m_num_fixed = new_fixed;
     obj ** source = lean_closure_arg_cptr(f);
     obj ** target = lean_closure_arg_cptr(r);
     if (!lean_is_exclusive(f)) {
@@ -97,6 +116,9 @@ default: return reinterpret_cast<fnn>(f)(as);
 }
 }
 static obj* curry(obj* f, unsigned n, obj** as) { return curry(lean_closure_fun(f), n, as); }
+/* Over-application of closures with small arity and at most one fixed argument, as is common for
+   combinators, calls the function directly and applies the result to the remaining arguments
+   instead of going through `curry` and an argument array. */
 extern "C" obj* lean_apply_n(obj*, unsigned, obj**);
 extern "C" LEAN_EXPORT obj* lean_apply_1(obj* f, obj* a1) {
 if (lean_is_scalar(f)) { lean_dec(a1); return f; } // f is an erased proof
@@ -208,6 +230,15 @@ if (arity == fixed + 2) {
     return r;
   }
 } else if (arity < fixed + 2) {
+  if (fixed == 0) {
+    switch (arity) {
+    case 1: { obj* r = FN1(f)(a1); lean_dec_ref(f); return lean_apply_1(r, a2); }
+    }
+  } else if (fixed == 1) {
+    switch (arity) {
+    case 2: { obj* r; if (lean_is_exclusive(f)) { r = FN2(f)(fx(0), a1); lean_free_small_object(f); } else { lean_inc(fx(0)); r = FN2(f)(fx(0), a1); lean_dec_ref(f); } return lean_apply_1(r, a2); }
+    }
+  }
   obj * as[2] = { a1, a2 };
   obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
   for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
@@ -268,6 +299,17 @@ if (arity == fixed + 3) {
     return r;
   }
 } else if (arity < fixed + 3) {
+  if (fixed == 0) {
+    switch (arity) {
+    case 1: { obj* r = FN1(f)(a1); lean_dec_ref(f); return lean_apply_2(r, a2, a3); }
+    case 2: { obj* r = FN2(f)(a1, a2); lean_dec_ref(f); return lean_apply_1(r, a3); }
+    }
+  } else if (fixed == 1) {
+    switch (arity) {
+    case 2: { obj* r; if (lean_is_exclusive(f)) { r = FN2(f)(fx(0), a1); lean_free_small_object(f); } else { lean_inc(fx(0)); r = FN2(f)(fx(0), a1); lean_dec_ref(f); } return lean_apply_2(r, a2, a3); }
+    case 3: { obj* r; if (lean_is_exclusive(f)) { r = FN3(f)(fx(0), a1, a2); lean_free_small_object(f); } else { lean_inc(fx(0)); r = FN3(f)(fx(0), a1, a2); lean_dec_ref(f); } return lean_apply_1(r, a3); }
+    }
+  }
   obj * as[3] = { a1, a2, a3 };
   obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
   for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
@@ -326,6 +368,19 @@ if (arity == fixed + 4) {
     return r;
   }
 } else if (arity < fixed + 4) {
+  if (fixed == 0) {
+    switch (arity) {
+    case 1: { obj* r = FN1(f)(a1); lean_dec_ref(f); return lean_apply_3(r, a2, a3, a4); }
+    case 2: { obj* r = FN2(f)(a1, a2); lean_dec_ref(f); return lean_apply_2(r, a3, a4); }
+    case 3: { obj* r = FN3(f)(a1, a2, a3); lean_dec_ref(f); return lean_apply_1(r, a4); }
+    }
+  } else if (fixed == 1) {
+    switch (arity) {
+    case 2: { obj* r; if (lean_is_exclusive(f)) { r = FN2(f)(fx(0), a1); lean_free_small_object(f); } else { lean_inc(fx(0)); r = FN2(f)(fx(0), a1); lean_dec_ref(f); } return lean_apply_3(r, a2, a3, a4); }
+    case 3: { obj* r; if (lean_is_exclusive(f)) { r = FN3(f)(fx(0), a1, a2); lean_free_small_object(f); } else { lean_inc(fx(0)); r = FN3(f)(fx(0), a1, a2); lean_dec_ref(f); } return lean_apply_2(r, a3, a4); }
+    case 4: { obj* r; if (lean_is_exclusive(f)) { r = FN4(f)(fx(0), a1, a2, a3); lean_free_small_object(f); } else { lean_inc(fx(0)); r = FN4(f)(fx(0), a1, a2, a3); lean_dec_ref(f); } return lean_apply_1(r, a4); }
+    }
+  }
   obj * as[4] = { a1, a2, a3, a4 };
   obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
   for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
@@ -382,6 +437,20 @@ if (arity == fixed + 5) {
     return r;
   }
 } else if (arity < fixed + 5) {
+  if (fixed == 0) {
+    switch (arity) {
+    case 1: { obj* r = FN1(f)(a1); lean_dec_ref(f); return lean_apply_4(r, a2, a3, a4, a5); }
+    case 2: { obj* r = FN2(f)(a1, a2); lean_dec_ref(f); return lean_apply_3(r, a3, a4, a5); }
+    case 3: { obj* r = FN3(f)(a1, a2, a3); lean_dec_ref(f); return lean_apply_2(r, a4, a5); }
+    case 4: { obj* r = FN4(f)(a1, a2, a3, a4); lean_dec_ref(f); return lean_apply_1(r, a5); }
+    }
+  } else if (fixed == 1) {
+    switch (arity) {
+    case 2: { obj* r; if (lean_is_exclusive(f)) { r = FN2(f)(fx(0), a1); lean_free_small_object(f); } else { lean_inc(fx(0)); r = FN2(f)(fx(0), a1); lean_dec_ref(f); } return lean_apply_4(r, a2, a3, a4, a5); }
+    case 3: { obj* r; if (lean_is_exclusive(f)) { r = FN3(f)(fx(0), a1, a2); lean_free_small_object(f); } else { lean_inc(fx(0)); r = FN3(f)(fx(0), a1, a2); lean_dec_ref(f); } return lean_apply_3(r, a3, a4, a5); }
+    case 4: { obj* r; if (lean_is_exclusive(f)) { r = FN4(f)(fx(0), a1, a2, a3); lean_free_small_object(f); } else { lean_inc(fx(0)); r = FN4(f)(fx(0), a1, a2, a3); lean_dec_ref(f); } return lean_apply_2(r, a4, a5); }
+    }
+  }
   obj * as[5] = { a1, a2, a3, a4, a5 };
   obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
   for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
@@ -436,6 +505,20 @@ if (arity == fixed + 6) {
     return r;
   }
 } else if (arity < fixed + 6) {
+  if (fixed == 0) {
+    switch (arity) {
+    case 1: { obj* r = FN1(f)(a1); lean_dec_ref(f); return lean_apply_5(r, a2, a3, a4, a5, a6); }
+    case 2: { obj* r = FN2(f)(a1, a2); lean_dec_ref(f); return lean_apply_4(r, a3, a4, a5, a6); }
+    case 3: { obj* r = FN3(f)(a1, a2, a3); lean_dec_ref(f); return lean_apply_3(r, a4, a5, a6); }
+    case 4: { obj* r = FN4(f)(a1, a2, a3, a4); lean_dec_ref(f); return lean_apply_2(r, a5, a6); }
+    }
+  } else if (fixed == 1) {
+    switch (arity) {
+    case 2: { obj* r; if (lean_is_exclusive(f)) { r = FN2(f)(fx(0), a1); lean_free_small_object(f); } else { lean_inc(fx(0)); r = FN2(f)(fx(0), a1); lean_dec_ref(f); } return lean_apply_5(r, a2, a3, a4, a5, a6); }
+    case 3: { obj* r; if (lean_is_exclusive(f)) { r = FN3(f)(fx(0), a1, a2); lean_free_small_object(f); } else { lean_inc(fx(0)); r = FN3(f)(fx(0), a1, a2); lean_dec_ref(f); } return lean_apply_4(r, a3, a4, a5, a6); }
+    case 4: { obj* r; if (lean_is_exclusive(f)) { r = FN4(f)(fx(0), a1, a2, a3); lean_free_small_object(f); } else { lean_inc(fx(0)); r = FN4(f)(fx(0), a1, a2, a3); lean_dec_ref(f); } return lean_apply_3(r, a4, a5, a6); }
+    }
+  }
   obj * as[6] = { a1, a2, a3, a4, a5, a6 };
   obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
   for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
@@ -488,6 +571,20 @@ if (arity == fixed + 7) {
     return r;
   }
 } else if (arity < fixed + 7) {
+  if (fixed == 0) {
+    switch (arity) {
+    case 1: { obj* r = FN1(f)(a1); lean_dec_ref(f); return lean_apply_6(r, a2, a3, a4, a5, a6, a7); }
+    case 2: { obj* r = FN2(f)(a1, a2); lean_dec_ref(f); return lean_apply_5(r, a3, a4, a5, a6, a7); }
+    case 3: { obj* r = FN3(f)(a1, a2, a3); lean_dec_ref(f); return lean_apply_4(r, a4, a5, a6, a7); }
+    case 4: { obj* r = FN4(f)(a1, a2, a3, a4); lean_dec_ref(f); return lean_apply_3(r, a5, a6, a7); }
+    }
+  } else if (fixed == 1) {
+    switch (arity) {
+    case 2: { obj* r; if (lean_is_exclusive(f)) { r = FN2(f)(fx(0), a1); lean_free_small_object(f); } else { lean_inc(fx(0)); r = FN2(f)(fx(0), a1); lean_dec_ref(f); } return lean_apply_6(r, a2, a3, a4, a5, a6, a7); }
+    case 3: { obj* r; if (lean_is_exclusive(f)) { r = FN3(f)(fx(0), a1, a2); lean_free_small_object(f); } else { lean_inc(fx(0)); r = FN3(f)(fx(0), a1, a2); lean_dec_ref(f); } return lean_apply_5(r, a3, a4, a5, a6, a7); }
+    case 4: { obj* r; if (lean_is_exclusive(f)) { r = FN4(f)(fx(0), a1, a2, a3); lean_free_small_object(f); } else { lean_inc(fx(0)); r = FN4(f)(fx(0), a1, a2, a3); lean_dec_ref(f); } return lean_apply_4(r, a4, a5, a6, a7); }
+    }
+  }
   obj * as[7] = { a1, a2, a3, a4, a5, a6, a7 };
   obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
   for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
@@ -538,6 +635,20 @@ if (arity == fixed + 8) {
     return r;
   }
 } else if (arity < fixed + 8) {
+  if (fixed == 0) {
+    switch (arity) {
+    case 1: { obj* r = FN1(f)(a1); lean_dec_ref(f); return lean_apply_7(r, a2, a3, a4, a5, a6, a7, a8); }
+    case 2: { obj* r = FN2(f)(a1, a2); lean_dec_ref(f); return lean_apply_6(r, a3, a4, a5, a6, a7, a8); }
+    case 3: { obj* r = FN3(f)(a1, a2, a3); lean_dec_ref(f); return lean_apply_5(r, a4, a5, a6, a7, a8); }
+    case 4: { obj* r = FN4(f)(a1, a2, a3, a4); lean_dec_ref(f); return lean_apply_4(r, a5, a6, a7, a8); }
+    }
+  } else if (fixed == 1) {
+    switch (arity) {
+    case 2: { obj* r; if (lean_is_exclusive(f)) { r = FN2(f)(fx(0), a1); lean_free_small_object(f); } else { lean_inc(fx(0)); r = FN2(f)(fx(0), a1); lean_dec_ref(f); } return lean_apply_7(r, a2, a3, a4, a5, a6, a7, a8); }
+    case 3: { obj* r; if (lean_is_exclusive(f)) { r = FN3(f)(fx(0), a1, a2); lean_free_small_object(f); } else { lean_inc(fx(0)); r = FN3(f)(fx(0), a1, a2); lean_dec_ref(f); } return lean_apply_6(r, a3, a4, a5, a6, a7, a8); }
+    case 4: { obj* r; if (lean_is_exclusive(f)) { r = FN4(f)(fx(0), a1, a2, a3); lean_free_small_object(f); } else { lean_inc(fx(0)); r = FN4(f)(fx(0), a1, a2, a3); lean_dec_ref(f); } return lean_apply_5(r, a4, a5, a6, a7, a8); }
+    }
+  }
   obj * as[8] = { a1, a2, a3, a4, a5, a6, a7, a8 };
   obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
   for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
@@ -586,6 +697,20 @@ if (arity == fixed + 9) {
     return r;
   }
 } else if (arity < fixed + 9) {
+  if (fixed == 0) {
+    switch (arity) {
+    case 1: { obj* r = FN1(f)(a1); lean_dec_ref(f); return lean_apply_8(r, a2, a3, a4, a5, a6, a7, a8, a9); }
+    case 2: { obj* r = FN2(f)(a1, a2); lean_dec_ref(f); return lean_apply_7(r, a3, a4, a5, a6, a7, a8, a9); }
+    case 3: { obj* r = FN3(f)(a1, a2, a3); lean_dec_ref(f); return lean_apply_6(r, a4, a5, a6, a7, a8, a9); }
+    case 4: { obj* r = FN4(f)(a1, a2, a3, a4); lean_dec_ref(f); return lean_apply_5(r, a5, a6, a7, a8, a9); }
+    }
+  } else if (fixed == 1) {
+    switch (arity) {
+    case 2: { obj* r; if (lean_is_exclusive(f)) { r = FN2(f)(fx(0), a1); lean_free_small_object(f); } else { lean_inc(fx(0)); r = FN2(f)(fx(0), a1); lean_dec_ref(f); } return lean_apply_8(r, a2, a3, a4, a5, a6, a7, a8, a9); }
+    case 3: { obj* r; if (lean_is_exclusive(f)) { r = FN3(f)(fx(0), a1, a2); lean_free_small_object(f); } else { lean_inc(fx(0)); r = FN3(f)(fx(0), a1, a2); lean_dec_ref(f); } return lean_apply_7(r, a3, a4, a5, a6, a7, a8, a9); }
+    case 4: { obj* r; if (lean_is_exclusive(f)) { r = FN4(f)(fx(0), a1, a2, a3); lean_free_small_object(f); } else { lean_inc(fx(0)); r = FN4(f)(fx(0), a1, a2, a3); lean_dec_ref(f); } return lean_apply_6(r, a4, a5, a6, a7, a8, a9); }
+    }
+  }
   obj * as[9] = { a1, a2, a3, a4, a5, a6, a7, a8, a9 };
   obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
   for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
@@ -632,6 +757,20 @@ if (arity == fixed + 10) {
     return r;
   }
 } else if (arity < fixed + 10) {
+  if (fixed == 0) {
+    switch (arity) {
+    case 1: { obj* r = FN1(f)(a1); lean_dec_ref(f); return lean_apply_9(r, a2, a3, a4, a5, a6, a7, a8, a9, a10); }
+    case 2: { obj* r = FN2(f)(a1, a2); lean_dec_ref(f); return lean_apply_8(r, a3, a4, a5, a6, a7, a8, a9, a10); }
+    case 3: { obj* r = FN3(f)(a1, a2, a3); lean_dec_ref(f); return lean_apply_7(r, a4, a5, a6, a7, a8, a9, a10); }
+    case 4: { obj* r = FN4(f)(a1, a2, a3, a4); lean_dec_ref(f); return lean_apply_6(r, a5, a6, a7, a8, a9, a10); }
+    }
+  } else if (fixed == 1) {
+    switch (arity) {
+    case 2: { obj* r; if (lean_is_exclusive(f)) { r = FN2(f)(fx(0), a1); lean_free_small_object(f); } else { lean_inc(fx(0)); r = FN2(f)(fx(0), a1); lean_dec_ref(f); } return lean_apply_9(r, a2, a3, a4, a5, a6, a7, a8, a9, a10); }
+    case 3: { obj* r; if (lean_is_exclusive(f)) { r = FN3(f)(fx(0), a1, a2); lean_free_small_object(f); } else { lean_inc(fx(0)); r = FN3(f)(fx(0), a1, a2); lean_dec_ref(f); } return lean_apply_8(r, a3, a4, a5, a6, a7, a8, a9, a10); }
+    case 4: { obj* r; if (lean_is_exclusive(f)) { r = FN4(f)(fx(0), a1, a2, a3); lean_free_small_object(f); } else { lean_inc(fx(0)); r = FN4(f)(fx(0), a1, a2, a3); lean_dec_ref(f); } return lean_apply_7(r, a4, a5, a6, a7, a8, a9, a10); }
+    }
+  }
   obj * as[10] = { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10 };
   obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
   for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
@@ -676,6 +815,20 @@ if (arity == fixed + 11) {
     return r;
   }
 } else if (arity < fixed + 11) {
+  if (fixed == 0) {
+    switch (arity) {
+    case 1: { obj* r = FN1(f)(a1); lean_dec_ref(f); return lean_apply_10(r, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11); }
+    case 2: { obj* r = FN2(f)(a1, a2); lean_dec_ref(f); return lean_apply_9(r, a3, a4, a5, a6, a7, a8, a9, a10, a11); }
+    case 3: { obj* r = FN3(f)(a1, a2, a3); lean_dec_ref(f); return lean_apply_8(r, a4, a5, a6, a7, a8, a9, a10, a11); }
+    case 4: { obj* r = FN4(f)(a1, a2, a3, a4); lean_dec_ref(f); return lean_apply_7(r, a5, a6, a7, a8, a9, a10, a11); }
+    }
+  } else if (fixed == 1) {
+    switch (arity) {
+    case 2: { obj* r; if (lean_is_exclusive(f)) { r = FN2(f)(fx(0), a1); lean_free_small_object(f); } else { lean_inc(fx(0)); r = FN2(f)(fx(0), a1); lean_dec_ref(f); } return lean_apply_10(r, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11); }
+    case 3: { obj* r; if (lean_is_exclusive(f)) { r = FN3(f)(fx(0), a1, a2); lean_free_small_object(f); } else { lean_inc(fx(0)); r = FN3(f)(fx(0), a1, a2); lean_dec_ref(f); } return lean_apply_9(r, a3, a4, a5, a6, a7, a8, a9, a10, a11); }
+    case 4: { obj* r; if (lean_is_exclusive(f)) { r = FN4(f)(fx(0), a1, a2, a3); lean_free_small_object(f); } else { lean_inc(fx(0)); r = FN4(f)(fx(0), a1, a2, a3); lean_dec_ref(f); } return lean_apply_8(r, a4, a5, a6, a7, a8, a9, a10, a11); }
+    }
+  }
   obj * as[11] = { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11 };
   obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
   for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
@@ -718,6 +871,20 @@ if (arity == fixed + 12) {
     return r;
   }
 } else if (arity < fixed + 12) {
+  if (fixed == 0) {
+    switch (arity) {
+    case 1: { obj* r = FN1(f)(a1); lean_dec_ref(f); return lean_apply_11(r, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12); }
+    case 2: { obj* r = FN2(f)(a1, a2); lean_dec_ref(f); return lean_apply_10(r, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12); }
+    case 3: { obj* r = FN3(f)(a1, a2, a3); lean_dec_ref(f); return lean_apply_9(r, a4, a5, a6, a7, a8, a9, a10, a11, a12); }
+    case 4: { obj* r = FN4(f)(a1, a2, a3, a4); lean_dec_ref(f); return lean_apply_8(r, a5, a6, a7, a8, a9, a10, a11, a12); }
+    }
+  } else if (fixed == 1) {
+    switch (arity) {
+    case 2: { obj* r; if (lean_is_exclusive(f)) { r = FN2(f)(fx(0), a1); lean_free_small_object(f); } else { lean_inc(fx(0)); r = FN2(f)(fx(0), a1); lean_dec_ref(f); } return lean_apply_11(r, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12); }
+    case 3: { obj* r; if (lean_is_exclusive(f)) { r = FN3(f)(fx(0), a1, a2); lean_free_small_object(f); } else { lean_inc(fx(0)); r = FN3(f)(fx(0), a1, a2); lean_dec_ref(f); } return lean_apply_10(r, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12); }
+    case 4: { obj* r; if (lean_is_exclusive(f)) { r = FN4(f)(fx(0), a1, a2, a3); lean_free_small_object(f); } else { lean_inc(fx(0)); r = FN4(f)(fx(0), a1, a2, a3); lean_dec_ref(f); } return lean_apply_9(r, a4, a5, a6, a7, a8, a9, a10, a11, a12); }
+    }
+  }
   obj * as[12] = { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12 };
   obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
   for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
@@ -758,6 +925,20 @@ if (arity == fixed + 13) {
     return r;
   }
 } else if (arity < fixed + 13) {
+  if (fixed == 0) {
+    switch (arity) {
+    case 1: { obj* r = FN1(f)(a1); lean_dec_ref(f); return lean_apply_12(r, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13); }
+    case 2: { obj* r = FN2(f)(a1, a2); lean_dec_ref(f); return lean_apply_11(r, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13); }
+    case 3: { obj* r = FN3(f)(a1, a2, a3); lean_dec_ref(f); return lean_apply_10(r, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13); }
+    case 4: { obj* r = FN4(f)(a1, a2, a3, a4); lean_dec_ref(f); return lean_apply_9(r, a5, a6, a7, a8, a9, a10, a11, a12, a13); }
+    }
+  } else if (fixed == 1) {
+    switch (arity) {
+    case 2: { obj* r; if (lean_is_exclusive(f)) { r = FN2(f)(fx(0), a1); lean_free_small_object(f); } else { lean_inc(fx(0)); r = FN2(f)(fx(0), a1); lean_dec_ref(f); } return lean_apply_12(r, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13); }
+    case 3: { obj* r; if (lean_is_exclusive(f)) { r = FN3(f)(fx(0), a1, a2); lean_free_small_object(f); } else { lean_inc(fx(0)); r = FN3(f)(fx(0), a1, a2); lean_dec_ref(f); } return lean_apply_11(r, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13); }
+    case 4: { obj* r; if (lean_is_exclusive(f)) { r = FN4(f)(fx(0), a1, a2, a3); lean_free_small_object(f); } else { lean_inc(fx(0)); r = FN4(f)(fx(0), a1, a2, a3); lean_dec_ref(f); } return lean_apply_10(r, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13); }
+    }
+  }
   obj * as[13] = { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13 };
   obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
   for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
@@ -796,6 +977,20 @@ if (arity == fixed + 14) {
     return r;
   }
 } else if (arity < fixed + 14) {
+  if (fixed == 0) {
+    switch (arity) {
+    case 1: { obj* r = FN1(f)(a1); lean_dec_ref(f); return lean_apply_13(r, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14); }
+    case 2: { obj* r = FN2(f)(a1, a2); lean_dec_ref(f); return lean_apply_12(r, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14); }
+    case 3: { obj* r = FN3(f)(a1, a2, a3); lean_dec_ref(f); return lean_apply_11(r, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14); }
+    case 4: { obj* r = FN4(f)(a1, a2, a3, a4); lean_dec_ref(f); return lean_apply_10(r, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14); }
+    }
+  } else if (fixed == 1) {
+    switch (arity) {
+    case 2: { obj* r; if (lean_is_exclusive(f)) { r = FN2(f)(fx(0), a1); lean_free_small_object(f); } else { lean_inc(fx(0)); r = FN2(f)(fx(0), a1); lean_dec_ref(f); } return lean_apply_13(r, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14); }
+    case 3: { obj* r; if (lean_is_exclusive(f)) { r = FN3(f)(fx(0), a1, a2); lean_free_small_object(f); } else { lean_inc(fx(0)); r = FN3(f)(fx(0), a1, a2); lean_dec_ref(f); } return lean_apply_12(r, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14); }
+    case 4: { obj* r; if (lean_is_exclusive(f)) { r = FN4(f)(fx(0), a1, a2, a3); lean_free_small_object(f); } else { lean_inc(fx(0)); r = FN4(f)(fx(0), a1, a2, a3); lean_dec_ref(f); } return lean_apply_11(r, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14); }
+    }
+  }
   obj * as[14] = { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14 };
   obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
   for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
@@ -832,6 +1027,20 @@ if (arity == fixed + 15) {
     return r;
   }
 } else if (arity < fixed + 15) {
+  if (fixed == 0) {
+    switch (arity) {
+    case 1: { obj* r = FN1(f)(a1); lean_dec_ref(f); return lean_apply_14(r, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15); }
+    case 2: { obj* r = FN2(f)(a1, a2); lean_dec_ref(f); return lean_apply_13(r, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15); }
+    case 3: { obj* r = FN3(f)(a1, a2, a3); lean_dec_ref(f); return lean_apply_12(r, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15); }
+    case 4: { obj* r = FN4(f)(a1, a2, a3, a4); lean_dec_ref(f); return lean_apply_11(r, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15); }
+    }
+  } else if (fixed == 1) {
+    switch (arity) {
+    case 2: { obj* r; if (lean_is_exclusive(f)) { r = FN2(f)(fx(0), a1); lean_free_small_object(f); } else { lean_inc(fx(0)); r = FN2(f)(fx(0), a1); lean_dec_ref(f); } return lean_apply_14(r, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15); }
+    case 3: { obj* r; if (lean_is_exclusive(f)) { r = FN3(f)(fx(0), a1, a2); lean_free_small_object(f); } else { lean_inc(fx(0)); r = FN3(f)(fx(0), a1, a2); lean_dec_ref(f); } return lean_apply_13(r, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15); }
+    case 4: { obj* r; if (lean_is_exclusive(f)) { r = FN4(f)(fx(0), a1, a2, a3); lean_free_small_object(f); } else { lean_inc(fx(0)); r = FN4(f)(fx(0), a1, a2, a3); lean_dec_ref(f); } return lean_apply_12(r, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15); }
+    }
+  }
   obj * as[15] = { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15 };
   obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
   for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
@@ -866,6 +1075,20 @@ if (arity == fixed + 16) {
     return r;
   }
 } else if (arity < fixed + 16) {
+  if (fixed == 0) {
+    switch (arity) {
+    case 1: { obj* r = FN1(f)(a1); lean_dec_ref(f); return lean_apply_15(r, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16); }
+    case 2: { obj* r = FN2(f)(a1, a2); lean_dec_ref(f); return lean_apply_14(r, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16); }
+    case 3: { obj* r = FN3(f)(a1, a2, a3); lean_dec_ref(f); return lean_apply_13(r, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16); }
+    case 4: { obj* r = FN4(f)(a1, a2, a3, a4); lean_dec_ref(f); return lean_apply_12(r, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16); }
+    }
+  } else if (fixed == 1) {
+    switch (arity) {
+    case 2: { obj* r; if (lean_is_exclusive(f)) { r = FN2(f)(fx(0), a1); lean_free_small_object(f); } else { lean_inc(fx(0)); r = FN2(f)(fx(0), a1); lean_dec_ref(f); } return lean_apply_15(r, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16); }
+    case 3: { obj* r; if (lean_is_exclusive(f)) { r = FN3(f)(fx(0), a1, a2); lean_free_small_object(f); } else { lean_inc(fx(0)); r = FN3(f)(fx(0), a1, a2); lean_dec_ref(f); } return lean_apply_14(r, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16); }
+    case 4: { obj* r; if (lean_is_exclusive(f)) { r = FN4(f)(fx(0), a1, a2, a3); lean_free_small_object(f); } else { lean_inc(fx(0)); r = FN4(f)(fx(0), a1, a2, a3); lean_dec_ref(f); } return lean_apply_13(r, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16); }
+    }
+  }
   obj * as[16] = { a1, a2, a3, a4, a5, a6, a7, a8, a9, a10, a11, a12, a13, a14, a15, a16 };
   obj ** args = static_cast<obj**>(LEAN_ALLOCA(arity*sizeof(obj*))); // NOLINT
   for (unsigned i = 0; i < fixed; i++) { lean_inc(fx(i)); args[i] = fx(i); }
@@ -0,0 +1,313 @@
+/*
+Copyright (c) 2025 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+*/
+#include <deque>
+#include <lean/lean.h>
+#include "runtime/channel.h"
+#include "runtime/io.h"
+#include "runtime/object.h"
+#include "runtime/thread.h"
+
+namespace lean {
+
+// Capacity of the ring buffer of unbounded channels, values beyond it go to the overflow queue.
+#define LEAN_CHANNEL_UNBOUNDED_RING_SIZE 128
+
+struct channel_cell {
+    atomic<size_t> m_seq;
+    object *       m_value;
+};
+
+/*
+  A multi-producer multi-consumer channel.
+
+  Values are stored in a bounded lock-free ring buffer following Dmitry Vyukov's design: every cell
+  carries a sequence number that tells producers and consumers whether it is free or filled for
+  their position. The mutex is only taken for the slow paths: when the ring buffer is full and
+  `send` appends to `m_overflow`, and when a consumer has to wait. Waiting consumers register a
+  promise in `m_consumers` and bump `m_waiters`, which producers check after publishing a value.
+*/
+class channel {
+    size_t                 m_size;
+    bool                   m_bounded;
+    channel_cell *         m_cells;
+    // Producers and consumers update different positions, keep them on different cache lines.
+    char                   m_pad1[64];
+    atomic<size_t>         m_enqueue_pos;
+    char                   m_pad2[64];
+    atomic<size_t>         m_dequeue_pos;
+    char                   m_pad3[64];
+    atomic<size_t>         m_overflow_size;
+    atomic<size_t>         m_waiters;
+    atomic<bool>           m_closed;
+    mutex                  m_mutex;
+    std::deque<object *>   m_overflow;
+    std::deque<object *>   m_consumers;
+
+    bool ring_push(object * v) {
+        size_t pos = m_enqueue_pos.load(memory_order_relaxed);
+        channel_cell * cell;
+        while (true) {
+            cell = &m_cells[pos % m_size];
+            size_t seq = cell->m_seq.load(memory_order_acquire);
+            intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+            if (dif == 0) {
+                if (m_enqueue_pos.compare_exchange_weak(pos, pos + 1, memory_order_relaxed))
+                    break;
+            } else if (dif < 0) {
+                return false;
+            } else {
+                pos = m_enqueue_pos.load(memory_order_relaxed);
+            }
+        }
+        cell->m_value = v;
+        cell->m_seq.store(pos + 1, memory_order_release);
+        return true;
+    }
+
+    object * ring_pop() {
+        size_t pos = m_dequeue_pos.load(memory_order_relaxed);
+        channel_cell * cell;
+        while (true) {
+            cell = &m_cells[pos % m_size];
+            size_t seq = cell->m_seq.load(memory_order_acquire);
+            intptr_t dif = (intptr_t)seq - (intptr_t)(pos + 1);
+            if (dif == 0) {
+                if (m_dequeue_pos.compare_exchange_weak(pos, pos + 1, memory_order_relaxed))
+                    break;
+            } else if (dif < 0) {
+                return nullptr;
+            } else {
+                pos = m_dequeue_pos.load(memory_order_relaxed);
+            }
+        }
+        object * v = cell->m_value;
+        cell->m_seq.store(pos + m_size, memory_order_release);
+        return v;
+    }
+
+    // Values in the ring buffer are older than the ones in the overflow queue. Requires `m_mutex`.
+    object * pop_locked() {
+        if (object * v = ring_pop())
+            return v;
+        if (!m_overflow.empty()) {
+            object * v = m_overflow.front();
+            m_overflow.pop_front();
+            m_overflow_size.fetch_sub(1);
+            return v;
+        }
+        return nullptr;
+    }
+
+    static void resolve(object * promise, object * v) {
+        object * res = lean_io_promise_resolve(v, promise, lean_io_mk_world());
+        dec(res);
+        dec(promise);
+    }
+
+    // Hand values to waiting consumers. Requires `m_mutex`.
+    void wake_consumers() {
+        while (!m_consumers.empty()) {
+            object * v = pop_locked();
+            if (v == nullptr)
+                return;
+            object * promise = m_consumers.front();
+            m_consumers.pop_front();
+            m_waiters.fetch_sub(1);
+            resolve(promise, mk_option_some(v));
+        }
+    }
+
+    void after_ring_push() {
+        // Pairs with the fence in `recv`: either the consumer sees the value or we see the consumer.
+        atomic_thread_fence(memory_order_seq_cst);
+        if (m_waiters.load(memory_order_relaxed) > 0) {
+            lock_guard<mutex> lock(m_mutex);
+            wake_consumers();
+        }
+    }
+
+public:
+    channel(size_t size, bool bounded) :
+        m_size(size), m_bounded(bounded), m_enqueue_pos(0), m_dequeue_pos(0), m_overflow_size(0),
+        m_waiters(0), m_closed(false) {
+        m_cells = new channel_cell[size];
+        for (size_t i = 0; i < size; i++) {
+            m_cells[i].m_seq.store(i, memory_order_relaxed);
+        }
+    }
+
+    ~channel() {
+        while (object * v = ring_pop())
+            dec(v);
+        for (object * v : m_overflow)
+            dec(v);
+        // Dropping the promises resolves `result?` with `none`.
+        for (object * promise : m_consumers)
+            dec(promise);
+        delete[] m_cells;
+    }
+
+    void for_each(b_obj_arg fn) {
+        size_t end = m_enqueue_pos.load();
+        for (size_t pos = m_dequeue_pos.load(); pos != end; pos++) {
+            channel_cell & cell = m_cells[pos % m_size];
+            if (cell.m_seq.load() == pos + 1) {
+                inc(fn);
+                inc(cell.m_value);
+                dec(lean_apply_1(fn, cell.m_value));
+            }
+        }
+        for (object * v : m_overflow) {
+            inc(fn);
+            inc(v);
+            dec(lean_apply_1(fn, v));
+        }
+        for (object * promise : m_consumers) {
+            inc(fn);
+            inc(promise);
+            dec(lean_apply_1(fn, promise));
+        }
+    }
+
+    void send(object * v) {
+        if (m_closed.load(memory_order_acquire)) {
+            dec(v);
+            return;
+        }
+        if (m_overflow_size.load(memory_order_acquire) == 0 && ring_push(v)) {
+            after_ring_push();
+            return;
+        }
+        lock_guard<mutex> lock(m_mutex);
+        m_overflow.push_back(v);
+        m_overflow_size.fetch_add(1);
+        wake_consumers();
+    }
+
+    bool try_send(object * v) {
+        if (!m_bounded) {
+            send(v);
+            return true;
+        }
+        if (m_closed.load(memory_order_acquire) ||
+            m_overflow_size.load(memory_order_acquire) != 0 || !ring_push(v)) {
+            dec(v);
+            return false;
+        }
+        after_ring_push();
+        return true;
+    }
+
+    void close() {
+        m_closed.store(true, memory_order_release);
+        lock_guard<mutex> lock(m_mutex);
+        wake_consumers();
+        for (object * promise : m_consumers) {
+            resolve(promise, mk_option_none());
+        }
+        m_waiters.fetch_sub(m_consumers.size());
+        m_consumers.clear();
+    }
+
+    // Returns `Sum.inl value` if a value is available or the channel is closed, `Sum.inr promise`
+    // if the consumer has to wait.
+    obj_res recv() {
+        object * v = ring_pop();
+        if (v == nullptr && m_overflow_size.load(memory_order_acquire) == 0 &&
+            !m_closed.load(memory_order_acquire)) {
+            lock_guard<mutex> lock(m_mutex);
+            m_waiters.fetch_add(1);
+            atomic_thread_fence(memory_order_seq_cst);
+            v = pop_locked();
+            if (v == nullptr && !m_closed.load(memory_order_acquire)) {
+                object * prom_res = lean_io_promise_new(lean_io_mk_world());
+                object * promise = lean_ctor_get(prom_res, 0);
+                inc(promise);
+                dec(prom_res);
+                // The promise is resolved by whichever thread sends the next value.
+                lean_mark_mt(promise);
+                inc(promise);
+                m_consumers.push_back(promise);
+                object * r = alloc_cnstr(1, 1, 0);
+                cnstr_set(r, 0, promise);
+                return r;
+            }
+            m_waiters.fetch_sub(1);
+        } else if (v == nullptr) {
+            lock_guard<mutex> lock(m_mutex);
+            v = pop_locked();
+        }
+        object * r = alloc_cnstr(0, 1, 0);
+        cnstr_set(r, 0, v == nullptr ? mk_option_none() : mk_option_some(v));
+        return r;
+    }
+
+    obj_res recv_all_current() {
+        object * arr = lean_mk_empty_array();
+        lock_guard<mutex> lock(m_mutex);
+        while (object * v = pop_locked())
+            arr = lean_array_push(arr, v);
+        return arr;
+    }
+};
+
+static lean_external_class * g_channel_external_class = nullptr;
+static void channel_finalizer(void * h) {
+    delete static_cast<channel *>(h);
+}
+static void channel_foreach(void * h, b_obj_arg fn) {
+    static_cast<channel *>(h)->for_each(fn);
+}
+
+static channel * channel_get(lean_object * ch) {
+    return static_cast<channel *>(lean_get_external_data(ch));
+}
+
+/* Std.Channel.newCore (capacity : USize) (bounded : Bool) : BaseIO (Channel α) */
+extern "C" LEAN_EXPORT obj_res lean_io_channel_new(size_t capacity, uint8_t bounded, obj_arg) {
+    size_t size = bounded ? capacity : LEAN_CHANNEL_UNBOUNDED_RING_SIZE;
+    return io_result_mk_ok(lean_alloc_external(g_channel_external_class, new channel(size, bounded)));
+}
+
+/* Std.Channel.send (ch : @& Channel α) (v : α) : BaseIO Unit */
+extern "C" LEAN_EXPORT obj_res lean_io_channel_send(b_obj_arg ch, obj_arg v, obj_arg) {
+    // Values in a channel that is shared between threads are received by other threads.
+    if (!lean_is_st(ch))
+        lean_mark_mt(v);
+    channel_get(ch)->send(v);
+    return io_result_mk_ok(box(0));
+}
+
+/* Std.Channel.trySend (ch : @& Channel α) (v : α) : BaseIO Bool */
+extern "C" LEAN_EXPORT obj_res lean_io_channel_try_send(b_obj_arg ch, obj_arg v, obj_arg) {
+    if (!lean_is_st(ch))
+        lean_mark_mt(v);
+    return io_result_mk_ok(box(channel_get(ch)->try_send(v)));
+}
+
+/* Std.Channel.close (ch : @& Channel α) : BaseIO Unit */
+extern "C" LEAN_EXPORT obj_res lean_io_channel_close(b_obj_arg ch, obj_arg) {
+    channel_get(ch)->close();
+    return io_result_mk_ok(box(0));
+}
+
+/* Std.Channel.recvCore (ch : @& Channel α) : BaseIO (Option α ⊕ IO.Promise (Option α)) */
+extern "C" LEAN_EXPORT obj_res lean_io_channel_recv(b_obj_arg ch, obj_arg) {
+    return io_result_mk_ok(channel_get(ch)->recv());
+}
+
+/* Std.Channel.recvAllCurrent (ch : @& Channel α) : BaseIO (Array α) */
+extern "C" LEAN_EXPORT obj_res lean_io_channel_recv_all_current(b_obj_arg ch, obj_arg) {
+    return io_result_mk_ok(channel_get(ch)->recv_all_current());
+}
+
+void initialize_channel() {
+    g_channel_external_class = lean_register_external_class(channel_finalizer, channel_foreach);
+}
+
+void finalize_channel() {
+}
+
+}
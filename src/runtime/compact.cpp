@@ -9,6 +9,7 @@ Author: Leonardo de Moura
 #include <string>
 #include <vector>
 #include <cstring>
+#include <atomic>
 #include <lean/lean.h>
 #include "runtime/hash.h"
 #include "runtime/compact.h"
@@ -35,7 +36,7 @@ struct max_sharing_hash {
     object_compactor * m;
     max_sharing_hash(object_compactor * manager):m(manager) {}
     unsigned operator()(max_sharing_key const & k) const {
-        return hash_str(k.m_size, reinterpret_cast<unsigned char const *>(m->m_begin) + k.m_offset, 17);
+        return hash_mem(k.m_size, reinterpret_cast<unsigned char const *>(m->m_begin) + k.m_offset, 17);
     }
 };
 
@@ -100,7 +101,23 @@ void object_compactor::save(object * o, object * new_o) {
     m_obj_table.insert(std::make_pair(o, reinterpret_cast<object_offset>(reinterpret_cast<char*>(new_o) - reinterpret_cast<char*>(m_begin) + reinterpret_cast<size_t>(m_base_addr))));
 }
 
+static unsigned get_share_kind(object * o) {
+    switch (lean_ptr_tag(o)) {
+    case LeanArray:       return compactor_share_array;
+    case LeanString:      return compactor_share_string;
+    case LeanScalarArray: return compactor_share_sarray;
+    case LeanThunk: case LeanTask: case LeanPromise: case LeanRef:
+        return compactor_share_other;
+    default:
+        return compactor_share_ctor;
+    }
+}
+
 void object_compactor::save_max_sharing(object * o, object * new_o, size_t new_o_sz) {
+    if (!(m_sharing_policy.m_kinds & get_share_kind(o)) || new_o_sz > m_sharing_policy.m_max_size) {
+        save(o, new_o);
+        return;
+    }
     max_sharing_key k(reinterpret_cast<char*>(new_o) - reinterpret_cast<char*>(m_begin), new_o_sz);
     auto it = m_max_sharing_table->m_table.find(k);
     if (it != m_max_sharing_table->m_table.end()) {
@@ -374,6 +391,13 @@ void object_compactor::operator()(object * o) {
     *static_cast<object_offset *>(m_begin) = to_offset(o);
 }
 
+/* Bytes of all live compacted regions. */
+static std::atomic<size_t> g_compacted_region_memory(0);
+
+size_t get_compacted_region_memory() {
+    return g_compacted_region_memory;
+}
+
 compacted_region::compacted_region(size_t sz, void * data, void * base_addr, bool is_mmap, std::function<void()> free_data):
     m_base_addr(base_addr),
     m_is_mmap(is_mmap),
@@ -381,6 +405,7 @@ compacted_region::compacted_region(size_t sz, void * data, void * base_addr, boo
     m_begin(data),
     m_next(data),
     m_end(static_cast<char*>(data)+sz) {
+    g_compacted_region_memory += sz;
 }
 
 compacted_region::compacted_region(object_compactor const & c):
@@ -388,9 +413,11 @@ compacted_region::compacted_region(object_compactor const & c):
     m_next(m_begin),
     m_end(static_cast<char*>(m_begin) + c.size()) {
     memcpy(m_begin, c.data(), c.size());
+    g_compacted_region_memory += c.size();
 }
 
 compacted_region::~compacted_region() {
+    g_compacted_region_memory -= static_cast<char*>(m_end) - static_cast<char*>(m_begin);
     m_free_data();
 }
 
@@ -13,12 +13,34 @@ Author: Leonardo de Moura
 namespace lean {
 typedef lean_object * object_offset;
 
+/* Kinds of objects that `object_compactor` tries to maximally share, see `compactor_sharing_policy`. */
+enum compactor_share_kind : unsigned {
+    compactor_share_ctor   = 1u << 0,
+    compactor_share_array  = 1u << 1,
+    compactor_share_string = 1u << 2,
+    compactor_share_sarray = 1u << 3,
+    // thunks, tasks, promises and references
+    compactor_share_other  = 1u << 4,
+    compactor_share_all    = (1u << 5) - 1
+};
+
+/*
+  Max sharing in `object_compactor` hashes every object it copies. On big inputs most of the
+  benefit comes from constructor objects and strings, so callers can restrict sharing to some
+  kinds of objects, and to objects of at most `m_max_size` bytes.
+*/
+struct compactor_sharing_policy {
+    unsigned m_kinds    = compactor_share_all;
+    size_t   m_max_size = static_cast<size_t>(-1);
+};
+
 class LEAN_EXPORT object_compactor {
     struct max_sharing_table;
     friend struct max_sharing_hash;
     friend struct max_sharing_eq;
     std::unordered_map<object*, object_offset, std::hash<object*>, std::equal_to<object*>> m_obj_table;
     std::unique_ptr<max_sharing_table> m_max_sharing_table;
+    compactor_sharing_policy m_sharing_policy;
     std::vector<object*> m_todo;
     std::vector<object_offset> m_tmp;
     // On-disk base address used for `mmap`ing compacted regions without relocations
@@ -51,11 +73,15 @@ public:
     ~object_compactor();
     object_compactor operator=(object_compactor const &) = delete;
     object_compactor operator=(object_compactor &&) = delete;
+    void set_sharing_policy(compactor_sharing_policy const & p) { m_sharing_policy = p; }
     void operator()(object * o);
     size_t size() const { return static_cast<char*>(m_end) - static_cast<char*>(m_begin); }
     void const * data() const { return m_begin; }
 };
 
+/* Return the total size of all live compacted regions in bytes. */
+LEAN_EXPORT size_t get_compacted_region_memory();
+
 class LEAN_EXPORT compacted_region {
     // see `object_compactor::m_base_addr`
     void * m_base_addr;
@@ -4,6 +4,7 @@ Released under Apache 2.0 license as described in the file LICENSE.
 
 Author: Leonardo de Moura
 */
+#include <cstring>
 #include "runtime/hash.h"
 
 namespace lean {
@@ -11,11 +12,12 @@ namespace lean {
 //-----------------------------------------------------------------------------
 // MurmurHash2, 64-bit versions, by Austin Appleby
 // https://sites.google.com/site/murmurhash/
-static uint64 MurmurHash64A(void const * key, size_t len, uint64 seed) {
-    const uint64 m = 0xc6a4a7935bd1e995;
-    const int r = 47;
+static const uint64 g_murmur_m = 0xc6a4a7935bd1e995;
+static const int g_murmur_r = 47;
 
-    uint64 h = seed ^ (len * m);
+static inline uint64 MurmurHash64A_blocks(uint64 h, void const * key, size_t len) {
+    const uint64 m = g_murmur_m;
+    const int r = g_murmur_r;
 
     const uint64 * data = (const uint64 *)key;
     const uint64 * end = data + (len/8);
@@ -44,6 +46,13 @@ static uint64 MurmurHash64A(void const * key, size_t len, uint64 seed) {
             h *= m;
     };
 
+    return h;
+}
+
+static inline uint64 MurmurHash64A_finish(uint64 h) {
+    const uint64 m = g_murmur_m;
+    const int r = g_murmur_r;
+
     h ^= h >> r;
     h *= m;
     h ^= h >> r;
@@ -51,8 +60,141 @@ static uint64 MurmurHash64A(void const * key, size_t len, uint64 seed) {
     return h;
 }
 
+static uint64 MurmurHash64A(void const * key, size_t len, uint64 seed) {
+    uint64 h = seed ^ (len * g_murmur_m);
+    return MurmurHash64A_finish(MurmurHash64A_blocks(h, key, len));
+}
+
 uint64 hash_str(size_t len, unsigned char const * str, uint64 init_value) {
     return MurmurHash64A(str, len, init_value);
 }
 
+hash_str_fn::hash_str_fn(size_t len, uint64 init_value):m_h(init_value ^ (len * g_murmur_m)) {}
+
+void hash_str_fn::add(size_t len, unsigned char const * str) {
+    m_h = MurmurHash64A_blocks(m_h, str, len);
+}
+
+uint64 hash_str_fn::finish() const {
+    return MurmurHash64A_finish(m_h);
+}
+
+//-----------------------------------------------------------------------------
+// wyhash (final version 4), by Wang Yi
+// https://github.com/wangyi-fudan/wyhash
+#if defined(__SIZEOF_INT128__)
+static const uint64 g_wyp[4] = {0xa0761d6478bd642full, 0xe7037ed1a0b428dbull, 0x8ebc6af09c88c6e3ull, 0x589965cc75374cc3ull};
+
+static inline void wymum(uint64 & a, uint64 & b) {
+    unsigned __int128 r = static_cast<unsigned __int128>(a) * b;
+    a = static_cast<uint64>(r);
+    b = static_cast<uint64>(r >> 64);
+}
+
+static inline uint64 wymix(uint64 a, uint64 b) { wymum(a, b); return a ^ b; }
+static inline uint64 wyr8(unsigned char const * p) { uint64 v; memcpy(&v, p, 8); return v; }
+static inline uint64 wyr4(unsigned char const * p) { uint32 v; memcpy(&v, p, 4); return v; }
+static inline uint64 wyr3(unsigned char const * p, size_t k) {
+    return (uint64(p[0]) << 16) | (uint64(p[k >> 1]) << 8) | p[k - 1];
+}
+
+static uint64 wyhash(unsigned char const * p, size_t len, uint64 seed) {
+    seed ^= wymix(seed ^ g_wyp[0], g_wyp[1]);
+    uint64 a, b;
+    if (len <= 16) {
+        if (len >= 4) {
+            a = (wyr4(p) << 32) | wyr4(p + ((len >> 3) << 2));
+            b = (wyr4(p + len - 4) << 32) | wyr4(p + len - 4 - ((len >> 3) << 2));
+        } else if (len > 0) {
+            a = wyr3(p, len);
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = len;
+        if (i > 48) {
+            uint64 see1 = seed, see2 = seed;
+            do {
+                seed = wymix(wyr8(p) ^ g_wyp[1], wyr8(p + 8) ^ seed);
+                see1 = wymix(wyr8(p + 16) ^ g_wyp[2], wyr8(p + 24) ^ see1);
+                see2 = wymix(wyr8(p + 32) ^ g_wyp[3], wyr8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16) {
+            seed = wymix(wyr8(p) ^ g_wyp[1], wyr8(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        a = wyr8(p + i - 16);
+        b = wyr8(p + i - 8);
+    }
+    a ^= g_wyp[1];
+    b ^= seed;
+    wymum(a, b);
+    return wymix(a ^ g_wyp[0] ^ len, b ^ g_wyp[1]);
+}
+#endif
+
+uint64 hash_mem(size_t len, unsigned char const * str, uint64 init_value) {
+#if defined(__SIZEOF_INT128__)
+    return wyhash(str, len, init_value);
+#else
+    return MurmurHash64A(str, len, init_value);
+#endif
+}
+
+
+//-----------------------------------------------------------------------------
+// CRC-32C
+
+static uint32 g_crc32c_table[256];
+
+static bool init_crc32c_table() {
+    for (uint32 i = 0; i < 256; i++) {
+        uint32 c = i;
+        for (int k = 0; k < 8; k++)
+            c = (c & 1) ? (c >> 1) ^ 0x82f63b78 : c >> 1;
+        g_crc32c_table[i] = c;
+    }
+    return true;
+}
+
+static uint32 crc32c_sw(unsigned char const * p, size_t len, uint32 crc) {
+    static bool initialized = init_crc32c_table();
+    (void)initialized;
+    for (size_t i = 0; i < len; i++)
+        crc = g_crc32c_table[(crc ^ p[i]) & 0xff] ^ (crc >> 8);
+    return crc;
+}
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+__attribute__((target("sse4.2")))
+static uint32 crc32c_hw(unsigned char const * p, size_t len, uint32 crc) {
+    uint64 c = crc;
+    for (; len >= 8; p += 8, len -= 8) {
+        uint64 v;
+        memcpy(&v, p, 8);
+        c = __builtin_ia32_crc32di(c, v);
+    }
+    crc = static_cast<uint32>(c);
+    for (; len > 0; p++, len--)
+        crc = __builtin_ia32_crc32qi(crc, *p);
+    return crc;
+}
+#endif
+
+uint32 crc32c(void const * data, size_t len, uint32 crc) {
+    unsigned char const * p = static_cast<unsigned char const *>(data);
+    crc = ~crc;
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+    static bool has_sse42 = __builtin_cpu_supports("sse4.2");
+    if (has_sse42)
+        return ~crc32c_hw(p, len, crc);
+#endif
+    return ~crc32c_sw(p, len, crc);
+}
 }
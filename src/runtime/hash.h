@@ -10,8 +10,27 @@ Author: Leonardo de Moura
 
 namespace lean {
 
+/** \brief Hash function used by `String.hash` and `ByteArray.hash`. Its values are observable from Lean
+    and stored in `.olean` files (e.g., as part of `Name` hashes), so it must not change. */
 uint64 hash_str(size_t len, unsigned char const * str, uint64 init_value);
 
+/** \brief Computes `hash_str(len, str, init_value)` from consecutive pieces of `str` passed to `add`.
+    All pieces but the last one must have a size divisible by 8. */
+class hash_str_fn {
+    uint64 m_h;
+public:
+    hash_str_fn(size_t len, uint64 init_value);
+    void add(size_t len, unsigned char const * str);
+    uint64 finish() const;
+};
+
+/** \brief Faster hash function for in-memory tables. Unlike `hash_str`, its values may differ between
+    platforms and versions, so they must not be persisted or exposed to Lean code. */
+uint64 hash_mem(size_t len, unsigned char const * str, uint64 init_value);
+
+/** \brief CRC-32C (Castagnoli) of the given data. Uses the SSE 4.2 instruction if available. */
+uint32 crc32c(void const * data, size_t len, uint32 crc = 0);
+
 inline uint64 hash(uint64 h, uint64 k) {
     uint64 m = 0xc6a4a7935bd1e995;
     uint64 r = 47;
@@ -20,6 +20,10 @@ void inc_heartbeat() { g_heartbeat++; }
 
 void reset_heartbeat() { g_heartbeat = 0; }
 
+size_t get_heartbeat() { return g_heartbeat; }
+
+void add_heartbeat(size_t n) { g_heartbeat += n; }
+
 void set_max_heartbeat(size_t max) { g_max_heartbeat = max; }
 
 size_t get_max_heartbeat() { return g_max_heartbeat; }
@@ -44,6 +48,8 @@ LEAN_THREAD_VALUE(lean_object *, g_cancel_tk, nullptr);
 
 LEAN_EXPORT scope_cancel_tk::scope_cancel_tk(lean_object * o):flet<lean_object *>(g_cancel_tk, o) {}
 
+LEAN_EXPORT lean_object * get_cancel_tk() { return g_cancel_tk; }
+
 /* CancelToken.isSet : @& IO.CancelToken → BaseIO Bool */
 extern "C" lean_obj_res lean_io_cancel_token_is_set(b_lean_obj_arg cancel_tk, lean_obj_arg);
 
@@ -57,11 +63,19 @@ void check_interrupted() {
     }
 }
 
+/* Querying the cancel token calls into Lean code, which costs much more than the other checks, so
+   `check_system` does so only every `LEAN_CHECK_INTERRUPTED_INTERVAL` calls per thread. */
+#define LEAN_CHECK_INTERRUPTED_INTERVAL 32
+LEAN_THREAD_VALUE(unsigned, g_check_interrupted_countdown, 0);
+
 void check_system(char const * component_name, bool do_check_interrupted) {
     check_stack(component_name);
     check_memory(component_name);
     if (do_check_interrupted) {
-        check_interrupted();
+        if (g_cancel_tk && g_check_interrupted_countdown-- == 0) {
+            g_check_interrupted_countdown = LEAN_CHECK_INTERRUPTED_INTERVAL - 1;
+            check_interrupted();
+        }
         check_heartbeat();
     }
 }
@@ -18,6 +18,13 @@ LEAN_EXPORT void inc_heartbeat();
 /** \brief Reset thread local counter for approximating elapsed time. */
 LEAN_EXPORT void reset_heartbeat();
 
+/** \brief Return the thread local counter for approximating elapsed time. */
+LEAN_EXPORT size_t get_heartbeat();
+
+/** \brief Add `n` to the thread local counter, e.g. for work done on behalf of this thread by
+    other threads. The limit is checked by the next `check_heartbeat`. */
+LEAN_EXPORT void add_heartbeat(size_t n);
+
 /* Update the current heartbeat */
 class scope_heartbeat : flet<size_t> {
 public:
@@ -48,6 +55,9 @@ public:
     LEAN_EXPORT scope_cancel_tk(lean_object *);
 };
 
+/* Return the thread local `IO.CancelToken` (`nullptr` if unset) */
+LEAN_EXPORT lean_object * get_cancel_tk();
+
 /**
    \brief Throw an interrupted exception if the current thread's cancel token is set.
 */
@@ -55,7 +65,8 @@ LEAN_EXPORT void check_interrupted();
 
 /**
    \brief Check system resources: stack, memory, and (if `do_check_interrupted` is true) heartbeat
-   limit and interrupt flag.
+   limit and interrupt flag. The interrupt flag is only queried on every few calls, which delays
+   interruption by a negligible amount of work.
 
    `do_check_interrupted` should only be set to `true` in places where a C++ exception is caught and
    would not bring down the entire process as interruption (via heartbeat limit or flag) should not
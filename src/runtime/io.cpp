@@ -28,6 +28,11 @@ Authors: Leonardo de Moura, Sebastian Ullrich
 #endif
 #ifndef LEAN_WINDOWS
 #include <csignal>
+#include <climits>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <poll.h>
+#include <pthread.h>
 #endif
 #include <dirent.h>
 #include <fcntl.h>
@@ -37,6 +42,8 @@ Authors: Leonardo de Moura, Sebastian Ullrich
 #include <fstream>
 #include <iomanip>
 #include <string>
+#include <vector>
+#include <atomic>
 #include <cstdlib>
 #include <cctype>
 #include <sys/stat.h>
@@ -49,6 +56,13 @@ Authors: Leonardo de Moura, Sebastian Ullrich
 #include "runtime/thread.h"
 #include "runtime/allocprof.h"
 #include "runtime/option_ref.h"
+#include "runtime/hash.h"
+#include "runtime/memory.h"
+
+// line buffers of `lean_io_prim_handle_get_line` bigger than this are not kept for later calls
+#define LEAN_GET_LINE_MAX_CACHED_BUFFER 1024*1024
+// Minimum number of bytes read at once by `Process.readOutputs`.
+#define LEAN_READ_OUTPUTS_CHUNK 64*1024
 
 #ifdef _MSC_VER
 #define S_ISDIR(mode) ((mode & _S_IFDIR) != 0)
@@ -306,7 +320,7 @@ extern "C" LEAN_EXPORT obj_res lean_decode_uv_error(int errnum, b_obj_arg fname)
         }
     /* LibUV does not map ECHILD as of version 1.48.0 */
     case UV_ENXIO: case UV_EHOSTUNREACH: case UV_ENETUNREACH:
-    case UV_ECONNREFUSED:
+    case UV_ECONNREFUSED: case UV_EAI_NONAME:
 #if UV_VERSION_HEX >= 0x014500
     case UV_ENODATA:
 #endif
@@ -584,6 +598,124 @@ extern "C" LEAN_EXPORT obj_res lean_io_prim_handle_read(b_obj_arg h, usize nbyte
     }
 }
 
+/* Handle.readInto : (@& Handle) → ByteArray → USize → USize → IO ByteArray */
+extern "C" LEAN_EXPORT obj_res lean_io_prim_handle_read_into(b_obj_arg h, obj_arg buf, usize off, usize nbytes, obj_arg /* w */) {
+    FILE * fp = io_get_handle(h);
+    off = std::min(off, lean_sarray_size(buf));
+    obj_res res;
+    usize n;
+    if (lean_is_exclusive(buf) && lean_sarray_capacity(buf) >= off + nbytes) {
+        res = buf;
+        n = std::fread(lean_sarray_cptr(res) + off, 1, nbytes, fp);
+        lean_sarray_set_size(res, off + n);
+    } else {
+        /* Read into a separate chunk first, so that `buf` is not copied just to find out that we
+           are at the end of the file. */
+        obj_res chunk = lean_alloc_sarray(1, 0, nbytes);
+        n = std::fread(lean_sarray_cptr(chunk), 1, nbytes, fp);
+        if (n == 0 && off == lean_sarray_size(buf)) {
+            res = buf;
+        } else {
+            res = lean_sarray_ensure_exclusive(lean_sarray_ensure_capacity(buf, off + n, /* exact */ false));
+            memcpy(lean_sarray_cptr(res) + off, lean_sarray_cptr(chunk), n);
+            lean_sarray_set_size(res, off + n);
+        }
+        dec_ref(chunk);
+    }
+    if (n > 0) {
+        return io_result_mk_ok(res);
+    } else if (feof(fp)) {
+        clearerr(fp);
+        return io_result_mk_ok(res);
+    } else {
+        dec_ref(res);
+        return io_result_mk_error(decode_io_error(errno, nullptr));
+    }
+}
+
+#if defined(LEAN_WINDOWS)
+/* Read the remaining contents of `fp`, growing `buf` geometrically. Returns `false` on error. */
+static bool read_bin_to_end_into(FILE * fp, object *& buf) {
+    while (true) {
+        buf = lean_sarray_ensure_exclusive(lean_sarray_ensure_capacity(buf, lean_sarray_size(buf) + LEAN_READ_OUTPUTS_CHUNK, /* exact */ false));
+        usize sz = lean_sarray_size(buf);
+        usize n = std::fread(lean_sarray_cptr(buf) + sz, 1, lean_sarray_capacity(buf) - sz, fp);
+        lean_sarray_set_size(buf, sz + n);
+        if (n == 0) {
+            if (feof(fp)) {
+                clearerr(fp);
+                return true;
+            }
+            return false;
+        }
+    }
+}
+#endif
+
+/*
+  Process.readOutputs : (@& Handle) → (@& Handle) → IO (ByteArray × ByteArray)
+
+  Drain both handles concurrently. On POSIX the underlying file descriptors are multiplexed with
+  `poll` and read directly, bypassing the stdio buffers, so the handles must not have been read
+  from before.
+*/
+extern "C" LEAN_EXPORT obj_res lean_io_process_read_outputs(b_obj_arg h1, b_obj_arg h2, obj_arg /* w */) {
+    object * bufs[2] = { lean_alloc_sarray(1, 0, 0), lean_alloc_sarray(1, 0, 0) };
+    int err = 0;
+#if defined(LEAN_WINDOWS)
+    FILE * fp1 = io_get_handle(h1);
+    bool ok1 = true;
+    lthread t([&]() { ok1 = read_bin_to_end_into(fp1, bufs[0]); if (!ok1) err = errno; });
+    bool ok2 = read_bin_to_end_into(io_get_handle(h2), bufs[1]);
+    if (!ok2) err = errno;
+    t.join();
+    bool ok = ok1 && ok2;
+#else
+    struct pollfd fds[2];
+    fds[0].fd = fileno(io_get_handle(h1));
+    fds[1].fd = fileno(io_get_handle(h2));
+    fds[0].events = fds[1].events = POLLIN;
+    int num_open = 2;
+    bool ok = true;
+    while (ok && num_open > 0) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            err = errno;
+            ok = false;
+            break;
+        }
+        for (int i = 0; i < 2; i++) {
+            if (fds[i].fd < 0 || !(fds[i].revents & (POLLIN | POLLHUP | POLLERR)))
+                continue;
+            object * buf = lean_sarray_ensure_exclusive(lean_sarray_ensure_capacity(bufs[i], lean_sarray_size(bufs[i]) + LEAN_READ_OUTPUTS_CHUNK, /* exact */ false));
+            bufs[i] = buf;
+            usize sz = lean_sarray_size(buf);
+            ssize_t n = read(fds[i].fd, lean_sarray_cptr(buf) + sz, lean_sarray_capacity(buf) - sz);
+            if (n > 0) {
+                lean_sarray_set_size(buf, sz + n);
+            } else if (n == 0) {
+                // a negative file descriptor is ignored by `poll`
+                fds[i].fd = -1;
+                num_open--;
+            } else if (errno != EINTR && errno != EAGAIN) {
+                err = errno;
+                ok = false;
+                break;
+            }
+        }
+    }
+#endif
+    if (!ok) {
+        dec_ref(bufs[0]);
+        dec_ref(bufs[1]);
+        return io_result_mk_error(decode_io_error(err, nullptr));
+    }
+    object * r = alloc_cnstr(0, 2, 0);
+    cnstr_set(r, 0, bufs[0]);
+    cnstr_set(r, 1, bufs[1]);
+    return io_result_mk_ok(r);
+}
+
 /* Handle.write : (@& Handle) → (@& ByteArray) → IO Unit */
 extern "C" LEAN_EXPORT obj_res lean_io_prim_handle_write(b_obj_arg h, b_obj_arg buf, obj_arg /* w */) {
     FILE * fp = io_get_handle(h);
@@ -596,10 +728,153 @@ extern "C" LEAN_EXPORT obj_res lean_io_prim_handle_write(b_obj_arg h, b_obj_arg
     }
 }
 
+/*
+  Positional and vectored I/O work on the underlying file descriptor, bypassing the stdio buffer,
+  which is flushed first so that earlier `Handle.write`s are not reordered with them.
+*/
+#ifdef LEAN_WINDOWS
+
+/* Handle.writeMany : (@& Handle) → (@& Array ByteArray) → IO Unit */
+extern "C" LEAN_EXPORT obj_res lean_io_prim_handle_write_many(b_obj_arg h, b_obj_arg bufs, obj_arg /* w */) {
+    FILE * fp = io_get_handle(h);
+    size_t sz = lean_array_size(bufs);
+    for (size_t i = 0; i < sz; i++) {
+        b_obj_arg buf = lean_array_get_core(bufs, i);
+        usize n = lean_sarray_size(buf);
+        if (std::fwrite(lean_sarray_cptr(buf), 1, n, fp) != n)
+            return io_result_mk_error(decode_io_error(errno, nullptr));
+    }
+    return io_result_mk_ok(box(0));
+}
+
+/* Handle.readAt : (@& Handle) → UInt64 → USize → IO ByteArray */
+extern "C" LEAN_EXPORT obj_res lean_io_prim_handle_read_at(b_obj_arg h, uint64 off, usize nbytes, obj_arg /* w */) {
+    FILE * fp = io_get_handle(h);
+    if (std::fflush(fp) != 0)
+        return io_result_mk_error(decode_io_error(errno, nullptr));
+    obj_res res = lean_alloc_sarray(1, 0, nbytes);
+    // Remark: unlike `pread`, this moves the file pointer of the handle
+    OVERLAPPED o = {0};
+    o.Offset     = static_cast<DWORD>(off);
+    o.OffsetHigh = static_cast<DWORD>(off >> 32);
+    DWORD n = 0;
+    if (!ReadFile(win_handle(fp), lean_sarray_cptr(res), static_cast<DWORD>(nbytes), &n, &o) && GetLastError() != ERROR_HANDLE_EOF) {
+        dec_ref(res);
+        return io_result_mk_error((sstream() << GetLastError()).str());
+    }
+    lean_sarray_set_size(res, n);
+    return io_result_mk_ok(res);
+}
+
+/* Handle.writeAt : (@& Handle) → UInt64 → (@& ByteArray) → IO Unit */
+extern "C" LEAN_EXPORT obj_res lean_io_prim_handle_write_at(b_obj_arg h, uint64 off, b_obj_arg buf, obj_arg /* w */) {
+    FILE * fp = io_get_handle(h);
+    if (std::fflush(fp) != 0)
+        return io_result_mk_error(decode_io_error(errno, nullptr));
+    OVERLAPPED o = {0};
+    o.Offset     = static_cast<DWORD>(off);
+    o.OffsetHigh = static_cast<DWORD>(off >> 32);
+    DWORD n = 0;
+    usize sz = lean_sarray_size(buf);
+    if (!WriteFile(win_handle(fp), lean_sarray_cptr(buf), static_cast<DWORD>(sz), &n, &o) || n != sz)
+        return io_result_mk_error((sstream() << GetLastError()).str());
+    return io_result_mk_ok(box(0));
+}
+
+#else
+
+/* Handle.writeMany : (@& Handle) → (@& Array ByteArray) → IO Unit */
+extern "C" LEAN_EXPORT obj_res lean_io_prim_handle_write_many(b_obj_arg h, b_obj_arg bufs, obj_arg /* w */) {
+    FILE * fp = io_get_handle(h);
+    if (std::fflush(fp) != 0)
+        return io_result_mk_error(decode_io_error(errno, nullptr));
+    int fd = fileno(fp);
+    size_t sz = lean_array_size(bufs);
+    std::vector<iovec> iov;
+    size_t i = 0;   // next buffer to write
+    size_t off = 0; // bytes of buffer `i` already written
+    while (i < sz) {
+        iov.clear();
+        for (size_t j = i; j < sz && iov.size() < IOV_MAX; j++) {
+            b_obj_arg buf = lean_array_get_core(bufs, j);
+            size_t skip = j == i ? off : 0;
+            iov.push_back(iovec{lean_sarray_cptr(buf) + skip, lean_sarray_size(buf) - skip});
+        }
+        ssize_t n = writev(fd, iov.data(), iov.size());
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return io_result_mk_error(decode_io_error(errno, nullptr));
+        }
+        // skip over what has been written, keeping track of a partially written buffer
+        size_t rem = n;
+        while (i < sz && rem >= lean_sarray_size(lean_array_get_core(bufs, i)) - off) {
+            rem -= lean_sarray_size(lean_array_get_core(bufs, i)) - off;
+            off = 0;
+            i++;
+        }
+        off += rem;
+    }
+    return io_result_mk_ok(box(0));
+}
+
+/* Handle.readAt : (@& Handle) → UInt64 → USize → IO ByteArray */
+extern "C" LEAN_EXPORT obj_res lean_io_prim_handle_read_at(b_obj_arg h, uint64 off, usize nbytes, obj_arg /* w */) {
+    FILE * fp = io_get_handle(h);
+    if (std::fflush(fp) != 0)
+        return io_result_mk_error(decode_io_error(errno, nullptr));
+    obj_res res = lean_alloc_sarray(1, 0, nbytes);
+    ssize_t n;
+    do {
+        n = pread(fileno(fp), lean_sarray_cptr(res), nbytes, off);
+    } while (n < 0 && errno == EINTR);
+    if (n < 0) {
+        dec_ref(res);
+        return io_result_mk_error(decode_io_error(errno, nullptr));
+    }
+    lean_sarray_set_size(res, n);
+    return io_result_mk_ok(res);
+}
+
+/* Handle.writeAt : (@& Handle) → UInt64 → (@& ByteArray) → IO Unit */
+extern "C" LEAN_EXPORT obj_res lean_io_prim_handle_write_at(b_obj_arg h, uint64 off, b_obj_arg buf, obj_arg /* w */) {
+    FILE * fp = io_get_handle(h);
+    if (std::fflush(fp) != 0)
+        return io_result_mk_error(decode_io_error(errno, nullptr));
+    uint8 const * data = lean_sarray_cptr(buf);
+    size_t sz = lean_sarray_size(buf);
+    while (sz > 0) {
+        ssize_t n = pwrite(fileno(fp), data, sz, off);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return io_result_mk_error(decode_io_error(errno, nullptr));
+        }
+        data += n;
+        sz   -= n;
+        off  += n;
+    }
+    return io_result_mk_ok(box(0));
+}
+
+#endif
+
+#if !defined(LEAN_WINDOWS)
+/* Line buffer of `lean_io_prim_handle_get_line`, freed when the thread finishes. */
+LEAN_THREAD_PTR(char, g_line_buf);
+LEAN_THREAD_VALUE(size_t, g_line_buf_cap, 0);
+LEAN_THREAD_VALUE(bool, g_line_buf_finalizer, false);
+
+static void finalize_line_buf(void *) {
+    free(g_line_buf);
+    g_line_buf = nullptr;
+    g_line_buf_cap = 0;
+}
+#endif
+
 /* Handle.getLine : (@& Handle) → IO Unit */
 extern "C" LEAN_EXPORT obj_res lean_io_prim_handle_get_line(b_obj_arg h, obj_arg /* w */) {
     FILE * fp = io_get_handle(h);
 
+#if defined(LEAN_WINDOWS)
     std::string result;
     int c; // Note: int, not char, required to handle EOF
     while ((c = std::fgetc(fp)) != EOF) {
@@ -618,6 +893,27 @@ extern "C" LEAN_EXPORT obj_res lean_io_prim_handle_get_line(b_obj_arg h, obj_arg
         obj_res ret = io_result_mk_ok(mk_string(result));
         return ret;
     }
+#else
+    /* `getline` searches the stdio buffer for the newline in bulk instead of reading one character
+       at a time. The line buffer is reused by later calls on the same thread unless it got big. */
+    if (!g_line_buf_finalizer) {
+        register_thread_finalizer(finalize_line_buf, nullptr);
+        g_line_buf_finalizer = true;
+    }
+    ssize_t n = getline(&g_line_buf, &g_line_buf_cap, fp);
+    obj_res r;
+    if (n >= 0) {
+        r = io_result_mk_ok(lean_mk_string_from_bytes(g_line_buf, n));
+    } else if (std::ferror(fp)) {
+        r = io_result_mk_error(decode_io_error(errno, nullptr));
+    } else {
+        clearerr(fp);
+        r = io_result_mk_ok(lean_mk_string(""));
+    }
+    if (g_line_buf_cap > LEAN_GET_LINE_MAX_CACHED_BUFFER)
+        finalize_line_buf(nullptr);
+    return r;
+#endif
 }
 
 /* Handle.putStr : (@& Handle) → (@& String) → IO Unit */
@@ -632,6 +928,292 @@ extern "C" LEAN_EXPORT obj_res lean_io_prim_handle_put_str(b_obj_arg h, b_obj_ar
     }
 }
 
+/* Read-only views of whole files, memory mapped if possible (`IO.FS.MappedFile`) */
+
+struct mapped_file {
+    char const * m_data;
+    size_t       m_size;
+    bool         m_is_mmap;
+};
+
+static lean_external_class * g_mapped_file_external_class = nullptr;
+
+static void mapped_file_finalizer(void * p) {
+    mapped_file * m = static_cast<mapped_file *>(p);
+    if (m->m_is_mmap) {
+#if defined(LEAN_WINDOWS)
+        UnmapViewOfFile(m->m_data);
+#else
+        munmap(const_cast<char *>(m->m_data), m->m_size);
+#endif
+    } else {
+        free(const_cast<char *>(m->m_data));
+    }
+    delete m;
+}
+
+static void mapped_file_foreach(void * /* mod */, b_obj_arg /* fn */) {
+}
+
+static mapped_file * mapped_file_get(b_obj_arg m) {
+    return static_cast<mapped_file *>(lean_get_external_data(m));
+}
+
+/* MappedFile.mk : (@& FilePath) → IO MappedFile */
+extern "C" LEAN_EXPORT obj_res lean_io_mapped_file_mk(b_obj_arg fname, obj_arg /* w */) {
+    mapped_file * m = new mapped_file{nullptr, 0, false};
+#if defined(LEAN_WINDOWS)
+    HANDLE h = CreateFile(string_cstr(fname), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    LARGE_INTEGER sz;
+    if (h == INVALID_HANDLE_VALUE || !GetFileSizeEx(h, &sz)) {
+        if (h != INVALID_HANDLE_VALUE) CloseHandle(h);
+        delete m;
+        return io_result_mk_error((sstream() << "failed to open '" << string_cstr(fname) << "': " << GetLastError()).str());
+    }
+    m->m_size = static_cast<size_t>(sz.QuadPart);
+    if (m->m_size > 0) {
+        // the view stays valid after closing both handles
+        HANDLE h_map = CreateFileMapping(h, NULL, PAGE_READONLY, 0, 0, NULL);
+        m->m_data = h_map ? static_cast<char const *>(MapViewOfFile(h_map, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+        if (h_map) CloseHandle(h_map);
+        if (m->m_data == nullptr) {
+            CloseHandle(h);
+            delete m;
+            return io_result_mk_error((sstream() << "failed to map '" << string_cstr(fname) << "': " << GetLastError()).str());
+        }
+        m->m_is_mmap = true;
+    }
+    CloseHandle(h);
+#else
+    int fd = open(string_cstr(fname), O_RDONLY);
+    struct stat st;
+    if (fd == -1 || fstat(fd, &st) != 0) {
+        int err = errno;
+        if (fd != -1) close(fd);
+        delete m;
+        return io_result_mk_error(decode_io_error(err, fname));
+    }
+    m->m_size = st.st_size;
+    if (m->m_size > 0) {
+#ifdef LEAN_MMAP
+        void * data = mmap(nullptr, m->m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            m->m_data = static_cast<char const *>(data);
+            m->m_is_mmap = true;
+        }
+#endif
+        if (!m->m_is_mmap) {
+            // no `mmap` support, read the file instead
+            char * data = static_cast<char *>(malloc(m->m_size));
+            size_t n = 0;
+            while (data && n < m->m_size) {
+                ssize_t r = read(fd, data + n, m->m_size - n);
+                if (r <= 0) break;
+                n += r;
+            }
+            if (!data || n < m->m_size) {
+                int err = errno;
+                free(data);
+                close(fd);
+                delete m;
+                return io_result_mk_error(decode_io_error(err, fname));
+            }
+            m->m_data = data;
+        }
+    }
+    close(fd);
+#endif
+    return io_result_mk_ok(lean_alloc_external(g_mapped_file_external_class, m));
+}
+
+/* MappedFile.size : (@& MappedFile) → Nat */
+extern "C" LEAN_EXPORT obj_res lean_io_mapped_file_size(b_obj_arg m) {
+    return lean_usize_to_nat(mapped_file_get(m)->m_size);
+}
+
+/* MappedFile.get! : (@& MappedFile) → (@& Nat) → UInt8 */
+extern "C" LEAN_EXPORT uint8 lean_io_mapped_file_get(b_obj_arg m, b_obj_arg i) {
+    mapped_file * f = mapped_file_get(m);
+    if (!lean_is_scalar(i) || lean_unbox(i) >= f->m_size) {
+        lean_panic_fn(lean_box(0), lean_mk_ascii_string_unchecked("Error: index out of bounds"));
+        return 0;
+    }
+    return f->m_data[lean_unbox(i)];
+}
+
+/* MappedFile.extract : (@& MappedFile) → (@& Nat) → (@& Nat) → ByteArray */
+extern "C" LEAN_EXPORT obj_res lean_io_mapped_file_extract(b_obj_arg m, b_obj_arg o_start, b_obj_arg o_stop) {
+    mapped_file * f = mapped_file_get(m);
+    size_t stop  = lean_is_scalar(o_stop) ? std::min(lean_unbox(o_stop), f->m_size) : f->m_size;
+    size_t start = lean_is_scalar(o_start) ? std::min(lean_unbox(o_start), stop) : stop;
+    obj_res r    = lean_alloc_sarray(1, stop - start, stop - start);
+    if (stop > start)
+        memcpy(lean_sarray_cptr(r), f->m_data + start, stop - start);
+    return r;
+}
+
+/* MappedFile.advise : (@& MappedFile) → MappedFile.Advice → IO Unit */
+extern "C" LEAN_EXPORT obj_res lean_io_mapped_file_advise(b_obj_arg m, uint8 advice, obj_arg /* w */) {
+#if !defined(LEAN_WINDOWS) && defined(LEAN_MMAP)
+    mapped_file * f = mapped_file_get(m);
+    if (f->m_is_mmap) {
+        static int const advices[] = { MADV_NORMAL, MADV_SEQUENTIAL, MADV_RANDOM, MADV_WILLNEED, MADV_DONTNEED };
+        if (madvise(const_cast<char *>(f->m_data), f->m_size, advices[advice]) != 0)
+            return io_result_mk_error(decode_io_error(errno, nullptr));
+    }
+#else
+    (void)m; (void)advice;
+#endif
+    return io_result_mk_ok(box(0));
+}
+
+/* MappedFile.hash : (@& MappedFile) → UInt64 */
+extern "C" LEAN_EXPORT uint64 lean_io_mapped_file_hash(b_obj_arg m) {
+    mapped_file * f = mapped_file_get(m);
+    // same as `lean_byte_array_hash`
+    return hash_str(f->m_size, reinterpret_cast<unsigned char const *>(f->m_data), 11);
+}
+
+/* hashBinFile : (@& FilePath) → IO UInt64 */
+extern "C" LEAN_EXPORT obj_res lean_io_hash_bin_file(b_obj_arg fname, obj_arg /* w */) {
+    int flags = O_RDONLY;
+#ifdef LEAN_WINDOWS
+    flags |= O_BINARY;
+#endif
+    int fd = open(string_cstr(fname), flags);
+    struct stat st;
+    if (fd == -1 || fstat(fd, &st) != 0) {
+        int err = errno;
+        if (fd != -1) close(fd);
+        return io_result_mk_error(decode_io_error(err, fname));
+    }
+    size_t size = st.st_size;
+    // same as `lean_byte_array_hash` of the contents, which are read in chunks so that a file
+    // truncated or extended while hashing is reported instead of faulting like a mapped file
+    hash_str_fn h(size, 11);
+    size_t const chunk_size = 64 * 1024;
+    std::vector<unsigned char> buf(chunk_size);
+    size_t n = 0;
+    while (true) {
+        size_t len = 0;
+        ssize_t r = 1;
+        // fill the whole chunk, as only the last piece passed to `h` may have a size not divisible by 8
+        while (len < chunk_size && (r = read(fd, buf.data() + len, chunk_size - len)) > 0)
+            len += r;
+        if (r < 0) {
+            int err = errno;
+            close(fd);
+            return io_result_mk_error(decode_io_error(err, fname));
+        }
+        n += len;
+        if (n > size)
+            break;
+        h.add(len, buf.data());
+        if (len < chunk_size)
+            break;
+    }
+    close(fd);
+    if (n != size)
+        return io_result_mk_error((sstream() << "file '" << string_cstr(fname) << "' changed while it was being hashed").str());
+    return io_result_mk_ok(lean_box_uint64(h.finish()));
+}
+
+/* Cells emptied under memory pressure (`IO.CacheCell`) */
+
+struct cache_cell {
+    object *     m_value; // `nullptr` if empty
+    cache_cell * m_prev;
+    cache_cell * m_next;
+};
+
+static lean_external_class * g_cache_cell_external_class = nullptr;
+/* Guards all cells and the list of live cells `g_cache_cells`. Values are released only after
+   unlocking, as their finalizers may access other cells. */
+static mutex * g_cache_cells_mutex = nullptr;
+static cache_cell * g_cache_cells = nullptr;
+
+static void cache_cell_finalizer(void * p) {
+    cache_cell * c = static_cast<cache_cell *>(p);
+    {
+        lock_guard<mutex> lock(*g_cache_cells_mutex);
+        if (c->m_prev) c->m_prev->m_next = c->m_next; else g_cache_cells = c->m_next;
+        if (c->m_next) c->m_next->m_prev = c->m_prev;
+    }
+    if (c->m_value)
+        lean_dec(c->m_value);
+    delete c;
+}
+
+/* Values are marked multi-threaded when stored as they may be released by any thread. */
+static void cache_cell_foreach(void * /* mod */, b_obj_arg /* fn */) {
+}
+
+static cache_cell * cache_cell_get(b_obj_arg c) {
+    return static_cast<cache_cell *>(lean_get_external_data(c));
+}
+
+static object * cache_cell_swap(b_obj_arg c, object * v) {
+    cache_cell * cell = cache_cell_get(c);
+    lock_guard<mutex> lock(*g_cache_cells_mutex);
+    object * old = cell->m_value;
+    cell->m_value = v;
+    return old;
+}
+
+static void clear_cache_cells() {
+    std::vector<object *> values;
+    {
+        lock_guard<mutex> lock(*g_cache_cells_mutex);
+        for (cache_cell * c = g_cache_cells; c; c = c->m_next) {
+            if (c->m_value) {
+                values.push_back(c->m_value);
+                c->m_value = nullptr;
+            }
+        }
+    }
+    for (object * v : values)
+        lean_dec(v);
+}
+
+/* CacheCell.new : BaseIO (CacheCell α) */
+extern "C" LEAN_EXPORT obj_res lean_io_cache_cell_new(obj_arg /* w */) {
+    cache_cell * c = new cache_cell{nullptr, nullptr, nullptr};
+    {
+        lock_guard<mutex> lock(*g_cache_cells_mutex);
+        c->m_next = g_cache_cells;
+        if (g_cache_cells) g_cache_cells->m_prev = c;
+        g_cache_cells = c;
+    }
+    return io_result_mk_ok(lean_alloc_external(g_cache_cell_external_class, c));
+}
+
+/* CacheCell.get? : (@& CacheCell α) → BaseIO (Option α) */
+extern "C" LEAN_EXPORT obj_res lean_io_cache_cell_get(b_obj_arg c, obj_arg /* w */) {
+    cache_cell * cell = cache_cell_get(c);
+    object * v;
+    {
+        lock_guard<mutex> lock(*g_cache_cells_mutex);
+        v = cell->m_value;
+        if (v) lean_inc(v);
+    }
+    return io_result_mk_ok(v ? mk_option_some(v) : mk_option_none());
+}
+
+/* CacheCell.set : (@& CacheCell α) → α → BaseIO Unit */
+extern "C" LEAN_EXPORT obj_res lean_io_cache_cell_set(b_obj_arg c, obj_arg v, obj_arg /* w */) {
+    lean_mark_mt(v);
+    if (object * old = cache_cell_swap(c, v))
+        lean_dec(old);
+    return io_result_mk_ok(box(0));
+}
+
+/* CacheCell.clear : (@& CacheCell α) → BaseIO Unit */
+extern "C" LEAN_EXPORT obj_res lean_io_cache_cell_clear(b_obj_arg c, obj_arg /* w */) {
+    if (object * old = cache_cell_swap(c, nullptr))
+        lean_dec(old);
+    return io_result_mk_ok(box(0));
+}
+
 /* Std.Time.Timestamp.now : IO Timestamp */
 extern "C" LEAN_EXPORT obj_res lean_get_current_time(obj_arg /* w */) {
     using namespace std::chrono;
@@ -818,22 +1400,19 @@ extern "C" LEAN_EXPORT obj_res lean_io_mono_nanos_now(obj_arg /* w */) {
     return io_result_mk_ok(uint64_to_nat(tm.count()));
 }
 
-/* getRandomBytes (nBytes : USize) : IO ByteArray */
-extern "C" LEAN_EXPORT obj_res lean_io_get_random_bytes (size_t nbytes, obj_arg /* w */) {
+/* Fill `dst` with `nbytes` bytes from the operating system's random source.
+   Returns `nullptr` on success and an `IO.Error` otherwise. */
+static obj_res os_random_bytes(uint8_t * dst, size_t nbytes) {
     // Adapted from https://github.com/rust-random/getrandom/blob/30308ae845b0bf3839e5a92120559eaf56048c28/src/
 
-    if (nbytes == 0) return io_result_mk_ok(lean_alloc_sarray(1, 0, 0));
-
 #if !defined(LEAN_WINDOWS)
     int fd_urandom = open("/dev/urandom", O_RDONLY | O_CLOEXEC);
     if (fd_urandom < 0) {
-        return io_result_mk_error(decode_io_error(errno, lean_mk_ascii_string_unchecked("/dev/urandom")));
+        return decode_io_error(errno, lean_mk_ascii_string_unchecked("/dev/urandom"));
     }
 #endif
 
-    obj_res res = lean_alloc_sarray(1, 0, nbytes);
     size_t remain = nbytes;
-    uint8_t *dst = lean_sarray_cptr(res);
 
     while (remain > 0) {
 #if defined(LEAN_WINDOWS)
@@ -846,8 +1425,7 @@ extern "C" LEAN_EXPORT obj_res lean_io_get_random_bytes (size_t nbytes, obj_arg
             BCRYPT_USE_SYSTEM_PREFERRED_RNG
         );
         if (!NT_SUCCESS(status)) {
-            dec_ref(res);
-            return io_result_mk_error("BCryptGenRandom failed");
+            return lean_mk_io_user_error(mk_ascii_string_unchecked("BCryptGenRandom failed"));
         }
         remain -= read_sz;
         dst += read_sz;
@@ -861,9 +1439,9 @@ extern "C" LEAN_EXPORT obj_res lean_io_get_random_bytes (size_t nbytes, obj_arg
         ssize_t nread = read(fd_urandom, dst, read_sz);
         if (nread < 0) {
             if (errno != EINTR) {
+                int err = errno;
                 close(fd_urandom);
-                dec_ref(res);
-                return io_result_mk_error(decode_io_error(errno, nullptr));
+                return decode_io_error(err, nullptr);
             }
         } else {
             remain -= nread;
@@ -875,6 +1453,126 @@ extern "C" LEAN_EXPORT obj_res lean_io_get_random_bytes (size_t nbytes, obj_arg
 #if !defined(LEAN_WINDOWS)
     close(fd_urandom);
 #endif
+    return nullptr;
+}
+
+/*
+  Small requests are served from a per-thread ChaCha20 generator (RFC 8439) instead of going to the
+  operating system every time. The generator uses "fast key erasure": every refill of the output
+  buffer replaces the key by the first block of that refill, and bytes are wiped from the buffer as
+  they are handed out, so that compromising the state does not reveal earlier outputs. It is
+  reseeded from the operating system after `LEAN_RANDOM_RESEED_INTERVAL` bytes, and in child
+  processes after `fork`.
+*/
+#define LEAN_RANDOM_SMALL_REQUEST 256
+#define LEAN_RANDOM_BUFFER_SIZE 1024
+#define LEAN_RANDOM_RESEED_INTERVAL 1024*1024
+
+static std::atomic<unsigned> g_random_fork_generation(0);
+
+static void secure_zero(void * p, size_t n) {
+    volatile uint8_t * v = static_cast<volatile uint8_t *>(p);
+    while (n--) *v++ = 0;
+}
+
+static inline uint32_t chacha_rotl(uint32_t v, int c) { return (v << c) | (v >> (32 - c)); }
+
+#define LEAN_CHACHA_QUARTERROUND(a, b, c, d)              \
+    a += b; d ^= a; d = chacha_rotl(d, 16);               \
+    c += d; b ^= c; b = chacha_rotl(b, 12);               \
+    a += b; d ^= a; d = chacha_rotl(d, 8);                \
+    c += d; b ^= c; b = chacha_rotl(b, 7);
+
+static void chacha20_block(uint32_t const key[8], uint32_t counter, uint8_t out[64]) {
+    uint32_t in[16] = { 0x61707865, 0x3320646e, 0x79622d32, 0x6b206574,
+                        key[0], key[1], key[2], key[3], key[4], key[5], key[6], key[7],
+                        counter, 0, 0, 0 };
+    uint32_t x[16];
+    memcpy(x, in, sizeof(x));
+    for (int i = 0; i < 10; i++) {
+        LEAN_CHACHA_QUARTERROUND(x[0], x[4], x[8],  x[12]);
+        LEAN_CHACHA_QUARTERROUND(x[1], x[5], x[9],  x[13]);
+        LEAN_CHACHA_QUARTERROUND(x[2], x[6], x[10], x[14]);
+        LEAN_CHACHA_QUARTERROUND(x[3], x[7], x[11], x[15]);
+        LEAN_CHACHA_QUARTERROUND(x[0], x[5], x[10], x[15]);
+        LEAN_CHACHA_QUARTERROUND(x[1], x[6], x[11], x[12]);
+        LEAN_CHACHA_QUARTERROUND(x[2], x[7], x[8],  x[13]);
+        LEAN_CHACHA_QUARTERROUND(x[3], x[4], x[9],  x[14]);
+    }
+    for (int i = 0; i < 16; i++) {
+        uint32_t v = x[i] + in[i];
+        out[4*i]     = static_cast<uint8_t>(v);
+        out[4*i + 1] = static_cast<uint8_t>(v >> 8);
+        out[4*i + 2] = static_cast<uint8_t>(v >> 16);
+        out[4*i + 3] = static_cast<uint8_t>(v >> 24);
+    }
+    secure_zero(x, sizeof(x));
+}
+
+struct random_state {
+    uint32_t m_key[8];
+    uint8_t  m_buf[LEAN_RANDOM_BUFFER_SIZE];
+    size_t   m_pos = LEAN_RANDOM_BUFFER_SIZE;      // Position of the next unused byte of `m_buf`.
+    size_t   m_since_reseed = 0;
+    bool     m_seeded = false;
+    unsigned m_fork_generation = 0;
+    ~random_state() { secure_zero(this, sizeof(random_state)); }
+
+    obj_res reseed() {
+        if (obj_res err = os_random_bytes(reinterpret_cast<uint8_t *>(m_key), sizeof(m_key)))
+            return err;
+        m_seeded = true;
+        m_fork_generation = g_random_fork_generation.load(std::memory_order_relaxed);
+        m_since_reseed = 0;
+        secure_zero(m_buf, sizeof(m_buf));
+        m_pos = LEAN_RANDOM_BUFFER_SIZE;
+        return nullptr;
+    }
+
+    void refill() {
+        static_assert(LEAN_RANDOM_BUFFER_SIZE % 64 == 0, "random buffer must consist of full blocks");
+        for (uint32_t i = 0; i < LEAN_RANDOM_BUFFER_SIZE / 64; i++)
+            chacha20_block(m_key, i, m_buf + 64 * i);
+        memcpy(m_key, m_buf, sizeof(m_key));
+        secure_zero(m_buf, sizeof(m_key));
+        m_pos = sizeof(m_key);
+    }
+
+    obj_res fill(uint8_t * dst, size_t nbytes) {
+        if (!m_seeded || m_since_reseed >= LEAN_RANDOM_RESEED_INTERVAL ||
+            m_fork_generation != g_random_fork_generation.load(std::memory_order_relaxed)) {
+            if (obj_res err = reseed())
+                return err;
+        }
+        m_since_reseed += nbytes;
+        while (nbytes > 0) {
+            if (m_pos == LEAN_RANDOM_BUFFER_SIZE)
+                refill();
+            size_t n = std::min(nbytes, static_cast<size_t>(LEAN_RANDOM_BUFFER_SIZE) - m_pos);
+            memcpy(dst, m_buf + m_pos, n);
+            secure_zero(m_buf + m_pos, n);
+            m_pos += n;
+            dst += n;
+            nbytes -= n;
+        }
+        return nullptr;
+    }
+};
+
+MK_THREAD_LOCAL_GET_DEF(random_state, get_random_state);
+
+/* getRandomBytes (nBytes : USize) : IO ByteArray */
+extern "C" LEAN_EXPORT obj_res lean_io_get_random_bytes (size_t nbytes, obj_arg /* w */) {
+    if (nbytes == 0) return io_result_mk_ok(lean_alloc_sarray(1, 0, 0));
+
+    obj_res res = lean_alloc_sarray(1, 0, nbytes);
+    obj_res err = nbytes <= LEAN_RANDOM_SMALL_REQUEST
+        ? get_random_state().fill(lean_sarray_cptr(res), nbytes)
+        : os_random_bytes(lean_sarray_cptr(res), nbytes);
+    if (err) {
+        dec_ref(res);
+        return io_result_mk_error(err);
+    }
     lean_sarray_set_size(res, nbytes);
     return io_result_mk_ok(res);
 }
@@ -908,11 +1606,57 @@ extern "C" LEAN_EXPORT obj_res lean_io_allocprof(b_obj_arg msg, obj_arg fn, obj_
     return res;
 }
 
+/* startAllocSampling (period : USize) : BaseIO Unit */
+extern "C" LEAN_EXPORT obj_res lean_io_start_alloc_sampling(size_t period, obj_arg /* w */) {
+    start_alloc_sampling(period);
+    return io_result_mk_ok(box(0));
+}
+
+/* stopAllocSampling : BaseIO Unit */
+extern "C" LEAN_EXPORT obj_res lean_io_stop_alloc_sampling(obj_arg /* w */) {
+    stop_alloc_sampling();
+    return io_result_mk_ok(box(0));
+}
+
+/* writeAllocProfile (fname : @& FilePath) : IO Unit */
+extern "C" LEAN_EXPORT obj_res lean_io_write_alloc_profile(b_obj_arg fname, obj_arg /* w */) {
+    std::ofstream out(string_cstr(fname), std::ios::binary);
+    if (!out) {
+        return io_result_mk_error(decode_io_error(errno, fname));
+    }
+    write_alloc_profile(out);
+    return io_result_mk_ok(box(0));
+}
+
 /* getNumHeartbeats : BaseIO Nat */
 extern "C" LEAN_EXPORT obj_res lean_io_get_num_heartbeats(obj_arg /* w */) {
     return io_result_mk_ok(lean_uint64_to_nat(get_num_heartbeats()));
 }
 
+/* getAllocStats : BaseIO AllocStats */
+extern "C" LEAN_EXPORT obj_res lean_io_get_alloc_stats(obj_arg /* w */) {
+    alloc_info info;
+    get_alloc_info(info);
+    object * classes = lean_alloc_array(0, info.m_slots.size());
+    for (alloc_slot_info const & slot : info.m_slots) {
+        if (slot.m_num_pages == 0)
+            continue;
+        object * c = alloc_cnstr(0, 4, 0);
+        cnstr_set(c, 0, lean_usize_to_nat(slot.m_obj_size));
+        cnstr_set(c, 1, lean_uint64_to_nat(slot.m_num_pages));
+        cnstr_set(c, 2, lean_uint64_to_nat(slot.m_num_objs - slot.m_num_free));
+        cnstr_set(c, 3, lean_uint64_to_nat(slot.m_num_objs));
+        classes = lean_array_push(classes, c);
+    }
+    object * r = alloc_cnstr(0, 5, 0);
+    cnstr_set(r, 0, lean_uint64_to_nat(info.m_num_heaps));
+    cnstr_set(r, 1, lean_uint64_to_nat(info.m_num_segments));
+    cnstr_set(r, 2, lean_uint64_to_nat(info.m_num_released));
+    cnstr_set(r, 3, lean_uint64_to_nat(info.m_num_remote_frees));
+    cnstr_set(r, 4, classes);
+    return io_result_mk_ok(r);
+}
+
 /* setHeartbeats (count : Nat) : BaseIO Unit */
 extern "C" LEAN_EXPORT obj_res lean_io_set_heartbeats(obj_arg count, obj_arg /* w */) {
     set_heartbeats(lean_uint64_of_nat(count));
@@ -1012,6 +1756,78 @@ extern "C" LEAN_EXPORT obj_res lean_io_read_dir(b_obj_arg dirname, obj_arg) {
     return io_result_mk_ok(arr);
 }
 
+static uint8 st_mode_to_file_type(unsigned mode) {
+    return S_ISDIR(mode) ? 0 :
+           S_ISREG(mode) ? 1 :
+#ifndef LEAN_WINDOWS
+           S_ISLNK(mode) ? 2 :
+#endif
+           3;
+}
+
+/* Determine the `FileType` of `entry` of the open directory `dp` without following symbolic links.
+   The type reported by `readdir` is used when available, so that `stat` is only needed on file
+   systems that do not report it. Returns `false` and sets `errno` if the type cannot be determined. */
+static bool dir_entry_file_type(DIR * dp, b_obj_arg dirname, dirent * entry, uint8 & type) {
+#if defined(DT_UNKNOWN) && !defined(LEAN_WINDOWS)
+    switch (entry->d_type) {
+    case DT_DIR: type = 0; return true;
+    case DT_REG: type = 1; return true;
+    case DT_LNK: type = 2; return true;
+    case DT_UNKNOWN: break;
+    default: type = 3; return true;
+    }
+    struct stat st;
+    if (fstatat(dirfd(dp), entry->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+        return false;
+#else
+    (void)dp;
+    std::string path = std::string(string_cstr(dirname)) + "/" + entry->d_name;
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0)
+        return false;
+#endif
+    type = st_mode_to_file_type(st.st_mode);
+    return true;
+}
+
+/*
+constant readDirWithType : @& FilePath → IO (Array (DirEntry × FileType))
+*/
+extern "C" LEAN_EXPORT obj_res lean_io_read_dir_with_type(b_obj_arg dirname, obj_arg) {
+    object * arr = array_mk_empty();
+    DIR * dp = opendir(string_cstr(dirname));
+    if (!dp) {
+        return io_result_mk_error(decode_io_error(errno, dirname));
+    }
+    while (dirent * entry = readdir(dp)) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+        uint8 type;
+        if (!dir_entry_file_type(dp, dirname, entry, type)) {
+            if (errno == ENOENT) {
+                // entry vanished since `readdir`
+                continue;
+            }
+            int err = errno;
+            lean_always_assert(closedir(dp) == 0);
+            dec_ref(arr);
+            return io_result_mk_error(decode_io_error(err, dirname));
+        }
+        object * lentry = alloc_cnstr(0, 2, 0);
+        lean_inc(dirname);
+        cnstr_set(lentry, 0, dirname);
+        cnstr_set(lentry, 1, lean_mk_string(entry->d_name));
+        object * pair = alloc_cnstr(0, 2, 0);
+        cnstr_set(pair, 0, lentry);
+        cnstr_set(pair, 1, box(type));
+        arr = lean_array_push(arr, pair);
+    }
+    lean_always_assert(closedir(dp) == 0);
+    return io_result_mk_ok(arr);
+}
+
 /*
 inductive FileType where
   | dir
@@ -1057,13 +1873,7 @@ extern "C" LEAN_EXPORT obj_res lean_io_metadata(b_obj_arg fname, obj_arg) {
     cnstr_set(mdata, 1, timespec_to_obj(st.st_mtim));
 #endif
     cnstr_set_uint64(mdata, 2 * sizeof(object *), st.st_size);
-    cnstr_set_uint8(mdata, 2 * sizeof(object *) + sizeof(uint64),
-                    S_ISDIR(st.st_mode) ? 0 :
-                    S_ISREG(st.st_mode) ? 1 :
-#ifndef LEAN_WINDOWS
-                    S_ISLNK(st.st_mode) ? 2 :
-#endif
-                    3);
+    cnstr_set_uint8(mdata, 2 * sizeof(object *) + sizeof(uint64), st_mode_to_file_type(st.st_mode));
     return io_result_mk_ok(mdata);
 }
 
@@ -1287,6 +2097,54 @@ static inline atomic<object*> * mt_ref_val_addr(object * o) {
     return reinterpret_cast<atomic<object*> *>(&(lean_to_ref(o)->m_value));
 }
 
+/*
+  While a thread holds the value of a multi-threaded ref (in `get`, or between `take` and `set` in
+  `modify`), the slot contains `nullptr` and other threads have to wait for it. They spin for
+  `LEAN_REF_SPIN_LIMIT` rounds and then park on a bucket of `g_ref_parking_lot`, which is chosen by
+  the address of the slot. Threads storing a value into a slot wake up the bucket if it has
+  waiters. `g_ref_spins` and `g_ref_parks` count how often this happens.
+*/
+#define LEAN_REF_SPIN_LIMIT 128
+#define LEAN_REF_PARKING_BUCKETS 64
+
+struct ref_parking_bucket {
+    mutex              m_mutex;
+    condition_variable m_cv;
+    atomic<unsigned>   m_waiters{0};
+};
+
+static ref_parking_bucket * g_ref_parking_lot = nullptr;
+static atomic<uint64> g_ref_spins(0);
+static atomic<uint64> g_ref_parks(0);
+
+static inline ref_parking_bucket & ref_parking_bucket_of(atomic<object*> * val_addr) {
+    return g_ref_parking_lot[(reinterpret_cast<uintptr_t>(val_addr) / sizeof(lean_ref_object)) % LEAN_REF_PARKING_BUCKETS];
+}
+
+/* Called when `*val_addr` was found to be `nullptr`. `spins` is the number of rounds so far. */
+static void ref_wait(atomic<object*> * val_addr, unsigned & spins) {
+    g_ref_spins.fetch_add(1, memory_order_relaxed);
+    if (++spins < LEAN_REF_SPIN_LIMIT)
+        return;
+    spins = 0;
+    g_ref_parks.fetch_add(1, memory_order_relaxed);
+    ref_parking_bucket & b = ref_parking_bucket_of(val_addr);
+    unique_lock<mutex> lock(b.m_mutex);
+    b.m_waiters.fetch_add(1);
+    while (val_addr->load() == nullptr)
+        b.m_cv.wait(lock);
+    b.m_waiters.fetch_sub(1);
+}
+
+/* Must be called after storing a value that is not `nullptr` into `*val_addr`. */
+static inline void ref_notify(atomic<object*> * val_addr) {
+    ref_parking_bucket & b = ref_parking_bucket_of(val_addr);
+    if (b.m_waiters.load() > 0) {
+        lock_guard<mutex> lock(b.m_mutex);
+        b.m_cv.notify_all();
+    }
+}
+
 /*
   Important: we have added support for initializing global constants
   at program startup. This feature is particularly useful for
@@ -1303,6 +2161,7 @@ static inline bool ref_maybe_mt(b_obj_arg ref) { return lean_is_mt(ref) || lean_
 extern "C" LEAN_EXPORT obj_res lean_st_ref_get(b_obj_arg ref, obj_arg) {
     if (ref_maybe_mt(ref)) {
         atomic<object *> * val_addr = mt_ref_val_addr(ref);
+        unsigned spins = 0;
         while (true) {
             /*
               We cannot simply read `val` from the ref and `inc` it like in the `else` branch since someone else could
@@ -1312,12 +2171,14 @@ extern "C" LEAN_EXPORT obj_res lean_st_ref_get(b_obj_arg ref, obj_arg) {
             if (val != nullptr) {
                 inc(val);
                 object * tmp = val_addr->exchange(val);
+                ref_notify(val_addr);
                 if (tmp != nullptr) {
                     /* this may happen if another thread wrote `ref` */
                     dec(tmp);
                 }
                 return io_result_mk_ok(val);
             }
+            ref_wait(val_addr, spins);
         }
     } else {
         object * val = lean_to_ref(ref)->m_value;
@@ -1330,10 +2191,12 @@ extern "C" LEAN_EXPORT obj_res lean_st_ref_get(b_obj_arg ref, obj_arg) {
 extern "C" LEAN_EXPORT obj_res lean_st_ref_take(b_obj_arg ref, obj_arg) {
     if (ref_maybe_mt(ref)) {
         atomic<object *> * val_addr = mt_ref_val_addr(ref);
+        unsigned spins = 0;
         while (true) {
             object * val = val_addr->exchange(nullptr);
             if (val != nullptr)
                 return io_result_mk_ok(val);
+            ref_wait(val_addr, spins);
         }
     } else {
         object * val = lean_to_ref(ref)->m_value;
@@ -1353,6 +2216,7 @@ extern "C" LEAN_EXPORT obj_res lean_st_ref_set(b_obj_arg ref, obj_arg a, obj_arg
         mark_mt(a);
         atomic<object *> * val_addr = mt_ref_val_addr(ref);
         object * old_a = val_addr->exchange(a);
+        ref_notify(val_addr);
         if (old_a != nullptr)
             dec(old_a);
         return io_result_mk_ok(box(0));
@@ -1369,10 +2233,16 @@ extern "C" LEAN_EXPORT obj_res lean_st_ref_swap(b_obj_arg ref, obj_arg a, obj_ar
         /* See io_ref_write */
         mark_mt(a);
         atomic<object *> * val_addr = mt_ref_val_addr(ref);
+        unsigned spins = 0;
         while (true) {
-            object * old_a = val_addr->exchange(a);
-            if (old_a != nullptr)
+            /* Only replace a value that is present, storing into an empty slot would hand `a` to the
+               thread currently holding the value, which then releases it when putting its value back. */
+            object * old_a = val_addr->load();
+            if (old_a == nullptr) {
+                ref_wait(val_addr, spins);
+            } else if (val_addr->compare_exchange_weak(old_a, a)) {
                 return io_result_mk_ok(old_a);
+            }
         }
     } else {
         object * old_a = lean_to_ref(ref)->m_value;
@@ -1383,6 +2253,48 @@ extern "C" LEAN_EXPORT obj_res lean_st_ref_swap(b_obj_arg ref, obj_arg a, obj_ar
     }
 }
 
+/* Ref.compareAndSwap {σ α} (r : @& Ref σ α) (expected : @& α) (new : α) : ST σ Bool */
+extern "C" LEAN_EXPORT obj_res lean_st_ref_compare_and_swap(b_obj_arg ref, b_obj_arg expected, obj_arg a, obj_arg) {
+    if (ref_maybe_mt(ref)) {
+        /* See io_ref_write */
+        mark_mt(a);
+        atomic<object *> * val_addr = mt_ref_val_addr(ref);
+        unsigned spins = 0;
+        while (true) {
+            object * cur = expected;
+            if (val_addr->compare_exchange_weak(cur, a)) {
+                /* We replaced the RC token of `expected` held by the ref. */
+                dec(expected);
+                return io_result_mk_ok(box(true));
+            }
+            /* `nullptr` means another thread is holding the value, wait for it like `get` does. */
+            if (cur == nullptr) {
+                ref_wait(val_addr, spins);
+            } else if (cur != expected) {
+                dec(a);
+                return io_result_mk_ok(box(false));
+            }
+        }
+    } else {
+        object * cur = lean_to_ref(ref)->m_value;
+        if (cur != expected) {
+            dec(a);
+            return io_result_mk_ok(box(false));
+        }
+        dec(cur);
+        lean_to_ref(ref)->m_value = a;
+        return io_result_mk_ok(box(true));
+    }
+}
+
+/* getRefContention : BaseIO (Nat × Nat) */
+extern "C" LEAN_EXPORT obj_res lean_io_get_ref_contention(obj_arg /* w */) {
+    object * r = alloc_cnstr(0, 2, 0);
+    cnstr_set(r, 0, lean_uint64_to_nat(g_ref_spins.load(memory_order_relaxed)));
+    cnstr_set(r, 1, lean_uint64_to_nat(g_ref_parks.load(memory_order_relaxed)));
+    return io_result_mk_ok(r);
+}
+
 extern "C" LEAN_EXPORT obj_res lean_st_ref_ptr_eq(b_obj_arg ref1, b_obj_arg ref2, obj_arg) {
     // TODO(Leo): ref_maybe_mt
     bool r = lean_to_ref(ref1)->m_value == lean_to_ref(ref2)->m_value;
@@ -1461,6 +2373,8 @@ extern "C" LEAN_EXPORT obj_res lean_runtime_mark_multi_threaded(obj_arg a, obj_a
 }
 
 extern "C" LEAN_EXPORT obj_res lean_runtime_mark_persistent(obj_arg a, obj_arg /* w */) {
+    // persistent objects are never freed, and so must not be released with the current region
+    a = copy_out_of_active_region(a);
     lean_mark_persistent(a);
     return io_result_mk_ok(a);
 }
@@ -1486,7 +2400,12 @@ extern "C" LEAN_EXPORT obj_res lean_option_get_or_block(obj_arg o_opt) {
 void initialize_io() {
     g_io_error_nullptr_read = lean_mk_io_user_error(mk_ascii_string_unchecked("null reference read"));
     mark_persistent(g_io_error_nullptr_read);
+    g_ref_parking_lot = new ref_parking_bucket[LEAN_REF_PARKING_BUCKETS];
     g_io_handle_external_class = lean_register_external_class(io_handle_finalizer, io_handle_foreach);
+    g_mapped_file_external_class = lean_register_external_class(mapped_file_finalizer, mapped_file_foreach);
+    g_cache_cell_external_class = lean_register_external_class(cache_cell_finalizer, cache_cell_foreach);
+    g_cache_cells_mutex = new mutex();
+    register_memory_pressure_fn(clear_cache_cells);
 #if defined(LEAN_WINDOWS)
     _setmode(_fileno(stdout), _O_BINARY);
     _setmode(_fileno(stderr), _O_BINARY);
@@ -1502,6 +2421,10 @@ void initialize_io() {
     // We want to handle SIGPIPE ourselves
     lean_always_assert(signal(SIGPIPE, SIG_IGN) != SIG_ERR);
 #endif
+#if !defined(LEAN_WINDOWS)
+    // Make child processes reseed their random generators instead of repeating the parent's output
+    lean_always_assert(pthread_atfork(nullptr, nullptr, []() { g_random_fork_generation++; }) == 0);
+#endif
 }
 
 void finalize_io() {
@@ -15,9 +15,16 @@ namespace lean {
 
 extern "C" void initialize_libuv() {
     initialize_libuv_timer();
+    initialize_libuv_writer();
+    initialize_libuv_tcp_socket();
+    initialize_libuv_udp_socket();
+    initialize_libuv_dns();
     initialize_libuv_loop();
 
-    lthread([]() { event_loop_run_loop(&global_ev); });
+    for (unsigned i = 0; i < g_num_event_loops; i++) {
+        event_loop_t * event_loop = g_event_loops[i];
+        lthread([event_loop]() { event_loop_run_loop(event_loop); });
+    }
 }
 
 /* Lean.libUVVersionFn : Unit → Nat */
@@ -8,6 +8,12 @@ Author: Markus Himmel, Sofia Rodrigues
 #include <lean/lean.h>
 #include "runtime/uv/event_loop.h"
 #include "runtime/uv/timer.h"
+#include "runtime/uv/timer_wheel.h"
+#include "runtime/uv/fs.h"
+#include "runtime/uv/writer.h"
+#include "runtime/uv/tcp.h"
+#include "runtime/uv/udp.h"
+#include "runtime/uv/dns.h"
 #include "runtime/alloc.h"
 #include "runtime/io.h"
 #include "runtime/utf8.h"
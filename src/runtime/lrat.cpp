@@ -0,0 +1,347 @@
+/*
+Copyright (c) 2025 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+*/
+#include <string>
+#include <vector>
+#include "runtime/object.h"
+
+/*
+Native implementation of `Std.Tactic.BVDecide.LRAT.parseLRATProof`, which accepts the same binary
+and non-binary LRAT formats as the parser in `Std/Tactic/BVDecide/LRAT/Parser.lean`.
+
+The proof is first parsed into flat arrays of literals and ids that grow geometrically, and the
+`Array IntAction` is only built once the whole input has been accepted, so that parsing neither
+allocates Lean objects per number nor has to free partial results on errors.
+*/
+
+namespace lean {
+
+class lrat_parser {
+    enum class kind { add, del };
+    struct step {
+        kind     m_kind;
+        uint64_t m_id;
+        // ranges in `m_lits`, `m_ids` and `m_rat_hints`
+        size_t   m_clause_begin, m_clause_end;
+        size_t   m_hints_begin, m_hints_end;
+        size_t   m_rat_begin, m_rat_end;
+    };
+    struct rat_hint {
+        uint64_t m_pivot;
+        size_t   m_hints_begin, m_hints_end;
+    };
+
+    uint8_t const *       m_begin;
+    uint8_t const *       m_it;
+    uint8_t const *       m_end;
+    std::vector<step>     m_steps;
+    std::vector<int64_t>  m_lits;
+    std::vector<uint64_t> m_ids;
+    std::vector<rat_hint> m_rat_hints;
+    std::string           m_error;
+    size_t                m_error_pos = 0;
+
+    bool fail(std::string const & msg) {
+        if (m_error.empty()) {
+            m_error     = msg;
+            m_error_pos = m_it - m_begin;
+        }
+        return false;
+    }
+    bool at_end() const { return m_it == m_end; }
+    bool expect(uint8_t b) {
+        if (at_end())
+            return fail("unexpected end of input");
+        if (*m_it != b)
+            return fail("expected: '" + std::to_string(b) + "'");
+        m_it++;
+        return true;
+    }
+    bool peek(uint8_t & b) {
+        if (at_end())
+            return fail("unexpected end of input");
+        b = *m_it;
+        return true;
+    }
+
+    bool push_step(step const & s) {
+        if (s.m_kind == kind::add && s.m_clause_begin == s.m_clause_end && s.m_rat_begin != s.m_rat_end)
+            return fail("There cannot be any ratHints for adding the empty clause");
+        m_steps.push_back(s);
+        return true;
+    }
+
+    // Non-binary format
+
+    /* A positive decimal number, like `Text.parsePos`. */
+    bool text_pos(uint64_t & r) {
+        if (at_end() || *m_it < '0' || *m_it > '9')
+            return fail(at_end() ? "unexpected end of input" : "digit expected");
+        r = 0;
+        while (!at_end() && *m_it >= '0' && *m_it <= '9') {
+            uint64_t d = *m_it - '0';
+            if (r > (UINT64_MAX - d) / 10)
+                return fail("number too large");
+            r = 10 * r + d;
+            m_it++;
+        }
+        return r != 0 || fail("id was 0");
+    }
+    /* Try to parse `lit ' '` where `lit` is a nonzero, optionally negated, number. On failure, the
+       position is restored as `attempt` would do. */
+    bool try_text_lit_ws(bool allow_pos, bool allow_neg, int64_t & lit) {
+        uint8_t const * start = m_it;
+        bool neg = !at_end() && *m_it == '-';
+        if (neg ? !allow_neg : !allow_pos) return false;
+        if (neg) m_it++;
+        if (at_end() || *m_it < '0' || *m_it > '9') { m_it = start; return false; }
+        uint64_t n = 0;
+        while (!at_end() && *m_it >= '0' && *m_it <= '9') {
+            uint64_t d = *m_it - '0';
+            if (n > (static_cast<uint64_t>(INT64_MAX) - d) / 10)
+                return fail("number too large");
+            n = 10 * n + d;
+            m_it++;
+        }
+        if (n == 0 || at_end() || *m_it != ' ') { m_it = start; return false; }
+        m_it++;
+        lit = neg ? -static_cast<int64_t>(n) : static_cast<int64_t>(n);
+        return true;
+    }
+    /* `Text.parseIdList`, which always succeeds unless a number overflows. */
+    bool text_id_list() {
+        int64_t id;
+        while (try_text_lit_ws(true, false, id))
+            m_ids.push_back(id);
+        return m_error.empty();
+    }
+    bool text_newline() {
+        if (!at_end() && *m_it == '\n') { m_it++; return true; }
+        if (!at_end() && *m_it == '\r') { m_it++; return expect('\n'); }
+        return fail(at_end() ? "unexpected end of input" : "expected: '10'");
+    }
+    bool text_action() {
+        step s;
+        if (!text_pos(s.m_id) || !expect(' ')) return false;
+        s.m_clause_begin = s.m_clause_end = m_lits.size();
+        s.m_rat_begin = s.m_rat_end = m_rat_hints.size();
+        if (!at_end() && *m_it == 'd') {
+            m_it++;
+            s.m_kind = kind::del;
+            s.m_hints_begin = m_ids.size();
+            if (!expect(' ') || !text_id_list() || !expect('0')) return false;
+            s.m_hints_end = m_ids.size();
+        } else {
+            s.m_kind = kind::add;
+            int64_t lit;
+            while (try_text_lit_ws(true, true, lit))
+                m_lits.push_back(lit);
+            s.m_clause_end = m_lits.size();
+            s.m_hints_begin = m_ids.size();
+            if (!m_error.empty() || !expect('0') || !expect(' ') || !text_id_list()) return false;
+            s.m_hints_end = m_ids.size();
+            int64_t pivot;
+            while (try_text_lit_ws(false, true, pivot)) {
+                rat_hint h;
+                h.m_pivot = -pivot;
+                h.m_hints_begin = m_ids.size();
+                if (!text_id_list()) return false;
+                h.m_hints_end = m_ids.size();
+                m_rat_hints.push_back(h);
+            }
+            s.m_rat_end = m_rat_hints.size();
+            if (!m_error.empty() || !expect('0')) return false;
+        }
+        return push_step(s);
+    }
+    /* `Text.parseActions` */
+    bool text_actions() {
+        while (true) {
+            uint8_t b;
+            if (!peek(b)) return false;
+            if (b == 'c') {
+                while (!at_end() && *m_it != '\n' && *m_it != '\r')
+                    m_it++;
+            } else if (!text_action()) {
+                return false;
+            }
+            if (!text_newline()) return false;
+            if (at_end()) return true;
+        }
+    }
+
+    // Binary format
+
+    /* A variable-length encoded literal, like `Binary.parseLit`. */
+    bool binary_lit(int64_t & lit) {
+        uint64_t uidx = 0;
+        for (unsigned shift = 0;; shift += 7) {
+            if (at_end())
+                return fail("unexpected end of input");
+            uint8_t uch = *m_it++;
+            if (shift == 28 && (uch & ~15) != 0)
+                return fail("Excessive literal");
+            if (uch == 0)
+                return fail("Invalid zero byte in literal");
+            uidx |= static_cast<uint64_t>(uch & 127) << shift;
+            if ((uch & 128) == 0) {
+                int64_t idx = uidx >> 1;
+                lit = (uidx & 1) ? -idx : idx;
+                return true;
+            }
+        }
+    }
+    bool binary_pos(uint64_t & r) {
+        int64_t lit;
+        if (!binary_lit(lit)) return false;
+        if (lit <= 0) return fail("parsed non positive lit where positive was expected");
+        r = lit;
+        return true;
+    }
+    /* `Binary.parseIdList`: ids up to the next negative literal or zero byte. */
+    bool binary_id_list() {
+        uint8_t b;
+        while (peek(b) && (b & 1) == 0 && b != 0) {
+            uint64_t id;
+            if (!binary_pos(id)) return false;
+            m_ids.push_back(id);
+        }
+        return m_error.empty();
+    }
+    bool binary_action() {
+        step s;
+        uint8_t discr = *m_it++;
+        s.m_id = 0;
+        s.m_clause_begin = s.m_clause_end = m_lits.size();
+        s.m_rat_begin = s.m_rat_end = m_rat_hints.size();
+        if (discr == 'a') {
+            s.m_kind = kind::add;
+            if (!binary_pos(s.m_id)) return false;
+            uint8_t b;
+            while (peek(b) && b != 0) {
+                int64_t lit;
+                if (!binary_lit(lit)) return false;
+                m_lits.push_back(lit);
+            }
+            s.m_clause_end = m_lits.size();
+            s.m_hints_begin = m_ids.size();
+            if (!m_error.empty() || !expect(0) || !binary_id_list()) return false;
+            s.m_hints_end = m_ids.size();
+            while (peek(b) && b != 0) {
+                int64_t lit;
+                if (!binary_lit(lit)) return false;
+                if (lit >= 0) return fail("parsed non negative lit where negative was expected");
+                rat_hint h;
+                h.m_pivot = -lit;
+                h.m_hints_begin = m_ids.size();
+                if (!binary_id_list()) return false;
+                h.m_hints_end = m_ids.size();
+                m_rat_hints.push_back(h);
+            }
+            s.m_rat_end = m_rat_hints.size();
+            if (!m_error.empty() || !expect(0)) return false;
+        } else if (discr == 'd') {
+            s.m_kind = kind::del;
+            s.m_hints_begin = m_ids.size();
+            if (!binary_id_list() || !expect(0)) return false;
+            s.m_hints_end = m_ids.size();
+        } else {
+            return fail("Expected a or d got: " + std::to_string(discr));
+        }
+        return push_step(s);
+    }
+    /* `Binary.parseActions` */
+    bool binary_actions() {
+        while (!at_end()) {
+            if (!binary_action()) return false;
+        }
+        return true;
+    }
+
+    // Conversion to `Array IntAction`
+
+    obj_res mk_id_array(size_t begin, size_t end) const {
+        obj_res r = lean_alloc_array(end - begin, end - begin);
+        for (size_t i = begin; i < end; i++)
+            lean_array_cptr(r)[i - begin] = lean_uint64_to_nat(m_ids[i]);
+        return r;
+    }
+    obj_res mk_clause(step const & s) const {
+        size_t n = s.m_clause_end - s.m_clause_begin;
+        obj_res r = lean_alloc_array(n, n);
+        for (size_t i = 0; i < n; i++)
+            lean_array_cptr(r)[i] = lean_int64_to_int(m_lits[s.m_clause_begin + i]);
+        return r;
+    }
+    obj_res mk_rat_hints(step const & s) const {
+        size_t n = s.m_rat_end - s.m_rat_begin;
+        obj_res r = lean_alloc_array(n, n);
+        for (size_t i = 0; i < n; i++) {
+            rat_hint const & h = m_rat_hints[s.m_rat_begin + i];
+            obj_res p = lean_alloc_ctor(0, 2, 0);
+            lean_ctor_set(p, 0, lean_uint64_to_nat(h.m_pivot));
+            lean_ctor_set(p, 1, mk_id_array(h.m_hints_begin, h.m_hints_end));
+            lean_array_cptr(r)[i] = p;
+        }
+        return r;
+    }
+    obj_res mk_action(step const & s) const {
+        obj_res a;
+        if (s.m_kind == kind::del) {
+            // `Action.del ids`
+            a = lean_alloc_ctor(3, 1, 0);
+            lean_ctor_set(a, 0, mk_id_array(s.m_hints_begin, s.m_hints_end));
+        } else if (s.m_clause_begin == s.m_clause_end) {
+            // `Action.addEmpty id rupHints`
+            a = lean_alloc_ctor(0, 2, 0);
+            lean_ctor_set(a, 0, lean_uint64_to_nat(s.m_id));
+            lean_ctor_set(a, 1, mk_id_array(s.m_hints_begin, s.m_hints_end));
+        } else if (s.m_rat_begin == s.m_rat_end) {
+            // `Action.addRup id c rupHints`
+            a = lean_alloc_ctor(1, 3, 0);
+            lean_ctor_set(a, 0, lean_uint64_to_nat(s.m_id));
+            lean_ctor_set(a, 1, mk_clause(s));
+            lean_ctor_set(a, 2, mk_id_array(s.m_hints_begin, s.m_hints_end));
+        } else {
+            // `Action.addRat id c pivot rupHints ratHints` where `pivot` is the first literal of `c`
+            int64_t first = m_lits[s.m_clause_begin];
+            obj_res pivot = lean_alloc_ctor(0, 2, 0);
+            lean_ctor_set(pivot, 0, lean_uint64_to_nat(first < 0 ? -static_cast<uint64_t>(first) : first));
+            lean_ctor_set(pivot, 1, lean_box(first > 0));
+            a = lean_alloc_ctor(2, 5, 0);
+            lean_ctor_set(a, 0, lean_uint64_to_nat(s.m_id));
+            lean_ctor_set(a, 1, mk_clause(s));
+            lean_ctor_set(a, 2, pivot);
+            lean_ctor_set(a, 3, mk_id_array(s.m_hints_begin, s.m_hints_end));
+            lean_ctor_set(a, 4, mk_rat_hints(s));
+        }
+        return a;
+    }
+
+public:
+    lrat_parser(uint8_t const * data, size_t size):m_begin(data), m_it(data), m_end(data + size) {}
+
+    /* Return `Except String (Array IntAction)` */
+    obj_res operator()() {
+        uint8_t b;
+        bool ok = peek(b) && ((b == 'a' || b == 'd') ? binary_actions() : text_actions());
+        if (!ok) {
+            std::string msg = "offset " + std::to_string(m_error_pos) + ": " + m_error;
+            obj_res r = lean_alloc_ctor(0, 1, 0);
+            lean_ctor_set(r, 0, lean_mk_string(msg.c_str()));
+            return r;
+        }
+        obj_res actions = lean_alloc_array(m_steps.size(), m_steps.size());
+        for (size_t i = 0; i < m_steps.size(); i++)
+            lean_array_cptr(actions)[i] = mk_action(m_steps[i]);
+        obj_res r = lean_alloc_ctor(1, 1, 0);
+        lean_ctor_set(r, 0, actions);
+        return r;
+    }
+};
+
+extern "C" LEAN_EXPORT obj_res lean_lrat_parse_proof(b_obj_arg proof) {
+    return lrat_parser(lean_sarray_cptr(proof), lean_sarray_size(proof))();
+}
+}
@@ -7,9 +7,13 @@ Author: Leonardo de Moura
 #include <new>
 #include <cstdlib>
 #include <iostream>
+#include <functional>
+#include <vector>
 #include "runtime/exception.h"
 #include "runtime/memory.h"
 #include "runtime/thread.h"
+#include "runtime/alloc.h"
+#include "runtime/compact.h"
 
 #ifndef LEAN_CHECK_MEM_THRESHOLD
 #define LEAN_CHECK_MEM_THRESHOLD 200
@@ -112,10 +116,61 @@ size_t get_current_rss() {
 
 namespace lean {
 static size_t g_max_memory = 0;
+static atomic<size_t> g_soft_memory(0);
 LEAN_THREAD_VALUE(size_t, g_counter, 0);
 
+/* The memory sampler checks the resident set size every `LEAN_MEMORY_SAMPLE_INTERVAL_MS`
+   milliseconds. When it exceeds the soft limit, it bumps `g_memory_pressure_epoch`, and every thread
+   runs the functions registered with `register_memory_pressure_fn` on its next `check_memory`.
+   Eviction happens on the thread owning the caches, as most of them are thread local. */
+#define LEAN_MEMORY_SAMPLE_INTERVAL_MS 100
+// Minimal time between two requests to evict caches.
+#define LEAN_MEMORY_PRESSURE_INTERVAL_MS 1000
+// Default soft limit in percent of the hard limit.
+#define LEAN_DEFAULT_SOFT_MEMORY_PERCENT 80
+
+static std::vector<std::function<void()>> * g_memory_pressure_fns = nullptr;
+static atomic<bool> g_memory_sampler(false);
+static atomic<size_t> g_sampled_rss(0);
+static atomic<unsigned> g_memory_pressure_epoch(0);
+LEAN_THREAD_VALUE(unsigned, g_seen_memory_pressure_epoch, 0);
+
+void register_memory_pressure_fn(std::function<void()> fn) {
+    if (!g_memory_pressure_fns)
+        g_memory_pressure_fns = new std::vector<std::function<void()>>();
+    g_memory_pressure_fns->push_back(fn);
+}
+
+static void start_memory_sampler() {
+#if defined(LEAN_MULTI_THREAD)
+    if (g_memory_sampler.exchange(true))
+        return;
+    g_sampled_rss = get_current_rss();
+    lthread([]() {
+        auto last_pressure = chrono::steady_clock::now() - chrono::milliseconds(LEAN_MEMORY_PRESSURE_INTERVAL_MS);
+        while (true) {
+            this_thread::sleep_for(chrono::milliseconds(LEAN_MEMORY_SAMPLE_INTERVAL_MS));
+            size_t rss = get_current_rss();
+            g_sampled_rss = rss;
+            auto now = chrono::steady_clock::now();
+            if (g_soft_memory > 0 && rss >= g_soft_memory &&
+                now - last_pressure >= chrono::milliseconds(LEAN_MEMORY_PRESSURE_INTERVAL_MS)) {
+                last_pressure = now;
+                g_memory_pressure_epoch++;
+            }
+        }
+    });
+    // `lthread` will be implicitly freed, which frees up its control resources but does not terminate the thread
+#endif
+}
+
 void set_max_memory(size_t max) {
     g_max_memory = max;
+    if (max > 0) {
+        if (g_soft_memory == 0 || g_soft_memory > max)
+            g_soft_memory = max / 100 * LEAN_DEFAULT_SOFT_MEMORY_PERCENT;
+        start_memory_sampler();
+    }
 }
 
 void set_max_memory_megabyte(unsigned max) {
@@ -124,12 +179,38 @@ void set_max_memory_megabyte(unsigned max) {
     set_max_memory(m);
 }
 
+void set_soft_memory(size_t soft) {
+    g_soft_memory = soft;
+    if (soft > 0)
+        start_memory_sampler();
+}
+
 // separate definition to allow breakpoint in debugger
 void throw_memory_exception(char const * component_name) {
     throw memory_exception(component_name);
 }
 
+static void handle_memory_pressure() {
+    g_seen_memory_pressure_epoch = g_memory_pressure_epoch;
+    if (g_memory_pressure_fns) {
+        for (std::function<void()> const & fn : *g_memory_pressure_fns)
+            fn();
+    }
+}
+
 void check_memory(char const * component_name) {
+    if (g_memory_sampler) {
+        if (LEAN_UNLIKELY(g_seen_memory_pressure_epoch != g_memory_pressure_epoch.load(memory_order_relaxed)))
+            handle_memory_pressure();
+        if (g_max_memory > 0 && g_sampled_rss.load(memory_order_relaxed) >= g_max_memory) {
+            // Confirm with a fresh measurement, caches may have been evicted since the last sample.
+            size_t r = get_current_rss();
+            g_sampled_rss = r;
+            if (r >= g_max_memory)
+                throw_memory_exception(component_name);
+        }
+        return;
+    }
     if (g_max_memory == 0) return;
     g_counter++;
     if (g_counter >= LEAN_CHECK_MEM_THRESHOLD) {
@@ -147,4 +228,26 @@ void check_memory(char const * component_name) {
 size_t get_allocated_memory() {
     return get_current_rss();
 }
+
+memory_stats get_memory_stats() {
+    memory_stats r;
+    r.m_rss = get_current_rss();
+    r.m_peak_rss = get_peak_rss();
+    r.m_allocator = get_allocator_memory();
+    r.m_compacted_regions = get_compacted_region_memory();
+    r.m_soft_limit = g_soft_memory;
+    r.m_hard_limit = g_max_memory;
+    return r;
+}
+
+/* IO.getMemoryStats : BaseIO IO.MemoryStats */
+extern "C" LEAN_EXPORT obj_res lean_io_get_memory_stats(obj_arg /* w */) {
+    memory_stats st = get_memory_stats();
+    size_t values[] = { st.m_rss, st.m_peak_rss, st.m_allocator, st.m_compacted_regions, st.m_soft_limit, st.m_hard_limit };
+    size_t num_values = sizeof(values) / sizeof(size_t);
+    object * r = lean_alloc_ctor(0, num_values, 0);
+    for (size_t i = 0; i < num_values; i++)
+        lean_ctor_set(r, i, lean_usize_to_nat(values[i]));
+    return lean_io_result_mk_ok(r);
+}
 }
@@ -6,6 +6,7 @@ Author: Leonardo de Moura
 */
 #pragma once
 #include <cstdlib>
+#include <functional>
 #include <lean/lean.h>
 
 namespace lean {
@@ -13,6 +14,23 @@ namespace lean {
 LEAN_EXPORT void set_max_memory(size_t max);
 /** \brief Set maximum amount of memory in megabytes */
 LEAN_EXPORT void set_max_memory_megabyte(unsigned max);
+/** \brief Set the amount of memory in bytes above which caches are evicted. It defaults to 80% of the
+    maximum amount of memory. */
+LEAN_EXPORT void set_soft_memory(size_t soft);
 LEAN_EXPORT void check_memory(char const * component_name);
 LEAN_EXPORT size_t get_allocated_memory();
+/** \brief Register a function that evicts caches of the current thread. Once memory usage exceeds
+    the soft limit, every thread calls the registered functions in its next `check_memory`. Must be
+    called during initialization. */
+LEAN_EXPORT void register_memory_pressure_fn(std::function<void()> fn);
+
+struct memory_stats {
+    size_t m_rss;               // resident set size
+    size_t m_peak_rss;
+    size_t m_allocator;         // memory held by the small object allocator
+    size_t m_compacted_regions; // memory of loaded `.olean` files
+    size_t m_soft_limit;        // 0 if unset
+    size_t m_hard_limit;        // 0 if unset
+};
+LEAN_EXPORT memory_stats get_memory_stats();
 }
@@ -86,11 +86,10 @@ void mpn_sub(mpn_digit const * a, size_t const lnga,
     }
 }
 
-void mpn_mul(mpn_digit const * a, size_t const lnga,
-             mpn_digit const * b, size_t const lngb,
-             mpn_digit * c) {
+static void mpn_mul_basecase(mpn_digit const * a, size_t const lnga,
+                             mpn_digit const * b, size_t const lngb,
+                             mpn_digit * c) {
     // Essentially Knuth's Algorithm M.
-    // Perhaps implement a more efficient version, see e.g., Knuth, Section 4.3.3.
     size_t i;
     mpn_digit k;
 
@@ -122,6 +121,87 @@ void mpn_mul(mpn_digit const * a, size_t const lnga,
     }
 }
 
+/* Operands with fewer digits than this are multiplied using `mpn_mul_basecase`. */
+#define LEAN_MPN_KARATSUBA_THRESHOLD 32
+
+/* c[0, lngc) += x[0, lngx), where the sum must fit in `lngc` digits. */
+static void mpn_add_in_place(mpn_digit * c, size_t lngc, mpn_digit const * x, size_t lngx) {
+    mpn_digit k = 0;
+    size_t j = 0;
+    for (; j < lngx; j++) {
+        if (j >= lngc) {
+            lean_assert(x[j] == 0);
+            continue;
+        }
+        mpn_double_digit t = (mpn_double_digit)c[j] + (mpn_double_digit)x[j] + k;
+        c[j] = (mpn_digit)t;
+        k = (mpn_digit)(t >> DIGIT_BITS);
+    }
+    for (; k != 0 && j < lngc; j++) {
+        c[j]++;
+        k = c[j] == 0;
+    }
+    lean_assert(k == 0);
+}
+
+/* Karatsuba multiplication of `a` and `b`, both with `n` digits, storing the `2n` digits of the product in `c`.
+   See Knuth, Section 4.3.3. */
+static void mpn_mul_karatsuba(mpn_digit const * a, mpn_digit const * b, size_t n, mpn_digit * c) {
+    if (n < LEAN_MPN_KARATSUBA_THRESHOLD) {
+        mpn_mul_basecase(a, n, b, n, c);
+        return;
+    }
+    // a = a1*B^h + a0, b = b1*B^h + b0
+    size_t h  = n / 2;
+    size_t hi = n - h;
+    // c = a1*b1*B^2h + a0*b0
+    mpn_mul_karatsuba(a, b, h, c);
+    mpn_mul_karatsuba(a + h, b + h, hi, c + 2*h);
+    // m = (a0 + a1)*(b0 + b1) - a0*b0 - a1*b1 = a0*b1 + a1*b0
+    buffer<mpn_digit> sa, sb, m;
+    sa.resize(hi + 1, 0);
+    sb.resize(hi + 1, 0);
+    m.resize(2*hi + 2, 0);
+    size_t lng;
+    mpn_add(a, h, a + h, hi, sa.data(), hi + 1, &lng);
+    mpn_add(b, h, b + h, hi, sb.data(), hi + 1, &lng);
+    mpn_mul_karatsuba(sa.data(), sb.data(), hi + 1, m.data());
+    mpn_digit borrow;
+    mpn_sub(m.data(), 2*hi + 2, c, 2*h, m.data(), &borrow);
+    lean_assert(borrow == 0);
+    mpn_sub(m.data(), 2*hi + 2, c + 2*h, 2*hi, m.data(), &borrow);
+    lean_assert(borrow == 0);
+    // c += m*B^h
+    mpn_add_in_place(c + h, 2*n - h, m.data(), 2*hi + 2);
+}
+
+void mpn_mul(mpn_digit const * a, size_t const lnga,
+             mpn_digit const * b, size_t const lngb,
+             mpn_digit * c) {
+    if (lnga < lngb) {
+        mpn_mul(b, lngb, a, lnga, c);
+        return;
+    }
+    if (lngb < LEAN_MPN_KARATSUBA_THRESHOLD) {
+        mpn_mul_basecase(a, lnga, b, lngb, c);
+        return;
+    }
+    if (lnga == lngb) {
+        mpn_mul_karatsuba(a, b, lnga, c);
+        return;
+    }
+    // Multiply `b` by `lngb`-digit chunks of `a`, and add the partial products.
+    for (size_t i = 0; i < lnga + lngb; i++)
+        c[i] = 0;
+    buffer<mpn_digit> tmp;
+    tmp.resize(2*lngb, 0);
+    for (size_t i = 0; i < lnga; i += lngb) {
+        size_t lngc = lnga - i < lngb ? lnga - i : lngb;
+        mpn_mul(a + i, lngc, b, lngb, tmp.data());
+        mpn_add_in_place(c + i, lnga + lngb - i, tmp.data(), lngc + lngb);
+    }
+}
+
 #define MASK_FIRST (~((mpn_digit)(-1) >> 1))
 #define FIRST_BITS(N, X) ((X) >> (DIGIT_BITS-(N)))
 #define LAST_BITS(N, X) (((X) << (DIGIT_BITS-(N))) >> (DIGIT_BITS-(N)))
@@ -329,21 +409,32 @@ char * mpn_to_string(mpn_digit const * a, size_t const lng, char * buf, size_t c
 #endif
     }
     else {
-        mpn_buffer temp(lng, 0), t_numer(lng+1, 0), t_denom(1, 0);
+        mpn_buffer temp(lng, 0);
         for (unsigned i = 0; i < lng; i++)
             temp[i] = a[i];
+        size_t sz = lng;
+        while (sz > 0 && temp[sz-1] == 0)
+            sz--;
 
+        // Divide by 10^9 in each pass, producing 9 decimal digits (least significant first) at a time.
+        const mpn_digit chunk = 1000000000;
         size_t j = 0;
-        mpn_digit rem;
-        mpn_digit ten = 10;
-        while (!temp.empty() && (temp.size() > 1 || temp[0] != 0)) {
-            size_t d = div_normalize(&temp[0], temp.size(), &ten, 1, t_numer, t_denom);
-            div_1(t_numer, t_denom[0], &temp[0]);
-            div_unnormalize(t_numer, t_denom, d, &rem);
-            buf[j++] = '0' + rem;
-            while (!temp.empty() && temp.back() == 0)
-                temp.pop_back();
+        while (sz > 0) {
+            mpn_double_digit rem = 0;
+            for (size_t i = sz; i-- > 0;) {
+                mpn_double_digit t = (rem << DIGIT_BITS) | temp[i];
+                temp[i] = (mpn_digit)(t / chunk);
+                rem = t % chunk;
+            }
+            while (sz > 0 && temp[sz-1] == 0)
+                sz--;
+            for (unsigned k = 0; k < 9 && (sz > 0 || rem != 0); k++) {
+                buf[j++] = '0' + rem % 10;
+                rem /= 10;
+            }
         }
+        if (j == 0)
+            buf[j++] = '0';
         buf[j] = 0;
 
         j--;
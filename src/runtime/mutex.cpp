@@ -67,9 +67,92 @@ extern "C" LEAN_EXPORT obj_res lean_io_condvar_notify_all(b_obj_arg condvar, obj
     return io_result_mk_ok(box(0));
 }
 
+static lean_external_class * g_basesharedmutex_external_class = nullptr;
+static void basesharedmutex_finalizer(void * h) {
+    delete static_cast<shared_mutex *>(h);
+}
+static void basesharedmutex_foreach(void *, b_obj_arg) {}
+
+static shared_mutex * basesharedmutex_get(lean_object * mtx) {
+    return static_cast<shared_mutex *>(lean_get_external_data(mtx));
+}
+
+extern "C" LEAN_EXPORT obj_res lean_io_basesharedmutex_new(obj_arg) {
+    return io_result_mk_ok(lean_alloc_external(g_basesharedmutex_external_class, new shared_mutex));
+}
+
+extern "C" LEAN_EXPORT obj_res lean_io_basesharedmutex_lock(b_obj_arg mtx, obj_arg) {
+    basesharedmutex_get(mtx)->lock();
+    return io_result_mk_ok(box(0));
+}
+
+extern "C" LEAN_EXPORT obj_res lean_io_basesharedmutex_try_lock(b_obj_arg mtx, obj_arg) {
+    return io_result_mk_ok(box(basesharedmutex_get(mtx)->try_lock()));
+}
+
+extern "C" LEAN_EXPORT obj_res lean_io_basesharedmutex_unlock(b_obj_arg mtx, obj_arg) {
+    basesharedmutex_get(mtx)->unlock();
+    return io_result_mk_ok(box(0));
+}
+
+extern "C" LEAN_EXPORT obj_res lean_io_basesharedmutex_lock_shared(b_obj_arg mtx, obj_arg) {
+    basesharedmutex_get(mtx)->lock_shared();
+    return io_result_mk_ok(box(0));
+}
+
+extern "C" LEAN_EXPORT obj_res lean_io_basesharedmutex_try_lock_shared(b_obj_arg mtx, obj_arg) {
+    return io_result_mk_ok(box(basesharedmutex_get(mtx)->try_lock_shared()));
+}
+
+extern "C" LEAN_EXPORT obj_res lean_io_basesharedmutex_unlock_shared(b_obj_arg mtx, obj_arg) {
+    basesharedmutex_get(mtx)->unlock_shared();
+    return io_result_mk_ok(box(0));
+}
+
+static lean_external_class * g_atomic_uint64_external_class = nullptr;
+static void atomic_uint64_finalizer(void * h) {
+    delete static_cast<atomic<uint64> *>(h);
+}
+static void atomic_uint64_foreach(void *, b_obj_arg) {}
+
+static atomic<uint64> * atomic_uint64_get(lean_object * a) {
+    return static_cast<atomic<uint64> *>(lean_get_external_data(a));
+}
+
+extern "C" LEAN_EXPORT obj_res lean_io_atomic_uint64_new(uint64 v, obj_arg) {
+    return io_result_mk_ok(lean_alloc_external(g_atomic_uint64_external_class, new atomic<uint64>(v)));
+}
+
+extern "C" LEAN_EXPORT obj_res lean_io_atomic_uint64_load(b_obj_arg a, obj_arg) {
+    return io_result_mk_ok(lean_box_uint64(atomic_uint64_get(a)->load()));
+}
+
+extern "C" LEAN_EXPORT obj_res lean_io_atomic_uint64_store(b_obj_arg a, uint64 v, obj_arg) {
+    atomic_uint64_get(a)->store(v);
+    return io_result_mk_ok(box(0));
+}
+
+extern "C" LEAN_EXPORT obj_res lean_io_atomic_uint64_swap(b_obj_arg a, uint64 v, obj_arg) {
+    return io_result_mk_ok(lean_box_uint64(atomic_uint64_get(a)->exchange(v)));
+}
+
+extern "C" LEAN_EXPORT obj_res lean_io_atomic_uint64_fetch_add(b_obj_arg a, uint64 v, obj_arg) {
+    return io_result_mk_ok(lean_box_uint64(atomic_uint64_get(a)->fetch_add(v)));
+}
+
+extern "C" LEAN_EXPORT obj_res lean_io_atomic_uint64_fetch_sub(b_obj_arg a, uint64 v, obj_arg) {
+    return io_result_mk_ok(lean_box_uint64(atomic_uint64_get(a)->fetch_sub(v)));
+}
+
+extern "C" LEAN_EXPORT obj_res lean_io_atomic_uint64_compare_and_swap(b_obj_arg a, uint64 expected, uint64 desired, obj_arg) {
+    return io_result_mk_ok(box(atomic_uint64_get(a)->compare_exchange_strong(expected, desired)));
+}
+
 void initialize_mutex() {
     g_basemutex_external_class = lean_register_external_class(basemutex_finalizer, basemutex_foreach);
     g_condvar_external_class = lean_register_external_class(condvar_finalizer, condvar_foreach);
+    g_basesharedmutex_external_class = lean_register_external_class(basesharedmutex_finalizer, basesharedmutex_foreach);
+    g_atomic_uint64_external_class = lean_register_external_class(atomic_uint64_finalizer, atomic_uint64_foreach);
 }
 
 void finalize_mutex() {
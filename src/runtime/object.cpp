@@ -7,8 +7,12 @@ Author: Leonardo de Moura
 #include <string>
 #include <algorithm>
 #include <vector>
+#include <unordered_map>
+#include <unordered_set>
 #include <deque>
 #include <cmath>
+#include <cstdlib>
+#include <iostream>
 #include <lean/lean.h>
 #include "runtime/object.h"
 #include "runtime/thread.h"
@@ -21,6 +25,7 @@ Author: Leonardo de Moura
 #include "runtime/buffer.h"
 #include "runtime/io.h"
 #include "runtime/hash.h"
+#include "runtime/task_trace.h"
 
 #if defined(__GLIBC__) || defined(__APPLE__)
     #define LEAN_SUPPORTS_BACKTRACE 1
@@ -362,16 +367,107 @@ static void lean_del_core(object * o, object * & todo) {
     }
 }
 
+/* Return true if the heap object `o` was allocated in `region` (see `scoped_region`). */
+static bool is_region_object(void * region, object * o) {
+    if (region == nullptr || !lean_has_rc(o))
+        return false;
+    switch (lean_ptr_tag(o)) {
+    case LeanArray: case LeanScalarArray: case LeanString:
+        /* big arrays and strings are not allocated in the region pages */
+        if (lean_object_byte_size(o) > LEAN_MAX_SMALL_OBJECT_SIZE)
+            return false;
+        return in_region(region, o);
+    default:
+        return in_region(region, o);
+    }
+}
+
+/* Return true if `o` was allocated in the region of the current thread, and can be dropped without
+   being deallocated. Tasks, promises and external objects have side effects on deletion, and `mpz`
+   numbers own memory outside the region, so they are always deleted. */
+static bool is_region_garbage(object * o) {
+    switch (lean_ptr_tag(o)) {
+    case LeanMPZ: case LeanTask: case LeanPromise: case LeanExternal:
+        return false;
+    default:
+        return is_region_object(g_region, o);
+    }
+}
+
+// =======================================
+// Deferred deallocation
+
+/* Maximum number of objects deleted by `lean_dec_ref_cold` before the rest of a multi-threaded
+   object graph is handed to the reclamation thread, if `g_deferred_free` is set. */
+#define LEAN_DEFERRED_FREE_BUDGET 4096
+
+static bool g_deferred_free = false;
+static mutex * g_deferred_free_mutex = nullptr;
+static condition_variable * g_deferred_free_cv = nullptr;
+static std::vector<object *> * g_deferred_free_todo = nullptr;
+static bool g_deferred_free_worker = false;
+
+static void deferred_free_worker() {
+    save_stack_info(false);
+    unique_lock<mutex> lock(*g_deferred_free_mutex);
+    while (true) {
+        g_deferred_free_cv->wait(lock, []() { return !g_deferred_free_todo->empty(); });
+        object * todo = g_deferred_free_todo->back();
+        g_deferred_free_todo->pop_back();
+        lock.unlock();
+        while (todo != nullptr) {
+            object * o = pop_back(todo);
+            lean_del_core(o, todo);
+        }
+        lock.lock();
+    }
+}
+
+/* Hand the objects in `todo` to the reclamation thread. This is only safe when they belong to a
+   multi-threaded object graph: objects reachable from multi-threaded objects are multi-threaded
+   or persistent as well, so the reclamation thread only updates reference counters atomically. */
+static void defer_free(object * todo) {
+    unique_lock<mutex> lock(*g_deferred_free_mutex);
+    if (!g_deferred_free_worker) {
+        g_deferred_free_worker = true;
+        lthread([]() { deferred_free_worker(); });
+        // `lthread` will be implicitly freed, which frees up its control resources but does not terminate the thread
+    }
+    g_deferred_free_todo->push_back(todo);
+    g_deferred_free_cv->notify_one();
+}
+
+void set_deferred_free(bool flag) {
+#if defined(LEAN_MULTI_THREAD)
+    g_deferred_free = flag;
+#else
+    (void)flag;
+#endif
+}
+
 extern "C" LEAN_EXPORT void lean_dec_ref_cold(lean_object * o) {
+#ifndef LEAN_LAZY_RC
+    /* Only the deletion of multi-threaded objects can be deferred, see `defer_free`. */
+    bool deferrable = LEAN_UNLIKELY(g_deferred_free) && !lean_is_st(o);
+#endif
     if (o->m_rc == 1 || std::atomic_fetch_add_explicit(lean_get_rc_mt_addr(o), 1, std::memory_order_acq_rel) == -1) {
 #ifdef LEAN_LAZY_RC
         push_back(g_to_free, o);
 #else
         object * todo = nullptr;
+        unsigned budget = LEAN_DEFERRED_FREE_BUDGET;
         while (true) {
-            lean_del_core(o, todo);
+            if (LEAN_UNLIKELY(g_region != nullptr) && is_region_garbage(o)) {
+                /* `o` and the references it holds are released in bulk at the end of the region */
+            } else {
+                lean_del_core(o, todo);
+            }
             if (todo == nullptr)
                 return;
+            if (LEAN_UNLIKELY(deferrable) && --budget == 0 && g_region == nullptr) {
+                defer_free(todo);
+                return;
+            }
             o = pop_back(todo);
         }
 #endif
@@ -429,6 +525,24 @@ extern "C" LEAN_EXPORT lean_obj_res lean_array_set_panic(lean_obj_arg a, lean_ob
 // =======================================
 // Thunks
 
+#define LEAN_THUNK_WAIT_STRIPES 64
+#define LEAN_THUNK_SPIN_ITERS 64
+
+/* Threads waiting for a thunk that is being evaluated by another thread sleep on the stripe
+   of the thunk's address. `m_waiters` lets the evaluating thread skip the notification when
+   nobody is waiting, which is the common case. */
+struct thunk_wait_stripe {
+    mutex                 m_mutex;
+    condition_variable    m_cv;
+    std::atomic<unsigned> m_waiters{0};
+};
+
+static thunk_wait_stripe * g_thunk_wait_stripes = nullptr;
+
+static thunk_wait_stripe & get_thunk_wait_stripe(b_obj_arg t) {
+    return g_thunk_wait_stripes[(reinterpret_cast<size_t>(t) / sizeof(lean_thunk_object)) % LEAN_THUNK_WAIT_STRIPES];
+}
+
 extern "C" LEAN_EXPORT b_obj_res lean_thunk_get_core(b_obj_arg t) {
     object * c = lean_to_thunk(t)->m_closure.exchange(nullptr);
     if (c != nullptr) {
@@ -439,23 +553,146 @@ extern "C" LEAN_EXPORT b_obj_res lean_thunk_get_core(b_obj_arg t) {
            to be object stored in the constructor object.
 
            Recall that `apply_1` also consumes `c`'s RC. */
-        object * r = lean_apply_1(c, lean_box(0));
+        object * r;
+        if (g_region == nullptr || is_region_object(g_region, t)) {
+            r = lean_apply_1(c, lean_box(0));
+        } else {
+            /* `t` may outlive the current region, and so must its value. */
+            scoped_region_suspend suspend;
+            r = lean_apply_1(c, lean_box(0));
+        }
         lean_assert(r != nullptr); /* Closure must return a valid lean object */
         lean_assert(lean_to_thunk(t)->m_value == nullptr);
         mark_mt(r);
         lean_to_thunk(t)->m_value = r;
+        thunk_wait_stripe & s = get_thunk_wait_stripe(t);
+        if (s.m_waiters > 0) {
+            lock_guard<mutex> lock(s.m_mutex);
+            s.m_cv.notify_all();
+        }
         return r;
     } else {
         lean_assert(c == nullptr);
-        /* There is another thread executing the closure. We keep waiting for the m_value to be
-           set by another thread. */
-        while (!lean_to_thunk(t)->m_value) {
+        /* There is another thread executing the closure. Most thunks are cheap, so we first spin
+           for a little while, and then sleep until the other thread has set `m_value`. */
+        for (unsigned i = 0; i < LEAN_THUNK_SPIN_ITERS; i++) {
+            if (object * r = lean_to_thunk(t)->m_value)
+                return r;
             this_thread::yield();
         }
+        thunk_wait_stripe & s = get_thunk_wait_stripe(t);
+        unique_lock<mutex> lock(s.m_mutex);
+        s.m_waiters++;
+        s.m_cv.wait(lock, [&]() { return lean_to_thunk(t)->m_value != nullptr; });
+        s.m_waiters--;
         return lean_to_thunk(t)->m_value;
     }
 }
 
+// =======================================
+// Regions
+
+/* Copy the objects of `region` reachable from `root` to the current heap, and return the copy of `root`.
+   The copies reuse the references to objects outside the region held by the originals, which are
+   never released (see `lean_dec_ref_cold`). Big arrays reachable from `root` are not allocated in the
+   region, but may point to region objects, and are updated in place. */
+static obj_res region_copy_out(void * region, obj_arg root) {
+    std::unordered_map<object *, object *> copies;
+    std::unordered_map<object *, unsigned> num_refs; // number of references to each copy
+    std::unordered_set<object *> visited;
+    buffer<object *> todo;
+    auto visit = [&](object * o) -> object * {
+        if (lean_is_scalar(o))
+            return o;
+        if (!is_region_object(region, o)) {
+            if (lean_is_array(o) && lean_has_rc(o) && visited.insert(o).second)
+                todo.push_back(o);
+            return o;
+        }
+        auto it = copies.find(o);
+        if (it != copies.end()) {
+            num_refs[it->second]++;
+            return it->second;
+        }
+        uint8_t tag = lean_ptr_tag(o);
+        if (tag == LeanTask || tag == LeanPromise)
+            lean_internal_panic("tasks and promises cannot escape from a region");
+        size_t sz = lean_object_byte_size(o);
+        object * c = lean_alloc_object(sz);
+        memcpy(c, o, sz);
+        copies.insert(std::make_pair(o, c));
+        num_refs[c] = 1;
+        todo.push_back(c);
+        return c;
+    };
+    object * r = visit(root);
+    while (!todo.empty()) {
+        object * o = todo.back();
+        todo.pop_back();
+        uint8_t tag = lean_ptr_tag(o);
+        if (tag <= LeanMaxCtorTag) {
+            object ** it  = lean_ctor_obj_cptr(o);
+            object ** end = it + lean_ctor_num_objs(o);
+            for (; it != end; ++it) *it = visit(*it);
+        } else {
+            switch (tag) {
+            case LeanClosure: {
+                object ** it  = lean_closure_arg_cptr(o);
+                object ** end = it + lean_closure_num_fixed(o);
+                for (; it != end; ++it) *it = visit(*it);
+                break;
+            }
+            case LeanArray: {
+                object ** it  = lean_array_cptr(o);
+                object ** end = it + lean_array_size(o);
+                for (; it != end; ++it) *it = visit(*it);
+                break;
+            }
+            case LeanThunk:
+                if (object * c = lean_to_thunk(o)->m_closure) lean_to_thunk(o)->m_closure = visit(c);
+                if (object * v = lean_to_thunk(o)->m_value) lean_to_thunk(o)->m_value = visit(v);
+                break;
+            case LeanRef:
+                if (object * v = lean_to_ref(o)->m_value) lean_to_ref(o)->m_value = visit(v);
+                break;
+            default:
+                break;
+            }
+        }
+    }
+    for (auto const & p : copies) {
+        object * c = p.second;
+        if (lean_has_rc(c)) {
+            int n = static_cast<int>(num_refs[c]);
+            c->m_rc = lean_is_mt(c) ? -n : n;
+        }
+    }
+    return r;
+}
+
+obj_res copy_out_of_active_region(obj_arg o) {
+    if (g_region == nullptr)
+        return o;
+    void * rgn = g_region;
+    scoped_region_suspend suspend;
+    return region_copy_out(rgn, o);
+}
+
+extern "C" LEAN_EXPORT obj_res lean_with_region(obj_arg f) {
+    /* Keep `f` alive so that the values it captures are shared and thus never updated in place. */
+    lean_inc(f);
+    object * r;
+    {
+        scoped_region region;
+        void * rgn = g_region;
+        r = lean_apply_1(f, lean_box(0));
+        scoped_region_suspend suspend;
+        r = region_copy_out(rgn, r);
+    }
+    lean_dec(f);
+    return r;
+}
+
 // =======================================
 // Mark Persistent
 
@@ -472,73 +709,212 @@ static obj_res mark_persistent_fn(obj_arg o) {
 #endif
 #endif
 
-extern "C" LEAN_EXPORT void lean_mark_persistent(object * o) {
-    buffer<object*> todo;
-    todo.push_back(o);
-    while (!todo.empty()) {
-        object * o = todo.back();
-        todo.pop_back();
-        if (!lean_is_scalar(o) && lean_has_rc(o)) {
-            o->m_rc = 0;
+/* Set on threads taking part in a parallel `lean_mark_persistent`, in which case objects are claimed
+   atomically, including by nested calls for the contents of external objects. */
+LEAN_THREAD_VALUE(bool, g_mark_persistent_atomic, false);
+
+/* Marks `o` unless it is a scalar or already persistent, which includes all objects in compacted
+   regions, and schedules its children. Marking objects when they are scheduled rather than when
+   they are visited keeps shared and persistent objects out of the work list. */
+template<bool Atomic> static inline void mark_persistent_push(buffer<object*> & todo, object * o) {
+    if (lean_is_scalar(o))
+        return;
+    if (Atomic) {
+        std::atomic<int> * rc = lean_get_rc_mt_addr(o);
+        if (rc->load(std::memory_order_relaxed) == 0 || rc->exchange(0, std::memory_order_relaxed) == 0)
+            return;
+    } else {
+        if (!lean_has_rc(o))
+            return;
+        o->m_rc = 0;
+    }
 #if defined(__has_feature)
 #if __has_feature(address_sanitizer)
-            // do not report as leak
-            // NOTE: Most persistent objects are actually reachable from global
-            // variables up to the end of the process. However, this is *not*
-            // true for closures inside of persistent thunks, which are
-            // "orphaned" after being evaluated.
-            __lsan_ignore_object(o);
+    // do not report as leak
+    // NOTE: Most persistent objects are actually reachable from global
+    // variables up to the end of the process. However, this is *not*
+    // true for closures inside of persistent thunks, which are
+    // "orphaned" after being evaluated.
+    __lsan_ignore_object(o);
 #endif
 #endif
-            uint8_t tag = lean_ptr_tag(o);
-            if (tag <= LeanMaxCtorTag) {
-                object ** it  = lean_ctor_obj_cptr(o);
-                object ** end = it + lean_ctor_num_objs(o);
-                for (; it != end; ++it) todo.push_back(*it);
-            } else {
-                switch (tag) {
-                case LeanScalarArray:
-                case LeanString:
-                case LeanMPZ:
-                    break;
-                case LeanExternal: {
-                    object * fn = lean_alloc_closure((void*)mark_persistent_fn, 1, 0);
-                    lean_to_external(o)->m_class->m_foreach(lean_to_external(o)->m_data, fn);
-                    lean_dec(fn);
-                    break;
-                }
-                case LeanTask:
-                    todo.push_back(lean_task_get(o));
-                    break;
-                case LeanPromise:
-                    todo.push_back((lean_object *)lean_to_promise(o)->m_result);
-                    break;
-                case LeanClosure: {
-                    object ** it  = lean_closure_arg_cptr(o);
-                    object ** end = it + lean_closure_num_fixed(o);
-                    for (; it != end; ++it) todo.push_back(*it);
-                    break;
-                }
-                case LeanArray: {
-                    object ** it  = lean_array_cptr(o);
-                    object ** end = it + lean_array_size(o);
-                    for (; it != end; ++it) todo.push_back(*it);
-                    break;
-                }
-                case LeanThunk:
-                    if (object * c = lean_to_thunk(o)->m_closure) todo.push_back(c);
-                    if (object * v = lean_to_thunk(o)->m_value) todo.push_back(v);
-                    break;
-                case LeanRef:
-                    if (object * v = lean_to_ref(o)->m_value) todo.push_back(v);
-                    break;
-                default:
-                    lean_unreachable();
-                    break;
-                }
+    todo.push_back(o);
+}
+
+/* Schedules the children of the marked object `o`. */
+template<bool Atomic> static void mark_persistent_children(buffer<object*> & todo, object * o) {
+    uint8_t tag = lean_ptr_tag(o);
+    if (tag <= LeanMaxCtorTag) {
+        object ** it  = lean_ctor_obj_cptr(o);
+        object ** end = it + lean_ctor_num_objs(o);
+        for (; it != end; ++it) mark_persistent_push<Atomic>(todo, *it);
+    } else {
+        switch (tag) {
+        case LeanScalarArray:
+        case LeanString:
+        case LeanMPZ:
+            break;
+        case LeanExternal: {
+            object * fn = lean_alloc_closure((void*)mark_persistent_fn, 1, 0);
+            lean_to_external(o)->m_class->m_foreach(lean_to_external(o)->m_data, fn);
+            lean_dec(fn);
+            break;
+        }
+        case LeanTask:
+            mark_persistent_push<Atomic>(todo, lean_task_get(o));
+            break;
+        case LeanPromise:
+            mark_persistent_push<Atomic>(todo, (lean_object *)lean_to_promise(o)->m_result);
+            break;
+        case LeanClosure: {
+            object ** it  = lean_closure_arg_cptr(o);
+            object ** end = it + lean_closure_num_fixed(o);
+            for (; it != end; ++it) mark_persistent_push<Atomic>(todo, *it);
+            break;
+        }
+        case LeanArray: {
+            object ** it  = lean_array_cptr(o);
+            object ** end = it + lean_array_size(o);
+            for (; it != end; ++it) mark_persistent_push<Atomic>(todo, *it);
+            break;
+        }
+        case LeanThunk:
+            if (object * c = lean_to_thunk(o)->m_closure) mark_persistent_push<Atomic>(todo, c);
+            if (object * v = lean_to_thunk(o)->m_value) mark_persistent_push<Atomic>(todo, v);
+            break;
+        case LeanRef:
+            if (object * v = lean_to_ref(o)->m_value) mark_persistent_push<Atomic>(todo, v);
+            break;
+        default:
+            lean_unreachable();
+            break;
+        }
+    }
+}
+
+/* Processes scheduled objects until none or at most `budget` objects have been processed. */
+template<bool Atomic> static void mark_persistent_loop(buffer<object*> & todo, size_t budget = SIZE_MAX) {
+    while (!todo.empty() && budget > 0) {
+        budget--;
+        object * o = todo.back();
+        todo.pop_back();
+        mark_persistent_children<Atomic>(todo, o);
+    }
+}
+
+#if defined(LEAN_MULTI_THREAD)
+/* Graphs with more objects than this, such as imported environments, are marked in parallel. */
+#define LEAN_MARK_PERSISTENT_SEQ_BUDGET 65536
+/* Number of scheduled objects moved between the work lists of threads at once */
+#define LEAN_MARK_PERSISTENT_CHUNK 256
+#define LEAN_MARK_PERSISTENT_MAX_THREADS 8
+
+static unsigned mark_persistent_num_threads();
+
+/* Parallel marking of the scheduled objects `todo`. Threads with a long work list hand off parts
+   of it to a shared pool whenever another thread ran out of work. */
+class mark_persistent_par {
+    mutex                m_mutex;
+    condition_variable   m_cv;
+    std::vector<object*> m_shared;
+    unsigned             m_num_threads;
+    atomic<unsigned>     m_num_idle;
+
+    bool take(buffer<object*> & todo) {
+        unique_lock<mutex> lock(m_mutex);
+        m_num_idle++;
+        while (m_shared.empty()) {
+            if (m_num_idle == m_num_threads) {
+                // nothing left anywhere
+                m_cv.notify_all();
+                return false;
+            }
+            m_cv.wait(lock);
+        }
+        m_num_idle--;
+        for (unsigned i = 0; i < LEAN_MARK_PERSISTENT_CHUNK && !m_shared.empty(); i++) {
+            todo.push_back(m_shared.back());
+            m_shared.pop_back();
+        }
+        return true;
+    }
+
+    void give(buffer<object*> & todo) {
+        lock_guard<mutex> lock(m_mutex);
+        for (unsigned i = 0; i < LEAN_MARK_PERSISTENT_CHUNK; i++) {
+            m_shared.push_back(todo.back());
+            todo.pop_back();
+        }
+        m_cv.notify_all();
+    }
+
+    void run() {
+        flet<bool> set_atomic(g_mark_persistent_atomic, true);
+        buffer<object*> todo;
+        while (take(todo)) {
+            while (!todo.empty()) {
+                if (todo.size() > 2 * LEAN_MARK_PERSISTENT_CHUNK && m_num_idle.load(std::memory_order_relaxed) > 0)
+                    give(todo);
+                object * o = todo.back();
+                todo.pop_back();
+                mark_persistent_children<true>(todo, o);
             }
         }
     }
+public:
+    mark_persistent_par(buffer<object*> const & todo, unsigned num_threads):
+        m_shared(todo.begin(), todo.end()), m_num_threads(num_threads), m_num_idle(0) {}
+
+    void operator()() {
+        std::vector<std::unique_ptr<lthread>> threads;
+        for (unsigned i = 1; i < m_num_threads; i++)
+            threads.emplace_back(new lthread([this]() { run(); }));
+        run();
+        for (auto & t : threads)
+            t->join();
+    }
+};
+#endif
+
+extern "C" LEAN_EXPORT void lean_mark_persistent(object * o) {
+    buffer<object*> todo;
+    if (g_mark_persistent_atomic) {
+        mark_persistent_push<true>(todo, o);
+        mark_persistent_loop<true>(todo);
+        return;
+    }
+    mark_persistent_push<false>(todo, o);
+#if defined(LEAN_MULTI_THREAD)
+    mark_persistent_loop<false>(todo, LEAN_MARK_PERSISTENT_SEQ_BUDGET);
+    if (todo.empty())
+        return;
+    unsigned num_threads = mark_persistent_num_threads();
+    if (num_threads > 1) {
+        mark_persistent_par(todo, num_threads)();
+        return;
+    }
+#endif
+    mark_persistent_loop<false>(todo);
+}
+
+// =======================================
+// Lazy closed terms
+
+/* The value is computed without holding a lock, as initializing a closed term may access other
+   ones, possibly from tasks. If several threads race on the first access, each computes the value
+   and the first one to publish it wins; the other values are persistent and hence leaked. */
+extern "C" LEAN_EXPORT object * lean_init_lazy_closed_term(std::atomic<object *> * cell, object * (*init)()) {
+    object * v;
+    {
+        /* the cell outlives the current region, and so must its value */
+        scoped_region_suspend suspend;
+        v = init();
+    }
+    lean_mark_persistent(v);
+    object * expected = nullptr;
+    if (cell->compare_exchange_strong(expected, v, std::memory_order_acq_rel, std::memory_order_acquire))
+        return v;
+    return expected;
 }
 
 // =======================================
@@ -552,65 +928,149 @@ static obj_res mark_mt_fn(obj_arg o) {
     return lean_box(0);
 }
 
+#ifdef LEAN_RUNTIME_STATS
+/* Number of objects marked by `lean_mark_mt`, and the largest number marked by a single call, to
+   spot tasks and references capturing large freshly built object graphs. */
+static std::atomic<uint64> g_num_mark_mt_objs(0);
+static std::atomic<uint64> g_max_mark_mt_objs(0);
+struct mark_mt_stats {
+    ~mark_mt_stats() {
+        std::cerr << "num. objs. marked MT:     " << g_num_mark_mt_objs << "\n";
+        std::cerr << "max. objs. marked at once: " << g_max_mark_mt_objs << "\n";
+    }
+};
+static mark_mt_stats g_mark_mt_stats;
+#endif
+
+/* Marks `o` if it still has a single-threaded reference counter and schedules its children.
+   Objects are marked when they are scheduled so that objects reachable along several paths, which
+   are common in expression DAGs, are scheduled only once, and already marked objects, scalars and
+   persistent objects are not put into the work list at all. */
+static inline void mark_mt_push(buffer<object*> & todo, object * o) {
+    if (!lean_is_scalar(o) && lean_is_st(o)) {
+        o->m_rc = -o->m_rc;
+        todo.push_back(o);
+    }
+}
+
 extern "C" LEAN_EXPORT void lean_mark_mt(object * o) {
 #ifndef LEAN_MULTI_THREAD
     return;
 #endif
     if (lean_is_scalar(o) || !lean_is_st(o)) return;
 
+    buffer<object*> todo;
+    mark_mt_push(todo, o);
+#ifdef LEAN_RUNTIME_STATS
+    uint64 num_marked = 0;
+#endif
+    while (!todo.empty()) {
+        object * o = todo.back();
+        todo.pop_back();
+#ifdef LEAN_RUNTIME_STATS
+        num_marked++;
+#endif
+        uint8_t tag = lean_ptr_tag(o);
+        if (tag <= LeanMaxCtorTag) {
+            object ** it  = lean_ctor_obj_cptr(o);
+            object ** end = it + lean_ctor_num_objs(o);
+            for (; it != end; ++it) mark_mt_push(todo, *it);
+        } else {
+            switch (tag) {
+            case LeanScalarArray:
+            case LeanString:
+            case LeanMPZ:
+                break;
+            case LeanExternal: {
+                object * fn = lean_alloc_closure((void*)mark_mt_fn, 1, 0);
+                lean_to_external(o)->m_class->m_foreach(lean_to_external(o)->m_data, fn);
+                lean_dec(fn);
+                break;
+            }
+            case LeanTask:
+                mark_mt_push(todo, lean_task_get(o));
+                break;
+            case LeanPromise:
+                mark_mt_push(todo, (lean_object *)lean_to_promise(o)->m_result);
+                break;
+            case LeanClosure: {
+                object ** it  = lean_closure_arg_cptr(o);
+                object ** end = it + lean_closure_num_fixed(o);
+                for (; it != end; ++it) mark_mt_push(todo, *it);
+                break;
+            }
+            case LeanArray: {
+                object ** it  = lean_array_cptr(o);
+                object ** end = it + lean_array_size(o);
+                for (; it != end; ++it) mark_mt_push(todo, *it);
+                break;
+            }
+            case LeanThunk:
+                if (object * c = lean_to_thunk(o)->m_closure) mark_mt_push(todo, c);
+                if (object * v = lean_to_thunk(o)->m_value) mark_mt_push(todo, v);
+                break;
+            case LeanRef:
+                if (object * v = lean_to_ref(o)->m_value) mark_mt_push(todo, v);
+                break;
+            default:
+                lean_unreachable();
+                break;
+            }
+        }
+    }
+#ifdef LEAN_RUNTIME_STATS
+    g_num_mark_mt_objs += num_marked;
+    uint64 max = g_max_mark_mt_objs.load(std::memory_order_relaxed);
+    while (num_marked > max && !g_max_mark_mt_objs.compare_exchange_weak(max, num_marked, std::memory_order_relaxed)) {}
+#endif
+}
+
+/* Variant of `lean_mark_mt` for an object whose ownership is being transferred to another thread,
+   e.g. the closure of a new task. Objects reachable from `o` only through exclusively referenced
+   objects cannot be accessed by the current thread afterwards, so they keep their non-atomic
+   reference counters. Only the shared part of the object graph is marked as multi-threaded. */
+static void mark_mt_transfer(object * o) {
+#ifndef LEAN_MULTI_THREAD
+    return;
+#endif
     buffer<object*> todo;
     todo.push_back(o);
     while (!todo.empty()) {
         object * o = todo.back();
         todo.pop_back();
-        if (!lean_is_scalar(o) && lean_is_st(o)) {
-            o->m_rc = -o->m_rc;
-            uint8_t tag = lean_ptr_tag(o);
-            if (tag <= LeanMaxCtorTag) {
-                object ** it  = lean_ctor_obj_cptr(o);
-                object ** end = it + lean_ctor_num_objs(o);
+        if (lean_is_scalar(o) || !lean_is_st(o))
+            continue;
+        if (!lean_is_exclusive(o)) {
+            lean_mark_mt(o);
+            continue;
+        }
+        uint8_t tag = lean_ptr_tag(o);
+        if (tag <= LeanMaxCtorTag) {
+            object ** it  = lean_ctor_obj_cptr(o);
+            object ** end = it + lean_ctor_num_objs(o);
+            for (; it != end; ++it) todo.push_back(*it);
+        } else {
+            switch (tag) {
+            case LeanScalarArray:
+            case LeanString:
+            case LeanMPZ:
+                break;
+            case LeanClosure: {
+                object ** it  = lean_closure_arg_cptr(o);
+                object ** end = it + lean_closure_num_fixed(o);
                 for (; it != end; ++it) todo.push_back(*it);
-            } else {
-                switch (tag) {
-                case LeanScalarArray:
-                case LeanString:
-                case LeanMPZ:
-                    break;
-                case LeanExternal: {
-                    object * fn = lean_alloc_closure((void*)mark_mt_fn, 1, 0);
-                    lean_to_external(o)->m_class->m_foreach(lean_to_external(o)->m_data, fn);
-                    lean_dec(fn);
-                    break;
-                }
-                case LeanTask:
-                    todo.push_back(lean_task_get(o));
-                    break;
-                case LeanPromise:
-                    todo.push_back((lean_object *)lean_to_promise(o)->m_result);
-                    break;
-                case LeanClosure: {
-                    object ** it  = lean_closure_arg_cptr(o);
-                    object ** end = it + lean_closure_num_fixed(o);
-                    for (; it != end; ++it) todo.push_back(*it);
-                    break;
-                }
-                case LeanArray: {
-                    object ** it  = lean_array_cptr(o);
-                    object ** end = it + lean_array_size(o);
-                    for (; it != end; ++it) todo.push_back(*it);
-                    break;
-                }
-                case LeanThunk:
-                    if (object * c = lean_to_thunk(o)->m_closure) todo.push_back(c);
-                    if (object * v = lean_to_thunk(o)->m_value) todo.push_back(v);
-                    break;
-                case LeanRef:
-                    if (object * v = lean_to_ref(o)->m_value) todo.push_back(v);
-                    break;
-                default:
-                    lean_unreachable();
-                    break;
-                }
+                break;
+            }
+            case LeanArray: {
+                object ** it  = lean_array_cptr(o);
+                object ** end = it + lean_array_size(o);
+                for (; it != end; ++it) todo.push_back(*it);
+                break;
+            }
+            default:
+                /* thunks, references and external objects may be shared through other means */
+                lean_mark_mt(o);
+                break;
             }
         }
     }
@@ -621,8 +1081,18 @@ extern "C" LEAN_EXPORT void lean_mark_mt(object * o) {
 
 LEAN_THREAD_PTR(lean_task_object, g_current_task_object);
 
-static lean_task_imp * alloc_task_imp(obj_arg c, unsigned prio, bool keep_alive) {
-    lean_task_imp * imp = (lean_task_imp*)lean_alloc_small_object(sizeof(lean_task_imp));
+/* Tasks that are not created finished are allocated together with their `lean_task_imp` record,
+   so that spawning a task or creating a promise takes a single small-object allocation, and
+   finishing it (usually on a different thread than the one that spawned it) does not release
+   memory into a foreign heap. The embedded record is dead once `m_imp` has been reset. */
+struct lean_task_with_imp {
+    lean_task_object m_task;
+    lean_task_imp    m_imp;
+};
+
+static lean_task_object * alloc_task_with_imp(obj_arg c, unsigned prio, bool keep_alive) {
+    lean_task_with_imp * o = (lean_task_with_imp*)lean_alloc_small_object(sizeof(lean_task_with_imp));
+    lean_task_imp * imp = &o->m_imp;
     imp->m_closure     = c;
     imp->m_head_dep    = nullptr;
     imp->m_next_dep    = nullptr;
@@ -630,34 +1100,218 @@ static lean_task_imp * alloc_task_imp(obj_arg c, unsigned prio, bool keep_alive)
     imp->m_canceled    = false;
     imp->m_keep_alive  = keep_alive;
     imp->m_deleted     = false;
-    return imp;
-}
-
-static void free_task_imp(lean_task_imp * imp) {
-    lean_free_small_object((lean_object*)imp);
+    o->m_task.m_value  = nullptr;
+    o->m_task.m_imp    = imp;
+    return &o->m_task;
 }
 
 static void free_task(lean_task_object * t) {
-    if (t->m_imp) free_task_imp(t->m_imp);
     lean_free_small_object((lean_object*)t);
 }
 
-struct scoped_current_task_object : flet<lean_task_object *> {
-    scoped_current_task_object(lean_task_object * t):flet(g_current_task_object, t) {}
+/* Cancellation flag of the task being executed by the current thread, see `lean_io_check_canceled_core`. */
+static uint8_t g_not_canceled = 0;
+LEAN_THREAD_VALUE(uint8_t const *, g_current_cancel_flag, &g_not_canceled);
+static bool g_task_manager_shutting_down = false;
+
+/* Counters of the task manager, enabled by `LEAN_TASK_STATS` and printed to `stderr` on exit. They
+   are global instead of members of `task_manager` so that they survive its destruction. */
+struct task_manager_stats {
+    atomic<uint64_t> m_enqueued{0};       // tasks added to the shared queues
+    atomic<uint64_t> m_enqueued_local{0}; // tasks added to the queue of the spawning worker
+    atomic<uint64_t> m_run_shared{0};     // tasks taken from the shared queues
+    atomic<uint64_t> m_run_own{0};        // tasks taken by a worker from its own queue
+    atomic<uint64_t> m_stolen{0};         // tasks stolen from a worker on the same NUMA node
+    atomic<uint64_t> m_stolen_remote{0};  // tasks stolen from a worker on another NUMA node
+    atomic<uint64_t> m_idle_waits{0};     // times a worker went to sleep waiting for tasks
+    /* Only updated while holding the task manager's mutex. */
+    unsigned         m_max_queued{0};
+    unsigned         m_max_workers{0};
+};
+static bool g_task_stats_enabled = false;
+static task_manager_stats * g_task_stats = nullptr;
+
+static void display_task_stats() {
+    task_manager_stats & s = *g_task_stats;
+    std::cerr << "task manager statistics:\n"
+              << "\tenqueued " << s.m_enqueued.load() << "\n"
+              << "\tenqueued local " << s.m_enqueued_local.load() << "\n"
+              << "\trun from shared queue " << s.m_run_shared.load() << "\n"
+              << "\trun from own queue " << s.m_run_own.load() << "\n"
+              << "\tstolen " << s.m_stolen.load() << "\n"
+              << "\tstolen remote " << s.m_stolen_remote.load() << "\n"
+              << "\tidle waits " << s.m_idle_waits.load() << "\n"
+              << "\tmax queued " << s.m_max_queued << "\n"
+              << "\tmax workers " << s.m_max_workers << "\n";
+}
+
+struct scoped_current_task_object {
+    flet<lean_task_object *> m_task;
+    flet<uint8_t const *>    m_cancel_flag;
+    scoped_current_task_object(lean_task_object * t):
+        m_task(g_current_task_object, t), m_cancel_flag(g_current_cancel_flag, &t->m_imp->m_canceled) {}
+};
+
+/* Queue of priority 0 tasks spawned by a standard worker while all workers are busy.
+   The owner pushes and pops tasks at the back, other workers steal them from the front.
+   See `task_manager::enqueue_local`. */
+struct worker_queue {
+    mutex                                         m_mutex;
+    std::deque<lean_task_object *>                m_tasks;
+    unsigned                                      m_node{0}; // NUMA node of the worker, see `task_manager::m_numa_nodes`
+};
+
+LEAN_THREAD_PTR(worker_queue, g_worker_queue);
+
+/* Number of tasks being run by `task_manager::wait_for` on the current thread instead of blocking.
+   A task run this way may in turn wait for another queued task, so beyond `LEAN_MAX_INLINE_TASK_DEPTH`
+   we block instead to keep the stack depth bounded. */
+#define LEAN_MAX_INLINE_TASK_DEPTH 32
+LEAN_THREAD_VALUE(unsigned, g_inline_task_depth, 0);
+
+/* Completion queue of an `IO.TaskSet`. Tasks are pushed by a sync continuation when they finish,
+   so consumers can take finished tasks in O(1) each instead of rescanning a list as `wait_any`
+   does. `m_size` counts the tasks added and not yet taken, finished or not. Protected by the
+   task manager's mutex. */
+struct task_set {
+    std::deque<object *> m_finished;
+    size_t               m_size{0};
 };
 
 class task_manager {
     mutex                                         m_mutex;
     std::vector<std::unique_ptr<lthread>>         m_std_workers;
-    unsigned                                      m_idle_std_workers{0};
-    unsigned                                      m_max_std_workers{0};
+    std::vector<std::unique_ptr<worker_queue>>    m_worker_queues;
+    /* The following counters are modified while holding `m_mutex`, but also read by `enqueue_local`. */
+    atomic<unsigned>                              m_num_std_workers{0};
+    atomic<unsigned>                              m_idle_std_workers{0};
+    atomic<unsigned>                              m_max_std_workers{0};
+    /* Configured size of the pool. `m_max_std_workers` is temporarily larger while workers are
+       blocked, see `begin_blocking`. */
+    unsigned                                      m_num_threads;
     unsigned                                      m_num_dedicated_workers{0};
     std::deque<lean_task_object *>                m_queues[LEAN_MAX_PRIO+1];
     unsigned                                      m_queues_size{0};
     unsigned                                      m_max_prio{0};
+    /* Number of tasks in `m_worker_queues`. */
+    atomic<unsigned>                              m_num_local_tasks{0};
     condition_variable                            m_queue_cv;
     condition_variable                            m_task_finished_cv;
     bool                                          m_shutting_down{false};
+    /* Callbacks registered using `IO.onCancel`, to be run when the task is canceled. */
+    std::unordered_map<lean_task_object *, std::vector<object *>> m_cancel_callbacks;
+    /* CPUs of each NUMA node if workers are pinned to nodes (`LEAN_PIN_WORKERS`), empty otherwise. */
+    std::vector<std::vector<unsigned>>            m_numa_nodes;
+
+    bool has_queued_tasks() const {
+        return m_queues_size != 0 || m_num_local_tasks != 0;
+    }
+
+    /* Enqueue `t` on the queue of the current worker without taking `m_mutex`, which is contended
+       when many workers spawn tasks. We only do so when all workers are busy: there is no idle
+       worker to notify, and no new worker can be spawned. An idle worker increments
+       `m_idle_std_workers` before checking `m_num_local_tasks`, so it cannot miss `t`. */
+    bool enqueue_local(lean_task_object * t) {
+        worker_queue * q = g_worker_queue;
+        if (q == nullptr || t->m_imp->m_prio != 0 ||
+            m_idle_std_workers != 0 || m_num_std_workers < m_max_std_workers)
+            return false;
+        {
+            lock_guard<mutex> lock(q->m_mutex);
+            q->m_tasks.push_back(t);
+            m_num_local_tasks++;
+        }
+        if (LEAN_UNLIKELY(g_task_stats_enabled))
+            g_task_stats->m_enqueued_local++;
+        if (m_idle_std_workers != 0) {
+            // a worker became idle in the meantime, it may be already waiting
+            unique_lock<mutex> lock(m_mutex);
+            m_queue_cv.notify_one();
+        }
+        return true;
+    }
+
+    lean_task_object * pop_local(worker_queue * q, bool back) {
+        lock_guard<mutex> lock(q->m_mutex);
+        if (q->m_tasks.empty())
+            return nullptr;
+        lean_task_object * t;
+        if (back) {
+            t = q->m_tasks.back();
+            q->m_tasks.pop_back();
+        } else {
+            t = q->m_tasks.front();
+            q->m_tasks.pop_front();
+        }
+        m_num_local_tasks--;
+        return t;
+    }
+
+    /* Return the next task to be executed by the current worker, or `nullptr` if another worker
+       took it first. Tasks with priority greater than 0 are executed first, then the tasks of the own
+       queue of the worker, the tasks with priority 0 enqueued by other threads, and finally tasks
+       stolen from other workers. */
+    lean_task_object * next_task() {
+        bool stats = g_task_stats_enabled;
+        if (m_queues_size != 0 && m_max_prio > 0) {
+            if (LEAN_UNLIKELY(stats)) g_task_stats->m_run_shared++;
+            return dequeue();
+        }
+        if (worker_queue * q = g_worker_queue) {
+            if (lean_task_object * t = pop_local(q, true)) {
+                if (LEAN_UNLIKELY(stats)) g_task_stats->m_run_own++;
+                return t;
+            }
+        }
+        if (m_queues_size != 0) {
+            if (LEAN_UNLIKELY(stats)) g_task_stats->m_run_shared++;
+            return dequeue();
+        }
+        /* Prefer stealing tasks spawned on the same NUMA node, as their data is more likely to be
+           in memory local to it. */
+        unsigned node = g_worker_queue ? g_worker_queue->m_node : 0;
+        for (auto & q : m_worker_queues) {
+            if (q->m_node == node) {
+                if (lean_task_object * t = pop_local(q.get(), false)) {
+                    if (LEAN_UNLIKELY(stats)) g_task_stats->m_stolen++;
+                    return t;
+                }
+            }
+        }
+        for (auto & q : m_worker_queues) {
+            if (q->m_node != node) {
+                if (lean_task_object * t = pop_local(q.get(), false)) {
+                    if (LEAN_UNLIKELY(stats)) g_task_stats->m_stolen_remote++;
+                    return t;
+                }
+            }
+        }
+        return nullptr;
+    }
+
+    std::vector<object *> take_cancel_callbacks(lean_task_object * t) {
+        std::vector<object *> r;
+        if (!m_cancel_callbacks.empty()) {
+            auto it = m_cancel_callbacks.find(t);
+            if (it != m_cancel_callbacks.end()) {
+                r.swap(it->second);
+                m_cancel_callbacks.erase(it);
+            }
+        }
+        return r;
+    }
+
+    static void run_cancel_callbacks(std::vector<object *> const & cbs) {
+        for (object * cb : cbs) {
+            object * r = lean_apply_1(cb, lean_io_mk_world());
+            lean_dec(r);
+        }
+    }
+
+    void update_max_prio() {
+        while (m_max_prio > 0 && m_queues[m_max_prio].empty())
+            --m_max_prio;
+    }
 
     lean_task_object * dequeue() {
         lean_assert(m_queues_size != 0);
@@ -666,14 +1320,45 @@ class task_manager {
         lean_task_object * result      = q.front();
         q.pop_front();
         m_queues_size--;
-        if (q.empty()) {
-            while (m_max_prio > 0) {
-                --m_max_prio;
-                if (!m_queues[m_max_prio].empty())
-                    break;
+        update_max_prio();
+        return result;
+    }
+
+    /* Remove `t` from the queues if it is waiting for a worker. Tasks are usually waited for soon
+       after being spawned, so we search the queues starting from the most recent tasks. */
+    bool take_queued(lean_task_object * t) {
+        if (worker_queue * q = g_worker_queue) {
+            lock_guard<mutex> lock(q->m_mutex);
+            auto it = std::find(q->m_tasks.rbegin(), q->m_tasks.rend(), t);
+            if (it != q->m_tasks.rend()) {
+                q->m_tasks.erase(std::next(it).base());
+                m_num_local_tasks--;
+                return true;
             }
         }
-        return result;
+        unsigned prio = t->m_imp->m_prio;
+        if (prio > LEAN_MAX_PRIO)
+            return false;
+        std::deque<lean_task_object *> & q = m_queues[prio];
+        auto it = std::find(q.rbegin(), q.rend(), t);
+        if (it != q.rend()) {
+            q.erase(std::next(it).base());
+            m_queues_size--;
+            update_max_prio();
+            return true;
+        }
+        for (auto & wq : m_worker_queues) {
+            if (wq.get() == g_worker_queue)
+                continue;
+            lock_guard<mutex> lock(wq->m_mutex);
+            auto it = std::find(wq->m_tasks.begin(), wq->m_tasks.end(), t);
+            if (it != wq->m_tasks.end()) {
+                wq->m_tasks.erase(it);
+                m_num_local_tasks--;
+                return true;
+            }
+        }
+        return false;
     }
 
     void enqueue_core(unique_lock<mutex> & lock, lean_task_object * t) {
@@ -691,7 +1376,13 @@ class task_manager {
             m_max_prio = prio;
         m_queues[prio].push_back(t);
         m_queues_size++;
-        if (!m_idle_std_workers && m_std_workers.size() < m_max_std_workers)
+        if (LEAN_UNLIKELY(task_trace_enabled()))
+            trace_task_queue_size(m_queues_size + m_num_local_tasks);
+        if (LEAN_UNLIKELY(g_task_stats_enabled)) {
+            g_task_stats->m_enqueued++;
+            g_task_stats->m_max_queued = std::max(g_task_stats->m_max_queued, m_queues_size + m_num_local_tasks);
+        }
+        if (!m_idle_std_workers && m_num_std_workers < m_max_std_workers)
             spawn_worker();
         else
             m_queue_cv.notify_one();
@@ -704,7 +1395,9 @@ class task_manager {
         t->m_imp->m_head_dep    = nullptr;
         t->m_imp->m_canceled    = true;
         t->m_imp->m_deleted     = true;
+        std::vector<object *> cbs = take_cancel_callbacks(t);
         lock.unlock();
+        run_cancel_callbacks(cbs);
         while (it) {
             lean_assert(it->m_imp->m_deleted);
             lean_task_object * next_it = it->m_imp->m_next_dep;
@@ -719,26 +1412,48 @@ class task_manager {
         if (m_shutting_down)
             return;
 
-        m_std_workers.emplace_back(new lthread([this]() {
+        m_worker_queues.emplace_back(new worker_queue());
+        worker_queue * q = m_worker_queues.back().get();
+        if (!m_numa_nodes.empty())
+            q->m_node = (m_worker_queues.size() - 1) % m_numa_nodes.size();
+        m_num_std_workers++;
+        if (LEAN_UNLIKELY(g_task_stats_enabled))
+            g_task_stats->m_max_workers = std::max<unsigned>(g_task_stats->m_max_workers, m_num_std_workers);
+        m_std_workers.emplace_back(new lthread([this, q]() {
             save_stack_info(false);
+            if (!m_numa_nodes.empty())
+                set_thread_affinity(m_numa_nodes[q->m_node]);
+            g_worker_queue = q;
             unique_lock<mutex> lock(m_mutex);
             m_idle_std_workers++;
             while (true) {
-                if (m_queues_size == 0 && m_shutting_down) {
+                if (!has_queued_tasks() && m_shutting_down) {
                     break;
                 }
-                if (m_queues_size == 0 ||
+                if (!has_queued_tasks() ||
                         // If we have reached the maximum number of standard workers (because the
                         // maximum was decreased by `task_get`), wait for someone else to become
                         // idle before picking up new work.
-                        m_std_workers.size() - m_idle_std_workers >= m_max_std_workers) {
+                        m_num_std_workers - m_idle_std_workers >= m_max_std_workers) {
+                    if (LEAN_UNLIKELY(g_task_stats_enabled))
+                        g_task_stats->m_idle_waits++;
                     m_queue_cv.wait(lock);
                     continue;
                 }
 
-                lean_task_object * t = dequeue();
+                lean_task_object * t = next_task();
+                if (t == nullptr) {
+                    // a local task was taken by its owner in the meantime
+                    continue;
+                }
+                if (LEAN_UNLIKELY(task_trace_enabled()))
+                    trace_task_queue_size(m_queues_size + m_num_local_tasks);
                 m_idle_std_workers--;
-                run_task(lock, t);
+                while (t) {
+                    lean_task_object * next = nullptr;
+                    run_task(lock, t, &next);
+                    t = next;
+                }
                 m_idle_std_workers++;
                 reset_heartbeat();
             }
@@ -757,7 +1472,9 @@ class task_manager {
         // `lthread` will be implicitly freed, which frees up its control resources but does not terminate the thread
     }
 
-    void run_task(unique_lock<mutex> & lock, lean_task_object * t) {
+    /* Execute `t`. If `next` is not null, it may be set to a dependent task of `t` that has become
+       ready and should be executed next by the caller, see `handle_finished`. */
+    void run_task(unique_lock<mutex> & lock, lean_task_object * t, lean_task_object ** next = nullptr) {
         lean_assert(t->m_imp);
         if (t->m_imp->m_deleted) {
             free_task(t);
@@ -770,7 +1487,12 @@ class task_manager {
             object * c = t->m_imp->m_closure;
             t->m_imp->m_closure = nullptr;
             lock.unlock();
+            bool trace = task_trace_enabled();
+            if (LEAN_UNLIKELY(trace))
+                trace_task_event(task_event::start, (lean_object*)t, t->m_imp->m_prio);
             v = lean_apply_1(c, box(0));
+            if (LEAN_UNLIKELY(trace))
+                trace_task_event(task_event::finish, (lean_object*)t);
             // If deactivation was delayed by `m_keep_alive`, deactivate after the final execution (`v != nulltpr`)
             if (v != nullptr && t->m_imp->m_keep_alive) {
                 lean_dec_ref((lean_object*)t);
@@ -785,7 +1507,7 @@ class task_manager {
             lock.lock();
         } else if (v != nullptr) {
             lean_assert(t->m_imp->m_closure == nullptr);
-            resolve_core(lock, t, v);
+            resolve_core(lock, t, v, next);
         } else {
             // `bind` task has not finished yet, re-add as dependency of nested task
             // NOTE: closure MUST be extracted before unlocking the mutex as otherwise
@@ -798,19 +1520,33 @@ class task_manager {
         }
     }
 
-    void resolve_core(unique_lock<mutex> & lock, lean_task_object * t, object * v) {
+    void resolve_core(unique_lock<mutex> & lock, lean_task_object * t, object * v, lean_task_object ** next = nullptr) {
         mark_mt(v);
         t->m_value = v;
         lean_task_imp * imp = t->m_imp;
         t->m_imp   = nullptr;
-        handle_finished(lock, t, imp);
-        /* After the task has been finished and we propagated
-           dependencies, we can release `imp` and keep just the value */
-        free_task_imp(imp);
+        /* `imp` is embedded in the task object, it is dead after propagating dependencies and
+           released together with the task */
+        handle_finished(lock, t, imp, next);
         m_task_finished_cv.notify_all();
+        std::vector<object *> cbs = take_cancel_callbacks(t);
+        if (!cbs.empty()) {
+            // the task cannot be canceled anymore
+            lock.unlock();
+            for (object * cb : cbs) lean_dec(cb);
+            lock.lock();
+        }
+    }
+
+    /* Return true if the ready task `t` can be executed by the worker that finished its dependency
+       instead of being enqueued. This saves a queue round-trip for `Task.map` and `Task.bind` chains.
+       We must not bypass queued tasks of higher priority. */
+    bool can_run_inline(lean_task_object * t) {
+        unsigned prio = t->m_imp->m_prio;
+        return prio <= LEAN_MAX_PRIO && (m_queues_size == 0 || prio >= m_max_prio);
     }
 
-    void handle_finished(unique_lock<mutex> & lock, lean_task_object * t, lean_task_imp * imp) {
+    void handle_finished(unique_lock<mutex> & lock, lean_task_object * t, lean_task_imp * imp, lean_task_object ** next = nullptr) {
         lean_task_object * it = imp->m_head_dep;
         imp->m_head_dep = nullptr;
         while (it) {
@@ -820,6 +1556,8 @@ class task_manager {
             it->m_imp->m_next_dep = nullptr;
             if (it->m_imp->m_deleted) {
                 free_task(it);
+            } else if (next && *next == nullptr && can_run_inline(it)) {
+                *next = it;
             } else {
                 enqueue_core(lock, it);
             }
@@ -827,6 +1565,26 @@ class task_manager {
         }
     }
 
+    /* Called before the current thread blocks on `m_task_finished_cv`. If it is a worker of the
+       standard pool, temporarily add another worker so that the pool can still make progress (see
+       `Task.get`). Returns whether `end_blocking` has to undo this. */
+    bool begin_blocking(unique_lock<mutex> &) {
+        bool in_pool = g_current_task_object && g_current_task_object->m_imp->m_prio <= LEAN_MAX_PRIO;
+        if (in_pool) {
+            m_max_std_workers++;
+            if (m_idle_std_workers == 0)
+                spawn_worker();
+            else
+                m_queue_cv.notify_one();
+        }
+        return in_pool;
+    }
+
+    void end_blocking(bool in_pool) {
+        if (in_pool)
+            m_max_std_workers--;
+    }
+
     object * wait_any_check(object * task_list) {
         object * it = task_list;
         while (!is_scalar(it)) {
@@ -840,13 +1598,21 @@ class task_manager {
 
 public:
     task_manager(unsigned max_std_workers):
-        m_max_std_workers(max_std_workers) {
+        m_max_std_workers(max_std_workers), m_num_threads(max_std_workers) {
+        /* `LEAN_PIN_WORKERS` distributes the standard workers over the NUMA nodes of the machine
+           in a round-robin fashion and restricts each worker to the CPUs of its node. */
+        if (std::getenv("LEAN_PIN_WORKERS")) {
+            m_numa_nodes = get_numa_node_cpus();
+            if (m_numa_nodes.size() < 2)
+                m_numa_nodes.clear();
+        }
     }
 
     ~task_manager() {
         {
             unique_lock<mutex> lock(m_mutex);
             m_shutting_down = true;
+            g_task_manager_shutting_down = true;
             // we can assume that `m_std_workers` will not be changed after this line
         }
         m_queue_cv.notify_all();
@@ -859,6 +1625,8 @@ public:
     }
 
     void enqueue(lean_task_object * t) {
+        if (enqueue_local(t))
+            return;
         unique_lock<mutex> lock(m_mutex);
         enqueue_core(lock, t);
     }
@@ -893,25 +1661,49 @@ public:
         t1->m_imp->m_head_dep = t2;
     }
 
+    /* Unregister the dependent task `t2` of the unfinished task `t1`. Returns `false` if `t2` is not
+       (anymore) waiting for `t1`, in which case it is either queued, running or finished. */
+    bool remove_dep(lean_task_object * t1, lean_task_object * t2) {
+        unique_lock<mutex> lock(m_mutex);
+        if (t1->m_value || !t1->m_imp || !t2->m_imp)
+            return false;
+        for (lean_task_object ** it = &t1->m_imp->m_head_dep; *it; it = &(*it)->m_imp->m_next_dep) {
+            if (*it == t2) {
+                *it = t2->m_imp->m_next_dep;
+                t2->m_imp->m_next_dep = nullptr;
+                return true;
+            }
+        }
+        return false;
+    }
+
     void wait_for(lean_task_object * t) {
         if (t->m_value)
             return;
         unique_lock<mutex> lock(m_mutex);
         if (t->m_value)
             return;
-        // see `Task.get`
-        bool in_pool = g_current_task_object && g_current_task_object->m_imp->m_prio <= LEAN_MAX_PRIO;
-        if (in_pool) {
-            m_max_std_workers++;
-            if (m_idle_std_workers == 0)
-                spawn_worker();
-            else
-                m_queue_cv.notify_one();
+        if (t->m_imp && g_inline_task_depth < LEAN_MAX_INLINE_TASK_DEPTH && take_queued(t)) {
+            /* Instead of blocking, run `t` on the current thread. It may not be finished afterwards
+               if it is a `bind` task waiting for the nested task. We keep the heartbeats of the
+               current thread, as `run_task` resets them. */
+            uint64_t heartbeats = get_num_heartbeats();
+            {
+                flet<unsigned> inc_depth(g_inline_task_depth, g_inline_task_depth + 1);
+                run_task(lock, t);
+            }
+            set_heartbeats(heartbeats);
+            if (t->m_value)
+                return;
         }
+        bool in_pool = begin_blocking(lock);
+        bool trace = task_trace_enabled();
+        if (LEAN_UNLIKELY(trace))
+            trace_task_event(task_event::wait_begin, (lean_object*)t);
         m_task_finished_cv.wait(lock, [&]() { return t->m_value != nullptr; });
-        if (in_pool) {
-            m_max_std_workers--;
-        }
+        if (LEAN_UNLIKELY(trace))
+            trace_task_event(task_event::wait_end, (lean_object*)t);
+        end_blocking(in_pool);
     }
 
     object * wait_any(object * task_list) {
@@ -925,6 +1717,41 @@ public:
         }
     }
 
+    void task_set_add(task_set * s) {
+        unique_lock<mutex> lock(m_mutex);
+        s->m_size++;
+    }
+
+    void task_set_push(task_set * s, object * t) {
+        {
+            unique_lock<mutex> lock(m_mutex);
+            s->m_finished.push_back(t);
+        }
+        m_task_finished_cv.notify_all();
+    }
+
+    /* Take a finished task from `s`, or return `nullptr` if `s` is empty or, when `!block`, no
+       task in it has finished yet. */
+    object * task_set_take(task_set * s, bool block) {
+        unique_lock<mutex> lock(m_mutex);
+        if (s->m_finished.empty()) {
+            if (!block || s->m_size == 0)
+                return nullptr;
+            bool in_pool = begin_blocking(lock);
+            m_task_finished_cv.wait(lock, [&]() { return !s->m_finished.empty(); });
+            end_blocking(in_pool);
+        }
+        object * t = s->m_finished.front();
+        s->m_finished.pop_front();
+        s->m_size--;
+        return t;
+    }
+
+    size_t task_set_size(task_set * s) {
+        unique_lock<mutex> lock(m_mutex);
+        return s->m_size;
+    }
+
     void deactivate_task(lean_task_object * t) {
         unique_lock<mutex> lock(m_mutex);
         if (object * v = t->m_value) {
@@ -940,14 +1767,63 @@ public:
     }
 
     void cancel(lean_task_object * t) {
+        if (LEAN_UNLIKELY(task_trace_enabled()))
+            trace_task_event(task_event::cancel, (lean_object*)t);
+        std::vector<object *> cbs;
+        {
+            unique_lock<mutex> lock(m_mutex);
+            if (t->m_imp) {
+                t->m_imp->m_canceled = true;
+                cbs = take_cancel_callbacks(t);
+            }
+        }
+        run_cancel_callbacks(cbs);
+    }
+
+    /* Run `cb` when `t` gets canceled, or immediately if it has already been canceled. */
+    void on_cancel(lean_task_object * t, object * cb) {
         unique_lock<mutex> lock(m_mutex);
-        if (t->m_imp)
-            t->m_imp->m_canceled = true;
+        if (t->m_imp && !t->m_imp->m_canceled) {
+            mark_mt(cb);
+            m_cancel_callbacks[t].push_back(cb);
+            return;
+        }
+        lock.unlock();
+        run_cancel_callbacks({cb});
     }
 
     bool shutting_down() const {
         return m_shutting_down;
     }
+
+    unsigned max_std_workers() const {
+        return m_max_std_workers;
+    }
+
+    unsigned num_threads() {
+        unique_lock<mutex> lock(m_mutex);
+        return m_num_threads;
+    }
+
+    /* Change the size of the pool of standard workers. When shrinking, surplus workers are not
+       terminated but stop picking up new work as soon as they finish their current task, as when
+       the maximum is restored after `begin_blocking`. */
+    void set_num_threads(unsigned n) {
+        lean_assert(n > 0);
+        unique_lock<mutex> lock(m_mutex);
+        if (n >= m_num_threads) {
+            m_max_std_workers += n - m_num_threads;
+        } else {
+            m_max_std_workers -= m_num_threads - n;
+        }
+        m_num_threads = n;
+        unsigned queued = m_queues_size + m_num_local_tasks;
+        while (queued > m_idle_std_workers && m_num_std_workers < m_max_std_workers) {
+            spawn_worker();
+            queued--;
+        }
+        m_queue_cv.notify_all();
+    }
 };
 
 static task_manager * g_task_manager = nullptr;
@@ -961,19 +1837,50 @@ extern "C" LEAN_EXPORT void lean_init_task_manager_using(unsigned num_workers) {
 #endif
 }
 
+#if defined(LEAN_MULTI_THREAD)
+/* Threads of a parallel `lean_mark_persistent`. The markers are started alongside the workers of
+   the task manager and should not use more cores than it, so programs without one mark
+   sequentially. WebAssembly builds do so as well, as their preallocated pthread pool has no workers
+   to spare for the markers (see `src/util/shell.cpp`). */
+static unsigned mark_persistent_num_threads() {
+#if defined(LEAN_WASM_PTHREAD_POOL_SIZE)
+    return 1;
+#else
+    if (g_task_manager == nullptr)
+        return 1;
+    return std::min({default_num_threads(), g_task_manager->max_std_workers(),
+                     static_cast<unsigned>(LEAN_MARK_PERSISTENT_MAX_THREADS)});
+#endif
+}
+#endif
+
 static unsigned get_lean_num_threads() {
 #ifndef LEAN_EMSCRIPTEN
     if (char const * num_threads = std::getenv("LEAN_NUM_THREADS")) {
         return atoi(num_threads);
     }
 #endif
-    return hardware_concurrency();
+    return default_num_threads();
 }
 
 extern "C" LEAN_EXPORT void lean_init_task_manager() {
     lean_init_task_manager_using(get_lean_num_threads());
 }
 
+/* getNumThreads : BaseIO Nat */
+extern "C" LEAN_EXPORT obj_res lean_io_get_num_threads(obj_arg) {
+    return io_result_mk_ok(lean_unsigned_to_nat(g_task_manager ? g_task_manager->num_threads() : 0));
+}
+
+/* setNumThreads (n : Nat) : BaseIO Unit */
+extern "C" LEAN_EXPORT obj_res lean_io_set_num_threads(b_obj_arg n, obj_arg) {
+    if (g_task_manager) {
+        size_t num = lean_is_scalar(n) ? lean_unbox(n) : SIZE_MAX;
+        g_task_manager->set_num_threads(std::max<size_t>(1, std::min<size_t>(num, UINT_MAX)));
+    }
+    return io_result_mk_ok(box(0));
+}
+
 extern "C" LEAN_EXPORT void lean_finalize_task_manager() {
     if (g_task_manager) {
         delete g_task_manager;
@@ -1015,11 +1922,11 @@ static inline void lean_set_task_header(lean_object * o) {
 }
 
 static lean_task_object * alloc_task(obj_arg c, unsigned prio, bool keep_alive) {
-    lean_mark_mt(c);
-    lean_task_object * o = (lean_task_object*)lean_alloc_small_object(sizeof(lean_task_object));
+    mark_mt_transfer(c);
+    lean_task_object * o = alloc_task_with_imp(c, prio, keep_alive);
+    if (LEAN_UNLIKELY(task_trace_enabled()))
+        trace_task_event(task_event::spawn, (lean_object*)o, prio, c);
     lean_set_task_header((lean_object*)o);
-    o->m_value = nullptr;
-    o->m_imp   = alloc_task_imp(c, prio, keep_alive);
     if (keep_alive)
         lean_inc_ref((lean_object*)o);
     return o;
@@ -1121,12 +2028,125 @@ extern "C" LEAN_EXPORT obj_res lean_task_bind_core(obj_arg x, obj_arg f, unsigne
     }
 }
 
+/* Data-parallel `Array.parMap`.
+
+   Instead of spawning one task per element (or per fixed-size chunk), the calling thread and at
+   most `max_std_workers() - 1` helper tasks share a single job object and claim index ranges from
+   an atomic cursor. Range sizes shrink with the remaining work (guided self-scheduling), so large
+   arrays are split lazily: few claims while there is plenty of work left, small ones near the end
+   to balance the tail. Helpers that are dequeued after the work has been exhausted return
+   immediately; the caller waits for all of them since they reference the job on its stack, also
+   when `f` throws an exception on the calling thread. */
+#define LEAN_PAR_MAP_MIN_SIZE 2
+
+struct par_map_job {
+    object *         m_fn;
+    object *         m_src;
+    object *         m_dst;
+    size_t           m_size;
+    size_t           m_num_workers;
+    atomic<size_t>   m_next{0};
+};
+
+static void par_map_run(par_map_job & job, bool helper) {
+    while (true) {
+        size_t next    = job.m_next.load(std::memory_order_relaxed);
+        if (next >= job.m_size)
+            return;
+        size_t chunk   = std::max<size_t>(1, (job.m_size - next) / (2 * job.m_num_workers));
+        size_t begin   = job.m_next.fetch_add(chunk, std::memory_order_relaxed);
+        if (begin >= job.m_size)
+            return;
+        size_t end     = std::min(job.m_size, begin + chunk);
+        for (size_t i = begin; i < end; i++) {
+            object * a = lean_array_get_core(job.m_src, i);
+            lean_inc(a);
+            lean_inc(job.m_fn);
+            object * r = lean_apply_1(job.m_fn, a);
+            /* results of helpers are returned to the calling thread */
+            if (helper)
+                mark_mt(r);
+            lean_array_set_core(job.m_dst, i, r);
+        }
+    }
+}
+
+static obj_res par_map_helper_fn(obj_arg job, obj_arg) {
+    par_map_run(*static_cast<par_map_job *>(reinterpret_cast<void *>(lean_unbox_usize(job))), true);
+    lean_dec(job);
+    return box(0);
+}
+
+/* Array.parMap (f : α → β) (as : Array α) : Array β */
+extern "C" LEAN_EXPORT obj_res lean_array_par_map(obj_arg f, obj_arg as) {
+    size_t sz = lean_array_size(as);
+    unsigned num_workers = g_task_manager ? g_task_manager->max_std_workers() : 1;
+    object * r = lean_alloc_array(sz, sz);
+    if (num_workers <= 1 || sz < LEAN_PAR_MAP_MIN_SIZE) {
+        for (size_t i = 0; i < sz; i++) {
+            object * a = lean_array_get_core(as, i);
+            lean_inc(a);
+            lean_inc(f);
+            lean_array_set_core(r, i, lean_apply_1(f, a));
+        }
+    } else {
+        for (size_t i = 0; i < sz; i++)
+            lean_array_set_core(r, i, box(0));
+        /* `f` and the elements of `as` are now shared with the helpers */
+        mark_mt(f);
+        mark_mt(as);
+        par_map_job job;
+        job.m_fn          = f;
+        job.m_src         = as;
+        job.m_dst         = r;
+        job.m_size        = sz;
+        job.m_num_workers = std::min<size_t>(num_workers, sz);
+        buffer<object *> helpers;
+        for (size_t i = 1; i < job.m_num_workers; i++) {
+            object * c = mk_closure_2_1(par_map_helper_fn, lean_box_usize(reinterpret_cast<size_t>(&job)));
+            helpers.push_back(lean_task_spawn_core(c, 0, false));
+        }
+        auto join_helpers = [&]() {
+            for (object * t : helpers) {
+                lean_task_get(t);
+                lean_dec(t);
+            }
+        };
+        try {
+            par_map_run(job, false);
+        } catch (...) {
+            /* `f` threw (e.g., on interruption). The helpers reference `job` on our stack, so they
+               must stop claiming ranges and finish before the exception leaves this frame. */
+            job.m_next = job.m_size;
+            join_helpers();
+            lean_dec(r);
+            lean_dec(f);
+            lean_dec(as);
+            throw;
+        }
+        join_helpers();
+    }
+    lean_dec(f);
+    lean_dec(as);
+    return r;
+}
+
 extern "C" LEAN_EXPORT bool lean_io_check_canceled_core() {
+    /* This function is called frequently from long-running computations; in the common case, it
+       only reads the cancellation flag of the current task through a thread-local pointer. */
+    if (*g_current_cancel_flag)
+        return true;
+    return LEAN_UNLIKELY(g_task_manager_shutting_down) && g_current_task_object != nullptr;
+}
+
+/* onCancel (act : BaseIO Unit) : BaseIO Unit */
+extern "C" LEAN_EXPORT obj_res lean_io_on_cancel(obj_arg act, obj_arg /* w */) {
     if (lean_task_object * t = g_current_task_object) {
-        lean_assert(t->m_imp); // task is being executed
-        return t->m_imp->m_canceled || g_task_manager->shutting_down();
+        g_task_manager->on_cancel(t, act);
+    } else {
+        lean_dec(act);
     }
-    return false;
+    return io_result_mk_ok(box(0));
 }
 
 extern "C" LEAN_EXPORT void lean_io_cancel_core(b_obj_arg t) {
@@ -1152,16 +2172,193 @@ extern "C" LEAN_EXPORT b_obj_res lean_io_wait_any_core(b_obj_arg task_list) {
     return g_task_manager->wait_any(task_list);
 }
 
+static lean_external_class * g_task_set_external_class = nullptr;
+static void task_set_finalizer(void * s) {
+    for (object * t : static_cast<task_set *>(s)->m_finished)
+        lean_dec(t);
+    delete static_cast<task_set *>(s);
+}
+static void task_set_foreach(void *, b_obj_arg) {}
+
+static task_set * task_set_get(b_obj_arg s) {
+    return static_cast<task_set *>(lean_get_external_data(s));
+}
+
+static obj_res task_set_notify_fn(obj_arg s, obj_arg t, obj_arg v) {
+    lean_dec(v);
+    g_task_manager->task_set_push(task_set_get(s), t);
+    lean_dec(s);
+    return box(0);
+}
+
+/* TaskSet.new : BaseIO (TaskSet α) */
+extern "C" LEAN_EXPORT obj_res lean_io_task_set_new(obj_arg) {
+    return io_result_mk_ok(lean_alloc_external(g_task_set_external_class, new task_set()));
+}
+
+/* TaskSet.add (s : @& TaskSet α) (t : Task α) : BaseIO Unit */
+extern "C" LEAN_EXPORT obj_res lean_io_task_set_add(b_obj_arg s, obj_arg t, obj_arg) {
+    task_set * ts = task_set_get(s);
+    if (!g_task_manager) {
+        ts->m_size++;
+        ts->m_finished.push_back(t);
+    } else if (lean_to_task(t)->m_value) {
+        g_task_manager->task_set_add(ts);
+        g_task_manager->task_set_push(ts, t);
+    } else {
+        g_task_manager->task_set_add(ts);
+        lean_inc(s);
+        lean_inc(t);
+        lean_dec(lean_task_map_core(mk_closure_3_2(task_set_notify_fn, s, t), t, 0, true, true));
+    }
+    return io_result_mk_ok(box(0));
+}
+
+static obj_res task_set_take(b_obj_arg s, bool block) {
+    task_set * ts = task_set_get(s);
+    object * t;
+    if (!g_task_manager) {
+        if (ts->m_finished.empty())
+            return io_result_mk_ok(mk_option_none());
+        t = ts->m_finished.front();
+        ts->m_finished.pop_front();
+        ts->m_size--;
+    } else {
+        t = g_task_manager->task_set_take(ts, block);
+        if (!t)
+            return io_result_mk_ok(mk_option_none());
+    }
+    return io_result_mk_ok(mk_option_some(t));
+}
+
+/* TaskSet.take? (s : @& TaskSet α) : BaseIO (Option (Task α)) */
+extern "C" LEAN_EXPORT obj_res lean_io_task_set_take(b_obj_arg s, obj_arg) {
+    return task_set_take(s, true);
+}
+
+/* TaskSet.tryTake? (s : @& TaskSet α) : BaseIO (Option (Task α)) */
+extern "C" LEAN_EXPORT obj_res lean_io_task_set_try_take(b_obj_arg s, obj_arg) {
+    return task_set_take(s, false);
+}
+
+/* TaskSet.size (s : @& TaskSet α) : BaseIO Nat */
+extern "C" LEAN_EXPORT obj_res lean_io_task_set_size(b_obj_arg s, obj_arg) {
+    task_set * ts = task_set_get(s);
+    size_t sz = g_task_manager ? g_task_manager->task_set_size(ts) : ts->m_size;
+    return io_result_mk_ok(lean_usize_to_nat(sz));
+}
+
+/* State shared by the continuations registered by `lean_io_select`. */
+struct select_state {
+    atomic<bool>          m_done{false};
+    /* Incremented once registration has finished and once by the first continuation; whoever
+       brings it to `2` unregisters the remaining continuations. */
+    atomic<unsigned>      m_stage{0};
+    object *              m_promise = nullptr;
+    std::vector<object *> m_inputs;
+    std::vector<object *> m_deps;
+};
+
+static lean_external_class * g_select_state_external_class = nullptr;
+static void select_state_finalizer(void * s) {
+    select_state * st = static_cast<select_state *>(s);
+    if (st->m_promise) lean_dec(st->m_promise);
+    delete st;
+}
+static void select_state_foreach(void *, b_obj_arg) {}
+
+static select_state * select_state_get(b_obj_arg s) {
+    return static_cast<select_state *>(lean_get_external_data(s));
+}
+
+/* Unregister the continuations that did not win. The caller must own a reference to the state. */
+static void select_cleanup(select_state * st) {
+    for (size_t i = 0; i < st->m_deps.size(); i++) {
+        lean_task_object * d = lean_to_task(st->m_deps[i]);
+        if (g_task_manager->remove_dep(lean_to_task(st->m_inputs[i]), d)) {
+            /* Nobody else can reach the continuation anymore, release it right away instead of
+               keeping it around until its input finishes, which might be never. */
+            object * c = d->m_imp->m_closure;
+            d->m_imp->m_closure = nullptr;
+            free_task(d);
+            lean_dec(c);
+        } else {
+            lean_dec(st->m_deps[i]);
+        }
+        lean_dec(st->m_inputs[i]);
+    }
+    st->m_deps.clear();
+    st->m_inputs.clear();
+    lean_dec(st->m_promise);
+    st->m_promise = nullptr;
+}
+
+static obj_res select_fn(obj_arg s, obj_arg idx, obj_arg v) {
+    select_state * st = select_state_get(s);
+    if (!st->m_done.exchange(true)) {
+        object * r = alloc_cnstr(0, 2, 0);
+        cnstr_set(r, 0, idx);
+        cnstr_set(r, 1, v);
+        lean_dec(lean_io_promise_resolve(r, st->m_promise, io_mk_world()));
+        if (st->m_stage.fetch_add(1) == 1)
+            select_cleanup(st);
+    } else {
+        lean_dec(idx);
+        lean_dec(v);
+    }
+    lean_dec(s);
+    return box(0);
+}
+
+static obj_res mk_select_result(size_t i, b_obj_arg t) {
+    object * v = lean_to_task(t)->m_value;
+    lean_inc(v);
+    object * r = alloc_cnstr(0, 2, 0);
+    cnstr_set(r, 0, lean_usize_to_nat(i));
+    cnstr_set(r, 1, v);
+    return lean_task_pure(mk_option_some(r));
+}
+
+/* IO.selectCore [Nonempty α] (tasks : @& Array (Task α)) : BaseIO (Task (Option (Nat × α))) */
+extern "C" LEAN_EXPORT obj_res lean_io_select(b_obj_arg tasks, obj_arg) {
+    size_t n = lean_array_size(tasks);
+    for (size_t i = 0; i < n; i++) {
+        if (lean_to_task(lean_array_get_core(tasks, i))->m_value)
+            return io_result_mk_ok(mk_select_result(i, lean_array_get_core(tasks, i)));
+    }
+    lean_always_assert(g_task_manager);
+
+    select_state * st = new select_state();
+    object * s = lean_alloc_external(g_select_state_external_class, st);
+    object * prom_res = lean_io_promise_new(io_mk_world());
+    st->m_promise = lean_ctor_get(prom_res, 0);
+    lean_inc(st->m_promise);
+    lean_dec(prom_res);
+    mark_mt(st->m_promise);
+    object * result = lean_io_promise_result_opt(st->m_promise);
+
+    for (size_t i = 0; i < n && !st->m_done.load(); i++) {
+        object * t = lean_array_get_core(tasks, i);
+        lean_inc(t);
+        st->m_inputs.push_back(t);
+        lean_inc(s);
+        lean_inc(t);
+        st->m_deps.push_back(lean_task_map_core(mk_closure_3_2(select_fn, s, lean_usize_to_nat(i)), t, 0, true, false));
+    }
+    if (st->m_stage.fetch_add(1) == 1)
+        select_cleanup(st);
+    lean_dec(s);
+    return io_result_mk_ok(result);
+}
+
 extern "C" LEAN_EXPORT obj_res lean_io_promise_new(obj_arg) {
     lean_always_assert(g_task_manager);
 
     bool keep_alive = false;
     unsigned prio = 0;
     object * closure = nullptr;
-    lean_task_object * t = (lean_task_object*)lean_alloc_small_object(sizeof(lean_task_object));
+    lean_task_object * t = alloc_task_with_imp(closure, prio, keep_alive);
     lean_set_task_header((lean_object*)t);
-    t->m_value = nullptr;
-    t->m_imp   = alloc_task_imp(closure, prio, keep_alive);
 
     lean_promise_object * o = (lean_promise_object *)lean_alloc_small_object(sizeof(lean_promise_object));
     lean_set_st_header((lean_object *)o, LeanPromise, 0);
@@ -1197,6 +2394,13 @@ object * alloc_mpz(mpz const & m) {
     return (lean_object*)o;
 }
 
+object * alloc_mpz(mpz && m) {
+    void * mem = lean_alloc_small_object(sizeof(mpz_object));
+    mpz_object * o = new (mem) mpz_object(std::move(m));
+    lean_set_st_header((lean_object*)o, LeanMPZ, 0);
+    return (lean_object*)o;
+}
+
 #ifdef LEAN_USE_GMP
 extern "C" LEAN_EXPORT lean_object * lean_alloc_mpz(mpz_t v) {
     return alloc_mpz(mpz(v));
@@ -1212,6 +2416,12 @@ object * mpz_to_nat_core(mpz const & m) {
     return alloc_mpz(m);
 }
 
+/* Most callers pass the temporary result of an operation, which we move into the new object. */
+object * mpz_to_nat_core(mpz && m) {
+    lean_assert(!m.is_size_t() || m.get_size_t() > LEAN_MAX_SMALL_NAT);
+    return alloc_mpz(std::move(m));
+}
+
 static inline obj_res mpz_to_nat(mpz const & m) {
     if (m.is_size_t() && m.get_size_t() <= LEAN_MAX_SMALL_NAT)
         return lean_box(m.get_size_t());
@@ -1219,6 +2429,13 @@ static inline obj_res mpz_to_nat(mpz const & m) {
         return mpz_to_nat_core(m);
 }
 
+static inline obj_res mpz_to_nat(mpz && m) {
+    if (m.is_size_t() && m.get_size_t() <= LEAN_MAX_SMALL_NAT)
+        return lean_box(m.get_size_t());
+    else
+        return mpz_to_nat_core(std::move(m));
+}
+
 extern "C" LEAN_EXPORT object * lean_cstr_to_nat(char const * n) {
     return mpz_to_nat(mpz(n));
 }
@@ -1467,9 +2684,14 @@ inline object * mpz_to_int_core(mpz const & m) {
     return alloc_mpz(m);
 }
 
-static object * mpz_to_int(mpz const & m) {
+inline object * mpz_to_int_core(mpz && m) {
+    lean_assert(m < LEAN_MIN_SMALL_INT || m > LEAN_MAX_SMALL_INT);
+    return alloc_mpz(std::move(m));
+}
+
+static object * mpz_to_int(mpz && m) {
     if (m < LEAN_MIN_SMALL_INT || m > LEAN_MAX_SMALL_INT)
-        return mpz_to_int_core(m);
+        return mpz_to_int_core(std::move(m));
     else
         return lean_box(static_cast<unsigned>(m.get_int()));
 }
@@ -1478,7 +2700,7 @@ extern "C" LEAN_EXPORT lean_obj_res lean_big_int_to_nat(lean_obj_arg a) {
     lean_assert(!lean_is_scalar(a));
     mpz m = mpz_value(a);
     lean_dec(a);
-    return mpz_to_nat(m);
+    return mpz_to_nat(std::move(m));
 }
 
 extern "C" LEAN_EXPORT object * lean_cstr_to_int(char const * n) {
@@ -2195,11 +3417,197 @@ extern "C" LEAN_EXPORT obj_res lean_string_utf8_extract(b_obj_arg s, b_obj_arg b
     /* In the reference implementation if `e` is not pointing to a valid UTF8
        character start position, it is assumed to be at the end. */
     if (e < sz && !is_utf8_first_byte(str[e])) e = sz;
+    if (b == 0 && e == sz) {
+        /* Strings are immutable, so sharing `s` is equivalent to copying it. */
+        lean_inc_ref(s);
+        return s;
+    }
     usize new_sz = e - b;
     lean_assert(new_sz > 0);
     return lean_mk_string_from_bytes_unchecked(lean_string_cstr(s) + b, new_sz);
 }
 
+/* The reference implementation is `String.posOfAux`:
+   ```
+   def posOfAux (s : String) (c : Char) (stopPos : Pos) (pos : Pos) : Pos :=
+     if pos < stopPos then
+       if s.get pos == c then pos
+       else posOfAux s c stopPos (s.next pos)
+     else pos
+   ```
+   Strings are valid UTF-8, so starting from a character boundary the loop visits exactly the positions
+   where the encoding of a character starts, and `s.get pos == c` holds iff the bytes at `pos` are the
+   encoding of `c`. Thus, we use `memchr` to find candidates instead of decoding each character. */
+extern "C" LEAN_EXPORT obj_res lean_string_pos_of_aux(b_obj_arg s, uint32 c, b_obj_arg stop0, b_obj_arg i0) {
+    if (!lean_is_scalar(stop0) || !lean_is_scalar(i0)) {
+        /* See comment at string_utf8_get */
+        lean_inc(i0);
+        object * i = i0;
+        while (lean_nat_lt(i, stop0)) {
+            if (lean_string_utf8_get(s, i) == c)
+                return i;
+            object * new_i = lean_string_utf8_next(s, i);
+            lean_dec(i);
+            i = new_i;
+        }
+        return i;
+    }
+    usize i    = lean_unbox(i0);
+    usize stop = lean_unbox(stop0);
+    char const * str = lean_string_cstr(s);
+    usize size = lean_string_size(s) - 1;
+    /* Positions inside a multi-byte character contain the default character and are stepped over one byte
+       at a time, see `lean_string_utf8_get` and `lean_string_utf8_next`. */
+    while (i < stop && i < size && !is_utf8_first_byte(str[i])) {
+        if (c == lean_char_default_value())
+            return lean_box(i);
+        i++;
+    }
+    if (i < stop && i < size) {
+        char enc[4];
+        unsigned n = push_unicode_scalar(enc, c);
+        usize end  = std::min(stop, size);
+        char const * it = str + i;
+        while (char const * p = static_cast<char const *>(memchr(it, enc[0], str + end - it))) {
+            usize j = p - str;
+            if (j + n <= size && memcmp(p, enc, n) == 0)
+                return lean_box(j);
+            it = p + 1;
+        }
+        /* `c` does not occur before `stop`, move to the first character boundary at or after it. */
+        i = end;
+        while (i < size && !is_utf8_first_byte(str[i]))
+            i++;
+    }
+    if (i < stop) {
+        /* Past the end of the string, `lean_string_utf8_get` returns the default character. */
+        return lean_box(c == lean_char_default_value() ? i : stop);
+    }
+    return lean_box(i);
+}
+
+static inline bool is_json_special_byte(unsigned char c) {
+    return c == '"' || c == '\\' || c < 0x20;
+}
+
+/* Whether one of the bytes of `w` is `"`, `\` or below `0x20`, see "Determine if a word has a byte
+   less than n" in Bit Twiddling Hacks. Each of the three tests is exact, so there are no false
+   positives. */
+static inline bool has_json_special_byte(uint64 w) {
+    uint64 ones = 0x0101010101010101ull;
+    uint64 high = 0x8080808080808080ull;
+    uint64 q = w ^ (ones * '"');
+    uint64 b = w ^ (ones * '\\');
+    return ((((q - ones) & ~q) | ((b - ones) & ~b) | ((w - ones * 0x20) & ~w)) & high) != 0;
+}
+
+/* Lean.Json.nextSpecialByte (s : @& String) (i : @& Nat) : Nat */
+extern "C" LEAN_EXPORT obj_res lean_json_next_special_byte(b_obj_arg s, b_obj_arg i0) {
+    usize size = lean_string_size(s) - 1;
+    if (!lean_is_scalar(i0) || lean_unbox(i0) >= size) {
+        /* See comment at string_utf8_get */
+        lean_inc(i0);
+        return i0;
+    }
+    char const * str = lean_string_cstr(s);
+    usize i = lean_unbox(i0);
+    /* Skip eight bytes at a time while none of them is special. */
+    for (; i + 8 <= size; i += 8) {
+        uint64 w;
+        memcpy(&w, str + i, sizeof(w));
+        if (has_json_special_byte(w))
+            break;
+    }
+    while (i < size && !is_json_special_byte(str[i]))
+        i++;
+    return lean_box(i);
+}
+
+/* Bytes of ASCII characters satisfying `isIdRest`, i.e. letters, digits, `_`, `'`, `!` and `?`. */
+static bool g_ascii_id_rest[256];
+
+static void init_ascii_id_rest() {
+    for (unsigned c = 0; c < 128; c++)
+        g_ascii_id_rest[c] = ('a' <= c && c <= 'z') || ('A' <= c && c <= 'Z') || ('0' <= c && c <= '9') ||
+            c == '_' || c == '\'' || c == '!' || c == '?';
+}
+
+/* Lean.Parser.asciiIdRestEnd (s : @& String) (i : @& Nat) : Nat */
+extern "C" LEAN_EXPORT obj_res lean_parser_ascii_id_rest_end(b_obj_arg s, b_obj_arg i0) {
+    usize size = lean_string_size(s) - 1;
+    if (!lean_is_scalar(i0) || lean_unbox(i0) >= size) {
+        /* See comment at string_utf8_get */
+        lean_inc(i0);
+        return i0;
+    }
+    unsigned char const * str = reinterpret_cast<unsigned char const *>(lean_string_cstr(s));
+    usize i = lean_unbox(i0);
+    while (i < size && g_ascii_id_rest[str[i]])
+        i++;
+    return lean_box(i);
+}
+
+/* Whether each byte of `w` is ` ` or `\n`, using the exact test for zero bytes of "Determine if a
+   word has a zero byte" in Bit Twiddling Hacks. */
+static inline bool is_all_blank(uint64 w) {
+    uint64 low = 0x7f7f7f7f7f7f7f7full;
+    uint64 ones = 0x0101010101010101ull;
+    uint64 sp = w ^ (ones * ' ');
+    uint64 nl = w ^ (ones * '\n');
+    // high bit of each byte set iff the byte is non-zero
+    uint64 sp_nz = ((sp & low) + low) | sp;
+    uint64 nl_nz = ((nl & low) + low) | nl;
+    return (sp_nz & nl_nz & ~low) == 0;
+}
+
+/* Lean.Parser.asciiBlankEnd (s : @& String) (i : @& Nat) : Nat */
+extern "C" LEAN_EXPORT obj_res lean_parser_ascii_blank_end(b_obj_arg s, b_obj_arg i0) {
+    usize size = lean_string_size(s) - 1;
+    if (!lean_is_scalar(i0) || lean_unbox(i0) >= size) {
+        /* See comment at string_utf8_get */
+        lean_inc(i0);
+        return i0;
+    }
+    char const * str = lean_string_cstr(s);
+    usize i = lean_unbox(i0);
+    /* Indentation comes in long runs of spaces, so skip eight bytes at a time. */
+    for (; i + 8 <= size; i += 8) {
+        uint64 w;
+        memcpy(&w, str + i, sizeof(w));
+        if (!is_all_blank(w))
+            break;
+    }
+    while (i < size && (str[i] == ' ' || str[i] == '\n'))
+        i++;
+    return lean_box(i);
+}
+
+/* Lean.Parser.nextCommentDelimByte (s : @& String) (i : @& Nat) : Nat */
+extern "C" LEAN_EXPORT obj_res lean_parser_next_comment_delim_byte(b_obj_arg s, b_obj_arg i0) {
+    usize size = lean_string_size(s) - 1;
+    if (!lean_is_scalar(i0) || lean_unbox(i0) >= size) {
+        /* See comment at string_utf8_get */
+        lean_inc(i0);
+        return i0;
+    }
+    char const * str = lean_string_cstr(s);
+    usize i = lean_unbox(i0);
+    uint64 ones = 0x0101010101010101ull;
+    uint64 high = 0x8080808080808080ull;
+    /* Skip eight bytes at a time while none of them is `-` or `/`, see `has_json_special_byte`. */
+    for (; i + 8 <= size; i += 8) {
+        uint64 w;
+        memcpy(&w, str + i, sizeof(w));
+        uint64 d = w ^ (ones * '-');
+        uint64 l = w ^ (ones * '/');
+        if ((((d - ones) & ~d) | ((l - ones) & ~l)) & high)
+            break;
+    }
+    while (i < size && str[i] != '-' && str[i] != '/')
+        i++;
+    return lean_box(i);
+}
+
 extern "C" LEAN_EXPORT obj_res lean_string_utf8_prev(b_obj_arg s, b_obj_arg i0) {
     if (!lean_is_scalar(i0)) {
         /* See comment at string_utf8_get */
@@ -2262,6 +3670,12 @@ extern "C" LEAN_EXPORT obj_res lean_string_of_usize(size_t n) {
     return mk_ascii_string_unchecked(std::to_string(n));
 }
 
+extern "C" LEAN_EXPORT obj_res lean_nat_big_repr(b_obj_arg n) {
+    if (lean_is_scalar(n))
+        return mk_ascii_string_unchecked(std::to_string(lean_unbox(n)));
+    return mk_ascii_string_unchecked(mpz_value(n).to_string());
+}
+
 // =======================================
 // ByteArray & FloatArray
 
@@ -2367,6 +3781,35 @@ extern "C" LEAN_EXPORT obj_res lean_byte_array_push(obj_arg a, uint8 b) {
     return r;
 }
 
+/* Position of the first `b` at or after `start`, or the array size if there is none. */
+extern "C" LEAN_EXPORT obj_res lean_byte_array_index_of(b_obj_arg a, uint8 b, b_obj_arg start) {
+    size_t sz = lean_sarray_size(a);
+    if (!lean_is_scalar(start) || lean_unbox(start) >= sz)
+        return lean_usize_to_nat(sz);
+    size_t i = lean_unbox(start);
+    uint8 const * data = lean_sarray_cptr(a);
+    void const * p = memchr(data + i, b, sz - i);
+    return lean_usize_to_nat(p ? static_cast<uint8 const *>(p) - data : sz);
+}
+
+/* Counting sort, which produces the same array as any other sort of the bytes. */
+extern "C" LEAN_EXPORT obj_res lean_byte_array_sort(obj_arg a) {
+    size_t sz = lean_sarray_size(a);
+    size_t counts[256] = {};
+    uint8 const * data = lean_sarray_cptr(a);
+    for (size_t i = 0; i < sz; i++)
+        counts[data[i]]++;
+    object * r = lean_is_exclusive(a) ? a : lean_alloc_sarray(1, sz, sz);
+    uint8 * it = lean_sarray_cptr(r);
+    for (unsigned b = 0; b < 256; b++) {
+        memset(it, b, counts[b]);
+        it += counts[b];
+    }
+    if (r != a)
+        lean_dec(a);
+    return r;
+}
+
 extern "C" LEAN_EXPORT uint64_t lean_byte_array_hash(b_obj_arg a) {
     return hash_str(lean_sarray_size(a), lean_sarray_cptr(a), 11);
 }
@@ -2410,6 +3853,55 @@ extern "C" LEAN_EXPORT obj_res lean_float_array_push(obj_arg a, double d) {
     return r;
 }
 
+/* Left-to-right sum, so that the result agrees with the reference `foldl`. */
+extern "C" LEAN_EXPORT double lean_float_array_sum(b_obj_arg a) {
+    double const * it  = reinterpret_cast<double const *>(lean_sarray_cptr(a));
+    double const * end = it + lean_sarray_size(a);
+    double r = 0.0;
+    for (; it != end; ++it)
+        r += *it;
+    return r;
+}
+
+extern "C" LEAN_EXPORT obj_res lean_copy_uint64_array(obj_arg a) {
+    return lean_copy_sarray(a, lean_sarray_capacity(a));
+}
+
+extern "C" LEAN_EXPORT obj_res lean_uint64_array_mk(obj_arg a) {
+    usize sz      = lean_array_size(a);
+    obj_res r     = lean_alloc_sarray(sizeof(uint64), sz, sz); // NOLINT
+    object ** it  = lean_array_cptr(a);
+    object ** end = it + sz;
+    uint64 * dest = reinterpret_cast<uint64*>(lean_sarray_cptr(r));
+    for (; it != end; ++it, ++dest) {
+        *dest = lean_unbox_uint64(*it);
+    }
+    lean_dec(a);
+    return r;
+}
+
+extern "C" LEAN_EXPORT obj_res lean_uint64_array_data(obj_arg a) {
+    usize sz       = lean_sarray_size(a);
+    obj_res r      = lean_alloc_array(sz, sz);
+    uint64 * it    = reinterpret_cast<uint64*>(lean_sarray_cptr(a));
+    uint64 * end   = it+sz;
+    object ** dest = lean_array_cptr(r);
+    for (; it != end; ++it, ++dest) {
+        *dest = lean_box_uint64(*it);
+    }
+    lean_dec(a);
+    return r;
+}
+
+extern "C" LEAN_EXPORT obj_res lean_uint64_array_push(obj_arg a, uint64 v) {
+    object * r = lean_sarray_ensure_exclusive(lean_sarray_ensure_capacity(a, lean_sarray_size(a) + 1, /* exact */ false));
+    size_t & sz  = lean_to_sarray(r)->m_size;
+    uint64 * it  = reinterpret_cast<uint64*>(lean_sarray_cptr(r)) + sz;
+    *it = v;
+    sz++;
+    return r;
+}
+
 // =======================================
 // Array functions for generated code
 
@@ -2479,6 +3971,35 @@ extern "C" LEAN_EXPORT object * lean_array_push(obj_arg a, obj_arg v) {
     return r;
 }
 
+extern "C" LEAN_EXPORT obj_res lean_array_extract(obj_arg a, b_obj_arg o_start, b_obj_arg o_stop) {
+    size_t sz    = lean_array_size(a);
+    size_t stop  = lean_is_scalar(o_stop) ? std::min(lean_unbox(o_stop), sz) : sz;
+    size_t start = lean_is_scalar(o_start) ? std::min(lean_unbox(o_start), stop) : stop;
+    size_t len   = stop - start;
+    // the result has no spare capacity, so that extracting a small range does not keep a large buffer alive
+    if (len == sz && lean_array_capacity(a) == sz)
+        return a;
+    object * r     = lean_alloc_array(len, len);
+    object ** it   = lean_array_cptr(a);
+    object ** dest = lean_array_cptr(r);
+    if (lean_is_exclusive(a)) {
+        // transfer ownership of the elements in the range directly instead of inc+dec
+        for (size_t i = 0; i < start; i++)
+            lean_dec(it[i]);
+        for (size_t i = stop; i < sz; i++)
+            lean_dec(it[i]);
+        memcpy(dest, it + start, len * sizeof(object *));
+        lean_dealloc(a, lean_array_byte_size(a));
+    } else {
+        for (size_t i = start; i < stop; i++, dest++) {
+            *dest = it[i];
+            lean_inc(it[i]);
+        }
+        lean_dec(a);
+    }
+    return r;
+}
+
 // =======================================
 // Name primitives
 
@@ -2497,7 +4018,7 @@ extern "C" LEAN_EXPORT uint8 lean_name_eq(b_lean_obj_arg n1, b_lean_obj_arg n2)
             if (!lean_string_eq(lean_ctor_get(n1, 1), lean_ctor_get(n2, 1)))
                 return false;
         } else {
-            if (!lean_nat_eq(lean_ctor_get(n1, 1), lean_ctor_get(n1, 1)))
+            if (!lean_nat_eq(lean_ctor_get(n1, 1), lean_ctor_get(n2, 1)))
                 return false;
         }
         n1 = lean_ctor_get(n1, 0);
@@ -2572,15 +4093,30 @@ extern "C" LEAN_EXPORT lean_external_class * lean_register_external_class(lean_e
 }
 
 void initialize_object() {
+    init_ascii_id_rest();
     g_ext_classes       = new std::vector<external_object_class*>();
     g_ext_classes_mutex = new mutex();
     g_array_empty       = lean_alloc_array(0, 0);
     mark_persistent(g_array_empty);
+    g_thunk_wait_stripes  = new thunk_wait_stripe[LEAN_THUNK_WAIT_STRIPES];
+    g_deferred_free_mutex = new mutex();
+    g_deferred_free_cv    = new condition_variable();
+    g_deferred_free_todo  = new std::vector<object *>();
+    g_task_set_external_class = lean_register_external_class(task_set_finalizer, task_set_foreach);
+    g_select_state_external_class = lean_register_external_class(select_state_finalizer, select_state_foreach);
+    if (std::getenv("LEAN_DEFERRED_FREE"))
+        set_deferred_free(true);
+    g_task_stats = new task_manager_stats();
+    if (std::getenv("LEAN_TASK_STATS")) {
+        g_task_stats_enabled = true;
+        std::atexit(display_task_stats);
+    }
 }
 
 void finalize_object() {
     for (external_object_class * cls : *g_ext_classes) delete cls;
     delete g_ext_classes;
     delete g_ext_classes_mutex;
+    delete[] g_thunk_wait_stripes;
 }
 }
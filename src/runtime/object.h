@@ -23,6 +23,7 @@ struct mpz_object {
     mpz         m_value;
     mpz_object() {}
     explicit mpz_object(mpz const & m):m_value(m) {}
+    explicit mpz_object(mpz && m):m_value(std::move(m)) {}
 };
 
 typedef lean_external_class         external_object_class;
@@ -64,6 +65,11 @@ inline bool is_ref(object * o) { return lean_is_ref(o); }
 
 inline void mark_persistent(object * o) { return lean_mark_persistent(o); }
 
+/* If the current thread is in a region, copy the objects of the region reachable from `o` to the
+   heap outside of it, and return the copy of `o`. Objects that outlive the region, such as
+   persistent ones, must be copied out first. See `scoped_region`. */
+LEAN_EXPORT obj_res copy_out_of_active_region(obj_arg o);
+
 inline unsigned obj_tag(b_obj_arg o) { return lean_obj_tag(o); }
 
 // =======================================
@@ -175,6 +181,8 @@ inline object* apply_m(object* f, unsigned n, object** args) { return lean_apply
 // MPZ
 
 LEAN_EXPORT object * alloc_mpz(mpz const &);
+/* Move `m` into a new object, avoiding the allocation and copy of its digits. */
+LEAN_EXPORT object * alloc_mpz(mpz && m);
 inline mpz_object * to_mpz(object * o) { lean_assert(is_mpz(o)); return (mpz_object*)o; }
 
 // =======================================
@@ -215,6 +223,8 @@ inline void sarray_set_size(u_obj_arg o, size_t sz) { lean_sarray_set_size(o, sz
 inline unsigned sarray_elem_size(object * o) { return lean_sarray_elem_size(o); }
 inline size_t sarray_capacity(object * o) { return lean_sarray_capacity(o); }
 inline uint8 * sarray_cptr(object * o) { return lean_sarray_cptr(o); }
+obj_res lean_sarray_ensure_exclusive(obj_arg a);
+extern "C" LEAN_EXPORT obj_res lean_sarray_ensure_capacity(obj_arg a, size_t min_cap, bool exact);
 
 // =======================================
 // ByteArray
@@ -307,6 +317,7 @@ inline obj_res mk_option_some(obj_arg v) { obj_res r = alloc_cnstr(1, 1, 0); cns
 
 inline mpz const & mpz_value(b_obj_arg o) { return to_mpz(o)->m_value; }
 LEAN_EXPORT object * mpz_to_nat_core(mpz const & m);
+LEAN_EXPORT object * mpz_to_nat_core(mpz && m);
 inline object * mk_nat_obj_core(mpz const & m) { return mpz_to_nat_core(m); }
 inline obj_res mk_nat_obj(mpz const & m) {
     if (m.is_size_t() && m.get_size_t() <= LEAN_MAX_SMALL_NAT)
@@ -475,6 +486,11 @@ extern "C" LEAN_EXPORT obj_res lean_get_or_block(obj_arg opt);
 
 // =======================================
 // Module initialization/finalization
+/* When `flag` is true, large multi-threaded object graphs whose reference counter drops to zero
+   are partially deleted by a background thread, avoiding long pauses in the current thread.
+   It can also be enabled by setting the `LEAN_DEFERRED_FREE` environment variable. */
+LEAN_EXPORT void set_deferred_free(bool flag);
+
 void initialize_object();
 void finalize_object();
 }
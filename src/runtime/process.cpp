@@ -25,6 +25,12 @@ Author: Jared Roesch
 #include <sys/wait.h>
 #include <signal.h>
 #include <limits.h> // NOLINT
+#include <spawn.h>
+#include <vector>
+#endif
+
+#ifdef __APPLE__
+#include <crt_externs.h>
 #endif
 
 #ifdef __linux
@@ -412,6 +418,99 @@ static optional<pipe> setup_stdio(stdio cfg) {
     lean_unreachable();
 }
 
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 29))
+#define LEAN_POSIX_SPAWN_CHDIR
+#endif
+
+static char ** current_environ() {
+#ifdef __APPLE__
+    return *_NSGetEnviron();
+#else
+    return environ;
+#endif
+}
+
+static int spawn_file_action(posix_spawn_file_actions_t * actions, optional<pipe> const & p, stdio mode, int fd, bool in) {
+    if (p) {
+        return posix_spawn_file_actions_adddup2(actions, in ? p->m_read_fd : p->m_write_fd, fd);
+    } else if (mode == stdio::NUL) {
+        return posix_spawn_file_actions_addopen(actions, fd, "/dev/null", in ? O_RDONLY : O_WRONLY, 0);
+    }
+    return 0;
+}
+
+/* Start the process using `posix_spawnp`, which unlike `fork` does not need to copy the page tables of the
+   (potentially very large) parent process. Returns `false` if the requested configuration cannot be expressed
+   with `posix_spawn` on this platform or if spawning failed, in which case the caller falls back to `fork`,
+   which also takes care of reporting the error. */
+static bool try_posix_spawn(string_ref const & proc_name, array_ref<string_ref> const & args,
+  stdio stdin_mode, optional<pipe> const & stdin_pipe, stdio stdout_mode, optional<pipe> const & stdout_pipe,
+  stdio stderr_mode, optional<pipe> const & stderr_pipe, option_ref<string_ref> const & cwd,
+  array_ref<pair_ref<string_ref, option_ref<string_ref>>> const & env, bool do_setsid, pid_t & pid) {
+#ifndef LEAN_POSIX_SPAWN_CHDIR
+    if (cwd) return false;
+#endif
+#ifndef POSIX_SPAWN_SETSID
+    if (do_setsid) return false;
+#endif
+    /* `posix_spawnp` searches the `PATH` of the parent, while `execvp` in the child would use the modified one. */
+    for (auto & entry : env) {
+        if (strcmp(entry.fst().data(), "PATH") == 0) return false;
+    }
+
+    std::vector<std::string> env_entries;
+    auto is_overridden = [&](char const * var, size_t len) {
+        for (auto & entry : env) {
+            if (strlen(entry.fst().data()) == len && strncmp(entry.fst().data(), var, len) == 0) return true;
+        }
+        return false;
+    };
+    for (char ** e = current_environ(); *e; e++) {
+        char const * eq = strchr(*e, '=');
+        if (!eq || !is_overridden(*e, eq - *e)) env_entries.push_back(*e);
+    }
+    for (size_t i = 0; i < env.size(); i++) {
+        auto const & entry = env[i];
+        bool set_later = false;
+        for (size_t j = i + 1; j < env.size(); j++) {
+            if (strcmp(env[j].fst().data(), entry.fst().data()) == 0) set_later = true;
+        }
+        if (!set_later && entry.snd()) {
+            env_entries.push_back(std::string(entry.fst().data()) + "=" + entry.snd().get()->data());
+        }
+    }
+    std::vector<char *> envp;
+    for (auto & e : env_entries) envp.push_back(const_cast<char *>(e.c_str()));
+    envp.push_back(nullptr);
+
+    std::vector<char *> pargs;
+    pargs.push_back(const_cast<char *>(proc_name.data()));
+    for (auto & arg : args)
+        pargs.push_back(const_cast<char *>(arg.data()));
+    pargs.push_back(nullptr);
+
+    posix_spawn_file_actions_t actions;
+    if (posix_spawn_file_actions_init(&actions) != 0) return false;
+    posix_spawnattr_t attr;
+    if (posix_spawnattr_init(&attr) != 0) {
+        posix_spawn_file_actions_destroy(&actions);
+        return false;
+    }
+    int r = spawn_file_action(&actions, stdin_pipe, stdin_mode, STDIN_FILENO, true);
+    if (r == 0) r = spawn_file_action(&actions, stdout_pipe, stdout_mode, STDOUT_FILENO, false);
+    if (r == 0) r = spawn_file_action(&actions, stderr_pipe, stderr_mode, STDERR_FILENO, false);
+#ifdef LEAN_POSIX_SPAWN_CHDIR
+    if (r == 0 && cwd) r = posix_spawn_file_actions_addchdir_np(&actions, cwd.get()->data());
+#endif
+#ifdef POSIX_SPAWN_SETSID
+    if (r == 0 && do_setsid) r = posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSID);
+#endif
+    if (r == 0) r = posix_spawnp(&pid, pargs[0], &actions, &attr, pargs.data(), envp.data());
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&actions);
+    return r == 0;
+}
+
 static obj_res spawn(string_ref const & proc_name, array_ref<string_ref> const & args, stdio stdin_mode, stdio stdout_mode,
   stdio stderr_mode, option_ref<string_ref> const & cwd, array_ref<pair_ref<string_ref, option_ref<string_ref>>> const & env,
   bool do_setsid) {
@@ -420,7 +519,11 @@ static obj_res spawn(string_ref const & proc_name, array_ref<string_ref> const &
     auto stdout_pipe = setup_stdio(stdout_mode);
     auto stderr_pipe = setup_stdio(stderr_mode);
 
-    int pid = fork();
+    pid_t pid;
+    if (!try_posix_spawn(proc_name, args, stdin_mode, stdin_pipe, stdout_mode, stdout_pipe, stderr_mode, stderr_pipe,
+                         cwd, env, do_setsid, pid)) {
+        pid = fork();
+    }
 
     if (pid == 0) {
         for (auto & entry : env) {
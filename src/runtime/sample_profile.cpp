@@ -0,0 +1,234 @@
+/*
+Copyright (c) 2025 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+*/
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <vector>
+#include "runtime/sample_profile.h"
+#include "runtime/thread.h"
+
+/* Stacks are recorded by walking the frame pointers of the interrupted thread, starting from its
+   registers as saved in the signal context, so only the platforms whose context layout we know are
+   supported. */
+#if (defined(__linux__) || defined(__APPLE__)) && (defined(__x86_64__) || defined(__aarch64__)) && !defined(LEAN_EMSCRIPTEN)
+#define LEAN_SUPPORTS_SAMPLE_PROFILE 1
+#include <signal.h>
+#include <sys/time.h>
+#include <ucontext.h>
+#else
+#define LEAN_SUPPORTS_SAMPLE_PROFILE 0
+#endif
+
+namespace lean {
+#if LEAN_SUPPORTS_SAMPLE_PROFILE
+
+#define LEAN_SAMPLE_PROFILE_PERIOD_US 10000
+#define LEAN_SAMPLE_PROFILE_MAX_DEPTH 64
+// Number of samples that can be recorded before the buffer is drained, see `sample_profile_drain`.
+#define LEAN_SAMPLE_PROFILE_BUFFER_SIZE 4096
+// Largest distance between consecutive frame pointers that we accept as a valid frame.
+#define LEAN_SAMPLE_PROFILE_MAX_FRAME 1048576
+
+enum class sample_state : int { free, writing, ready };
+
+/* Samples are written by the signal handler, which must neither allocate nor take locks. */
+struct sample_slot {
+    atomic<int> m_state;
+    int         m_depth;
+    void *      m_pcs[LEAN_SAMPLE_PROFILE_MAX_DEPTH];
+};
+
+static bool g_sample_profile = false;
+static char const * g_sample_profile_fname = nullptr;
+static sample_slot * g_sample_buffer = nullptr;
+static atomic<size_t> g_sample_next(0);
+static atomic<uint64_t> g_samples_dropped(0);
+/* Aggregated stacks, protected by `g_sample_profile_mutex`. */
+static mutex * g_sample_profile_mutex = nullptr;
+static std::map<std::vector<void *>, uint64_t> * g_sample_stacks = nullptr;
+
+/* Registers of the interrupted code, read from the signal context `ctx`. */
+static void get_context_regs(void * ctx, uintptr_t & pc, uintptr_t & fp, uintptr_t & sp) {
+    ucontext_t * uc = static_cast<ucontext_t *>(ctx);
+#if defined(__APPLE__) && defined(__x86_64__)
+    pc = uc->uc_mcontext->__ss.__rip;
+    fp = uc->uc_mcontext->__ss.__rbp;
+    sp = uc->uc_mcontext->__ss.__rsp;
+#elif defined(__APPLE__)
+    pc = uc->uc_mcontext->__ss.__pc;
+    fp = uc->uc_mcontext->__ss.__fp;
+    sp = uc->uc_mcontext->__ss.__sp;
+#elif defined(__x86_64__)
+    pc = uc->uc_mcontext.gregs[REG_RIP];
+    fp = uc->uc_mcontext.gregs[REG_RBP];
+    sp = uc->uc_mcontext.gregs[REG_RSP];
+#else
+    pc = uc->uc_mcontext.pc;
+    fp = uc->uc_mcontext.regs[29];
+    sp = uc->uc_mcontext.sp;
+#endif
+}
+
+/* Record the stack of the interrupted code into `pcs`. We cannot use `backtrace` here, which is not
+   async-signal-safe: it may take the locks of the unwinder or of `malloc`, which the interrupted
+   thread may be holding. Instead we follow the chain of frame records `[previous fp, return address]`,
+   which is only complete where the code is compiled with frame pointers. Frame pointers that do not
+   point above the current frame within `LEAN_SAMPLE_PROFILE_MAX_FRAME` bytes, e.g. because the
+   register is used for other purposes in code without frame pointers, end the walk instead of
+   being dereferenced. */
+static int sample_stack(void * ctx, void ** pcs) {
+    uintptr_t pc, fp, sp;
+    get_context_regs(ctx, pc, fp, sp);
+    int depth = 0;
+    pcs[depth++] = reinterpret_cast<void *>(pc);
+    uintptr_t prev = sp;
+    while (depth < LEAN_SAMPLE_PROFILE_MAX_DEPTH) {
+        if (fp < prev || fp - prev > LEAN_SAMPLE_PROFILE_MAX_FRAME || fp % sizeof(uintptr_t) != 0)
+            break;
+        uintptr_t * frame = reinterpret_cast<uintptr_t *>(fp);
+        uintptr_t ret = frame[1];
+        if (ret == 0)
+            break;
+        pcs[depth++] = reinterpret_cast<void *>(ret);
+        prev = fp + 2 * sizeof(uintptr_t);
+        fp   = frame[0];
+    }
+    return depth;
+}
+
+static void sample_profile_handler(int, siginfo_t *, void * ctx) {
+    int saved_errno = errno;
+    size_t i = g_sample_next.fetch_add(1, memory_order_relaxed) % LEAN_SAMPLE_PROFILE_BUFFER_SIZE;
+    sample_slot & slot = g_sample_buffer[i];
+    int expected = static_cast<int>(sample_state::free);
+    if (slot.m_state.compare_exchange_strong(expected, static_cast<int>(sample_state::writing))) {
+        slot.m_depth = sample_stack(ctx, slot.m_pcs);
+        slot.m_state.store(static_cast<int>(sample_state::ready), memory_order_release);
+    } else {
+        g_samples_dropped.fetch_add(1, memory_order_relaxed);
+    }
+    errno = saved_errno;
+}
+
+/* Move the recorded samples from the buffer into `g_sample_stacks`. */
+static void sample_profile_drain() {
+    lock_guard<mutex> lock(*g_sample_profile_mutex);
+    std::vector<void *> stack;
+    for (size_t i = 0; i < LEAN_SAMPLE_PROFILE_BUFFER_SIZE; i++) {
+        sample_slot & slot = g_sample_buffer[i];
+        if (slot.m_state.load(memory_order_acquire) != static_cast<int>(sample_state::ready))
+            continue;
+        stack.assign(slot.m_pcs, slot.m_pcs + slot.m_depth);
+        slot.m_state.store(static_cast<int>(sample_state::free), memory_order_release);
+        (*g_sample_stacks)[stack]++;
+    }
+}
+
+static void write_word(std::ostream & out, uintptr_t w) {
+    out.write(reinterpret_cast<char const *>(&w), sizeof(w));
+}
+
+static void write_sample_profile(std::ostream & out) {
+    lock_guard<mutex> lock(*g_sample_profile_mutex);
+    // header: header count, header words, format version, sampling period, padding
+    write_word(out, 0);
+    write_word(out, 3);
+    write_word(out, 0);
+    write_word(out, LEAN_SAMPLE_PROFILE_PERIOD_US);
+    write_word(out, 0);
+    for (auto const & p : *g_sample_stacks) {
+        write_word(out, p.second);
+        write_word(out, p.first.size());
+        for (void * pc : p.first)
+            write_word(out, reinterpret_cast<uintptr_t>(pc));
+    }
+    // trailer
+    write_word(out, 0);
+    write_word(out, 1);
+    write_word(out, 0);
+    // `pprof` maps addresses to binaries using the memory map.
+    std::ifstream maps("/proc/self/maps");
+    if (maps)
+        out << maps.rdbuf();
+}
+
+static void stop_sample_profile_timer() {
+    struct itimerval timer;
+    memset(&timer, 0, sizeof(timer));
+    setitimer(ITIMER_PROF, &timer, nullptr);
+}
+
+static void write_sample_profile_at_exit() {
+    stop_sample_profile_timer();
+    sample_profile_drain();
+    std::ofstream out(g_sample_profile_fname, std::ios::binary);
+    write_sample_profile(out);
+    if (uint64_t dropped = g_samples_dropped.load())
+        std::cerr << "sample profile: dropped " << dropped << " samples\n";
+}
+
+bool sample_profile_supported() {
+    return true;
+}
+
+void start_sample_profile(char const * fname) {
+    if (g_sample_profile)
+        return;
+    g_sample_profile = true;
+    g_sample_profile_fname = fname;
+    g_sample_buffer = new sample_slot[LEAN_SAMPLE_PROFILE_BUFFER_SIZE];
+    for (size_t i = 0; i < LEAN_SAMPLE_PROFILE_BUFFER_SIZE; i++)
+        g_sample_buffer[i].m_state.store(static_cast<int>(sample_state::free), memory_order_relaxed);
+    std::atexit(write_sample_profile_at_exit);
+
+#if defined(LEAN_MULTI_THREAD)
+    // Drain the buffer regularly so that long runs do not drop samples.
+    lthread([]() {
+        while (true) {
+            this_thread::sleep_for(chrono::milliseconds(100));
+            sample_profile_drain();
+        }
+    });
+    // `lthread` will be implicitly freed, which frees up its control resources but does not terminate the thread
+#endif
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_sigaction = sample_profile_handler;
+    action.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGPROF, &action, nullptr);
+
+    struct itimerval timer;
+    timer.it_interval.tv_sec  = 0;
+    timer.it_interval.tv_usec = LEAN_SAMPLE_PROFILE_PERIOD_US;
+    timer.it_value = timer.it_interval;
+    setitimer(ITIMER_PROF, &timer, nullptr);
+}
+
+void initialize_sample_profile() {
+    g_sample_profile_mutex = new mutex();
+    g_sample_stacks = new std::map<std::vector<void *>, uint64_t>();
+    if (char const * fname = std::getenv("LEAN_SAMPLE_PROFILE"))
+        start_sample_profile(fname);
+}
+
+#else
+
+bool sample_profile_supported() {
+    return false;
+}
+
+void start_sample_profile(char const *) {
+}
+
+void initialize_sample_profile() {
+}
+
+#endif
+}
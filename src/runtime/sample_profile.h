@@ -0,0 +1,22 @@
+/*
+Copyright (c) 2025 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+*/
+#pragma once
+#include <lean/lean.h>
+
+namespace lean {
+/* Opt-in sampling profiler. While it runs, `SIGPROF` interrupts the process every
+   `LEAN_SAMPLE_PROFILE_PERIOD_US` microseconds of CPU time and the native stack of the interrupted
+   thread is recorded by following its frame pointers. Compiled Lean functions show up under their
+   native symbols. Stacks are cut short at code compiled without frame pointers, so binaries should be
+   built with `-fno-omit-frame-pointer` (as `RelWithDebInfo` builds are) for complete profiles.
+
+   The profile is written in the legacy CPU profile format of gperftools, which `pprof` reads
+   together with the executable and shared libraries listed at its end to symbolize stacks. */
+
+/* Start sampling, and write the profile to `fname` when the process exits. */
+LEAN_EXPORT void start_sample_profile(char const * fname);
+LEAN_EXPORT bool sample_profile_supported();
+void initialize_sample_profile();
+}
@@ -7,6 +7,12 @@ Author: Leonardo de Moura
 #include <cstring>
 #include "runtime/sharecommon.h"
 #include "runtime/hash.h"
+#include "runtime/io.h"
+#include "runtime/thread.h"
+
+#ifndef LEAN_SHARECOMMON_NUM_SHARDS
+#define LEAN_SHARECOMMON_NUM_SHARDS 64
+#endif
 
 namespace lean {
 
@@ -32,7 +38,7 @@ extern "C" LEAN_EXPORT uint64_t lean_sharecommon_hash(b_obj_arg o) {
     // hash relevant parts of the header
     unsigned init = hash(lean_ptr_tag(o), lean_ptr_other(o));
     // hash body
-    return hash_str(sz - header_sz, reinterpret_cast<unsigned char const *>(o) + header_sz, init);
+    return hash_mem(sz - header_sz, reinterpret_cast<unsigned char const *>(o) + header_sz, init);
 }
 
 static obj_res mk_pair(obj_arg a, obj_arg b) {
@@ -438,4 +444,181 @@ lean_object * sharecommon_persistent_fn::operator()(lean_object * e) {
     m_saved.push_back(object_ref(r, true));
     return r;
 }
+
+/*
+  Hash-consing table that can be shared between tasks. It is split into shards, each one
+  protected by its own mutex, so that tasks hash-consing unrelated terms rarely contend.
+  Every object stored in the table is multi-threaded, and the table owns one reference to it.
+*/
+class sharecommon_concurrent_table {
+    struct set_hash {
+        std::size_t operator()(lean_object * o) const { return lean_sharecommon_hash(o); }
+    };
+    struct set_eq {
+        std::size_t operator()(lean_object * o1, lean_object * o2) const { return lean_sharecommon_eq(o1, o2); }
+    };
+    struct shard {
+        mutex                                               m_mutex;
+        std::unordered_set<lean_object *, set_hash, set_eq> m_set;
+    };
+    shard m_shards[LEAN_SHARECOMMON_NUM_SHARDS];
+
+    shard & get_shard(lean_object * o) {
+        return m_shards[lean_sharecommon_hash(o) % LEAN_SHARECOMMON_NUM_SHARDS];
+    }
+public:
+    ~sharecommon_concurrent_table() {
+        for (shard & s : m_shards)
+            for (lean_object * o : s.m_set)
+                lean_dec_ref(o);
+    }
+
+    /* Return (a new reference to) the object in the table that is equal to `o`, or `nullptr`. */
+    lean_object * find(lean_object * o) {
+        shard & s = get_shard(o);
+        lock_guard<mutex> lock(s.m_mutex);
+        auto it = s.m_set.find(o);
+        if (it == s.m_set.end())
+            return nullptr;
+        lean_inc_ref(*it);
+        return *it;
+    }
+
+    /*
+      Return (a new reference to) the object in the table that is equal to `o`.
+      If there is none, `o` is marked as multi-threaded and inserted.
+      This function takes ownership of `o`.
+    */
+    lean_object * insert(lean_object * o) {
+        shard & s = get_shard(o);
+        lock_guard<mutex> lock(s.m_mutex);
+        auto it = s.m_set.find(o);
+        if (it != s.m_set.end()) {
+            lean_object * r = *it;
+            lean_inc_ref(r);
+            lean_dec_ref(o);
+            return r;
+        }
+        lean_mark_mt(o);
+        s.m_set.insert(o);
+        lean_inc_ref(o);
+        return o;
+    }
+};
+
+static lean_external_class * g_sharecommon_table_external_class = nullptr;
+
+static void sharecommon_table_finalizer(void * t) {
+    delete static_cast<sharecommon_concurrent_table *>(t);
+}
+
+static void sharecommon_table_foreach(void *, b_obj_arg) {}
+
+static sharecommon_concurrent_table * sharecommon_table_get(b_obj_arg t) {
+    return static_cast<sharecommon_concurrent_table *>(lean_get_external_data(t));
+}
+
+/*
+  Like `sharecommon_quick_fn`, but the hash-consing table is a `sharecommon_concurrent_table`
+  that may be used by other tasks at the same time. `m_cache` is local to each invocation.
+*/
+class sharecommon_concurrent_fn {
+    sharecommon_concurrent_table &                   m_table;
+    std::unordered_map<lean_object *, lean_object *> m_cache;
+
+    lean_object * check_cache(lean_object * a) {
+        if (lean_is_exclusive(a))
+            return nullptr;
+        auto it = m_cache.find(a);
+        if (it != m_cache.end()) {
+            lean_inc_ref(it->second);
+            return it->second;
+        }
+        /* `a` may already be the result of a previous call, possibly from another task.
+           Since `lean_sharecommon_eq` compares children by pointer, any object in the table
+           that is equal to `a` is the maximally shared version of `a`. */
+        return m_table.find(a);
+    }
+
+    lean_object * save(lean_object * a, lean_object * new_a) {
+        lean_object * r = m_table.insert(new_a);
+        if (!lean_is_exclusive(a))
+            m_cache.insert(std::make_pair(a, r));
+        return r;
+    }
+
+    lean_object * visit_terminal(lean_object * a) {
+        if (lean_object * r = m_table.find(a))
+            return r;
+        lean_inc_ref(a);
+        return m_table.insert(a);
+    }
+
+    lean_object * visit_array(lean_object * a) {
+        if (lean_object * r = check_cache(a))
+            return r;
+        size_t sz = array_size(a);
+        lean_object * new_a = lean_alloc_array(sz, sz);
+        for (size_t i = 0; i < sz; i++) {
+            lean_array_set_core(new_a, i, visit(lean_array_get_core(a, i)));
+        }
+        return save(a, new_a);
+    }
+
+    lean_object * visit_ctor(lean_object * a) {
+        if (lean_object * r = check_cache(a))
+            return r;
+        unsigned num_objs      = lean_ctor_num_objs(a);
+        unsigned tag           = lean_ptr_tag(a);
+        unsigned sz            = lean_object_byte_size(a);
+        unsigned scalar_offset = sizeof(lean_object) + num_objs*sizeof(void*);
+        unsigned scalar_sz     = sz - scalar_offset;
+        lean_object * new_a    = lean_alloc_ctor(tag, num_objs, scalar_sz);
+        for (unsigned i = 0; i < num_objs; i++) {
+            lean_ctor_set(new_a, i, visit(lean_ctor_get(a, i)));
+        }
+        if (scalar_sz > 0) {
+            memcpy(reinterpret_cast<char*>(new_a) + scalar_offset, reinterpret_cast<char*>(a) + scalar_offset, scalar_sz);
+        }
+        return save(a, new_a);
+    }
+
+    lean_object * visit(lean_object * a) {
+        if (lean_is_scalar(a)) {
+            return a;
+        }
+        switch (lean_ptr_tag(a)) {
+        case LeanScalarArray:     return visit_terminal(a);
+        case LeanString:          return visit_terminal(a);
+        case LeanArray:           return visit_array(a);
+        case LeanMPZ:      case LeanClosure:
+        case LeanThunk:    case LeanTask:
+        case LeanPromise:  case LeanRef:
+        case LeanExternal: case LeanReserved:
+            lean_inc_ref(a);
+            return a;
+        default:                  return visit_ctor(a);
+        }
+    }
+public:
+    sharecommon_concurrent_fn(sharecommon_concurrent_table & t):m_table(t) {}
+    lean_object * operator()(lean_object * a) { return visit(a); }
+};
+
+// opaque ShareCommon.ConcurrentTable.new : BaseIO ConcurrentTable
+extern "C" LEAN_EXPORT obj_res lean_sharecommon_concurrent_table_new(obj_arg) {
+    return io_result_mk_ok(lean_alloc_external(g_sharecommon_table_external_class, new sharecommon_concurrent_table()));
+}
+
+// def ShareCommon.ConcurrentTable.shareCommon (t : @& ConcurrentTable) (a : @& α) : BaseIO α
+extern "C" LEAN_EXPORT obj_res lean_sharecommon_concurrent(b_obj_arg t, b_obj_arg a, obj_arg) {
+    return io_result_mk_ok(sharecommon_concurrent_fn(*sharecommon_table_get(t))(a));
+}
+
+void initialize_sharecommon() {
+    g_sharecommon_table_external_class = lean_register_external_class(sharecommon_table_finalizer, sharecommon_table_foreach);
+}
+
+void finalize_sharecommon() {
+}
 };
@@ -68,4 +68,6 @@ public:
     lean_object * operator()(lean_object * e);
 };
 
+void initialize_sharecommon();
+void finalize_sharecommon();
 };
@@ -0,0 +1,200 @@
+/*
+Copyright (c) 2025 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+*/
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+#include "runtime/task_trace.h"
+#include "runtime/thread.h"
+
+#if defined(__GLIBC__) || defined(__APPLE__)
+#define LEAN_TASK_TRACE_DLADDR 1
+#include <dlfcn.h>
+#else
+#define LEAN_TASK_TRACE_DLADDR 0
+#endif
+
+namespace lean {
+struct task_trace_event {
+    task_event m_kind;
+    unsigned   m_tid;
+    uint64_t   m_ts;    // microseconds since `start_task_trace`
+    uintptr_t  m_task;
+    unsigned   m_prio;
+    unsigned   m_queue_size;
+    bool       m_is_queue_size; // if true, this is a queue size sample and `m_kind` is ignored
+    unsigned   m_name{0};       // index into `g_task_trace_names`
+};
+
+static bool g_task_trace = false;
+static char const * g_task_trace_fname = nullptr;
+static std::chrono::steady_clock::time_point g_task_trace_start;
+static mutex * g_task_trace_mutex = nullptr;
+static std::vector<task_trace_event> * g_task_trace_events = nullptr;
+/* Names of the traced tasks, see `get_task_name`. Task objects are reused after being freed, so we
+   map each task to the name of its latest spawn. */
+static std::vector<std::string> * g_task_trace_names = nullptr;
+static std::unordered_map<uintptr_t, unsigned> * g_task_trace_name_of = nullptr;
+static std::string (*g_task_trace_decl_fn)() = nullptr;
+static atomic<unsigned> g_task_trace_next_tid(1);
+LEAN_THREAD_VALUE(unsigned, g_task_trace_tid, 0);
+
+bool task_trace_enabled() {
+    return g_task_trace;
+}
+
+void set_task_trace_decl_fn(std::string (*fn)()) {
+    g_task_trace_decl_fn = fn;
+}
+
+static unsigned get_task_trace_tid() {
+    if (g_task_trace_tid == 0)
+        g_task_trace_tid = g_task_trace_next_tid++;
+    return g_task_trace_tid;
+}
+
+static uint64_t get_task_trace_ts() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - g_task_trace_start).count();
+}
+
+/* Name a new task after the declaration being interpreted, or the native function implementing
+   its closure. */
+static std::string get_task_name(lean_object * c) {
+    if (g_task_trace_decl_fn) {
+        std::string n = g_task_trace_decl_fn();
+        if (!n.empty())
+            return n;
+    }
+#if LEAN_TASK_TRACE_DLADDR
+    if (c && !lean_is_scalar(c) && lean_is_closure(c)) {
+        Dl_info info;
+        if (dladdr(lean_closure_fun(c), &info) && info.dli_sname)
+            return info.dli_sname;
+    }
+#endif
+    return "task";
+}
+
+void trace_task_event(task_event e, lean_object * t, unsigned prio, lean_object * c) {
+    if (!g_task_trace)
+        return;
+    task_trace_event ev{e, get_task_trace_tid(), get_task_trace_ts(), reinterpret_cast<uintptr_t>(t), prio, 0, false};
+    std::string name;
+    if (e == task_event::spawn)
+        name = get_task_name(c);
+    lock_guard<mutex> lock(*g_task_trace_mutex);
+    if (e == task_event::spawn) {
+        ev.m_name = g_task_trace_names->size();
+        g_task_trace_names->push_back(name);
+        (*g_task_trace_name_of)[ev.m_task] = ev.m_name;
+    } else {
+        auto it = g_task_trace_name_of->find(ev.m_task);
+        if (it != g_task_trace_name_of->end())
+            ev.m_name = it->second;
+    }
+    g_task_trace_events->push_back(ev);
+}
+
+void trace_task_queue_size(unsigned n) {
+    if (!g_task_trace)
+        return;
+    task_trace_event ev{task_event::spawn, get_task_trace_tid(), get_task_trace_ts(), 0, 0, n, true};
+    lock_guard<mutex> lock(*g_task_trace_mutex);
+    g_task_trace_events->push_back(ev);
+}
+
+void write_json_string(std::ostream & out, std::string const & s) {
+    out << '"';
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            out << "\\u00" << "0123456789abcdef"[(c >> 4) & 0xf] << "0123456789abcdef"[c & 0xf];
+        } else {
+            out << c;
+        }
+    }
+    out << '"';
+}
+
+/* Write the recorded events in the Chrome trace event format. Tasks are shown as slices on the
+   thread executing them, linked to the place they were spawned by flow events. */
+static void write_task_trace(std::ostream & out) {
+    std::vector<task_trace_event> events;
+    std::vector<std::string> names;
+    {
+        lock_guard<mutex> lock(*g_task_trace_mutex);
+        events = *g_task_trace_events;
+        names  = *g_task_trace_names;
+    }
+    out << "{\"traceEvents\":[\n";
+    bool first = true;
+    for (task_trace_event const & ev : events) {
+        if (!first) out << ",\n";
+        first = false;
+        out << "{\"pid\":1,\"tid\":" << ev.m_tid << ",\"ts\":" << ev.m_ts << ",";
+        if (ev.m_is_queue_size) {
+            out << "\"ph\":\"C\",\"name\":\"queued tasks\",\"args\":{\"tasks\":" << ev.m_queue_size << "}}";
+            continue;
+        }
+        std::ostringstream id;
+        id << "0x" << std::hex << ev.m_task;
+        std::string const & name = names[ev.m_name];
+        switch (ev.m_kind) {
+        case task_event::spawn:
+            out << "\"ph\":\"s\",\"cat\":\"task\",\"name\":\"spawn\",\"id\":\"" << id.str() << "\"},\n";
+            out << "{\"pid\":1,\"tid\":" << ev.m_tid << ",\"ts\":" << ev.m_ts << ",\"ph\":\"i\",\"s\":\"t\",\"name\":\"spawn\","
+                << "\"args\":{\"task\":\"" << id.str() << "\",\"prio\":" << ev.m_prio << ",\"name\":";
+            write_json_string(out, name);
+            out << "}}";
+            break;
+        case task_event::start:
+            out << "\"ph\":\"f\",\"bp\":\"e\",\"cat\":\"task\",\"name\":\"spawn\",\"id\":\"" << id.str() << "\"},\n";
+            out << "{\"pid\":1,\"tid\":" << ev.m_tid << ",\"ts\":" << ev.m_ts << ",\"ph\":\"B\",\"name\":";
+            write_json_string(out, name);
+            out << ",\"args\":{\"task\":\"" << id.str() << "\",\"prio\":" << ev.m_prio << "}}";
+            break;
+        case task_event::finish:
+        case task_event::wait_end:
+            out << "\"ph\":\"E\"}";
+            break;
+        case task_event::wait_begin:
+            out << "\"ph\":\"B\",\"name\":\"wait\",\"args\":{\"task\":\"" << id.str() << "\",\"name\":";
+            write_json_string(out, name);
+            out << "}}";
+            break;
+        case task_event::cancel:
+            out << "\"ph\":\"i\",\"s\":\"t\",\"name\":\"cancel\",\"args\":{\"task\":\"" << id.str() << "\"}}";
+            break;
+        }
+    }
+    out << "\n]}\n";
+}
+
+static void write_task_trace_at_exit() {
+    std::ofstream out(g_task_trace_fname);
+    write_task_trace(out);
+}
+
+void start_task_trace(char const * fname) {
+    if (g_task_trace)
+        return;
+    g_task_trace_fname = fname;
+    g_task_trace_start = std::chrono::steady_clock::now();
+    std::atexit(write_task_trace_at_exit);
+    g_task_trace = true;
+}
+
+void initialize_task_trace() {
+    g_task_trace_mutex  = new mutex();
+    g_task_trace_events = new std::vector<task_trace_event>();
+    g_task_trace_names  = new std::vector<std::string>({"task"});
+    g_task_trace_name_of = new std::unordered_map<uintptr_t, unsigned>();
+    if (char const * fname = std::getenv("LEAN_TRACE_TASKS"))
+        start_task_trace(fname);
+}
+}
@@ -0,0 +1,29 @@
+/*
+Copyright (c) 2025 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+*/
+#pragma once
+#include <string>
+#include <ostream>
+#include <lean/lean.h>
+
+namespace lean {
+/* Opt-in tracing of the task manager. Events are written in the Chrome trace event format, which
+   can be inspected using `ui.perfetto.dev` or `chrome://tracing`. */
+enum class task_event { spawn, start, finish, wait_begin, wait_end, cancel };
+
+/* Start recording task events, and write them to `fname` when the process exits. */
+LEAN_EXPORT void start_task_trace(char const * fname);
+LEAN_EXPORT bool task_trace_enabled();
+/* Register a function returning the name of the Lean declaration currently being executed
+   by the interpreter, if any. It is used to name tasks spawned by interpreted code. */
+LEAN_EXPORT void set_task_trace_decl_fn(std::string (*fn)());
+/* Record event `e` for task `t` with priority `prio`. For `task_event::spawn`, `c` is the closure
+   of the new task, which is used to name it. */
+void trace_task_event(task_event e, lean_object * t, unsigned prio = 0, lean_object * c = nullptr);
+/* Record the number of tasks waiting to be executed by a worker. */
+void trace_task_queue_size(unsigned n);
+void initialize_task_trace();
+/* Write `s` as a JSON string literal, for other writers of trace files. */
+LEAN_EXPORT void write_json_string(std::ostream & out, std::string const & s);
+}
@@ -7,6 +7,9 @@ Author: Leonardo de Moura
 #include <utility>
 #include <vector>
 #include <iostream>
+#include <fstream>
+#include <string>
+#include <cstdlib>
 #ifdef LEAN_WINDOWS
 #include <windows.h>
 # ifdef LEAN_AUTO_THREAD_FINALIZATION
@@ -15,6 +18,9 @@ Author: Leonardo de Moura
 #else
 #include <pthread.h>
 #endif
+#if defined(__linux__)
+#include <sched.h>
+#endif
 #include <lean/config.h>
 #include "runtime/thread.h"
 #include "runtime/interrupt.h"
@@ -99,8 +105,10 @@ struct lthread::imp {
 
     imp(runnable const & p) {
         runnable * f = new std::function<void()>(mk_thread_proc(p, get_max_heartbeat()));
+        // Only reserve the stack so that it is committed on demand like on other platforms, as a
+        // large `--tstack` would otherwise be committed for every worker thread upfront.
         m_thread = CreateThread(nullptr, m_thread_stack_size,
-                                _main, f, 0, nullptr);
+                                _main, f, STACK_SIZE_PARAM_IS_A_RESERVATION, nullptr);
         if (m_thread == NULL) {
             throw exception("failed to create thread");
         }
@@ -321,4 +329,107 @@ void finalize_thread() {
     finalize_thread_local_reset_fns();
 }
 #endif
+
+#if defined(__linux__)
+/* Parse a CPU or node list such as `0-15,32-47` as used in `/sys/devices/system/node`. */
+static std::vector<unsigned> parse_cpu_list(std::string const & s) {
+    std::vector<unsigned> r;
+    size_t i = 0;
+    while (i < s.size()) {
+        size_t j = s.find(',', i);
+        if (j == std::string::npos) j = s.size();
+        std::string range = s.substr(i, j - i);
+        size_t k = range.find('-');
+        try {
+            unsigned lo = std::stoul(range.substr(0, k));
+            unsigned hi = k == std::string::npos ? lo : std::stoul(range.substr(k + 1));
+            for (unsigned c = lo; c <= hi; c++) r.push_back(c);
+        } catch (std::exception &) {
+            // ignore malformed entries (e.g. the trailing newline)
+        }
+        i = j + 1;
+    }
+    return r;
+}
+
+std::vector<std::vector<unsigned>> get_numa_node_cpus() {
+    std::vector<std::vector<unsigned>> r;
+    // Node ids need not be contiguous, e.g. after a node has been taken offline.
+    std::ifstream online("/sys/devices/system/node/online");
+    if (!online)
+        return r;
+    std::string nodes;
+    std::getline(online, nodes);
+    for (unsigned n : parse_cpu_list(nodes)) {
+        std::ifstream in("/sys/devices/system/node/node" + std::to_string(n) + "/cpulist");
+        if (!in)
+            continue;
+        std::string line;
+        std::getline(in, line);
+        std::vector<unsigned> cpus = parse_cpu_list(line);
+        if (!cpus.empty())
+            r.push_back(cpus);
+    }
+    return r;
+}
+
+bool set_thread_affinity(std::vector<unsigned> const & cpus) {
+#if defined(LEAN_MULTI_THREAD)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (unsigned c : cpus) {
+        if (c < CPU_SETSIZE) CPU_SET(c, &set);
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    return false;
+#endif
+}
+
+unsigned get_cpu_quota() {
+    long quota = -1, period = 0;
+    // cgroup v2: `<quota> <period>` or `max <period>`
+    std::ifstream v2("/sys/fs/cgroup/cpu.max");
+    if (v2) {
+        std::string q;
+        v2 >> q >> period;
+        if (q != "max") {
+            try { quota = std::stol(q); } catch (std::exception &) {}
+        }
+    } else {
+        // cgroup v1, quota is -1 if unlimited
+        std::ifstream q("/sys/fs/cgroup/cpu/cpu.cfs_quota_us");
+        std::ifstream p("/sys/fs/cgroup/cpu/cpu.cfs_period_us");
+        if (q && p) {
+            q >> quota;
+            p >> period;
+        }
+    }
+    if (quota <= 0 || period <= 0)
+        return 0;
+    return static_cast<unsigned>((quota + period - 1) / period);
+}
+#else
+std::vector<std::vector<unsigned>> get_numa_node_cpus() {
+    return std::vector<std::vector<unsigned>>();
+}
+
+bool set_thread_affinity(std::vector<unsigned> const &) {
+    return false;
+}
+
+unsigned get_cpu_quota() {
+    return 0;
+}
+#endif
+
+unsigned default_num_threads() {
+    unsigned n = hardware_concurrency();
+    if (std::getenv("LEAN_USE_CPU_QUOTA")) {
+        unsigned quota = get_cpu_quota();
+        if (quota != 0 && quota < n)
+            n = quota;
+    }
+    return n;
+}
 }
@@ -8,6 +8,7 @@ Author: Leonardo de Moura
 #include <iostream>
 #include <chrono>
 #include <functional>
+#include <vector>
 #include <lean/lean.h>
 
 #ifndef LEAN_STACK_BUFFER_SPACE
@@ -21,6 +22,7 @@ namespace chrono = std::chrono;
 #if defined(LEAN_MULTI_THREAD)
 #include <thread>
 #include <mutex>
+#include <shared_mutex>
 #include <atomic>
 #include <condition_variable>
 #define LEAN_THREAD_LOCAL thread_local
@@ -29,6 +31,7 @@ namespace lean {
 using std::thread;
 using std::mutex;
 using std::recursive_mutex;
+typedef std::shared_timed_mutex shared_mutex;
 using std::atomic;
 using std::atomic_bool;
 using std::atomic_ushort;
@@ -89,8 +92,10 @@ public:
     atomic & operator=(atomic const & v) { m_value = v.m_value; return *this; }
     atomic & operator=(atomic && v) { m_value = std::forward<T>(v.m_value); return *this; }
     operator T() const { return m_value; }
-    void store(T const & v) { m_value = v; }
-    T load() const { return m_value; }
+    void store(T const & v, int = 0) { m_value = v; }
+    T load(int = 0) const { return m_value; }
+    T fetch_add(T const & v, int = 0) { T r(m_value); m_value += v; return r; }
+    T fetch_sub(T const & v, int = 0) { T r(m_value); m_value -= v; return r; }
     atomic & operator|=(T const & v) { m_value |= v; return *this; }
     atomic & operator+=(T const & v) { m_value += v; return *this; }
     atomic & operator-=(T const & v) { m_value -= v; return *this; }
@@ -112,6 +117,9 @@ public:
             return false;
         }
     }
+    bool compare_exchange_weak(T & expected, T desired, int = 0) {
+        return compare_exchange_strong(expected, desired);
+    }
 };
 typedef atomic<unsigned short> atomic_ushort;
 typedef atomic<unsigned char>  atomic_uchar;
@@ -152,6 +160,15 @@ public:
     void lock() {}
     void unlock() {}
 };
+class shared_mutex {
+public:
+    void lock() {}
+    bool try_lock() { return true; }
+    void unlock() {}
+    void lock_shared() {}
+    bool try_lock_shared() { return true; }
+    void unlock_shared() {}
+};
 class condition_variable {
 public:
     template<typename Lock> void wait(Lock const &) {}
@@ -252,4 +269,19 @@ LEAN_EXPORT void register_thread_local_reset_fn(std::function<void()> fn);
    We invoke this function before processing a command
    and before executing a task. */
 LEAN_EXPORT void reset_thread_local();
+
+/** \brief Return the CPUs of each NUMA node of the machine, or an empty vector
+    if the topology is unknown (currently, on platforms other than Linux). */
+LEAN_EXPORT std::vector<std::vector<unsigned>> get_numa_node_cpus();
+
+/** \brief Restrict the current thread to the given CPUs. Return false if it is not supported. */
+LEAN_EXPORT bool set_thread_affinity(std::vector<unsigned> const & cpus);
+
+/** \brief Return the number of CPUs the process may use according to its cgroup CPU quota,
+    rounded up, or 0 if there is no quota or it is unknown (e.g. on platforms other than Linux). */
+LEAN_EXPORT unsigned get_cpu_quota();
+
+/** \brief Default number of worker threads: `hardware_concurrency()`, capped by `get_cpu_quota()`
+    if the environment variable `LEAN_USE_CPU_QUOTA` is set. */
+LEAN_EXPORT unsigned default_num_threads();
 }
@@ -5,6 +5,7 @@ Released under Apache 2.0 license as described in the file LICENSE.
 Author: Leonardo de Moura
 */
 #include <cstdlib>
+#include <cstring>
 #include <string>
 #include "runtime/debug.h"
 #include "runtime/optional.h"
@@ -13,6 +14,17 @@ Author: Leonardo de Moura
 namespace lean {
 bool is_utf8_next(unsigned char c) { return (c & 0xC0) == 0x80; }
 
+/* Number of bytes checked at once by the ASCII fast paths below. */
+#define LEAN_UTF8_WORD_SIZE 8
+
+/* Return true if the `LEAN_UTF8_WORD_SIZE` bytes starting at `str` are all ASCII characters.
+   Most text is mostly ASCII, so the loops below skip whole words of it instead of decoding single bytes. */
+static inline bool is_ascii_word(void const * str) {
+    uint64_t w;
+    memcpy(&w, str, sizeof(w));
+    return (w & 0x8080808080808080ull) == 0;
+}
+
 unsigned get_utf8_size(unsigned char c) {
     if ((c & 0x80) == 0)
         return 1;
@@ -50,6 +62,11 @@ extern "C" LEAN_EXPORT size_t lean_utf8_n_strlen(char const * str, size_t sz) {
     size_t r = 0;
     size_t i = 0;
     while (i < sz) {
+        if (i + LEAN_UTF8_WORD_SIZE <= sz && is_ascii_word(str + i)) {
+            i += LEAN_UTF8_WORD_SIZE;
+            r += LEAN_UTF8_WORD_SIZE;
+            continue;
+        }
         unsigned d = get_utf8_size(str[i]);
         r++;
         i += d;
@@ -269,6 +286,11 @@ bool validate_utf8_one(uint8_t const * str, size_t size, size_t & pos) {
 
 bool validate_utf8(uint8_t const * str, size_t size, size_t & pos, size_t & i) {
     while (pos < size) {
+        if (pos + LEAN_UTF8_WORD_SIZE <= size && is_ascii_word(str + pos)) {
+            pos += LEAN_UTF8_WORD_SIZE;
+            i   += LEAN_UTF8_WORD_SIZE;
+            continue;
+        }
         if (!validate_utf8_one(str, size, pos)) return false;
         i++;
     }
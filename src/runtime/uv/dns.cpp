@@ -0,0 +1,230 @@
+/*
+Copyright (c) 2025 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+*/
+#include <cstring>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "runtime/uv/dns.h"
+#include "runtime/uv/net_addr.h"
+#include "runtime/thread.h"
+
+namespace lean {
+#ifndef LEAN_EMSCRIPTEN
+
+using namespace std;
+
+// A successfully resolved name in the cache.
+struct dns_cache_entry {
+    vector<sockaddr_storage> m_addrs;
+    uint64_t                 m_expiry; // In milliseconds of `uv_hrtime`.
+};
+
+static mutex * g_dns_cache_mutex = nullptr;
+static unordered_map<string, dns_cache_entry> * g_dns_cache = nullptr;
+
+void initialize_libuv_dns() {
+    g_dns_cache_mutex = new mutex();
+    g_dns_cache = new unordered_map<string, dns_cache_entry>();
+}
+
+static uint64_t dns_now() {
+    return uv_hrtime() / 1000000;
+}
+
+static string dns_cache_key(b_obj_arg host, b_obj_arg service) {
+    string key(lean_string_cstr(host), lean_string_size(host) - 1);
+    key.push_back('\0');
+    key.append(lean_string_cstr(service), lean_string_size(service) - 1);
+    return key;
+}
+
+static lean_obj_res sockaddrs_to_array(vector<sockaddr_storage> const & addrs) {
+    lean_object * arr = lean_alloc_array(0, addrs.size());
+    for (sockaddr_storage const & addr : addrs) {
+        arr = lean_array_push(arr, lean_sockaddr_to_socket_address((const sockaddr*)&addr));
+    }
+    return arr;
+}
+
+// Returns `Array SocketAddress` if `key` is cached and has not yet expired, `NULL` otherwise.
+static lean_obj_res dns_cache_find(string const & key) {
+    lock_guard<mutex> lock(*g_dns_cache_mutex);
+    auto it = g_dns_cache->find(key);
+    if (it == g_dns_cache->end()) return NULL;
+    if (it->second.m_expiry <= dns_now()) {
+        g_dns_cache->erase(it);
+        return NULL;
+    }
+    return sockaddrs_to_array(it->second.m_addrs);
+}
+
+static void dns_cache_insert(string const & key, vector<sockaddr_storage> const & addrs) {
+    lock_guard<mutex> lock(*g_dns_cache_mutex);
+    uint64_t now = dns_now();
+    if (g_dns_cache->size() >= LEAN_DNS_CACHE_SIZE) {
+        for (auto it = g_dns_cache->begin(); it != g_dns_cache->end();) {
+            if (it->second.m_expiry <= now) {
+                it = g_dns_cache->erase(it);
+            } else {
+                it++;
+            }
+        }
+        // The cache is only meant for a few hot names, so simply start over if it is full.
+        if (g_dns_cache->size() >= LEAN_DNS_CACHE_SIZE) g_dns_cache->clear();
+    }
+    dns_cache_entry & entry = (*g_dns_cache)[key];
+    entry.m_addrs = addrs;
+    entry.m_expiry = now + LEAN_DNS_CACHE_TTL_MS;
+}
+
+// Resolves `promise` with `Except.ok value` or, if `status` indicates failure, with `Except.error`.
+static void dns_resolve(lean_object * promise, int status, lean_object * value) {
+    if (status < 0) {
+        lean_assert(value == NULL);
+        resolve_promise(promise, mk_except_err(status));
+    } else {
+        resolve_promise(promise, mk_except_ok(value));
+    }
+}
+
+static void getaddrinfo_finish(lean_uv_getaddrinfo_req * req, int status, struct addrinfo * res) {
+    lean_object * value = NULL;
+    if (status >= 0) {
+        vector<sockaddr_storage> addrs;
+        for (struct addrinfo * ai = res; ai != NULL; ai = ai->ai_next) {
+            if (ai->ai_family != AF_INET && ai->ai_family != AF_INET6) continue;
+            sockaddr_storage addr;
+            memset(&addr, 0, sizeof(sockaddr_storage));
+            memcpy(&addr, ai->ai_addr, ai->ai_addrlen);
+            addrs.push_back(addr);
+        }
+        if (req->m_cache) {
+            dns_cache_insert(dns_cache_key(req->m_host, req->m_service), addrs);
+        }
+        value = sockaddrs_to_array(addrs);
+    }
+    if (res != NULL) uv_freeaddrinfo(res);
+
+    dns_resolve(req->m_promise, status, value);
+
+    lean_dec(req->m_promise);
+    lean_dec(req->m_host);
+    lean_dec(req->m_service);
+    free(req);
+}
+
+static void handle_getaddrinfo_event(uv_getaddrinfo_t * uv_req, int status, struct addrinfo * res) {
+    getaddrinfo_finish((lean_uv_getaddrinfo_req*)uv_req->data, status, res);
+}
+
+static char const * string_or_null(b_obj_arg s) {
+    return lean_string_size(s) == 1 ? NULL : lean_string_cstr(s);
+}
+
+static void getaddrinfo_start(void * data) {
+    lean_uv_getaddrinfo_req * req = (lean_uv_getaddrinfo_req*)data;
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(struct addrinfo));
+    hints.ai_family = AF_UNSPEC;
+    // Without a socket type every address is reported once per protocol.
+    hints.ai_socktype = SOCK_STREAM;
+
+    int result = uv_getaddrinfo(req->m_ev->loop, &req->m_uv_req, handle_getaddrinfo_event,
+                                string_or_null(req->m_host), string_or_null(req->m_service), &hints);
+    if (result < 0) {
+        // libuv does not invoke the callback for requests that failed on submission.
+        getaddrinfo_finish(req, result, NULL);
+    }
+}
+
+/* Std.Internal.UV.DNS.getAddrInfo (host service : @& String) (cache : Bool) : IO (IO.Promise (Except IO.Error (Array SocketAddress))) */
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_dns_get_info(b_obj_arg host, b_obj_arg service, uint8_t cache, obj_arg /* w */) {
+    if (cache) {
+        lean_object * addrs = dns_cache_find(dns_cache_key(host, service));
+        if (addrs != NULL) {
+            lean_object * promise = create_promise();
+            dns_resolve(promise, 0, addrs);
+            return lean_io_result_mk_ok(promise);
+        }
+    }
+
+    lean_uv_getaddrinfo_req * req = (lean_uv_getaddrinfo_req*)malloc(sizeof(lean_uv_getaddrinfo_req));
+    req->m_ev = event_loop_pick();
+    req->m_promise = create_promise();
+    req->m_cache = cache;
+    req->m_uv_req.data = req;
+    // The strings are released on the event loop thread.
+    lean_mark_mt(host);
+    lean_inc(host);
+    req->m_host = host;
+    lean_mark_mt(service);
+    lean_inc(service);
+    req->m_service = service;
+
+    lean_inc(req->m_promise);
+    lean_object * promise = req->m_promise;
+    event_loop_submit(req->m_ev, getaddrinfo_start, req);
+    return lean_io_result_mk_ok(promise);
+}
+
+static void getnameinfo_finish(lean_uv_getnameinfo_req * req, int status, char const * hostname, char const * service) {
+    lean_object * value = NULL;
+    if (status >= 0) {
+        value = lean_alloc_ctor(0, 2, 0);
+        lean_ctor_set(value, 0, lean_mk_string(hostname));
+        lean_ctor_set(value, 1, lean_mk_string(service));
+    }
+
+    dns_resolve(req->m_promise, status, value);
+
+    lean_dec(req->m_promise);
+    free(req);
+}
+
+static void handle_getnameinfo_event(uv_getnameinfo_t * uv_req, int status, char const * hostname, char const * service) {
+    getnameinfo_finish((lean_uv_getnameinfo_req*)uv_req->data, status, hostname, service);
+}
+
+static void getnameinfo_start(void * data) {
+    lean_uv_getnameinfo_req * req = (lean_uv_getnameinfo_req*)data;
+    int result = uv_getnameinfo(req->m_ev->loop, &req->m_uv_req, handle_getnameinfo_event, (const sockaddr*)&req->m_addr, 0);
+    if (result < 0) {
+        getnameinfo_finish(req, result, NULL, NULL);
+    }
+}
+
+/* Std.Internal.UV.DNS.getNameInfo (addr : @& SocketAddress) : IO (IO.Promise (Except IO.Error (String × String))) */
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_dns_get_name(b_obj_arg addr, obj_arg /* w */) {
+    lean_uv_getnameinfo_req * req = (lean_uv_getnameinfo_req*)malloc(sizeof(lean_uv_getnameinfo_req));
+    req->m_ev = event_loop_pick();
+    req->m_promise = create_promise();
+    req->m_uv_req.data = req;
+    lean_socket_address_to_sockaddr_storage(addr, &req->m_addr);
+
+    lean_inc(req->m_promise);
+    lean_object * promise = req->m_promise;
+    event_loop_submit(req->m_ev, getnameinfo_start, req);
+    return lean_io_result_mk_ok(promise);
+}
+
+#else
+
+void initialize_libuv_dns() {}
+
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_dns_get_info(b_obj_arg host, b_obj_arg service, uint8_t cache, obj_arg /* w */) {
+    lean_always_assert(
+        false && ("Please build a version of Lean4 with libuv to invoke this.")
+    );
+}
+
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_dns_get_name(b_obj_arg addr, obj_arg /* w */) {
+    lean_always_assert(
+        false && ("Please build a version of Lean4 with libuv to invoke this.")
+    );
+}
+
+#endif
+}
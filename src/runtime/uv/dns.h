@@ -0,0 +1,47 @@
+/*
+Copyright (c) 2025 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+*/
+#pragma once
+#include <lean/lean.h>
+#include "runtime/uv/event_loop.h"
+
+namespace lean {
+
+void initialize_libuv_dns();
+
+#ifndef LEAN_EMSCRIPTEN
+using namespace std;
+#include <uv.h>
+
+// How long successful `getAddrInfo` results stay in the in-process cache, in milliseconds.
+#define LEAN_DNS_CACHE_TTL_MS 30000
+// The maximal number of names in the in-process cache.
+#define LEAN_DNS_CACHE_SIZE 256
+
+// Structure for a single in-flight `getaddrinfo` request.
+typedef struct {
+    uv_getaddrinfo_t m_uv_req;  // LibUV request.
+    event_loop_t *   m_ev;      // The event loop the request is submitted to.
+    lean_object *    m_promise; // The promise resolved with the `Except IO.Error _` result.
+    lean_object *    m_host;    // The name to resolve.
+    lean_object *    m_service; // The service to resolve.
+    bool             m_cache;   // Whether the result is stored in the cache.
+} lean_uv_getaddrinfo_req;
+
+// Structure for a single in-flight `getnameinfo` request.
+typedef struct {
+    uv_getnameinfo_t m_uv_req;  // LibUV request.
+    event_loop_t *   m_ev;      // The event loop the request is submitted to.
+    lean_object *    m_promise; // The promise resolved with the `Except IO.Error _` result.
+    sockaddr_storage m_addr;    // The address to look up.
+} lean_uv_getnameinfo_req;
+
+#endif
+
+// =======================================
+// DNS functions
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_dns_get_info(b_obj_arg host, b_obj_arg service, uint8_t cache, obj_arg /* w */);
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_dns_get_name(b_obj_arg addr, obj_arg /* w */);
+
+}
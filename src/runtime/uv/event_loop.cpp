@@ -4,6 +4,7 @@ Released under Apache 2.0 license as described in the file LICENSE.
 
 Author: Sofia Rodrigues, Henrik Böving
 */
+#include <cstring>
 #include "runtime/uv/event_loop.h"
 
 
@@ -15,13 +16,25 @@ thread. Once this notification arrives the event loop suspends its own execution
 that protects it. This mutex can then be taken by another thread that wants to work with the event
 loop. After that work is done it signals a condition variable that the event loop is waiting on
 to continue its execution.
+
+Work that does not need to report back to the submitting thread synchronously, such as starting a
+request whose outcome is delivered through a promise, is instead pushed onto a lock free queue with
+`event_loop_submit`. It is run by the `uv_async_t` callback on the event loop thread, so neither
+the loop nor the submitter has to wait for the other.
 */
 
 namespace lean {
 #ifndef LEAN_EMSCRIPTEN
 using namespace std;
 
+/* Upper bound on `LEAN_NUM_EVENT_LOOPS`. Every loop owns a thread, so a mistyped value must not
+   make the runtime start thousands of them. */
+#define LEAN_MAX_EVENT_LOOPS 64
+
 event_loop_t global_ev;
+event_loop_t ** g_event_loops = NULL;
+unsigned g_num_event_loops = 0;
+static _Atomic(unsigned) g_next_event_loop(0);
 
 // Utility function for error checking. This function is only used inside the
 // initializition of the event loop.
@@ -32,9 +45,38 @@ static void check_uv(int result, const char * msg) {
     }
 }
 
-// The callback that stops the loop when it's called.
-void async_callback(uv_async_t * handle) {
-    uv_stop(handle->loop);
+// Runs all submitted work in submission order.
+static void event_loop_drain(event_loop_t * event_loop) {
+    event_loop_work_t * work = atomic_exchange_explicit(&event_loop->queue, (event_loop_work_t*)NULL, memory_order_acquire);
+    // The queue is a stack, reverse it to run the work in order.
+    event_loop_work_t * ordered = NULL;
+    while (work != NULL) {
+        event_loop_work_t * next = work->next;
+        work->next = ordered;
+        ordered = work;
+        work = next;
+    }
+    event_loop_stats_t * stats = &event_loop->stats;
+    uint64_t now = uv_hrtime();
+    while (ordered != NULL) {
+        event_loop_work_t * next = ordered->next;
+        // Only the loop thread updates the submission counters.
+        uint64_t latency = now > ordered->submitted ? now - ordered->submitted : 0;
+        atomic_store_explicit(&stats->submissions, atomic_load_explicit(&stats->submissions, memory_order_relaxed) + 1, memory_order_relaxed);
+        atomic_store_explicit(&stats->submit_latency, atomic_load_explicit(&stats->submit_latency, memory_order_relaxed) + latency, memory_order_relaxed);
+        if (latency > atomic_load_explicit(&stats->max_submit_latency, memory_order_relaxed)) {
+            atomic_store_explicit(&stats->max_submit_latency, latency, memory_order_relaxed);
+        }
+        ordered->fn(ordered->data);
+        free(ordered);
+        ordered = next;
+    }
+}
+
+// The callback that runs submitted work. Other threads waiting for the loop do not need it: any
+// `uv_async_send` makes the current `uv_run(UV_RUN_ONCE)` return.
+static void async_callback(uv_async_t * handle) {
+    event_loop_drain((event_loop_t*)handle->data);
 }
 
 // Interrupts the event loop and stops it so it can receive future requests.
@@ -44,22 +86,108 @@ void event_loop_interrupt(event_loop_t * event_loop) {
     lean_assert(result == 0);
 }
 
+static void walk_count_handle(uv_handle_t * handle, void * arg) {
+    if (uv_is_active(handle)) ((uint64_t*)arg)[uv_handle_get_type(handle)]++;
+}
+
+// Counts the active handles of `event_loop` by type. Requires the lock of the loop.
+static void event_loop_count_handles(event_loop_t * event_loop, uint64_t counts[UV_HANDLE_TYPE_MAX]) {
+    memset(counts, 0, UV_HANDLE_TYPE_MAX * sizeof(uint64_t));
+    uv_walk(event_loop->loop, walk_count_handle, counts);
+    // Our own handles are an implementation detail.
+    counts[UV_ASYNC]--;
+    if (uv_is_active((uv_handle_t*)&event_loop->stats_timer)) counts[UV_TIMER]--;
+}
+
+static unsigned event_loop_index(event_loop_t * event_loop) {
+    for (unsigned i = 0; i < g_num_event_loops; i++) {
+        if (g_event_loops[i] == event_loop) return i;
+    }
+    return 0;
+}
+
+// Runs on the loop thread, which holds the lock of the loop.
+static void stats_timer_callback(uv_timer_t * handle) {
+    event_loop_t * event_loop = (event_loop_t*)handle->data;
+    event_loop_stats_t * stats = &event_loop->stats;
+    uint64_t counts[UV_HANDLE_TYPE_MAX];
+    event_loop_count_handles(event_loop, counts);
+    uint64_t submissions = stats->submissions;
+    fprintf(stderr, "[event loop %u] iterations: %llu, run: %llums, lock waits: %llu (%llums), "
+            "submissions: %llu (avg latency %lluus, max %lluus), handles:",
+            event_loop_index(event_loop),
+            (unsigned long long)stats->iterations,
+            (unsigned long long)(stats->run_time / 1000000),
+            (unsigned long long)stats->lock_waits,
+            (unsigned long long)(stats->lock_wait_time / 1000000),
+            (unsigned long long)submissions,
+            (unsigned long long)(submissions ? stats->submit_latency / submissions / 1000 : 0),
+            (unsigned long long)(stats->max_submit_latency / 1000));
+    for (int i = UV_UNKNOWN_HANDLE + 1; i < UV_HANDLE_TYPE_MAX; i++) {
+        if (counts[i] > 0) fprintf(stderr, " %s %llu", uv_handle_type_name((uv_handle_type)i), (unsigned long long)counts[i]);
+    }
+    fprintf(stderr, "\n");
+}
+
+static void event_loop_stats_init(event_loop_t * event_loop) {
+    event_loop->stats.iterations = 0;
+    event_loop->stats.run_time = 0;
+    event_loop->stats.lock_waits = 0;
+    event_loop->stats.lock_wait_time = 0;
+    event_loop->stats.submissions = 0;
+    event_loop->stats.submit_latency = 0;
+    event_loop->stats.max_submit_latency = 0;
+
+    check_uv(uv_timer_init(event_loop->loop, &event_loop->stats_timer), "Failed to initialize stats timer");
+    event_loop->stats_timer.data = event_loop;
+    if (char const * n = getenv("LEAN_EVENT_LOOP_STATS_INTERVAL")) {
+        int interval = atoi(n);
+        if (interval > 0) {
+            check_uv(uv_timer_start(&event_loop->stats_timer, stats_timer_callback, interval, interval), "Failed to start stats timer");
+        }
+    }
+    // Logging must not keep the loop alive.
+    uv_unref((uv_handle_t*)&event_loop->stats_timer);
+}
+
 // Initializes the event loop
 void event_loop_init(event_loop_t * event_loop) {
-    event_loop->loop = uv_default_loop();
+    if (event_loop == &global_ev) {
+        event_loop->loop = uv_default_loop();
+    } else {
+        event_loop->loop = (uv_loop_t*)malloc(sizeof(uv_loop_t));
+        check_uv(uv_loop_init(event_loop->loop), "Failed to initialize loop");
+    }
     check_uv(uv_mutex_init_recursive(&event_loop->mutex), "Failed to initialize mutex");
     check_uv(uv_cond_init(&event_loop->cond_var), "Failed to initialize condition variable");
-    check_uv(uv_async_init(event_loop->loop, &event_loop->async, NULL), "Failed to initialize async");
+    check_uv(uv_async_init(event_loop->loop, &event_loop->async, async_callback), "Failed to initialize async");
+    event_loop->async.data = event_loop;
     event_loop->n_waiters = 0;
+    event_loop->queue = NULL;
+    event_loop_stats_init(event_loop);
+}
+
+void event_loop_submit(event_loop_t * event_loop, void (*fn)(void *), void * data) {
+    event_loop_work_t * work = (event_loop_work_t*)malloc(sizeof(event_loop_work_t));
+    work->fn = fn;
+    work->data = data;
+    work->submitted = uv_hrtime();
+    work->next = atomic_load_explicit(&event_loop->queue, memory_order_relaxed);
+    while (!atomic_compare_exchange_weak_explicit(&event_loop->queue, &work->next, work, memory_order_release, memory_order_relaxed)) {}
+    // Multiple sends before the callback runs are coalesced into a single call.
+    event_loop_interrupt(event_loop);
 }
 
 // Locks the event loop for the side of the requesters.
 void event_loop_lock(event_loop_t * event_loop) {
     if (uv_mutex_trylock(&event_loop->mutex) != 0) {
+        uint64_t start = uv_hrtime();
         event_loop->n_waiters++;
         event_loop_interrupt(event_loop);
         uv_mutex_lock(&event_loop->mutex);
         event_loop->n_waiters--;
+        event_loop->stats.lock_waits++;
+        event_loop->stats.lock_wait_time += uv_hrtime() - start;
     }
 }
 
@@ -80,52 +208,120 @@ void event_loop_run_loop(event_loop_t * event_loop) {
             uv_cond_wait(&event_loop->cond_var, &event_loop->mutex);
         }
 
+        uint64_t start = uv_hrtime();
         uv_run(event_loop->loop, UV_RUN_ONCE);
+        event_loop->stats.iterations++;
+        event_loop->stats.run_time += uv_hrtime() - start;
         /*
-         * We leave `uv_run` only when `uv_stop` is called as there is always the `uv_async_t` so
-         * we can never run out of things to wait on. `uv_stop` is only called from `async_callback`
-         * when another thread wants to work with the event loop so we need to give up the mutex.
+         * There is always the `uv_async_t`, so we can never run out of things to wait on and
+         * `uv_run` blocks until some event arrives. In particular it returns after a thread that
+         * wants to work with the event loop called `event_loop_interrupt`, so we give up the mutex.
          */
 
         uv_mutex_unlock(&event_loop->mutex);
     }
 }
 
+event_loop_t * event_loop_pick() {
+    if (g_num_event_loops == 1) return &global_ev;
+    unsigned i = atomic_fetch_add_explicit(&g_next_event_loop, 1u, memory_order_relaxed);
+    return g_event_loops[i % g_num_event_loops];
+}
+
 /* Std.Internal.UV.Loop.configure (options : Loop.Options) : BaseIO Unit */
 extern "C" LEAN_EXPORT lean_obj_res lean_uv_event_loop_configure(b_obj_arg options, obj_arg /* w */ ) {
     bool accum = lean_ctor_get_uint8(options, 0);
     bool block = lean_ctor_get_uint8(options, 1);
 
-    event_loop_lock(&global_ev);
+    for (unsigned i = 0; i < g_num_event_loops; i++) {
+        event_loop_t * event_loop = g_event_loops[i];
+        int result = 0;
 
-    if (accum) {
-        int result = uv_loop_configure(global_ev.loop, UV_METRICS_IDLE_TIME);
-        if (result != 0) return lean_io_result_mk_error(lean_decode_uv_error(result, NULL));
-    }
+        event_loop_lock(event_loop);
+
+        if (accum) {
+            result = uv_loop_configure(event_loop->loop, UV_METRICS_IDLE_TIME);
+        }
+
+        #if!defined(WIN32) && !defined(_WIN32)
+        if (result == 0 && block) {
+            result = uv_loop_configure(event_loop->loop, UV_LOOP_BLOCK_SIGNAL, SIGPROF);
+        }
+        #endif
+
+        event_loop_unlock(event_loop);
 
-    #if!defined(WIN32) && !defined(_WIN32)
-    if (block) {
-        int result = uv_loop_configure(global_ev.loop, UV_LOOP_BLOCK_SIGNAL, SIGPROF);
         if (result != 0) return lean_io_result_mk_error(lean_decode_uv_error(result, NULL));
     }
-    #endif
-
-    event_loop_unlock(&global_ev);
 
     return lean_io_result_mk_ok(lean_box(0));
 }
 
 /* Std.Internal.UV.Loop.alive : BaseIO UInt64 */
 extern "C" LEAN_EXPORT lean_obj_res lean_uv_event_loop_alive(obj_arg /* w */ ) {
-    event_loop_lock(&global_ev);
-    int is_alive = uv_loop_alive(global_ev.loop);
-    event_loop_unlock(&global_ev);
+    int is_alive = 0;
+    for (unsigned i = 0; i < g_num_event_loops && !is_alive; i++) {
+        event_loop_t * event_loop = g_event_loops[i];
+        event_loop_lock(event_loop);
+        is_alive = uv_loop_alive(event_loop->loop);
+        event_loop_unlock(event_loop);
+    }
 
     return lean_io_result_mk_ok(lean_box(is_alive));
 }
 
+/* Std.Internal.UV.Loop.stats : BaseIO (Array Loop.Stats) */
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_event_loop_stats(obj_arg /* w */ ) {
+    lean_object * arr = lean_alloc_array(0, g_num_event_loops);
+    for (unsigned i = 0; i < g_num_event_loops; i++) {
+        event_loop_t * event_loop = g_event_loops[i];
+        event_loop_stats_t * stats = &event_loop->stats;
+        uint64_t counts[UV_HANDLE_TYPE_MAX];
+
+        event_loop_lock(event_loop);
+        event_loop_count_handles(event_loop, counts);
+        uint64_t idle_time = uv_metrics_idle_time(event_loop->loop);
+        event_loop_unlock(event_loop);
+
+        lean_object * handles = lean_mk_empty_array();
+        for (int t = UV_UNKNOWN_HANDLE + 1; t < UV_HANDLE_TYPE_MAX; t++) {
+            if (counts[t] == 0) continue;
+            lean_object * pair = lean_alloc_ctor(0, 2, 0);
+            lean_ctor_set(pair, 0, lean_mk_string(uv_handle_type_name((uv_handle_type)t)));
+            lean_ctor_set(pair, 1, lean_uint64_to_nat(counts[t]));
+            handles = lean_array_push(handles, pair);
+        }
+
+        uint64_t values[] = {
+            stats->iterations, stats->run_time, idle_time, stats->lock_waits, stats->lock_wait_time,
+            stats->submissions, stats->submit_latency, stats->max_submit_latency
+        };
+        size_t num_values = sizeof(values) / sizeof(uint64_t);
+        lean_object * o = lean_alloc_ctor(0, 1, num_values * sizeof(uint64_t));
+        lean_ctor_set(o, 0, handles);
+        for (size_t j = 0; j < num_values; j++) {
+            lean_ctor_set_uint64(o, sizeof(lean_object *) + j * sizeof(uint64_t), values[j]);
+        }
+        arr = lean_array_push(arr, o);
+    }
+    return lean_io_result_mk_ok(arr);
+}
+
 void initialize_libuv_loop() {
-    event_loop_init(&global_ev);
+    g_num_event_loops = 1;
+    if (char const * n = getenv("LEAN_NUM_EVENT_LOOPS")) {
+        int v = atoi(n);
+        if (v > LEAN_MAX_EVENT_LOOPS) v = LEAN_MAX_EVENT_LOOPS;
+        if (v > 1) g_num_event_loops = v;
+    }
+    g_event_loops = (event_loop_t**)malloc(g_num_event_loops * sizeof(event_loop_t*));
+    g_event_loops[0] = &global_ev;
+    for (unsigned i = 1; i < g_num_event_loops; i++) {
+        g_event_loops[i] = new event_loop_t();
+    }
+    for (unsigned i = 0; i < g_num_event_loops; i++) {
+        event_loop_init(g_event_loops[i]);
+    }
 }
 
 #else
@@ -140,6 +336,11 @@ extern "C" LEAN_EXPORT lean_obj_res lean_uv_event_loop_alive(obj_arg /* w */ ) {
     return io_result_mk_error("lean_uv_event_loop_alive is not supported");
 }
 
+/* Std.Internal.UV.Loop.stats : BaseIO (Array Loop.Stats) */
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_event_loop_stats(obj_arg /* w */ ) {
+    return io_result_mk_error("lean_uv_event_loop_stats is not supported");
+}
+
 #endif
 
 }
\ No newline at end of file
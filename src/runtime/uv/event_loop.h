@@ -17,6 +17,25 @@ void initialize_libuv_loop();
 using namespace std;
 #include <uv.h>
 
+// A piece of work submitted to the event loop through `event_loop_submit`.
+typedef struct event_loop_work {
+    void                  (*fn)(void *); // Function run on the event loop thread.
+    void *                  data;        // Argument of `fn`.
+    struct event_loop_work * next;       // Next (earlier submitted) work in the queue.
+    uint64_t                submitted;   // `uv_hrtime` at submission.
+} event_loop_work_t;
+
+// Counters reported by `Std.Internal.UV.Loop.stats`. All times are in nanoseconds.
+typedef struct {
+    _Atomic(uint64_t) iterations;         // Number of `uv_run` calls.
+    _Atomic(uint64_t) run_time;           // Time spent in `uv_run`, including waiting for events.
+    _Atomic(uint64_t) lock_waits;         // Number of `event_loop_lock` calls that had to wait.
+    _Atomic(uint64_t) lock_wait_time;     // Total time these calls waited for the loop.
+    _Atomic(uint64_t) submissions;        // Number of works run that were passed to `event_loop_submit`.
+    _Atomic(uint64_t) submit_latency;     // Total time between submitting and running these works.
+    _Atomic(uint64_t) max_submit_latency; // Longest time between submitting and running a work.
+} event_loop_stats_t;
+
 // Event loop structure for managing asynchronous events and synchronization across multiple threads.
 typedef struct {
     uv_loop_t  * loop;      // The libuv event loop.
@@ -24,11 +43,19 @@ typedef struct {
     uv_cond_t    cond_var;  // Condition variable for signaling that `loop` is free.
     uv_async_t   async;     // Async handle to interrupt `loop`.
     _Atomic(int) n_waiters; // Atomic counter for managing waiters for `loop`.
+    _Atomic(event_loop_work_t *) queue; // Lock free stack of work submitted by other threads.
+    event_loop_stats_t stats;
+    uv_timer_t   stats_timer; // Logs `stats` if `LEAN_EVENT_LOOP_STATS_INTERVAL` is set.
 } event_loop_t;
 
 // The multithreaded event loop object for all tasks in the task manager.
 extern event_loop_t global_ev;
 
+// All event loops, each run by its own thread. The first one is `global_ev`; further ones are
+// created if `LEAN_NUM_EVENT_LOOPS` is set to a number greater than one.
+extern event_loop_t ** g_event_loops;
+extern unsigned g_num_event_loops;
+
 // =======================================
 // Event loop manipulation functions.
 void event_loop_init(event_loop_t *event_loop);
@@ -36,6 +63,45 @@ void event_loop_cleanup(event_loop_t *event_loop);
 void event_loop_lock(event_loop_t *event_loop);
 void event_loop_unlock(event_loop_t *event_loop);
 void event_loop_run_loop(event_loop_t *event_loop);
+// Pick the event loop for a new handle or request. Loops are assigned round-robin; everything
+// related to a handle must happen on the loop it was created on.
+event_loop_t * event_loop_pick();
+// Run `fn(data)` on the event loop thread without waiting for the loop. Use this instead of
+// `event_loop_lock` for work whose result is not needed by the submitting thread.
+void event_loop_submit(event_loop_t *event_loop, void (*fn)(void *), void * data);
+
+// =======================================
+// Helpers for requests whose outcome is delivered through an `IO.Promise (Except IO.Error α)`.
+
+// Create a new promise, marked as shared since it is resolved on the event loop thread.
+static inline lean_object * create_promise() {
+    lean_object * prom_res = lean_io_promise_new(lean_io_mk_world());
+    lean_object * promise = lean_ctor_get(prom_res, 0);
+    lean_inc(promise);
+    lean_dec(prom_res);
+    lean_mark_mt(promise);
+    return promise;
+}
+
+// `Except.ok value`
+static inline lean_object * mk_except_ok(lean_object * value) {
+    lean_object * except = lean_alloc_ctor(1, 1, 0);
+    lean_ctor_set(except, 0, value);
+    return except;
+}
+
+// `Except.error` with the `IO.Error` corresponding to the libuv error code `status`.
+static inline lean_object * mk_except_err(int status) {
+    lean_object * except = lean_alloc_ctor(0, 1, 0);
+    lean_ctor_set(except, 0, lean_decode_uv_error(status, NULL));
+    return except;
+}
+
+// Resolve `promise` with `except`, taking ownership of `except`.
+static inline void resolve_promise(lean_object * promise, lean_object * except) {
+    lean_object * res = lean_io_promise_resolve(except, promise, lean_io_mk_world());
+    lean_dec(res);
+}
 
 #endif
 
@@ -43,5 +109,6 @@ void event_loop_run_loop(event_loop_t *event_loop);
 // Global event loop manipulation functions
 extern "C" LEAN_EXPORT lean_obj_res lean_uv_event_loop_configure(b_obj_arg options, obj_arg /* w */ );
 extern "C" LEAN_EXPORT lean_obj_res lean_uv_event_loop_alive(obj_arg /* w */ );
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_event_loop_stats(obj_arg /* w */ );
 
 }
@@ -0,0 +1,179 @@
+/*
+Copyright (c) 2025 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+*/
+#include <cstring>
+#include "runtime/uv/fs.h"
+
+namespace lean {
+#ifndef LEAN_EMSCRIPTEN
+
+using namespace std;
+
+// Resolves the promise of `req` with `Except.ok value` or, if the request failed, with
+// `Except.error`, and releases the request.
+static void fs_req_finish(lean_uv_fs_req * req, lean_object * value) {
+    lean_object * except;
+    if (req->m_uv_fs.result < 0) {
+        lean_assert(value == NULL);
+        except = lean_alloc_ctor(0, 1, 0);
+        lean_ctor_set(except, 0, lean_decode_uv_error((int)req->m_uv_fs.result, req->m_path));
+    } else {
+        except = mk_except_ok(value);
+    }
+
+    resolve_promise(req->m_promise, except);
+
+    uv_fs_req_cleanup(&req->m_uv_fs);
+    lean_dec(req->m_promise);
+    lean_dec(req->m_path);
+    if (req->m_new_path != NULL) lean_dec(req->m_new_path);
+    free(req);
+}
+
+static void handle_fs_unit_event(uv_fs_t * uv_fs) {
+    lean_uv_fs_req * req = (lean_uv_fs_req*)uv_fs->data;
+    fs_req_finish(req, uv_fs->result < 0 ? NULL : lean_box(0));
+}
+
+static lean_object * uv_timespec_to_obj(uv_timespec_t const & ts) {
+    lean_object * o = lean_alloc_ctor(0, 1, sizeof(uint32_t));
+    lean_ctor_set(o, 0, lean_int64_to_int(ts.tv_sec));
+    lean_ctor_set_uint32(o, sizeof(lean_object *), ts.tv_nsec);
+    return o;
+}
+
+// Keep in sync with `lean_io_metadata`.
+static void handle_fs_stat_event(uv_fs_t * uv_fs) {
+    lean_uv_fs_req * req = (lean_uv_fs_req*)uv_fs->data;
+    if (uv_fs->result < 0) {
+        fs_req_finish(req, NULL);
+        return;
+    }
+    uv_stat_t const & st = uv_fs->statbuf;
+    lean_object * mdata = lean_alloc_ctor(0, 2, sizeof(uint64_t) + sizeof(uint8_t));
+    lean_ctor_set(mdata, 0, uv_timespec_to_obj(st.st_atim));
+    lean_ctor_set(mdata, 1, uv_timespec_to_obj(st.st_mtim));
+    lean_ctor_set_uint64(mdata, 2 * sizeof(lean_object *), st.st_size);
+    uint64_t fmt = st.st_mode & S_IFMT;
+    lean_ctor_set_uint8(mdata, 2 * sizeof(lean_object *) + sizeof(uint64_t),
+                        fmt == S_IFDIR ? 0 :
+                        fmt == S_IFREG ? 1 :
+                        fmt == S_IFLNK ? 2 :
+                        3);
+    fs_req_finish(req, mdata);
+}
+
+// Starts the request on the event loop thread. Errors on submission are reported through the
+// promise like errors of the operation itself.
+static void fs_start(void * data) {
+    lean_uv_fs_req * req = (lean_uv_fs_req*)data;
+    char const * path = lean_string_cstr(req->m_path);
+    int result = UV_EINVAL;
+    switch (req->m_kind) {
+    case FS_REQ_METADATA:
+        result = uv_fs_stat(req->m_ev->loop, &req->m_uv_fs, path, handle_fs_stat_event);
+        break;
+    case FS_REQ_RENAME:
+        result = uv_fs_rename(req->m_ev->loop, &req->m_uv_fs, path, lean_string_cstr(req->m_new_path), handle_fs_unit_event);
+        break;
+    case FS_REQ_REMOVE_FILE:
+        result = uv_fs_unlink(req->m_ev->loop, &req->m_uv_fs, path, handle_fs_unit_event);
+        break;
+    case FS_REQ_CREATE_DIR:
+        result = uv_fs_mkdir(req->m_ev->loop, &req->m_uv_fs, path, 0777, handle_fs_unit_event);
+        break;
+    case FS_REQ_REMOVE_DIR:
+        result = uv_fs_rmdir(req->m_ev->loop, &req->m_uv_fs, path, handle_fs_unit_event);
+        break;
+    }
+    if (result < 0) {
+        // libuv does not invoke the callback for requests that failed on submission.
+        req->m_uv_fs.result = result;
+        fs_req_finish(req, NULL);
+    }
+}
+
+// Allocates a request of the given kind and submits it to the event loop. Returns its promise.
+static lean_obj_res fs_submit(uv_fs_req_kind kind, b_obj_arg path, b_obj_arg new_path) {
+    lean_uv_fs_req * req = (lean_uv_fs_req*)malloc(sizeof(lean_uv_fs_req));
+    req->m_kind = kind;
+    req->m_ev = event_loop_pick();
+    req->m_promise = create_promise();
+    memset(&req->m_uv_fs, 0, sizeof(uv_fs_t));
+    req->m_uv_fs.data = req;
+    // The paths are released on the event loop thread.
+    lean_mark_mt(path);
+    lean_inc(path);
+    req->m_path = path;
+    if (new_path != NULL) {
+        lean_mark_mt(new_path);
+        lean_inc(new_path);
+    }
+    req->m_new_path = new_path;
+
+    lean_inc(req->m_promise);
+    lean_object * promise = req->m_promise;
+    event_loop_submit(req->m_ev, fs_start, req);
+    return lean_io_result_mk_ok(promise);
+}
+
+/* Std.Internal.UV.FS.metadata (path : @& String) : IO (IO.Promise (Except IO.Error IO.FS.Metadata)) */
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_fs_metadata(b_obj_arg path, obj_arg /* w */) {
+    return fs_submit(FS_REQ_METADATA, path, NULL);
+}
+
+/* Std.Internal.UV.FS.rename (oldPath newPath : @& String) : IO (IO.Promise (Except IO.Error Unit)) */
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_fs_rename(b_obj_arg old_path, b_obj_arg new_path, obj_arg /* w */) {
+    return fs_submit(FS_REQ_RENAME, old_path, new_path);
+}
+
+/* Std.Internal.UV.FS.removeFile (path : @& String) : IO (IO.Promise (Except IO.Error Unit)) */
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_fs_remove_file(b_obj_arg path, obj_arg /* w */) {
+    return fs_submit(FS_REQ_REMOVE_FILE, path, NULL);
+}
+
+/* Std.Internal.UV.FS.createDir (path : @& String) : IO (IO.Promise (Except IO.Error Unit)) */
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_fs_create_dir(b_obj_arg path, obj_arg /* w */) {
+    return fs_submit(FS_REQ_CREATE_DIR, path, NULL);
+}
+
+/* Std.Internal.UV.FS.removeDir (path : @& String) : IO (IO.Promise (Except IO.Error Unit)) */
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_fs_remove_dir(b_obj_arg path, obj_arg /* w */) {
+    return fs_submit(FS_REQ_REMOVE_DIR, path, NULL);
+}
+
+#else
+
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_fs_metadata(b_obj_arg path, obj_arg /* w */) {
+    lean_always_assert(
+        false && ("Please build a version of Lean4 with libuv to invoke this.")
+    );
+}
+
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_fs_rename(b_obj_arg old_path, b_obj_arg new_path, obj_arg /* w */) {
+    lean_always_assert(
+        false && ("Please build a version of Lean4 with libuv to invoke this.")
+    );
+}
+
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_fs_remove_file(b_obj_arg path, obj_arg /* w */) {
+    lean_always_assert(
+        false && ("Please build a version of Lean4 with libuv to invoke this.")
+    );
+}
+
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_fs_create_dir(b_obj_arg path, obj_arg /* w */) {
+    lean_always_assert(
+        false && ("Please build a version of Lean4 with libuv to invoke this.")
+    );
+}
+
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_fs_remove_dir(b_obj_arg path, obj_arg /* w */) {
+    lean_always_assert(
+        false && ("Please build a version of Lean4 with libuv to invoke this.")
+    );
+}
+
+#endif
+}
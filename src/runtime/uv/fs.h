@@ -0,0 +1,46 @@
+/*
+Copyright (c) 2025 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+*/
+#pragma once
+#include <lean/lean.h>
+#include "runtime/uv/event_loop.h"
+
+namespace lean {
+
+#ifndef LEAN_EMSCRIPTEN
+using namespace std;
+#include <uv.h>
+
+// Structure for a single in-flight file system request. It is allocated when the request is
+// submitted, started on the event loop thread and freed after the promise has been resolved.
+enum uv_fs_req_kind {
+    FS_REQ_METADATA,
+    FS_REQ_RENAME,
+    FS_REQ_REMOVE_FILE,
+    FS_REQ_CREATE_DIR,
+    FS_REQ_REMOVE_DIR,
+};
+
+// The request owns references to the promise and paths, which are released on the event loop
+// thread once the request finishes. `fs_submit` therefore marks them as multi-threaded.
+typedef struct {
+    uv_fs_t         m_uv_fs;       // LibUV file system request.
+    uv_fs_req_kind  m_kind;        // The operation to perform.
+    event_loop_t *  m_ev;          // The event loop the request is submitted to.
+    lean_object *   m_promise;     // The promise resolved with the `Except IO.Error _` result.
+    lean_object *   m_path;        // The path the request operates on, also used for error messages.
+    lean_object *   m_new_path;    // The target path of `FS_REQ_RENAME`, `NULL` otherwise.
+} lean_uv_fs_req;
+
+#endif
+
+// =======================================
+// File system operations
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_fs_metadata(b_obj_arg path, obj_arg /* w */);
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_fs_rename(b_obj_arg old_path, b_obj_arg new_path, obj_arg /* w */);
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_fs_remove_file(b_obj_arg path, obj_arg /* w */);
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_fs_create_dir(b_obj_arg path, obj_arg /* w */);
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_fs_remove_dir(b_obj_arg path, obj_arg /* w */);
+
+}
@@ -55,6 +55,48 @@ lean_obj_res lean_in6_addr_to_ipv6_addr(const in6_addr* ipv6_addr) {
     return ret;
 }
 
+void lean_socket_address_to_sockaddr_storage(b_obj_arg socket_address, sockaddr_storage* out) {
+    memset(out, 0, sizeof(sockaddr_storage));
+    lean_object* socket_address_inner = lean_ctor_get(socket_address, 0);
+    lean_object* ip_addr = lean_ctor_get(socket_address_inner, 0);
+    uint16_t port = lean_ctor_get_uint16(socket_address_inner, sizeof(void*));
+    if (lean_obj_tag(socket_address) == 0) {
+        sockaddr_in* cast = (sockaddr_in*)out;
+        cast->sin_family = AF_INET;
+        cast->sin_port = htons(port);
+        lean_ipv4_addr_to_in_addr(ip_addr, &cast->sin_addr);
+    } else {
+        sockaddr_in6* cast = (sockaddr_in6*)out;
+        cast->sin6_family = AF_INET6;
+        cast->sin6_port = htons(port);
+        lean_ipv6_addr_to_in6_addr(ip_addr, &cast->sin6_addr);
+    }
+}
+
+lean_obj_res lean_sockaddr_to_socket_address(const sockaddr* sockaddr) {
+    lean_object* ip_addr;
+    uint16_t port;
+    unsigned tag;
+    if (sockaddr->sa_family == AF_INET) {
+        const sockaddr_in* cast = (const sockaddr_in*)sockaddr;
+        ip_addr = lean_in_addr_to_ipv4_addr(&cast->sin_addr);
+        port = ntohs(cast->sin_port);
+        tag = 0;
+    } else {
+        lean_assert(sockaddr->sa_family == AF_INET6);
+        const sockaddr_in6* cast = (const sockaddr_in6*)sockaddr;
+        ip_addr = lean_in6_addr_to_ipv6_addr(&cast->sin6_addr);
+        port = ntohs(cast->sin6_port);
+        tag = 1;
+    }
+    lean_object* socket_address_inner = lean_alloc_ctor(0, 1, sizeof(uint16_t));
+    lean_ctor_set(socket_address_inner, 0, ip_addr);
+    lean_ctor_set_uint16(socket_address_inner, sizeof(void*), port);
+    lean_object* socket_address = lean_alloc_ctor(tag, 1, 0);
+    lean_ctor_set(socket_address, 0, socket_address_inner);
+    return socket_address;
+}
+
 /* Std.Net.IPV4Addr.ofString (s : @&String) : Option IPV4Addr */
 extern "C" LEAN_EXPORT lean_obj_res lean_uv_pton_v4(b_obj_arg str_obj) {
     const char* str = string_cstr(str_obj);
@@ -0,0 +1,484 @@
+/*
+Copyright (c) 2025 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+*/
+#include "runtime/uv/tcp.h"
+
+namespace lean {
+#ifndef LEAN_EMSCRIPTEN
+
+using namespace std;
+
+/*
+All operations on a socket lock its event loop, which also keeps the callbacks, which run on the
+event loop thread with the loop locked, from observing the socket in an intermediate state.
+While an operation is pending the socket is kept alive by a reference owned by that operation.
+*/
+
+// The finalizer of the `Socket`. Pending operations keep the socket alive, so there are none left here.
+void lean_uv_tcp_socket_finalizer(void* ptr) {
+    lean_uv_tcp_socket_object * tcp_socket = (lean_uv_tcp_socket_object*) ptr;
+    lean_assert(tcp_socket->m_promise_accept == NULL && tcp_socket->m_promise_read == NULL);
+
+    if (tcp_socket->m_byte_array != NULL) {
+        lean_dec(tcp_socket->m_byte_array);
+    }
+
+    // The handle is closed right away with the loop locked, as callbacks such as the one of
+    // `listen` may otherwise still run and access the freed socket through `data`. The socket data
+    // is freed together with the handle once it has been closed.
+    event_loop_t * ev = tcp_socket->m_ev;
+    event_loop_lock(ev);
+    tcp_socket->m_uv_tcp->data = tcp_socket;
+    uv_close((uv_handle_t*)tcp_socket->m_uv_tcp, [](uv_handle_t* handle) {
+        free(handle->data);
+        free(handle);
+    });
+    event_loop_unlock(ev);
+}
+
+void initialize_libuv_tcp_socket() {
+    g_uv_tcp_socket_external_class = lean_register_external_class(lean_uv_tcp_socket_finalizer, [](void* obj, lean_object* f) {
+        lean_uv_tcp_socket_object * tcp_socket = (lean_uv_tcp_socket_object*)obj;
+        if (tcp_socket->m_promise_accept != NULL) {
+            lean_inc(f);
+            lean_apply_1(f, tcp_socket->m_promise_accept);
+        }
+        if (tcp_socket->m_promise_read != NULL) {
+            lean_inc(f);
+            lean_apply_1(f, tcp_socket->m_promise_read);
+        }
+    });
+}
+
+// Create a socket on `ev`, which must be locked by the caller.
+static int tcp_socket_alloc(event_loop_t * ev, lean_object ** out) {
+    uv_tcp_t * uv_tcp = (uv_tcp_t*)malloc(sizeof(uv_tcp_t));
+    int result = uv_tcp_init(ev->loop, uv_tcp);
+    if (result != 0) {
+        free(uv_tcp);
+        return result;
+    }
+
+    lean_uv_tcp_socket_object * tcp_socket = (lean_uv_tcp_socket_object*)malloc(sizeof(lean_uv_tcp_socket_object));
+    tcp_socket->m_uv_tcp = uv_tcp;
+    tcp_socket->m_ev = ev;
+    tcp_socket->m_promise_accept = NULL;
+    tcp_socket->m_promise_read = NULL;
+    tcp_socket->m_byte_array = NULL;
+    tcp_socket->m_read_size = 0;
+    tcp_socket->m_pending_connections = 0;
+
+    lean_object * obj = lean_uv_tcp_socket_new(tcp_socket);
+    lean_mark_mt(obj);
+    uv_tcp->data = obj;
+    *out = obj;
+    return 0;
+}
+
+// The promise of the new request has a second reference, which is returned to the caller by
+// `tcp_req_started`, as the request may be finished and freed as soon as the loop is unlocked.
+static lean_uv_tcp_req * tcp_req_new(b_obj_arg socket, lean_object * data) {
+    lean_uv_tcp_req * req = (lean_uv_tcp_req*)malloc(sizeof(lean_uv_tcp_req));
+    req->m_promise = create_promise();
+    lean_inc(req->m_promise);
+    lean_inc(socket);
+    req->m_socket = socket;
+    req->m_data = data;
+    return req;
+}
+
+static void tcp_req_free(lean_uv_tcp_req * req) {
+    lean_dec(req->m_promise);
+    if (req->m_data != NULL) lean_dec(req->m_data);
+    lean_dec(req->m_socket);
+    free(req);
+}
+
+static void tcp_req_finish(lean_uv_tcp_req * req, int status) {
+    resolve_promise(req->m_promise, status < 0 ? mk_except_err(status) : mk_except_ok(lean_box(0)));
+    tcp_req_free(req);
+}
+
+// Returns `promise`, the caller's reference to the promise of `req`, if the request was started,
+// and frees the request otherwise. `req` must not be accessed if it was started.
+static lean_obj_res tcp_req_started(lean_uv_tcp_req * req, lean_object * promise, int result) {
+    if (result < 0) {
+        lean_dec(promise);
+        tcp_req_free(req);
+        return lean_io_result_mk_error(lean_decode_uv_error(result, NULL));
+    }
+    return lean_io_result_mk_ok(promise);
+}
+
+/* Std.Internal.UV.TCP.Socket.new : IO Socket */
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_tcp_new(obj_arg /* w */) {
+    event_loop_t * ev = event_loop_pick();
+    lean_object * obj;
+
+    event_loop_lock(ev);
+    int result = tcp_socket_alloc(ev, &obj);
+    event_loop_unlock(ev);
+
+    if (result != 0) {
+        return lean_io_result_mk_error(lean_decode_uv_error(result, NULL));
+    }
+    return lean_io_result_mk_ok(obj);
+}
+
+/* Std.Internal.UV.TCP.Socket.connect (socket : @& Socket) (addr : @& SocketAddress) : IO (IO.Promise (Except IO.Error Unit)) */
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_tcp_connect(b_obj_arg socket, b_obj_arg addr, obj_arg /* w */) {
+    lean_uv_tcp_socket_object * tcp_socket = lean_to_uv_tcp_socket(socket);
+    sockaddr_storage addr_ptr;
+    lean_socket_address_to_sockaddr_storage(addr, &addr_ptr);
+
+    lean_uv_tcp_req * req = tcp_req_new(socket, NULL);
+    req->m_uv_req.m_connect.data = req;
+    lean_object * promise = req->m_promise;
+
+    event_loop_lock(tcp_socket->m_ev);
+    int result = uv_tcp_connect(&req->m_uv_req.m_connect, tcp_socket->m_uv_tcp, (const sockaddr*)&addr_ptr, [](uv_connect_t* uv_connect, int status) {
+        tcp_req_finish((lean_uv_tcp_req*)uv_connect->data, status);
+    });
+    event_loop_unlock(tcp_socket->m_ev);
+
+    return tcp_req_started(req, promise, result);
+}
+
+/* Std.Internal.UV.TCP.Socket.send (socket : @& Socket) (data : ByteArray) : IO (IO.Promise (Except IO.Error Unit)) */
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_tcp_send(b_obj_arg socket, obj_arg data, obj_arg /* w */) {
+    lean_uv_tcp_socket_object * tcp_socket = lean_to_uv_tcp_socket(socket);
+
+    // The data is written directly from the `ByteArray`, which is released on the event loop thread.
+    lean_mark_mt(data);
+    lean_uv_tcp_req * req = tcp_req_new(socket, data);
+    req->m_uv_req.m_write.data = req;
+    lean_object * promise = req->m_promise;
+    uv_buf_t buf = uv_buf_init((char*)lean_sarray_cptr(data), (unsigned int)lean_sarray_size(data));
+
+    event_loop_lock(tcp_socket->m_ev);
+    int result = uv_write(&req->m_uv_req.m_write, (uv_stream_t*)tcp_socket->m_uv_tcp, &buf, 1, [](uv_write_t* uv_write, int status) {
+        tcp_req_finish((lean_uv_tcp_req*)uv_write->data, status);
+    });
+    event_loop_unlock(tcp_socket->m_ev);
+
+    return tcp_req_started(req, promise, result);
+}
+
+/* Std.Internal.UV.TCP.Socket.recv? (socket : @& Socket) (size : UInt64) : IO (IO.Promise (Except IO.Error (Option ByteArray))) */
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_tcp_recv(b_obj_arg socket, uint64_t size, obj_arg /* w */) {
+    lean_uv_tcp_socket_object * tcp_socket = lean_to_uv_tcp_socket(socket);
+    if (size == 0) {
+        return lean_io_result_mk_error(lean_decode_uv_error(UV_EINVAL, NULL));
+    }
+
+    event_loop_lock(tcp_socket->m_ev);
+
+    if (tcp_socket->m_promise_read != NULL) {
+        event_loop_unlock(tcp_socket->m_ev);
+        return lean_io_result_mk_error(lean_decode_uv_error(UV_EALREADY, NULL));
+    }
+
+    // The bytes are read directly into a `ByteArray` of the requested size.
+    auto alloc_cb = [](uv_handle_t* handle, size_t /* suggested_size */, uv_buf_t* buf) {
+        lean_uv_tcp_socket_object * tcp_socket = lean_to_uv_tcp_socket((lean_object*)handle->data);
+        if (tcp_socket->m_byte_array == NULL) {
+            tcp_socket->m_byte_array = lean_alloc_sarray(1, 0, tcp_socket->m_read_size);
+        }
+        buf->base = (char*)lean_sarray_cptr(tcp_socket->m_byte_array);
+        buf->len = lean_sarray_capacity(tcp_socket->m_byte_array);
+    };
+
+    auto read_cb = [](uv_stream_t* stream, ssize_t nread, const uv_buf_t* /* buf */) {
+        if (nread == 0) {
+            // Nothing was read (`EAGAIN`), keep the buffer for the next attempt.
+            return;
+        }
+        lean_object * obj = (lean_object*)stream->data;
+        lean_uv_tcp_socket_object * tcp_socket = lean_to_uv_tcp_socket(obj);
+        uv_read_stop(stream);
+
+        lean_object * promise = tcp_socket->m_promise_read;
+        tcp_socket->m_promise_read = NULL;
+        lean_object * except;
+        if (nread > 0) {
+            lean_object * byte_array = tcp_socket->m_byte_array;
+            tcp_socket->m_byte_array = NULL;
+            lean_sarray_set_size(byte_array, nread);
+            except = mk_except_ok(mk_option_some(byte_array));
+        } else if (nread == UV_EOF) {
+            except = mk_except_ok(mk_option_none());
+        } else {
+            except = mk_except_err((int)nread);
+        }
+        resolve_promise(promise, except);
+        lean_dec(promise);
+
+        // The pending read does not need to keep the socket alive anymore.
+        lean_dec(obj);
+    };
+
+    if (tcp_socket->m_byte_array != NULL) {
+        // left over from a previous read that did not return any data
+        lean_dec(tcp_socket->m_byte_array);
+        tcp_socket->m_byte_array = NULL;
+    }
+    tcp_socket->m_read_size = size;
+    lean_object * promise = create_promise();
+    tcp_socket->m_promise_read = promise;
+    lean_inc(socket);
+
+    int result = uv_read_start((uv_stream_t*)tcp_socket->m_uv_tcp, alloc_cb, read_cb);
+
+    if (result < 0) {
+        tcp_socket->m_promise_read = NULL;
+        event_loop_unlock(tcp_socket->m_ev);
+        lean_dec(promise);
+        lean_dec(socket);
+        return lean_io_result_mk_error(lean_decode_uv_error(result, NULL));
+    }
+
+    lean_inc(promise);
+    event_loop_unlock(tcp_socket->m_ev);
+    return lean_io_result_mk_ok(promise);
+}
+
+/* Std.Internal.UV.TCP.Socket.bind (socket : @& Socket) (addr : @& SocketAddress) : IO Unit */
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_tcp_bind(b_obj_arg socket, b_obj_arg addr, obj_arg /* w */) {
+    lean_uv_tcp_socket_object * tcp_socket = lean_to_uv_tcp_socket(socket);
+    sockaddr_storage addr_ptr;
+    lean_socket_address_to_sockaddr_storage(addr, &addr_ptr);
+
+    event_loop_lock(tcp_socket->m_ev);
+    int result = uv_tcp_bind(tcp_socket->m_uv_tcp, (const sockaddr*)&addr_ptr, 0);
+    event_loop_unlock(tcp_socket->m_ev);
+
+    if (result < 0) {
+        return lean_io_result_mk_error(lean_decode_uv_error(result, NULL));
+    }
+    return lean_io_result_mk_ok(lean_box(0));
+}
+
+// Accept a connection on `server`, whose event loop must be locked by the caller, and return the
+// result as an `Except IO.Error Socket`.
+static lean_object * tcp_accept_core(lean_uv_tcp_socket_object * server) {
+    lean_object * client;
+    int result = tcp_socket_alloc(server->m_ev, &client);
+    if (result < 0) {
+        return mk_except_err(result);
+    }
+    result = uv_accept((uv_stream_t*)server->m_uv_tcp, (uv_stream_t*)lean_to_uv_tcp_socket(client)->m_uv_tcp);
+    if (result < 0) {
+        lean_dec(client);
+        return mk_except_err(result);
+    }
+    return mk_except_ok(client);
+}
+
+/* Std.Internal.UV.TCP.Socket.listen (socket : @& Socket) (backlog : UInt32) : IO Unit */
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_tcp_listen(b_obj_arg socket, uint32_t backlog, obj_arg /* w */) {
+    lean_uv_tcp_socket_object * tcp_socket = lean_to_uv_tcp_socket(socket);
+
+    event_loop_lock(tcp_socket->m_ev);
+    int result = uv_listen((uv_stream_t*)tcp_socket->m_uv_tcp, (int)backlog, [](uv_stream_t* stream, int status) {
+        lean_object * obj = (lean_object*)stream->data;
+        lean_uv_tcp_socket_object * server = lean_to_uv_tcp_socket(obj);
+        if (server->m_promise_accept == NULL) {
+            if (status == 0) server->m_pending_connections++;
+            return;
+        }
+        lean_object * promise = server->m_promise_accept;
+        server->m_promise_accept = NULL;
+        resolve_promise(promise, status < 0 ? mk_except_err(status) : tcp_accept_core(server));
+        lean_dec(promise);
+
+        // The pending accept does not need to keep the socket alive anymore.
+        lean_dec(obj);
+    });
+    event_loop_unlock(tcp_socket->m_ev);
+
+    if (result < 0) {
+        return lean_io_result_mk_error(lean_decode_uv_error(result, NULL));
+    }
+    return lean_io_result_mk_ok(lean_box(0));
+}
+
+/* Std.Internal.UV.TCP.Socket.accept (socket : @& Socket) : IO (IO.Promise (Except IO.Error Socket)) */
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_tcp_accept(b_obj_arg socket, obj_arg /* w */) {
+    lean_uv_tcp_socket_object * tcp_socket = lean_to_uv_tcp_socket(socket);
+
+    event_loop_lock(tcp_socket->m_ev);
+
+    if (tcp_socket->m_promise_accept != NULL) {
+        event_loop_unlock(tcp_socket->m_ev);
+        return lean_io_result_mk_error(lean_decode_uv_error(UV_EALREADY, NULL));
+    }
+
+    lean_object * promise = create_promise();
+    if (tcp_socket->m_pending_connections > 0) {
+        tcp_socket->m_pending_connections--;
+        resolve_promise(promise, tcp_accept_core(tcp_socket));
+    } else {
+        lean_inc(promise);
+        tcp_socket->m_promise_accept = promise;
+        // The pending accept keeps the socket alive.
+        lean_inc(socket);
+    }
+
+    event_loop_unlock(tcp_socket->m_ev);
+    return lean_io_result_mk_ok(promise);
+}
+
+/* Std.Internal.UV.TCP.Socket.shutdown (socket : @& Socket) : IO (IO.Promise (Except IO.Error Unit)) */
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_tcp_shutdown(b_obj_arg socket, obj_arg /* w */) {
+    lean_uv_tcp_socket_object * tcp_socket = lean_to_uv_tcp_socket(socket);
+
+    lean_uv_tcp_req * req = tcp_req_new(socket, NULL);
+    req->m_uv_req.m_shutdown.data = req;
+    lean_object * promise = req->m_promise;
+
+    event_loop_lock(tcp_socket->m_ev);
+    int result = uv_shutdown(&req->m_uv_req.m_shutdown, (uv_stream_t*)tcp_socket->m_uv_tcp, [](uv_shutdown_t* uv_shutdown, int status) {
+        tcp_req_finish((lean_uv_tcp_req*)uv_shutdown->data, status);
+    });
+    event_loop_unlock(tcp_socket->m_ev);
+
+    return tcp_req_started(req, promise, result);
+}
+
+/* Std.Internal.UV.TCP.Socket.getPeerName (socket : @& Socket) : IO SocketAddress */
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_tcp_getpeername(b_obj_arg socket, obj_arg /* w */) {
+    lean_uv_tcp_socket_object * tcp_socket = lean_to_uv_tcp_socket(socket);
+    sockaddr_storage addr_storage;
+    int len = sizeof(addr_storage);
+
+    event_loop_lock(tcp_socket->m_ev);
+    int result = uv_tcp_getpeername(tcp_socket->m_uv_tcp, (sockaddr*)&addr_storage, &len);
+    event_loop_unlock(tcp_socket->m_ev);
+
+    if (result < 0) {
+        return lean_io_result_mk_error(lean_decode_uv_error(result, NULL));
+    }
+    return lean_io_result_mk_ok(lean_sockaddr_to_socket_address((const sockaddr*)&addr_storage));
+}
+
+/* Std.Internal.UV.TCP.Socket.getSockName (socket : @& Socket) : IO SocketAddress */
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_tcp_getsockname(b_obj_arg socket, obj_arg /* w */) {
+    lean_uv_tcp_socket_object * tcp_socket = lean_to_uv_tcp_socket(socket);
+    sockaddr_storage addr_storage;
+    int len = sizeof(addr_storage);
+
+    event_loop_lock(tcp_socket->m_ev);
+    int result = uv_tcp_getsockname(tcp_socket->m_uv_tcp, (sockaddr*)&addr_storage, &len);
+    event_loop_unlock(tcp_socket->m_ev);
+
+    if (result < 0) {
+        return lean_io_result_mk_error(lean_decode_uv_error(result, NULL));
+    }
+    return lean_io_result_mk_ok(lean_sockaddr_to_socket_address((const sockaddr*)&addr_storage));
+}
+
+/* Std.Internal.UV.TCP.Socket.noDelay (socket : @& Socket) : IO Unit */
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_tcp_nodelay(b_obj_arg socket, obj_arg /* w */) {
+    lean_uv_tcp_socket_object * tcp_socket = lean_to_uv_tcp_socket(socket);
+
+    event_loop_lock(tcp_socket->m_ev);
+    int result = uv_tcp_nodelay(tcp_socket->m_uv_tcp, 1);
+    event_loop_unlock(tcp_socket->m_ev);
+
+    if (result < 0) {
+        return lean_io_result_mk_error(lean_decode_uv_error(result, NULL));
+    }
+    return lean_io_result_mk_ok(lean_box(0));
+}
+
+/* Std.Internal.UV.TCP.Socket.keepAlive (socket : @& Socket) (enable : Bool) (delay : UInt32) : IO Unit */
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_tcp_keepalive(b_obj_arg socket, uint8_t enable, uint32_t delay, obj_arg /* w */) {
+    lean_uv_tcp_socket_object * tcp_socket = lean_to_uv_tcp_socket(socket);
+
+    event_loop_lock(tcp_socket->m_ev);
+    int result = uv_tcp_keepalive(tcp_socket->m_uv_tcp, enable, delay);
+    event_loop_unlock(tcp_socket->m_ev);
+
+    if (result < 0) {
+        return lean_io_result_mk_error(lean_decode_uv_error(result, NULL));
+    }
+    return lean_io_result_mk_ok(lean_box(0));
+}
+
+#else
+
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_tcp_new(obj_arg /* w */) {
+    lean_always_assert(
+        false && ("Please build a version of Lean4 with libuv to invoke this.")
+    );
+}
+
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_tcp_connect(b_obj_arg socket, b_obj_arg addr, obj_arg /* w */) {
+    lean_always_assert(
+        false && ("Please build a version of Lean4 with libuv to invoke this.")
+    );
+}
+
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_tcp_send(b_obj_arg socket, obj_arg data, obj_arg /* w */) {
+    lean_always_assert(
+        false && ("Please build a version of Lean4 with libuv to invoke this.")
+    );
+}
+
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_tcp_recv(b_obj_arg socket, uint64_t size, obj_arg /* w */) {
+    lean_always_assert(
+        false && ("Please build a version of Lean4 with libuv to invoke this.")
+    );
+}
+
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_tcp_bind(b_obj_arg socket, b_obj_arg addr, obj_arg /* w */) {
+    lean_always_assert(
+        false && ("Please build a version of Lean4 with libuv to invoke this.")
+    );
+}
+
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_tcp_listen(b_obj_arg socket, uint32_t backlog, obj_arg /* w */) {
+    lean_always_assert(
+        false && ("Please build a version of Lean4 with libuv to invoke this.")
+    );
+}
+
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_tcp_accept(b_obj_arg socket, obj_arg /* w */) {
+    lean_always_assert(
+        false && ("Please build a version of Lean4 with libuv to invoke this.")
+    );
+}
+
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_tcp_shutdown(b_obj_arg socket, obj_arg /* w */) {
+    lean_always_assert(
+        false && ("Please build a version of Lean4 with libuv to invoke this.")
+    );
+}
+
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_tcp_getpeername(b_obj_arg socket, obj_arg /* w */) {
+    lean_always_assert(
+        false && ("Please build a version of Lean4 with libuv to invoke this.")
+    );
+}
+
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_tcp_getsockname(b_obj_arg socket, obj_arg /* w */) {
+    lean_always_assert(
+        false && ("Please build a version of Lean4 with libuv to invoke this.")
+    );
+}
+
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_tcp_nodelay(b_obj_arg socket, obj_arg /* w */) {
+    lean_always_assert(
+        false && ("Please build a version of Lean4 with libuv to invoke this.")
+    );
+}
+
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_tcp_keepalive(b_obj_arg socket, uint8_t enable, uint32_t delay, obj_arg /* w */) {
+    lean_always_assert(
+        false && ("Please build a version of Lean4 with libuv to invoke this.")
+    );
+}
+
+#endif
+}
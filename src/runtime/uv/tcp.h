@@ -0,0 +1,65 @@
+/*
+Copyright (c) 2025 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+*/
+#pragma once
+#include <lean/lean.h>
+#include "runtime/uv/event_loop.h"
+#include "runtime/uv/net_addr.h"
+
+namespace lean {
+
+static lean_external_class * g_uv_tcp_socket_external_class = NULL;
+void initialize_libuv_tcp_socket();
+
+#ifndef LEAN_EMSCRIPTEN
+using namespace std;
+#include <uv.h>
+
+// Structure for managing a single TCP socket object, including the promises of its pending
+// operations. All fields are only accessed with the event loop `m_ev` locked.
+typedef struct {
+    uv_tcp_t *      m_uv_tcp;               // LibUV TCP handle, whose `data` is the `Socket` object.
+    event_loop_t *  m_ev;                   // The event loop the handle belongs to.
+    lean_object *   m_promise_accept;       // The promise of the pending `accept`, or `NULL`.
+    lean_object *   m_promise_read;         // The promise of the pending `recv?`, or `NULL`.
+    lean_object *   m_byte_array;           // The buffer the pending `recv?` reads into, or `NULL`.
+    uint64_t        m_read_size;            // The maximal number of bytes of the pending `recv?`.
+    uint32_t        m_pending_connections;  // Connections that arrived while no `accept` was pending.
+} lean_uv_tcp_socket_object;
+
+// Structure for a connect, write or shutdown request on a TCP socket.
+typedef struct {
+    union {
+        uv_connect_t    m_connect;
+        uv_write_t      m_write;
+        uv_shutdown_t   m_shutdown;
+    }               m_uv_req;     // LibUV request.
+    lean_object *   m_promise;    // The promise resolved once the request has completed.
+    lean_object *   m_socket;     // The socket, kept alive until then.
+    lean_object *   m_data;       // The `ByteArray` being written, or `NULL`.
+} lean_uv_tcp_req;
+
+// =======================================
+// TCP socket object manipulation functions.
+static inline lean_object* lean_uv_tcp_socket_new(lean_uv_tcp_socket_object * s) { return lean_alloc_external(g_uv_tcp_socket_external_class, s); }
+static inline lean_uv_tcp_socket_object* lean_to_uv_tcp_socket(lean_object * o) { return (lean_uv_tcp_socket_object*)(lean_get_external_data(o)); }
+
+#endif
+
+// =======================================
+// TCP socket manipulation functions
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_tcp_new(obj_arg /* w */);
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_tcp_connect(b_obj_arg socket, b_obj_arg addr, obj_arg /* w */);
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_tcp_send(b_obj_arg socket, obj_arg data, obj_arg /* w */);
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_tcp_recv(b_obj_arg socket, uint64_t size, obj_arg /* w */);
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_tcp_bind(b_obj_arg socket, b_obj_arg addr, obj_arg /* w */);
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_tcp_listen(b_obj_arg socket, uint32_t backlog, obj_arg /* w */);
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_tcp_accept(b_obj_arg socket, obj_arg /* w */);
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_tcp_shutdown(b_obj_arg socket, obj_arg /* w */);
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_tcp_getpeername(b_obj_arg socket, obj_arg /* w */);
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_tcp_getsockname(b_obj_arg socket, obj_arg /* w */);
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_tcp_nodelay(b_obj_arg socket, obj_arg /* w */);
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_tcp_keepalive(b_obj_arg socket, uint8_t enable, uint32_t delay, obj_arg /* w */);
+
+}
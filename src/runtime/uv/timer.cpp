@@ -19,13 +19,11 @@ void lean_uv_timer_finalizer(void* ptr) {
         lean_dec(timer->m_promise);
     }
 
-    event_loop_lock(&global_ev);
-
-    uv_close((uv_handle_t*)timer->m_uv_timer, [](uv_handle_t* handle) {
-        free(handle);
-    });
-
-    event_loop_unlock(&global_ev);
+    event_loop_submit(timer->m_ev, [](void* uv_timer) {
+        uv_close((uv_handle_t*)uv_timer, [](uv_handle_t* handle) {
+            free(handle);
+        });
+    }, timer->m_uv_timer);
 
     free(timer);
 }
@@ -79,9 +77,10 @@ extern "C" LEAN_EXPORT lean_obj_res lean_uv_timer_mk(uint64_t timeout, uint8_t r
 
     uv_timer_t * uv_timer = (uv_timer_t*)malloc(sizeof(uv_timer_t));
 
-    event_loop_lock(&global_ev);
-    int result = uv_timer_init(global_ev.loop, uv_timer);
-    event_loop_unlock(&global_ev);
+    event_loop_t * ev = event_loop_pick();
+    event_loop_lock(ev);
+    int result = uv_timer_init(ev->loop, uv_timer);
+    event_loop_unlock(ev);
 
     if (result != 0) {
         free(uv_timer);
@@ -90,6 +89,7 @@ extern "C" LEAN_EXPORT lean_obj_res lean_uv_timer_mk(uint64_t timeout, uint8_t r
     }
 
     timer->m_uv_timer = uv_timer;
+    timer->m_ev = ev;
 
     lean_object * obj = lean_uv_timer_new(timer);
     lean_mark_mt(obj);
@@ -119,7 +119,7 @@ extern "C" LEAN_EXPORT lean_obj_res lean_uv_timer_next(b_obj_arg obj, obj_arg /*
         // The event loop must keep the timer alive for the duration of the run time.
         lean_inc(obj);
 
-        event_loop_lock(&global_ev);
+        event_loop_lock(timer->m_ev);
 
         int result = uv_timer_start(
             timer->m_uv_timer,
@@ -128,7 +128,7 @@ extern "C" LEAN_EXPORT lean_obj_res lean_uv_timer_next(b_obj_arg obj, obj_arg /*
             timer->m_repeating ? timer->m_timeout : 0
         );
 
-        event_loop_unlock(&global_ev);
+        event_loop_unlock(timer->m_ev);
 
         if (result != 0) {
             lean_dec(obj);
@@ -185,7 +185,7 @@ extern "C" LEAN_EXPORT lean_obj_res lean_uv_timer_reset(b_obj_arg obj, obj_arg /
     if (timer->m_state == TIMER_STATE_RUNNING) {
         lean_assert(timer->m_promise != NULL);
 
-        event_loop_lock(&global_ev);
+        event_loop_lock(timer->m_ev);
 
         uv_timer_stop(timer->m_uv_timer);
 
@@ -196,7 +196,7 @@ extern "C" LEAN_EXPORT lean_obj_res lean_uv_timer_reset(b_obj_arg obj, obj_arg /
             timer->m_repeating ? timer->m_timeout : 0
         );
 
-        event_loop_unlock(&global_ev);
+        event_loop_unlock(timer->m_ev);
 
         if (result != 0) {
             return lean_io_result_mk_error(lean_decode_uv_error(result, NULL));
@@ -215,11 +215,11 @@ extern "C" LEAN_EXPORT lean_obj_res lean_uv_timer_stop(b_obj_arg obj, obj_arg /*
     if (timer->m_state == TIMER_STATE_RUNNING) {
         lean_assert(timer->m_promise != NULL);
 
-        event_loop_lock(&global_ev);
+        event_loop_lock(timer->m_ev);
 
         uv_timer_stop(timer->m_uv_timer);
 
-        event_loop_unlock(&global_ev);
+        event_loop_unlock(timer->m_ev);
 
         timer->m_state = TIMER_STATE_FINISHED;
 
@@ -27,6 +27,7 @@ enum uv_timer_state {
 // repeating behavior.
 typedef struct {
     uv_timer_t *    m_uv_timer;    // LibUV timer handle.
+    event_loop_t *  m_ev;          // The event loop the timer handle belongs to.
     lean_object *   m_promise;     // The associated promise for asynchronous results.
     uint64_t        m_timeout;     // Timeout duration in milliseconds.
     bool            m_repeating;   // Flag indicating if the timer is repeating.
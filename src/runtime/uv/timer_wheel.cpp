@@ -0,0 +1,181 @@
+/*
+Copyright (c) 2025 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+*/
+#include "runtime/uv/timer_wheel.h"
+
+namespace lean {
+#ifndef LEAN_EMSCRIPTEN
+
+using namespace std;
+
+// The timer wheel of `global_ev`. It is only accessed while holding the lock of `global_ev` or
+// from its loop thread.
+static timer_wheel g_timer_wheel;
+
+static uint64_t timer_wheel_now() {
+    uv_update_time(global_ev.loop);
+    return uv_now(global_ev.loop);
+}
+
+// Compute where the entry expiring at `expiry` belongs relative to `w->m_current`.
+static timer_wheel_entry ** timer_wheel_slot(timer_wheel * w, uint64_t expiry) {
+    uint64_t delta = expiry > w->m_current ? expiry - w->m_current : 0;
+    unsigned level = 0;
+    while (level < LEAN_TIMER_WHEEL_LEVELS - 1 && delta >= (1ull << (LEAN_TIMER_WHEEL_SLOT_BITS * (level + 1)))) {
+        level++;
+    }
+    uint64_t max_delta = (1ull << (LEAN_TIMER_WHEEL_SLOT_BITS * LEAN_TIMER_WHEEL_LEVELS)) - 1;
+    if (delta > max_delta) {
+        // Park it in the furthest slot, it is moved again once that slot is cascaded.
+        expiry = w->m_current + max_delta;
+    }
+    uint64_t idx = (expiry >> (LEAN_TIMER_WHEEL_SLOT_BITS * level)) & (LEAN_TIMER_WHEEL_SLOTS - 1);
+    return &w->m_slots[level][idx];
+}
+
+static void timer_wheel_insert(timer_wheel * w, timer_wheel_entry * entry) {
+    timer_wheel_entry ** slot = timer_wheel_slot(w, entry->m_expiry);
+    entry->m_next = *slot;
+    *slot = entry;
+}
+
+// Move all entries of slot `idx` on `level` to the levels below.
+static void timer_wheel_cascade(timer_wheel * w, unsigned level, uint64_t idx) {
+    timer_wheel_entry * entry = w->m_slots[level][idx];
+    w->m_slots[level][idx] = NULL;
+    while (entry != NULL) {
+        timer_wheel_entry * next = entry->m_next;
+        timer_wheel_insert(w, entry);
+        entry = next;
+    }
+}
+
+// Process all ticks up to and including `tick`, resolving every expired promise.
+static void timer_wheel_advance(timer_wheel * w, uint64_t tick) {
+    while (w->m_current < tick) {
+        if (w->m_count == 0) {
+            w->m_current = tick;
+            break;
+        }
+
+        uint64_t current = ++w->m_current;
+
+        unsigned level = 0;
+        while (level < LEAN_TIMER_WHEEL_LEVELS - 1 &&
+               (current & ((1ull << (LEAN_TIMER_WHEEL_SLOT_BITS * (level + 1))) - 1)) == 0) {
+            level++;
+        }
+        for (; level > 0; level--) {
+            timer_wheel_cascade(w, level, (current >> (LEAN_TIMER_WHEEL_SLOT_BITS * level)) & (LEAN_TIMER_WHEEL_SLOTS - 1));
+        }
+
+        timer_wheel_entry ** slot = &w->m_slots[0][current & (LEAN_TIMER_WHEEL_SLOTS - 1)];
+        timer_wheel_entry * entry = *slot;
+        *slot = NULL;
+        while (entry != NULL) {
+            timer_wheel_entry * next = entry->m_next;
+            lean_assert(entry->m_expiry <= current);
+            lean_object* res = lean_io_promise_resolve(lean_box(0), entry->m_promise, lean_io_mk_world());
+            lean_dec(res);
+            lean_dec(entry->m_promise);
+            free(entry);
+            w->m_count--;
+            entry = next;
+        }
+    }
+}
+
+void handle_timer_wheel_event(uv_timer_t* handle) {
+    timer_wheel * w = &g_timer_wheel;
+    timer_wheel_advance(w, uv_now(handle->loop) / LEAN_TIMER_WHEEL_TICK_MS);
+
+    if (w->m_count == 0) {
+        uv_timer_stop(&w->m_uv_timer);
+        w->m_running = false;
+    }
+}
+
+/* Std.Internal.UV.TimerWheel.sleep (timeout : UInt64) : IO (IO.Promise Unit) */
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_timer_wheel_sleep(uint64_t timeout, obj_arg /* w */) {
+    timer_wheel * w = &g_timer_wheel;
+
+    event_loop_lock(&global_ev);
+
+    if (!w->m_initialized) {
+        int result = uv_timer_init(global_ev.loop, &w->m_uv_timer);
+        if (result != 0) {
+            event_loop_unlock(&global_ev);
+            return lean_io_result_mk_error(lean_decode_uv_error(result, NULL));
+        }
+        w->m_initialized = true;
+    }
+
+    uint64_t now = timer_wheel_now();
+    if (w->m_count == 0) {
+        w->m_current = now / LEAN_TIMER_WHEEL_TICK_MS;
+    }
+
+    // Round up so that at least `timeout` milliseconds pass before the promise is resolved.
+    uint64_t expiry = (now + timeout + LEAN_TIMER_WHEEL_TICK_MS - 1) / LEAN_TIMER_WHEEL_TICK_MS;
+    if (expiry <= w->m_current) {
+        expiry = w->m_current + 1;
+    }
+
+    // Sleeps that expire at the same tick are usually inserted right after each other, so checking
+    // the head of the slot is enough to share most promises.
+    timer_wheel_entry ** slot = timer_wheel_slot(w, expiry);
+    if (*slot != NULL && (*slot)->m_expiry == expiry) {
+        lean_object * promise = (*slot)->m_promise;
+        lean_inc(promise);
+        event_loop_unlock(&global_ev);
+        return lean_io_result_mk_ok(promise);
+    }
+
+    if (!w->m_running) {
+        int result = uv_timer_start(&w->m_uv_timer, handle_timer_wheel_event, LEAN_TIMER_WHEEL_TICK_MS, LEAN_TIMER_WHEEL_TICK_MS);
+        if (result != 0) {
+            event_loop_unlock(&global_ev);
+            return lean_io_result_mk_error(lean_decode_uv_error(result, NULL));
+        }
+        w->m_running = true;
+    }
+
+    lean_object * promise = create_promise();
+
+    timer_wheel_entry * entry = (timer_wheel_entry*)malloc(sizeof(timer_wheel_entry));
+    entry->m_expiry = expiry;
+    entry->m_promise = promise;
+    entry->m_next = *slot;
+    *slot = entry;
+    w->m_count++;
+
+    lean_inc(promise);
+    event_loop_unlock(&global_ev);
+    return lean_io_result_mk_ok(promise);
+}
+
+/* Std.Internal.UV.TimerWheel.pending : IO UInt64 */
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_timer_wheel_pending(obj_arg /* w */) {
+    event_loop_lock(&global_ev);
+    uint64_t count = g_timer_wheel.m_count;
+    event_loop_unlock(&global_ev);
+    return lean_io_result_mk_ok(lean_box_uint64(count));
+}
+
+#else
+
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_timer_wheel_sleep(uint64_t timeout, obj_arg /* w */) {
+    lean_always_assert(
+        false && ("Please build a version of Lean4 with libuv to invoke this.")
+    );
+}
+
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_timer_wheel_pending(obj_arg /* w */) {
+    lean_always_assert(
+        false && ("Please build a version of Lean4 with libuv to invoke this.")
+    );
+}
+
+#endif
+}
@@ -0,0 +1,50 @@
+/*
+Copyright (c) 2025 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+*/
+#pragma once
+#include <lean/lean.h>
+#include "runtime/uv/event_loop.h"
+
+namespace lean {
+
+#ifndef LEAN_EMSCRIPTEN
+using namespace std;
+#include <uv.h>
+
+// Granularity of the timer wheel in milliseconds. Deadlines are rounded up to a multiple of it.
+#define LEAN_TIMER_WHEEL_TICK_MS 10
+// The wheel has `LEAN_TIMER_WHEEL_LEVELS` levels of `1 << LEAN_TIMER_WHEEL_SLOT_BITS` slots each.
+// Level `l` covers deadlines up to `LEAN_TIMER_WHEEL_SLOTS^(l+1)` ticks in the future; deadlines
+// that are further away are parked in the last level and cascaded down again later.
+#define LEAN_TIMER_WHEEL_SLOT_BITS 6
+#define LEAN_TIMER_WHEEL_SLOTS (1 << LEAN_TIMER_WHEEL_SLOT_BITS)
+#define LEAN_TIMER_WHEEL_LEVELS 4
+
+// A deadline in the timer wheel. All sleeps that expire at the same tick share one entry and
+// hence one promise.
+typedef struct timer_wheel_entry {
+    uint64_t                   m_expiry;  // Tick at which `m_promise` is resolved.
+    lean_object *              m_promise; // The promise resolved at `m_expiry`.
+    struct timer_wheel_entry * m_next;    // Next entry in the same slot.
+} timer_wheel_entry;
+
+// A hierarchical timer wheel driven by a single libuv timer on `global_ev`. It is meant for huge
+// numbers of coarse sleeps and timeouts that would otherwise each need their own `uv_timer_t`.
+typedef struct {
+    uv_timer_t          m_uv_timer;    // LibUV timer that ticks while the wheel is non empty.
+    bool                m_initialized; // Whether `m_uv_timer` was initialized.
+    bool                m_running;     // Whether `m_uv_timer` is started.
+    uint64_t            m_current;     // The last tick that was processed.
+    size_t              m_count;       // Number of entries in the wheel.
+    timer_wheel_entry * m_slots[LEAN_TIMER_WHEEL_LEVELS][LEAN_TIMER_WHEEL_SLOTS];
+} timer_wheel;
+
+#endif
+
+// =======================================
+// Timer wheel functions
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_timer_wheel_sleep(uint64_t timeout, obj_arg /* w */);
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_timer_wheel_pending(obj_arg /* w */);
+
+}
@@ -0,0 +1,308 @@
+/*
+Copyright (c) 2025 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+*/
+#include "runtime/uv/udp.h"
+
+namespace lean {
+#ifndef LEAN_EMSCRIPTEN
+
+using namespace std;
+
+// As for TCP sockets, all operations lock the event loop of the socket and pending operations own
+// a reference to the socket.
+
+// The finalizer of the `Socket`. A pending receive keeps the socket alive, so there is none left here.
+void lean_uv_udp_socket_finalizer(void* ptr) {
+    lean_uv_udp_socket_object * udp_socket = (lean_uv_udp_socket_object*) ptr;
+    lean_assert(udp_socket->m_promise_read == NULL);
+
+    if (udp_socket->m_byte_array != NULL) {
+        lean_dec(udp_socket->m_byte_array);
+    }
+
+    // As for TCP sockets, the handle is closed right away with the loop locked so that no callback
+    // accesses the freed socket, and the socket data is freed together with the handle.
+    event_loop_t * ev = udp_socket->m_ev;
+    event_loop_lock(ev);
+    udp_socket->m_uv_udp->data = udp_socket;
+    uv_close((uv_handle_t*)udp_socket->m_uv_udp, [](uv_handle_t* handle) {
+        free(handle->data);
+        free(handle);
+    });
+    event_loop_unlock(ev);
+}
+
+void initialize_libuv_udp_socket() {
+    g_uv_udp_socket_external_class = lean_register_external_class(lean_uv_udp_socket_finalizer, [](void* obj, lean_object* f) {
+        lean_uv_udp_socket_object * udp_socket = (lean_uv_udp_socket_object*)obj;
+        if (udp_socket->m_promise_read != NULL) {
+            lean_inc(f);
+            lean_apply_1(f, udp_socket->m_promise_read);
+        }
+    });
+}
+
+/* Std.Internal.UV.UDP.Socket.new : IO Socket */
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_udp_new(obj_arg /* w */) {
+    event_loop_t * ev = event_loop_pick();
+    uv_udp_t * uv_udp = (uv_udp_t*)malloc(sizeof(uv_udp_t));
+
+    event_loop_lock(ev);
+    int result = uv_udp_init(ev->loop, uv_udp);
+    event_loop_unlock(ev);
+
+    if (result != 0) {
+        free(uv_udp);
+        return lean_io_result_mk_error(lean_decode_uv_error(result, NULL));
+    }
+
+    lean_uv_udp_socket_object * udp_socket = (lean_uv_udp_socket_object*)malloc(sizeof(lean_uv_udp_socket_object));
+    udp_socket->m_uv_udp = uv_udp;
+    udp_socket->m_ev = ev;
+    udp_socket->m_promise_read = NULL;
+    udp_socket->m_byte_array = NULL;
+    udp_socket->m_read_size = 0;
+
+    lean_object * obj = lean_uv_udp_socket_new(udp_socket);
+    lean_mark_mt(obj);
+    uv_udp->data = obj;
+    return lean_io_result_mk_ok(obj);
+}
+
+/* Std.Internal.UV.UDP.Socket.bind (socket : @& Socket) (addr : @& SocketAddress) : IO Unit */
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_udp_bind(b_obj_arg socket, b_obj_arg addr, obj_arg /* w */) {
+    lean_uv_udp_socket_object * udp_socket = lean_to_uv_udp_socket(socket);
+    sockaddr_storage addr_ptr;
+    lean_socket_address_to_sockaddr_storage(addr, &addr_ptr);
+
+    event_loop_lock(udp_socket->m_ev);
+    int result = uv_udp_bind(udp_socket->m_uv_udp, (const sockaddr*)&addr_ptr, 0);
+    event_loop_unlock(udp_socket->m_ev);
+
+    if (result < 0) {
+        return lean_io_result_mk_error(lean_decode_uv_error(result, NULL));
+    }
+    return lean_io_result_mk_ok(lean_box(0));
+}
+
+/* Std.Internal.UV.UDP.Socket.connect (socket : @& Socket) (addr : @& SocketAddress) : IO Unit */
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_udp_connect(b_obj_arg socket, b_obj_arg addr, obj_arg /* w */) {
+    lean_uv_udp_socket_object * udp_socket = lean_to_uv_udp_socket(socket);
+    sockaddr_storage addr_ptr;
+    lean_socket_address_to_sockaddr_storage(addr, &addr_ptr);
+
+    event_loop_lock(udp_socket->m_ev);
+    int result = uv_udp_connect(udp_socket->m_uv_udp, (const sockaddr*)&addr_ptr);
+    event_loop_unlock(udp_socket->m_ev);
+
+    if (result < 0) {
+        return lean_io_result_mk_error(lean_decode_uv_error(result, NULL));
+    }
+    return lean_io_result_mk_ok(lean_box(0));
+}
+
+/* Std.Internal.UV.UDP.Socket.send (socket : @& Socket) (data : ByteArray) (addr : @& Option SocketAddress) : IO (IO.Promise (Except IO.Error Unit)) */
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_udp_send(b_obj_arg socket, obj_arg data, b_obj_arg opt_addr, obj_arg /* w */) {
+    lean_uv_udp_socket_object * udp_socket = lean_to_uv_udp_socket(socket);
+
+    sockaddr_storage addr_storage;
+    const sockaddr * addr_ptr = NULL;
+    if (!lean_is_scalar(opt_addr)) {
+        lean_socket_address_to_sockaddr_storage(lean_ctor_get(opt_addr, 0), &addr_storage);
+        addr_ptr = (const sockaddr*)&addr_storage;
+    }
+
+    // The datagram is sent directly from the `ByteArray`, which is released on the event loop thread.
+    lean_mark_mt(data);
+    lean_uv_udp_send_req * req = (lean_uv_udp_send_req*)malloc(sizeof(lean_uv_udp_send_req));
+    req->m_uv_send.data = req;
+    req->m_promise = create_promise();
+    // The reference returned to the caller, which is taken before the loop may free the request.
+    lean_object * promise = req->m_promise;
+    lean_inc(promise);
+    lean_inc(socket);
+    req->m_socket = socket;
+    req->m_data = data;
+    uv_buf_t buf = uv_buf_init((char*)lean_sarray_cptr(data), (unsigned int)lean_sarray_size(data));
+
+    event_loop_lock(udp_socket->m_ev);
+    int result = uv_udp_send(&req->m_uv_send, udp_socket->m_uv_udp, &buf, 1, addr_ptr, [](uv_udp_send_t* uv_send, int status) {
+        lean_uv_udp_send_req * req = (lean_uv_udp_send_req*)uv_send->data;
+        resolve_promise(req->m_promise, status < 0 ? mk_except_err(status) : mk_except_ok(lean_box(0)));
+        lean_dec(req->m_promise);
+        lean_dec(req->m_data);
+        lean_dec(req->m_socket);
+        free(req);
+    });
+    event_loop_unlock(udp_socket->m_ev);
+
+    if (result < 0) {
+        lean_dec(promise);
+        lean_dec(req->m_promise);
+        lean_dec(req->m_data);
+        lean_dec(req->m_socket);
+        free(req);
+        return lean_io_result_mk_error(lean_decode_uv_error(result, NULL));
+    }
+
+    return lean_io_result_mk_ok(promise);
+}
+
+/* Std.Internal.UV.UDP.Socket.recv (socket : @& Socket) (size : UInt64) : IO (IO.Promise (Except IO.Error (ByteArray × Option SocketAddress))) */
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_udp_recv(b_obj_arg socket, uint64_t size, obj_arg /* w */) {
+    lean_uv_udp_socket_object * udp_socket = lean_to_uv_udp_socket(socket);
+    if (size == 0) {
+        return lean_io_result_mk_error(lean_decode_uv_error(UV_EINVAL, NULL));
+    }
+
+    event_loop_lock(udp_socket->m_ev);
+
+    if (udp_socket->m_promise_read != NULL) {
+        event_loop_unlock(udp_socket->m_ev);
+        return lean_io_result_mk_error(lean_decode_uv_error(UV_EALREADY, NULL));
+    }
+
+    // The datagram is received directly into a `ByteArray` of the requested size.
+    auto alloc_cb = [](uv_handle_t* handle, size_t /* suggested_size */, uv_buf_t* buf) {
+        lean_uv_udp_socket_object * udp_socket = lean_to_uv_udp_socket((lean_object*)handle->data);
+        if (udp_socket->m_byte_array == NULL) {
+            udp_socket->m_byte_array = lean_alloc_sarray(1, 0, udp_socket->m_read_size);
+        }
+        buf->base = (char*)lean_sarray_cptr(udp_socket->m_byte_array);
+        buf->len = lean_sarray_capacity(udp_socket->m_byte_array);
+    };
+
+    auto recv_cb = [](uv_udp_t* handle, ssize_t nread, const uv_buf_t* /* buf */, const sockaddr* addr, unsigned /* flags */) {
+        if (nread == 0 && addr == NULL) {
+            // Nothing was received, keep the buffer for the next attempt.
+            return;
+        }
+        lean_object * obj = (lean_object*)handle->data;
+        lean_uv_udp_socket_object * udp_socket = lean_to_uv_udp_socket(obj);
+        uv_udp_recv_stop(handle);
+
+        lean_object * promise = udp_socket->m_promise_read;
+        udp_socket->m_promise_read = NULL;
+        lean_object * except;
+        if (nread >= 0) {
+            lean_object * byte_array = udp_socket->m_byte_array;
+            udp_socket->m_byte_array = NULL;
+            lean_sarray_set_size(byte_array, nread);
+            lean_object * pair = lean_alloc_ctor(0, 2, 0);
+            lean_ctor_set(pair, 0, byte_array);
+            lean_ctor_set(pair, 1, addr != NULL ? mk_option_some(lean_sockaddr_to_socket_address(addr)) : mk_option_none());
+            except = mk_except_ok(pair);
+        } else {
+            except = mk_except_err((int)nread);
+        }
+        resolve_promise(promise, except);
+        lean_dec(promise);
+
+        // The pending receive does not need to keep the socket alive anymore.
+        lean_dec(obj);
+    };
+
+    if (udp_socket->m_byte_array != NULL) {
+        // left over from a previous receive that failed
+        lean_dec(udp_socket->m_byte_array);
+        udp_socket->m_byte_array = NULL;
+    }
+    udp_socket->m_read_size = size;
+    lean_object * promise = create_promise();
+    udp_socket->m_promise_read = promise;
+    lean_inc(socket);
+
+    int result = uv_udp_recv_start(udp_socket->m_uv_udp, alloc_cb, recv_cb);
+
+    if (result < 0) {
+        udp_socket->m_promise_read = NULL;
+        event_loop_unlock(udp_socket->m_ev);
+        lean_dec(promise);
+        lean_dec(socket);
+        return lean_io_result_mk_error(lean_decode_uv_error(result, NULL));
+    }
+
+    lean_inc(promise);
+    event_loop_unlock(udp_socket->m_ev);
+    return lean_io_result_mk_ok(promise);
+}
+
+/* Std.Internal.UV.UDP.Socket.getSockName (socket : @& Socket) : IO SocketAddress */
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_udp_getsockname(b_obj_arg socket, obj_arg /* w */) {
+    lean_uv_udp_socket_object * udp_socket = lean_to_uv_udp_socket(socket);
+    sockaddr_storage addr_storage;
+    int len = sizeof(addr_storage);
+
+    event_loop_lock(udp_socket->m_ev);
+    int result = uv_udp_getsockname(udp_socket->m_uv_udp, (sockaddr*)&addr_storage, &len);
+    event_loop_unlock(udp_socket->m_ev);
+
+    if (result < 0) {
+        return lean_io_result_mk_error(lean_decode_uv_error(result, NULL));
+    }
+    return lean_io_result_mk_ok(lean_sockaddr_to_socket_address((const sockaddr*)&addr_storage));
+}
+
+/* Std.Internal.UV.UDP.Socket.getPeerName (socket : @& Socket) : IO SocketAddress */
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_udp_getpeername(b_obj_arg socket, obj_arg /* w */) {
+    lean_uv_udp_socket_object * udp_socket = lean_to_uv_udp_socket(socket);
+    sockaddr_storage addr_storage;
+    int len = sizeof(addr_storage);
+
+    event_loop_lock(udp_socket->m_ev);
+    int result = uv_udp_getpeername(udp_socket->m_uv_udp, (sockaddr*)&addr_storage, &len);
+    event_loop_unlock(udp_socket->m_ev);
+
+    if (result < 0) {
+        return lean_io_result_mk_error(lean_decode_uv_error(result, NULL));
+    }
+    return lean_io_result_mk_ok(lean_sockaddr_to_socket_address((const sockaddr*)&addr_storage));
+}
+
+#else
+
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_udp_new(obj_arg /* w */) {
+    lean_always_assert(
+        false && ("Please build a version of Lean4 with libuv to invoke this.")
+    );
+}
+
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_udp_bind(b_obj_arg socket, b_obj_arg addr, obj_arg /* w */) {
+    lean_always_assert(
+        false && ("Please build a version of Lean4 with libuv to invoke this.")
+    );
+}
+
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_udp_connect(b_obj_arg socket, b_obj_arg addr, obj_arg /* w */) {
+    lean_always_assert(
+        false && ("Please build a version of Lean4 with libuv to invoke this.")
+    );
+}
+
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_udp_send(b_obj_arg socket, obj_arg data, b_obj_arg addr, obj_arg /* w */) {
+    lean_always_assert(
+        false && ("Please build a version of Lean4 with libuv to invoke this.")
+    );
+}
+
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_udp_recv(b_obj_arg socket, uint64_t size, obj_arg /* w */) {
+    lean_always_assert(
+        false && ("Please build a version of Lean4 with libuv to invoke this.")
+    );
+}
+
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_udp_getsockname(b_obj_arg socket, obj_arg /* w */) {
+    lean_always_assert(
+        false && ("Please build a version of Lean4 with libuv to invoke this.")
+    );
+}
+
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_udp_getpeername(b_obj_arg socket, obj_arg /* w */) {
+    lean_always_assert(
+        false && ("Please build a version of Lean4 with libuv to invoke this.")
+    );
+}
+
+#endif
+}
@@ -0,0 +1,54 @@
+/*
+Copyright (c) 2025 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+*/
+#pragma once
+#include <lean/lean.h>
+#include "runtime/uv/event_loop.h"
+#include "runtime/uv/net_addr.h"
+
+namespace lean {
+
+static lean_external_class * g_uv_udp_socket_external_class = NULL;
+void initialize_libuv_udp_socket();
+
+#ifndef LEAN_EMSCRIPTEN
+using namespace std;
+#include <uv.h>
+
+// Structure for managing a single UDP socket object, including the promise of its pending receive.
+// All fields are only accessed with the event loop `m_ev` locked.
+typedef struct {
+    uv_udp_t *      m_uv_udp;        // LibUV UDP handle, whose `data` is the `Socket` object.
+    event_loop_t *  m_ev;            // The event loop the handle belongs to.
+    lean_object *   m_promise_read;  // The promise of the pending `recv`, or `NULL`.
+    lean_object *   m_byte_array;    // The buffer the pending `recv` reads into, or `NULL`.
+    uint64_t        m_read_size;     // The maximal number of bytes of the pending `recv`.
+} lean_uv_udp_socket_object;
+
+// Structure for a send request on a UDP socket.
+typedef struct {
+    uv_udp_send_t   m_uv_send;    // LibUV send request.
+    lean_object *   m_promise;    // The promise resolved once the datagram has been sent.
+    lean_object *   m_socket;     // The socket, kept alive until then.
+    lean_object *   m_data;       // The `ByteArray` being sent.
+} lean_uv_udp_send_req;
+
+// =======================================
+// UDP socket object manipulation functions.
+static inline lean_object* lean_uv_udp_socket_new(lean_uv_udp_socket_object * s) { return lean_alloc_external(g_uv_udp_socket_external_class, s); }
+static inline lean_uv_udp_socket_object* lean_to_uv_udp_socket(lean_object * o) { return (lean_uv_udp_socket_object*)(lean_get_external_data(o)); }
+
+#endif
+
+// =======================================
+// UDP socket manipulation functions
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_udp_new(obj_arg /* w */);
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_udp_bind(b_obj_arg socket, b_obj_arg addr, obj_arg /* w */);
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_udp_connect(b_obj_arg socket, b_obj_arg addr, obj_arg /* w */);
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_udp_send(b_obj_arg socket, obj_arg data, b_obj_arg addr, obj_arg /* w */);
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_udp_recv(b_obj_arg socket, uint64_t size, obj_arg /* w */);
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_udp_getsockname(b_obj_arg socket, obj_arg /* w */);
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_udp_getpeername(b_obj_arg socket, obj_arg /* w */);
+
+}
@@ -0,0 +1,185 @@
+/*
+Copyright (c) 2025 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+*/
+#include "runtime/uv/writer.h"
+#include "runtime/io.h"
+#ifdef LEAN_WINDOWS
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace lean {
+#ifndef LEAN_EMSCRIPTEN
+
+using namespace std;
+
+// The finalizer of the `Writer`. Pending writes keep the writer alive, so there are none left here.
+// Closing the stream handle also closes the file descriptor, which is the writer's own duplicate.
+void lean_uv_writer_finalizer(void* ptr) {
+    lean_uv_writer_object * writer = (lean_uv_writer_object*) ptr;
+
+    event_loop_submit(writer->m_ev, [](void* stream) {
+        uv_close((uv_handle_t*)stream, [](uv_handle_t* handle) {
+            free(handle);
+        });
+    }, writer->m_uv_stream);
+
+    free(writer);
+}
+
+void initialize_libuv_writer() {
+    g_uv_writer_external_class = lean_register_external_class(lean_uv_writer_finalizer, [](void* obj, lean_object* f) {});
+}
+
+void handle_write_event(uv_write_t* uv_write, int status) {
+    lean_uv_write_req * req = (lean_uv_write_req*)uv_write->data;
+
+    resolve_promise(req->m_promise, status < 0 ? mk_except_err(status) : mk_except_ok(lean_box(0)));
+
+    lean_dec(req->m_promise);
+    lean_dec(req->m_data);
+    lean_dec(req->m_writer);
+    free(req);
+}
+
+static void close_fd(uv_file file) {
+#ifdef LEAN_WINDOWS
+    _close(file);
+#else
+    close(file);
+#endif
+}
+
+/* Std.Internal.UV.Writer.mk (fd : UInt32) : IO Writer */
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_writer_mk(uint32_t fd, obj_arg /* w */) {
+    // The stream handle closes its file descriptor, so it is given a duplicate of `fd`.
+#ifdef LEAN_WINDOWS
+    uv_file file = _dup((int)fd);
+#else
+    uv_file file = dup((int)fd);
+#endif
+    if (file < 0)
+        return lean_io_result_mk_error(decode_io_error(errno, nullptr));
+    uv_handle_type type = uv_guess_handle(file);
+    uv_stream_t * stream;
+    int result;
+
+    event_loop_t * ev = event_loop_pick();
+    event_loop_lock(ev);
+    if (type == UV_TTY) {
+        uv_tty_t * tty = (uv_tty_t*)malloc(sizeof(uv_tty_t));
+        stream = (uv_stream_t*)tty;
+        result = uv_tty_init(ev->loop, tty, file, 0);
+    } else if (type == UV_NAMED_PIPE) {
+        uv_pipe_t * pipe = (uv_pipe_t*)malloc(sizeof(uv_pipe_t));
+        stream = (uv_stream_t*)pipe;
+        result = uv_pipe_init(ev->loop, pipe, 0);
+        if (result == 0) {
+            result = uv_pipe_open(pipe, file);
+            if (result != 0) {
+                uv_close((uv_handle_t*)pipe, [](uv_handle_t* handle) { free(handle); });
+                event_loop_unlock(ev);
+                close_fd(file);
+                return lean_io_result_mk_error(lean_decode_uv_error(result, NULL));
+            }
+        }
+    } else {
+        event_loop_unlock(ev);
+        close_fd(file);
+        return lean_io_result_mk_error(lean_decode_uv_error(UV_EINVAL, NULL));
+    }
+    event_loop_unlock(ev);
+
+    if (result != 0) {
+        free(stream);
+        close_fd(file);
+        return lean_io_result_mk_error(lean_decode_uv_error(result, NULL));
+    }
+
+    lean_uv_writer_object * writer = (lean_uv_writer_object*)malloc(sizeof(lean_uv_writer_object));
+    writer->m_uv_stream = stream;
+    writer->m_ev = ev;
+    atomic_init(&writer->m_submitted, (uint64_t)0);
+
+    lean_object * obj = lean_uv_writer_new(writer);
+    lean_mark_mt(obj);
+    return lean_io_result_mk_ok(obj);
+}
+
+/* Std.Internal.UV.Writer.write (writer : @& Writer) (data : ByteArray) : IO (IO.Promise (Except IO.Error Unit)) */
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_writer_write(b_obj_arg obj, obj_arg data, obj_arg /* w */) {
+    lean_object * promise = create_promise();
+
+    // The data is written directly from the `ByteArray`, which is therefore made thread-safe to
+    // release from the event loop.
+    lean_mark_mt(data);
+
+    lean_uv_write_req * req = (lean_uv_write_req*)malloc(sizeof(lean_uv_write_req));
+    req->m_uv_write.data = req;
+    req->m_promise = promise;
+    req->m_data = data;
+    // The event loop must keep the writer alive until the write has completed.
+    lean_inc(obj);
+    req->m_writer = obj;
+
+    lean_inc(promise);
+
+    // Counted by `queueSize` until the write is handed to libuv, which then accounts for it.
+    lean_uv_writer_object * writer = lean_to_uv_writer(obj);
+    atomic_fetch_add_explicit(&writer->m_submitted, (uint64_t)lean_sarray_size(data), memory_order_relaxed);
+
+    // The write is started on the event loop thread; errors on submission resolve the promise.
+    event_loop_submit(writer->m_ev, [](void* ptr) {
+        lean_uv_write_req * req = (lean_uv_write_req*)ptr;
+        lean_uv_writer_object * writer = lean_to_uv_writer(req->m_writer);
+        uv_stream_t * stream = writer->m_uv_stream;
+        size_t size = lean_sarray_size(req->m_data);
+        atomic_fetch_sub_explicit(&writer->m_submitted, (uint64_t)size, memory_order_relaxed);
+        uv_buf_t buf = uv_buf_init((char*)lean_sarray_cptr(req->m_data), (unsigned int)size);
+        int result = uv_write(&req->m_uv_write, stream, &buf, 1, handle_write_event);
+        if (result != 0) {
+            handle_write_event(&req->m_uv_write, result);
+        }
+    }, req);
+
+    return lean_io_result_mk_ok(promise);
+}
+
+/* Std.Internal.UV.Writer.queueSize (writer : @& Writer) : IO UInt64 */
+// Includes the writes that have been submitted but not started on the event loop yet.
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_writer_queue_size(b_obj_arg obj, obj_arg /* w */) {
+    lean_uv_writer_object * writer = lean_to_uv_writer(obj);
+
+    // Submitted writes are started while the loop is locked, so they are counted exactly once.
+    event_loop_lock(writer->m_ev);
+    uint64_t size = uv_stream_get_write_queue_size(writer->m_uv_stream);
+    size += atomic_load_explicit(&writer->m_submitted, memory_order_relaxed);
+    event_loop_unlock(writer->m_ev);
+
+    return lean_io_result_mk_ok(lean_box_uint64(size));
+}
+
+#else
+
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_writer_mk(uint32_t fd, obj_arg /* w */) {
+    lean_always_assert(
+        false && ("Please build a version of Lean4 with libuv to invoke this.")
+    );
+}
+
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_writer_write(b_obj_arg writer, obj_arg data, obj_arg /* w */) {
+    lean_always_assert(
+        false && ("Please build a version of Lean4 with libuv to invoke this.")
+    );
+}
+
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_writer_queue_size(b_obj_arg writer, obj_arg /* w */) {
+    lean_always_assert(
+        false && ("Please build a version of Lean4 with libuv to invoke this.")
+    );
+}
+
+#endif
+}
@@ -0,0 +1,46 @@
+/*
+Copyright (c) 2025 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+*/
+#pragma once
+#include <lean/lean.h>
+#include "runtime/uv/event_loop.h"
+
+namespace lean {
+
+static lean_external_class * g_uv_writer_external_class = NULL;
+void initialize_libuv_writer();
+
+#ifndef LEAN_EMSCRIPTEN
+using namespace std;
+#include <uv.h>
+
+// Structure for an asynchronous writer on a pipe or terminal file descriptor.
+typedef struct {
+    uv_stream_t *   m_uv_stream;   // LibUV stream handle, either a `uv_pipe_t` or a `uv_tty_t`.
+    event_loop_t *  m_ev;          // The event loop the stream handle belongs to.
+    _Atomic(uint64_t) m_submitted; // Bytes passed to `write` whose write has not been started on the loop yet.
+} lean_uv_writer_object;
+
+// Structure for a single write request that has been queued on a writer.
+typedef struct {
+    uv_write_t      m_uv_write;    // LibUV write request.
+    lean_object *   m_promise;     // The promise resolved once the data has been written.
+    lean_object *   m_data;        // The `ByteArray` being written, kept alive until then.
+    lean_object *   m_writer;      // The writer, kept alive until then.
+} lean_uv_write_req;
+
+// =======================================
+// Writer object manipulation functions.
+static inline lean_object* lean_uv_writer_new(lean_uv_writer_object * s) { return lean_alloc_external(g_uv_writer_external_class, s); }
+static inline lean_uv_writer_object* lean_to_uv_writer(lean_object * o) { return (lean_uv_writer_object*)(lean_get_external_data(o)); }
+
+#endif
+
+// =======================================
+// Writer manipulation functions
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_writer_mk(uint32_t fd, obj_arg /* w */);
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_writer_write(b_obj_arg writer, obj_arg data, obj_arg /* w */);
+extern "C" LEAN_EXPORT lean_obj_res lean_uv_writer_queue_size(b_obj_arg writer, obj_arg /* w */);
+
+}
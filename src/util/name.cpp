@@ -189,6 +189,8 @@ bool operator==(name const & a, char const * b) {
 }
 
 int name::cmp_core(object * i1, object * i2) {
+    if (i1 == i2)
+        return 0;
     buffer<object*> limbs1, limbs2;
     copy_limbs(i1, limbs1);
     copy_limbs(i2, limbs2);
@@ -197,6 +199,8 @@ int name::cmp_core(object * i1, object * i2) {
     for (; it1 != limbs1.end() && it2 != limbs2.end(); ++it1, ++it2) {
         i1 = *it1;
         i2 = *it2;
+        if (i1 == i2)
+            continue; // shared prefix
         name_kind k1 = static_cast<name_kind>(cnstr_tag(i1));
         name_kind k2 = static_cast<name_kind>(cnstr_tag(i2));
         if (k1 != k2)
@@ -0,0 +1,86 @@
+/*
+Copyright (c) 2025 Lean FRO, LLC. All rights reserved.
+Released under Apache 2.0 license as described in the file LICENSE.
+*/
+#pragma once
+#include <deque>
+#include <utility>
+#include <vector>
+#include "util/name.h"
+namespace lean {
+/**
+   \brief Insert-only hash map from names to `T` for hot lookup tables such as the caches of the
+   IR interpreter.
+
+   Unlike `name_hash_map`, lookups probe a flat open-addressing index that stores the hash of each
+   key, which is cached in the `Name` object anyway, so that mismatches are mostly rejected without
+   touching the keys. Entries are stored in a `std::deque` in insertion order and are never moved,
+   so references to them stay valid across insertions. */
+template<typename T> class name_flat_map {
+    struct slot {
+        unsigned m_hash;
+        // index into `m_entries` plus one, `0` if the slot is empty
+        unsigned m_idx;
+    };
+    std::deque<std::pair<name, T>> m_entries;
+    std::vector<slot>              m_slots;
+
+    slot * find_slot(name const & k, unsigned h) {
+        size_t mask = m_slots.size() - 1;
+        for (size_t i = h & mask;; i = (i + 1) & mask) {
+            slot & s = m_slots[i];
+            if (s.m_idx == 0 || (s.m_hash == h && m_entries[s.m_idx - 1].first == k))
+                return &s;
+        }
+    }
+
+    void grow() {
+        std::vector<slot> old(m_slots.empty() ? 16 : 2 * m_slots.size(), slot { 0, 0 });
+        std::swap(old, m_slots);
+        size_t mask = m_slots.size() - 1;
+        for (slot const & s : old) {
+            if (s.m_idx == 0)
+                continue;
+            size_t i = s.m_hash & mask;
+            while (m_slots[i].m_idx != 0)
+                i = (i + 1) & mask;
+            m_slots[i] = s;
+        }
+    }
+public:
+    typedef typename std::deque<std::pair<name, T>>::const_iterator const_iterator;
+
+    T * find(name const & k) {
+        if (m_entries.empty())
+            return nullptr;
+        slot * s = find_slot(k, k.hash());
+        return s->m_idx == 0 ? nullptr : &m_entries[s->m_idx - 1].second;
+    }
+
+    T const * find(name const & k) const { return const_cast<name_flat_map *>(this)->find(k); }
+
+    /** \brief Insert `v` unless `k` is already present, and return the entry for `k`. */
+    T & insert(name const & k, T const & v) {
+        // keep the load factor at most 1/2
+        if (2 * (m_entries.size() + 1) > m_slots.size())
+            grow();
+        unsigned h = k.hash();
+        slot * s = find_slot(k, h);
+        if (s->m_idx == 0) {
+            m_entries.emplace_back(k, v);
+            *s = slot { h, static_cast<unsigned>(m_entries.size()) };
+        }
+        return m_entries[s->m_idx - 1].second;
+    }
+
+    void clear() {
+        m_entries.clear();
+        m_slots.clear();
+    }
+
+    size_t size() const { return m_entries.size(); }
+    bool empty() const { return m_entries.empty(); }
+    const_iterator begin() const { return m_entries.begin(); }
+    const_iterator end() const { return m_entries.end(); }
+};
+}
@@ -69,6 +69,7 @@ public:
     friend options join(options const & opts1, options const & opts2);
 
     object * to_obj_arg() const { return m_value.to_obj_arg(); }
+    object * raw() const { return m_value.raw(); }
 };
 
 LEAN_EXPORT bool get_verbose(options const & opts);
@@ -13,6 +13,7 @@ Author: Leonardo de Moura
 #include <utility>
 #include <vector>
 #include <set>
+#include <algorithm>
 #include "runtime/stackinfo.h"
 #include "runtime/interrupt.h"
 #include "runtime/memory.h"
@@ -22,6 +23,8 @@ Author: Leonardo de Moura
 #include "runtime/array_ref.h"
 #include "runtime/object_ref.h"
 #include "runtime/utf8.h"
+#include "runtime/task_trace.h"
+#include "runtime/sample_profile.h"
 #include "util/timer.h"
 #include "util/macros.h"
 #include "util/io.h"
@@ -229,7 +232,12 @@ static void display_help(std::ostream & out) {
     std::cout << "      --print-prefix     print the installation prefix for Lean and exit\n";
     std::cout << "      --print-libdir     print the installation directory for Lean's built-in libraries and exit\n";
     std::cout << "      --profile          display elaboration/type checking time for each definition/theorem\n";
+    std::cout << "      --profile-json=file like --profile, and write a Chrome/Perfetto trace of the profiled spans to file on exit\n";
+    std::cout << "      --trace-tasks=file write a Chrome/Perfetto trace of the task scheduler to file on exit\n";
+    std::cout << "      --sample-profile=file sample native stacks and write a pprof CPU profile to file on exit\n";
     std::cout << "      --stats            display environment statistics\n";
+    std::cout << "      --save-env-snapshot=file store the imported modules in file, to be loaded instead of their .olean\n";
+    std::cout << "                         files by processes run with LEAN_IMPORT_SNAPSHOT=file\n";
     DEBUG_CODE(
     std::cout << "      --debug=tag        enable assertions with the given tag\n";
         )
@@ -254,7 +262,11 @@ static struct option g_long_options[] = {
     {"memory",       required_argument, 0, 'M'},
     {"trust",        required_argument, 0, 't'},
     {"profile",      no_argument,       0, 'P'},
+    {"profile-json", required_argument, 0, 'Y'},
+    {"trace-tasks",  required_argument, 0, 'K'},
+    {"sample-profile", required_argument, 0, 'Z'},
     {"stats",        no_argument,       0, 'a'},
+    {"save-env-snapshot", required_argument, 0, 'N'},
     {"quiet",        no_argument,       0, 'q'},
     {"deps",         no_argument,       0, 'd'},
     {"src-deps",     no_argument,       &only_src_deps, 1},
@@ -484,6 +496,7 @@ extern "C" LEAN_EXPORT int lean_main(int argc, char ** argv) {
     bool run = false;
     optional<std::string> olean_fn;
     optional<std::string> ilean_fn;
+    optional<std::string> env_snapshot_fn;
     bool use_stdin = false;
     unsigned trust_lvl = LEAN_BELIEVER_TRUST_LEVEL + 1;
     bool only_deps = false;
@@ -493,7 +506,12 @@ extern "C" LEAN_EXPORT int lean_main(int argc, char ** argv) {
     int run_server = 0;
     unsigned num_threads    = 0;
 #if defined(LEAN_MULTI_THREAD)
-    num_threads = hardware_concurrency();
+    num_threads = default_num_threads();
+#if defined(LEAN_WASM_PTHREAD_POOL_SIZE)
+    // threads beyond the preallocated workers reserved for the task manager would not start in time,
+    // see `src/CMakeLists.txt`
+    num_threads = std::min(num_threads, static_cast<unsigned>(LEAN_WASM_PTHREAD_POOL_SIZE));
+#endif
 #endif
 
     try {
@@ -619,6 +637,27 @@ extern "C" LEAN_EXPORT int lean_main(int argc, char ** argv) {
             case 'P':
                 opts = opts.update("profiler", true);
                 break;
+            case 'Y':
+                check_optarg("-profile-json");
+                opts = opts.update("profiler", true);
+                lean::start_profile_trace(optarg);
+                break;
+            case 'N':
+                check_optarg("-save-env-snapshot");
+                env_snapshot_fn = optarg;
+                break;
+            case 'K':
+                check_optarg("-trace-tasks");
+                lean::start_task_trace(optarg);
+                break;
+            case 'Z':
+                check_optarg("-sample-profile");
+                if (!lean::sample_profile_supported()) {
+                    std::cerr << "--sample-profile is not supported on this platform" << std::endl;
+                    return 1;
+                }
+                lean::start_sample_profile(optarg);
+                break;
 #if defined(LEAN_DEBUG)
             case 'B':
                 check_optarg("B");
@@ -760,14 +799,25 @@ extern "C" LEAN_EXPORT int lean_main(int argc, char ** argv) {
             env.display_stats();
         }
 
+        if (env_snapshot_fn && ok) {
+            save_import_snapshot(env, *env_snapshot_fn);
+        }
+
         if (run && ok) {
             uint32 ret = ir::run_main(env, opts, argc - optind, argv + optind);
             // environment_free_regions(std::move(env));
             return ret;
         }
+        // When also generating code, we serialize the .olean file concurrently instead of
+        // extending the critical path of the build by both.
+        object * olean_task = nullptr;
         if (olean_fn && ok) {
-            time_task t(".olean serialization", opts);
-            write_module(env, *olean_fn);
+            if (c_output || llvm_output) {
+                olean_task = write_module_async(env, *olean_fn);
+            } else {
+                time_task t(".olean serialization", opts);
+                write_module(env, *olean_fn);
+            }
         }
 
         if (c_output && ok) {
@@ -777,7 +827,7 @@ extern "C" LEAN_EXPORT int lean_main(int argc, char ** argv) {
                 return 1;
             }
             time_task _("C code generation", opts);
-            out << lean::ir::emit_c(env, *main_module_name).data();
+            out << lean::ir::emit_c(env, *main_module_name, opts).data();
             out.close();
         }
 
@@ -791,6 +841,12 @@ extern "C" LEAN_EXPORT int lean_main(int argc, char ** argv) {
                         lean_io_mk_world()));
         }
 
+        if (olean_task) {
+            // only measures the time spent waiting after code generation
+            time_task t(".olean serialization", opts);
+            wait_for_module(olean_task);
+        }
+
         display_cumulative_profiling_times(std::cerr);
 
 #ifdef LEAN_SMALL_ALLOCATOR
@@ -0,0 +1,282 @@
+/*
+Micro-benchmarks of the C runtime, compiled with `leanc` like the other benchmarks.
+
+Each benchmark runs its body in batches of increasing size until a batch takes at least
+`MIN_BATCH_TIME` seconds, and reports the time per iteration of that batch in nanoseconds, one
+`name: value` line per benchmark, for `speedcenter.exec.velcom.yaml`. Pass benchmark names as
+arguments to run only a subset.
+*/
+#define _POSIX_C_SOURCE 199309L
+#include <lean/lean.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#define MIN_BATCH_TIME 0.2
+
+/* Not in `lean.h`, declared by the `main` functions generated for Lean programs as well. */
+void lean_initialize_runtime_module(void);
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Keep results alive so that the compiler cannot remove the benchmarked code. */
+static volatile uint64_t g_sink;
+
+typedef void (*bench_fn)(size_t n);
+
+static void bench_alloc_small(size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        lean_object * o = lean_alloc_small_object(sizeof(lean_ctor_object) + 2 * sizeof(void *));
+        g_sink += (uintptr_t)o;
+        lean_free_small_object(o);
+    }
+}
+
+static void bench_rc(lean_object * o, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        lean_inc(o);
+        lean_dec(o);
+    }
+}
+
+static void bench_rc_st(size_t n) {
+    lean_object * o = lean_alloc_ctor(0, 1, 0);
+    lean_ctor_set(o, 0, lean_box(0));
+    bench_rc(o, n);
+    lean_dec(o);
+}
+
+static void bench_rc_mt(size_t n) {
+    lean_object * o = lean_alloc_ctor(0, 1, 0);
+    lean_ctor_set(o, 0, lean_box(0));
+    lean_mark_mt(o);
+    bench_rc(o, n);
+    lean_dec(o);
+}
+
+/* Containers are rebuilt every `CHUNK` iterations so that memory usage does not depend on `n`. */
+#define CHUNK 1024
+
+static void bench_array_push(size_t n) {
+    lean_object * a = lean_mk_empty_array();
+    for (size_t i = 0; i < n; i++) {
+        if (i % CHUNK == 0) {
+            lean_dec(a);
+            a = lean_mk_empty_array();
+        }
+        a = lean_array_push(a, lean_box(i));
+    }
+    g_sink += lean_array_size(a);
+    lean_dec(a);
+}
+
+static void bench_string_append(size_t n) {
+    lean_object * s = lean_mk_string("");
+    lean_object * t = lean_mk_string("lean");
+    for (size_t i = 0; i < n; i++) {
+        if (i % CHUNK == 0) {
+            lean_dec(s);
+            s = lean_mk_string("");
+        }
+        s = lean_string_append(s, t);
+    }
+    g_sink += lean_string_size(s);
+    lean_dec(s);
+    lean_dec(t);
+}
+
+static void bench_string_hash(size_t n) {
+    lean_object * s = lean_mk_string("Lean.Elab.Command.elabCommandTopLevel");
+    for (size_t i = 0; i < n; i++)
+        g_sink += lean_string_hash(s);
+    lean_dec(s);
+}
+
+static void bench_nat_big_mul(size_t n) {
+    lean_object * a = lean_cstr_to_nat("123456789012345678901234567890123456789");
+    lean_object * b = lean_cstr_to_nat("987654321098765432109876543210987654321");
+    for (size_t i = 0; i < n; i++) {
+        lean_object * r = lean_nat_mul(a, b);
+        g_sink += (uintptr_t)r;
+        lean_dec(r);
+    }
+    lean_dec(a);
+    lean_dec(b);
+}
+
+static void bench_nat_big_add(size_t n) {
+    lean_object * a = lean_cstr_to_nat("123456789012345678901234567890123456789");
+    lean_object * b = lean_cstr_to_nat("987654321098765432109876543210987654321");
+    for (size_t i = 0; i < n; i++) {
+        lean_object * r = lean_nat_add(a, b);
+        g_sink += (uintptr_t)r;
+        lean_dec(r);
+    }
+    lean_dec(a);
+    lean_dec(b);
+}
+
+/* Boxing as done for scalars passed to polymorphic code, see `INLINE_BOXED_SCALARS` */
+static void bench_box_uint64(size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        lean_object * o = lean_box_uint64(i);
+        g_sink += lean_unbox_uint64(o);
+        lean_dec(o);
+    }
+}
+
+static void bench_box_float(size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        lean_object * o = lean_box_float((double)i * 0.5);
+        g_sink += (uint64_t)lean_unbox_float(o);
+        lean_dec(o);
+    }
+}
+
+static lean_object * add3(lean_object * a, lean_object * b, lean_object * c) {
+    return lean_box(lean_unbox(a) + lean_unbox(b) + lean_unbox(c));
+}
+
+static void bench_apply_partial(size_t n) {
+    /* A closure with one fixed argument applied to the remaining two */
+    lean_object * f = lean_alloc_closure((void *)add3, 3, 1);
+    lean_closure_set(f, 0, lean_box(1));
+    for (size_t i = 0; i < n; i++) {
+        lean_inc(f);
+        g_sink += lean_unbox(lean_apply_2(f, lean_box(i), lean_box(2)));
+    }
+    lean_dec(f);
+}
+
+static void bench_apply_under(size_t n) {
+    /* Fewer arguments than the arity, so a new partial application is created */
+    lean_object * f = lean_alloc_closure((void *)add3, 3, 0);
+    for (size_t i = 0; i < n; i++) {
+        lean_inc(f);
+        lean_object * g = lean_apply_2(f, lean_box(i), lean_box(1));
+        g_sink += lean_unbox(lean_apply_1(g, lean_box(2)));
+    }
+    lean_dec(f);
+}
+
+static lean_object * mk_add3(lean_object * a) {
+    lean_object * f = lean_alloc_closure((void *)add3, 3, 1);
+    lean_closure_set(f, 0, a);
+    return f;
+}
+
+static void bench_apply_over(size_t n) {
+    /* More arguments than the arity, so the result is applied to the remaining ones */
+    lean_object * f = lean_alloc_closure((void *)mk_add3, 1, 0);
+    for (size_t i = 0; i < n; i++) {
+        lean_inc(f);
+        g_sink += lean_unbox(lean_apply_3(f, lean_box(i), lean_box(1), lean_box(2)));
+    }
+    lean_dec(f);
+}
+
+static lean_object * first_of(lean_object * a, lean_object * b) {
+    lean_dec(b);
+    return a;
+}
+
+static void bench_apply_over_fixed(size_t n) {
+    /* Like `apply_over`, with the function stored as a fixed argument of a combinator */
+    lean_object * f = lean_alloc_closure((void *)first_of, 2, 1);
+    lean_closure_set(f, 0, lean_alloc_closure((void *)add3, 3, 0));
+    for (size_t i = 0; i < n; i++) {
+        lean_inc(f);
+        g_sink += lean_unbox(lean_apply_4(f, lean_box(0), lean_box(i), lean_box(1), lean_box(2)));
+    }
+    lean_dec(f);
+}
+
+static lean_object * task_body(lean_object * x, lean_object * unit) {
+    (void)unit;
+    return x;
+}
+
+static void bench_task_spawn_get(size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        lean_object * c = lean_alloc_closure((void *)task_body, 2, 1);
+        lean_closure_set(c, 0, lean_box(i));
+        lean_object * t = lean_task_spawn_core(c, 0, false);
+        g_sink += lean_unbox(lean_task_get_own(t));
+    }
+}
+
+static void bench_mark_mt(size_t n) {
+    /* A chain of nodes whose both fields point to the previous node, like shared subterms */
+    for (size_t i = 0; i < n; i++) {
+        lean_object * o = lean_box(0);
+        for (int j = 0; j < 64; j++) {
+            lean_object * c = lean_alloc_ctor(0, 2, 0);
+            if (!lean_is_scalar(o)) lean_inc(o);
+            lean_ctor_set(c, 0, o);
+            lean_ctor_set(c, 1, o);
+            o = c;
+        }
+        lean_mark_mt(o);
+        g_sink += (uintptr_t)o;
+        lean_dec(o);
+    }
+}
+
+struct bench {
+    char const * name;
+    bench_fn     fn;
+};
+
+static struct bench g_benches[] = {
+    {"alloc_small", bench_alloc_small},
+    {"rc_st", bench_rc_st},
+    {"rc_mt", bench_rc_mt},
+    {"array_push", bench_array_push},
+    {"string_append", bench_string_append},
+    {"string_hash", bench_string_hash},
+    {"nat_big_mul", bench_nat_big_mul},
+    {"nat_big_add", bench_nat_big_add},
+    {"box_uint64", bench_box_uint64},
+    {"box_float", bench_box_float},
+    {"apply_partial", bench_apply_partial},
+    {"apply_under", bench_apply_under},
+    {"apply_over", bench_apply_over},
+    {"apply_over_fixed", bench_apply_over_fixed},
+    {"task_spawn_get", bench_task_spawn_get},
+    {"mark_mt", bench_mark_mt},
+};
+
+static void run(struct bench const * b) {
+    size_t n = 1;
+    double t;
+    while (1) {
+        double start = now();
+        b->fn(n);
+        t = now() - start;
+        if (t >= MIN_BATCH_TIME)
+            break;
+        n *= 2;
+    }
+    printf("%s (ns/iter): %.2f\n", b->name, t * 1e9 / n);
+    fflush(stdout);
+}
+
+int main(int argc, char ** argv) {
+    lean_initialize_runtime_module();
+    lean_io_mark_end_initialization();
+    lean_init_task_manager();
+    size_t num_benches = sizeof(g_benches) / sizeof(g_benches[0]);
+    for (size_t i = 0; i < num_benches; i++) {
+        int selected = argc == 1;
+        for (int j = 1; j < argc; j++)
+            selected |= strcmp(argv[j], g_benches[i].name) == 0;
+        if (selected)
+            run(&g_benches[i]);
+    }
+    lean_finalize_task_manager();
+    return 0;
+}
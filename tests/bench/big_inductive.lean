@@ -0,0 +1,21 @@
+/-!
+This benchmark declares an inductive type with 500 constructors, most of them with recursive and
+higher-order recursive fields, to exercise the kernel checks of constructors (including positivity)
+and the generation of recursor rules.
+-/
+import Lean
+open Lean Elab Command
+
+-- The field types in the quotations below must refer to `Big` itself.
+set_option hygiene false in
+run_cmd do
+  let mut ctors : Array (TSyntax ``Parser.Command.ctor) := #[]
+  for i in [0:500] do
+    let c := mkIdent (.mkSimple s!"c{i}")
+    let ctor ← match i % 4 with
+      | 0 => `(Parser.Command.ctor| | $c:ident (n : Nat))
+      | 1 => `(Parser.Command.ctor| | $c:ident (n : Nat) (b : Big))
+      | 2 => `(Parser.Command.ctor| | $c:ident (f : Nat → Big) (b : Big))
+      | _ => `(Parser.Command.ctor| | $c:ident (xs : List Nat) (f : Nat → Bool → Big))
+    ctors := ctors.push ctor
+  elabCommand (← `(inductive Big where $[$ctors:ctor]*))
@@ -0,0 +1,43 @@
+/-!
+Hashes of build artifacts as computed by Lake's `computeBinFileHash` with `IO.FS.hashBinFile`,
+compared to reading each file into a `ByteArray` and to hashing a `MappedFile`.
+Usage: `file_hash.lean.out <files> <KiB per file>`
+-/
+
+@[noinline]
+def hashRead (paths : Array System.FilePath) : IO UInt64 :=
+  paths.foldlM (init := 0) fun h path => return mixHash h (hash (← IO.FS.readBinFile path))
+
+@[noinline]
+def hashMapped (paths : Array System.FilePath) : IO UInt64 :=
+  paths.foldlM (init := 0) fun h path => do
+    let m ← IO.FS.MappedFile.mk path
+    m.advise .sequential
+    return mixHash h m.hash
+
+@[noinline]
+def hashChunked (paths : Array System.FilePath) : IO UInt64 :=
+  paths.foldlM (init := 0) fun h path => return mixHash h (← IO.FS.hashBinFile path)
+
+def time (name : String) (act : IO UInt64) : IO UInt64 := do
+  let start ← IO.monoNanosNow
+  let h ← act
+  let stop ← IO.monoNanosNow
+  IO.println s!"{name}: {(stop - start).toFloat / 1e9}"
+  return h
+
+def main (args : List String) : IO Unit := do
+  let n := args[0]!.toNat!
+  let size := args[1]!.toNat! * 1024
+  let dir := System.FilePath.mk "file_hash.tmp"
+  IO.FS.createDirAll dir
+  let contents := ByteArray.mk <| (Array.range size).map (·.toUInt8)
+  let paths := (Array.range n).map (dir / s!"{·}.bin")
+  for path in paths do
+    IO.FS.writeBinFile path contents
+  let h₁ ← time "readBinFile" (hashRead paths)
+  let h₂ ← time "MappedFile" (hashMapped paths)
+  let h₃ ← time "hashBinFile" (hashChunked paths)
+  IO.FS.removeDirAll dir
+  unless h₁ == h₂ && h₁ == h₃ do
+    throw <| IO.userError "hashes differ"
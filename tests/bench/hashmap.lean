@@ -0,0 +1,22 @@
+import Std.Data.HashMap
+
+/-! `rbmap_library`-style workload on `Std.HashMap`: build a map, then look up every key. -/
+
+abbrev Map : Type := Std.HashMap Nat Bool
+
+def mkMapAux : Nat → Map → Map
+  | 0,   m => m
+  | n+1, m => mkMapAux n (m.insert n (n % 10 = 0))
+
+def mkMap (n : Nat) :=
+  mkMapAux n {}
+
+def countHits (m : Map) : Nat → Nat → Nat
+  | 0,   r => r
+  | n+1, r => countHits m n (if m.getD (n * 7 % m.size) false then r + 1 else r)
+
+def main (xs : List String) : IO Unit := do
+  let m := mkMap xs.head!.toNat!
+  let v := m.fold (fun r _ v => if v then r + 1 else r) 0
+  IO.println (toString v)
+  IO.println (toString (countHits m m.size 0))
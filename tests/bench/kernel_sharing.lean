@@ -0,0 +1,21 @@
+/-!
+This benchmark adds definitions whose declared and inferred types contain large terms that are
+structurally equal but built separately, as produced by metaprograms. Run it with and without
+`LEAN_KERNEL_MAX_SHARING` set to measure maximal sharing of definitions in the kernel.
+-/
+import Lean
+open Lean
+
+/-- A full binary tree of `Nat.add`s whose equal subtrees are distinct objects. -/
+def mkTree : Nat → Nat → Expr
+  | 0,     i => mkNatLit (i % 2)
+  | d + 1, i => mkApp2 (mkConst ``Nat.add) (mkTree d (2 * i)) (mkTree d (2 * i + 1))
+
+run_meta do
+  for i in [0:200] do
+    let tree (n : Nat) := mkTree 12 (n * 4096)
+    let type := mkApp3 (mkConst ``Eq [1]) (mkConst ``Nat) (tree 0) (tree 1)
+    let value := mkApp2 (mkConst ``Eq.refl [1]) (mkConst ``Nat) (tree 2)
+    addDecl <| .defnDecl {
+      name := .mkSimple s!"d{i}", levelParams := [], type, value
+      hints := .opaque, safety := .safe }
@@ -0,0 +1,23 @@
+/-!
+This benchmark exercises lazy delta reduction in the kernel on deep unfolding chains: `f i` and
+`g i` have the same definitional height, so checking `f i n = g i n` unfolds both sides in lockstep
+until reaching `n`.
+-/
+import Lean
+open Lean Elab Command
+
+run_cmd do
+  elabCommand (← `(def f0 (n : Nat) : Nat := n))
+  elabCommand (← `(def g0 (n : Nat) : Nat := n))
+  for i in [1:400] do
+    let f := mkIdent (.mkSimple s!"f{i}")
+    let f' := mkIdent (.mkSimple s!"f{i-1}")
+    let g := mkIdent (.mkSimple s!"g{i}")
+    let g' := mkIdent (.mkSimple s!"g{i-1}")
+    elabCommand (← `(def $f (n : Nat) : Nat := $f' n))
+    elabCommand (← `(def $g (n : Nat) : Nat := $g' n))
+
+run_cmd do
+  for i in [0:200] do
+    let t := mkIdent (.mkSimple s!"t{i}")
+    elabCommand (← `(theorem $t (n : Nat) : f399 (n + $(quote i)) = g399 (n + $(quote i)) := rfl))
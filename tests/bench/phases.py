@@ -0,0 +1,134 @@
+#!/usr/bin/env python3
+"""
+Run `lean` on the given files with the profiler enabled and report the time spent per phase together
+with wall time, peak RSS and, if `perf` is available, retired instructions.
+
+The results are printed as `'file metric': value` lines like `accumulate_profile.py` does, so the
+script can be used as a speedcenter `output` runner. With `--out` they are also saved as JSON, and
+with `--baseline` the relative change against such a saved run is reported as well:
+```
+./phases.py --out base.json big_omega.lean reduceMatch.lean
+# ... change and rebuild Lean ...
+./phases.py --baseline base.json big_omega.lean reduceMatch.lean
+```
+"""
+
+import argparse
+import collections
+import json
+import os
+import re
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+
+# Profiler categories and the phase they are attributed to. The breakdown of `import` into
+# categories such as `import: read .olean` is attributed to `import` as well. All other categories,
+# such as `tactic execution` or `typeclass inference`, are nested in elaboration.
+PHASES = {
+    "import": "import",
+    "parsing": "parse",
+    "elaboration": "elaborate",
+    "type checking": "kernel",
+    "compilation": "compile",
+    "compilation new": "compile",
+    "compiler new": "compile",
+    ".olean serialization": "olean write",
+}
+
+PHASE_ORDER = ["import", "parse", "elaborate", "kernel", "compile", "olean write"]
+
+def run_lean(args, path):
+    with tempfile.TemporaryDirectory() as tmp:
+        cmd = [args.lean, "-Dprofiler=true", "-Dprofiler.threshold=999999", "-o",
+               os.path.join(tmp, "out.olean"), path]
+        perf_out = os.path.join(tmp, "perf.txt")
+        if args.perf:
+            cmd = ["perf", "stat", "-x", ";", "-e", "instructions", "-o", perf_out, "--"] + cmd
+        start = time.monotonic()
+        proc = subprocess.Popen(cmd, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, text=True)
+        output = proc.stdout.read()
+        # `wait4` reports the resource usage of this child only, unlike `RUSAGE_CHILDREN`.
+        _, status, rusage = os.wait4(proc.pid, 0)
+        wall = time.monotonic() - start
+        proc.returncode = os.waitstatus_to_exitcode(status)
+        if proc.returncode != 0:
+            sys.stderr.write(output)
+            raise Exception(f"{path}: lean exited with code {proc.returncode}")
+
+        # Only the categories listed under `cumulative profiling times` are taken into account.
+        phases = collections.defaultdict(lambda: 0.0)
+        in_cumulative = False
+        for line in output.splitlines():
+            if not line.startswith("\t"):
+                in_cumulative = line == "cumulative profiling times:"
+            elif in_cumulative and (m := re.match(r"\t(.+?) ([\d.]+)(m?)s$", line)):
+                cat = m[1].strip()
+                if args.categories:
+                    phase = cat
+                elif cat.startswith("import: "):
+                    phase = "import"
+                else:
+                    phase = PHASES.get(cat, "elaborate")
+                phases[phase] += float(m[2]) * (1e-3 if m[3] else 1)
+
+        res = {
+            "phases": dict(phases),
+            "wall": wall,
+            # `ru_maxrss` is in KiB on Linux
+            "maxrss": rusage.ru_maxrss * 1024,
+        }
+        if args.perf:
+            with open(perf_out) as f:
+                for line in f:
+                    fields = line.strip().split(';')
+                    if len(fields) > 2 and fields[2].startswith("instructions") and fields[0].isdigit():
+                        res["instructions"] = int(fields[0])
+        return res
+
+def metrics(res):
+    for phase in sorted(res["phases"], key=lambda p: (PHASE_ORDER + [p]).index(p)):
+        yield phase, res["phases"][phase]
+    for key in ["wall", "maxrss", "instructions"]:
+        if key in res:
+            yield key, res[key]
+
+def main():
+    parser = argparse.ArgumentParser(description="Per-phase timings of elaborating Lean files")
+    parser.add_argument("files", nargs="+")
+    parser.add_argument("--lean", default="lean", help="the `lean` executable to run")
+    parser.add_argument("--out", help="save the results as JSON")
+    parser.add_argument("--baseline", help="report changes relative to results saved with `--out`")
+    parser.add_argument("--categories", action="store_true",
+                        help="report profiler categories instead of grouping them into phases")
+    parser.add_argument("--no-perf", dest="perf", action="store_false",
+                        help="do not count instructions using `perf stat`")
+    args = parser.parse_args()
+    if args.perf and shutil.which("perf") is None:
+        args.perf = False
+
+    baseline = {}
+    if args.baseline:
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+
+    results = {}
+    for path in args.files:
+        name = os.path.basename(path)
+        res = results[name] = run_lean(args, path)
+        base = dict(metrics(baseline[name])) if name in baseline else {}
+        for metric, value in metrics(res):
+            line = f"{f'{name} {metric}'!r}: {value:f}"
+            if metric in base and base[metric] != 0:
+                line += f"  # {(value - base[metric]) / base[metric] * 100:+.1f}% vs. baseline"
+            print(line)
+        sys.stdout.flush()
+
+    if args.out:
+        with open(args.out, "w") as f:
+            json.dump(results, f, indent=2, sort_keys=True)
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,90 @@
+#!/usr/bin/env python3
+"""
+Measure how parallel elaboration scales with the number of threads.
+
+The script generates a file of independent theorems, elaborates it with `lean --threads N` for
+N = 1, 2, 4, ... up to the number of CPUs, and reports wall time, speedup relative to one thread,
+and the statistics of the task manager (see `LEAN_TASK_STATS`) for each N. The cost of the file is
+controlled by the number of theorems and the number of `omega` calls in each proof:
+```
+./scaling.py --theorems 400 --cost 20
+./scaling.py --generate scaling_input.lean  # only write the generated file
+```
+"""
+
+import argparse
+import os
+import re
+import subprocess
+import sys
+import tempfile
+import time
+
+def generate(num_theorems, cost):
+    lines = []
+    for i in range(num_theorems):
+        lines.append(f"theorem thm{i} (x y : Nat) (h : x ≤ y) : x + {i} ≤ y + {i + cost} := by")
+        for j in range(cost):
+            lines.append(f"  have h{j} : x + {j} ≤ y + {j + 1} := by omega")
+        lines.append("  omega")
+        lines.append("")
+    return "\n".join(lines)
+
+def run_lean(args, path, threads):
+    env = dict(os.environ, LEAN_TASK_STATS="1")
+    cmd = [args.lean, f"--threads={threads}", "-DElab.async=true", path]
+    start = time.monotonic()
+    proc = subprocess.run(cmd, env=env, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, text=True)
+    wall = time.monotonic() - start
+    if proc.returncode != 0:
+        sys.stderr.write(proc.stdout)
+        raise Exception(f"lean --threads={threads} exited with code {proc.returncode}")
+    stats = {}
+    in_stats = False
+    for line in proc.stdout.splitlines():
+        if not line.startswith("\t"):
+            in_stats = line == "task manager statistics:"
+        elif in_stats and (m := re.match(r"\t(.+) (\d+)$", line)):
+            stats[m[1]] = int(m[2])
+    return wall, stats
+
+def thread_counts(max_threads):
+    n = 1
+    while n < max_threads:
+        yield n
+        n *= 2
+    yield max_threads
+
+def main():
+    parser = argparse.ArgumentParser(description="Scaling of parallel elaboration with --threads")
+    parser.add_argument("--lean", default="lean", help="the `lean` executable to run")
+    parser.add_argument("--theorems", type=int, default=200, help="number of generated theorems")
+    parser.add_argument("--cost", type=int, default=10, help="number of `omega` calls per theorem")
+    parser.add_argument("--max-threads", type=int, default=os.cpu_count())
+    parser.add_argument("--runs", type=int, default=1, help="take the best of this many runs")
+    parser.add_argument("--generate", metavar="FILE", help="only write the generated file to FILE")
+    args = parser.parse_args()
+
+    contents = generate(args.theorems, args.cost)
+    if args.generate:
+        with open(args.generate, "w") as f:
+            f.write(contents)
+        return
+
+    with tempfile.TemporaryDirectory() as tmp:
+        path = os.path.join(tmp, "Scaling.lean")
+        with open(path, "w") as f:
+            f.write(contents)
+        base = None
+        for threads in thread_counts(args.max_threads):
+            wall, stats = min((run_lean(args, path, threads) for _ in range(args.runs)),
+                              key=lambda r: r[0])
+            base = base or wall
+            print(f"{f'threads {threads} wall'!r}: {wall:f}")
+            print(f"{f'threads {threads} speedup'!r}: {base / wall:f}")
+            for name, value in stats.items():
+                print(f"{f'threads {threads} {name}'!r}: {value}")
+            sys.stdout.flush()
+
+if __name__ == "__main__":
+    main()
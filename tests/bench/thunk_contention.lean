@@ -0,0 +1,21 @@
+/-!
+Many tasks forcing the same thunk at once, so that all but one of them wait for the value computed
+by another task. Usage: `thunk_contention.lean.out <thunks> <tasks per thunk>`
+-/
+
+@[noinline]
+def work (n : Nat) : Nat := Id.run do
+  let mut acc := 0
+  for i in [0:n] do
+    acc := acc + i % 7
+  return acc
+
+def main (args : List String) : IO Unit := do
+  let numThunks := args[0]!.toNat!
+  let numTasks := args[1]!.toNat!
+  let mut total := 0
+  for i in [0:numThunks] do
+    let t : Thunk Nat := .mk fun _ => work (100000 + i)
+    let tasks := (List.range numTasks).map fun j => Task.spawn fun _ => t.get + j
+    total := tasks.foldl (init := total) (· + ·.get)
+  IO.println total
@@ -0,0 +1,29 @@
+/-!
+This benchmark exercises universe level constraints: each definition coerces between sorts whose
+levels are equal only up to normalization (reordered and nested `max` with offsets), so both the
+elaborator and the kernel have to compare normalized levels.
+-/
+import Lean
+open Lean Elab Command
+
+universe u v w
+
+-- The universe names in the quotations below must refer to `u v w`.
+set_option hygiene false in
+run_cmd do
+  let perms : Array (TSyntax `level × TSyntax `level × TSyntax `level) := #[
+    (← `(level| u), ← `(level| v), ← `(level| w)), (← `(level| u), ← `(level| w), ← `(level| v)),
+    (← `(level| v), ← `(level| u), ← `(level| w)), (← `(level| v), ← `(level| w), ← `(level| u)),
+    (← `(level| w), ← `(level| u), ← `(level| v)), (← `(level| w), ← `(level| v), ← `(level| u))]
+  for i in [0:600] do
+    let (a, b, c) := perms[i % 6]!
+    let (x, y, z) := perms[(i + 1 + i / 6) % 6]!
+    let k := quote (i % 3 + 1)
+    -- `lhs` and `rhs` are the same level
+    let lhs ← `(level| max $a (max $b $c))
+    let rhs ← `(level| max (max $x $y) $z)
+    let ci := mkIdent (.mkSimple s!"c{i}")
+    let di := mkIdent (.mkSimple s!"d{i}")
+    elabCommand (← `(def $ci (α : Sort ($lhs + $k)) : Sort ($rhs + $k) := α))
+    elabCommand (← `(def $di (α : Sort (max 1 $lhs)) (β : Sort ($rhs + 1)) :
+      Sort (max 1 (max ($rhs + 1) $lhs)) := PProd α β))
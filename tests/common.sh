@@ -25,7 +25,10 @@ function lean_has_llvm_support {
 }
 
 function compile_lean_c_backend {
-    lean --c="$f.c" "$f" || fail "Failed to compile $f into C file"
+    # `$f.flags` may contain additional options for the compiler such as `-Dcompiler.stackCtors=true`
+    lean_flags=""
+    [ -f "$f.flags" ] && lean_flags=$(< "$f.flags")
+    lean $lean_flags --c="$f.c" "$f" || fail "Failed to compile $f into C file"
     leanc ${LEANC_OPTS-} -O3 -DNDEBUG -o "$f.out" "$@" "$f.c" || fail "Failed to compile C file $f.c"
 }
 
@@ -0,0 +1,18 @@
+/-!
+With `compiler.exclusiveLoops`, a self tail call passing its array parameter unchanged must not
+enter the copy of the loop that skips the exclusivity checks, as the array may still be shared.
+-/
+
+def fill (a : ByteArray) (i : Nat) : ByteArray :=
+  if h : i < a.size then
+    if i == 0 then fill a (i+1)
+    else fill (a.set i 7) (i+1)
+  else a
+
+def main : IO Unit := do
+  let a := ByteArray.mk #[1, 2, 3, 4]
+  let b := fill a 0
+  IO.println a
+  IO.println b
+  let c := fill (ByteArray.mk #[5, 6]) 1
+  IO.println c
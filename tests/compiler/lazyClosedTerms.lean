@@ -0,0 +1,22 @@
+/-!
+Closed terms compiled with `compiler.lazyClosedTerms` are initialized on first access, which may
+happen inside a region or from several tasks at once.
+-/
+
+@[noinline] def greeting (i : Nat) : String :=
+  #["hello", "world"][i % 2]!
+
+@[noinline] def lookup (i : Nat) : String :=
+  #["zero", "one", "two", "three"][i % 4]!
+
+def work (n : Nat) : Nat := Id.run do
+  let mut s := 0
+  for i in [0:n] do
+    s := s + (lookup i).length
+  return s
+
+def main : IO Unit := do
+  IO.println (unsafe Runtime.withRegion fun _ => greeting 0 ++ " " ++ greeting 1)
+  IO.println (greeting 0 ++ " " ++ greeting 1)
+  let tasks := (List.range 8).map fun _ => Task.spawn fun _ => work 1000
+  IO.println (tasks.map Task.get)
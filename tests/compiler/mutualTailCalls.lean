@@ -0,0 +1,34 @@
+/-!
+Tail calls between mutually recursive functions with the same C signature are emitted with
+`LEAN_MUSTTAIL`, so that they run in constant stack space.
+-/
+
+mutual
+def isEven : Nat → Bool
+  | 0 => true
+  | n+1 => isOdd n
+
+def isOdd : Nat → Bool
+  | 0 => false
+  | n+1 => isEven n
+end
+
+mutual
+def countA : Nat → Nat → Nat
+  | 0, acc => acc
+  | n+1, acc => countB n (acc + 1)
+
+def countB : Nat → Nat → Nat
+  | 0, acc => acc
+  | n+1, acc => countC n (acc + 2)
+
+def countC : Nat → Nat → Nat
+  | 0, acc => acc
+  | n+1, acc => countA n (acc + 3)
+end
+
+def main : IO Unit := do
+  IO.println (isEven 10000000)
+  IO.println (isOdd 10000001)
+  IO.println (isEven 10000001)
+  IO.println (countA 30000000 0)
@@ -0,0 +1,51 @@
+/-!
+With `compiler.stackCtors`, constructor objects that do not escape their function are allocated
+on the stack. Check projections, `case`, join points, and releasing the fields on each path.
+-/
+
+structure P where
+  name : String
+  tags : List String
+  n    : UInt32
+  w    : Float
+
+@[noinline] def mkName (i : Nat) : String := s!"item{i}"
+
+/-- Projections of object and scalar fields. -/
+@[noinline] def describe (i : Nat) : String :=
+  let p : P := { name := mkName i, tags := [mkName (i+1)], n := i.toUInt32, w := i.toFloat / 2 }
+  s!"{p.name} {p.tags} {p.n} {p.w}"
+
+/-- `case` on a local object whose constructor depends on the input. -/
+@[noinline] def pick (i : Nat) : String :=
+  let e : Except String (String × Nat) := if i % 2 == 0 then .ok (mkName i, i) else .error (mkName i)
+  match e with
+  | .ok (s, n) => s ++ "/" ++ toString n
+  | .error s   => "error " ++ s
+
+/-- Join points and a different set of fields alive on each path. -/
+@[noinline] def join (i : Nat) : String := Id.run do
+  let q := (mkName i, mkName (i+1), i)
+  let mut r := ""
+  if q.2.2 % 3 == 0 then
+    r := q.1
+  else if q.2.2 % 3 == 1 then
+    r := q.2.1
+  else
+    r := q.1 ++ q.2.1
+  return r ++ "!"
+
+/-- A local object created in every iteration of a loop. -/
+@[noinline] def loop (n : Nat) : Nat := Id.run do
+  let mut acc := 0
+  for i in [0:n] do
+    let p := (mkName i, i)
+    acc := acc + p.1.length + p.2
+  return acc
+
+def main : IO Unit := do
+  for i in [0:4] do
+    IO.println (describe i)
+    IO.println (pick i)
+    IO.println (join i)
+  IO.println (loop 1000)
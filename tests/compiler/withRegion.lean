@@ -0,0 +1,37 @@
+def build (n : Nat) : List (Nat × String) :=
+  (List.range n).map fun i => (i, toString i)
+
+def summarize (xs : List (Nat × String)) : Array String :=
+  xs.foldl (init := #[]) fun acc (i, s) => if i % 1000 == 0 then acc.push s else acc
+
+unsafe def summarizeInRegionImp (xs : List (Nat × String)) : Array String :=
+  Runtime.withRegion fun _ => summarize (build 5000 ++ xs)
+
+@[implemented_by summarizeInRegionImp]
+def summarizeInRegion (xs : List (Nat × String)) : Array String :=
+  summarize (build 5000 ++ xs)
+
+unsafe def doublesInRegionImp (n : Nat) : Array Nat :=
+  Runtime.withRegion fun _ => (List.range n).toArray.map (· * 2)
+
+@[implemented_by doublesInRegionImp]
+def doublesInRegion (n : Nat) : Array Nat :=
+  (List.range n).toArray.map (· * 2)
+
+-- persistent objects outlive the region
+unsafe def persistentInRegionImp (n : Nat) : List String :=
+  Runtime.withRegion fun _ => unsafeBaseIO (Runtime.markPersistent ((build n).map (·.2)))
+
+@[implemented_by persistentInRegionImp]
+def persistentInRegion (n : Nat) : List String :=
+  (build n).map (·.2)
+
+def main : IO Unit := do
+  let base := build 10
+  for _ in [0:3] do
+    IO.println (summarizeInRegion base)
+  let big := doublesInRegion 2000
+  IO.println (big.size, big.foldl (· + ·) 0)
+  let names := persistentInRegion 5
+  IO.println (summarizeInRegion base)
+  IO.println names
@@ -0,0 +1,68 @@
+import Lean.CoreM
+
+/-!
+Batches of declarations added with `Kernel.Environment.addDeclsCore`, mixing inductive types, which
+are added synchronously, with declarations checked in parallel.
+-/
+
+open Lean
+
+def defn (n : Name) (type value : Expr) : Declaration :=
+  .defnDecl { name := n, levelParams := [], type, value, hints := .abbrev, safety := .safe }
+
+def ind (n : Name) : Declaration :=
+  .inductDecl [] 0 [{ name := n, type := .sort 1, ctors := [{ name := n ++ `mk, type := .const n [] }] }] false
+
+def nat : Expr := .const ``Nat []
+
+/-- Adds `decls` as one batch, and prints those of `names` that are in the resulting environment. -/
+def addBatch (decls : Array Declaration) (names : List Name) : CoreM Unit := do
+  match (← getEnv).toKernelEnv.addDeclsCore 0 decls none with
+  | .ok env => IO.println (names.filter (env.find? · |>.isSome))
+  | .error _ => IO.println "kernel error"
+
+/-- info: [a, T, T.mk] -/
+#guard_msgs in
+#eval addBatch #[defn `a nat (.lit (.natVal 1)), ind `T] [`a, `T, `T.mk]
+
+/-- info: [T, T.mk, b] -/
+#guard_msgs in
+#eval addBatch #[ind `T, defn `b (.const `T []) (.const `T.mk [])] [`T, `T.mk, `b]
+
+/-- info: [a, T, T.mk, b, U, U.mk] -/
+#guard_msgs in
+#eval addBatch #[defn `a nat (.lit (.natVal 1)), ind `T, defn `b (.const `T []) (.const `T.mk []), ind `U]
+  [`a, `T, `T.mk, `b, `U, `U.mk]
+
+-- an ill-typed definition before an inductive type
+/-- info: kernel error -/
+#guard_msgs in
+#eval addBatch #[defn `a nat (.sort 0), ind `T] [`a, `T]
+
+-- an inductive type referring to a later declaration
+/-- info: kernel error -/
+#guard_msgs in
+#eval addBatch #[ind `T, .inductDecl [] 0 [{ name := `V, type := .sort 1, ctors := [{ name := `V.mk, type := .const `W [] }] }] false,
+  defn `W (.sort 1) nat] [`T, `V, `W]
+
+-- a definition referring to a later definition of the batch
+/-- info: kernel error -/
+#guard_msgs in
+#eval addBatch #[defn `b nat (.const `c []), defn `c nat (.lit (.natVal 1))] [`b, `c]
+
+-- the same term is checked in several environments of the batch, and only the later ones contain `c`
+/-- info: kernel error -/
+#guard_msgs in
+#eval addBatch #[defn `c nat (.lit (.natVal 1)), defn `d nat (.const `c []), defn `e nat (.const `f []),
+  defn `f nat (.const `c []), defn `g nat (.const `f [])] [`c, `d, `e, `f, `g]
+
+-- a declaration of the batch that cannot be added, followed by a valid one
+/-- info: kernel error -/
+#guard_msgs in
+#eval addBatch #[defn `a nat (.lit (.natVal 1)), defn `a nat (.lit (.natVal 2)), defn `h nat (.lit (.natVal 3))]
+  [`a, `h]
+
+/-- info: [a, b, c] -/
+#guard_msgs in
+#eval addBatch #[defn `a nat (.lit (.natVal 1)), defn `b nat (.const `a []), defn `c nat (.const `b [])]
+  [`a, `b, `c]
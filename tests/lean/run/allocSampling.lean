@@ -0,0 +1,21 @@
+/-!
+Tests for the sampling allocation profiler. Sampling requires the small object allocator, which may
+be disabled (e.g. in sanitizer builds), so we only check that a well-formed profile is written.
+-/
+
+def checkAllocSampling : IO Unit := do
+  startAllocSampling (period := 4096)
+  let n := (List.range 100000).map (· + 1) |>.foldl (· + ·) 0
+  stopAllocSampling
+  assert! n > 0
+  let (_, path) ← IO.FS.createTempFile
+  try
+    writeAllocProfile path
+    let bytes ← IO.FS.readBinFile path
+    -- the string table contains at least the sample types
+    unless bytes.size > 0 do
+      throw <| IO.userError "empty allocation profile"
+  finally
+    IO.FS.removeFile path
+
+#eval checkAllocSampling
@@ -0,0 +1,21 @@
+/-!
+Tests for `IO.getAllocStats`. The small object allocator may be disabled (e.g. in sanitizer builds),
+so we only check that the statistics are consistent.
+-/
+
+def checkAllocStats : IO Unit := do
+  let s ← IO.getAllocStats
+  for c in s.sizeClasses do
+    unless c.numPages > 0 && c.numLiveObjects ≤ c.capacity && c.objSize > 0 do
+      throw <| IO.userError s!"inconsistent size class statistics: {repr c}"
+  unless s.sizeClasses.size == 0 || s.numHeaps > 0 do
+    throw <| IO.userError "size classes without heaps"
+  -- allocate on another thread so that its heap is published as well
+  let t ← IO.asTask (prio := .dedicated) do
+    return (List.range 1000).map (· + 1) |>.foldl (· + ·) 0
+  discard <| IO.wait t
+  let s' ← IO.getAllocStats
+  unless s'.numHeaps ≥ s.numHeaps do
+    throw <| IO.userError "number of heaps decreased"
+
+#eval checkAllocStats
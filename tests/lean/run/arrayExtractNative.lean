@@ -0,0 +1,35 @@
+/-!
+# `Array.extract` is implemented natively by `lean_array_extract`
+
+The native version moves the elements out of the input array when it is not shared, so we check
+both the exclusive and the shared paths against the expected results.
+-/
+
+def xs : Array Nat := #[0, 1, 2, 3, 4, 5]
+
+#guard xs.extract 1 4 = #[1, 2, 3]
+#guard xs.extract 0 6 = xs
+#guard xs.extract 4 100 = #[4, 5]
+#guard xs.extract 4 2 = #[]
+#guard xs.extract 7 9 = #[]
+#guard xs.extract (2^70) (2^80) = #[]
+#guard xs.extract 3 (2^80) = #[3, 4, 5]
+#guard xs.take 2 = #[0, 1]
+#guard xs.drop 5 = #[5]
+
+def exclusive (n i j : Nat) : Array String :=
+  ((List.range n).map toString).toArray.extract i j
+
+#guard exclusive 6 2 4 = #["2", "3"]
+#guard exclusive 6 0 3 = #["0", "1", "2"]
+#guard exclusive 6 3 6 = #["3", "4", "5"]
+#guard exclusive 0 0 1 = #[]
+
+def shared (n i j : Nat) : Array String × Array String :=
+  let as := ((List.range n).map toString).toArray
+  (as, as.extract i j)
+
+#guard shared 4 1 3 = (#["0", "1", "2", "3"], #["1", "2"])
+
+#guard (xs[2:5] : Subarray Nat).toArray = #[2, 3, 4]
+#guard xs[:0].toArray = #[]
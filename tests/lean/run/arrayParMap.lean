@@ -0,0 +1,21 @@
+/-!
+`Array.parMap` splits the array between the calling thread and helper tasks. Check that every
+element is mapped exactly once, in order, for sizes around the chunking thresholds and for
+results that are themselves heap objects.
+-/
+
+def check (n : Nat) : IO Unit := do
+  let as := (List.range n).toArray
+  let bs := as.parMap fun i => (List.range (i % 50)).foldl (· + ·) i
+  unless bs == as.map (fun i => (List.range (i % 50)).foldl (· + ·) i) do
+    throw <| IO.userError s!"unexpected result for size {n}"
+
+#eval do
+  for n in [0, 1, 2, 3, 7, 64, 1000, 100000] do
+    check n
+
+#eval do
+  let as := (List.range 10000).toArray
+  let bs := as.parMap fun i => s!"{i}"
+  unless bs.size == as.size && bs[1234]! == "1234" do
+    throw <| IO.userError "unexpected string result"
@@ -0,0 +1,33 @@
+import Std.Internal.UV
+import Std.Net.Addr
+open Std.Internal.UV
+open Std.Net
+
+def await (p : IO (IO.Promise (Except IO.Error α))) : IO α := do
+  IO.ofExcept (← p).result.get
+
+def loopback : SocketAddress := .v4 { addr := .ofParts 127 0 0 1, port := 80 }
+
+def numericHost : IO Unit := do
+  let addrs ← await (DNS.getAddrInfo "127.0.0.1" "80")
+  assert! addrs == #[loopback]
+
+def cachedHost : IO Unit := do
+  let addrs1 ← await (DNS.getAddrInfo "127.0.0.1" "80" (cache := true))
+  let addrs2 ← await (DNS.getAddrInfo "127.0.0.1" "80" (cache := true))
+  assert! addrs1 == addrs2
+
+def unknownHost : IO Unit := do
+  match (← (← DNS.getAddrInfo "does-not-exist.invalid" "").result.get) with
+  | .ok _ => throw <| .userError "expected resolution to fail"
+  | .error _ => pure ()
+
+def nameOfLoopback : IO Unit := do
+  let (host, service) ← await (DNS.getNameInfo loopback)
+  assert! !host.isEmpty
+  assert! !service.isEmpty
+
+#eval numericHost
+#eval cachedHost
+#eval unknownHost
+#eval nameOfLoopback
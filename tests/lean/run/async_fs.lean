@@ -0,0 +1,33 @@
+import Std.Internal.UV
+open Std.Internal.UV
+
+def await (p : IO (IO.Promise (Except IO.Error α))) : IO α := do
+  IO.ofExcept (← p).result.get
+
+def testFs : IO Unit := do
+  let dir := "async_fs_test_dir"
+  if ← System.FilePath.isDir dir then
+    IO.FS.removeDirAll dir
+  await (FS.createDir dir)
+  let md ← await (FS.metadata dir)
+  assert! md.type == .dir
+  let a := dir ++ "/a.txt"
+  let b := dir ++ "/b.txt"
+  IO.FS.writeFile a "hello"
+  let md ← await (FS.metadata a)
+  assert! md.type == .file
+  assert! md.byteSize == 5
+  await (FS.rename a b)
+  assert! !(← System.FilePath.pathExists a)
+  assert! (← IO.FS.readFile b) == "hello"
+  await (FS.removeFile b)
+  assert! !(← System.FilePath.pathExists b)
+  -- errors are reported through the promise
+  match (← FS.metadata b).result.get with
+  | .ok _ => throw <| .userError "expected an error"
+  | .error (.noFileOrDirectory ..) => pure ()
+  | .error e => throw e
+  await (FS.removeDir dir)
+  assert! !(← System.FilePath.pathExists dir)
+
+#eval testFs
@@ -0,0 +1,21 @@
+import Std.Internal.Async.Timer
+
+open Std.Internal.IO.Async
+
+/-!
+`Std.Internal.UV.Loop.stats` reports one entry per event loop and counts loop activity.
+-/
+
+#eval show IO Unit from do
+  let before ← Std.Internal.UV.Loop.stats
+  unless before.size ≥ 1 do
+    throw <| IO.userError "expected at least one event loop"
+  let t ← sleep 10
+  t.block
+  let after ← Std.Internal.UV.Loop.stats
+  unless after[0]!.iterations > before[0]!.iterations do
+    throw <| IO.userError "event loop did not iterate"
+  unless after[0]!.submissions > before[0]!.submissions do
+    throw <| IO.userError "sleep was not submitted to the event loop"
+  unless after[0]!.maxSubmitLatency ≥ before[0]!.maxSubmitLatency do
+    throw <| IO.userError "maximum latency decreased"
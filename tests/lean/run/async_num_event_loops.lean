@@ -0,0 +1,33 @@
+import Std.Internal.Async.Timer
+
+open Std.Internal.IO.Async
+
+/-!
+`LEAN_NUM_EVENT_LOOPS` starts one event loop per requested loop, up to a fixed maximum of 64.
+Each child process reports the number of loops it runs after using a timer on them.
+-/
+
+def child : String := "import Std.Internal.Async.Timer
+open Std.Internal.IO.Async
+def main : IO Unit := do
+  for _ in [0:8] do
+    (← sleep 1).block
+  IO.println (← Std.Internal.UV.Loop.stats).size
+"
+
+def numLoops (n : String) : IO String := do
+  IO.FS.withTempFile fun h path => do
+    h.putStr child
+    h.flush
+    let out ← IO.Process.output {
+      cmd := (← IO.appPath).toString
+      args := #["--run", path.toString]
+      env := #[("LEAN_NUM_EVENT_LOOPS", some n)]
+    }
+    unless out.exitCode == 0 do
+      throw <| IO.userError s!"child failed: {out.stderr}"
+    return out.stdout.trim
+
+/-- info: ["1", "1", "4", "64"] -/
+#guard_msgs in
+#eval show IO (List String) from ["0", "1", "4", "100000"].mapM numLoops
@@ -0,0 +1,40 @@
+import Std.Internal.UV
+import Std.Net.Addr
+open Std.Internal.UV
+open Std.Net
+
+def await (p : IO (IO.Promise (Except IO.Error α))) : IO α := do
+  IO.ofExcept (← p).result.get
+
+def localhost : SocketAddress := .v4 { addr := .ofParts 127 0 0 1, port := 0 }
+
+def tcpEcho : IO Unit := do
+  let server ← TCP.Socket.new
+  server.bind localhost
+  server.listen 16
+  let addr ← server.getSockName
+  let accepted ← server.accept
+  let client ← TCP.Socket.new
+  await (client.connect addr)
+  let conn ← IO.ofExcept accepted.result.get
+  client.noDelay
+  await (client.send "hello".toUTF8)
+  let some data ← await (conn.recv? 1024) | throw <| .userError "unexpected end of stream"
+  assert! String.fromUTF8! data == "hello"
+  assert! (← conn.getPeerName) == (← client.getSockName)
+  await (conn.shutdown)
+  let none ← await (client.recv? 1024) | throw <| .userError "expected end of stream"
+
+def udpPingPong : IO Unit := do
+  let a ← UDP.Socket.new
+  a.bind localhost
+  let b ← UDP.Socket.new
+  b.bind localhost
+  let received ← b.recv 1024
+  await (a.send "ping".toUTF8 (some (← b.getSockName)))
+  let (data, sender) ← IO.ofExcept received.result.get
+  assert! String.fromUTF8! data == "ping"
+  assert! sender == some (← a.getSockName)
+
+#eval tcpEcho
+#eval udpPingPong
@@ -0,0 +1,54 @@
+import Std.Internal.UV
+import Std.Internal.Async.Timer
+open Std.Internal.UV
+
+def await (x : Task α) : IO α := pure x.get
+
+-- the wheel ticks every 10ms, allow generous slack for slow CI systems
+def EPS : Nat := 200
+
+def elapsedAtLeast (timeout : Nat) (x : IO Unit) : IO Unit := do
+  let t1 ← IO.monoMsNow
+  x
+  let t2 ← IO.monoMsNow
+  let dur := t2 - t1
+  if dur < timeout || dur > timeout + EPS then
+    throw <| .userError s!"elapsed time was {dur}, expected at least {timeout}, tolerance {EPS}"
+
+def oneSleep : IO Unit := do
+  elapsedAtLeast 100 do
+    let p ← TimerWheel.sleep 100
+    await p.result
+
+def zeroSleep : IO Unit := do
+  let p ← TimerWheel.sleep 0
+  await p.result
+
+def manySleeps : IO Unit := do
+  elapsedAtLeast 300 do
+    let mut ps := #[]
+    for i in [0:10000] do
+      ps := ps.push (← TimerWheel.sleep (100 + (i % 200).toUInt64))
+    -- sleeps expiring at the same tick share their promise
+    assert! (← TimerWheel.pending) ≤ 25
+    for p in ps do
+      await p.result
+  assert! (← TimerWheel.pending) == 0
+
+def orderedSleeps : IO Unit := do
+  let long ← TimerWheel.sleep 700
+  let short ← TimerWheel.sleep 50
+  await short.result
+  assert! (← IO.getTaskState long.result) != .finished
+  await long.result
+
+def surfaceSleep : IO Unit := do
+  let task ← Std.Internal.IO.Async.coarseSleep 20
+  let task ← task.mapIO fun _ => return 37
+  assert! (← task.block) == 37
+
+#eval oneSleep
+#eval zeroSleep
+#eval manySleeps
+#eval orderedSleeps
+#eval surfaceSleep
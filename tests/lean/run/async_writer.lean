@@ -0,0 +1,19 @@
+import Std.Internal.UV
+open Std.Internal.UV
+
+def await (x : Task α) : IO α := pure x.get
+
+def test : IO Unit := do
+  -- not an open file descriptor
+  match ← (Writer.mk 12345).toBaseIO with
+  | .ok _ => throw <| .userError "expected an error"
+  | .error _ => pure ()
+  -- the standard output is only supported if it is a pipe or terminal
+  match ← (Writer.mk 1).toBaseIO with
+  | .ok w =>
+    let p ← w.write "written by a Writer\n".toUTF8
+    IO.ofExcept (← await p.result)
+    assert! (← w.queueSize) == 0
+  | .error _ => pure ()
+
+#eval test
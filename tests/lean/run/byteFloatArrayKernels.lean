@@ -0,0 +1,25 @@
+/-!
+# Native `ByteArray.indexOfAux`, `ByteArray.sort` and `FloatArray.sum`
+-/
+
+def bs : ByteArray := ⟨#[1, 2, 3, 2, 1]⟩
+
+#guard bs.indexOf? 2 = some 1
+#guard bs.indexOf? 2 (start := 2) = some 3
+#guard bs.indexOf? 7 = none
+#guard bs.indexOf? 1 (start := 5) = none
+#guard bs.indexOfAux 1 100 = 5
+#guard ByteArray.empty.indexOf? 0 = none
+
+#guard bs.sort.data = #[1, 1, 2, 2, 3]
+#guard ByteArray.empty.sort.size = 0
+def big : ByteArray := ⟨(Array.range 1000).map fun i => (i * 37 % 256).toUInt8⟩
+#guard big.sort.data = big.data.qsort (· < ·)
+-- `bs` is shared, so sorting must not modify it
+#guard bs.sort.data != bs.data && bs.data = #[1, 2, 3, 2, 1]
+
+def fs : FloatArray := ⟨#[1.5, 2.25, -0.75]⟩
+
+#guard fs.sum == 3.0
+#guard FloatArray.empty.sum == 0
+#guard (⟨#[1e16, 1, -1e16]⟩ : FloatArray).sum == (1e16 + 1 + -1e16 : Float)
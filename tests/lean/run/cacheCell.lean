@@ -0,0 +1,23 @@
+/-! Cache cells can be emptied by the runtime at any time but never return a stale value. -/
+
+def test : IO Unit := do
+  let c : IO.CacheCell (Array Nat) ← IO.CacheCell.new
+  assert! (← c.get?).isNone
+  c.set #[1, 2, 3]
+  assert! (← c.get?) == some #[1, 2, 3]
+  c.set #[4]
+  assert! (← c.get?) == some #[4]
+  c.clear
+  assert! (← c.get?).isNone
+  let mut n := 0
+  for _ in [0:3] do
+    let v ← c.getOrCompute (pure #[n])
+    assert! v.size == 1
+    n := n + 1
+  -- values can be set and read from other threads
+  let tasks ← (List.range 8).mapM fun i => IO.asTask (c.set #[i])
+  for t in tasks do
+    let _ ← IO.wait t
+  assert! ((← c.get?).map (·.size)) == some 1
+
+#eval test
@@ -0,0 +1,62 @@
+import Std.Sync.Channel
+open Std
+
+def fifo : IO Unit := do
+  let ch : Channel Nat ← Channel.new
+  for i in [0:1000] do
+    ch.send i
+  let mut received := #[]
+  for _ in [0:1000] do
+    let some v ← IO.wait (← ch.recv?) | throw <| .userError "unexpected close"
+    received := received.push v
+  assert! received == (List.range 1000).toArray
+
+def waitingConsumer : IO Unit := do
+  let ch : Channel Nat ← Channel.new
+  let t ← ch.recv?
+  assert! !(← IO.hasFinished t)
+  ch.send 37
+  assert! (← IO.wait t) == some 37
+
+def closeWakesConsumers : IO Unit := do
+  let ch : Channel Nat ← Channel.new
+  let t1 ← ch.recv?
+  let t2 ← ch.recv?
+  ch.send 1
+  ch.close
+  assert! (← IO.wait t1) == some 1
+  assert! (← IO.wait t2) == none
+  ch.send 2
+  assert! (← IO.wait (← ch.recv?)) == none
+
+def bounded : IO Unit := do
+  let ch : Channel Nat ← Channel.newBounded 2
+  assert! (← ch.trySend 1)
+  assert! (← ch.trySend 2)
+  assert! !(← ch.trySend 3)
+  assert! (← IO.wait (← ch.recv?)) == some 1
+  assert! (← ch.trySend 4)
+  assert! (← ch.recvAllCurrent) == #[2, 4]
+  ch.close
+  assert! !(← ch.trySend 5)
+
+def manyProducers : IO Unit := do
+  let ch : Channel Nat ← Channel.new
+  let producers ← (List.range 8).mapM fun p => IO.asTask do
+    for i in [0:1000] do
+      ch.send (p * 1000 + i)
+  let consumer ← IO.asTask do
+    let mut sum := 0
+    for _ in [0:8000] do
+      let some v ← ch.sync.recv? | throw <| .userError "unexpected close"
+      sum := sum + v
+    return sum
+  for p in producers do
+    discard <| IO.ofExcept (← IO.wait p)
+  assert! (← IO.ofExcept (← IO.wait consumer)) == (List.range 8000).foldl (· + ·) 0
+
+#eval fifo
+#eval waitingConsumer
+#eval closeWakesConsumers
+#eval bounded
+#eval manyProducers
@@ -0,0 +1,15 @@
+def tstFoldLines : IO Unit := do
+  let path := "tmp_fold_lines_file"
+  IO.FS.writeFile path "a\nbb\r\n\nccc"
+  let ls ← IO.FS.withFile path .read fun h => h.foldLines #[] fun ls l => pure (ls.push l)
+  unless ls == #["a", "bb", "", "ccc"] do
+    throw <| IO.userError s!"unexpected lines: {ls}"
+  let n ← IO.FS.withFile path .read fun h => h.foldLines 0 fun n l => pure (n + l.length)
+  IO.println n
+  unless (← IO.FS.lines path) == ls do
+    throw <| IO.userError "IO.FS.lines disagrees with foldLines"
+  IO.FS.removeFile path
+
+/-- info: 6 -/
+#guard_msgs in
+#eval tstFoldLines
@@ -0,0 +1,19 @@
+def tstPositionalIO : IO Unit := do
+  let path := "tmp_positional_io_file"
+  IO.FS.withFile path .write fun h => do
+    h.write "ab".toUTF8
+    h.writeMany #["cd".toUTF8, ByteArray.empty, "efg".toUTF8]
+    h.writeAt 1 "XY".toUTF8
+  let s ← IO.FS.readFile path
+  unless s == "aXYdefg" do throw <| IO.userError s!"unexpected contents {s}"
+  IO.FS.withFile path .read fun h => do
+    let b ← h.readAt 3 3
+    unless b.toList == "def".toUTF8.toList do throw <| IO.userError "unexpected readAt"
+    unless (← h.readAt 100 3).size == 0 do throw <| IO.userError "expected end of file"
+    -- `readAt` does not move the position of the handle (except on Windows)
+    unless System.Platform.isWindows do
+      let b ← h.read 2
+      unless b.toList == "aX".toUTF8.toList do throw <| IO.userError "unexpected read"
+  IO.FS.removeFile path
+
+#eval tstPositionalIO
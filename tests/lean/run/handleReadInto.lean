@@ -0,0 +1,19 @@
+def tstReadInto : IO Unit := do
+  let path := "tmp_read_into_file"
+  IO.FS.writeFile path "hello world"
+  IO.FS.withFile path .read fun h => do
+    let buf ← h.readInto (ByteArray.emptyWithCapacity 16) 0 5
+    unless buf.toList == "hello".toUTF8.toList do throw <| IO.userError "unexpected first chunk"
+    -- `off` past the end is clamped to the current size
+    let buf ← h.readInto buf 100 3
+    unless buf.toList == "hello wo".toUTF8.toList do throw <| IO.userError "unexpected second chunk"
+    -- Reusing the buffer from the start truncates it to the data read
+    let buf ← h.readInto buf 0 10
+    unless buf.toList == "rld".toUTF8.toList do throw <| IO.userError "unexpected third chunk"
+    let buf ← h.readInto buf 1 10
+    unless buf.toList == "r".toUTF8.toList do throw <| IO.userError "expected end of file"
+  let all ← IO.FS.readBinFile path
+  unless all.toList == "hello world".toUTF8.toList do throw <| IO.userError "unexpected readBinFile result"
+  IO.FS.removeFile path
+
+#eval tstReadInto
@@ -1,2 +1,15 @@
 #eval IO.getRandomBytes 0
 #eval IO.getRandomBytes 256
+
+-- small requests are served from a buffered per-thread generator, large ones by the OS
+def checkRandomBytes : IO Unit := do
+  let mut seen : Array (List UInt8) := #[]
+  for n in [1, 7, 31, 32, 33, 64, 255, 256, 257, 1000, 4096] do
+    for _ in [0:50] do
+      let bs ← IO.getRandomBytes n.toUSize
+      assert! bs.size == n
+      if n ≥ 16 then
+        assert! !seen.contains bs.toList
+        seen := seen.push bs.toList
+
+#eval checkRandomBytes
@@ -0,0 +1,23 @@
+import Lean.Data.JsonRpc
+
+open Lean Lean.JsonRpc
+
+/-! The classification of serialized messages must agree with the format of `Json.compress`. -/
+
+def serialize (m : Message) : String :=
+  (toJson m).compress
+
+#guard peekNotificationMethod? (serialize (.notification "textDocument/publishDiagnostics"
+  (some (.arr #[Json.str "file:///a.lean", Json.arr #[]])))) ==
+  some "textDocument/publishDiagnostics"
+#guard peekNotificationMethod? (serialize (.notification "$/lean/ileanInfoFinal" none)) ==
+  some "$/lean/ileanInfoFinal"
+#guard peekNotificationMethod? (serialize (.request 1 "textDocument/hover" none)) == none
+#guard peekNotificationMethod? (serialize (.response 1 (Json.mkObj [("method", Json.str "m")]))) == none
+
+#guard peekResponseId? (serialize (.response 42 (Json.mkObj [("contents", Json.str "x")]))) == some 42
+#guard peekResponseId? (serialize (.response (.str "r1") Json.null)) == some (.str "r1")
+#guard peekResponseId? (serialize (.response (.str "a\"b") Json.null)) == none
+#guard peekResponseId? (serialize (.responseError 3 .internalError "oops" none)) == none
+#guard peekResponseId? (serialize (.request 3 "textDocument/hover" none)) == none
+#guard peekResponseId? (serialize (.notification "m" none)) == none
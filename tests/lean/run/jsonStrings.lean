@@ -0,0 +1,29 @@
+import Lean.Data.Json
+
+open Lean
+
+/-! Rendering and parsing of string literals, which copy runs of plain characters natively. -/
+
+#guard Json.nextSpecialByte "" 0 == 0
+#guard Json.nextSpecialByte "abc" 5 == 5
+#guard Json.nextSpecialByte "abcdefghijklmnop\"q" 0 == 16
+#guard Json.nextSpecialByte "abcdefghijklmnop\"q" 17 == 18
+#guard Json.nextSpecialByte "αβγδεζηθ\\" 0 == 16
+#guard Json.nextSpecialByte "abcdefg\x01" 3 == 7
+
+#guard Json.compress (.str "plain text that is longer than eight bytes") ==
+  "\"plain text that is longer than eight bytes\""
+#guard Json.compress (.str "quote \" backslash \\ newline \n tab \t unicode ∀ end") ==
+  "\"quote \\\" backslash \\\\ newline \\n tab \\u0009 unicode ∀ end\""
+
+def roundtrips (s : String) : Bool :=
+  (Json.parse (Json.compress (.str s))).toOption == some (.str s)
+
+#guard roundtrips ""
+#guard roundtrips "\"\"\\\\"
+#guard roundtrips "αβγ \x01\x1f \"∀x, p x\" \\n ends with a backslash \\"
+#guard roundtrips (String.join (List.replicate 100 "abcdefg\""))
+
+#guard (Json.parse "\"a\\u0041\\/b\"").toOption == some (.str "aA/b")
+#guard (Json.parse "\"unterminated").toOption.isNone
+#guard (Json.parse "\"control \x01 character\"").toOption.isNone
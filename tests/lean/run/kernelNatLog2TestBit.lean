@@ -0,0 +1,13 @@
+/-!
+The kernel and `whnf` evaluate `Nat.log2` and `Nat.testBit` on literals.
+-/
+
+example : Nat.log2 (2^1000) = 1000 := by decide
+example : Nat.log2 (2^1000 - 1) = 999 := by decide
+example : Nat.log2 0 = 0 := rfl
+example : (2^4096 + 5).testBit 4096 = true := by decide
+example : (2^4096 + 5).testBit 1 = false := by decide
+example : (2^4096 + 5).testBit 2 = true := by decide
+example : Nat.testBit 5 100000 = false := rfl
+
+theorem log2_big : Nat.log2 (10^500) = 1660 := by decide
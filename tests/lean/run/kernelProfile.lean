@@ -0,0 +1,7 @@
+set_option kernel.profile true in
+theorem kernelProfileTest : 2 + 2 = 4 := rfl
+
+set_option kernel.profile true in
+def kernelProfileDef (n : Nat) : Nat := n + 1
+
+example : kernelProfileDef 1 = 2 := rfl
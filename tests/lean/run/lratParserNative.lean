@@ -0,0 +1,23 @@
+import Std.Tactic.BVDecide.LRAT.Parser
+
+open Std.Tactic.BVDecide LRAT
+
+/-! The native LRAT parser must agree with the serializers for both formats. -/
+
+def proof : Array IntAction := #[
+  .addRup 5 #[1, -2] #[3, 4],
+  .del #[3, 4],
+  .addRat 7 #[2, 3] (2, true) #[1] #[(5, #[6, 8]), (9, #[])],
+  .addRat 8 #[-4] (4, false) #[] #[(70000, #[123456789])],
+  .addEmpty 9 #[5, 7]
+]
+
+#guard (parseLRATProof (lratProofToString proof).toUTF8).toOption == some proof
+#guard (parseLRATProof (lratProofToBinary proof)).toOption == some proof
+#guard (parseLRATProof "c comment\r\n5 1 -2 0 3 4 0\n".toUTF8).toOption ==
+  some #[.addRup 5 #[1, -2] #[3, 4]]
+#guard (parseLRATProof "".toUTF8).toOption.isNone
+#guard (parseLRATProof "5 1 x 0\n".toUTF8).toOption.isNone
+#guard (parseLRATProof "6 0 5 -3 0\n".toUTF8).toOption.isNone
+#guard (parseLRATProof "5 1 -2 0 3 4 0".toUTF8).toOption.isNone
+#guard (parseLRATProof ⟨#[0x61, 0x0b]⟩).toOption.isNone
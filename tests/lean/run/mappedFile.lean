@@ -0,0 +1,39 @@
+def tstMappedFile : IO Unit := do
+  let path := "tmp_mapped_file"
+  IO.FS.writeFile path "hello mmap"
+  let m ← IO.FS.MappedFile.mk path
+  m.advise .sequential
+  unless m.size == 10 do throw <| IO.userError s!"unexpected size {m.size}"
+  unless m.get! 0 == 'h'.toUInt8 && m.get! 9 == 'p'.toUInt8 do
+    throw <| IO.userError "unexpected bytes"
+  unless (m.extract 6 100).toList == "mmap".toUTF8.toList do
+    throw <| IO.userError "unexpected extract"
+  unless (m.extract 5 2).size == 0 do
+    throw <| IO.userError "expected empty extract"
+  unless m.hash == hash "hello mmap".toUTF8 do
+    throw <| IO.userError "unexpected hash"
+  IO.FS.writeFile path ""
+  let e ← IO.FS.MappedFile.mk path
+  unless e.size == 0 && (e.extract 0 1).size == 0 do throw <| IO.userError "unexpected empty file"
+  unless e.hash == hash ByteArray.empty do
+    throw <| IO.userError "unexpected hash of empty file"
+  IO.FS.removeFile path
+  try
+    discard <| IO.FS.MappedFile.mk path
+    throw <| IO.userError "expected an error for a missing file"
+  catch
+    | .noFileOrDirectory .. => pure ()
+    | e => throw e
+
+#eval tstMappedFile
+
+def tstHashBinFile : IO Unit := do
+  let path := "tmp_hash_bin_file"
+  for size in [0, 10, 65536, 200003] do
+    let contents := ByteArray.mk <| (Array.range size).map (·.toUInt8)
+    IO.FS.writeBinFile path contents
+    unless (← IO.FS.hashBinFile path) == hash contents do
+      throw <| IO.userError s!"unexpected hash of file of size {size}"
+  IO.FS.removeFile path
+
+#eval tstHashBinFile
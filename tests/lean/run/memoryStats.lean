@@ -0,0 +1,10 @@
+/-!
+`IO.getMemoryStats` reports the memory usage of the process.
+-/
+
+#eval show IO Unit from do
+  let st ← IO.getMemoryStats
+  unless st.rss > 0 && st.peakRss ≥ st.rss do
+    throw <| IO.userError s!"unexpected resident set size {repr st}"
+  unless st.softLimit ≤ st.hardLimit do
+    throw <| IO.userError s!"soft limit above hard limit {repr st}"
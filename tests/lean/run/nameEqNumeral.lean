@@ -0,0 +1,13 @@
+/-!
+`Name.beq` (`lean_name_eq`) must compare the numeric components of both names. All numerals of at
+least `2^64` have the same hash, so these names can only be told apart by the comparison itself.
+-/
+
+def n₁ : Lean.Name := .num `a (2^64)
+def n₂ : Lean.Name := .num `a (2^64 + 1)
+
+#guard hash n₁ == hash n₂
+#guard n₁ != n₂
+#guard n₁ == .num `a (2^64)
+#guard (n₁.str "b") != (n₂.str "b")
+#guard (Lean.Name.num n₁ 0) == (Lean.Name.num (.num `a (2^64)) 0)
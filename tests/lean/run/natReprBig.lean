@@ -0,0 +1,9 @@
+/-! `Nat.repr` of big numbers is computed natively; check it against `Nat.toDigits`. -/
+
+def reprRef (n : Nat) : String := (Nat.toDigits 10 n).asString
+
+#guard (2^64).repr = "18446744073709551616"
+#guard (10^100).repr = reprRef (10^100)
+#guard (10^100 - 1).repr = reprRef (10^100 - 1)
+#guard (3^1000).repr = reprRef (3^1000)
+#guard ((2^4096 + 12345) * 7^333).repr = reprRef ((2^4096 + 12345) * 7^333)
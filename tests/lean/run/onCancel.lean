@@ -0,0 +1,24 @@
+/-!
+`IO.onCancel` wakes up a task blocked on a promise when the task is canceled.
+-/
+
+def waitCanceled : IO Bool := do
+  let p : IO.Promise Unit ← IO.Promise.new
+  let t ← IO.asTask (prio := .dedicated) do
+    IO.onCancel (p.resolve ())
+    discard <| IO.wait p.result?
+    IO.checkCanceled
+  IO.sleep 10
+  IO.cancel t
+  match ← IO.wait t with
+  | .ok canceled => return canceled
+  | .error e => throw e
+
+def outsideTask : IO Unit := do
+  -- no task to be canceled
+  IO.onCancel (pure ())
+  assert! !(← IO.checkCanceled)
+
+#eval do
+  assert! (← waitCanceled)
+  outsideTask
@@ -0,0 +1,18 @@
+import Lean.Data.PersistentArray
+
+open Lean
+
+/-! `PersistentArray.ofArray` builds the same tree as pushing the elements one by one. -/
+
+def pushAll (xs : Array Nat) : PersistentArray Nat :=
+  xs.foldl (init := {}) PersistentArray.push
+
+def sameShape (n : Nat) : Bool :=
+  let xs := Array.range n
+  let a := PersistentArray.ofArray xs
+  let b := pushAll xs
+  a.size == b.size && a.tailOff == b.tailOff && a.shift == b.shift &&
+    toString a.stats == toString b.stats && a.toArray == xs &&
+    (a.push n).toArray == xs.push n && a.pop.toArray == xs.pop
+
+#guard [0, 1, 31, 32, 33, 1023, 1024, 1055, 1056, 1057, 2600, 32767, 32768, 32800, 32801].all sameShape
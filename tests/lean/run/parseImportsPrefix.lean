@@ -0,0 +1,17 @@
+import Lean.Elab.ParseImportsFast
+
+open Lean ParseImports
+
+/-! Headers parsed from a prefix of a file must only be used if the rest cannot change them. -/
+
+def modules (s : String) : Option (List Name) :=
+  (parsePrefix? s.toUTF8).map (·.toList.map (·.module))
+
+#guard modules "import A\nimport B.C\n\ndef x := 1\n" == some [`Init, `A, `B.C]
+#guard modules "prelude\nimport A\ntheorem t : True := trivial\n" == some [`A]
+-- the header may continue after the prefix
+#guard modules "import A\nimport B\n" == none
+#guard modules "import A\nimport B.C\ndef" == none
+#guard modules "import A\n-- comment\nimport\n" == none
+#guard modules "import A\n/- unterminated\ncomment\n" == none
+#guard modules "import A\nimport B.Cd" == none
@@ -0,0 +1,27 @@
+import Lean.Parser.Basic
+
+open Lean.Parser
+
+/-! The native scanning functions used by the tokenizer, and the constructs that use them. -/
+
+#guard asciiIdRestEnd "" 0 == 0
+#guard asciiIdRestEnd "foo_bar'!? baz" 0 == 10
+#guard asciiIdRestEnd "fooα" 0 == 3
+#guard asciiIdRestEnd "x.y" 1 == 1
+#guard asciiIdRestEnd "abc" 7 == 7
+
+#guard asciiBlankEnd "        \n    x" 0 == 13
+#guard asciiBlankEnd "  \t " 0 == 2
+#guard asciiBlankEnd "                  " 3 == 18
+
+#guard nextCommentDelimByte "a comment that is long -/" 0 == 23
+#guard nextCommentDelimByte "αβγδεζηθ/" 0 == 16
+#guard nextCommentDelimByte "none" 0 == 4
+
+/- A block comment with /- a nested one -/ and trailing text - and / characters -/
+-- a line comment with identifiers like x' and x₁
+def x₁ := 1
+def fooα' := x₁   -- comment   after   spaces
+
+
+#guard fooα' == 1
@@ -0,0 +1,19 @@
+/-!
+# `IO.Process.output` drains stdout and stderr concurrently
+
+The child writes far more than a pipe buffer to stderr before writing to stdout, which would stall
+if the two streams were read one after the other.
+-/
+
+def test : IO Unit := do
+  if System.Platform.isWindows then return
+  let out ← IO.Process.output {
+    cmd := "sh", args := #["-c", "head -c 1000000 /dev/zero | tr '\\0' e >&2; echo out; exit 2"] }
+  assert! out.exitCode == 2
+  assert! out.stdout == "out\n"
+  assert! out.stderr.length == 1000000
+  assert! out.stderr.all (· == 'e')
+  let out ← IO.Process.output { cmd := "sh", args := #["-c", "true"] }
+  assert! out.stdout == "" && out.stderr == ""
+
+#eval test
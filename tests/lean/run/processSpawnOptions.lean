@@ -0,0 +1,27 @@
+/-!
+# Process spawning honours environment, working directory and stdio configuration
+
+These exercise both the `posix_spawn` path and the `fork` fallback (used e.g. when `PATH` is
+modified).
+-/
+
+def sh (script : String) (cfg : IO.Process.SpawnArgs → IO.Process.SpawnArgs := id) :
+    IO IO.Process.Output :=
+  IO.Process.output (cfg { cmd := "sh", args := #["-c", script] })
+
+def test : IO Unit := do
+  if System.Platform.isWindows then return
+  let out ← sh "echo $FOO-$HOME" fun a => { a with env := #[("FOO", some "bar"), ("HOME", none)] }
+  assert! out.stdout == "bar-\n"
+  let out ← sh "echo $FOO" fun a => { a with env := #[("FOO", some "a"), ("FOO", some "b")] }
+  assert! out.stdout == "b\n"
+  let out ← sh "pwd" fun a => { a with cwd := some "/" }
+  assert! out.stdout == "/\n"
+  let out ← sh "echo err >&2; exit 3" fun a => { a with setsid := true }
+  assert! out.stderr == "err\n" && out.exitCode == 3
+  let out ← sh "cat" fun a => { a with stdin := .null }
+  assert! out.stdout == "" && out.exitCode == 0
+  let out ← IO.Process.output { cmd := "/bin/sh", args := #["-c", "echo $PATH"], env := #[("PATH", some "/nowhere")] }
+  assert! out.stdout == "/nowhere\n"
+
+#eval test
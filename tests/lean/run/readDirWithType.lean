@@ -0,0 +1,23 @@
+/-!
+# `System.FilePath.readDirWithType` reports entry types without following symbolic links
+-/
+
+def sortedNames (entries : Array (IO.FS.DirEntry × IO.FS.FileType)) : List (String × String) :=
+  (entries.map fun (e, t) => (e.fileName, reprStr t)).toList.mergeSort (·.1 ≤ ·.1)
+
+def test : IO Unit := do
+  let root : System.FilePath := "readDirWithType_test"
+  if ← root.isDir then
+    IO.FS.removeDirAll root
+  IO.FS.createDirAll (root / "sub" / "inner")
+  IO.FS.writeFile (root / "a.txt") "a"
+  IO.FS.writeFile (root / "sub" / "b.txt") "b"
+  let entries ← root.readDirWithType
+  assert! sortedNames entries == [("a.txt", "IO.FS.FileType.file"), ("sub", "IO.FS.FileType.dir")]
+  assert! entries.all fun (e, _) => e.root == root
+  let walked := (← root.walkDir).map (·.toString) |>.qsort (· < ·)
+  assert! walked == #[root / "a.txt", root / "sub", root / "sub" / "b.txt", root / "sub" / "inner"].map (·.toString)
+  IO.FS.removeDirAll root
+  assert! !(← root.pathExists)
+
+#eval test
@@ -0,0 +1,53 @@
+/-! Iota reduction in the kernel for recursors with many rules, which are looked up through an index. -/
+
+inductive Op where
+  | op0
+  | op1
+  | op2
+  | op3
+  | op4
+  | op5
+  | op6
+  | op7
+  | op8
+  | op9
+  | op10
+  | op11
+  | op12
+  | op13
+  | op14
+  | op15
+  | op16
+  | op17
+  | op18
+  | op19
+  deriving Repr
+
+def Op.code : Op → Nat
+  | .op0 => 0
+  | .op1 => 1
+  | .op2 => 2
+  | .op3 => 3
+  | .op4 => 4
+  | .op5 => 5
+  | .op6 => 6
+  | .op7 => 7
+  | .op8 => 8
+  | .op9 => 9
+  | .op10 => 10
+  | .op11 => 11
+  | .op12 => 12
+  | .op13 => 13
+  | .op14 => 14
+  | .op15 => 15
+  | .op16 => 16
+  | .op17 => 17
+  | .op18 => 18
+  | .op19 => 19
+
+example : Op.op0.code = 0 := rfl
+example : Op.op7.code = 7 := rfl
+example : Op.op19.code = 19 := rfl
+
+theorem Op.code_lt (o : Op) : o.code < 20 := by
+  cases o <;> decide
@@ -0,0 +1,40 @@
+/-!
+# Contended `IO.Ref`s
+
+Threads waiting for the value of a shared ref first spin and then park until the value is put back.
+-/
+
+def slowSucc (n : Nat) : Nat := Id.run do
+  let mut x := n
+  for _ in [0:200] do
+    x := x + 1
+  return x - 199
+
+def contendedModify : IO Unit := do
+  let r ← IO.mkRef (0 : Nat)
+  let (spins₁, _) ← IO.getRefContention
+  let ts ← (List.range 8).mapM fun _ => IO.asTask do
+    for _ in [0:2000] do
+      r.modify slowSucc
+      discard <| r.get
+  for t in ts do
+    discard <| IO.ofExcept (← IO.wait t)
+  assert! (← r.get) == 16000
+  let (spins₂, _) ← IO.getRefContention
+  assert! spins₁ ≤ spins₂
+
+def contendedSwap : IO Unit := do
+  let r ← IO.mkRef (0 : Nat)
+  let ts ← (List.range 8).mapM fun i => IO.asTask do
+    let mut sum := 0
+    for j in [0:1000] do
+      sum := sum + (← r.swap (i * 1000 + j + 1))
+    return sum
+  let mut sum := 0
+  for t in ts do
+    sum := sum + (← IO.ofExcept (← IO.wait t))
+  -- every value is returned by exactly one swap, except for the last one which stays in the ref
+  assert! sum + (← r.get) == (List.range 8001).foldl (· + ·) 0
+
+#eval contendedModify
+#eval contendedSwap
@@ -0,0 +1,38 @@
+import Std.Internal.Async.Timer
+
+open Std.Internal.IO.Async
+
+/-!
+`IO.select` resolves with the first finished task and does not wait for the others.
+-/
+
+#eval show IO Unit from do
+  let promises ← (List.range 5).toArray.mapM fun _ => IO.Promise.new (α := Nat)
+  let t ← IO.select (promises.map (·.result!)) (by simp)
+  if (← IO.hasFinished t) then
+    throw <| IO.userError "select finished too early"
+  promises[3]!.resolve 42
+  promises[1]!.resolve 1
+  unless t.get == (3, 42) do
+    throw <| IO.userError s!"unexpected result {t.get}"
+
+#eval show IO Unit from do
+  let p ← IO.Promise.new (α := Nat)
+  let t ← IO.select #[p.result!, Task.pure 7, Task.pure 8]
+  unless t.get == (1, 7) do
+    throw <| IO.userError s!"unexpected result {t.get}"
+
+-- Many selects over a promise that is never resolved must not keep their continuations around.
+#eval show IO Unit from do
+  let never ← IO.Promise.new (α := Nat)
+  for i in [0:1000] do
+    let t ← IO.select #[never.result!, Task.spawn fun _ => i]
+    unless t.get == (1, i) do
+      throw <| IO.userError s!"unexpected result {t.get}"
+
+-- A timeout by racing an I/O result against a timer.
+#eval show IO Unit from do
+  let never ← IO.Promise.new (α := Except IO.Error Unit)
+  let timeout ← sleep 10
+  let t ← AsyncTask.race (.ofPromise never) timeout
+  t.block
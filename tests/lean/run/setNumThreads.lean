@@ -0,0 +1,16 @@
+/-!
+Resizing the task manager at runtime does not lose queued tasks.
+-/
+
+#eval show IO Unit from do
+  let n ← IO.getNumThreads
+  if n == 0 then return
+  IO.setNumThreads 1
+  unless (← IO.getNumThreads) == 1 do
+    throw <| IO.userError "expected a single worker"
+  let tasks := (List.range 32).map fun i => Task.spawn fun _ => i + 1
+  IO.setNumThreads (n + 2)
+  let sum := tasks.foldl (fun acc t => acc + t.get) 0
+  IO.setNumThreads n
+  unless sum == 32 * 33 / 2 do
+    throw <| IO.userError s!"unexpected sum {sum}"
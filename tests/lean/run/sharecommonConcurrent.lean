@@ -0,0 +1,31 @@
+open ShareCommon
+
+def check (b : Bool) : IO Unit := do
+  unless b do throw <| IO.userError "check failed"
+
+def mkTerm (n : Nat) : List (String × Nat) :=
+  (List.range n).map fun i => (toString i, i)
+
+unsafe def tst : IO Unit := do
+  let t ← ConcurrentTable.new
+  let x := mkTerm 20
+  let y := mkTerm 20
+  check <| ptrAddrUnsafe x != ptrAddrUnsafe y
+  let x ← t.shareCommon x
+  let y ← t.shareCommon y
+  check <| ptrAddrUnsafe x == ptrAddrUnsafe y
+  -- Terms hash-consed by different tasks are shared with each other
+  let tasks ← (List.range 8).mapM fun _ => IO.asTask (t.shareCommon (mkTerm 20))
+  for task in tasks do
+    let z ← IO.ofExcept task.get
+    check <| ptrAddrUnsafe z == ptrAddrUnsafe x
+  -- Sharing an already shared term returns it unchanged
+  let x' ← t.shareCommon x
+  check <| ptrAddrUnsafe x' == ptrAddrUnsafe x
+  let z ← t.shareCommon (mkTerm 3)
+  check <| ptrAddrUnsafe z.tail != ptrAddrUnsafe x.tail
+  IO.println z
+
+/-- info: [(0, 0), (1, 1), (2, 2)] -/
+#guard_msgs in
+#eval tst
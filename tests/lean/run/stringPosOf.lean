@@ -0,0 +1,30 @@
+/-!
+# `String.posOf` is implemented natively by `lean_string_pos_of_aux`
+
+We compare it against the reference loop, including positions inside multi-byte characters and
+past the end of the string.
+-/
+
+partial def refPosOfAux (s : String) (c : Char) (stopPos : String.Pos) (pos : String.Pos) : String.Pos :=
+  if pos < stopPos then
+    if s.get pos == c then pos
+    else refPosOfAux s c stopPos (s.next pos)
+  else pos
+
+def sameAsRef (s : String) : Bool := Id.run do
+  for c in ['a', 'A', '∀', '😀', ' ', 'z'] do
+    for b in [0:s.utf8ByteSize + 3] do
+      for e in [0:s.utf8ByteSize + 5] do
+        if String.posOfAux s c ⟨e⟩ ⟨b⟩ != refPosOfAux s c ⟨e⟩ ⟨b⟩ then
+          return false
+  return true
+
+#guard "abba".posOf 'a' = ⟨0⟩
+#guard "abba".posOf 'z' = ⟨4⟩
+#guard "L∃∀N".posOf '∀' = ⟨4⟩
+#guard "".posOf 'a' = ⟨0⟩
+#guard "😀a😀".posOf 'a' = ⟨4⟩
+#guard sameAsRef ""
+#guard sameAsRef "abA∃∀N"
+#guard sameAsRef "😀 ∀a∀ A😀"
+#guard sameAsRef "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa∀"
@@ -0,0 +1,69 @@
+import Std.Sync
+open Std
+
+def sharedMutex : IO Unit := do
+  let m ← SharedMutex.new (0 : Nat)
+  let writers ← (List.range 4).mapM fun _ => IO.asTask do
+    for _ in [0:1000] do
+      m.atomically (modify (· + 1))
+  let readers ← (List.range 4).mapM fun _ => IO.asTask do
+    for _ in [0:1000] do
+      let v ← m.atomicallyRead (m := IO) read
+      assert! v ≤ 4000
+  for t in writers ++ readers do
+    discard <| IO.ofExcept (← IO.wait t)
+  assert! (← m.atomicallyRead (m := IO) read) == 4000
+
+def baseSharedMutex : IO Unit := do
+  let m ← BaseSharedMutex.new
+  m.lockShared
+  -- the lock is tried from another thread, trying it from the holding thread is undefined behavior
+  let tryRead := IO.asTask do
+    let ok ← m.tryLockShared
+    if ok then m.unlockShared
+    return ok
+  assert! (← IO.wait (← tryRead)) matches .ok true
+  assert! (← IO.wait (← IO.asTask m.tryLock)) matches .ok false
+  m.unlockShared
+  m.lock
+  assert! (← IO.wait (← tryRead)) matches .ok false
+  m.unlock
+
+def atomicCounter : IO Unit := do
+  let a ← AtomicUInt64.new
+  let ts ← (List.range 8).mapM fun _ => IO.asTask do
+    for _ in [0:1000] do
+      discard <| a.fetchAdd 1
+  for t in ts do
+    discard <| IO.ofExcept (← IO.wait t)
+  assert! (← a.load) == 8000
+  assert! (← a.fetchSub 8001) == 8000
+  assert! (← a.load) == UInt64.ofNat (2^64 - 1)
+  assert! !(← a.compareAndSwap 5 6)
+  assert! (← a.compareAndSwap (UInt64.ofNat (2^64 - 1)) 6)
+  assert! (← a.swap 7) == 6
+  a.store 9
+  assert! (← a.load) == 9
+
+def refCompareAndSwap : IO Unit := do
+  let r ← IO.mkRef #[1, 2, 3]
+  let old ← r.get
+  assert! (← r.compareAndSwap old #[4])
+  -- `old` is no longer the current value
+  assert! !(← r.compareAndSwap old #[5])
+  assert! (← r.get) == #[4]
+  -- concurrent increments with a retry loop
+  let n ← IO.mkRef (0 : Nat)
+  let ts ← (List.range 4).mapM fun _ => IO.asTask do
+    for _ in [0:1000] do
+      repeat
+        let v ← n.get
+        if (← n.compareAndSwap v (v + 1)) then break
+  for t in ts do
+    discard <| IO.ofExcept (← IO.wait t)
+  assert! (← n.get) == 4000
+
+#eval sharedMutex
+#eval baseSharedMutex
+#eval atomicCounter
+#eval refCompareAndSwap
@@ -0,0 +1,29 @@
+/-! Results shared between commands must be invalidated when the set of instances changes. -/
+
+set_option synthInstance.sharedCache true
+
+class Foo (α : Type) where
+  val : Nat
+
+instance : Foo Nat := ⟨1⟩
+
+#guard (Foo.val Nat) == 1
+#guard (Foo.val Nat) == 1
+
+instance (priority := high) : Foo Nat := ⟨2⟩
+
+#guard (Foo.val Nat) == 2
+
+example : Decidable ((1 : Nat) = 2) := inferInstance
+example : Decidable ((1 : Nat) = 2) := inferInstance
+
+section
+local instance (priority := high) : Foo Nat := ⟨3⟩
+
+#guard (Foo.val Nat) == 3
+end
+
+#guard (Foo.val Nat) == 2
+
+-- Problems with local instances are not shared
+example [Foo Bool] : Foo.val Bool = Foo.val Bool := rfl
@@ -0,0 +1,28 @@
+/-!
+`Task.get` on a task that is still queued runs it on the waiting thread. Check that a long chain of
+queued tasks, each of which gets its predecessor, does not overflow the stack of the waiter.
+-/
+
+def chain (n : Nat) : Task Nat := Id.run do
+  let mut t := Task.pure 0
+  for _ in [0:n] do
+    let prev := t
+    t := Task.spawn fun _ => prev.get + 1
+  return t
+
+#eval show IO Unit from do
+  let n ← IO.getNumThreads
+  if n == 0 then return
+  -- Keep the only worker busy so that the whole chain is still queued when we wait for it.
+  IO.setNumThreads 1
+  let stop ← IO.mkRef false
+  let busy ← IO.asTask do
+    while !(← stop.get) do
+      IO.sleep 0
+  let t := chain 5000
+  let r := t.get
+  stop.set true
+  let _ ← IO.wait busy
+  IO.setNumThreads n
+  unless r == 5000 do
+    throw <| IO.userError s!"unexpected result {r}"
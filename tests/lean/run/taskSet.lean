@@ -0,0 +1,36 @@
+/-!
+`IO.TaskSet` returns every added task exactly once, in completion order, and `none` once drained.
+-/
+
+#eval show IO Unit from do
+  let set ← IO.TaskSet.new
+  let promises ← (List.range 10).mapM fun _ => IO.Promise.new (α := Nat)
+  for p in promises do
+    set.add p.result!
+  set.add (Task.pure 100)
+  unless (← set.size) == 11 do
+    throw <| IO.userError "unexpected size"
+  -- only the pure task is finished so far
+  let some t ← set.tryTake? | throw <| IO.userError "expected a finished task"
+  unless t.get == 100 do
+    throw <| IO.userError "unexpected first task"
+  if (← set.tryTake?).isSome then
+    throw <| IO.userError "no other task should be finished"
+  for p in promises.reverse, i in [0:10] do
+    p.resolve i
+    let some t ← set.take? | throw <| IO.userError "expected a task"
+    unless t.get == i do
+      throw <| IO.userError s!"unexpected task result {t.get}"
+  if (← set.take?).isSome then
+    throw <| IO.userError "set should be empty"
+
+#eval show IO Unit from do
+  let set ← IO.TaskSet.new
+  for i in [0:100] do
+    set.add <| Task.spawn fun _ => i * i
+  let mut sum := 0
+  while true do
+    let some t ← set.take? | break
+    sum := sum + t.get
+  unless sum == (List.range 100).foldl (fun acc i => acc + i * i) 0 do
+    throw <| IO.userError s!"unexpected sum {sum}"
@@ -0,0 +1,27 @@
+/-!
+Tasks whose closures own their data exclusively do not mark it as multi-threaded. Check that
+exclusive and shared captured values are handled correctly when both are used by several tasks.
+-/
+
+def sumTasks (shared : Array Nat) : IO Nat := do
+  let mut tasks := #[]
+  for i in [0:16] do
+    -- `own` is only referenced by the task closure, `shared` by all of them
+    let own := (List.range (1000 + i)).toArray
+    tasks := tasks.push <| Task.spawn fun _ =>
+      let own := own.map (· + 1)
+      own.foldl (· + ·) 0 + shared.foldl (· + ·) 0
+  return tasks.foldl (fun acc t => acc + t.get) 0
+
+def expected (shared : Array Nat) : Nat := Id.run do
+  let mut r := 0
+  for i in [0:16] do
+    let n := 1000 + i
+    r := r + n * (n + 1) / 2 + shared.foldl (· + ·) 0
+  return r
+
+#eval do
+  let shared := (List.range 100).toArray
+  let r ← sumTasks shared
+  unless r == expected shared do
+    throw <| IO.userError s!"unexpected result {r}"
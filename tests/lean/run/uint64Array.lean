@@ -0,0 +1,31 @@
+/-!
+# `UInt64Array` stores its elements unboxed
+-/
+
+def big : UInt64 := 0xFFFFFFFFFFFFFFFF
+
+def a : UInt64Array := [1, big, 3].toUInt64Array
+
+#guard a.size = 3
+#guard a[1]! = big
+#guard a.get! 7 = 0
+#guard (a.set! 0 big).toList = [big, big, 3]
+#guard a.set! 9 0 |>.toList = [1, big, 3]
+#guard (a.push 4).data = #[1, big, 3, 4]
+#guard (UInt64Array.mk #[5, 6]).toList = [5, 6]
+#guard a.foldl (· + ·) 0 = 3
+#guard toString (UInt64Array.empty.push 2) = "[2]"
+
+def sumFor (a : UInt64Array) : UInt64 := Id.run do
+  let mut s := 0
+  for x in a do
+    s := s + x
+  return s
+
+#guard sumFor a = 3
+
+def casesOn (a : UInt64Array) : Nat :=
+  match a with
+  | ⟨xs⟩ => xs.size
+
+#guard casesOn a = 3